@@ -0,0 +1,296 @@
+// benchmark.cc
+//
+// Description:
+// Microbenchmarks for the core kernels of the IBPM library: curl, inner
+// products, the 2d elliptic solve, the regularizer transfers, the
+// Cholesky constraint solve, and a full RK3 timestep, across a range of
+// grid sizes.
+//
+// Output is machine-readable CSV on stdout, one row per measurement:
+//     benchmark,nx,calls,mean_seconds,min_seconds
+// Each case is run once to warm up (FFTW planning, buffer pools), then
+// repeated until at least MIN_TIME seconds have elapsed.  The minimum is
+// the most stable statistic to compare across commits; the gap between
+// mean and minimum shows the jitter of the run.
+//
+// Usage:
+//     ./benchmark [sizes] [filter]
+// where sizes is a comma-separated list of grid sizes (default
+// "256,512,1024,2048") and filter restricts the run to benchmarks whose
+// name contains the given substring.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ibpm.h"
+#include "CholeskySolver.h"
+#include "EllipticSolver2d.h"
+
+using namespace std;
+using namespace ibpm;
+
+namespace {
+
+const double MIN_TIME = 0.2;    // seconds of repetitions per measurement
+
+double sink = 0.;               // defeats dead-code elimination
+
+// Return true if the given benchmark should run
+bool want( const char* name, const char* filter ) {
+    return ( filter == NULL ) || ( strstr( name, filter ) != NULL );
+}
+
+// Fill a scalar field with a smooth function, so that solves and
+// products run on representative data
+void fillScalar( Scalar& f ) {
+    const Grid& grid = f.getGrid();
+    for (int lev=0; lev<f.Ngrid(); ++lev) {
+        for (int i=1; i<f.Nx(); ++i) {
+            for (int j=1; j<f.Ny(); ++j) {
+                double x = grid.getXEdge(lev,i);
+                double y = grid.getYEdge(lev,j);
+                f(lev,i,j) = sin(x) * cos(y);
+            }
+        }
+    }
+}
+
+// One benchmark case: run() executes the operation once
+struct Benchmark {
+    virtual ~Benchmark() {}
+    virtual void run() = 0;
+};
+
+void measure( const char* name, int nx, Benchmark& b ) {
+    b.run();    // warm up: FFTW planning, buffer pools, caches
+
+    // calibrate the number of repetitions
+    double t0 = Timers::readClock();
+    b.run();
+    double once = Timers::readClock() - t0;
+    int calls = 1;
+    if ( once < MIN_TIME ) {
+        calls = (int) ( MIN_TIME / ( once > 1.e-9 ? once : 1.e-9 ) ) + 1;
+    }
+
+    double total = 0.;
+    double best = 0.;
+    for (int i=0; i<calls; ++i) {
+        double start = Timers::readClock();
+        b.run();
+        double elapsed = Timers::readClock() - start;
+        total += elapsed;
+        if ( i == 0 || elapsed < best ) best = elapsed;
+    }
+    printf( "%s,%d,%d,%.6e,%.6e\n", name, nx, calls, total / calls, best );
+    fflush( stdout );
+}
+
+// ~~~ individual benchmarks ~~~
+
+// Curl( Scalar, Flux )
+struct CurlFluxBench : public Benchmark {
+    CurlFluxBench( const Grid& grid ) : f(grid), q(grid) { fillScalar(f); }
+    void run() { Curl( f, q ); }
+    Scalar f;
+    Flux q;
+};
+
+// Curl( Flux, Scalar )
+struct CurlScalarBench : public Benchmark {
+    CurlScalarBench( const Grid& grid ) : q(grid), f(grid) {
+        Scalar psi(grid);
+        fillScalar(psi);
+        Curl( psi, q );
+    }
+    void run() { Curl( q, f ); }
+    Flux q;
+    Scalar f;
+};
+
+// InnerProduct( Scalar, Scalar )
+struct ScalarIPBench : public Benchmark {
+    ScalarIPBench( const Grid& grid ) : f(grid), g(grid) {
+        fillScalar(f);
+        fillScalar(g);
+    }
+    void run() { sink += InnerProduct( f, g ); }
+    Scalar f;
+    Scalar g;
+};
+
+// InnerProduct( Flux, Flux )
+struct FluxIPBench : public Benchmark {
+    FluxIPBench( const Grid& grid ) : p(grid), q(grid) {
+        Scalar psi(grid);
+        fillScalar(psi);
+        Curl( psi, p );
+        Curl( psi, q );
+    }
+    void run() { sink += InnerProduct( p, q ); }
+    Flux p;
+    Flux q;
+};
+
+// EllipticSolver2d::solve (Poisson, single level)
+struct Poisson2dBench : public Benchmark {
+    Poisson2dBench( const Grid& grid ) :
+        solver( grid.Nx(), grid.Ny(), grid.Dx() ),
+        rhs( grid.Nx()-1, grid.Ny()-1, 1, 1 ),
+        u( grid.Nx()-1, grid.Ny()-1, 1, 1 ) {
+        for (int i=1; i<grid.Nx(); ++i) {
+            for (int j=1; j<grid.Ny(); ++j) {
+                rhs(i,j) = sin( grid.getXEdge(0,i) ) * cos( grid.getYEdge(0,j) );
+            }
+        }
+    }
+    void run() { solver.solve( rhs, u ); }
+    PoissonSolver2d solver;
+    Array::Array2<double> rhs;
+    Array::Array2<double> u;
+};
+
+// Regularizer::toFlux (smearing) and toBoundary (interpolation)
+struct RegularizerBench : public Benchmark {
+    RegularizerBench( const Grid& grid, const Geometry& geom, bool smear ) :
+        _smear( smear ),
+        reg( grid, geom ),
+        u1( geom.getNumPoints() ),
+        u2( grid ) {
+        reg.update();
+        u1 = 1.;
+        reg.toFlux( u1, u2 );
+    }
+    void run() {
+        if ( _smear ) reg.toFlux( u1, u2 );
+        else reg.toBoundary( u2, u1 );
+    }
+    bool _smear;
+    Regularizer reg;
+    BoundaryVector u1;
+    Flux u2;
+};
+
+// CholeskySolver::Minv (one back-substitution against the factor)
+struct CholeskyMinvBench : public Benchmark {
+    CholeskyMinvBench( const Grid& grid, const NavierStokesModel& model,
+                       int numPoints ) :
+        solver( grid, model, 0.005 ) {
+        solver.init();
+        b.push_back( BoundaryVector( numPoints ) );
+        x.push_back( BoundaryVector( numPoints ) );
+        b[0] = 1.;
+        x[0] = 0.;
+    }
+    void run() { solver.Minv( b, x ); }
+    CholeskySolver solver;
+    vector<BoundaryVector> b;
+    vector<BoundaryVector> x;
+};
+
+// One full RK3 step of the nonlinear solver
+struct RK3StepBench : public Benchmark {
+    RK3StepBench( Grid& grid, NavierStokesModel& model, int numPoints ) :
+        solver( grid, model, 0.01, Scheme::RK3 ),
+        x( grid, numPoints ) {
+        solver.init();
+        fillScalar( x.omega );
+        model.refreshState( x );
+    }
+    void run() { solver.advance( x ); }
+    NonlinearIBSolver solver;
+    State x;
+};
+
+void runSize( int nx, const char* filter ) {
+    Grid grid( nx, nx, 1, 4., -2., -2. );
+
+    if ( want( "curl_scalar_to_flux", filter ) ) {
+        CurlFluxBench b( grid );
+        measure( "curl_scalar_to_flux", nx, b );
+    }
+    if ( want( "curl_flux_to_scalar", filter ) ) {
+        CurlScalarBench b( grid );
+        measure( "curl_flux_to_scalar", nx, b );
+    }
+    if ( want( "curl_scalar_to_flux_3lev", filter ) ) {
+        // multi-domain variant, exercising the coarse-fine boundary
+        // interpolation as well
+        Grid grid3( nx, nx, 3, 4., -2., -2. );
+        CurlFluxBench b( grid3 );
+        measure( "curl_scalar_to_flux_3lev", nx, b );
+    }
+    if ( want( "innerproduct_scalar", filter ) ) {
+        ScalarIPBench b( grid );
+        measure( "innerproduct_scalar", nx, b );
+    }
+    if ( want( "innerproduct_flux", filter ) ) {
+        FluxIPBench b( grid );
+        measure( "innerproduct_flux", nx, b );
+    }
+    if ( want( "elliptic2d_poisson", filter ) ) {
+        Poisson2dBench b( grid );
+        measure( "elliptic2d_poisson", nx, b );
+    }
+
+    // cases needing a body: a circle of radius 0.5, with boundary points
+    // spaced like the grid
+    Geometry geom;
+    RigidBody body;
+    body.addCircle( 0., 0., 0.5, grid.Dx() );
+    geom.addBody( body );
+
+    if ( want( "regularizer_smear", filter ) ) {
+        RegularizerBench b( grid, geom, true );
+        measure( "regularizer_smear", nx, b );
+    }
+    if ( want( "regularizer_interp", filter ) ) {
+        RegularizerBench b( grid, geom, false );
+        measure( "regularizer_interp", nx, b );
+    }
+
+    if ( want( "cholesky_minv", filter ) || want( "rk3_step", filter ) ) {
+        NavierStokesModel model( grid, geom, 100. );
+        model.init();
+        if ( want( "cholesky_minv", filter ) ) {
+            CholeskyMinvBench b( grid, model, geom.getNumPoints() );
+            measure( "cholesky_minv", nx, b );
+        }
+        if ( want( "rk3_step", filter ) ) {
+            RK3StepBench b( grid, model, geom.getNumPoints() );
+            measure( "rk3_step", nx, b );
+        }
+    }
+}
+
+} // namespace
+
+int main( int argc, char* argv[] ) {
+    string sizes = ( argc > 1 ) ? argv[1] : "256,512,1024,2048";
+    const char* filter = ( argc > 2 ) ? argv[2] : NULL;
+
+    printf( "benchmark,nx,calls,mean_seconds,min_seconds\n" );
+    fflush( stdout );
+
+    string::size_type pos = 0;
+    while ( pos <= sizes.size() ) {
+        string::size_type comma = sizes.find( ',', pos );
+        if ( comma == string::npos ) comma = sizes.size();
+        int nx = atoi( sizes.substr( pos, comma - pos ).c_str() );
+        if ( nx > 0 ) runSize( nx, filter );
+        pos = comma + 1;
+    }
+
+    // keep the accumulated results observable
+    fprintf( stderr, "checksum %g\n", sink );
+    return 0;
+}
@@ -1,21 +1,29 @@
 #!/bin/bash
+#
+# Speed benchmarking cases, one reproducible command each.  The solver's
+# -benchmark mode constructs no output machinery and formats no force
+# lines, runs a few untimed warmup steps, and prints per-step statistics
+# (mean/p50/p99) with a per-stage breakdown, so the numbers measure the
+# solver alone and regressions show up run to run.
 
-echo "Speed benchmarking tests"
-echo "Stationary body, body fixed frame running...time taken is "
-tfixedubf1="$(TIMEFORMAT='%lU'; (time ./build/ibpm -outdir benchmarking/benchout -tecplot 0 -restart 0 -nx 200 -ny 200 -ngrid 3 -length 4 -xoffset -2 -yoffset -2 -xshift 0.72 -geom benchmarking/cylinder2Pa.geom -ubf 1 -Re 100 -dt 0.01 -nsteps 20 -scheme euler  2>&1 1>/dev/null))"
-
-rm benchmarking/benchout/*
-echo "Stationary body, inertial frame running...time taken is "
-tfixedubf0="$(TIMEFORMAT='%lU'; (time ./build/ibpm -outdir benchmarking/benchout -tecplot 0 -restart 0 -nx 200 -ny 200 -ngrid 3 -length 4 -xoffset -2 -yoffset -2 -xshift 0.72 -geom benchmarking/cylinder2Pa.geom -ubf 0 -Re 100 -dt 0.01 -nsteps 20 -scheme euler 2>&1 1>/dev/null))"
-
-rm benchmarking/benchout/*
-echo "Moving body, body fixed frame running...time taken is "
-tplungeubf1="$(TIMEFORMAT='%lU'; (time ./build/ibpm -outdir benchmarking/benchout -tecplot 0 -restart 0 -nx 200 -ny 200 -ngrid 3 -length 4 -xoffset -2 -yoffset -2 -xshift 0.72 -geom benchmarking/cylinder2PaPlunge.geom -ubf 1 -Re 100 -dt 0.01 -nsteps 20 -scheme euler 2>&1 1>/dev/null))"
+common="-outdir benchmarking/benchout -nx 200 -ny 200 -ngrid 3 -length 4 -xoffset -2 -yoffset -2 -xshift 0.72 -Re 100 -dt 0.01 -scheme euler -benchmark 1 -warmup 5 -nsteps 20"
 
-rm benchmarking/benchout/*
-echo "Moving body, inertial frame running...time taken is"
-tplungeubf0="$(TIMEFORMAT='%lU'; (time ./build/ibpm -outdir benchmarking/benchout -tecplot 0 -restart 0 -nx 200 -ny 200 -ngrid 3 -length 4 -xoffset -2 -yoffset -2 -xshift 0.72 -geom benchmarking/cylinder2PaPlunge.geom -ubf 0 -Re 100 -dt 0.01 -nsteps 20 -scheme euler 2>&1 1>/dev/null))"
-
-rm benchmarking/benchout/*
+run_case () {
+    echo ""
+    echo "=== $1 ==="
+    shift
+    ./build/ibpm $common "$@" | sed -n '/Benchmark report/,$p'
+    rm -f benchmarking/benchout/*
+}
 
+echo "Speed benchmarking tests"
+mkdir -p benchmarking/benchout
 
+run_case "Stationary body, body fixed frame" \
+    -geom benchmarking/cylinder2Pa.geom -ubf 1
+run_case "Stationary body, inertial frame" \
+    -geom benchmarking/cylinder2Pa.geom -ubf 0
+run_case "Moving body, body fixed frame" \
+    -geom benchmarking/cylinder2PaPlunge.geom -ubf 1
+run_case "Moving body, inertial frame" \
+    -geom benchmarking/cylinder2PaPlunge.geom -ubf 0
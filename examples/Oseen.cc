@@ -37,17 +37,6 @@ void computeExactSolution(
     State& exact
 );
 
-const double PI = 4. * atan(1.);
-
-// Alpha is the solution to
-//    e^{-\alpha} = 1 / (1 + 2\alpha)
-// Setting
-//    \omega = \Gamma * \alpha / PI * exp( -\alpha r^2 )
-// makes the max velocity occur at r = 1
-// and so corresponds by nondimensionalizing by the radius of u_max
-const double alpha = 1.256431208626170;
-
-
 int main(int argc, char* argv[]) {
 	cout << "Test of Oseen vortex\n";
 	
@@ -125,64 +114,24 @@ int main(int argc, char* argv[]) {
  	return 0;
 }
 
+// The field evaluation lives in the library (see AnalyticFlow.h): the
+// OseenVortex rows vectorize and SetAnalyticFlow threads over rows, so
+// IC setup stays negligible for the large-grid convergence studies
 void computeExactSolution(
     double Reynolds,
     double time,
     int timestep,
     State& exact
     ) {
-    const Grid& grid = exact.omega.getGrid();
-    int nx = grid.Nx();
-    int ny = grid.Ny();
-    double dx = grid.Dx();
-
-    const double circulation = 2 * PI * (1 + 1./(2*alpha) );
-    double amp = circulation * Reynolds / (4 * PI * time);
-
+    SetAnalyticFlow( OseenVortex( Reynolds, time ), exact );
     exact.time = time;
     exact.timestep = timestep;
-
-    // Vorticity
-    for (int i=1; i < nx; ++i ){
-        double x = grid.getXEdge(0,i);
-        for (int j=1; j < ny; ++j ){
-            double y = grid.getYEdge(0,j);
-            double rSquared = x*x + y*y;
-            exact.omega(0,i,j) = amp * exp( -rSquared * Reynolds / (4 * time) );
-        }
-    }
-
-    // Flux
-    Flux::index ind;
-    // X-direction flux
-    for (ind = exact.q.begin(X); ind != exact.q.end(X); ++ind) {
-        double x = exact.q.x(0,ind);
-        double y = exact.q.y(0,ind);
-        double r = sqrt( x*x + y*y );
-        double uTheta = circulation / (2 * PI * r);
-        uTheta *= 1 - exp( -r*r * Reynolds / (4 * time) );
-        double theta = atan2( y, x );
-        double u = -uTheta * sin(theta);
-        exact.q(0,ind) = u * dx;
-    }
-    // Y-direction flux
-    for (ind = exact.q.begin(Y); ind != exact.q.end(Y); ++ind) {
-        double x = exact.q.x(0,ind);
-        double y = exact.q.y(0,ind);
-        double r = sqrt( x*x + y*y );
-        double uTheta = circulation / (2 * PI * r);
-        uTheta *= 1 - exp( -r*r * Reynolds / (4 * time) );
-        double theta = atan2( y, x );
-        double v =  uTheta * cos(theta);
-        exact.q(0,ind) = v * dx;
-    }
 }
 
 void initializeOseenVortex(
     double Reynolds,
     State& x
     ) {
-    
-    double t0 = Reynolds / (4 * alpha);
-    computeExactSolution( Reynolds, t0, 0, x );    
+    computeExactSolution( Reynolds, OseenVortex::initialTime( Reynolds ),
+        0, x );
 }
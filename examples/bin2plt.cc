@@ -1,5 +1,17 @@
 // bin2plt - utility to convert restart files to Tecplot format, for IBPM code
 //
+// Accepts any number of filenames (e.g. from a shell glob) and converts
+// them with a pool of worker threads, each owning its own State buffer:
+//     bin2plt -j 8 run_*.bin
+// The -bin flag writes binary Tecplot (TDV112) files instead of ASCII.
+//
+// With -flux the flux is rebuilt from the vorticity through
+// NavierStokesModel::computeFlux before each file is written, so runs
+// may dump compact, sparse, or quantized snapshots (whose flux is not
+// stored) and defer the velocity computation to this post-run pass;
+// -mag and -alpha set the base flow it assumes (default 1 and 0).
+// -psi appends the streamfunction as a fourth Tecplot variable.
+//
 // Clancy Rowley
 // 6 Sep 2008
 //
@@ -9,8 +21,12 @@
 // $HeadURL$
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include "ibpm.h"
 
 using namespace std;
@@ -18,31 +34,227 @@ using namespace ibpm;
 
 string GetBasename( string s );
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        cout << "Usage: " << argv[0] << " <filenames>" << endl;        
-        exit(1);
+// Per-worker model for the derived fields (see -flux): rebuilt only
+// when a file's grid differs from the previous one's.  The geometry is
+// empty -- no bodies are needed to rebuild the flux from the vorticity
+struct DeriveContext {
+    bool reconstructFlux;
+    bool writeStreamFunction;
+    double magnitude;
+    double alpha;       // radians
+    Geometry geometry;
+    Grid grid;
+    NavierStokesModel* model;
+    DeriveContext() : reconstructFlux( false ), writeStreamFunction( false ),
+        magnitude( 1. ), alpha( 0. ), model( NULL ) {}
+    ~DeriveContext() { delete model; }
+};
+
+// Solver setup (FFT plan creation) is not safe to run concurrently
+static pthread_mutex_t derivedLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Make ctx.model match the given grid, (re)building it if needed
+static void EnsureModel( DeriveContext& ctx, const Grid& grid ) {
+    if ( ctx.model != NULL && ctx.grid.isEqualTo( grid ) ) return;
+    pthread_mutex_lock( &derivedLock );
+    delete ctx.model;
+    ctx.grid = grid;
+    BaseFlow q_potential( ctx.grid, ctx.magnitude, ctx.alpha );
+    // The Reynolds number enters only the viscous terms, not the
+    // flux reconstruction
+    ctx.model = new NavierStokesModel( ctx.grid, ctx.geometry, 1.,
+                                       q_potential );
+    ctx.model->init();
+    pthread_mutex_unlock( &derivedLock );
+}
+
+// Convert one restart or time-series file; returns the number of errors
+static int ProcessFile( const char* filename, bool binary,
+                        DeriveContext& ctx ) {
+    int numErrors = 0;
+    State x;
+    bool derive = ctx.reconstructFlux || ctx.writeStreamFunction;
+    // If the file is a time-series file, convert each frame to its
+    // own Tecplot file
+    int numFrames = OutputSeries::getNumFrames( filename );
+    if ( numFrames >= 0 ) {
+        string basename = GetBasename( filename );
+        for (int frame=0; frame<numFrames; ++frame) {
+            if ( ! OutputSeries::loadFrame( filename, frame, x ) ) {
+                cerr << "Error reading frame " << frame << " of file "
+                     << filename << endl;
+                ++numErrors;
+                continue;
+            }
+            char outname[256];
+            sprintf( outname, "%s%05d.plt", basename.c_str(), x.timestep );
+            string title( outname );
+            OutputTecplot tecplot( outname, title, 1, binary );
+            Scalar psi;
+            if ( derive ) {
+                EnsureModel( ctx, x.omega.getGrid() );
+                if ( ctx.reconstructFlux ) ctx.model->refreshState( x );
+                if ( ctx.writeStreamFunction ) {
+                    psi = ctx.model->vorticityToStreamfunction( x.omega );
+                    tecplot.addScalar( &psi, "Streamfunction" );
+                }
+            }
+            if ( ! tecplot.doOutput( x ) ) {
+                cerr << "Error writing file " << outname << endl;
+                ++numErrors;
+            }
+        }
+        return numErrors;
+    }
+    // Read in a restart file, mapping it rather than copying it in;
+    // rebuilding the flux mutates the state, so it is loaded into
+    // private memory in that case
+    if ( derive ? ! x.load( filename )
+                : ( ! x.mapFromFile( filename ) && ! x.load( filename ) ) ) {
+        cerr << "Error reading file " << filename << endl;
+        ++numErrors;
+    }
+    else {
+        // Write out the Tecplot file
+        string outname = GetBasename( filename );
+        outname += ".plt";
+        string title( filename );
+        OutputTecplot tecplot( outname, title, 1, binary );
+        Scalar psi;
+        if ( derive ) {
+            EnsureModel( ctx, x.omega.getGrid() );
+            if ( ctx.reconstructFlux ) ctx.model->refreshState( x );
+            if ( ctx.writeStreamFunction ) {
+                psi = ctx.model->vorticityToStreamfunction( x.omega );
+                tecplot.addScalar( &psi, "Streamfunction" );
+            }
+        }
+        if ( ! tecplot.doOutput( x ) ) {
+            cerr << "Error writing file " << outname << endl;
+            ++numErrors;
+        }
+    }
+    return numErrors;
+}
+
+// Shared work queue: each worker pulls the next unconverted file
+struct ConvertQueue {
+    const vector<string>* files;
+    bool binary;
+    bool reconstructFlux;
+    bool writeStreamFunction;
+    double magnitude;
+    double alpha;       // radians
+    int next;
+    int numErrors;
+    pthread_mutex_t lock;
+};
+
+static void* ConvertWorker( void* arg ) {
+    ConvertQueue* queue = (ConvertQueue*) arg;
+    DeriveContext ctx;
+    ctx.reconstructFlux = queue->reconstructFlux;
+    ctx.writeStreamFunction = queue->writeStreamFunction;
+    ctx.magnitude = queue->magnitude;
+    ctx.alpha = queue->alpha;
+    while ( true ) {
+        pthread_mutex_lock( &queue->lock );
+        int i = queue->next++;
+        pthread_mutex_unlock( &queue->lock );
+        if ( i >= (int) queue->files->size() ) break;
+        int numErrors = ProcessFile( (*queue->files)[i].c_str(),
+                                     queue->binary, ctx );
+        pthread_mutex_lock( &queue->lock );
+        queue->numErrors += numErrors;
+        pthread_mutex_unlock( &queue->lock );
     }
-    
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int numThreads = 1;
+    bool binary = false;
+    bool reconstructFlux = false;
+    bool writeStreamFunction = false;
+    double magnitude = 1.;
+    double alphaDeg = 0.;
+    vector<string> files;
     for (int i=1; i<argc; ++i) {
-        State x;
-        // Read in a restart file
-        if ( ! x.load( argv[i] ) ) {
-            cerr << "Error reading file " << argv[i] << endl;
+        string arg = argv[i];
+        if ( arg == "-j" && i+1 < argc ) {
+            numThreads = atoi( argv[++i] );
+            if ( numThreads < 1 ) numThreads = 1;
+        }
+        else if ( arg == "-bin" ) {
+            binary = true;
+        }
+        else if ( arg == "-flux" ) {
+            reconstructFlux = true;
+        }
+        else if ( arg == "-psi" ) {
+            writeStreamFunction = true;
+        }
+        else if ( arg == "-mag" && i+1 < argc ) {
+            magnitude = atof( argv[++i] );
+        }
+        else if ( arg == "-alpha" && i+1 < argc ) {
+            alphaDeg = atof( argv[++i] );
         }
         else {
-            // Write out the Tecplot file
-            string outname = GetBasename( argv[i] );
-            outname += ".plt";
-            string title( argv[i] );
-            OutputTecplot tecplot( outname, title, 1 );
-            if ( ! tecplot.doOutput( x ) ) {
-                cerr << "Error writing file " << outname << endl;
-            }
+            files.push_back( arg );
+        }
+    }
+    double pi = 4. * atan( 1. );
+    double alpha = alphaDeg * pi / 180.;
+    if ( files.empty() ) {
+        cout << "Usage: " << argv[0] << " [-j nthreads] [-bin] [-flux]"
+            << " [-psi] [-mag u] [-alpha deg] <filenames>" << endl;
+        cout << "  -flux   rebuild the flux (velocities) from the"
+            << " vorticity, for files whose flux was not stored" << endl;
+        cout << "  -psi    append the streamfunction as a Tecplot"
+            << " variable" << endl;
+        cout << "  -mag, -alpha   base flow the reconstruction assumes"
+            << endl;
+        exit(1);
+    }
+
+    if ( numThreads == 1 || files.size() == 1 ) {
+        // serial path: no thread overhead
+        int numErrors = 0;
+        DeriveContext ctx;
+        ctx.reconstructFlux = reconstructFlux;
+        ctx.writeStreamFunction = writeStreamFunction;
+        ctx.magnitude = magnitude;
+        ctx.alpha = alpha;
+        for (unsigned int i=0; i<files.size(); ++i) {
+            numErrors += ProcessFile( files[i].c_str(), binary, ctx );
         }
+        return numErrors > 0 ? 1 : 0;
     }
-    
-    return 0;
+
+    ConvertQueue queue;
+    queue.files = &files;
+    queue.binary = binary;
+    queue.reconstructFlux = reconstructFlux;
+    queue.writeStreamFunction = writeStreamFunction;
+    queue.magnitude = magnitude;
+    queue.alpha = alpha;
+    queue.next = 0;
+    queue.numErrors = 0;
+    pthread_mutex_init( &queue.lock, NULL );
+    if ( numThreads > (int) files.size() ) {
+        numThreads = files.size();
+    }
+    vector<pthread_t> workers( numThreads );
+    for (int i=0; i<numThreads; ++i) {
+        pthread_create( &workers[i], NULL, ConvertWorker, &queue );
+    }
+    for (int i=0; i<numThreads; ++i) {
+        pthread_join( workers[i], NULL );
+    }
+    pthread_mutex_destroy( &queue.lock );
+
+    return queue.numErrors > 0 ? 1 : 0;
 }
 
 // remove the leading part of the path, and the suffix
@@ -18,24 +18,68 @@ int main(int argc, char *argv[]) {
     if (argc != 2) {
         cerr << "Usage: " << argv[0] << " <filename>" << endl;
     }
-    
+
     State x;
 
-    // Read in a restart file
-    if ( ! x.load( argv[1] ) ) {
+    // If the file is a time-series file, list its frames
+    int numFrames = OutputSeries::getNumFrames( argv[1] );
+    if ( numFrames >= 0 ) {
+        cout << "Time series with " << numFrames << " frame(s)" << endl;
+        for (int frame=0; frame<numFrames; ++frame) {
+            int timestep;
+            double time;
+            OutputSeries::getFrameInfo( argv[1], frame, timestep, time );
+            cout << "Frame " << frame << ": timestep " << timestep
+                 << ", time = " << time << endl;
+        }
+        if ( numFrames > 0 && OutputSeries::loadFrame( argv[1], 0, x ) ) {
+            // Write out the Grid information
+            cout << "nx = " << x.omega.Nx() << endl
+                 << "ny = " << x.omega.Ny() << endl
+                 << "dx = " << x.omega.Dx() << endl
+                 << "x0 = " << x.omega.getXEdge(0,0) << endl
+                 << "y0 = " << x.omega.getYEdge(0,0) << endl
+                 << "numPoints = " << x.f.getNumPoints() << endl;
+        }
+        return 0;
+    }
+
+    // Read only the header of a restart file: no field data is loaded,
+    // so scanning a large directory of snapshots is fast
+    StateInfo info;
+    if ( ! State::describe( argv[1], info ) ) {
         cerr << "Error reading file " << argv[1] << endl;
+        return 1;
+    }
+    cout << "Timestep " << info.timestep << endl;
+    cout << "time = " << info.time << endl;
+    // Write out the Grid information
+    cout << "nx = " << info.nx << endl
+         << "ny = " << info.ny << endl
+         << "ngrid = " << info.ngrid << endl
+         << "dx = " << info.dx << endl
+         << "x0 = " << info.x0 << endl
+         << "y0 = " << info.y0 << endl
+         << "numPoints = " << info.numPoints << endl;
+    if ( info.delta ) {
+        cout << "format: delta" << endl;
+    }
+    else if ( info.sparse ) {
+        cout << "format: sparse" << endl;
+    }
+    else if ( info.quantized ) {
+        cout << "format: quantized" << endl;
+    }
+    else if ( info.compressed ) {
+        cout << "format: compressed" << endl;
     }
     else {
-        cout << "Timestep " << x.timestep << endl;
-        cout << "time = " << x.time << endl;
-        // Write out the Grid information
-        cout << "nx = " << x.omega.Nx() << endl
-             << "ny = " << x.omega.Ny() << endl
-             << "dx = " << x.omega.Dx() << endl
-             << "x0 = " << x.omega.getXEdge(0,0) << endl
-             << "y0 = " << x.omega.getYEdge(0,0) << endl
-             << "numPoints = " << x.f.getNumPoints() << endl;
-    }
-    
+        cout << "format: " << ( info.singlePrecision ? "single" : "double" )
+             << " precision" << endl
+             << "offsets: q " << info.qOffset
+             << ", omega " << info.omegaOffset
+             << ", f " << info.fOffset << endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,158 @@
+// statediff - compare two restart files field by field with tolerances
+//
+// Validates an optimized build against archived results without going
+// through Tecplot ASCII: both states are loaded in their native binary
+// form and compared entry by entry with the mixed criterion
+//
+//     |a - b| <= atol + rtol * |b|
+//
+// (b is the reference, the second file).  The default mode stops at the
+// first exceedance and reports it, so a CI-style sweep over a snapshot
+// directory fails fast; -norms scans everything and prints per-field
+// summaries (max and RMS difference, number of exceedances) instead.
+//
+// Exit status: 0 if all fields agree within tolerance, 1 if any entry
+// exceeds it, 2 on usage or read errors.
+//
+// Clancy Rowley
+// 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ibpm.h"
+
+using namespace std;
+using namespace ibpm;
+
+namespace {
+
+double tolAbs = 0.;
+double tolRel = 1.e-12;
+bool printNorms = false;
+
+void usage( const char* prog ) {
+    cerr << "Usage: " << prog
+         << " [-atol a] [-rtol r] [-norms] <file> <reference>" << endl
+         << "  -atol a   absolute tolerance (default 0)" << endl
+         << "  -rtol r   relative tolerance (default 1e-12)" << endl
+         << "  -norms    scan all entries and print per-field summaries,"
+         << endl
+         << "            instead of stopping at the first exceedance"
+         << endl;
+}
+
+// Compare one field, given as flat arrays.  Returns the number of
+// entries exceeding the tolerance; in fast mode the first exceedance is
+// reported and counted, and the scan stops there
+long compareField( const char* name, const double* a, const double* b,
+                   long n ) {
+    long exceeded = 0;
+    double maxDiff = 0.;
+    double sumSq = 0.;
+    for ( long k=0; k<n; ++k ) {
+        double diff = fabs( a[k] - b[k] );
+        if ( diff > maxDiff ) maxDiff = diff;
+        sumSq += diff * diff;
+        if ( diff > tolAbs + tolRel * fabs( b[k] ) ) {
+            ++exceeded;
+            if ( ! printNorms ) {
+                cout << name << "[" << k << "]: " << a[k] << " vs "
+                     << b[k] << " (diff " << diff << ")" << endl;
+                return exceeded;
+            }
+        }
+    }
+    if ( printNorms ) {
+        cout << name << ": max diff " << maxDiff
+             << ", rms diff " << ( n > 0 ? sqrt( sumSq / n ) : 0. )
+             << ", exceedances " << exceeded << "/" << n << endl;
+    }
+    return exceeded;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* fileA = NULL;
+    const char* fileB = NULL;
+    for ( int i=1; i<argc; ++i ) {
+        if ( strcmp( argv[i], "-atol" ) == 0 && i+1 < argc ) {
+            tolAbs = atof( argv[++i] );
+        }
+        else if ( strcmp( argv[i], "-rtol" ) == 0 && i+1 < argc ) {
+            tolRel = atof( argv[++i] );
+        }
+        else if ( strcmp( argv[i], "-norms" ) == 0 ) {
+            printNorms = true;
+        }
+        else if ( fileA == NULL ) {
+            fileA = argv[i];
+        }
+        else if ( fileB == NULL ) {
+            fileB = argv[i];
+        }
+        else {
+            usage( argv[0] );
+            return 2;
+        }
+    }
+    if ( fileA == NULL || fileB == NULL ) {
+        usage( argv[0] );
+        return 2;
+    }
+
+    State a;
+    State b;
+    if ( ! a.load( fileA ) ) {
+        cerr << "Error reading file " << fileA << endl;
+        return 2;
+    }
+    if ( ! b.load( fileB ) ) {
+        cerr << "Error reading file " << fileB << endl;
+        return 2;
+    }
+
+    // The grids must match for an entry-by-entry comparison
+    if ( a.omega.Nx() != b.omega.Nx() || a.omega.Ny() != b.omega.Ny() ||
+         a.omega.Ngrid() != b.omega.Ngrid() ||
+         a.f.getNumPoints() != b.f.getNumPoints() ) {
+        cerr << "Grids differ: " << a.omega.Nx() << "x" << a.omega.Ny()
+             << "x" << a.omega.Ngrid() << " with "
+             << a.f.getNumPoints() << " point(s) vs "
+             << b.omega.Nx() << "x" << b.omega.Ny() << "x"
+             << b.omega.Ngrid() << " with "
+             << b.f.getNumPoints() << " point(s)" << endl;
+        return 1;
+    }
+    if ( a.timestep != b.timestep ) {
+        cout << "note: timesteps differ (" << a.timestep << " vs "
+             << b.timestep << ")" << endl;
+    }
+
+    long exceeded = 0;
+    exceeded += compareField( "q", a.q.flatten(0), b.q.flatten(0),
+        a.q.getSize() );
+    if ( exceeded == 0 || printNorms ) {
+        exceeded += compareField( "omega", a.omega.flatten(0),
+            b.omega.flatten(0), a.omega.getSize() );
+    }
+    if ( exceeded == 0 || printNorms ) {
+        exceeded += compareField( "f", a.f.flatten(), b.f.flatten(),
+            a.f.getSize() );
+    }
+
+    if ( exceeded == 0 ) {
+        if ( printNorms ) {
+            cout << "files agree within tolerance" << endl;
+        }
+        return 0;
+    }
+    return 1;
+}
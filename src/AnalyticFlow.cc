@@ -0,0 +1,139 @@
+// AnalyticFlow.cc
+//
+// Description:
+// Implementation of analytic flow fields for initial conditions
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "AnalyticFlow.h"
+#include "State.h"
+#include "Grid.h"
+#include "Threads.h"
+#include <math.h>
+#include <vector>
+
+using std::vector;
+
+namespace ibpm {
+
+// Evaluate the flow row by row on every level: vorticity at interior
+// nodes, then the velocity at the x- and y-flux locations, scaled by dx.
+// The rows are independent, so each level's sweep runs threaded
+void SetAnalyticFlow( const AnalyticFlow& flow, State& state ) {
+    const Grid& grid = state.omega.getGrid();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int ngrid = grid.Ngrid();
+
+    for (int lev=0; lev<ngrid; ++lev) {
+        double dx = grid.Dx(lev);
+
+        // Coordinates along a row, shared by all rows of the level:
+        // cell edges for vorticity and x-fluxes, centers for y-fluxes
+        vector<double> xEdge( nx+1 );
+        vector<double> xCenter( nx );
+        for (int i=0; i<=nx; ++i) {
+            xEdge[i] = grid.getXEdge( lev, i );
+        }
+        for (int i=0; i<nx; ++i) {
+            xCenter[i] = grid.getXCenter( lev, i );
+        }
+
+        // Vorticity at the interior nodes
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for (int j=1; j<ny; ++j) {
+            vector<double> row( nx-1 );
+            flow.vorticityRow( nx-1, &xEdge[1], grid.getYEdge( lev, j ),
+                &row[0] );
+            for (int i=1; i<nx; ++i) {
+                state.omega(lev,i,j) = row[i-1];
+            }
+        }
+
+        // X-fluxes: u dx at the vertical cell edges
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for (int j=0; j<ny; ++j) {
+            vector<double> u( nx+1 );
+            vector<double> v( nx+1 );
+            flow.velocityRow( nx+1, &xEdge[0], grid.getYCenter( lev, j ),
+                &u[0], &v[0] );
+            for (int i=0; i<=nx; ++i) {
+                state.q(lev,X,i,j) = u[i] * dx;
+            }
+        }
+
+        // Y-fluxes: v dx at the horizontal cell edges
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for (int j=0; j<=ny; ++j) {
+            vector<double> u( nx );
+            vector<double> v( nx );
+            flow.velocityRow( nx, &xCenter[0], grid.getYEdge( lev, j ),
+                &u[0], &v[0] );
+            for (int i=0; i<nx; ++i) {
+                state.q(lev,Y,i,j) = v[i] * dx;
+            }
+        }
+    }
+}
+
+// Alpha is the solution to
+//    e^{-\alpha} = 1 / (1 + 2\alpha)
+// which puts the maximum of u_\theta at r = 1 when t = Re / (4 alpha)
+static const double OSEEN_ALPHA = 1.256431208626170;
+
+OseenVortex::OseenVortex( double Reynolds, double time ) {
+    const double pi = 4. * atan(1.);
+    _circulation = 2. * pi * ( 1. + 1. / ( 2. * OSEEN_ALPHA ) );
+    _amp = _circulation * Reynolds / ( 4. * pi * time );
+    _decay = Reynolds / ( 4. * time );
+}
+
+double OseenVortex::initialTime( double Reynolds ) {
+    return Reynolds / ( 4. * OSEEN_ALPHA );
+}
+
+void OseenVortex::vorticityRow(
+    int n, const double* x, double y, double* omega ) const {
+    double y2 = y * y;
+    for (int k=0; k<n; ++k) {
+        omega[k] = _amp * exp( -_decay * ( x[k]*x[k] + y2 ) );
+    }
+}
+
+// u = -y u_theta / r, v = x u_theta / r, so with
+//    f(r^2) = Gamma / (2 pi r^2) * ( 1 - exp( -decay r^2 ) )
+// the row is one exponential per point and no trigonometry.  As r -> 0,
+// f -> Gamma decay / (2 pi), which removes the singularity
+void OseenVortex::velocityRow(
+    int n, const double* x, double y, double* u, double* v ) const {
+    const double pi = 4. * atan(1.);
+    double y2 = y * y;
+    double fOrigin = _circulation * _decay / ( 2. * pi );
+    for (int k=0; k<n; ++k) {
+        double r2 = x[k]*x[k] + y2;
+        double f = ( r2 > 1.e-30 )
+            ? _circulation / ( 2. * pi * r2 ) * ( 1. - exp( -_decay * r2 ) )
+            : fOrigin;
+        u[k] = -y * f;
+        v[k] = x[k] * f;
+    }
+}
+
+} // namespace ibpm
@@ -0,0 +1,86 @@
+#ifndef _ANALYTICFLOW_H_
+#define _ANALYTICFLOW_H_
+
+namespace ibpm {
+
+class State;
+
+/*!
+    \file AnalyticFlow.h
+    \class AnalyticFlow
+
+    \brief Analytic flow fields, for initial conditions and exact
+    solutions.
+
+    An AnalyticFlow gives the vorticity and velocity as functions of
+    position.  Implementations fill whole rows of constant y at a time,
+    so the inner loops vectorize, and SetAnalyticFlow evaluates the rows
+    of every level in parallel: filling a State from an analytic
+    expression then costs a few field sweeps, instead of the pointwise
+    transcendental evaluation that dominated startup of large-grid
+    convergence studies (see examples/Oseen.cc).
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 30 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+class AnalyticFlow {
+public:
+    virtual ~AnalyticFlow() {}
+
+    /// \brief Fill omega[0..n-1] with the vorticity at ( x[k], y )
+    virtual void vorticityRow(
+        int n, const double* x, double y, double* omega
+    ) const = 0;
+
+    /// \brief Fill u[0..n-1] and v[0..n-1] with the velocity at ( x[k], y )
+    virtual void velocityRow(
+        int n, const double* x, double y, double* u, double* v
+    ) const = 0;
+};
+
+/// \brief Fill the vorticity and flux of the given State from the
+/// analytic flow, on every grid level, threaded over rows.  The forces
+/// and times are left untouched
+void SetAnalyticFlow( const AnalyticFlow& flow, State& state );
+
+/*!
+    \class OseenVortex
+
+    \brief The Oseen vortex centered at the origin,
+        \omega = \Gamma \alpha / (\pi s) exp( -\alpha r^2 / s ),
+        u_\theta = \Gamma / (2 \pi r) ( 1 - exp( -\alpha r^2 / s ) ),
+    with s = 4 \alpha t / Re, an exact solution of Navier-Stokes.
+    Nondimensionalized after Colonius and Taira (2007): the velocity
+    scale is the maximum velocity at t0 = Re / (4 \alpha) and the length
+    scale the radius where it is attained, which makes the circulation
+    \Gamma = 2 \pi ( 1 + 1 / (2 \alpha) ).  The velocity rows are
+    evaluated without atan2/sin/cos, from u = -y u_\theta / r and
+    v = x u_\theta / r, with the removable singularity at the origin
+    handled by its limit
+*/
+class OseenVortex : public AnalyticFlow {
+public:
+    /// \brief The vortex at the given time; the initial condition of
+    /// the convergence studies is time t0 = Re / (4 \alpha)
+    OseenVortex( double Reynolds, double time );
+
+    void vorticityRow( int n, const double* x, double y,
+        double* omega ) const;
+    void velocityRow( int n, const double* x, double y,
+        double* u, double* v ) const;
+
+    /// \brief Time at which the peak velocity is 1 at radius 1
+    static double initialTime( double Reynolds );
+
+private:
+    double _circulation;
+    double _amp;        // vorticity amplitude, Gamma Re / (4 pi t)
+    double _decay;      // Gaussian decay rate, Re / (4 t)
+};
+
+} // namespace ibpm
+
+#endif /* _ANALYTICFLOW_H_ */
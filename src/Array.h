@@ -110,7 +110,7 @@ inline void free0(void *p)
 template<class T>
 inline void newAlign(T *&v, size_t len, size_t align)
 {
-  void *mem;
+  void *mem=NULL;
   const char *invalid="Invalid alignment requested";
   const char *nomem="Memory limits exceeded";
 #ifdef HAVE_POSIX_MEMALIGN
@@ -127,8 +127,7 @@ inline void newAlign(T *&v, size_t len, size_t align)
 template<class T>
 inline void deleteAlign(T *v, size_t len)
 {
-  for(size_t i=len-1; i > 0; i--) v[i].~T();
-  v[0].~T();
+  for(size_t i=len; i > 0; i--) v[i-1].~T();
 #ifdef HAVE_POSIX_MEMALIGN
   free(v);
 #else
@@ -137,13 +136,34 @@ inline void deleteAlign(T *v, size_t len)
 }
 
 namespace Array {
-  
+
+// Default alignment (in bytes) for arrays holding field data: a full
+// cache line, which also satisfies the alignment FFTW requires of the
+// buffers it transforms.  Pass as the trailing align argument of
+// Allocate
+const size_t cacheAlignment=64;
+
+// Accounting hooks, defined in Memory.cc: accountAlloc charges an
+// allocation to the owner tag currently in effect and returns that tag;
+// accountFree returns the bytes charged against it
+int accountAlloc(size_t bytes);
+void accountFree(int tag, size_t bytes);
+
+// Backing hooks, defined in Memory.cc: backingAlign raises the
+// alignment to the huge-page size when the owner tag in effect is
+// configured for huge pages (Memory::setHugePages) and the allocation
+// is large enough; backingAdvise applies the huge-page advice and the
+// residency lock (Memory::setPinned) to a fresh aligned allocation
+size_t backingAlign(size_t bytes, size_t align);
+void backingAdvise(void* p, size_t bytes);
+
 template<class T>
 class array1 {
  protected:
   T *v;
   unsigned int size;
   mutable int state;
+  mutable int memoryTag;
  public:
   enum alloc_state {unallocated=0, allocated=1, temporary=2, aligned=4};
   virtual unsigned int Size() const {return size;}
@@ -166,12 +186,15 @@ class array1 {
   void set(int flag) const {state |= flag;}
   void Activate(size_t align=0) {
     if(align) {
-      newAlign(v,size,align);
+      size_t bytes=size*sizeof(T);
+      newAlign(v,size,backingAlign(bytes,align));
       set(allocated | aligned);
+      backingAdvise(v,bytes);
     } else {
       v=new T[size];
       set(allocated);
     }
+    memoryTag=accountAlloc(size*sizeof(T));
   }
   void CheckActivate(int dim, size_t align=0) {
     if (test(allocated)) {
@@ -186,6 +209,7 @@ class array1 {
     if(test(allocated)) {
       if(test(aligned)) deleteAlign(v,size);
       else delete [] v;
+      accountFree(memoryTag,size*sizeof(T));
       state=unallocated;
     }
   }
@@ -932,7 +956,7 @@ class Array1 : public array1<T> {
   void Dimension(unsigned int nx0, T *v0, int ox0=0) {
     this->v=v0;
     Dimension(nx0,ox0);
-    clear(this->allocated);
+    this->clear(this->allocated);
   }
   void Dimension(const Array1<T>& A) {
     Dimension(A.size,A.v,A.ox); this->state=A.test(this->temporary);
@@ -992,6 +1016,16 @@ class Array1 : public array1<T> {
   }
   
   int Ox() const {return ox;}
+
+  // Exchange contents with A in constant time (no elements are copied)
+  void Swap(Array1<T>& A) {
+    T *tv=this->v; this->v=A.v; A.v=tv;
+    unsigned int ts=this->size; this->size=A.size; A.size=ts;
+    int tst=this->state; this->state=A.state; A.state=tst;
+    tst=this->memoryTag; this->memoryTag=A.memoryTag; A.memoryTag=tst;
+    int t=ox; ox=A.ox; A.ox=t;
+    Offsets(); A.Offsets();
+  }
 };
 
 template<class T>
@@ -1080,6 +1114,19 @@ class Array2 : public array2<T> {
   int Ox() const {return ox;}
   int Oy() const {return oy;}
   
+
+  // Exchange contents with A in constant time (no elements are copied)
+  void Swap(Array2<T>& A) {
+    T *tv=this->v; this->v=A.v; A.v=tv;
+    unsigned int ts=this->size; this->size=A.size; A.size=ts;
+    int tst=this->state; this->state=A.state; A.state=tst;
+    tst=this->memoryTag; this->memoryTag=A.memoryTag; A.memoryTag=tst;
+    ts=this->nx; this->nx=A.nx; A.nx=ts;
+    ts=this->ny; this->ny=A.ny; A.ny=ts;
+    int t=ox; ox=A.ox; A.ox=t;
+    t=oy; oy=A.oy; A.oy=t;
+    Offsets(); A.Offsets();
+  }
 };
 
 template<class T>
@@ -1103,7 +1150,7 @@ class Array3 : public array3<T> {
 		 T *v0, int ox0=0, int oy0=0, int oz0=0) {
     this->v=v0;
     Dimension(nx0,ny0,nz0,ox0,oy0,oz0);
-    clear(this->allocated);
+    this->clear(this->allocated);
   }
   
   void Allocate(unsigned int nx0, unsigned int ny0, unsigned int nz0,
@@ -1169,6 +1216,22 @@ class Array3 : public array3<T> {
   int Oy() const {return oy;}
   int Oz() const {return oz;}
 
+
+  // Exchange contents with A in constant time (no elements are copied)
+  void Swap(Array3<T>& A) {
+    T *tv=this->v; this->v=A.v; A.v=tv;
+    unsigned int ts=this->size; this->size=A.size; A.size=ts;
+    int tst=this->state; this->state=A.state; A.state=tst;
+    tst=this->memoryTag; this->memoryTag=A.memoryTag; A.memoryTag=tst;
+    ts=this->nx; this->nx=A.nx; A.nx=ts;
+    ts=this->ny; this->ny=A.ny; A.ny=ts;
+    ts=this->nz; this->nz=A.nz; A.nz=ts;
+    ts=this->nyz; this->nyz=A.nyz; A.nyz=ts;
+    int t=ox; ox=A.ox; A.ox=t;
+    t=oy; oy=A.oy; A.oy=t;
+    t=oz; oz=A.oz; A.oz=t;
+    Offsets(); A.Offsets();
+  }
 };
 
 template<class T>
@@ -13,42 +13,49 @@
 // $LastChangedBy$
 // $HeadURL$
 
-// Boundary data is stored in a 1d array.
-// For an (8 x 4) grid, the data is arranged as follows:
-//
-//  4  5  6  7  8  9 10 11 12
-//  3                      13
-//  2                      14
-//  1                      15
-//  0 23 22 21 20 19 18 17 16
-//
-// Note that the total number of boundary points is
-//   (nx+1) * 2 + (ny-1) * 2 = 2 * (nx + ny)
+// Boundary data is stored in a 1d array, one contiguous ascending run
+// per side (left, right, bottom, top -- see the layout note in BC.h).
+// Each corner value is stored once per adjoining side, so the total
+// number of slots is
+//   2 * (nx+1) + 2 * (ny+1) = 2 * (nx + ny + 2)
 
 #include "BC.h"
+#include "Field.h"
+#include "Memory.h"
 
 namespace ibpm {
-    
+
 BC::BC( int nx, int ny ) :
     _nx( nx ),
-    _ny( ny ),
-    _data( 2*(nx+ny) )
+    _ny( ny )
     {
+    // Draw storage from the shared field-buffer pool (see Field.h), so that
+    // BC objects constructed inside operators such as Curl recycle a buffer
+    // rather than allocating a fresh one each call
+    unsigned int size = 2 * (nx + ny + 2);
+    ScopedMemoryTag memTag( Memory::BOUNDARY );
+    _data.Dimension( size, acquireFieldBuffer( size ) );
     _data = 0.;
 }
 
 BC::BC( const BC& bc ) :
     _nx( bc._nx ),
-    _ny( bc._ny ),
-    _data( 2*(_nx+_ny) ) {
+    _ny( bc._ny ) {
 
+    unsigned int size = 2 * (_nx + _ny + 2);
+    ScopedMemoryTag memTag( Memory::BOUNDARY );
+    _data.Dimension( size, acquireFieldBuffer( size ) );
     // copy data
     for (unsigned int i=0; i<_data.Size(); ++i) {
         _data(i) = bc._data(i);
     }
 }
 
-BC::~BC()
-{}
+/// Return the data buffer to the pool in the destructor
+BC::~BC() {
+    if ( _data.Size() > 0 ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
+}
 
 } // namespace ibpm
@@ -19,13 +19,18 @@ namespace ibpm {
     \version $Revision$
 */
 
-// For an (8 x 4) grid, the data is arranged as follows:
+// Each of the four sides is stored as its own contiguous run inside one
+// backing array, in ascending index order:
 //
-//  4  5  6  7  8  9 10 11 12
-//  3                      13
-//  2                      14
-//  1                      15
-//  0 23 22 21 20 19 18 17 16
+//   left   [0..ny]   at offset 0
+//   right  [0..ny]   at offset ny+1
+//   bottom [0..nx]   at offset 2*(ny+1)
+//   top    [0..nx]   at offset 2*(ny+1) + (nx+1)
+//
+// The corner values therefore appear in both adjoining sides; fillers
+// (Scalar::getBC) write every slot, so the two copies agree.  Each side
+// is traversed with unit stride and no branches, so the boundary sweeps
+// in VectorOperations and EllipticSolver2d::getRHS vectorize cleanly.
 
 class BC {
 public:
@@ -51,42 +56,60 @@ public:
     /// \param[in] j must be from 0..ny
     inline double& right( int j ) {
         assert( j >= 0 && j <= _ny );
-        return _data( 2 * _ny + _nx - j);
+        return _data( _ny + 1 + j );
     }
     inline const double& right( int j ) const {
         assert( j >= 0 && j <= _ny );
-        return _data( 2 * _ny + _nx - j);
+        return _data( _ny + 1 + j );
     }
-    
+
     /// \brief Return reference to value on top boundary, at index i
     /// \param[in] i must be from 0..nx
     inline double& top( int i ) {
         assert( i >= 0 && i <= _nx );
-        return _data( _ny + i );
+        return _data( 2 * (_ny + 1) + _nx + 1 + i );
     }
     inline const double& top( int i ) const {
         assert( i >= 0 && i <= _nx );
-        return _data( _ny + i );
+        return _data( 2 * (_ny + 1) + _nx + 1 + i );
     }
-    
+
     /// \brief Return reference to value on bottom boundary, at index i
-    /// \param[in] j must be from 0..nx
+    /// \param[in] i must be from 0..nx
     inline double& bottom( int i ) {
         assert( i >= 0 && i <= _nx );
-        if (i == 0) return _data(0);
-        else return _data( 2 * (_nx + _ny) - i );
+        return _data( 2 * (_ny + 1) + i );
     }
     inline const double& bottom( int i ) const {
         assert( i >= 0 && i <= _nx );
-        if (i == 0) return _data(0);
-        else return _data( 2 * (_nx + _ny) - i );
+        return _data( 2 * (_ny + 1) + i );
     }
-    
+
     inline BC& operator=(double a) {
         _data = a;
         return *this;
     }
-    
+
+    // Contiguous views of one side's run, for flat boundary sweeps:
+    // length Ny()+1 for left/right, Nx()+1 for top/bottom
+    inline const double* leftData() const { return &_data(0); }
+    inline const double* rightData() const { return &_data( _ny + 1 ); }
+    inline const double* bottomData() const {
+        return &_data( 2 * (_ny + 1) );
+    }
+    inline const double* topData() const {
+        return &_data( 2 * (_ny + 1) + _nx + 1 );
+    }
+
+    /// \brief Return a pointer to the underlying flat data array, arranged
+    /// as in the diagram above; its length is given by Size()
+    inline double* flatten() { return &_data(0); }
+    inline const double* flatten() const { return &_data(0); }
+
+    /// \brief Return the total number of boundary slots, 2 * (nx + ny + 2)
+    /// (each corner value is stored once per adjoining side)
+    inline int Size() const { return 2 * (_nx + _ny + 2); }
+
     inline int Nx() const { return _nx; }
     inline int Ny() const { return _ny; }
     
@@ -45,6 +45,7 @@ BaseFlow::BaseFlow() {
     _alpha = 0.;
     _alphaBF = 0.;
     _gamma = 0.;
+    _qRotCurrent = false;
 }
 
 BaseFlow::BaseFlow(const Grid& grid ) {
@@ -53,6 +54,7 @@ BaseFlow::BaseFlow(const Grid& grid ) {
     _isStationary = true;
     _motion = NULL;
     _time = 0.;
+    _qRotCurrent = false;
     resize( grid );
     _mag = 0.;
     _magBF = 0.;
@@ -73,6 +75,7 @@ BaseFlow::BaseFlow(const Grid& grid, double mag, double alpha) {
     _alpha = alpha;
     _alphaBF = alpha;
     _gamma = -1.*_alphaBF;
+    _qRotCurrent = false;
     resize( grid );
     _q = Flux::UniformFlow( grid, _magBF, _alphaBF);
 }
@@ -89,12 +92,14 @@ BaseFlow::BaseFlow(const Grid& grid, double mag, double alpha, const Motion& mot
     _alpha = alpha;
     _alphaBF = alpha;
     _gamma = -1.*_alphaBF;
+    _qRotCurrent = false;
     resize( grid );
     _q = Flux::UniformFlow( grid, _magBF, _alphaBF);
 }
 
 void BaseFlow::resize( const Grid& grid ) {
     _q.resize( grid );
+    _qRotCurrent = false;
 }
 
 bool BaseFlow::isStationary() const {
@@ -144,11 +149,80 @@ void BaseFlow::moveFlow(double time) {
 
     xdot = _mag * cos(_alpha);  // using the xdot,ydot of the baseflow
     ydot = _mag * sin(_alpha);
-    TangentSE2 gnew(x,y,theta,xdot,ydot,-1.*thetadot);
-    // Update the baseFlow based on this new motion 
-    _q.setFlow( gnew, _xCenter, _yCenter);	
+    // The flux is affine in (xdot, ydot, thetadot): a uniform part,
+    // plus the rotation rate times a basis flux fixed by the grid and
+    // the center.  The basis is built once (and again after a center
+    // or grid change), so the per-point coordinate evaluation in
+    // Flux::setFlow happens once instead of every update
+    if ( ! _qRotCurrent ) {
+        updateRotationalFlux();
+    }
+    double omega = -1.*thetadot;
+    Flux::index ind;
+    for (int lev=0; lev<_q.Ngrid(); ++lev) {
+        double dx = _q.Dx(lev);
+        double uniformX = xdot * dx;
+        for (ind = _q.begin(X); ind != _q.end(X); ++ind) {
+            _q(lev,ind) = uniformX + omega * _qRot(lev,ind);
+        }
+        double uniformY = ydot * dx;
+        for (ind = _q.begin(Y); ind != _q.end(Y); ++ind) {
+            _q(lev,ind) = uniformY + omega * _qRot(lev,ind);
+        }
+    }
+}
+
+void BaseFlow::updateRotationalFlux() {
+    if ( ! _qRot.getGrid().isEqualTo( _q.getGrid() ) ) {
+        _qRot.resize( _q.getGrid() );
+    }
+    TangentSE2 unitRotation( 0., 0., 0., 0., 0., 1. );
+    _qRot.setFlow( unitRotation, _xCenter, _yCenter );
+    _qRotCurrent = true;
+}
+
+BaseFlow::BaseFlow( const BaseFlow& q ) :
+    _q( q._q ) {
+    _magBF = q._magBF;
+    _alphaBF = q._alphaBF;
+    _mag = q._mag;
+    _gamma = q._gamma;
+    _alpha = q._alpha;
+    _time = q._time;
+    _xCenter = q._xCenter;
+    _yCenter = q._yCenter;
+    _isStationary = q._isStationary;
+    _qRotCurrent = false;   // rebuilt lazily on the first update
+    _motion = ( q._motion == NULL ) ? NULL : q._motion->clone();
+}
+
+BaseFlow& BaseFlow::operator=( const BaseFlow& q ) {
+    if ( &q == this ) return *this;
+    _magBF = q._magBF;
+    _alphaBF = q._alphaBF;
+    _mag = q._mag;
+    _gamma = q._gamma;
+    _alpha = q._alpha;
+    if ( ! _q.getGrid().isEqualTo( q._q.getGrid() ) ) {
+        _q.resize( q._q.getGrid() );
+    }
+    _q = q._q;
+    _time = q._time;
+    _xCenter = q._xCenter;
+    _yCenter = q._yCenter;
+    _isStationary = q._isStationary;
+    _qRotCurrent = false;   // rebuilt lazily on the first update
+    if ( _motion != NULL ) {
+        delete _motion;
+    }
+    _motion = ( q._motion == NULL ) ? NULL : q._motion->clone();
+    return *this;
+}
+
+BaseFlow::~BaseFlow() {
+    if ( _motion != NULL ) {
+        delete _motion;
+    }
 }
 
-BaseFlow::~BaseFlow() {}
-    
 } // namespace ibpm
@@ -44,6 +44,12 @@ public:
     /// Initialize with constant and moving component
     BaseFlow( const Grid& grid, double mag, double alpha, const Motion& motion );
 
+    /// Deep copy: the new BaseFlow gets its own copy of the Motion
+    BaseFlow( const BaseFlow& q );
+
+    /// Deep copy assignment, reallocating the flux if the grids differ
+    BaseFlow& operator=( const BaseFlow& q );
+
     ~BaseFlow();
     
     /// \brief Allocate memory, with the specified Grid and number of
@@ -60,6 +66,7 @@ public:
     inline void setCenter(double x, double y) {
         _xCenter = x;
         _yCenter = y;
+        _qRotCurrent = false;   // rotational basis depends on the center
     }
 
     /// Get the center of the domain, about which rotations are defined
@@ -93,12 +100,17 @@ public:
     inline const Flux& getFlux() const {return _q;};
 
 private:
-    double _magBF;    /// Initial magnitude of base flow	
+    // Rebuild the cached rotational basis flux (see moveFlow)
+    void updateRotationalFlux();
+
+    double _magBF;    /// Initial magnitude of base flow
     double _alphaBF;  /// Initial angle of base flow
     double _mag;      /// True magnitude of flow, taking into account rigid body motion
     double _gamma;    /// Flight Path Angle
     double _alpha;    /// True angle of attack, taking into account rigid body motion
     Flux _q;
+    Flux _qRot;       /// Unit-rotation basis flux, fixed by grid and center
+    bool _qRotCurrent;
     double _time;
     double _xCenter;
     double _yCenter;
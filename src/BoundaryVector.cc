@@ -14,17 +14,26 @@
 // $HeadURL$
 
 #include "BoundaryVector.h"
+#include "Memory.h"
 
 namespace ibpm {
 
-BoundaryVector::BoundaryVector() {}
+BoundaryVector::BoundaryVector() {
+    _numPoints = 0;
+    _sharedData = false;
+    _dataOwner = NULL;
+}
 
 BoundaryVector::BoundaryVector(int numPoints ) {
+    _sharedData = false;
+    _dataOwner = NULL;
     resize( numPoints );
 }
 
 /// Allocate a new BoundaryVector, copy the data
 BoundaryVector::BoundaryVector(const BoundaryVector& f) {
+    _sharedData = false;
+    _dataOwner = NULL;
     resize( f._numPoints );
     _data = f._data;
 }
@@ -33,7 +42,16 @@ void BoundaryVector::resize( int numPoints ) {
     _numPoints = numPoints;
     // blitz: _data.resize( _numPoints * XY );
     _data.Deallocate();
-    _data.Allocate( _numPoints * XY );
+    ScopedMemoryTag memTag( Memory::BOUNDARY );
+    _data.Allocate( _numPoints * XY, 0, Array::cacheAlignment );
+    _sharedData = false;
+}
+
+void BoundaryVector::viewExternal( int numPoints, double* data ) {
+    _numPoints = numPoints;
+    _data.Deallocate();
+    _data.Dimension( _numPoints * XY, data );
+    _sharedData = false;
 }
 
 } // namespace ibpm
@@ -3,6 +3,8 @@
 
 #include "Array.h"
 #include "Direction.h"
+#include "Field.h"
+#include "Kernels.h"
 #include <iostream>
 
 using std::cout;
@@ -15,9 +17,14 @@ namespace ibpm {
     \class BoundaryVector
 
     \brief Store vectors located at boundary points
-    
+
     Examples are forces, velocities, and coordinates of points on a body.
 
+    The layout is guaranteed structure-of-arrays: all x-components are
+    stored contiguously, followed by all y-components, so consumers may
+    run vectorized kernels over the per-component spans returned by
+    component() instead of indexing element-by-element.
+
     \author Clancy Rowley
     \author $LastChangedBy$
     \date  7 Jul 2008
@@ -39,6 +46,12 @@ public:
 
     /// Reallocate memory for the given number of points
     void resize( int numPoints );
+
+    /// \brief Make this vector a view of externally owned data of length
+    /// 2*numPoints, in the layout above (all x-components, then all
+    /// y-components).  The data must outlive the view (see State, which
+    /// backs q, omega, and f with one contiguous arena)
+    void viewExternal( int numPoints, double* data );
     
     /// Return the number of boundary points
     inline int getNumPoints() const { return _numPoints; }
@@ -63,6 +76,7 @@ public:
 
     /// f(dir,i) refers to the value in direction dir (X or Y) at point i
     inline double& operator()(int dir, int i) {
+        ensureUnique();
         assert(dir>=X  && dir<=Y);
         assert(i>=0  && i<_numPoints);
         return _data(dir * _numPoints + i);
@@ -80,6 +94,7 @@ public:
     
     /// f(ind) refers to the value corresponding to the given index ind
     inline double& operator()(index ind) {
+        ensureUnique();
         assert( (ind >= 0) && (ind < _numPoints * XY) );
         return _data(ind);
     }
@@ -116,7 +131,26 @@ public:
     }
     
     /// Return a pointer to the data, expressed as a C-style array.
-    double* flatten();
+    inline double* flatten() {
+        ensureUnique();
+        return ( _numPoints > 0 ) ? &_data(0) : NULL;
+    }
+
+    /// \brief Return a pointer to the contiguous span of components in
+    /// direction dir (X or Y), of length getNumPoints().
+    /// component(dir)[i] is the same element as f(dir,i).
+    inline double* component(int dir) {
+        ensureUnique();
+        assert ((dir >= X) && (dir <= Y));
+        return ( _numPoints > 0 ) ? &_data(dir * _numPoints) : NULL;
+    }
+
+    /// \brief Return a const pointer to the contiguous span of components
+    /// in direction dir (X or Y), of length getNumPoints().
+    inline const double* component(int dir) const {
+        assert ((dir >= X) && (dir <= Y));
+        return ( _numPoints > 0 ) ? &_data(dir * _numPoints) : NULL;
+    }
     
     /// Return the dot product of *this and the argument
     double dot(BoundaryVector& f);
@@ -124,6 +158,7 @@ public:
 
     /// Copy assignment
     inline BoundaryVector& operator=(const BoundaryVector& f) {
+        ensureUnique();
         assert(f._numPoints == _numPoints);
         _data = f._data;
         return *this;
@@ -131,12 +166,39 @@ public:
 
     /// Copy assignment from double
     inline BoundaryVector& operator=(double a) {
+        ensureUnique();
         _data = a;
         return *this;
     };
 
+    /// Exchange contents with f, in constant time (no data is copied)
+    inline void swap( BoundaryVector& f ) {
+        int t = _numPoints; _numPoints = f._numPoints; f._numPoints = t;
+        _data.Swap( f._data );
+        bool s = _sharedData;
+        _sharedData = f._sharedData;
+        f._sharedData = s;
+        FieldDataOwner* o = _dataOwner;
+        _dataOwner = f._dataOwner;
+        f._dataOwner = o;
+    }
+
+#if __cplusplus >= 201103L
+    /// Move constructor: take over the contents of f, leaving it empty
+    inline BoundaryVector( BoundaryVector&& f ) : _numPoints(0) {
+        swap( f );
+    }
+
+    /// Move assignment: exchange contents with f
+    inline BoundaryVector& operator=( BoundaryVector&& f ) {
+        swap( f );
+        return *this;
+    }
+#endif
+
     /// f += g
     inline BoundaryVector& operator+=(const BoundaryVector& f) {
+        ensureUnique();
         assert(f._numPoints == _numPoints);
         _data += f._data;
         return *this;
@@ -144,12 +206,14 @@ public:
 
     /// f += a
     inline BoundaryVector& operator+=(double a) {
+        ensureUnique();
         _data += a;
         return *this;
     }
 
     /// f -= g
     inline BoundaryVector& operator-=(const BoundaryVector& f) {
+        ensureUnique();
         assert(f._numPoints == _numPoints);
         _data -= f._data;
         return *this;
@@ -157,18 +221,21 @@ public:
 
     /// f -= a
     inline BoundaryVector& operator-=(double a) {
+        ensureUnique();
         _data -= a;
         return *this;
     }
 
     /// f *= a
     inline BoundaryVector& operator*=(double a) {
+        ensureUnique();
         _data *= a;
         return *this;
     }
     
     /// f /= a
     inline BoundaryVector& operator/=(double a) {
+        ensureUnique();
         _data /= a;
         return *this;
     }
@@ -216,10 +283,31 @@ public:
     }
 
     friend double InnerProduct(BoundaryVector& x, BoundaryVector& y);
-    
+
+    /// \brief Mark the data as shared with other owners, under
+    /// copy-on-write, as for the grid fields (see Field::shareData)
+    inline void shareData( FieldDataOwner* owner ) const {
+        _sharedData = true;
+        _dataOwner = owner;
+    }
+
+    /// Clear the shared mark (the data has been detached or replaced)
+    inline void unshareData() const { _sharedData = false; }
+
+    /// Return true when the data is shared and a mutation must detach
+    inline bool isShared() const { return _sharedData; }
+
 private:
+    /// Give this vector a private copy of its data if it is shared
+    /// (see Field::ensureUnique)
+    inline void ensureUnique() {
+        if ( _sharedData ) _dataOwner->detachData();
+    }
+
     int _numPoints;
     Array::Array1<double> _data;
+    mutable bool _sharedData;
+    mutable FieldDataOwner* _dataOwner;
 };  // class BoundaryVector
 
 /// -f
@@ -238,17 +326,9 @@ inline BoundaryVector operator*(double a, const BoundaryVector& f) {
 
 /// Return the inner product of BoundaryVectors x and y.
 inline double InnerProduct(BoundaryVector& x, BoundaryVector& y) {
-    // Implementation using only public interface
-    BoundaryVector::index ind;
-    double ip = 0;
-
-    for (ind = x.begin(); ind != x.end(); ++ind) {
-        ip += x(ind) * y(ind);
-    }    
-    return ip;
-    
-    // Implementation using Blitz arrays
-    // return sum(x._data * y._data);
+    // The X and Y blocks are contiguous in memory (see component()), so
+    // this is one flat dot product, run in the dispatched kernel
+    return Kernels::Dot( x.component(X), y.component(X), x.getSize() );
 }
 
 } // namespace ibpm
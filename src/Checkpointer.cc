@@ -0,0 +1,83 @@
+// Checkpointer.cc
+//
+// Description:
+// Implementation of the Checkpointer class
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Checkpointer.h"
+#include "IBSolver.h"
+#include <assert.h>
+
+namespace ibpm {
+
+Checkpointer::Checkpointer( IBSolver& solver, int maxStates ) :
+    _solver( solver ),
+    _maxStates( maxStates ),
+    _numSteps( 0 ),
+    _interval( 1 ),
+    _spanStart( -1 ),
+    _recomputed( 0 ) {
+    assert( maxStates >= 2 );   // need at least the endpoints
+}
+
+void Checkpointer::run( const State& initial, int numSteps ) {
+    _numSteps = numSteps;
+    // Uniform spacing; maxStates includes the initial state
+    _interval = ( numSteps + _maxStates - 2 ) / ( _maxStates - 1 );
+    if ( _interval < 1 ) _interval = 1;
+    _checkpoints.clear();
+    _span.clear();
+    _spanStart = -1;
+    _recomputed = 0;
+
+    State x = initial;
+    _checkpoints.push_back( x );
+    _solver.reset();
+    for (int n = 1; n <= numSteps; ++n) {
+        _solver.advance( x );
+        if ( n % _interval == 0 || n == numSteps ) {
+            _checkpoints.push_back( x );
+        }
+    }
+}
+
+const State& Checkpointer::state( int n ) {
+    assert( n >= 0 && n <= _numSteps );
+    if ( n % _interval == 0 || n == _numSteps ) {
+        int k = n / _interval;
+        if ( n == _numSteps ) k = _checkpoints.size() - 1;
+        return _checkpoints[k];
+    }
+    int spanBase = ( n / _interval ) * _interval;
+    if ( _spanStart != spanBase + 1 ) {
+        // Recompute this span from its left checkpoint.  The solver is
+        // reset first, so the checkpoint is treated as a restart
+        int spanEnd = spanBase + _interval - 1;
+        if ( spanEnd > _numSteps ) spanEnd = _numSteps;
+        _span.clear();
+        State x = _checkpoints[ spanBase / _interval ];
+        _solver.reset();
+        for (int m = spanBase + 1; m <= spanEnd; ++m) {
+            _solver.advance( x );
+            _span.push_back( x );
+            ++_recomputed;
+        }
+        _spanStart = spanBase + 1;
+    }
+    return _span[ n - _spanStart ];
+}
+
+int Checkpointer::recomputedSteps() const {
+    return _recomputed;
+}
+
+} // namespace ibpm
@@ -0,0 +1,69 @@
+#ifndef _CHECKPOINTER_H_
+#define _CHECKPOINTER_H_
+
+#include <vector>
+#include "State.h"
+
+namespace ibpm {
+
+class IBSolver;
+
+/*!
+    \file Checkpointer.h
+    \class Checkpointer
+
+    \brief Checkpointed access to a forward trajectory, for adjoint runs
+
+    An adjoint sweep needs the forward states in reverse order.  Rather
+    than writing every forward snapshot to disk and reading each one
+    back, this class keeps sparse checkpoints in memory during the
+    forward run and recomputes the span between two checkpoints with
+    the forward solver when the reverse sweep asks for a state inside
+    it, trading cheap re-advancing for snapshot I/O.
+
+    Checkpoints are uniformly spaced, so a full reverse sweep recomputes
+    each forward step at most once; memory holds the checkpoints plus
+    one span, which is smallest when maxStates is near sqrt(numSteps).
+    Recomputation restarts the solver at the checkpoint, the same
+    treatment a restart file gets, so multistep schemes see the
+    checkpoint as a first step.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+class Checkpointer {
+public:
+    /// \brief Constructor: keep at most maxStates checkpoints in memory
+    Checkpointer( IBSolver& solver, int maxStates );
+
+    /// \brief Run the forward solver numSteps steps from the given
+    /// initial state, storing checkpoints along the way
+    void run( const State& initial, int numSteps );
+
+    /// \brief The state after forward step n (0 <= n <= numSteps).
+    /// Designed for reverse-order access: a state between checkpoints
+    /// triggers recomputation of its whole span, which stays cached
+    /// until a state from another span is requested
+    const State& state( int n );
+
+    /// \brief Number of forward steps re-advanced so far
+    int recomputedSteps() const;
+
+private:
+    IBSolver& _solver;
+    int _maxStates;
+    int _numSteps;
+    int _interval;              // steps between checkpoints
+    std::vector<State> _checkpoints;   // state after step k*_interval
+    std::vector<State> _span;   // recomputed states inside one interval
+    int _spanStart;             // step number of _span[0], or -1
+    int _recomputed;
+};
+
+} // namespace ibpm
+
+#endif /* _CHECKPOINTER_H_ */
@@ -15,17 +15,77 @@
 
 #include "CholeskySolver.h"
 #include "NavierStokesModel.h"
+#include "Threads.h"
+#include "Timers.h"
+#include "Memory.h"
 #include "assert.h"
 #include <string>
+#include <string.h>
+#include <stdio.h>
 #include <fstream>
 #include <iomanip>
+#include <vector>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using std::ifstream;
 using std::ofstream;
 using std::setprecision;
+using std::vector;
 
 namespace ibpm {
 
+namespace {
+    // Header for binary factor files: magic tag plus a format version,
+    // bumped whenever the layout below changes
+    const char CHOLESKY_MAGIC[8] = "ibpmchl";
+    const int CHOLESKY_VERSION = 1;
+
+    // Dot products with four independent accumulators, so the compiler
+    // can vectorize the substitution kernels below (one variant for each
+    // precision the factor may be stored in)
+    inline double dotSingle( const float* a, const double* b, int n ) {
+        double s0 = 0.;
+        double s1 = 0.;
+        double s2 = 0.;
+        double s3 = 0.;
+        int k = 0;
+        for ( ; k <= n-4; k += 4 ) {
+            s0 += a[k]   * b[k];
+            s1 += a[k+1] * b[k+1];
+            s2 += a[k+2] * b[k+2];
+            s3 += a[k+3] * b[k+3];
+        }
+        double sum = (s0 + s1) + (s2 + s3);
+        for ( ; k < n; ++k ) {
+            sum += a[k] * b[k];
+        }
+        return sum;
+    }
+
+    inline double dot( const double* a, const double* b, int n ) {
+        double s0 = 0.;
+        double s1 = 0.;
+        double s2 = 0.;
+        double s3 = 0.;
+        int k = 0;
+        for ( ; k <= n-4; k += 4 ) {
+            s0 += a[k]   * b[k];
+            s1 += a[k+1] * b[k+1];
+            s2 += a[k+2] * b[k+2];
+            s3 += a[k+3] * b[k+3];
+        }
+        double sum = (s0 + s1) + (s2 + s3);
+        for ( ; k < n; ++k ) {
+            sum += a[k] * b[k];
+        }
+        return sum;
+    }
+}
+
 // Allocate memory for the Cholesky factorization, but do not compute it
 CholeskySolver::CholeskySolver(
     const Grid& grid,
@@ -36,20 +96,51 @@ CholeskySolver::CholeskySolver(
     _numPoints( model.getNumPoints() ),
     _size( 2 * _numPoints ),
     _alphaBeta( model.getAlpha() * beta ),
-    _lower( _size, _size ),
     _diagonal( _size ),
-    _hasBeenInitialized( false )
-{}
+    _singlePrecision( false ),
+    _lowerData( NULL ),
+    _mapBase( NULL ),
+    _mapLength( 0 ),
+    _hasBeenInitialized( false ),
+    _mirrorDeclared( model.isMirrorSymmetric() ),
+    _useMirror( false ),
+    _points( model.getPoints() )
+{
+    // the (packed) factor itself is allocated when it is computed or
+    // loaded, in the precision selected at that point
+}
 
 CholeskySolver::~CholeskySolver() {
     // Deallocate memory for the Cholesky factorization
     // (no need when Blitz++ arrays are initialized as above)
+#ifndef _WIN32
+    if ( _mapBase != NULL ) {
+        munmap( _mapBase, _mapLength );
+    }
+#endif
+}
+
+void CholeskySolver::setSinglePrecision( bool flag ) {
+    assert( ! _hasBeenInitialized );
+    _singlePrecision = flag;
 }
 
 void CholeskySolver::init() {
     // Return if CholeskySolver has already been initialized
     if ( _hasBeenInitialized ) return;
 
+    // If the geometry declares mirror symmetry about the x-axis, verify
+    // the point pairing and factor the symmetric and antisymmetric
+    // subblocks instead of the full matrix.  (The single-precision
+    // option keeps the full factor, so its refinement step stays simple)
+    if ( _mirrorDeclared && ! _singlePrecision && buildMirrorBasis() ) {
+        assembleAndFactorMirrorBlock( _symBlock );
+        assembleAndFactorMirrorBlock( _antiBlock );
+        _useMirror = true;
+        _hasBeenInitialized = true;
+        return;
+    }
+
     // Build matrix M explicitly, one column at a time
     array2<double> matrixM( _size, _size );
     computeMatrixM( matrixM );
@@ -61,12 +152,20 @@ void CholeskySolver::init() {
 
 // Compute the matrix M to be factored
 void CholeskySolver::computeMatrixM( array2<double>& matrixM ) {
-    BoundaryVector e( _numPoints ); // basis vector
-    BoundaryVector x( _numPoints ); // x = M(e)
-
     cerr << "Computing the matrix for Cholesky factorization..." << flush;
+    // The columns are independent: column j is M applied to the j-th basis
+    // vector.  Every operator M applies (B, the Helmholtz solve, C) works
+    // on caller-provided or per-thread workspace fields (see
+    // NavierStokesModel::getScratch), so the columns can be evaluated
+    // concurrently, each with its own basis and result vectors
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
     for ( int j=0; j<_size; ++j ) {
         // Compute j-th column of M
+        BoundaryVector e( _numPoints ); // basis vector
+        BoundaryVector x( _numPoints ); // x = M(e)
         e = 0;
         e(j) = 1;       // j-th basis vector
         M( e, x );      // Compute x = M(e)
@@ -86,34 +185,365 @@ void CholeskySolver::computeMatrixM( array2<double>& matrixM ) {
 // Postconditions:
 //      _lower contains the strictly lower triangular part of L (no diagonal)
 //      _diag  contains the diagonal elements of L
-void CholeskySolver::computeFactorization( const array2<double>& matrixM ) {
-    
+void CholeskySolver::computeFactorization( array2<double>& matrixM ) {
+
     cerr << "Computing Cholesky factorization..." << flush;
-    _lower = matrixM;
-    for ( int i=0; i<_size; ++i ) {
-        for ( int j=0; j<_size; ++j ) {
-            double sum = _lower(i,j);
-            for ( int k=i-1; k>=0; --k ) {
-                sum -= _lower(i,k) * _lower(j,k);
+    // The factorization runs in place in matrixM (freed by the caller
+    // afterwards); the strict lower triangle is then packed into _lower
+    factorInPlace( matrixM, _size, _diagonal );
+
+    // pack the strict lower triangle of the factor, in the precision
+    // selected for storage
+    unsigned int numPacked = (unsigned int) _size * (_size-1) / 2;
+    ScopedMemoryTag memTag( Memory::CHOLESKY );
+    if ( _singlePrecision ) {
+        _lowerSingle.Allocate( numPacked, Array::cacheAlignment );
+        for ( int i=1; i<_size; ++i ) {
+            for ( int j=0; j<i; ++j ) {
+                lowerSingle(i,j) = (float) matrixM(i,j);
+            }
+        }
+    }
+    else {
+        _lower.Allocate( numPacked, Array::cacheAlignment );
+        for ( int i=1; i<_size; ++i ) {
+            for ( int j=0; j<i; ++j ) {
+                lower(i,j) = matrixM(i,j);
+            }
+        }
+        _lowerData = &_lower(0);
+    }
+    cerr << "done" << endl;
+}
+
+// Cholesky factorization of the n x n matrix A, in place.  On return
+// diag holds the diagonal of the factor and the strict lower triangle
+// of A holds the rest.
+// Blocked right-looking factorization: factor a diagonal block, solve
+// the panel of rows below it, then subtract the panel's contribution
+// from the trailing submatrix.  The panel solve and trailing update
+// are independent across rows, so they run threaded (see Threads.h),
+// and the block width keeps the panel resident in cache during the
+// O(n^3) trailing update.
+void CholeskySolver::factorInPlace(
+    array2<double>& A,
+    int n,
+    array1<double>& diag
+    ) {
+    const int blockSize = 64;
+    for ( int k0=0; k0<n; k0+=blockSize ) {
+        int kend = k0 + blockSize;
+        if ( kend > n ) kend = n;
+
+        // Factor the diagonal block (serial; all earlier contributions
+        // have already been subtracted by previous trailing updates)
+        for ( int i=k0; i<kend; ++i ) {
+            double sum = A(i,i);
+            for ( int k=k0; k<i; ++k ) {
+                sum -= A(i,k) * A(i,k);
+            }
+            assert( sum > 0 );
+            diag(i) = sqrt(sum);
+            for ( int j=i+1; j<kend; ++j ) {
+                double s = A(j,i);
+                for ( int k=k0; k<i; ++k ) {
+                    s -= A(i,k) * A(j,k);
+                }
+                A(j,i) = s / diag(i);
+            }
+        }
+
+        // Panel solve: finish columns k0..kend-1 of the rows below
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for ( int i=kend; i<n; ++i ) {
+            for ( int j=k0; j<kend; ++j ) {
+                double sum = A(i,j);
+                for ( int k=k0; k<j; ++k ) {
+                    sum -= A(i,k) * A(j,k);
+                }
+                A(i,j) = sum / diag(j);
             }
-            if( i==j ) {
-				assert( sum > 0 );
-                _diagonal(i) = sqrt(sum);
+        }
+
+        // Trailing update: subtract the panel's contribution from the
+        // lower triangle of the remaining submatrix
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,16) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for ( int i=kend; i<n; ++i ) {
+            for ( int j=kend; j<=i; ++j ) {
+                double sum = 0.;
+                for ( int k=k0; k<kend; ++k ) {
+                    sum += A(i,k) * A(j,k);
+                }
+                A(i,j) -= sum;
+            }
+        }
+    }
+}
+
+// Pair each boundary point with its mirror image across the x-axis and
+// build the symmetric and antisymmetric force bases.  For a mirror pair
+// (i,p), the symmetric subspace carries (fx_i + fx_p) and (fy_i - fy_p),
+// the antisymmetric one (fx_i - fx_p) and (fy_i + fy_p); a point on the
+// axis contributes its x-force to the symmetric block and its y-force
+// to the antisymmetric block.  Returns false if any point lacks a
+// partner, in which case the full factorization is used, so a wrong
+// declaration only costs the check
+bool CholeskySolver::buildMirrorBasis() {
+    const double tol = 1e-10;
+    vector<int> partner( _numPoints, -1 );
+    for ( int i=0; i<_numPoints; ++i ) {
+        for ( int j=0; j<_numPoints; ++j ) {
+            if ( fabs( _points(X,j) - _points(X,i) ) < tol &&
+                 fabs( _points(Y,j) + _points(Y,i) ) < tol ) {
+                partner[i] = j;
+                break;
+            }
+        }
+        if ( partner[i] < 0 || partner[ partner[i] ] != i ) {
+            cerr << "WARNING: geometry declares mirror symmetry, but its "
+                "points do not pair up across the x-axis; "
+                "using the full factorization" << endl;
+            return false;
+        }
+    }
+
+    for ( int i=0; i<_numPoints; ++i ) {
+        int p = partner[i];
+        if ( p == i ) {
+            // on the axis
+            _symBlock.first.push_back( i );                   // fx
+            _symBlock.second.push_back( -1 );
+            _symBlock.sign.push_back( 0. );
+            _antiBlock.first.push_back( _numPoints + i );     // fy
+            _antiBlock.second.push_back( -1 );
+            _antiBlock.sign.push_back( 0. );
+        }
+        else if ( p > i ) {
+            _symBlock.first.push_back( i );
+            _symBlock.second.push_back( p );
+            _symBlock.sign.push_back( 1. );
+            _symBlock.first.push_back( _numPoints + i );
+            _symBlock.second.push_back( _numPoints + p );
+            _symBlock.sign.push_back( -1. );
+            _antiBlock.first.push_back( i );
+            _antiBlock.second.push_back( p );
+            _antiBlock.sign.push_back( -1. );
+            _antiBlock.first.push_back( _numPoints + i );
+            _antiBlock.second.push_back( _numPoints + p );
+            _antiBlock.sign.push_back( 1. );
+        }
+    }
+    return true;
+}
+
+// Assemble one mirror subblock of M and factor it.  Column c is M
+// applied to the c-th basis vector, projected back onto the block's own
+// basis; the cross-block projections vanish by symmetry, so they are
+// never formed.  The columns are independent, as in computeMatrixM
+void CholeskySolver::assembleAndFactorMirrorBlock( MirrorBlock& block ) {
+    int n = (int) block.first.size();
+    const double invSqrt2 = 1. / sqrt( 2. );
+    array2<double> A( n, n );
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+    for ( int c=0; c<n; ++c ) {
+        BoundaryVector e( _numPoints );
+        BoundaryVector x( _numPoints );
+        e = 0;
+        if ( block.second[c] < 0 ) {
+            e( block.first[c] ) = 1.;
+        }
+        else {
+            e( block.first[c] ) = invSqrt2;
+            e( block.second[c] ) = block.sign[c] * invSqrt2;
+        }
+        M( e, x );
+        for ( int i=0; i<n; ++i ) {
+            if ( block.second[i] < 0 ) {
+                A(i,c) = x( block.first[i] );
             }
             else {
-                _lower(j,i) = sum / _diagonal(i);
+                A(i,c) = invSqrt2 * ( x( block.first[i] )
+                    + block.sign[i] * x( block.second[i] ) );
+            }
+        }
+    }
+    ScopedMemoryTag memTag( Memory::CHOLESKY );
+    block.diag.Allocate( n );
+    factorInPlace( A, n, block.diag );
+    unsigned int numPacked = (unsigned int) n * (n-1) / 2;
+    block.lower.Allocate( numPacked > 0 ? numPacked : 1,
+                          Array::cacheAlignment );
+    for ( int i=1; i<n; ++i ) {
+        for ( int j=0; j<i; ++j ) {
+            block.lower( i*(i-1)/2 + j ) = A(i,j);
+        }
+    }
+}
+
+// Solve M x = b via the mirror blocks: project b onto each block's
+// basis, substitute with that block's factor, and reassemble the full
+// force vector.  The transforms touch each entry a constant number of
+// times, so the solve cost is the two half-size substitutions
+void CholeskySolver::substituteMirror(
+    const BoundaryVector& b,
+    BoundaryVector& x
+    ) {
+    const double invSqrt2 = 1. / sqrt( 2. );
+    x = 0.;
+    for ( int half=0; half<2; ++half ) {
+        MirrorBlock& block = ( half == 0 ) ? _symBlock : _antiBlock;
+        int n = (int) block.first.size();
+        vector<double> y( n );
+        for ( int i=0; i<n; ++i ) {
+            y[i] = ( block.second[i] < 0 )
+                ? b( block.first[i] )
+                : invSqrt2 * ( b( block.first[i] )
+                    + block.sign[i] * b( block.second[i] ) );
+        }
+        for ( int i=0; i<n; ++i ) {
+            const double* rowi = &block.lower( i*(i-1)/2 );
+            y[i] = ( y[i] - dot( rowi, &y[0], i ) ) / block.diag(i);
+        }
+        for ( int i=n-1; i>=0; --i ) {
+            double sum = y[i];
+            for ( int k=i+1; k<n; ++k ) {
+                sum -= block.lower( k*(k-1)/2 + i ) * y[k];
+            }
+            y[i] = sum / block.diag(i);
+        }
+        for ( int i=0; i<n; ++i ) {
+            if ( block.second[i] < 0 ) {
+                x( block.first[i] ) = y[i];
+            }
+            else {
+                x( block.first[i] )  += invSqrt2 * y[i];
+                x( block.second[i] ) += block.sign[i] * invSqrt2 * y[i];
             }
         }
     }
-    cerr << "done" << endl;
 }
 
 // Load a Cholesky decomposition from a file with name <basename>.cholesky
 // Return true if successful
+// Reads the binary format written by save below, falling back to the
+// ASCII format written by earlier versions of the code
 bool CholeskySolver::load(const string& basename) {
     string filename = basename + ".cholesky";
     cerr << "Loading Cholesky factorization from file " << filename
         << "..." << flush;
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) {
+        cerr << "(failed: could not open file)" << endl;
+        return false;
+    }
+
+    char magic[sizeof(CHOLESKY_MAGIC)];
+    bool isBinary = ( fread( magic, sizeof(magic), 1, fp ) == 1 ) &&
+        ( memcmp( magic, CHOLESKY_MAGIC, sizeof(magic) ) == 0 );
+    if ( isBinary ) {
+        bool success = true;
+        int version = 0;
+        success = success && ( fread( &version, sizeof(int), 1, fp ) == 1 );
+        if ( success && version != CHOLESKY_VERSION ) {
+            fclose( fp );
+            cerr << "(failed: unknown file version)" << endl;
+            return false;
+        }
+        int n = 0;
+        success = success && ( fread( &n, sizeof(int), 1, fp ) == 1 );
+        if ( success && n != _size ) {
+            fclose( fp );
+            cerr << "(failed: wrong file size)" << endl;
+            return false;
+        }
+        double alphaBeta_in = 0.;
+        success = success && ( fread( &alphaBeta_in, sizeof(double), 1, fp ) == 1 );
+        if ( success && alphaBeta_in != _alphaBeta ) {
+            fclose( fp );
+            cerr << "(failed: wrong timestep or Re)" << endl;
+            return false;
+        }
+        // read the diagonal, then the packed strictly lower triangle
+        // (stored row by row, so the packed array maps onto the file
+        // layout directly; narrowed row by row if the factor is stored
+        // in single precision)
+        size_t numPacked = (size_t) _size * (_size-1) / 2;
+        ScopedMemoryTag memTag( Memory::CHOLESKY );
+        success = success &&
+            ( fread( &_diagonal(0), sizeof(double), _size, fp ) ==
+                (size_t) _size );
+        if ( _singlePrecision ) {
+            _lowerSingle.Allocate( (unsigned int) numPacked, Array::cacheAlignment );
+            vector<double> row( _size );
+            for ( int i=1; success && i<_size; ++i ) {
+                success = ( fread( &row[0], sizeof(double), i, fp ) ==
+                    (size_t) i );
+                float* rowi = &_lowerSingle( i*(i-1)/2 );
+                for ( int j=0; j<i; ++j ) {
+                    rowi[j] = (float) row[j];
+                }
+            }
+        }
+        else {
+#ifndef _WIN32
+            // Map the packed triangle shared and read-only instead of
+            // copying it.  The 24-byte header keeps every double in the
+            // file 8-byte aligned within the (page-aligned) mapping,
+            // and a MAP_SHARED file-backed mapping is never duplicated
+            // on read, so N concurrent processes loading the same
+            // factor file on a node share one resident copy of it
+            long dataOffset = ftell( fp );
+            struct stat st;
+            size_t mapLength = (size_t) dataOffset
+                + numPacked * sizeof(double);
+            if ( success && dataOffset > 0 &&
+                 fstat( fileno( fp ), &st ) == 0 &&
+                 (size_t) st.st_size >= mapLength ) {
+                void* base = mmap( NULL, mapLength, PROT_READ, MAP_SHARED,
+                                   fileno( fp ), 0 );
+                if ( base != MAP_FAILED ) {
+                    madvise( base, mapLength, MADV_WILLNEED );
+                    _mapBase = base;
+                    _mapLength = mapLength;
+                    _lowerData = (const double*)
+                        ( (const char*) base + dataOffset );
+                }
+            }
+#endif
+            if ( _mapBase == NULL ) {
+                // mapping unavailable: fall back to a private copy
+                _lower.Allocate( (unsigned int) numPacked,
+                                 Array::cacheAlignment );
+                success = success &&
+                    ( fread( &_lower(0), sizeof(double), numPacked, fp ) ==
+                        numPacked );
+                if ( success ) {
+                    _lowerData = &_lower(0);
+                }
+            }
+        }
+        fclose( fp );
+        if ( ! success ) {
+            cerr << "(failed: corrupt file)" << endl;
+            return false;
+        }
+        _hasBeenInitialized = true;
+        cerr << ( ( _mapBase != NULL ) ? "done (mapped shared)" : "done" )
+            << endl;
+        return true;
+    }
+    fclose( fp );
+
+    // Not a binary factor file: try the legacy ASCII format
     ifstream infile( filename.c_str() );
     if ( ! infile.good() ) {
         cerr << "(failed: could not open file)" << endl;
@@ -150,10 +580,26 @@ bool CholeskySolver::load(const string& basename) {
     }
     
     // read the lower triangular portion
-    for ( int i=0; i<_size; ++i) {
-        for (int j=0; j<i; ++j) {
-            infile >> _lower(i,j);
+    unsigned int numPacked = (unsigned int) _size * (_size-1) / 2;
+    ScopedMemoryTag memTag( Memory::CHOLESKY );
+    if ( _singlePrecision ) {
+        _lowerSingle.Allocate( numPacked, Array::cacheAlignment );
+        double value;
+        for ( int i=0; i<_size; ++i) {
+            for (int j=0; j<i; ++j) {
+                infile >> value;
+                lowerSingle(i,j) = (float) value;
+            }
+        }
+    }
+    else {
+        _lower.Allocate( numPacked, Array::cacheAlignment );
+        for ( int i=0; i<_size; ++i) {
+            for (int j=0; j<i; ++j) {
+                infile >> lower(i,j);
+            }
         }
+        _lowerData = &_lower(0);
     }
     _hasBeenInitialized = true;
     cerr << "done" << endl;
@@ -163,64 +609,206 @@ bool CholeskySolver::load(const string& basename) {
 // Save a Cholesky decomposition a file with name <basename>.cholesky,
 // overwriting if necessary.
 // Return true if successful
+// The file is binary (native-endian doubles, written in bulk), with a
+// magic tag and version so load can recognize it; text output of a
+// 12800x12800 factor took minutes to write and parse on every restart.
+// The 24-byte header keeps every double in the file 8-byte aligned, so
+// load can map the file in place instead of copying it.
 // Note: saves only strictly lower triangular portion of _lower, since
 // that is all that is needed for back substitution
 bool CholeskySolver::save(const string& basename) {
     assert( _hasBeenInitialized );
+    if ( _useMirror ) {
+        // the file format holds a single full-size factor; recomputing
+        // the mirror blocks is cheap enough not to warrant a second one
+        cerr << "WARNING: mirror-symmetric factors cannot be saved" << endl;
+        return false;
+    }
     string filename = basename + ".cholesky";
     cerr << "Saving Cholesky factorization to file " << filename
         << "..." << flush;
-    ofstream outfile( filename.c_str() );
-    if ( ! outfile.good() ) {
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) {
         cerr << "(failed: could not open file)" << endl;
         return false;
     }
-    outfile << _size << endl;
-    outfile << setprecision(17) << _alphaBeta << endl;
-    // write the diagonal part
-    for ( int i=0; i<_size; ++i ) {
-        outfile << setprecision(17) << _diagonal(i) << endl;
-    }
-
-    // insert marker, as a crude verification that we did not skip a line
-    // when reading back in
-    outfile << "#" << endl;
-
-    // write the lower triangular part
-    for ( int i=0; i<_size; ++i) {
-        for (int j=0; j<i; ++j) {
-            outfile << setprecision(17) << _lower(i,j) << endl;
+    int version = CHOLESKY_VERSION;
+    fwrite( CHOLESKY_MAGIC, sizeof(CHOLESKY_MAGIC), 1, fp );
+    fwrite( &version, sizeof(int), 1, fp );
+    fwrite( &_size, sizeof(int), 1, fp );
+    fwrite( &_alphaBeta, sizeof(double), 1, fp );
+    // write the diagonal, then the packed strictly lower triangle (row
+    // by row, which is exactly the packed layout, so one bulk write when
+    // the factor is stored in double; a single-precision factor is
+    // widened row by row so the file format stays the same)
+    fwrite( &_diagonal(0), sizeof(double), _size, fp );
+    if ( _singlePrecision ) {
+        vector<double> row( _size );
+        for ( int i=1; i<_size; ++i ) {
+            const float* rowi = &_lowerSingle( i*(i-1)/2 );
+            for ( int j=0; j<i; ++j ) {
+                row[j] = rowi[j];
+            }
+            fwrite( &row[0], sizeof(double), i, fp );
         }
     }
+    else {
+        // _lowerData rather than _lower: the factor may itself live in a
+        // mapping of an earlier file
+        fwrite( _lowerData, sizeof(double), (size_t) _size * (_size-1) / 2, fp );
+    }
+    fclose( fp );
     cerr << "done" << endl;
     return true;
 }
 
-// Solve A x = b using the Cholesky factorization A = LL*
-void CholeskySolver::Minv(
+UpdatedCholeskySolver::UpdatedCholeskySolver(
+    const Grid& grid,
+    const NavierStokesModel& model,
+    double beta,
+    double tolerance
+    ) :
+    CholeskySolver( grid, model, beta ),
+    _toleranceSquared( tolerance * tolerance )
+{}
+
+// Solve M x = b for the current body positions, where the stored factor
+// corresponds to the reference configuration (body positions at init).
+// Iterative refinement with the reference factor as approximate inverse:
+//     x <- x + M0^{-1} ( b - M x )
+// converges when || M - M0 || is small, i.e. for small-amplitude motions
+void UpdatedCholeskySolver::Minv(
     const BoundaryVector& b,
     BoundaryVector& x
     ) {
+    const int maxIterations = 100;
+    // initial guess from the reference factor
+    CholeskySolver::Minv( b, x );
+    BoundaryVector r( b.getNumPoints() );
+    BoundaryVector dx( b.getNumPoints() );
+    for ( int i=0; i<maxIterations; ++i ) {
+        // r = b - M(x), for M at the current body positions
+        M( x, r );
+        r *= -1;
+        r += b;
+        if ( InnerProduct( r, r ) <= _toleranceSquared ) break;
+        CholeskySolver::Minv( r, dx );
+        x += dx;
+    }
+}
 
-    assert( _hasBeenInitialized );
+// Forward and back substitution with the double-precision factor
+void CholeskySolver::substitute(
+    const BoundaryVector& b,
+    BoundaryVector& x
+    ) {
     // Solve L y = b for y
-    // (Here, y and x use the same memory, for efficiency)
+    // (Here, y and x use the same memory, for efficiency.  Row i of the
+    // packed factor and the solution vector are both contiguous, so the
+    // forward solve is a vectorized dot product per row.)
     for ( int i=0; i<_size; ++i ) {
-        double sum = b(i);
-        for ( int k=i-1; k>=0; --k ) {
-            sum -= _lower(i,k) * x(k);
+        const double* rowi = _lowerData + (size_t) i*(i-1)/2;
+        x(i) = ( b(i) - dot( rowi, &x(0), i ) ) / _diagonal(i);
+    }
+
+    // Solve L^Tx = y for x
+    for ( int i=_size-1; i>=0; --i ) {
+        double sum = x(i);
+        for (int k=i+1; k<_size; ++k ) {
+            sum -= _lowerData[ (size_t) k*(k-1)/2 + i ] * x(k);
         }
         x(i) = sum / _diagonal(i);
     }
+}
 
-    // Solve L^Tx = y for x
+// Forward and back substitution with the single-precision factor
+// (accumulation is still in double)
+void CholeskySolver::substituteSingle(
+    const BoundaryVector& b,
+    BoundaryVector& x
+    ) {
+    for ( int i=0; i<_size; ++i ) {
+        const float* rowi = &_lowerSingle( i*(i-1)/2 );
+        x(i) = ( b(i) - dotSingle( rowi, &x(0), i ) ) / _diagonal(i);
+    }
     for ( int i=_size-1; i>=0; --i ) {
         double sum = x(i);
         for (int k=i+1; k<_size; ++k ) {
-            sum -= _lower(k,i) * x(k);
+            sum -= _lowerSingle( k*(k-1)/2 + i ) * x(k);
         }
         x(i) = sum / _diagonal(i);
     }
 }
 
+// Solve A x = b using the Cholesky factorization A = LL*
+void CholeskySolver::Minv(
+    const BoundaryVector& b,
+    BoundaryVector& x
+    ) {
+
+    assert( _hasBeenInitialized );
+    Timers::bump( Timers::CHOLESKY_SOLVES );
+    if ( _useMirror ) {
+        substituteMirror( b, x );
+        return;
+    }
+    if ( ! _singlePrecision ) {
+        substitute( b, x );
+        return;
+    }
+    // Single-precision factor: substitute, then apply one step of
+    // double-precision iterative refinement with the matrix-free M
+    // operator to restore accuracy
+    substituteSingle( b, x );
+    BoundaryVector r( b.getNumPoints() );
+    BoundaryVector dx( b.getNumPoints() );
+    M( x, r );
+    r *= -1;
+    r += b;
+    substituteSingle( r, dx );
+    x += dx;
+}
+
+// Solve M x = b for a block of right-hand sides against the same factor.
+// The loops are ordered so that each factor element is loaded once per
+// block, rather than once per vector
+void CholeskySolver::Minv(
+    const std::vector<BoundaryVector>& b,
+    std::vector<BoundaryVector>& x
+    ) {
+
+    assert( _hasBeenInitialized );
+    assert( b.size() == x.size() );
+    int numRhs = (int) b.size();
+
+    if ( _singlePrecision || _useMirror ) {
+        // refinement (and the mirror transforms) make the blocked pass
+        // awkward; solve one at a time
+        for ( int r=0; r<numRhs; ++r ) {
+            Minv( b[r], x[r] );
+        }
+        return;
+    }
+    Timers::bumpBy( Timers::CHOLESKY_SOLVES, numRhs );
+
+    // Solve L y = b for each right-hand side
+    for ( int i=0; i<_size; ++i ) {
+        const double* rowi = _lowerData + (size_t) i*(i-1)/2;
+        for ( int r=0; r<numRhs; ++r ) {
+            x[r](i) = ( b[r](i) - dot( rowi, &x[r](0), i ) ) / _diagonal(i);
+        }
+    }
+
+    // Solve L^T x = y for each right-hand side
+    for ( int i=_size-1; i>=0; --i ) {
+        for ( int r=0; r<numRhs; ++r ) {
+            double sum = x[r](i);
+            for ( int k=i+1; k<_size; ++k ) {
+                sum -= _lowerData[ (size_t) k*(k-1)/2 + i ] * x[r](k);
+            }
+            x[r](i) = sum / _diagonal(i);
+        }
+    }
+}
+
 } // namespace ibpm
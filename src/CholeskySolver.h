@@ -4,6 +4,7 @@
 #include "ProjectionSolver.h"
 #include "Array.h"
 #include <string>
+#include <vector>
 
 using Array::array1;
 using Array::array2;
@@ -36,19 +37,34 @@ namespace ibpm {
 
 class CholeskySolver : public ProjectionSolver {
 public:
-    
+
     CholeskySolver(
         const Grid& grid,
         const NavierStokesModel& model,
         double beta
     );
-    
+
     ~CholeskySolver();
 
-    /// \brief Compute the Cholesky decomposition of M
+    /// \brief Compute the Cholesky decomposition of M.
+    /// When the geometry declares mirror symmetry about the x-axis (see
+    /// RigidBody::setMirrorSymmetric) and its points pair up under the
+    /// reflection, M block-diagonalizes in the symmetric/antisymmetric
+    /// force basis and the two half-size blocks are factored separately,
+    /// at roughly an eighth of the full factorization cost
     void init();
 
+    /// \brief Store the factor in single precision, halving its memory
+    /// footprint and substitution bandwidth; accuracy is restored by one
+    /// step of double-precision iterative refinement in Minv, using the
+    /// matrix-free M operator.  Must be called before init() or load()
+    void setSinglePrecision( bool flag );
+
     /// \brief Load a Cholesky decomposition from the specified file.
+    /// A binary double-precision factor is mapped shared and read-only
+    /// (mmap) instead of being copied into private memory, so N
+    /// concurrent processes loading the same factor file on a node
+    /// share one resident copy of it between them.
     /// Returns true if successful
     bool load(const std::string& filename);
     
@@ -56,7 +72,17 @@ public:
     /// overwriting if necessary.
     /// Returns true if successful
     bool save(const std::string& filename);
-    
+
+    /// \brief Solve M f = b for several right-hand sides against the
+    /// same factor.  Each factor row is streamed from memory once per
+    /// block of vectors, so this is much cheaper than repeated
+    /// single-vector solves when many force vectors are needed (e.g.
+    /// for modal analysis with the linearized solver)
+    void Minv(
+        const std::vector<BoundaryVector>& b,
+        std::vector<BoundaryVector>& x
+    );
+
 protected:
     /// \brief Solve Mf = b for f, using the Cholesky factorization of M. 
     /// Assumes M is symmetric.
@@ -71,11 +97,98 @@ private:
     const double _alphaBeta;    // keep a local copy of alpha * beta, as a
                                 // check when reading in Cholesky factorizations
                                 // from files
-    array2<double> _lower;
+    // Strictly lower triangular factor, packed by rows: row i occupies
+    // entries [ i*(i-1)/2, i*(i-1)/2 + i ).  Only the strict lower
+    // triangle is ever used, so packed storage halves the memory per
+    // solver instance (there is one per RK substep)
+    array1<double> _lower;
+    array1<float> _lowerSingle;  // used instead of _lower when the
+                                 // single-precision option is enabled
     array1<double> _diagonal;
+    bool _singlePrecision;
+    // All reads of the packed factor go through this pointer: it aims
+    // at _lower when the factor lives in private memory (computed, or
+    // read from a legacy file), or into a shared read-only mapping of
+    // the factor file when load() maps one
+    const double* _lowerData;
+    void* _mapBase;      // mmap base address; NULL when not mapped
+    size_t _mapLength;   // length of the mapping, for munmap
+    inline double& lower( int i, int j ) {
+        return _lower( i*(i-1)/2 + j );
+    }
+    inline double lower( int i, int j ) const {
+        return _lowerData[ i*(i-1)/2 + j ];
+    }
+    inline float& lowerSingle( int i, int j ) {
+        return _lowerSingle( i*(i-1)/2 + j );
+    }
     void computeMatrixM( array2<double>& M );
-    void computeFactorization( const array2<double>& M );
+    void computeFactorization( array2<double>& M );
+    void factorInPlace( array2<double>& A, int n, array1<double>& diag );
+    void substitute( const BoundaryVector& b, BoundaryVector& x );
+    void substituteSingle( const BoundaryVector& b, BoundaryVector& x );
     bool _hasBeenInitialized;
+
+    // Mirror-symmetry mode (see init): one subblock of M in the
+    // symmetric or antisymmetric force basis.  Each basis vector has
+    // one or two nonzero entries in the full force vector, recorded by
+    // flat index; second is -1 for points on the axis
+    struct MirrorBlock {
+        std::vector<int> first;
+        std::vector<int> second;
+        std::vector<double> sign;    // sign of the second entry
+        array1<double> lower;        // packed strict lower triangle
+        array1<double> diag;
+    };
+    bool _mirrorDeclared;        // geometry declares mirror symmetry
+    bool _useMirror;             // declaration verified, blocks factored
+    BoundaryVector _points;      // boundary point coordinates, for pairing
+    MirrorBlock _symBlock;
+    MirrorBlock _antiBlock;
+    bool buildMirrorBasis();
+    void assembleAndFactorMirrorBlock( MirrorBlock& block );
+    void substituteMirror( const BoundaryVector& b, BoundaryVector& x );
+};
+
+/*!
+    \class UpdatedCholeskySolver
+
+    \brief Direct solver for moving geometry, correcting a reference
+    Cholesky factor instead of iterating from scratch.
+
+    The factor of M = C A^{-1} B is computed once, at the configuration
+    the bodies have when init() is called.  When the bodies move, M
+    changes, and Minv corrects for the difference by iterative
+    refinement, using the reference factor as an approximate inverse.
+    For small-amplitude motions this converges in a few iterations, each
+    costing one application of M plus two triangular substitutions --
+    far cheaper than running conjugate gradient to convergence every
+    timestep.
+*/
+class UpdatedCholeskySolver : public CholeskySolver {
+public:
+
+    UpdatedCholeskySolver(
+        const Grid& grid,
+        const NavierStokesModel& model,
+        double beta,
+        double tolerance
+    );
+
+    inline void setTolerance(double tolerance) {
+        _toleranceSquared = tolerance * tolerance;
+    }
+
+protected:
+    /// \brief Solve Mf = b for f at the current body positions, by
+    /// iterative refinement of solutions with the reference factor
+    void Minv(
+        const BoundaryVector& b,
+        BoundaryVector& x
+    );
+
+private:
+    double _toleranceSquared;
 };
 
 } // namespace ibpm
@@ -13,14 +13,123 @@
 // $LastChangedBy$
 // $HeadURL$
 
+#include <assert.h>
 #include "NavierStokesModel.h"
 #include "ProjectionSolver.h"
 #include "ConjugateGradientSolver.h"
+#include "Kernels.h"
+#include "Timers.h"
+
+using std::vector;
 
 namespace ibpm {
 
 const int MAX_ITERATIONS = 3000;
 
+// Subspace recycling parameters (see ConjugateGradientSolver::Minv):
+// how many approximate eigenvectors of M to retain across solves, how
+// many Lanczos vectors to store while iterating, and how many
+// iterations a solve may take before the retained space is considered
+// stale and rebuilt from the new Lanczos data
+const int RECYCLE_VECTORS = 6;
+const int RECYCLE_MAX_LANCZOS = 30;
+const int RECYCLE_REBUILD_ITERATIONS = 12;
+
+// Factor the symmetric positive definite n x n matrix A (row-major) in
+// place into its lower Cholesky factor.  Returns false if A is not
+// positive definite.  n is at most RECYCLE_VECTORS, so no blocking
+static bool CholeskyFactorSmall( vector<double>& A, int n ) {
+    for (int i=0; i<n; ++i) {
+        for (int j=0; j<=i; ++j) {
+            double sum = A[i*n+j];
+            for (int k=0; k<j; ++k) {
+                sum -= A[i*n+k] * A[j*n+k];
+            }
+            if ( i == j ) {
+                if ( sum <= 0. ) return false;
+                A[i*n+i] = sqrt( sum );
+            }
+            else {
+                A[i*n+j] = sum / A[j*n+j];
+            }
+        }
+    }
+    return true;
+}
+
+// Solve L L^T y = c in place, given the lower factor L from above
+static void CholeskySolveSmall( const vector<double>& L, int n,
+                                vector<double>& c ) {
+    for (int i=0; i<n; ++i) {
+        double sum = c[i];
+        for (int k=0; k<i; ++k) {
+            sum -= L[i*n+k] * c[k];
+        }
+        c[i] = sum / L[i*n+i];
+    }
+    for (int i=n-1; i>=0; --i) {
+        double sum = c[i];
+        for (int k=i+1; k<n; ++k) {
+            sum -= L[k*n+i] * c[k];
+        }
+        c[i] = sum / L[i*n+i];
+    }
+}
+
+// Eigenvalues and eigenvectors of the symmetric n x n matrix A
+// (row-major), by cyclic Jacobi sweeps; A is destroyed.  On return
+// eigval[i] is the i-th eigenvalue and column i of V the matching
+// eigenvector.  The matrices here are at most RECYCLE_MAX_LANCZOS
+// square, so the O(n^3) sweeps cost nothing next to one application
+// of M
+static void JacobiEigenSmall( vector<double>& A, int n,
+                              vector<double>& eigval, vector<double>& V ) {
+    V.assign( n*n, 0. );
+    for (int i=0; i<n; ++i) {
+        V[i*n+i] = 1.;
+    }
+    for (int sweep=0; sweep<50; ++sweep) {
+        double off = 0.;
+        for (int p=0; p<n; ++p) {
+            for (int q=p+1; q<n; ++q) {
+                off += A[p*n+q] * A[p*n+q];
+            }
+        }
+        if ( off < 1e-28 ) break;
+        for (int p=0; p<n; ++p) {
+            for (int q=p+1; q<n; ++q) {
+                if ( fabs( A[p*n+q] ) == 0. ) continue;
+                double theta = ( A[q*n+q] - A[p*n+p] ) / ( 2. * A[p*n+q] );
+                double t = ( theta >= 0. ? 1. : -1. ) /
+                           ( fabs( theta ) + sqrt( theta*theta + 1. ) );
+                double c = 1. / sqrt( t*t + 1. );
+                double s = t * c;
+                // A = J^T A J, where J rotates the (p,q) plane
+                for (int k=0; k<n; ++k) {
+                    double apk = A[p*n+k];
+                    double aqk = A[q*n+k];
+                    A[p*n+k] = c * apk - s * aqk;
+                    A[q*n+k] = s * apk + c * aqk;
+                }
+                for (int k=0; k<n; ++k) {
+                    double akp = A[k*n+p];
+                    double akq = A[k*n+q];
+                    A[k*n+p] = c * akp - s * akq;
+                    A[k*n+q] = s * akp + c * akq;
+                    double vkp = V[k*n+p];
+                    double vkq = V[k*n+q];
+                    V[k*n+p] = c * vkp - s * vkq;
+                    V[k*n+q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    eigval.assign( n, 0. );
+    for (int i=0; i<n; ++i) {
+        eigval[i] = A[i*n+i];
+    }
+}
+
 ConjugateGradientSolver::ConjugateGradientSolver(
     const Grid& grid,
     const NavierStokesModel& model,
@@ -28,10 +137,138 @@ ConjugateGradientSolver::ConjugateGradientSolver(
     double tolerance
     ) :
     ProjectionSolver( grid, model, beta ),
-    _toleranceSquared(tolerance*tolerance)
+    _toleranceSquared(tolerance*tolerance),
+    _fPrev( model.getNumPoints() ),
+    _fPrevSaved( false )
+{}
+
+// Per-run state, in the record framing of ProjectionSolver::saveRunState:
+// the boundary-vector count is odd iff a warm-start solution is stored
+// (the remainder is the k recycled basis vectors followed by their k
+// images under M), and the metadata is the warm-start flag, k, and the
+// k*k entries of the Gram factor
+bool ConjugateGradientSolver::saveRunState( FILE* fp ) {
+    int k = _recycleW.size();
+    int count = ( _fPrevSaved ? 1 : 0 ) + 2 * k;
+    int meta = 2 + k * k;
+    fwrite( &count, sizeof( int ), 1, fp );
+    fwrite( &meta, sizeof( int ), 1, fp );
+    size_t n = _fPrev.getSize();
+    if ( _fPrevSaved ) {
+        fwrite( _fPrev.flatten(), sizeof( double ), n, fp );
+    }
+    for (int i=0; i<k; ++i) {
+        fwrite( _recycleW[i].flatten(), sizeof( double ), n, fp );
+    }
+    for (int i=0; i<k; ++i) {
+        fwrite( _recycleMW[i].flatten(), sizeof( double ), n, fp );
+    }
+    double d = _fPrevSaved ? 1. : 0.;
+    fwrite( &d, sizeof( double ), 1, fp );
+    d = k;
+    fwrite( &d, sizeof( double ), 1, fp );
+    for (int i=0; i<k*k; ++i) {
+        fwrite( &_recycleGram[i], sizeof( double ), 1, fp );
+    }
+    return ferror( fp ) == 0;
+}
+
+bool ConjugateGradientSolver::loadRunState( FILE* fp ) {
+    int count, meta;
+    if ( fread( &count, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( fread( &meta, sizeof( int ), 1, fp ) != 1 ) return false;
+    bool havePrev = ( count % 2 == 1 );
+    int k = count / 2;
+    if ( count < 0 || k > RECYCLE_VECTORS || meta != 2 + k * k ) {
+        return false;
+    }
+    size_t n = _fPrev.getSize();
+    if ( havePrev ) {
+        if ( fread( _fPrev.flatten(), sizeof( double ), n, fp ) != n ) {
+            return false;
+        }
+    }
+    int numPoints = _fPrev.getNumPoints();
+    vector<BoundaryVector> W( k, BoundaryVector( numPoints ) );
+    vector<BoundaryVector> MW( k, BoundaryVector( numPoints ) );
+    for (int i=0; i<k; ++i) {
+        if ( fread( W[i].flatten(), sizeof( double ), n, fp ) != n ) {
+            return false;
+        }
+    }
+    for (int i=0; i<k; ++i) {
+        if ( fread( MW[i].flatten(), sizeof( double ), n, fp ) != n ) {
+            return false;
+        }
+    }
+    double flag, kStored;
+    if ( fread( &flag, sizeof( double ), 1, fp ) != 1 ) return false;
+    if ( fread( &kStored, sizeof( double ), 1, fp ) != 1 ) return false;
+    if ( ( flag != 0. ) != havePrev || (int) kStored != k ) return false;
+    vector<double> G( k * k );
+    for (int i=0; i<k*k; ++i) {
+        if ( fread( &G[i], sizeof( double ), 1, fp ) != 1 ) return false;
+    }
+    _fPrevSaved = havePrev;
+    _recycleW.swap( W );
+    _recycleMW.swap( MW );
+    _recycleGram.swap( G );
+    return true;
+}
+
+PreconditionedConjugateGradientSolver::PreconditionedConjugateGradientSolver(
+    const Grid& grid,
+    const NavierStokesModel& model,
+    double beta,
+    double tolerance
+    ) :
+    CholeskySolver( grid, model, beta ),
+    _toleranceSquared( tolerance * tolerance )
 {}
 
-// Implementation of conjugate gradient method
+void PreconditionedConjugateGradientSolver::applyPreconditioner(
+    const BoundaryVector& r,
+    BoundaryVector& z
+    ) {
+    CholeskySolver::Minv( r, z );
+}
+
+// Preconditioned conjugate gradient: same iteration as above, with the
+// search directions drawn from the preconditioned residual
+void PreconditionedConjugateGradientSolver::Minv(
+    const BoundaryVector& b,
+    BoundaryVector& x
+    ) {
+    int numIterations = 0;
+
+    // r = b - M(x)
+    BoundaryVector r = b;
+    BoundaryVector q = M(x);
+    r -= q;
+    BoundaryVector z( b.getNumPoints() );
+    applyPreconditioner( r, z );
+    BoundaryVector d = z;
+    double delta = InnerProduct( r, z );
+
+    while ( ( InnerProduct( r, r ) > _toleranceSquared ) &&
+            ( numIterations < MAX_ITERATIONS ) ) {
+        // alpha = <r,z> / <d, Md>
+        q = M(d);
+        double alpha = delta / InnerProduct( d, q );
+        // x += alpha * d and r -= alpha * q, without forming temporaries
+        Kernels::Axpy( x.flatten(),  alpha, d.flatten(), x.getSize() );
+        Kernels::Axpy( r.flatten(), -alpha, q.flatten(), r.getSize() );
+        applyPreconditioner( r, z );
+        double delta_old = delta;
+        delta = InnerProduct( r, z );
+        d = z + ( delta / delta_old ) * d;
+        ++numIterations;
+    }
+    Timers::bumpBy( Timers::CG_ITERATIONS, numIterations );
+}
+
+// Implementation of conjugate gradient method, with deflation of the
+// subspace recycled from previous solves (see the class comment)
 void ConjugateGradientSolver::Minv(
     const BoundaryVector& b,
     BoundaryVector& x
@@ -42,26 +279,357 @@ void ConjugateGradientSolver::Minv(
     double delta_old;
     int numIterations = 0;
 
+    // Warm start from the previous converged solution for this substep,
+    // if there is one
+    if ( _fPrevSaved ) {
+        x = _fPrev;
+    }
+
     // r = b - M(x)
     BoundaryVector r = b;
     BoundaryVector q = M(x);
     r -= q;
+
+    // Galerkin correction over the recycled subspace: remove the
+    // components of the error along the retained approximate
+    // eigenvectors of M before iterating.  These are the slow modes of
+    // an earlier solve, and they drift only slowly as the bodies move,
+    // so removing them up front spares the iteration its tail
+    int k = _recycleW.size();
+    vector<double> y( k );
+    if ( k > 0 ) {
+        for (int i=0; i<k; ++i) {
+            y[i] = InnerProduct( _recycleW[i], r );
+        }
+        CholeskySolveSmall( _recycleGram, k, y );
+        for (int i=0; i<k; ++i) {
+            Kernels::Axpy( x.flatten(),  y[i],
+                           _recycleW[i].component(X), x.getSize() );
+            Kernels::Axpy( r.flatten(), -y[i],
+                           _recycleMW[i].component(X), r.getSize() );
+        }
+    }
+
     BoundaryVector d = r;
     delta = InnerProduct(r,r);
-    
+
+    // Lanczos data for harvesting fresh approximate eigenvectors: the
+    // scaled residuals are the Lanczos vectors of M (with alternating
+    // sign), and alpha and beta assemble its tridiagonal
+    vector<BoundaryVector> lanczos;
+    vector<double> lanczosDiag;
+    vector<double> lanczosOff;
+    double carry = 0.;   // beta_{j-1} / alpha_{j-1}, feeds T(j,j)
+
     // while error is greater than tolerance
     while ( (delta > _toleranceSquared) &&
             (numIterations < MAX_ITERATIONS) ) {
+        bool storeLanczos = (int) lanczos.size() < RECYCLE_MAX_LANCZOS;
+        if ( storeLanczos ) {
+            BoundaryVector v = r;
+            double scale = 1. / sqrt( delta );
+            if ( lanczos.size() % 2 == 1 ) {
+                scale = -scale;
+            }
+            v *= scale;
+            lanczos.push_back( v );
+        }
         // alpha = r^2 / <d, Md>
         q = M(d);
         alpha = delta / InnerProduct( d, q );
-        x += alpha * d;
-        r -= alpha * q;
+        // x += alpha * d and r -= alpha * q, without forming temporaries
+        Kernels::Axpy( x.flatten(),  alpha, d.flatten(), x.getSize() );
+        Kernels::Axpy( r.flatten(), -alpha, q.flatten(), r.getSize() );
         delta_old = delta;
         delta = InnerProduct( r, r );
         beta = delta / delta_old;
+        if ( storeLanczos ) {
+            lanczosDiag.push_back( 1. / alpha + carry );
+            lanczosOff.push_back( sqrt( beta ) / alpha );
+        }
+        carry = beta / alpha;
         d = r + beta * d;
+        // Keep the new search direction M-conjugate to the recycled
+        // space, so the deflated modes stay deflated as rounding
+        // accumulates
+        if ( k > 0 ) {
+            for (int i=0; i<k; ++i) {
+                y[i] = InnerProduct( _recycleMW[i], r );
+            }
+            CholeskySolveSmall( _recycleGram, k, y );
+            for (int i=0; i<k; ++i) {
+                Kernels::Axpy( d.flatten(), -y[i],
+                               _recycleW[i].component(X), d.getSize() );
+            }
+        }
+        ++numIterations;
+    }
+    Timers::bumpBy( Timers::CG_ITERATIONS, numIterations );
+
+    // A slow solve means the recycled space (if any) no longer captures
+    // the slow modes; harvest a fresh one from this solve's Lanczos data
+    if ( numIterations >= RECYCLE_REBUILD_ITERATIONS &&
+         (int) lanczos.size() > RECYCLE_VECTORS ) {
+        rebuildRecycleSpace( lanczos, lanczosDiag, lanczosOff );
+    }
+
+    // save the converged solution to warm-start the next solve
+    _fPrev = x;
+    _fPrevSaved = true;
+}
+
+// Rebuild the recycled subspace.  The lowest Ritz pairs of the Lanczos
+// tridiagonal from the last solve approximate the slowly-converging
+// eigenvectors of M, which are the ones worth deflating from the next
+// solve.  The Ritz vectors are re-orthonormalized and the Gram matrix
+// W^T M W is recomputed exactly, at the cost of one application of M
+// per retained vector, so the Galerkin correction remains exact even
+// when the Ritz estimates are rough (as they are when a previous
+// recycle space was active during the solve)
+void ConjugateGradientSolver::rebuildRecycleSpace(
+    const vector<BoundaryVector>& lanczosVectors,
+    const vector<double>& diag,
+    const vector<double>& offdiag
+    ) {
+    int m = lanczosVectors.size();
+    int numKeep = ( RECYCLE_VECTORS < m-1 ) ? RECYCLE_VECTORS : m-1;
+    if ( numKeep < 1 ) return;
+
+    // Assemble the tridiagonal T and find its eigenpairs
+    vector<double> T( m*m, 0. );
+    for (int j=0; j<m; ++j) {
+        T[j*m+j] = diag[j];
+        if ( j < m-1 ) {
+            T[j*m+j+1] = offdiag[j];
+            T[(j+1)*m+j] = offdiag[j];
+        }
+    }
+    vector<double> eigval;
+    vector<double> Y;
+    JacobiEigenSmall( T, m, eigval, Y );
+
+    // Select the numKeep smallest Ritz values, by partial selection
+    // sort: m is tiny
+    vector<int> order( m );
+    for (int i=0; i<m; ++i) {
+        order[i] = i;
+    }
+    for (int i=0; i<numKeep; ++i) {
+        int best = i;
+        for (int j=i+1; j<m; ++j) {
+            if ( eigval[ order[j] ] < eigval[ order[best] ] ) {
+                best = j;
+            }
+        }
+        int tmp = order[i];
+        order[i] = order[best];
+        order[best] = tmp;
+    }
+
+    // Form the Ritz vectors and re-orthonormalize them by modified
+    // Gram-Schmidt, dropping any that degenerate
+    int numPoints = lanczosVectors[0].getNumPoints();
+    vector<BoundaryVector> W;
+    for (int i=0; i<numKeep; ++i) {
+        BoundaryVector w( numPoints );
+        w = 0.;
+        int col = order[i];
+        for (int j=0; j<m; ++j) {
+            Kernels::Axpy( w.flatten(), Y[j*m+col],
+                           lanczosVectors[j].component(X), w.getSize() );
+        }
+        for (unsigned int j=0; j<W.size(); ++j) {
+            double proj = InnerProduct( W[j], w );
+            Kernels::Axpy( w.flatten(), -proj,
+                           W[j].component(X), w.getSize() );
+        }
+        double norm = sqrt( InnerProduct( w, w ) );
+        if ( norm > 1e-10 ) {
+            w *= 1. / norm;
+            W.push_back( w );
+        }
+    }
+    if ( W.empty() ) return;
+
+    // One application of M per kept vector, and the exact Gram matrix
+    int k = W.size();
+    vector<BoundaryVector> MW;
+    for (int i=0; i<k; ++i) {
+        MW.push_back( M( W[i] ) );
+    }
+    vector<double> G( k*k );
+    for (int i=0; i<k; ++i) {
+        for (int j=0; j<k; ++j) {
+            G[i*k+j] = InnerProduct( W[i], MW[j] );
+        }
+    }
+    if ( ! CholeskyFactorSmall( G, k ) ) {
+        // M is positive definite, so a failed factorization means the
+        // candidate basis has degenerated; keep whatever was retained
+        // before rather than deflate with it
+        return;
+    }
+    _recycleW.swap( W );
+    _recycleMW.swap( MW );
+    _recycleGram.swap( G );
+}
+
+BlockConjugateGradientSolver::BlockConjugateGradientSolver(
+    const Grid& grid,
+    const NavierStokesModel& model,
+    double beta,
+    double tolerance
+    ) :
+    ProjectionSolver( grid, model, beta ),
+    _toleranceSquared( tolerance * tolerance )
+{}
+
+// A block of one: the single-system interface of ProjectionSolver
+void BlockConjugateGradientSolver::Minv(
+    const BoundaryVector& b,
+    BoundaryVector& x
+    ) {
+    vector<BoundaryVector> bBlock( 1, b );
+    vector<BoundaryVector> xBlock( 1, x );
+    solveBlock( bBlock, xBlock );
+    x = xBlock[0];
+}
+
+// Block conjugate gradient (O'Leary 1980).  Each iteration applies M
+// once per active column and couples the columns through the small
+// Gram systems over the block, so every column draws its update from
+// the whole block Krylov space and converges in far fewer iterations
+// than the columns run one at a time.  When a column converges it is
+// frozen out of the block and the directions restart from the
+// residuals of the reduced block, which also keeps the Gram systems
+// well conditioned; a failed factorization (a degenerated direction
+// block) triggers the same restart
+void BlockConjugateGradientSolver::solveBlock(
+    const vector<BoundaryVector>& b,
+    vector<BoundaryVector>& x
+    ) {
+    assert( b.size() == x.size() );
+    int numRhs = b.size();
+    if ( numRhs == 0 ) return;
+    int size = XY * b[0].getNumPoints();
+    int numIterations = 0;
+
+    // Residuals and search directions, one column per right-hand side
+    vector<BoundaryVector> r;
+    vector<BoundaryVector> p;
+    vector<BoundaryVector> q;
+    for (int i=0; i<numRhs; ++i) {
+        BoundaryVector ri = b[i];
+        BoundaryVector Mx = M( x[i] );
+        ri -= Mx;
+        r.push_back( ri );
+        p.push_back( ri );
+        q.push_back( ri );  // overwritten by M(p) each iteration
+    }
+
+    // Columns whose residual is still above tolerance
+    vector<int> act;
+    for (int i=0; i<numRhs; ++i) {
+        if ( Kernels::Dot( r[i].component(X), r[i].component(X), size )
+             > _toleranceSquared ) {
+            act.push_back( i );
+        }
+    }
+
+    bool freshDirections = true;
+    while ( ! act.empty() && numIterations < MAX_ITERATIONS ) {
+        int ka = act.size();
+        // All of the solve's cost is here: one application of M per
+        // active column
+        for (int a=0; a<ka; ++a) {
+            q[ act[a] ] = M( p[ act[a] ] );
+        }
+        // Factor the block Gram matrix P^T M P
+        vector<double> PtQ( ka*ka );
+        for (int a=0; a<ka; ++a) {
+            for (int c=0; c<ka; ++c) {
+                PtQ[a*ka+c] = Kernels::Dot( p[act[a]].component(X),
+                                            q[act[c]].component(X), size );
+            }
+        }
+        if ( ! CholeskyFactorSmall( PtQ, ka ) ) {
+            if ( freshDirections ) break;
+            for (int a=0; a<ka; ++a) {
+                p[ act[a] ] = r[ act[a] ];
+            }
+            freshDirections = true;
+            continue;
+        }
+        // alpha = (P^T M P)^{-1} P^T R, one small solve per column
+        vector<double> Alpha( ka*ka );
+        vector<double> col( ka );
+        for (int c=0; c<ka; ++c) {
+            for (int a=0; a<ka; ++a) {
+                col[a] = Kernels::Dot( p[act[a]].component(X),
+                                       r[act[c]].component(X), size );
+            }
+            CholeskySolveSmall( PtQ, ka, col );
+            for (int a=0; a<ka; ++a) {
+                Alpha[a*ka+c] = col[a];
+            }
+        }
+        // X += P alpha and R -= Q alpha
+        for (int c=0; c<ka; ++c) {
+            for (int a=0; a<ka; ++a) {
+                Kernels::Axpy( x[act[c]].flatten(),  Alpha[a*ka+c],
+                               p[act[a]].component(X), size );
+                Kernels::Axpy( r[act[c]].flatten(), -Alpha[a*ka+c],
+                               q[act[a]].component(X), size );
+            }
+        }
+        ++numIterations;
+
+        // Freeze converged columns out of the block
+        vector<int> actNew;
+        for (int a=0; a<ka; ++a) {
+            int i = act[a];
+            if ( Kernels::Dot( r[i].component(X), r[i].component(X), size )
+                 > _toleranceSquared ) {
+                actNew.push_back( i );
+            }
+        }
+        if ( (int) actNew.size() < ka ) {
+            act.swap( actNew );
+            for (unsigned int a=0; a<act.size(); ++a) {
+                p[ act[a] ] = r[ act[a] ];
+            }
+            freshDirections = true;
+            continue;
+        }
+
+        // P = R - P gamma, with gamma = (P^T M P)^{-1} Q^T R chosen to
+        // keep the new directions M-conjugate to the old block; the
+        // factor of P^T M P is reused from the alpha solve
+        vector<double> Gamma( ka*ka );
+        for (int c=0; c<ka; ++c) {
+            for (int a=0; a<ka; ++a) {
+                col[a] = Kernels::Dot( q[act[a]].component(X),
+                                       r[act[c]].component(X), size );
+            }
+            CholeskySolveSmall( PtQ, ka, col );
+            for (int a=0; a<ka; ++a) {
+                Gamma[a*ka+c] = col[a];
+            }
+        }
+        vector<BoundaryVector> pOld;
+        for (int a=0; a<ka; ++a) {
+            pOld.push_back( p[ act[a] ] );
+        }
+        for (int c=0; c<ka; ++c) {
+            p[ act[c] ] = r[ act[c] ];
+            for (int a=0; a<ka; ++a) {
+                Kernels::Axpy( p[act[c]].flatten(), -Gamma[a*ka+c],
+                               pOld[a].component(X), size );
+            }
+        }
+        freshDirections = false;
     }
+    Timers::bumpBy( Timers::CG_ITERATIONS, numIterations );
 }
 
 } // namespace ibpm
@@ -2,12 +2,14 @@
 #define _CONJUGATEGRADIENTSOLVER_H_
 
 #include <math.h>
+#include <vector>
+#include "BoundaryVector.h"
+#include "CholeskySolver.h"
 
 namespace ibpm {
 
 class ProjectionSolver;
 class NavierStokesModel;
-class BoundaryVector;
 
 /*!
     \file ConjugateGradientSolver.h
@@ -18,6 +20,16 @@ class BoundaryVector;
     This class assumes the matrix M is symmetric, and iterates until a
     specified tolerance has been reached.
 
+    Successive solves in a time-stepping run share spectral structure:
+    the dominant eigenvectors of M drift slowly as the bodies move.  In
+    addition to warm-starting from the previous converged solution, the
+    solver therefore recycles a small approximate eigenspace of M across
+    solves, harvested from the Lanczos coefficients of a slow solve, and
+    deflates it from subsequent ones: the initial residual is corrected
+    over the retained space and new search directions are kept
+    M-conjugate to it, so the iteration never re-converges the slow
+    modes it has already seen.
+
     \author Clancy Rowley
     \author $LastChangedBy$
     \date  9 Aug 2008
@@ -44,6 +56,14 @@ public:
         return sqrt(_toleranceSquared);
     }
 
+    /// \brief Write the warm-start solution and the recycled subspace
+    /// (basis, images under M, and Gram factor), so a resumed run
+    /// iterates exactly as the original would have
+    virtual bool saveRunState( FILE* fp );
+
+    /// \brief Read the state written by saveRunState
+    virtual bool loadRunState( FILE* fp );
+
 protected:
     /// \brief Solve Mf = b for f iteratively, using a conjugate-gradient method.
     /// Assumes M is symmetric
@@ -52,6 +72,119 @@ protected:
         BoundaryVector& x
     );
 
+private:
+    double _toleranceSquared;
+    // Converged solution from this solver's previous solve.  Each solver
+    // instance serves a single substep (fixed beta), and the force varies
+    // smoothly in time, so it makes a good initial iterate
+    BoundaryVector _fPrev;
+    bool _fPrevSaved;
+
+    /// \brief Rebuild the recycled subspace from the Lanczos vectors and
+    /// tridiagonal coefficients accumulated during a slow solve
+    void rebuildRecycleSpace(
+        const std::vector<BoundaryVector>& lanczosVectors,
+        const std::vector<double>& diag,
+        const std::vector<double>& offdiag
+    );
+
+    // Recycled approximate eigenspace of M, deflated from subsequent
+    // solves (see Minv): the basis vectors W, their images MW under M,
+    // and the Cholesky factor of the small Gram matrix W^T M W
+    std::vector<BoundaryVector> _recycleW;
+    std::vector<BoundaryVector> _recycleMW;
+    std::vector<double> _recycleGram;
+};
+
+/*!
+    \class PreconditionedConjugateGradientSolver
+
+    \brief Conjugate gradient preconditioned by a reference Cholesky
+    factor, for moving geometry.
+
+    The factor of M at the body positions seen at init() is used as an
+    approximate inverse inside the CG iteration.  When the bodies move
+    only moderately from the reference configuration the preconditioned
+    iteration converges in a few steps, each costing one application of
+    M plus two triangular substitutions, instead of the 60-100 plain CG
+    iterations a moving-body substep typically needs.  Subclasses may
+    override applyPreconditioner to substitute a different approximate
+    inverse.
+*/
+class PreconditionedConjugateGradientSolver : public CholeskySolver {
+public:
+
+    PreconditionedConjugateGradientSolver(
+        const Grid& grid,
+        const NavierStokesModel& model,
+        double beta,
+        double tolerance
+    );
+
+    inline void setTolerance(double tolerance) {
+        _toleranceSquared = tolerance * tolerance;
+    }
+
+protected:
+    /// \brief Apply the preconditioner: z = (approximate inverse of M) r.
+    /// By default, substitution with the reference Cholesky factor
+    virtual void applyPreconditioner( const BoundaryVector& r, BoundaryVector& z );
+
+    /// \brief Solve Mf = b for f at the current body positions, by
+    /// preconditioned conjugate gradient
+    void Minv(
+        const BoundaryVector& b,
+        BoundaryVector& x
+    );
+
+private:
+    double _toleranceSquared;
+};
+
+/*!
+    \class BlockConjugateGradientSolver
+
+    \brief Conjugate gradient over a block of right-hand sides that
+    share the operator M.
+
+    Batched linearized and ensemble runs generate simultaneous force
+    systems M f_i = b_i against the same operator.  Block CG iterates
+    all of them together, drawing every column's update from the shared
+    block Krylov space, which converges in substantially fewer
+    iterations than the columns solved one at a time — and applications
+    of M are the entire cost of a solve.  Columns are frozen out of the
+    block as they converge, which also keeps the small Gram systems
+    well conditioned.
+*/
+class BlockConjugateGradientSolver : public ProjectionSolver {
+public:
+
+    BlockConjugateGradientSolver(
+        const Grid& grid,
+        const NavierStokesModel& model,
+        double beta,
+        double tolerance
+    );
+
+    /// \brief Solve M f_i = b_i for all right-hand sides of the block
+    /// together.  b and x must have the same length, and each x_i is
+    /// used as the initial iterate for its column
+    void solveBlock(
+        const std::vector<BoundaryVector>& b,
+        std::vector<BoundaryVector>& x
+    );
+
+    inline void setTolerance(double tolerance) {
+        _toleranceSquared = tolerance * tolerance;
+    }
+
+protected:
+    /// \brief Single right-hand side: a block of one
+    void Minv(
+        const BoundaryVector& b,
+        BoundaryVector& x
+    );
+
 private:
     double _toleranceSquared;
 };
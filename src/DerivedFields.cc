@@ -0,0 +1,44 @@
+// DerivedFields.cc
+//
+// Description:
+// Implementation of the per-step cache of derived fields for outputs.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 22 Aug 2008
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "DerivedFields.h"
+#include "State.h"
+#include "VectorOperations.h"
+
+namespace ibpm {
+
+Scalar DerivedFields::_u;
+Scalar DerivedFields::_v;
+int DerivedFields::_timestep = 0;
+double DerivedFields::_time = 0.;
+bool DerivedFields::_valid = false;
+
+void DerivedFields::getVelocities( const State& x,
+                                   const Scalar*& u, const Scalar*& v ) {
+    const Grid& grid = x.omega.getGrid();
+    if ( ! _valid || _timestep != x.timestep || _time != x.time ||
+         ! _u.getGrid().isEqualTo( grid ) ) {
+        _u.resize( grid );
+        _v.resize( grid );
+        FluxToVelocity( x.q, _u, _v );
+        _timestep = x.timestep;
+        _time = x.time;
+        _valid = true;
+    }
+    u = &_u;
+    v = &_v;
+}
+
+} // namespace ibpm
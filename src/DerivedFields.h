@@ -0,0 +1,52 @@
+#ifndef _DERIVEDFIELDS_H_
+#define _DERIVEDFIELDS_H_
+
+#include "Scalar.h"
+
+namespace ibpm {
+
+class State;
+
+/*!
+\file DerivedFields.h
+\class DerivedFields
+
+\brief Per-step cache of fields derived from a State, for output routines
+
+Several output routines need the velocity components of the current
+state (Tecplot files, probes), and each used to recompute them with its
+own sweep over the fluxes.  This cache computes the derived fields
+lazily, on the first request of an output step, and shares them: the
+cached copies are reused as long as the requesting state's timestep and
+time match the ones they were computed from.
+
+Outputs run sequentially (on the writer thread, when output is
+asynchronous), so no locking is needed.
+
+\author Clancy Rowley
+\date 22 Aug 2008
+
+\author $LastChangedBy$
+\date $LastChangedDate$
+\version $Revision$
+*/
+
+class DerivedFields {
+public:
+    /// \brief Return the velocity components of x, recomputing them only
+    /// when x differs from the state they were last computed from.
+    /// The returned pointers stay valid until the next call.
+    static void getVelocities( const State& x,
+                               const Scalar*& u, const Scalar*& v );
+
+private:
+    static Scalar _u;
+    static Scalar _v;
+    static int _timestep;       // step the cached fields belong to
+    static double _time;
+    static bool _valid;
+};
+
+} // namespace ibpm
+
+#endif /* _DERIVEDFIELDS_H_ */
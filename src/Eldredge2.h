@@ -45,30 +45,39 @@ public:
         cout << " not here" << endl;
         _maxG = log((cosh(_a*(tt-_t1))*cosh(_a*(tt-_t4)))/(cosh(_a*(tt-_t2))*cosh(_a*(tt-_t3))));
 //        _maxG = log((cosh(_a*(tt-t1)))/(cosh(_a*(tt-_t2))));
+        _cacheValid = false;
+        _cachedTime = 0.;
+        _cachedG = 0.;
     }
-    
+
     /// Returns transformation for sinusoidal pitch/plunge:
     ///    (0, 0, theta(t), 0, 0, thetadot(t))
     inline TangentSE2 getTransformation(double time) const {
-        double t1d = time-_t1;
-        double t2d = time-_t2;
-        double t3d = time-_t3;
-        double t4d = time-_t4;
-        double G,dGdt;
-        double Garg = ((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
-        G = log(Garg);
-        //G = log((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
-        dGdt = _a*(tanh(_a*t1d)-tanh(_a*t2d)-tanh(_a*t3d)+tanh(_a*t4d));
+        // G is memoized: repeated queries at the same time (position and
+        // velocity, every substep) skip the cosh/log evaluations, and
+        // leave the integral of G unchanged (dtt would be zero)
+        if ( !_cacheValid || time != _cachedTime ) {
+            double t1d = time-_t1;
+            double t2d = time-_t2;
+            double t3d = time-_t3;
+            double t4d = time-_t4;
+            double Garg = ((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
+            double G = log(Garg);
+            //G = log((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
 
-        // The following is a hack to compute integral of G so that I can step vertical velocity...
-        double dtt = time-_oldtime;
-        _intG = _intG + G*dtt;
-        _oldtime = time;
-        cout << "dtt = " << dtt << endl;
-        cout << "intG = " << _intG << endl;
-        cout << "G = " << G*_AMP/_maxG << endl;
-        cout << "intG*stuff = " << _intG*_AMP/_maxG << endl;
-        return TangentSE2( 0, _intG*_AMP/_maxG, 0, 0, G*_AMP/_maxG, 0 );
+            // The following is a hack to compute integral of G so that I can step vertical velocity...
+            double dtt = time-_oldtime;
+            _intG = _intG + G*dtt;
+            _oldtime = time;
+            cout << "dtt = " << dtt << endl;
+            cout << "intG = " << _intG << endl;
+            cout << "G = " << G*_AMP/_maxG << endl;
+            cout << "intG*stuff = " << _intG*_AMP/_maxG << endl;
+            _cachedG = G;
+            _cachedTime = time;
+            _cacheValid = true;
+        }
+        return TangentSE2( 0, _intG*_AMP/_maxG, 0, 0, _cachedG*_AMP/_maxG, 0 );
     }
 
     inline Motion* clone() const {
@@ -92,6 +101,10 @@ private:
     double _maxG;
     mutable double _intG;
     mutable double _oldtime;
+    // memoized values of the most recent query
+    mutable bool _cacheValid;
+    mutable double _cachedTime;
+    mutable double _cachedG;
 };
 
 } // namespace ibpm
@@ -57,34 +57,49 @@ public:
         _oldtime = 0.;
         _maxGa = log((cosh(_a*(tta-_a1))*cosh(_a*(tta-_a4)))/(cosh(_a*(tta-_a2))*cosh(_a*(tta-_a3))));
         _maxGb = log((cosh(_b*(ttb-_b1))*cosh(_a*(ttb-_b4)))/(cosh(_b*(ttb-_b2))*cosh(_b*(ttb-_b3))));
+        double pi = 4. * atan(1.);
+        _AMPrad = _AMPb*(pi/180);
+        _cacheValid = false;
+        _cachedTime = 0.;
+        _cachedGa = 0.;
+        _cachedGb = 0.;
+        _cacheddGdtb = 0.;
     }
-    
+
     /// Returns transformation for sinusoidal pitch/plunge:
     ///    (0, h(t), theta(t), 0, hdot(t), thetadot(t))
     inline TangentSE2 getTransformation(double time) const {
-        double pi = 4. * atan(1.);
-        double AMPrad = _AMPb*(pi/180);
-        double a1d = time-_a1;
-        double a2d = time-_a2;
-        double a3d = time-_a3;
-        double a4d = time-_a4;
-        double b1d = time-_b1;
-        double b2d = time-_b2;
-        double b3d = time-_b3;
-        double b4d = time-_b4;
-        double Ga,Gb,dGdtb;
-        double Garga = ((cosh(_a*a1d)*cosh(_a*a4d))/(cosh(_a*a2d)*cosh(_a*a3d)));
-        double Gargb = ((cosh(_b*b1d)*cosh(_b*b4d))/(cosh(_b*b2d)*cosh(_b*b3d)));
-        Ga = log(Garga);
-        Gb = log(Gargb);
-        dGdtb = _b*(tanh(_b*b1d)-tanh(_b*b2d)-tanh(_b*b3d)+tanh(_b*b4d));
+        // Ga, Gb, and dGdtb are memoized: repeated queries at the same
+        // time (position and velocity, every substep) skip the
+        // cosh/log/tanh evaluations, and leave the integral of Ga
+        // unchanged (dtt would be zero)
+        if ( !_cacheValid || time != _cachedTime ) {
+            double a1d = time-_a1;
+            double a2d = time-_a2;
+            double a3d = time-_a3;
+            double a4d = time-_a4;
+            double b1d = time-_b1;
+            double b2d = time-_b2;
+            double b3d = time-_b3;
+            double b4d = time-_b4;
+            double Garga = ((cosh(_a*a1d)*cosh(_a*a4d))/(cosh(_a*a2d)*cosh(_a*a3d)));
+            double Gargb = ((cosh(_b*b1d)*cosh(_b*b4d))/(cosh(_b*b2d)*cosh(_b*b3d)));
+            double Ga = log(Garga);
+            _cachedGb = log(Gargb);
+            _cacheddGdtb = _b*(tanh(_b*b1d)-tanh(_b*b2d)-tanh(_b*b3d)+tanh(_b*b4d));
 
-        // The following is a hack to compute integral of G so that I can step vertical velocity...
-        double dtt = time-_oldtime;
-        _intG = _intG + Ga*dtt;
-        _oldtime = time;
+            // The following is a hack to compute integral of G so that I can step vertical velocity...
+            double dtt = time-_oldtime;
+            _intG = _intG + Ga*dtt;
+            _oldtime = time;
+            _cachedGa = Ga;
+            _cachedTime = time;
+            _cacheValid = true;
+        }
 
-        return TangentSE2( 0, _intG*_AMPa/_maxGa, Gb*AMPrad/_maxGb, 0, Ga*_AMPa/_maxGa, dGdtb*AMPrad/_maxGb );
+        return TangentSE2( 0, _intG*_AMPa/_maxGa, _cachedGb*_AMPrad/_maxGb,
+                           0, _cachedGa*_AMPa/_maxGa,
+                           _cacheddGdtb*_AMPrad/_maxGb );
     }
 
     inline Motion* clone() const {
@@ -119,8 +134,15 @@ private:
     double _b4;
     double _maxGa;
     double _maxGb;
+    double _AMPrad;     // pitch amplitude in radians, computed once
     mutable double _intG;
     mutable double _oldtime;
+    // memoized values of the most recent query
+    mutable bool _cacheValid;
+    mutable double _cachedTime;
+    mutable double _cachedGa;
+    mutable double _cachedGb;
+    mutable double _cacheddGdtb;
 };
 
 } // namespace ibpm
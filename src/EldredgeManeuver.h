@@ -41,24 +41,34 @@ public:
         double tt = (_t2+_t3)/2.;
         _maxG = log((cosh(_a*(tt-_t1))*cosh(_a*(tt-_t4)))/(cosh(_a*(tt-_t2))*cosh(_a*(tt-_t3))));
 //        _maxG = log((cosh(_a*(tt-t1)))/(cosh(_a*(tt-_t2))));
+        double pi = 4. * atan(1.);
+        _AMPrad = _AMP*(pi/180);
+        _cacheValid = false;
+        _cachedTime = 0.;
+        _cachedG = 0.;
+        _cacheddGdt = 0.;
     }
-    
+
     /// Returns transformation for sinusoidal pitch/plunge:
     ///    (0, 0, theta(t), 0, 0, thetadot(t))
     inline TangentSE2 getTransformation(double time) const {
-        double pi = 4. * atan(1.);
-        double AMPrad = _AMP*(pi/180); 
-        double t1d = time-_t1;
-        double t2d = time-_t2;
-        double t3d = time-_t3;
-        double t4d = time-_t4;
-        double G,dGdt;
-        double Garg = ((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
-        G = log(Garg);
-        //G = log((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
-        dGdt = _a*(tanh(_a*t1d)-tanh(_a*t2d)-tanh(_a*t3d)+tanh(_a*t4d));
+        // G and dGdt are memoized: repeated queries at the same time
+        // (position and velocity, every substep) skip the cosh/log/tanh
+        // evaluations
+        if ( !_cacheValid || time != _cachedTime ) {
+            double t1d = time-_t1;
+            double t2d = time-_t2;
+            double t3d = time-_t3;
+            double t4d = time-_t4;
+            double Garg = ((cosh(_a*t1d)*cosh(_a*t4d))/(cosh(_a*t2d)*cosh(_a*t3d)));
+            _cachedG = log(Garg);
+            _cacheddGdt = _a*(tanh(_a*t1d)-tanh(_a*t2d)-tanh(_a*t3d)+tanh(_a*t4d));
+            _cachedTime = time;
+            _cacheValid = true;
+        }
 
-        return TangentSE2( 0, 0, G*AMPrad/_maxG, 0, 0, dGdt*AMPrad/_maxG );
+        return TangentSE2( 0, 0, _cachedG*_AMPrad/_maxG,
+                           0, 0, _cacheddGdt*_AMPrad/_maxG );
     }
 
     inline Motion* clone() const {
@@ -80,6 +90,12 @@ private:
     double _t3;
     double _t4;
     double _maxG;
+    double _AMPrad;     // amplitude in radians, computed once
+    // memoized values of the most recent query
+    mutable bool _cacheValid;
+    mutable double _cachedTime;
+    mutable double _cachedG;
+    mutable double _cacheddGdt;
 };
 
 } // namespace ibpm
@@ -14,6 +14,7 @@
 // $HeadURL$
 
 #include "EllipticSolver.h"
+#include "MultigridSolver2d.h"
 #include <math.h>
 
 
@@ -21,6 +22,19 @@ namespace ibpm {
 
 typedef EllipticSolver2d::Array2d Array2d;
 
+namespace {
+    // Backend for 2d solvers created by the factories below
+    bool _useMultigrid = false;
+}
+
+void EllipticSolver::setUseMultigrid( bool useMultigrid ) {
+    _useMultigrid = useMultigrid;
+}
+
+bool EllipticSolver::getUseMultigrid() {
+    return _useMultigrid;
+}
+
 EllipticSolver::EllipticSolver( const Grid& grid ) :
     _ngrid( grid.Ngrid() ),
     _dx( grid.Dx() ),
@@ -49,11 +63,23 @@ void EllipticSolver::solve( const Scalar& f, Scalar& u ) const {
     assert( f.Ngrid() == u.Ngrid() );
     assert( f.Nx() == u.Nx() );
     assert( f.Ny() == u.Ny() );
-    
+
+    // Single-domain fast path: no coarsification and no boundary
+    // interpolation, so the right-hand side passes straight to the 2d
+    // solver with no copy
+    if ( _ngrid == 1 ) {
+        Array2d u1 = u[0];
+        _solvers[0]->solve( f[0], u1 );
+        return;
+    }
+
     // First "coarsify" right-hand side (f) to coarse grids
     Scalar rhs = f;
     rhs.coarsify();
-    // Solve coarsest grid first, then finer grids
+    // Solve coarsest grid first, then finer grids.  Unlike the curl,
+    // each finer level needs boundary values interpolated from the
+    // coarser *solution*, so the levels here cannot run concurrently;
+    // parallelism comes from the threaded transforms within each solve
     for (int lev = f.Ngrid() - 1; lev >= 0; --lev ) {
         // Get slices of input and output data at current grid level
         Array2d rhs1 = rhs[lev];
@@ -89,6 +115,9 @@ PoissonSolver::PoissonSolver( const Grid& grid ) :
 }
 
 EllipticSolver2d* PoissonSolver::create2dSolver( double dx ) {
+    if ( _useMultigrid ) {
+        return new MultigridPoissonSolver2d( _nx, _ny, dx );
+    }
     return new PoissonSolver2d( _nx, _ny, dx );
 }
 
@@ -104,6 +133,9 @@ HelmholtzSolver::HelmholtzSolver( const Grid& grid, double alpha ) :
 }
 
 EllipticSolver2d* HelmholtzSolver::create2dSolver( double dx ) {
+    if ( _useMultigrid ) {
+        return new MultigridHelmholtzSolver2d( _nx, _ny, dx, _alpha );
+    }
     return new HelmholtzSolver2d( _nx, _ny, dx, _alpha );
 }
     
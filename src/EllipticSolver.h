@@ -32,6 +32,16 @@ public:
     void solve( const Scalar& f, Scalar& u ) const;
     /// \brief Convenience form
     Scalar solve( const Scalar& f ) const;
+
+    /// \brief Select the backend for subsequently created solvers: if
+    /// true, create2dSolver returns geometric multigrid solvers (see
+    /// MultigridSolver2d.h) instead of the direct sin-transform solvers.
+    /// Multigrid solves are warm-started from the previous substep and
+    /// iterate to a tolerance (Multigrid2d::setDefaultTolerance)
+    static void setUseMultigrid( bool useMultigrid );
+
+    /// \brief Return true if multigrid solvers are currently selected
+    static bool getUseMultigrid();
 protected:
     virtual EllipticSolver2d* create2dSolver( double dx ) = 0;
     void init();
@@ -14,86 +14,366 @@
 // $HeadURL$
 
 #include "EllipticSolver2d.h"
+#include "Threads.h"
+#include "Timers.h"
+#include "Memory.h"
 #include "VectorOperations.h"
 #include <math.h>
+#include <list>
+#include <pthread.h>
 
 namespace ibpm {
-    
+
+namespace {
+    // File used to cache FFTW wisdom across runs; empty disables the cache.
+    // FFTW keys wisdom internally by transform size and thread count, so a
+    // single file covers all grid levels and substep solvers.
+    std::string _wisdomFile;
+    bool _wisdomImported = false;
+
+    // Precision applied to subsequently created solvers (see
+    // setSinglePrecision / setDefectCorrection)
+    bool _singlePrecisionMode = false;
+    bool _defectCorrectionMode = true;
+
+    // Shared FFTW plans, scratch buffers, and Laplacian eigenvalue
+    // tables, keyed by transform size.  All levels of a multi-domain
+    // grid, and all substep solvers built on it, use transforms of
+    // identical dimensions, so the (expensive) planning step and the
+    // eigenvalue table are shared per size rather than duplicated per
+    // solver.  (The eigenvalues at grid spacing dx are those at unit
+    // spacing divided by dx^2, so one table serves every level and every
+    // substep.)  Levels cannot share a single batched transform call,
+    // since each finer level needs boundary values from the coarser
+    // solution before its forward transform.
+    struct PlanCacheEntry {
+        int nx;
+        int ny;
+        int refCount;
+        // Double- and single-precision sides are created independently,
+        // on first request; unused sides stay NULL
+        double* buffer;
+        double* laplacianEig;
+        fftw_plan plan;
+        float* bufferF;
+        float* laplacianEigF;
+        fftwf_plan planF;
+    };
+    std::list<PlanCacheEntry> _planCache;
+
+    // Solvers may be constructed and destroyed from worker threads (see
+    // the ensemble driver in ibpm.cc), and FFTW planning itself is not
+    // thread safe, so the cache is serialized; plan execution on caller
+    // arrays needs no lock
+    pthread_mutex_t _planCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+    // Eigenvalue of the Laplacian at unit grid spacing, for wavenumber
+    // (i,j) on an (nx x ny)-cell grid
+    double laplacianEigenvalue( int nx, int ny, int i, int j ) {
+        double pi = 4. * atan(1.0);
+        return 2. * ( cos( (pi * i) / nx ) + cos( (pi * j) / ny ) - 2. );
+    }
+
+    // Return the shared resources for transforms of the given size and
+    // precision, creating them on first use.  The associated buffer is
+    // used only for planning: solves execute the plan directly on the
+    // caller's arrays.  Caller holds _planCacheMutex.
+    const PlanCacheEntry& acquirePlan( int nx, int ny, bool wantFloat ) {
+        std::list<PlanCacheEntry>::iterator it;
+        PlanCacheEntry* entry = NULL;
+        for (it = _planCache.begin(); it != _planCache.end(); ++it) {
+            if ( it->nx == nx && it->ny == ny ) {
+                ++it->refCount;
+                entry = &*it;
+                break;
+            }
+        }
+        if ( entry == NULL ) {
+            PlanCacheEntry newEntry;
+            newEntry.nx = nx;
+            newEntry.ny = ny;
+            newEntry.refCount = 1;
+            newEntry.buffer = NULL;
+            newEntry.laplacianEig = NULL;
+            newEntry.plan = NULL;
+            newEntry.bufferF = NULL;
+            newEntry.laplacianEigF = NULL;
+            newEntry.planF = NULL;
+            _planCache.push_back( newEntry );
+            entry = &_planCache.back();
+        }
+        if ( !_wisdomFile.empty() && !_wisdomImported ) {
+            fftw_import_wisdom_from_filename( _wisdomFile.c_str() );
+            _wisdomImported = true;
+        }
+        if ( !wantFloat && entry->plan == NULL ) {
+            entry->buffer = new double[ (nx-1) * (ny-1) ];
+            Memory::recordAlloc( Memory::FFT,
+                2 * (nx-1) * (ny-1) * sizeof(double) );
+            // Eigenvalues of the Laplacian at unit grid spacing, with
+            // index (i,j) at entry (i-1)*(ny-1) + (j-1), i,j starting at 1
+            entry->laplacianEig = new double[ (nx-1) * (ny-1) ];
+            for (int i=1; i < nx; ++i ) {
+                for (int j=1; j < ny; ++j ) {
+                    entry->laplacianEig[ (i-1)*(ny-1) + (j-1) ] =
+                        laplacianEigenvalue( nx, ny, i, j );
+                }
+            }
+            entry->plan = fftw_plan_r2r_2d( nx-1, ny-1,
+                entry->buffer, entry->buffer,
+                FFTW_RODFT00, FFTW_RODFT00, FFTW_EXHAUSTIVE);
+        }
+        if ( wantFloat && entry->planF == NULL ) {
+            entry->bufferF = new float[ (nx-1) * (ny-1) ];
+            Memory::recordAlloc( Memory::FFT,
+                2 * (nx-1) * (ny-1) * sizeof(float) );
+            entry->laplacianEigF = new float[ (nx-1) * (ny-1) ];
+            for (int i=1; i < nx; ++i ) {
+                for (int j=1; j < ny; ++j ) {
+                    entry->laplacianEigF[ (i-1)*(ny-1) + (j-1) ] =
+                        (float) laplacianEigenvalue( nx, ny, i, j );
+                }
+            }
+            entry->planF = fftwf_plan_r2r_2d( nx-1, ny-1,
+                entry->bufferF, entry->bufferF,
+                FFTW_RODFT00, FFTW_RODFT00, FFTW_EXHAUSTIVE);
+        }
+        if ( !_wisdomFile.empty() ) {
+            fftw_export_wisdom_to_filename( _wisdomFile.c_str() );
+        }
+        return *entry;
+    }
+
+    // Release a reference to shared resources, destroying them when no
+    // solvers use them any longer.  Caller holds _planCacheMutex.
+    void releasePlan( int nx, int ny ) {
+        std::list<PlanCacheEntry>::iterator it;
+        for (it = _planCache.begin(); it != _planCache.end(); ++it) {
+            if ( it->nx == nx && it->ny == ny ) {
+                if ( --it->refCount == 0 ) {
+                    if ( it->plan != NULL ) {
+                        fftw_destroy_plan( it->plan );
+                        delete[] it->buffer;
+                        delete[] it->laplacianEig;
+                        Memory::recordFree( Memory::FFT,
+                            2 * (it->nx-1) * (it->ny-1) * sizeof(double) );
+                    }
+                    if ( it->planF != NULL ) {
+                        fftwf_destroy_plan( it->planF );
+                        delete[] it->bufferF;
+                        delete[] it->laplacianEigF;
+                        Memory::recordFree( Memory::FFT,
+                            2 * (it->nx-1) * (it->ny-1) * sizeof(float) );
+                    }
+                    _planCache.erase( it );
+                }
+                return;
+            }
+        }
+    }
+}
+
+void EllipticSolver2d::setWisdomFile( const std::string& filename ) {
+    _wisdomFile = filename;
+    _wisdomImported = false;
+}
+
+void EllipticSolver2d::setSinglePrecision( bool singlePrecision ) {
+    _singlePrecisionMode = singlePrecision;
+}
+
+void EllipticSolver2d::setDefectCorrection( bool defectCorrection ) {
+    _defectCorrectionMode = defectCorrection;
+}
+
+void EllipticSolver2d::warmPlanCache( int nx, int ny ) {
+#ifdef IBPM_FFTW_THREADS
+    static bool fftwThreadsInitialized = false;
+    if ( ! fftwThreadsInitialized ) {
+        fftw_init_threads();
+        fftwThreadsInitialized = true;
+    }
+    fftw_plan_with_nthreads( GetKernelThreads( KERNEL_FFT ) );
+#endif
+    pthread_mutex_lock( &_planCacheMutex );
+    // The reference is deliberately never released: the plan for this
+    // size stays alive for the rest of the run, including across solver
+    // teardown and rebuild (e.g. the adaptive-timestep solver cache)
+    acquirePlan( nx, ny, _singlePrecisionMode );
+    pthread_mutex_unlock( &_planCacheMutex );
+}
+
 //------------------------------------------------------------------------------
 // Elliptic solver (abstract base class)
 //------------------------------------------------------------------------------
 
-    EllipticSolver2d::EllipticSolver2d( int nx, int ny, double dx ) :
-        // Need only interior points, so e-values are nx-1 by ny-1
-        // 2D array of eigenvalues has indices that starts at 1
-        _eigenvaluesOfInverse( nx-1, ny-1, 1, 1 ),
-        _fft( nx-1, ny-1, 1, 1 ) {
+    EllipticSolver2d::EllipticSolver2d( int nx, int ny, double dx ) {
         _nx = nx;
         _ny = ny;
         _dx = dx;
-        _FFTWPlan = fftw_plan_r2r_2d( nx-1, ny-1, _fft, _fft,
-            FFTW_RODFT00, FFTW_RODFT00, FFTW_EXHAUSTIVE);
+        // Subclasses overwrite these; identity until they do
+        _c0 = 1.;
+        _c1 = 0.;
+        // Precision is fixed per solver, from the process-wide setting
+        // at construction time
+        _singlePrecision = _singlePrecisionMode;
+        _defectCorrection = _defectCorrectionMode;
+        // Plan acquisition is deferred to the first transform (see
+        // initTransform), so subclasses that never call the transform
+        // solve never trigger FFTW planning
+        _planAcquired = false;
+        _FFTWPlan = NULL;
+        _laplacianEig = NULL;
+        _FFTWPlanF = NULL;
+        _laplacianEigF = NULL;
     }
-    
+
     EllipticSolver2d::~EllipticSolver2d() {
-        fftw_destroy_plan( _FFTWPlan );
-    }
-    
-    EllipticSolver2d::Array2d EllipticSolver2d::getLaplacianEigenvalues() const {
-        // calculate eigenvalues of Laplacian
-        double pi = 4. * atan(1.0);
-        double bydx2 = 1. / (_dx * _dx);
-        Array2d eig( _nx-1, _ny-1, 1, 1 );
-        for (int i=1; i < _nx; ++i ) {
-            for (int j=1; j < _ny; ++j ) {
-                eig(i,j) = 2. * ( cos( (pi * i) / _nx ) + 
-                                 cos( (pi * j) / _ny ) - 2. ) * bydx2;
-            }
+        if ( _planAcquired ) {
+            pthread_mutex_lock( &_planCacheMutex );
+            releasePlan( _nx, _ny );
+            pthread_mutex_unlock( &_planCacheMutex );
         }
-        return eig;
     }
-    
-    // Take discrete sin transform of u, leaving result in v
-    void EllipticSolver2d::sinTransform( const Array2d& u, Array2d& v ) const {
-        assert( u.Size() == v.Size() );
-        
-        // copy input array to FFTW array
-        for (unsigned int i = 0; i < u.Size(); ++i ) {
-            _fft(i) = u(i);
+
+    // Acquire the shared plan and eigenvalue table on first use
+    void EllipticSolver2d::initTransform() const {
+#ifdef IBPM_FFTW_THREADS
+        // Initialize the FFTW threading layer the first time a solver is
+        // created, and plan with the runtime thread count (see Threads.h),
+        // so that both transforms in each solve use multiple threads
+        static bool fftwThreadsInitialized = false;
+        if ( ! fftwThreadsInitialized ) {
+            fftw_init_threads();
+            fftwThreadsInitialized = true;
         }
-        
-        fftw_execute( _FFTWPlan ); 
-        
-        // copy back to output array
-        for (unsigned int i = 0; i < u.Size(); ++i) {
-            v(i) = _fft(i);
+        fftw_plan_with_nthreads( GetKernelThreads( KERNEL_FFT ) );
+#endif
+        pthread_mutex_lock( &_planCacheMutex );
+        if ( ! _planAcquired ) {
+            const PlanCacheEntry& shared =
+                acquirePlan( _nx, _ny, _singlePrecision );
+            if ( _singlePrecision ) {
+                _FFTWPlanF = shared.planF;
+                _laplacianEigF = shared.laplacianEigF;
+            }
+            else {
+                _FFTWPlan = shared.plan;
+                _laplacianEig = shared.laplacianEig;
+            }
+            _planAcquired = true;
         }
+        pthread_mutex_unlock( &_planCacheMutex );
     }
-    
-    // Take inverse sin transform of u, leaving result in v
-    // Note that inverse is the same as the forward transform, except for a
-    // normalization factor
-    void EllipticSolver2d::sinTransformInv( const Array2d& u, Array2d& v )
-    const {
-        assert( u.Size() == v.Size() );
-        sinTransform( u, v );
-        double normalizationFactor = 1. / (2 * _nx * 2 * _ny);
-        for (unsigned int i=0; i < v.Size(); ++i ) {
-            v(i) *= normalizationFactor;
+
+    // Take discrete sin transform of u in place, executing the shared plan
+    // directly on u's storage (the inverse transform is the same, up to a
+    // normalization factor, folded into the eigenvalue multiply in solve)
+    void EllipticSolver2d::sinTransformInPlace( Array2d& u ) const {
+        if ( ! _planAcquired ) {
+            initTransform();
         }
+        Timers::bump( Timers::FFT_EXECUTIONS );
+        fftw_execute_r2r( _FFTWPlan, &u(0), &u(0) );
     }
     
-    // Solve L u = f, single domain, assuming zero boundary conditions on u
+    // Solve L u = f, single domain, assuming zero boundary conditions on u.
+    // The solve runs in place in u, with no intermediate copies: the only
+    // copy is f into u, skipped when they are the same array (as when
+    // called from the boundary-condition form of solve below).
     void EllipticSolver2d::solve(const Array2d& f, Array2d& u ) const {
-        sinTransform( f, u );
+        assert( f.Size() == u.Size() );
+        if ( _singlePrecision ) {
+            solveSingle( f, u );
+            return;
+        }
+        if ( &u != &f ) {
+            for (unsigned int i=0; i < f.Size(); ++i) {
+                u(i) = f(i);
+            }
+        }
+        sinTransformInPlace( u );
+        // Scale by the eigenvalues of the inverse operator, computed from
+        // the shared Laplacian eigenvalue table, folding in the
+        // normalization factor for the inverse transform
+        const double normalizationFactor = 1. / (2 * _nx * 2 * _ny);
+        const double* eig = _laplacianEig;
         for (int i=1; i<_nx; ++i) {
             for (int j=1; j<_ny; ++j) {
-                u(i,j) *= _eigenvaluesOfInverse(i,j);
+                u(i,j) *= normalizationFactor / ( _c0 + _c1 * *eig++ );
             }
         }        
-        sinTransformInv( u, u ); // normalize on inverse transform        
+        sinTransformInPlace( u );
     }
         
+    // Forward transform, eigenvalue scaling, and inverse transform of the
+    // float working array, in place
+    void EllipticSolver2d::transformAndScaleSingle( float* w ) const {
+        Timers::bump( Timers::FFT_EXECUTIONS );
+        fftwf_execute_r2r( _FFTWPlanF, w, w );
+        const float normalizationFactor = 1.f / (2 * _nx * 2 * _ny);
+        const float c0 = (float) _c0;
+        const float c1 = (float) _c1;
+        const float* eig = _laplacianEigF;
+        const int numPoints = (_nx-1) * (_ny-1);
+        for (int k=0; k<numPoints; ++k) {
+            w[k] *= normalizationFactor / ( c0 + c1 * eig[k] );
+        }
+        Timers::bump( Timers::FFT_EXECUTIONS );
+        fftwf_execute_r2r( _FFTWPlanF, w, w );
+    }
+
+    // Single-precision solve: the transforms and eigenvalue scaling run
+    // entirely in float, halving the memory traffic of the dominant
+    // kernel.  When defect correction is on, the residual of the float
+    // solution is evaluated with the double-precision operator and a
+    // float solve of the correction is added back, recovering most of
+    // the lost accuracy for one extra (float) solve.
+    void EllipticSolver2d::solveSingle( const Array2d& f, Array2d& u ) const {
+        if ( ! _planAcquired ) {
+            initTransform();
+        }
+        const int numPoints = (_nx-1) * (_ny-1);
+        if ( (int) _scratchF.size() != numPoints ) {
+            _scratchF.resize( numPoints );
+        }
+        float* w = &_scratchF[0];
+        if ( _defectCorrection && (int) _rhsCopy.size() != numPoints ) {
+            _rhsCopy.resize( numPoints );
+        }
+        // Keep the right-hand side for the defect correction: f may
+        // alias u (as in the boundary-condition form of solve)
+        for (int k=0; k<numPoints; ++k) {
+            w[k] = (float) f(k);
+            if ( _defectCorrection ) _rhsCopy[k] = f(k);
+        }
+        transformAndScaleSingle( w );
+        for (int k=0; k<numPoints; ++k) {
+            u(k) = w[k];
+        }
+        if ( ! _defectCorrection ) return;
+
+        // One defect-correction pass: r = f - (c0 + c1 L) u in double,
+        // with L the unit-spacing Laplacian and zero boundary values
+        const double diag = _c0 - 4. * _c1;
+        for (int i=1; i<_nx; ++i) {
+            for (int j=1; j<_ny; ++j) {
+                double nbr = 0.;
+                if ( i > 1 )     nbr += u(i-1,j);
+                if ( i < _nx-1 ) nbr += u(i+1,j);
+                if ( j > 1 )     nbr += u(i,j-1);
+                if ( j < _ny-1 ) nbr += u(i,j+1);
+                double r = _rhsCopy[ (i-1)*(_ny-1) + (j-1) ]
+                    - diag * u(i,j) - _c1 * nbr;
+                w[ (i-1)*(_ny-1) + (j-1) ] = (float) r;
+            }
+        }
+        transformAndScaleSingle( w );
+        for (int k=0; k<numPoints; ++k) {
+            u(k) += w[k];
+        }
+    }
+
     // Solve L u = f, with specified boundary conditions on u.
     // Note that u contains only the interior points of the domain.
     void EllipticSolver2d::solve( const Array2d& f, const BC& bc, Array2d& u )
@@ -109,16 +389,10 @@ namespace ibpm {
     
     PoissonSolver2d::PoissonSolver2d( int nx, int ny, double dx ) :
         EllipticSolver2d( nx, ny, dx ) {
-        calculateEigenvalues();
-    }
-    
-    void PoissonSolver2d::calculateEigenvalues() {
-        Array2d eigL = getLaplacianEigenvalues();
-        for (int i=1; i < _nx; ++i ) {
-            for (int j=1; j < _ny; ++j ) {
-                _eigenvaluesOfInverse(i,j) = 1. / eigL(i,j);
-            }
-        }
+        // Inverse of L: eigenvalues are the unit-spacing Laplacian
+        // eigenvalues divided by dx^2
+        _c0 = 0.;
+        _c1 = 1. / (dx * dx);
     }
         
     // Set rhs = f - L * bc, in preparation for Poisson solve
@@ -150,16 +424,10 @@ namespace ibpm {
     HelmholtzSolver2d::HelmholtzSolver2d( int nx, int ny, double dx, double alpha ) :
         EllipticSolver2d( nx, ny, dx ),
         _alpha(alpha) {
-        calculateEigenvalues();
-    }
-    
-    void HelmholtzSolver2d::calculateEigenvalues() {
-        Array2d eigL = getLaplacianEigenvalues();
-        for (int i=1; i < _nx; ++i ) {
-            for (int j=1; j < _ny; ++j ) {
-                _eigenvaluesOfInverse(i,j) = 1. / (1 + _alpha * eigL(i,j));
-            }
-        }        
+        // Inverse of (1 + alpha L): only the scaling of the shared
+        // eigenvalue table depends on alpha (and hence on the substep)
+        _c0 = 1.;
+        _c1 = alpha / (dx * dx);
     }
 
     // Set rhs = f - alpha * L * bc, in preparation for Helmholtz solve
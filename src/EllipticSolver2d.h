@@ -4,6 +4,8 @@
 #include "Array.h"
 #include "BC.h"
 #include <fftw3.h>
+#include <string>
+#include <vector>
 
 namespace ibpm {
     
@@ -38,8 +40,12 @@ public:
     virtual ~EllipticSolver2d() = 0;
 
     /// \brief Solve L u = f, assuming zero boundary conditions on u
-    /// The 2D arrays f and u must have indices (1..nx-1, 1..ny-1)
-    void solve( const Array2d& f, Array2d& u ) const;
+    /// The 2D arrays f and u must have indices (1..nx-1, 1..ny-1).
+    /// The solve is done in place in u: if f and u are distinct arrays
+    /// f is copied into u once, and no further copies are made.
+    /// Virtual so that alternative backends (e.g. MultigridSolver2d)
+    /// can replace the direct transform solve.
+    virtual void solve( const Array2d& f, Array2d& u ) const;
 
     /// \brief Solve L u = f, with specified boundary conditions on u.
     /// Note that u contains only the interior points of the domain.
@@ -47,19 +53,67 @@ public:
     /// and the BC object has size (nx,ny)
     void solve( const Array2d& f, const BC& bc, Array2d& u ) const;
 
+    /// \brief Specify a file used to cache FFTW planning data (wisdom)
+    /// across runs.
+    ///
+    /// Wisdom is imported before the first plan is created and exported
+    /// after each new plan, so repeated runs on the same grid sizes (and
+    /// thread count) skip the expensive planning step entirely.  An empty
+    /// filename (the default) disables the cache.
+    static void setWisdomFile( const std::string& filename );
+
+    /// \brief Use single-precision transforms (fftwf plans and float
+    /// eigenvalue tables) in subsequently created solvers, halving the
+    /// memory traffic of the dominant kernel.  Suitable for exploratory
+    /// runs; the default (double) is for publication runs.
+    static void setSinglePrecision( bool singlePrecision );
+
+    /// \brief When solving in single precision, follow each solve with
+    /// one defect-correction pass: the residual is computed with the
+    /// double-precision operator and a single-precision solve of the
+    /// correction is added back.  On by default.
+    static void setDefectCorrection( bool defectCorrection );
+
+    /// \brief Create the transform plan and eigenvalue table for the
+    /// given interior size now, rather than at the first solve.  Needs
+    /// only the grid dimensions, so it can run on the background worker
+    /// (Tasks.h) while other startup phases load from disk; solvers
+    /// created later find the plan already in the shared cache
+    static void warmPlanCache( int nx, int ny );
+
 protected:
-    Array2d getLaplacianEigenvalues() const;
     virtual void getRHS( const Array2d& f, const BC& bc, Array2d& rhs ) const = 0;
-    Array2d _eigenvaluesOfInverse;
     int _nx;
     int _ny;
     double _dx;
+    // The inverse operator acts in the sin-transform basis as
+    // multiplication by 1 / ( c0 + c1 * lambda(i,j) ), where lambda(i,j)
+    // are the eigenvalues of the Laplacian at unit grid spacing.
+    // Subclasses set the two coefficients; the eigenvalue table itself is
+    // shared between all solvers of the same size, for all grid levels
+    // and substeps
+    double _c0;
+    double _c1;
 
 private:
-    void sinTransform( const Array2d& u, Array2d& v ) const;
-    void sinTransformInv( const Array2d& u, Array2d& v ) const;
-    fftw_plan _FFTWPlan;
-    Array2d _fft;
+    void sinTransformInPlace( Array2d& u ) const;
+    void initTransform() const;   // acquire shared plan on first transform
+    void solveSingle( const Array2d& f, Array2d& u ) const;
+    void transformAndScaleSingle( float* w ) const;
+    // Whether this solver uses single-precision transforms (recorded at
+    // construction from the process-wide setting above)
+    bool _singlePrecision;
+    bool _defectCorrection;
+    // The shared plan is acquired lazily, on the first transform, so that
+    // subclasses overriding solve() (e.g. multigrid) never pay for FFTW
+    // planning
+    mutable bool _planAcquired;
+    mutable fftw_plan _FFTWPlan;          // shared with other solvers of the same size
+    mutable const double* _laplacianEig;  // shared eigenvalue table, (nx-1) x (ny-1)
+    mutable fftwf_plan _FFTWPlanF;        // single-precision counterparts
+    mutable const float* _laplacianEigF;
+    mutable std::vector<float> _scratchF;   // working array for float solves
+    mutable std::vector<double> _rhsCopy;   // rhs kept for defect correction
 };
 
 /******************************************************************************/
@@ -76,8 +130,6 @@ public:
 protected:
     // set rhs = f - L * bc
     void getRHS( const Array2d& f, const BC& bc, Array2d& rhs ) const;
-private:
-    void calculateEigenvalues();
 };
 
 /******************************************************************************/
@@ -95,7 +147,6 @@ protected:
     void getRHS( const Array2d& f, const BC& bc, Array2d& rhs ) const;
 private:
     double _alpha;
-    void calculateEigenvalues();
 };
 
 } // namespace ibpm
@@ -15,10 +15,97 @@
 
 #include "Grid.h"
 #include "Field.h"
+#include "Array.h"
+#include "Memory.h"
+#include "Threads.h"
+#include <pthread.h>
+#include <vector>
 
 namespace ibpm {
 
-Field::Field() {
+namespace {
+
+    // Static Fields in other translation units may destruct after the
+    // pool itself during program exit; once this flag is set their
+    // buffers are freed directly instead of being pooled.
+    // (Declared before _pool so it outlives it.)
+    bool _poolDestroyed = false;
+
+    // Pool of released field data buffers, most recently released last.
+    // The pool owns its buffers and frees them at program exit
+    struct FieldBufferPool {
+        std::vector<unsigned int> sizes;
+        std::vector<double*> buffers;
+        ~FieldBufferPool() {
+            for (unsigned int i=0; i<buffers.size(); ++i) {
+                deleteAlign( buffers[i], sizes[i] );
+            }
+            _poolDestroyed = true;
+        }
+    };
+    FieldBufferPool _pool;
+
+    // Fields may be created concurrently by an asynchronous output
+    // thread (see Logger), so access to the pool is serialized
+    pthread_mutex_t _poolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+} // namespace
+
+double* acquireFieldBuffer( unsigned int size ) {
+    if ( size == 0 ) return 0;
+    // Search from the most recently released buffer: transient fields
+    // come and go in stack order, so this nearly always hits immediately
+    pthread_mutex_lock( &_poolMutex );
+    for (int i = _pool.sizes.size() - 1; i >= 0; --i) {
+        if ( _pool.sizes[i] == size ) {
+            double* buffer = _pool.buffers[i];
+            _pool.sizes.erase( _pool.sizes.begin() + i );
+            _pool.buffers.erase( _pool.buffers.begin() + i );
+            pthread_mutex_unlock( &_poolMutex );
+            return buffer;
+        }
+    }
+    pthread_mutex_unlock( &_poolMutex );
+    // None available: allocate a fresh buffer, aligned like any other
+    // field data.  The buffer stays charged to the caller's owner tag
+    // while pooled, matching its resident footprint
+    double* buffer = 0;
+    size_t bytes = size * sizeof(double);
+    newAlign( buffer, size,
+        Array::backingAlign( bytes, Array::cacheAlignment ) );
+    // Huge-page advice and residency lock must precede the first touch
+    // below, while the pages are still unpopulated
+    Array::backingAdvise( buffer, bytes );
+    Memory::recordAlloc( Memory::currentTag(), bytes );
+    // First-touch the pages in parallel, with the same static
+    // partitioning the threaded kernels use, so that on NUMA machines
+    // each thread's share of the field lands on its own node (the OS
+    // places a page on the node of the thread that first writes it)
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) \
+    num_threads( GetKernelThreads( KERNEL_STENCIL ) ) if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (unsigned int i=0; i<size; ++i) {
+        buffer[i] = 0.;
+    }
+    return buffer;
+}
+
+void releaseFieldBuffer( double* buffer, unsigned int size ) {
+    if ( buffer == 0 || size == 0 ) return;
+    if ( _poolDestroyed ) {
+        deleteAlign( buffer, size );
+        return;
+    }
+    pthread_mutex_lock( &_poolMutex );
+    _pool.sizes.push_back( size );
+    _pool.buffers.push_back( buffer );
+    pthread_mutex_unlock( &_poolMutex );
+}
+
+Field::Field() :
+    _sharedData( false ),
+    _dataOwner( NULL ) {
     // Note: cannot set nx to zero or computation of dx will divide by zero
     // Set to -1 to indicate no grid defined
     int nx = -1;
@@ -30,11 +117,16 @@ Field::Field() {
     _grid.resize( nx, ny, ngrid, length, xOffset, yOffset );
 }
 
-Field::Field(const Grid& grid) {
+Field::Field(const Grid& grid) :
+    _sharedData( false ),
+    _dataOwner( NULL ) {
     _grid = grid;
 }
 
-Field::Field(const Field& field) {
+// Note a fresh copy owns its data: the shared mark is not copied
+Field::Field(const Field& field) :
+    _sharedData( false ),
+    _dataOwner( NULL ) {
     _grid = field._grid;
 }
 
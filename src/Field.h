@@ -21,13 +21,42 @@ namespace ibpm {
     \version $Revision$
 */
 
+/*! \brief Interface for an object owning field data shared between
+    several owners, under copy-on-write.
+
+    State is the one implementor: its copies share a single arena, and
+    the fields viewing it are marked shared.  The first mutating access
+    to such a field calls detachData() through ensureUnique(), which
+    must give the owner's fields private copies of their data before the
+    write goes through.
+*/
+class FieldDataOwner {
+public:
+    virtual ~FieldDataOwner() {}
+    virtual void detachData() = 0;
+};
+
 class Field {
 public:
     Field();
     Field( const Grid& grid );
     Field( const Field& field );
     virtual ~Field();
-    
+
+    /// \brief Mark the field's data as shared with other owners, under
+    /// copy-on-write: the next mutating access calls owner->detachData()
+    /// before touching the data.  Cleared by resize and viewExternal
+    inline void shareData( FieldDataOwner* owner ) const {
+        _sharedData = true;
+        _dataOwner = owner;
+    }
+
+    /// Clear the shared mark (the data has been detached or replaced)
+    inline void unshareData() const { _sharedData = false; }
+
+    /// Return true when the data is shared and a mutation must detach
+    inline bool isShared() const { return _sharedData; }
+
     inline int Nx() const { return _grid.Nx(); }
     inline int NxExt() const { return _grid.NxExt(); }
     inline int Ny() const { return _grid.Ny(); }
@@ -59,11 +88,50 @@ public:
     inline double getYEdge(int lev, int j) const {
         return _grid.getYEdge( lev, j );
     }
-    
+
+protected:
+    /// \brief Called at the top of the subclasses' mutating accessors:
+    /// give this field a private copy of its data if it is currently
+    /// shared.  The flag is false except between a copy of the owning
+    /// State and the first write, so the branch predicts away in
+    /// elementwise loops
+    inline void ensureUnique() {
+        if ( _sharedData ) _dataOwner->detachData();
+    }
+
+    /// Exchange the copy-on-write bookkeeping with field (see swap in
+    /// the subclasses; State::swap re-points the owners afterwards)
+    inline void swapShareState( Field& field ) {
+        bool s = _sharedData;
+        _sharedData = field._sharedData;
+        field._sharedData = s;
+        FieldDataOwner* o = _dataOwner;
+        _dataOwner = field._dataOwner;
+        field._dataOwner = o;
+    }
+
 private:
     Grid _grid;
+    // Copy-on-write bookkeeping (see shareData); mutable so that a copy
+    // may mark the fields of its const source as shared
+    mutable bool _sharedData;
+    mutable FieldDataOwner* _dataOwner;
 };
 
+/*! \brief Acquire a data buffer of the given length (in doubles) from
+    the shared field-buffer pool.
+
+    Transient Scalar and Flux objects in the timestep loop are created
+    and destroyed in stack order, so rather than hitting the allocator
+    each time, released buffers are kept in a last-in-first-out pool and
+    handed back out to the next field of the same size.  Buffers are
+    cache-line aligned.  Returns NULL for length zero.
+*/
+double* acquireFieldBuffer( unsigned int size );
+
+/// \brief Return a buffer obtained from acquireFieldBuffer to the pool
+void releaseFieldBuffer( double* buffer, unsigned int size );
+
 } // namespace ibpm
 
 
@@ -0,0 +1,196 @@
+// FileStager.cc
+//
+// Description:
+// Tiered staging of heavy output files through local storage
+// (see FileStager.h)
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "FileStager.h"
+#include <dirent.h>
+#include <errno.h>
+#include <iostream>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace ibpm {
+
+namespace FileStager {
+
+namespace {
+
+// Seconds a staged file must sit unmodified before it is picked up;
+// a file still being written keeps a fresh mtime
+const int QUARANTINE_SECONDS = 2;
+
+// Copy chunk; also the granularity of the bandwidth pacing
+const size_t CHUNK_BYTES = 1 << 22;
+
+string _stageDir;
+string _outDir;
+double _maxBytesPerSec = 0.;
+bool _running = false;
+volatile bool _stopRequested = false;
+pthread_t _thread;
+
+double readClock() {
+    struct timeval t;
+    gettimeofday( &t, NULL );
+    return t.tv_sec + 1.e-6 * t.tv_usec;
+}
+
+// Move one staged file into the output directory: rename if the
+// directories share a filesystem, otherwise a paced copy to a
+// temporary name, renamed into place so no partial file is ever
+// visible at the destination
+bool migrateFile( const string& name ) {
+    string src = _stageDir + name;
+    string dst = _outDir + name;
+    if ( rename( src.c_str(), dst.c_str() ) == 0 ) {
+        return true;
+    }
+    if ( errno != EXDEV ) {
+        cerr << "FileStager: cannot move " << src << " to " << dst
+            << ": " << strerror( errno ) << endl;
+        return false;
+    }
+    FILE* in = fopen( src.c_str(), "rb" );
+    if ( in == NULL ) return false;
+    string tmp = dst + ".part";
+    FILE* out = fopen( tmp.c_str(), "wb" );
+    if ( out == NULL ) {
+        fclose( in );
+        cerr << "FileStager: cannot create " << tmp << endl;
+        return false;
+    }
+    vector<char> buf( CHUNK_BYTES );
+    bool ok = true;
+    double start = readClock();
+    double written = 0.;
+    size_t n;
+    while ( ( n = fread( &buf[0], 1, CHUNK_BYTES, in ) ) > 0 ) {
+        if ( fwrite( &buf[0], 1, n, out ) != n ) {
+            ok = false;
+            break;
+        }
+        written += n;
+        if ( _maxBytesPerSec > 0. ) {
+            // Sleep off any lead over the bandwidth cap
+            double ahead = written / _maxBytesPerSec
+                - ( readClock() - start );
+            if ( ahead > 0. ) {
+                usleep( (useconds_t) ( ahead * 1e6 ) );
+            }
+        }
+    }
+    ok = ok && ! ferror( in );
+    fclose( in );
+    ok = ( fclose( out ) == 0 ) && ok;
+    if ( ok ) {
+        ok = ( rename( tmp.c_str(), dst.c_str() ) == 0 );
+    }
+    if ( ok ) {
+        unlink( src.c_str() );
+    }
+    else {
+        unlink( tmp.c_str() );
+        cerr << "FileStager: failed to copy " << src << " to " << dst
+            << endl;
+    }
+    return ok;
+}
+
+// One scan of the staging directory.  Files younger than the
+// quarantine are skipped unless force is set (the end-of-run flush,
+// when no writer is left)
+bool scanPass( bool force ) {
+    DIR* dir = opendir( _stageDir.c_str() );
+    if ( dir == NULL ) return false;
+    time_t now = time( NULL );
+    bool ok = true;
+    struct dirent* entry;
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        string name = entry->d_name;
+        if ( name == "." || name == ".." ) continue;
+        if ( name.size() > 5 &&
+             name.compare( name.size() - 5, 5, ".part" ) == 0 ) continue;
+        struct stat st;
+        string path = _stageDir + name;
+        if ( stat( path.c_str(), &st ) != 0 ) continue;
+        if ( ! S_ISREG( st.st_mode ) ) continue;
+        if ( ! force && now - st.st_mtime < QUARANTINE_SECONDS ) continue;
+        ok = migrateFile( name ) && ok;
+    }
+    closedir( dir );
+    return ok;
+}
+
+// Body of the migrator thread: scan once a second until asked to stop
+void* runMigrator( void* ) {
+    while ( ! _stopRequested ) {
+        scanPass( false );
+        for ( int i = 0; i < 10 && ! _stopRequested; ++i ) {
+            usleep( 100000 );
+        }
+    }
+    return NULL;
+}
+
+} // anonymous namespace
+
+bool start( const string& stageDir, const string& outDir,
+            double maxMBps ) {
+    if ( _running ) return false;
+    if ( stageDir == outDir ) return false;
+    mkdir( stageDir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO );
+    struct stat st;
+    if ( stat( stageDir.c_str(), &st ) != 0 || ! S_ISDIR( st.st_mode ) ) {
+        cerr << "FileStager: cannot create staging directory "
+            << stageDir << endl;
+        return false;
+    }
+    _stageDir = stageDir;
+    _outDir = outDir;
+    _maxBytesPerSec = maxMBps * 1048576.;
+    _stopRequested = false;
+    if ( pthread_create( &_thread, NULL, runMigrator, NULL ) != 0 ) {
+        cerr << "FileStager: cannot start migrator thread; writing "
+            "directly to " << outDir << endl;
+        return false;
+    }
+    _running = true;
+    return true;
+}
+
+bool enabled() {
+    return _running;
+}
+
+bool drain() {
+    if ( ! _running ) return true;
+    _stopRequested = true;
+    pthread_join( _thread, NULL );
+    _running = false;
+    // Final flush on the caller's thread: all writers are done, so
+    // the quarantine no longer applies
+    return scanPass( true );
+}
+
+} // namespace FileStager
+
+} // namespace ibpm
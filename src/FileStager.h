@@ -0,0 +1,65 @@
+#ifndef _FILESTAGER_H_
+#define _FILESTAGER_H_
+
+#include <string>
+
+/*!
+    \file FileStager.h
+
+    \brief Tiered staging of heavy output files through local storage.
+
+    On clusters with fast node-local disks and a slow or bursty shared
+    filesystem, the checkpoint and snapshot files are landed in a
+    node-local staging directory at local-disk speed, and a background
+    migrator thread drains them to the final output directory.  The
+    writer (Logger's output thread, or the main loop in synchronous
+    mode) only ever waits on the local disk, so solver throughput is
+    decoupled from shared-filesystem weather.
+
+    The migrator scans the staging directory once a second and moves
+    every regular file whose modification time is at least a couple of
+    seconds old -- a file still being written keeps a fresh mtime, so
+    partially written files are never picked up.  Files are moved by
+    rename when the directories share a filesystem, and otherwise copied
+    to a temporary name and renamed into place, so the output directory
+    never shows a partial file.  The copy bandwidth can be capped, to
+    keep the migration from competing with neighbors for the shared
+    filesystem.  drain() flushes whatever remains at the end of the run.
+
+    Continuously appended files (force histories, probes, series) are
+    not staged: they stay open for the whole run and are light.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 30 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+namespace ibpm {
+
+namespace FileStager {
+
+/// \brief Start the migrator: files landing in stageDir are drained to
+/// outDir, copying at most maxMBps megabytes per second (0: unlimited).
+/// Creates stageDir if needed; both paths must end in a slash.  Returns
+/// false (and stages nothing) if stageDir cannot be created or equals
+/// outDir
+bool start( const std::string& stageDir, const std::string& outDir,
+            double maxMBps );
+
+/// \brief Return true if the migrator is running
+bool enabled();
+
+/// \brief Flush the remaining staged files and stop the migrator.
+/// Called once at the end of the run, after the output routines have
+/// been cleaned up; the final pass ignores the modification-time
+/// quarantine since no writer is left.  Returns false if any file
+/// could not be moved
+bool drain();
+
+} // namespace FileStager
+
+} // namespace ibpm
+
+#endif /* _FILESTAGER_H_ */
@@ -0,0 +1,101 @@
+// FlowMonitor.cc
+//
+// Description:
+// Per-step stability metrics piggybacked on existing field sweeps
+// (see FlowMonitor.h).  The fold functions are called with per-level
+// partial maxima from inside threaded passes, so they serialize on a
+// critical section; one call per level per pass keeps that negligible.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "FlowMonitor.h"
+
+namespace ibpm {
+
+static bool s_enabled = false;
+
+// Accumulators of the step in progress, and the published values of
+// the last completed step
+static double s_maxFlux = 0.;
+static double s_cflRate = 0.;
+static double s_maxVorticity = 0.;
+static double s_divergence = 0.;
+static double s_maxFluxDone = 0.;
+static double s_cflRateDone = 0.;
+static double s_maxVorticityDone = 0.;
+static double s_divergenceDone = 0.;
+
+void SetFlowMonitor( bool flag ) {
+    s_enabled = flag;
+}
+
+bool FlowMonitorEnabled() {
+    return s_enabled;
+}
+
+void FlowMonitorStartStep() {
+    if ( ! s_enabled ) return;
+    s_maxFluxDone = s_maxFlux;
+    s_cflRateDone = s_cflRate;
+    s_maxVorticityDone = s_maxVorticity;
+    s_divergenceDone = s_divergence;
+    s_maxFlux = 0.;
+    s_cflRate = 0.;
+    s_maxVorticity = 0.;
+    s_divergence = 0.;
+}
+
+void FlowMonitorFlux( double maxAbs, double dx ) {
+#ifdef _OPENMP
+#pragma omp critical (ibpm_flowmonitor)
+#endif
+    {
+        if ( maxAbs > s_maxFlux ) s_maxFlux = maxAbs;
+        double rate = maxAbs / ( dx * dx );
+        if ( rate > s_cflRate ) s_cflRate = rate;
+    }
+}
+
+void FlowMonitorVorticity( double maxAbs ) {
+#ifdef _OPENMP
+#pragma omp critical (ibpm_flowmonitor)
+#endif
+    {
+        if ( maxAbs > s_maxVorticity ) s_maxVorticity = maxAbs;
+    }
+}
+
+void FlowMonitorDivergence( double maxAbs ) {
+#ifdef _OPENMP
+#pragma omp critical (ibpm_flowmonitor)
+#endif
+    {
+        if ( maxAbs > s_divergence ) s_divergence = maxAbs;
+    }
+}
+
+double GetMonitorMaxFlux() {
+    return s_maxFluxDone;
+}
+
+double GetMonitorCFLRate() {
+    return s_cflRateDone;
+}
+
+double GetMonitorMaxVorticity() {
+    return s_maxVorticityDone;
+}
+
+double GetMonitorDivergence() {
+    return s_divergenceDone;
+}
+
+} // namespace ibpm
@@ -0,0 +1,74 @@
+#ifndef _FLOWMONITOR_H_
+#define _FLOWMONITOR_H_
+
+/*!
+    \file FlowMonitor.h
+
+    \brief Per-step stability metrics piggybacked on existing sweeps.
+
+    Tracks the peak flux magnitude (per level, CFL-weighted), the peak
+    vorticity, and the incompressibility residual of the flux, without
+    adding full-grid passes of their own: the accumulation points live
+    inside sweeps that already touch the data every substep (the curl
+    output pass of NavierStokesModel::computeFlux, and its vorticity
+    negation pass), folding in one partial maximum per level.
+    Monitoring is off by default and the hooks cost one branch when
+    disabled.
+
+    The published values describe the last completed timestep (the
+    accumulators are swapped at the start of IBSolver::advance), so a
+    driver can poll them after every step: the adaptive timestep reads
+    the CFL rate instead of re-sweeping the fluxes, and a divergence
+    abort (a peak vorticity that explodes or goes NaN) triggers on the
+    step it happens rather than at the next output interval.  The curl
+    of a streamfunction is discretely divergence free, so the residual
+    is roundoff-level in a healthy run; growth flags corrupted state.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 30 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+namespace ibpm {
+
+/// \brief Turn flow monitoring on or off (off by default)
+void SetFlowMonitor( bool flag );
+
+/// \brief Return true if flow monitoring is enabled
+bool FlowMonitorEnabled();
+
+/// \brief Publish the accumulators of the step just completed as the
+/// monitor's current values, and reset them for the coming step.
+/// Called at the start of each IBSolver::advance
+void FlowMonitorStartStep();
+
+/// \brief Fold one level's peak flux magnitude (and its grid spacing,
+/// for the CFL weighting |q| / dx^2) into the current accumulators
+void FlowMonitorFlux( double maxAbs, double dx );
+
+/// \brief Fold a partial peak vorticity into the current accumulators
+void FlowMonitorVorticity( double maxAbs );
+
+/// \brief Fold a partial incompressibility residual (peak cell
+/// divergence of the flux) into the current accumulators
+void FlowMonitorDivergence( double maxAbs );
+
+/// \brief Peak flux magnitude of the last completed step
+double GetMonitorMaxFlux();
+
+/// \brief Peak of |q| / dx^2 over all levels of the last completed
+/// step; multiplied by dt this is the CFL number (see
+/// IBSolver::computeCFLTimestep)
+double GetMonitorCFLRate();
+
+/// \brief Peak vorticity magnitude of the last completed step
+double GetMonitorMaxVorticity();
+
+/// \brief Peak cell divergence of the flux of the last completed step
+double GetMonitorDivergence();
+
+} // namespace ibpm
+
+#endif /* _FLOWMONITOR_H_ */
@@ -16,12 +16,15 @@
 #include "Flux.h"
 #include "Scalar.h"
 #include "Grid.h"
+#include "Memory.h"
 
 using std::cout;
 
 namespace ibpm {
 
-Flux::Flux() {}
+Flux::Flux() {
+    _ownData = true;
+}
 
 Flux::Flux( const Grid& grid ) :
     Field( grid ) {
@@ -45,11 +48,37 @@ void Flux::resize( const Grid& grid ) {
     int ny = Ny();
     _numXFluxes = nx * ny + ny;
     _numFluxes = 2 * nx * ny + nx + ny;
-    _data.Deallocate();
-    _data.Allocate( Ngrid(), _numFluxes );
+    // Storage is drawn from the shared field-buffer pool
+    if ( _data.Size() > 0 && _ownData ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
+    unsigned int size = Ngrid() * _numFluxes;
+    ScopedMemoryTag memTag( Memory::FLUX );
+    _data.Dimension( Ngrid(), _numFluxes, acquireFieldBuffer( size ) );
+    _ownData = true;
+    unshareData();
 }
 
-Flux::~Flux() {} // deallocation automatic for Blitz++ arrays
+void Flux::viewExternal( const Grid& grid, double* data ) {
+    if ( _data.Size() > 0 && _ownData ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
+    setGrid( grid );
+    int nx = Nx();
+    int ny = Ny();
+    _numXFluxes = nx * ny + ny;
+    _numFluxes = 2 * nx * ny + nx + ny;
+    _data.Dimension( Ngrid(), _numFluxes, data );
+    _ownData = false;
+    unshareData();
+}
+
+/// Return the data buffer to the pool in the destructor
+Flux::~Flux() {
+    if ( _data.Size() > 0 && _ownData ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
+}
 
 // Print the X and Y components to standard out (for debugging)
 void Flux::print() {
@@ -109,21 +138,37 @@ void Flux::setFlow(
         The components xdot, ydot, thetadot are calculated in BaseFlow::moveFlow
         The calculation is similar to Flux::UniformFlow, but with a rotational component
     */
+    ensureUnique();
     double xdot, ydot, thetadot;
-    double xdiff, ydiff;
     g.getVelocity(xdot,ydot,thetadot);
+    int nx = Nx();
+    int ny = Ny();
     Flux::index ind;
     for (int lev=0; lev<Ngrid(); ++lev) {
         double dx = Dx(lev);
-        for(ind = begin(X); ind != end(X); ++ind) {
-            xdiff = x(lev,ind) - xCenter;
-            ydiff = y(lev,ind) - yCenter;
-            _data(lev,ind) = (xdot -thetadot*ydiff)*dx;
+        // The flat index advances in step with the (i,j) loops, so the
+        // inverse index decomposition of x(lev,ind) / y(lev,ind) -- an
+        // integer divide and modulo per edge -- is avoided.  The X flux
+        // depends only on the edge ordinate and the Y flux only on the
+        // edge abscissa, so each distinct value is computed once and
+        // replicated along the other direction
+        ind = begin(X);
+        for (int j=0; j<ny; ++j, ++ind) {
+            double ydiff = getYCenter(lev,j) - yCenter;
+            _data(lev,ind) = (xdot - thetadot*ydiff)*dx;
+        }
+        const double* firstColumn = &_data(lev, begin(X));
+        for (int i=1; i<=nx; ++i) {
+            for (int j=0; j<ny; ++j, ++ind) {
+                _data(lev,ind) = firstColumn[j];
+            }
         }
-        for(ind = begin(Y); ind != end(Y); ++ind) {
-            xdiff = x(lev,ind) - xCenter;
-            ydiff = y(lev,ind) - yCenter;
-            _data(lev,ind) = (ydot + thetadot*xdiff)*dx;
+        for (int i=0; i<nx; ++i) {
+            double xdiff = getXCenter(lev,i) - xCenter;
+            double value = (ydot + thetadot*xdiff)*dx;
+            for (int j=0; j<=ny; ++j, ++ind) {
+                _data(lev,ind) = value;
+            }
         }
     }
 }
@@ -28,6 +28,9 @@ namespace ibpm {
     \version $Revision$
 */
 
+// Expression template for lazy elementwise arithmetic (defined below)
+template <class L, class Op, class R> class FluxExpr;
+
 class Flux : public Field {
 public:
     /// Constructor: allocate arrays based on the Grid dimensions
@@ -44,12 +47,19 @@ public:
 
     /// Set all parameters and reallocate arrays based on the Grid dimensions
     void resize( const Grid& grid );
-    
+
+    /// \brief Make this Flux a view of externally owned data, laid out as
+    /// in resize() (e.g. a region of a memory-mapped restart file; see
+    /// State::mapFromFile).  The data must outlive the view, and is not
+    /// returned to the buffer pool
+    void viewExternal( const Grid& grid, double* data );
+
     /// Print the X and Y components to standard out (for debugging)
     void print();
     
     /// Copy assignment
     inline Flux& operator=(const Flux& q) {
+        ensureUnique();
         assert(q.Ngrid() == Ngrid());
         assert(q.Nx() == Nx());
         assert(q.Ny() == Ny());
@@ -59,12 +69,80 @@ public:
 
     /// Copy assignment from double
     inline Flux& operator=(double a) {
+        ensureUnique();
         _data = a;
         return *this;
     }
 
+    /// Exchange contents with q, in constant time (no data is copied)
+    inline void swap( Flux& q ) {
+        Grid tmp = getGrid();
+        setGrid( q.getGrid() );
+        q.setGrid( tmp );
+        int t = _numXFluxes; _numXFluxes = q._numXFluxes; q._numXFluxes = t;
+        t = _numFluxes; _numFluxes = q._numFluxes; q._numFluxes = t;
+        _data.Swap( q._data );
+        bool own = _ownData; _ownData = q._ownData; q._ownData = own;
+        swapShareState( q );
+    }
+
+#if __cplusplus >= 201103L
+    /// Move constructor: take over the contents of q, leaving it empty
+    inline Flux( Flux&& q ) : Field( q ), _numXFluxes(0), _numFluxes(0) {
+        _ownData = true;
+        swap( q );
+    }
+
+    /// Move assignment: exchange contents with q
+    inline Flux& operator=( Flux&& q ) {
+        swap( q );
+        return *this;
+    }
+#endif
+
+    /// Construct from a lazy expression, evaluating it in a single loop
+    template <class L, class Op, class R>
+    inline Flux( const FluxExpr<L,Op,R>& e ) :
+        Field( e.getGrid() ) {
+        resize( e.getGrid() );
+        for (unsigned int i=0; i < _data.Size(); ++i) {
+            _data(i) = e(i);
+        }
+    }
+
+    /// Assignment from a lazy expression, evaluated in a single loop
+    template <class L, class Op, class R>
+    inline Flux& operator=(const FluxExpr<L,Op,R>& e) {
+        ensureUnique();
+        assert( e.getGrid().isEqualTo( getGrid() ) );
+        for (unsigned int i=0; i < _data.Size(); ++i) {
+            _data(i) = e(i);
+        }
+        return *this;
+    }
+
+    /// Return the total number of stored fluxes, over all levels
+    inline unsigned int getSize() const { return _data.Size(); }
+
+    /// \brief Return a pointer to the flat data at grid level lev, indexed
+    /// by Flux::index (all X fluxes, followed by all Y fluxes)
+    inline double* flatten(int lev) {
+        ensureUnique();
+        assert( lev >= 0 && lev < Ngrid() );
+        return &_data(lev,0);
+    }
+    inline const double* flatten(int lev) const {
+        assert( lev >= 0 && lev < Ngrid() );
+        return &_data(lev,0);
+    }
+
+    /// Return the i-th stored value, indexed linearly over all levels
+    /// (used by the expression templates below)
+    inline double flat(unsigned int i) const { return _data(i); }
+
     /// q(dir,i,j) refers to the flux in direction dir (X or Y) at edge (i,j)
     inline double& operator()(int lev, int dir, int i, int j) {
+        ensureUnique();
         assert( lev >= 0 && lev < Ngrid() );
         return _data(lev,getIndex(dir,i,j));
     };
@@ -80,6 +158,7 @@ public:
     
     /// f(ind) refers to the value corresponding to the given index ind
     inline double& operator()(int lev, index ind) {
+        ensureUnique();
         assert( lev >= 0 && lev < Ngrid() );
         assert( (ind >= 0) && (ind < _numFluxes) );
         return _data(lev, ind);
@@ -107,7 +186,10 @@ public:
         }
     }
 
-    /// q.x(ind) returns the x-coordinate of the flux specified by ind
+    /// \brief q.x(ind) returns the x-coordinate of the flux specified by
+    /// ind.  Note this recovers (dir,i) by integer division, so it is for
+    /// diagnostics and tests; loops over all edges should carry (i,j)
+    /// alongside the flat index instead (see Flux::setFlow)
     inline double x(int lev, index ind) {
         assert( lev >= 0 && lev < Ngrid() );
 		int dir;
@@ -186,6 +268,7 @@ public:
     
     /// f += g
     inline Flux& operator+=(const Flux& f) {
+        ensureUnique();
         assert(f.Ngrid() == Ngrid());
         assert(f.Nx() == Nx());
         assert(f.Ny() == Ny());
@@ -197,6 +280,7 @@ public:
 
     /// f += a
     inline Flux& operator+=(double a) {
+        ensureUnique();
         for (unsigned int i=0; i < _data.Size(); ++i) {
             _data(i) += a;
         }
@@ -205,6 +289,7 @@ public:
     
     /// f -= g
     inline Flux& operator-=(const Flux& f) {
+        ensureUnique();
         assert(f.Ngrid() == Ngrid());
         assert(f.Nx() == Nx());
         assert(f.Ny() == Ny());
@@ -216,72 +301,49 @@ public:
 
     /// f -= a
     inline Flux& operator-=(double a) {
+        ensureUnique();
         for (unsigned int i=0; i < _data.Size(); ++i) {
             _data(i) -= a;
         }
         return *this;
     }
     
-    /// f + g
-    inline Flux operator+(const Flux& f) {
-        assert(f.Ngrid() == Ngrid());
-        assert(f.Nx() == Nx());
-        assert(f.Ny() == Ny());
-        Flux g = *this;
-        g += f;
-        return g;
-    };
-    
-    /// f + a
-    inline Flux operator+(double a) {
-        Flux g = *this;
-        g += a;
-        return g;
-    };
+    /// f += (expression), evaluated in a single fused loop
+    template <class L, class Op, class R>
+    inline Flux& operator+=(const FluxExpr<L,Op,R>& e) {
+        ensureUnique();
+        assert( e.getGrid().isEqualTo( getGrid() ) );
+        for (unsigned int i=0; i < _data.Size(); ++i) {
+            _data(i) += e(i);
+        }
+        return *this;
+    }
 
-    /// f - g
-    inline Flux operator-(const Flux& f) {
-        assert(f.Ngrid() == Ngrid());
-        assert(f.Nx() == Nx());
-        assert(f.Ny() == Ny());
-        Flux g = *this;
-        g -= f;
-        return g;
-    };
-    
-    /// f - a
-    inline Flux operator-(double a) {
-        Flux g = *this;
-        g -= a;
-        return g;
-    };
+    /// f -= (expression), evaluated in a single fused loop
+    template <class L, class Op, class R>
+    inline Flux& operator-=(const FluxExpr<L,Op,R>& e) {
+        ensureUnique();
+        assert( e.getGrid().isEqualTo( getGrid() ) );
+        for (unsigned int i=0; i < _data.Size(); ++i) {
+            _data(i) -= e(i);
+        }
+        return *this;
+    }
 
     /// f *= a
     inline Flux& operator*=(double a) {
+        ensureUnique();
         _data *= a;
         return *this;
     }
 
     /// f /= a
     inline Flux& operator/=(double a) {
+        ensureUnique();
         _data /= a;
         return *this;
     }
 
-    /// f * a
-    inline Flux operator*(double a) {
-        Flux g = *this;
-        g *= a;
-        return g;
-    }
-
-    /// f / a
-    inline Flux operator/(double a) {
-        Flux g = *this;
-        g /= a;
-        return g;
-    }
-
     /// Return Flux for a uniform flow with the specified magnitude and dir
     static Flux UniformFlow(
         const Grid& grid,
@@ -300,34 +362,134 @@ private:
     int _numXFluxes;
     int _numFluxes;
     Array::Array2<double> _data;
+    bool _ownData;  // false when viewing externally owned data
 };  // class Flux
 
-/// -f
-inline Flux operator-(const Flux& f) {
-    Flux g = f;
-    g *= -1;
-    return g;
-}
+// =========================================================================
+// Expression templates for Flux arithmetic
+//
+// As for Scalar (see Scalar.h), binary operators build a lightweight
+// FluxExpr recording the operands, and the elementwise loop runs only on
+// assignment to a Flux.  Since a Flux stores both the X and Y edge arrays
+// on every grid level, these were the largest temporaries in the code:
+// superposing the base flow or forming q1 + alpha*q2 now runs in a single
+// pass with no intermediate flux fields.
+// =========================================================================
+
+/// Elementwise operation tags, applied by FluxExpr
+struct FPlus   { static inline double apply(double a, double b) {return a+b;} };
+struct FMinus  { static inline double apply(double a, double b) {return a-b;} };
+struct FTimes  { static inline double apply(double a, double b) {return a*b;} };
+struct FDivide { static inline double apply(double a, double b) {return a/b;} };
+
+/// Leaf node wrapping a reference to a Flux operand
+class FluxRef {
+public:
+    inline FluxRef( const Flux& q ) : _q( &q ) {}
+    inline double operator()(unsigned int i) const { return _q->flat(i); }
+    inline const Grid& getGrid() const { return _q->getGrid(); }
+private:
+    const Flux* _q;
+};
 
-/// a + f
-inline Flux operator+(double a, const Flux& f) {
-    Flux g = f;
-    g += a;
-    return g;
+/// Leaf node wrapping a scalar constant operand
+class FluxConst {
+public:
+    inline FluxConst( double a ) : _a( a ) {}
+    inline double operator()(unsigned int) const { return _a; }
+private:
+    double _a;
 };
-    
-/// a - f
-inline Flux operator-(double a, const Flux& f) {
-    Flux g = -f;
-    g += a;
-    return g;
+
+/// Node representing the elementwise operation Op applied to two
+/// subexpressions (leaves or other FluxExpr nodes), stored by value
+template <class L, class Op, class R>
+class FluxExpr {
+public:
+    inline FluxExpr( const L& l, const R& r, const Grid& grid ) :
+        _l( l ), _r( r ), _grid( &grid ) {}
+    inline double operator()(unsigned int i) const {
+        return Op::apply( _l(i), _r(i) );
+    }
+    inline const Grid& getGrid() const { return *_grid; }
+private:
+    L _l;
+    R _r;
+    const Grid* _grid;
 };
 
-/// a * f
-inline Flux operator*(double a, const Flux& f) {
-    Flux g = f;
-    g *= a;
-    return g;
+// Generate the overloads for one elementwise operator, covering each
+// combination of Flux, double, and subexpression operands
+#define IBPM_FLUX_EXPR_OP( op, Op )                                          \
+inline FluxExpr<FluxRef,Op,FluxRef>                                          \
+operator op( const Flux& f, const Flux& g ) {                                \
+    assert( f.getGrid().isEqualTo( g.getGrid() ) );                          \
+    return FluxExpr<FluxRef,Op,FluxRef>(                                     \
+        FluxRef(f), FluxRef(g), f.getGrid() );                               \
+}                                                                            \
+inline FluxExpr<FluxRef,Op,FluxConst>                                        \
+operator op( const Flux& f, double a ) {                                     \
+    return FluxExpr<FluxRef,Op,FluxConst>(                                   \
+        FluxRef(f), FluxConst(a), f.getGrid() );                             \
+}                                                                            \
+inline FluxExpr<FluxConst,Op,FluxRef>                                        \
+operator op( double a, const Flux& f ) {                                     \
+    return FluxExpr<FluxConst,Op,FluxRef>(                                   \
+        FluxConst(a), FluxRef(f), f.getGrid() );                             \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline FluxExpr<FluxExpr<L,O,R>,Op,FluxRef>                                  \
+operator op( const FluxExpr<L,O,R>& e, const Flux& f ) {                     \
+    assert( e.getGrid().isEqualTo( f.getGrid() ) );                          \
+    return FluxExpr<FluxExpr<L,O,R>,Op,FluxRef>(                             \
+        e, FluxRef(f), e.getGrid() );                                        \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline FluxExpr<FluxRef,Op,FluxExpr<L,O,R> >                                 \
+operator op( const Flux& f, const FluxExpr<L,O,R>& e ) {                     \
+    assert( f.getGrid().isEqualTo( e.getGrid() ) );                          \
+    return FluxExpr<FluxRef,Op,FluxExpr<L,O,R> >(                            \
+        FluxRef(f), e, e.getGrid() );                                        \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline FluxExpr<FluxExpr<L,O,R>,Op,FluxConst>                                \
+operator op( const FluxExpr<L,O,R>& e, double a ) {                          \
+    return FluxExpr<FluxExpr<L,O,R>,Op,FluxConst>(                           \
+        e, FluxConst(a), e.getGrid() );                                      \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline FluxExpr<FluxConst,Op,FluxExpr<L,O,R> >                               \
+operator op( double a, const FluxExpr<L,O,R>& e ) {                          \
+    return FluxExpr<FluxConst,Op,FluxExpr<L,O,R> >(                          \
+        FluxConst(a), e, e.getGrid() );                                      \
+}                                                                            \
+template <class L1, class O1, class R1, class L2, class O2, class R2>        \
+inline FluxExpr<FluxExpr<L1,O1,R1>,Op,FluxExpr<L2,O2,R2> >                   \
+operator op( const FluxExpr<L1,O1,R1>& e1,                                   \
+             const FluxExpr<L2,O2,R2>& e2 ) {                                \
+    assert( e1.getGrid().isEqualTo( e2.getGrid() ) );                        \
+    return FluxExpr<FluxExpr<L1,O1,R1>,Op,FluxExpr<L2,O2,R2> >(              \
+        e1, e2, e1.getGrid() );                                              \
+}
+
+IBPM_FLUX_EXPR_OP( +, FPlus )
+IBPM_FLUX_EXPR_OP( -, FMinus )
+IBPM_FLUX_EXPR_OP( *, FTimes )
+IBPM_FLUX_EXPR_OP( /, FDivide )
+
+#undef IBPM_FLUX_EXPR_OP
+
+/// -f, as the expression (-1) * f
+inline FluxExpr<FluxConst,FTimes,FluxRef>
+operator-( const Flux& f ) {
+    return -1. * f;
+}
+
+/// -(expression)
+template <class L, class O, class R>
+inline FluxExpr<FluxConst,FTimes,FluxExpr<L,O,R> >
+operator-( const FluxExpr<L,O,R>& e ) {
+    return -1. * e;
 }
 
 } // namespace ibpm
@@ -0,0 +1,60 @@
+// ForceHistory.cc
+//
+// Description:
+// Streaming iteration over the force history of saved snapshots: walks
+// a list of restart or time-series files and hands each record's
+// boundary force to a ForceProcessor callback, reading only the force
+// of each plain record.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 29 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "ForceHistory.h"
+#include "BoundaryVector.h"
+#include "State.h"
+#include "OutputSeries.h"
+#include <iostream>
+
+namespace ibpm {
+
+bool ProcessForceHistory( const std::vector<std::string>& files,
+                          ForceProcessor& proc ) {
+    BoundaryVector f( 0 );
+    int timestep;
+    double time;
+    double dx;
+    for (unsigned int i=0; i<files.size(); ++i) {
+        const std::string& name = files[i];
+        int numFrames = OutputSeries::getNumFrames( name );
+        if ( numFrames >= 0 ) {
+            // Time-series file: visit each frame in order
+            for (int frame=0; frame<numFrames; ++frame) {
+                if ( ! OutputSeries::loadFrameForce( name, frame, f,
+                        timestep, time, dx ) ) {
+                    cerr << "ERROR: could not read frame " << frame
+                         << " of series file " << name << endl;
+                    return false;
+                }
+                proc.processForce( timestep, time, dx, f );
+            }
+        }
+        else {
+            // Single snapshot
+            if ( ! State::loadForce( name, f, timestep, time, dx ) ) {
+                cerr << "ERROR: could not read force from " << name << endl;
+                return false;
+            }
+            proc.processForce( timestep, time, dx, f );
+        }
+    }
+    return true;
+}
+
+} // namespace ibpm
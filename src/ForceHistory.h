@@ -0,0 +1,52 @@
+#ifndef _FORCEHISTORY_H_
+#define _FORCEHISTORY_H_
+
+#include <string>
+#include <vector>
+
+namespace ibpm {
+
+class BoundaryVector;
+
+/*!
+    \file ForceHistory.h
+
+    \brief Streaming iteration over the force history of saved snapshots
+
+    Postprocessing the force history of a long run means visiting many
+    snapshots, whether stored as one restart file per step or as frames
+    of a time-series file (see OutputSeries).  ProcessForceHistory walks
+    a list of such files in order and hands each record's boundary force
+    to a user-supplied ForceProcessor, reading only the force of each
+    plain record (State::loadForce), so scanning thousands of snapshots
+    does not touch their field data.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 29 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+/// \brief Callback interface for ProcessForceHistory: processForce is
+/// called once per snapshot, in file order, with the record's timestep,
+/// time, grid spacing (for the dx^2 weighting of net forces; see
+/// State::computeNetForce), and boundary force
+class ForceProcessor {
+public:
+    virtual ~ForceProcessor() {}
+    virtual void processForce( int timestep, double time, double dx,
+                               const BoundaryVector& f ) = 0;
+};
+
+/// \brief Stream the force of every record in the given files through
+/// proc.  Each file may be a restart/snapshot file (plain, compressed,
+/// delta, or compact) or a time-series file, whose frames are visited
+/// in order.  Returns false (after reporting the offending file) if any
+/// file cannot be read
+bool ProcessForceHistory( const std::vector<std::string>& files,
+                          ForceProcessor& proc );
+
+} // namespace ibpm
+
+#endif /* _FORCEHISTORY_H_ */
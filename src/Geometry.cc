@@ -16,6 +16,7 @@
 #include "Motion.h"
 #include "RigidBody.h"
 #include "Regularizer.h"
+#include "Threads.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -31,11 +32,15 @@ namespace ibpm {
 Geometry::Geometry() {
     _numPoints = 0;
     _isStationary = true;
+    _gridDx = 0;
+    _cacheValid = false;
 }
 
 Geometry::Geometry(string filename) {
     _numPoints = 0;
     _isStationary = true;
+    _gridDx = 0;
+    _cacheValid = false;
     load( filename );
 }
 
@@ -66,7 +71,8 @@ Motion* Geometry::transferMotion() {
     for (body = _bodies.begin(); body != _bodies.end(); ++body) {
         if( body->isStationary() == false ) _isStationary = false;
     }
-    return tempmotion->clone(); 
+    _cacheValid = false;
+    return tempmotion->clone();
 } 
 
 void Geometry::transferCenter(double &x, double &y) {
@@ -76,54 +82,79 @@ void Geometry::transferCenter(double &x, double &y) {
     body->getCenter(x,y);
 }
 
-BoundaryVector Geometry::getPoints() const {
-    BoundaryVector coords(_numPoints);
+void Geometry::rebuildCache() const {
+    if ( _points.getNumPoints() != _numPoints ) {
+        _points.resize( _numPoints );
+        _velocities.resize( _numPoints );
+    }
     vector<RigidBody>::const_iterator body;
-
     int ind = 0;
     for (body = _bodies.begin(); body != _bodies.end(); ++body) {
         BoundaryVector bodyCoords = body->getPoints();
+        BoundaryVector bodyVel = body->getVelocities();
         for (int bodyInd=0; bodyInd < bodyCoords.getNumPoints(); ++bodyInd) {
-            coords(X,ind) = bodyCoords(X,bodyInd);
-            coords(Y,ind) = bodyCoords(Y,bodyInd);
+            _points(X,ind) = bodyCoords(X,bodyInd);
+            _points(Y,ind) = bodyCoords(Y,bodyInd);
+            _velocities(X,ind) = bodyVel(X,bodyInd);
+            _velocities(Y,ind) = bodyVel(Y,bodyInd);
             ++ind;
         }
     }
-    return coords;
+    _cacheValid = true;
 }
 
-BoundaryVector Geometry::getVelocities() const {
-    BoundaryVector velocities(_numPoints);
-    vector<RigidBody>::const_iterator body;
+const BoundaryVector& Geometry::getPoints() const {
+    if ( ! _cacheValid ) rebuildCache();
+    return _points;
+}
 
-    int ind = 0;
-    for (body = _bodies.begin(); body != _bodies.end(); ++body) {
-        BoundaryVector bodyVel = body->getVelocities();
-        for (int bodyInd=0; bodyInd < bodyVel.getNumPoints(); ++bodyInd) {
-            velocities(X,ind) = bodyVel(X,bodyInd);
-            velocities(Y,ind) = bodyVel(Y,bodyInd);
-            ++ind;
-        }
+const BoundaryVector& Geometry::getVelocities() const {
+    if ( ! _cacheValid ) rebuildCache();
+    return _velocities;
+}
+
+int Geometry::getBodyOffset( int i ) const {
+    int offset = 0;
+    for (int b=0; b<i; ++b) {
+        offset += _bodies[b].getNumPoints();
     }
-    return velocities;
+    return offset;
 }
 
-bool Geometry::isStationary() const { 
+bool Geometry::isStationary() const {
     return _isStationary;
 }
 
-void Geometry::moveBodies(double time) const {
-    // Update the positions and velocities of the associated RigidBodies
+bool Geometry::isMirrorSymmetric() const {
+    if ( _bodies.empty() ) return false;
     vector<RigidBody>::const_iterator body;
     for (body = _bodies.begin(); body != _bodies.end(); ++body) {
-        body->moveBody(time);
+        if ( ! body->isMirrorSymmetric() ) return false;
+    }
+    return true;
+}
+
+void Geometry::moveBodies(double time) const {
+    // Update the positions and velocities of the associated RigidBodies.
+    // Each body updates only its own point arrays, so the bodies are
+    // moved concurrently; dynamic scheduling keeps one expensive motion
+    // (e.g. file playback over a long record) from holding up the rest
+    int numBodies = (int) _bodies.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 && numBodies > 1 )
+#endif
+    for (int b = 0; b < numBodies; ++b) {
+        _bodies[b].moveBody(time);
     }
+    _cacheValid = false;
 }
 
 void Geometry::addBody(const RigidBody& body) {
     _bodies.push_back(body);
     _numPoints += body.getNumPoints();
     _isStationary = _isStationary && body.isStationary();
+    _cacheValid = false;
 }
 
 // Input format is as follows:
@@ -166,6 +197,7 @@ bool Geometry::load(istream& in) {
             EatWhitespace( name );
             RigidBody body;
             body.setName( name );
+            body.setGridSpacing( _gridDx );
             if ( body.load( in ) ) {
                 addBody( body );
 #ifdef DEBUG
@@ -53,6 +53,11 @@ public:
         return _bodies.size();
     }
 
+    /// \brief Return the body with the given index
+    inline const RigidBody& getBody( int i ) const {
+        return _bodies[i];
+    }
+
     /// \brief Return motion from one of the bodies, and clear that motion
     /// useful for unsteady baseflow, since we want to initialize baseFlow's motion
     /// from the motion in a geometry.  We need to get that motion, and then remove it from the 
@@ -62,18 +67,41 @@ public:
     /// \brief Fill (x,y) with the center of rotation of the first RigidBody
     void transferCenter(double &x, double &y);
 
-    /// \brief Return the boundary points in the geometry
-    BoundaryVector getPoints() const;
-    
-    /// \brief Return the velocities of the boundary points
-    BoundaryVector getVelocities() const;
+    /// \brief Return the boundary points in the geometry.
+    /// The assembled vector is cached, and the cache invalidated by
+    /// moveBodies, so repeated calls between geometry updates (every
+    /// timestep, for moving geometry) do not re-copy the coordinates
+    const BoundaryVector& getPoints() const;
+
+    /// \brief Return the velocities of the boundary points, cached as
+    /// for getPoints
+    const BoundaryVector& getVelocities() const;
+
+    /// \brief Return the index of the first point of body i within the
+    /// assembled vectors: body i occupies the index range
+    /// [getBodyOffset(i), getBodyOffset(i) + getBody(i).getNumPoints()),
+    /// so per-body consumers (see Regularizer::updateBody) can view
+    /// their span of the cached vectors instead of copying per body
+    int getBodyOffset( int i ) const;
 
     /// \brief Return true if the body is not moving; false otherwise
     bool isStationary() const;
 
+    /// \brief Return true if every body declares mirror symmetry about
+    /// the x-axis (see RigidBody::setMirrorSymmetric)
+    bool isMirrorSymmetric() const;
+
     /// \brief Move the boundary points and update their velocities
     void moveBodies(double time) const;
 
+    /// \brief Set the finest grid spacing, passed on to each RigidBody
+    /// loaded, for the grid-aware generator commands (circle_grid,
+    /// line_grid).  Call before load() so a single geometry file can be
+    /// reused across a grid-refinement sweep.
+    inline void setGridSpacing(double dx) {
+        _gridDx = dx;
+    }
+
     /// \brief Load a geometry from the specified input stream.
     /// Returns false if invalid input was encountered
     /// Input format is as follows:
@@ -97,9 +125,19 @@ public:
     bool load(string filename);
     
 private:
+    // Assemble the cached point and velocity vectors from the bodies
+    void rebuildCache() const;
+
     vector<RigidBody> _bodies;
     int _numPoints;
     bool _isStationary;
+    double _gridDx;
+    // Cached assembled point/velocity vectors (see getPoints); mutable
+    // because the cache is rebuilt lazily from const accessors, and
+    // invalidated by moveBodies, which is const
+    mutable BoundaryVector _points;
+    mutable BoundaryVector _velocities;
+    mutable bool _cacheValid;
 };
 
 } // namespace
@@ -0,0 +1,536 @@
+// GlobalModes.cc
+//
+// Description:
+// Implementation of the GlobalModeSolver class
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "GlobalModes.h"
+#include "Grid.h"
+#include "NavierStokesModel.h"
+#include "IBSolver.h"
+#include "State.h"
+#include "VectorOperations.h"
+#include "ScalarToTecplot.h"
+#include "RandomNumber.h"
+#include "Memory.h"
+#include <complex>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+
+namespace ibpm {
+
+typedef complex<double> Cplx;
+
+GlobalModeSolver::GlobalModeSolver(
+    Grid& grid,
+    NavierStokesModel& model,
+    IBSolver& solver,
+    double dt,
+    const string& outputBasename
+    ) :
+    _grid( grid ),
+    _model( model ),
+    _solver( solver ),
+    _dt( dt ),
+    _basename( outputBasename ),
+    _single( false ),
+    _numRows( 0 ) {
+}
+
+void GlobalModeSolver::applyOperator(
+    const Scalar& v,
+    Scalar& Gv,
+    int stepsPerMatvec
+    ) {
+    State p( _grid, _model.getNumPoints() );
+    p.omega = v;
+    p.q = 0.;
+    p.f = 0.;
+    _model.refreshState( p );
+    // Clear any multistep history: each product starts a fresh
+    // trajectory from an arbitrary vorticity field
+    _solver.reset();
+    for ( int i = 0; i < stepsPerMatvec; ++i ) {
+        _solver.advance( p );
+    }
+    Gv = p.omega;
+}
+
+void GlobalModeSolver::appendBasis( const Scalar& v ) {
+    int ngrid = v.Ngrid();
+    int nx = v.Nx();
+    int ny = v.Ny();
+    if ( _numRows == 0 ) {
+        _numRows = ngrid * (nx-1) * (ny-1);
+    }
+    if ( _single ) {
+        _basisF.push_back( vector<float>() );
+        vector<float>& col = _basisF.back();
+        col.reserve( _numRows );
+        for ( int lev = 0; lev < ngrid; ++lev ) {
+            for ( int i = 1; i < nx; ++i ) {
+                for ( int j = 1; j < ny; ++j ) {
+                    col.push_back( (float) v(lev,i,j) );
+                }
+            }
+        }
+        Memory::recordAlloc( Memory::OTHER, _numRows * sizeof(float) );
+    }
+    else {
+        _basisD.push_back( vector<double>() );
+        vector<double>& col = _basisD.back();
+        col.reserve( _numRows );
+        for ( int lev = 0; lev < ngrid; ++lev ) {
+            for ( int i = 1; i < nx; ++i ) {
+                for ( int j = 1; j < ny; ++j ) {
+                    col.push_back( v(lev,i,j) );
+                }
+            }
+        }
+        Memory::recordAlloc( Memory::OTHER, _numRows * sizeof(double) );
+    }
+}
+
+void GlobalModeSolver::unpackBasis( int col, Scalar& v ) const {
+    int ngrid = v.Ngrid();
+    int nx = v.Nx();
+    int ny = v.Ny();
+    int idx = 0;
+    if ( _single ) {
+        const vector<float>& c = _basisF[col];
+        for ( int lev = 0; lev < ngrid; ++lev ) {
+            for ( int i = 1; i < nx; ++i ) {
+                for ( int j = 1; j < ny; ++j ) {
+                    v(lev,i,j) = c[idx++];
+                }
+            }
+        }
+    }
+    else {
+        const vector<double>& c = _basisD[col];
+        for ( int lev = 0; lev < ngrid; ++lev ) {
+            for ( int i = 1; i < nx; ++i ) {
+                for ( int j = 1; j < ny; ++j ) {
+                    v(lev,i,j) = c[idx++];
+                }
+            }
+        }
+    }
+}
+
+void GlobalModeSolver::clearBasis() {
+    if ( _single ) {
+        Memory::recordFree( Memory::OTHER,
+            _basisF.size() * (size_t) _numRows * sizeof(float) );
+        _basisF.clear();
+    }
+    else {
+        Memory::recordFree( Memory::OTHER,
+            _basisD.size() * (size_t) _numRows * sizeof(double) );
+        _basisD.clear();
+    }
+}
+
+// Eigenvalues of an n x n upper Hessenberg matrix A (column-major,
+// destroyed), by the shifted QR iteration in complex arithmetic with
+// Givens rotations.  n is the Krylov dimension, so this is microseconds
+static void hessenbergEigenvalues( vector<Cplx>& A, int n,
+    vector<Cplx>& eig ) {
+    const double eps = 1e-14;
+    eig.assign( n, Cplx( 0., 0. ) );
+    int hi = n - 1;
+    int iter = 0;
+    int maxIter = 30 * n;
+    vector<Cplx> us( n ), vs( n );
+    while ( hi >= 0 ) {
+        if ( hi == 0 ) {
+            eig[0] = A[0];
+            break;
+        }
+        // Deflate at a negligible subdiagonal entry
+        int lo = hi;
+        while ( lo > 0 && abs( A[lo + (lo-1)*n] ) >
+                eps * ( abs( A[(lo-1) + (lo-1)*n] ) + abs( A[lo + lo*n] ) ) ) {
+            --lo;
+        }
+        if ( lo == hi ) {
+            eig[hi] = A[hi + hi*n];
+            --hi;
+            continue;
+        }
+        if ( ++iter > maxIter ) {
+            // Stagnation (should not happen): accept the diagonal of
+            // the unconverged block rather than loop forever
+            for ( int i = lo; i <= hi; ++i ) eig[i] = A[i + i*n];
+            hi = lo - 1;
+            continue;
+        }
+        // Wilkinson shift: the eigenvalue of the trailing 2 x 2 block
+        // closest to its lower-right entry
+        Cplx a = A[(hi-1) + (hi-1)*n];
+        Cplx b = A[(hi-1) + hi*n];
+        Cplx c = A[hi + (hi-1)*n];
+        Cplx d = A[hi + hi*n];
+        Cplx tr = a + d;
+        Cplx disc = sqrt( tr * tr - 4. * ( a * d - b * c ) );
+        Cplx mu1 = 0.5 * ( tr + disc );
+        Cplx mu2 = 0.5 * ( tr - disc );
+        Cplx sigma = ( abs( mu1 - d ) < abs( mu2 - d ) ) ? mu1 : mu2;
+        for ( int i = lo; i <= hi; ++i ) A[i + i*n] -= sigma;
+        // A - sigma I = QR by Givens rotations on the active block...
+        for ( int k = lo; k < hi; ++k ) {
+            Cplx x = A[k + k*n];
+            Cplx y = A[(k+1) + k*n];
+            double r = sqrt( norm( x ) + norm( y ) );
+            Cplx u( 1., 0. ), v( 0., 0. );
+            if ( r > 0. ) {
+                u = x / r;
+                v = y / r;
+            }
+            us[k] = u;
+            vs[k] = v;
+            for ( int j = k; j <= hi; ++j ) {
+                Cplx t1 = A[k + j*n];
+                Cplx t2 = A[(k+1) + j*n];
+                A[k + j*n] = conj( u ) * t1 + conj( v ) * t2;
+                A[(k+1) + j*n] = -v * t1 + u * t2;
+            }
+        }
+        // ...then A <- R Q + sigma I restores Hessenberg form
+        for ( int k = lo; k < hi; ++k ) {
+            Cplx u = us[k];
+            Cplx v = vs[k];
+            int imax = ( k + 1 < hi ) ? k + 1 : hi;
+            for ( int i = lo; i <= imax; ++i ) {
+                Cplx t1 = A[i + k*n];
+                Cplx t2 = A[i + (k+1)*n];
+                A[i + k*n] = u * t1 + v * t2;
+                A[i + (k+1)*n] = -conj( v ) * t1 + conj( u ) * t2;
+            }
+        }
+        for ( int i = lo; i <= hi; ++i ) A[i + i*n] += sigma;
+    }
+}
+
+// Unit eigenvector of the n x n matrix H (column-major) for the
+// eigenvalue lambda, by inverse iteration: two solves with an LU
+// factorization of H shifted slightly off the exact eigenvalue
+static void ritzEigenvector( const vector<Cplx>& H, int n, Cplx lambda,
+    vector<Cplx>& y ) {
+    vector<Cplx> B( H );
+    Cplx shift = lambda + ( abs( lambda ) + 1. ) * 1e-12;
+    for ( int i = 0; i < n; ++i ) B[i + i*n] -= shift;
+    // LU with partial pivoting
+    vector<int> piv( n );
+    for ( int k = 0; k < n; ++k ) {
+        int p = k;
+        for ( int i = k + 1; i < n; ++i ) {
+            if ( abs( B[i + k*n] ) > abs( B[p + k*n] ) ) p = i;
+        }
+        piv[k] = p;
+        if ( p != k ) {
+            for ( int j = 0; j < n; ++j ) {
+                Cplx t = B[k + j*n];
+                B[k + j*n] = B[p + j*n];
+                B[p + j*n] = t;
+            }
+        }
+        Cplx pivot = B[k + k*n];
+        if ( abs( pivot ) < 1e-300 ) {
+            pivot = Cplx( 1e-300, 0. );
+            B[k + k*n] = pivot;
+        }
+        for ( int i = k + 1; i < n; ++i ) {
+            Cplx m = B[i + k*n] / pivot;
+            B[i + k*n] = m;
+            for ( int j = k + 1; j < n; ++j ) {
+                B[i + j*n] -= m * B[k + j*n];
+            }
+        }
+    }
+    y.assign( n, Cplx( 1., 0. ) );
+    for ( int pass = 0; pass < 2; ++pass ) {
+        for ( int k = 0; k < n; ++k ) {
+            if ( piv[k] != k ) {
+                Cplx t = y[k];
+                y[k] = y[piv[k]];
+                y[piv[k]] = t;
+            }
+            for ( int i = k + 1; i < n; ++i ) y[i] -= B[i + k*n] * y[k];
+        }
+        for ( int k = n - 1; k >= 0; --k ) {
+            for ( int j = k + 1; j < n; ++j ) y[k] -= B[k + j*n] * y[j];
+            y[k] /= B[k + k*n];
+        }
+        double s = 0.;
+        for ( int i = 0; i < n; ++i ) s += norm( y[i] );
+        s = sqrt( s );
+        if ( s > 0. ) {
+            for ( int i = 0; i < n; ++i ) y[i] /= s;
+        }
+    }
+}
+
+bool GlobalModeSolver::computeModes(
+    int numModes,
+    int krylovDim,
+    int stepsPerMatvec,
+    int maxRestarts,
+    double tol,
+    bool singlePrecisionBasis,
+    double& leadingGrowthRate
+    ) {
+    leadingGrowthRate = 0.;
+    if ( numModes < 1 ) return false;
+    int m = krylovDim;
+    if ( m < numModes + 2 ) m = numModes + 2;
+    if ( stepsPerMatvec < 1 ) stepsPerMatvec = 1;
+    if ( maxRestarts < 0 ) maxRestarts = 0;
+    double T = stepsPerMatvec * _dt;
+    _single = singlePrecisionBasis;
+    // A float32 basis halves the memory but limits the attainable
+    // residual to roughly single-precision roundoff
+    if ( _single && tol < 1e-6 ) tol = 1e-6;
+
+    cout << "Global modes by Arnoldi iteration: " << numModes
+        << " modes, subspace " << m << ", " << stepsPerMatvec
+        << " steps per matvec" << endl;
+
+    // Fixed seed, so a rerun reproduces the same modes to roundoff
+    Scalar v0( _grid );
+    RandomizeScalar( v0, 1729 );
+    double nrm = sqrt( InnerProduct( v0, v0 ) );
+    v0 *= 1. / nrm;
+
+    Scalar w( _grid ), vk( _grid ), vi( _grid );
+    vector<double> H;               // (m+1) x m, column-major
+    vector<Cplx> Hc;                // leading mEff x mEff block
+    vector<Cplx> ritzVal;           // Ritz values, by descending |lambda|
+    vector< vector<Cplx> > ritzY;   // matching eigenvectors of Hc
+    vector<double> ritzRes;         // residual estimates, relative
+    int mEff = m;
+
+    for ( int restart = 0; ; ++restart ) {
+        clearBasis();
+        appendBasis( v0 );
+        H.assign( (size_t) (m+1) * m, 0. );
+        mEff = m;
+        bool breakdown = false;
+        for ( int k = 0; k < m; ++k ) {
+            cout << "    matvec " << k+1 << "/" << m << endl;
+            unpackBasis( k, vk );
+            applyOperator( vk, w, stepsPerMatvec );
+            // Modified Gram-Schmidt against the stored basis
+            for ( int i = 0; i <= k; ++i ) {
+                unpackBasis( i, vi );
+                double h = InnerProduct( w, vi );
+                H[i + k*(m+1)] = h;
+                w -= h * vi;
+            }
+            double hNext = sqrt( InnerProduct( w, w ) );
+            H[(k+1) + k*(m+1)] = hNext;
+            if ( hNext < 1e-12 ) {
+                // Exact invariant subspace: the Ritz pairs found so
+                // far are exact
+                mEff = k + 1;
+                breakdown = true;
+                break;
+            }
+            if ( k + 1 < m ) {
+                w *= 1. / hNext;
+                appendBasis( w );
+            }
+        }
+
+        // Ritz pairs of the leading mEff x mEff Hessenberg block
+        int n = mEff;
+        Hc.assign( (size_t) n * n, Cplx( 0., 0. ) );
+        for ( int j = 0; j < n; ++j ) {
+            int imax = ( j + 1 < n ) ? j + 1 : n - 1;
+            for ( int i = 0; i <= imax; ++i ) {
+                Hc[i + j*n] = Cplx( H[i + j*(m+1)], 0. );
+            }
+        }
+        vector<Cplx> work( Hc );
+        vector<Cplx> eig( n );
+        hessenbergEigenvalues( work, n, eig );
+        vector<int> order( n );
+        for ( int j = 0; j < n; ++j ) order[j] = j;
+        for ( int j = 0; j < n - 1; ++j ) {
+            int best = j;
+            for ( int i = j + 1; i < n; ++i ) {
+                if ( abs( eig[order[i]] ) > abs( eig[order[best]] ) ) {
+                    best = i;
+                }
+            }
+            int tmp = order[j]; order[j] = order[best]; order[best] = tmp;
+        }
+        double hLast = breakdown ? 0. : H[n + (n-1)*(m+1)];
+        ritzVal.clear();
+        ritzY.clear();
+        ritzRes.clear();
+        for ( int j = 0; j < n; ++j ) {
+            Cplx lambda = eig[order[j]];
+            vector<Cplx> y;
+            ritzEigenvector( Hc, n, lambda, y );
+            double denom = abs( lambda ) > 1e-30 ? abs( lambda ) : 1e-30;
+            ritzVal.push_back( lambda );
+            ritzY.push_back( y );
+            ritzRes.push_back( fabs( hLast ) * abs( y[n-1] ) / denom );
+        }
+
+        int wanted = ( numModes < n ) ? numModes : n;
+        int converged = 0;
+        for ( int j = 0; j < wanted; ++j ) {
+            if ( ritzRes[j] <= tol ) ++converged;
+        }
+        cout << "    restart " << restart << ": " << converged << "/"
+            << wanted << " Ritz pairs converged (worst residual "
+            << ritzRes[wanted-1] << ")" << endl;
+        if ( converged >= wanted || restart >= maxRestarts || breakdown ) {
+            break;
+        }
+        // Explicit restart from a combination of the leading Ritz
+        // vectors, so the next subspace starts inside the wanted
+        // invariant subspace
+        v0 = 0.;
+        for ( int j = 0; j < wanted; ++j ) {
+            for ( int i = 0; i < n; ++i ) {
+                double cr = ritzY[j][i].real() + ritzY[j][i].imag();
+                if ( cr == 0. ) continue;
+                unpackBasis( i, vi );
+                v0 += cr * vi;
+            }
+        }
+        nrm = sqrt( InnerProduct( v0, v0 ) );
+        if ( nrm < 1e-12 ) {
+            RandomizeScalar( v0, 1729 + restart + 1 );
+            nrm = sqrt( InnerProduct( v0, v0 ) );
+        }
+        v0 *= 1. / nrm;
+    }
+
+    // Select the leading distinct modes: the conjugate partner of a
+    // complex pair duplicates its mode, so keep only the nonnegative
+    // frequency of each pair
+    int n = mEff;
+    vector<int> selected;
+    for ( int j = 0; j < n && (int) selected.size() < numModes; ++j ) {
+        if ( ritzVal[j].imag() < 0. ) {
+            bool hasConjugate = false;
+            Cplx conjVal = conj( ritzVal[j] );
+            for ( int i = 0; i < n; ++i ) {
+                if ( i != j && abs( ritzVal[i] - conjVal ) <=
+                        1e-8 * ( abs( ritzVal[j] ) + 1. ) ) {
+                    hasConjugate = true;
+                    break;
+                }
+            }
+            if ( hasConjugate ) continue;
+        }
+        selected.push_back( j );
+    }
+
+    // Assemble the candidate modes and verify them against the true
+    // operator: propagate the real and imaginary parts of all modes in
+    // one batched advance, so each substep's projection operators are
+    // traversed once for the whole block
+    int numSelected = selected.size();
+    Scalar zero( _grid );
+    zero = 0.;
+    vector<Scalar> modeRe( numSelected, zero );
+    vector<Scalar> modeIm( numSelected, zero );
+    for ( int j = 0; j < numSelected; ++j ) {
+        const vector<Cplx>& y = ritzY[selected[j]];
+        for ( int i = 0; i < n; ++i ) {
+            unpackBasis( i, vi );
+            if ( y[i].real() != 0. ) modeRe[j] += y[i].real() * vi;
+            if ( y[i].imag() != 0. ) modeIm[j] += y[i].imag() * vi;
+        }
+    }
+    clearBasis();
+    vector<State> block;
+    State proto( _grid, _model.getNumPoints() );
+    for ( int j = 0; j < numSelected; ++j ) {
+        proto.omega = modeRe[j];
+        proto.q = 0.;
+        proto.f = 0.;
+        _model.refreshState( proto );
+        block.push_back( proto );
+        proto.omega = modeIm[j];
+        _model.refreshState( proto );
+        block.push_back( proto );
+    }
+    _solver.reset();
+    for ( int i = 0; i < stepsPerMatvec; ++i ) {
+        _solver.advance( block );
+    }
+
+    // Write the eigenvalue file, and a Tecplot file for each mode whose
+    // true residual is below tolerance
+    string eigFile = _basename + "_globalmodes.eig";
+    FILE* fp = fopen( eigFile.c_str(), "w" );
+    if ( fp == NULL ) return false;
+    fprintf( fp, "# global modes: eigenvalues of the T = %g propagator\n",
+        T );
+    fprintf( fp, "# mode  Re(lambda)  Im(lambda)  growth rate  frequency"
+        "  residual\n" );
+    bool status = true;
+    for ( int j = 0; j < numSelected; ++j ) {
+        Cplx lambda = ritzVal[selected[j]];
+        double lr = lambda.real();
+        double li = lambda.imag();
+        // Residual || G y - lambda y || of the complex mode, relative
+        // to |lambda| (the modes have unit norm)
+        Scalar rRe = block[2*j].omega;
+        rRe -= lr * modeRe[j];
+        rRe += li * modeIm[j];
+        Scalar rIm = block[2*j+1].omega;
+        rIm -= lr * modeIm[j];
+        rIm -= li * modeRe[j];
+        double denom = abs( lambda ) > 1e-30 ? abs( lambda ) : 1e-30;
+        double res = sqrt( InnerProduct( rRe, rRe )
+            + InnerProduct( rIm, rIm ) ) / denom;
+        double growth = log( denom ) / T;
+        double freq = arg( lambda ) / T;
+        fprintf( fp, "%d %.10e %.10e %.10e %.10e %.3e\n",
+            j + 1, lr, li, growth, freq, res );
+        if ( j == 0 ) leadingGrowthRate = growth;
+        // Written negated so a NaN residual also counts as unconverged
+        if ( ! ( res <= tol ) ) {
+            cout << "    mode " << j+1 << ": residual " << res
+                << " above tolerance, not written" << endl;
+            continue;
+        }
+        vector<const Scalar*> fields;
+        vector<string> names;
+        fields.push_back( &modeRe[j] ); names.push_back( "omega_re" );
+        fields.push_back( &modeIm[j] ); names.push_back( "omega_im" );
+        char title[256];
+        sprintf( title, "Global mode %d: growth rate = %g, "
+            "frequency = %g", j + 1, growth, freq );
+        char modeSuffix[64];
+        sprintf( modeSuffix, "_gmode%02d.plt", j + 1 );
+        status = ScalarToTecplot( fields, names,
+            _basename + modeSuffix, title ) && status;
+    }
+    fclose( fp );
+    cout << "    leading growth rate " << leadingGrowthRate << endl;
+    return status;
+}
+
+} // namespace ibpm
@@ -0,0 +1,93 @@
+#ifndef _GLOBALMODES_H_
+#define _GLOBALMODES_H_
+
+#include <string>
+// for IBSolver; Scheme.h itself has no include guard
+#include "IBSolver.h"
+#include "Scalar.h"
+#include <vector>
+
+namespace ibpm {
+
+/*!
+    \file GlobalModes.h
+    \class GlobalModeSolver
+
+    \brief Matrix-free Arnoldi computation of global stability modes
+
+    Computes the leading eigenvalues and eigenmodes of the propagator
+    G = exp(A T) of the linearized equations about a base flow, without
+    ever forming A.  The action of G on a vorticity field is a few
+    timesteps of the LinearizedIBSolver, so the Krylov basis is built
+    in-process -- kept in memory, optionally in single precision --
+    rather than by exporting snapshots to an external Arnoldi code.
+    The Ritz pairs of the small Hessenberg matrix are verified against
+    the true operator by propagating all the candidate modes in one
+    batched advance, and only the converged ones are written out.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 30 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+class GlobalModeSolver {
+public:
+    /// \brief Constructor.
+    /// \param[in] model    model with the base flow, used to refresh
+    ///                     perturbation states between steps
+    /// \param[in] solver   initialized LinearizedIBSolver about the base flow
+    /// \param[in] outputBasename basename for the eigenvalue and mode files
+    GlobalModeSolver(
+        Grid& grid,
+        NavierStokesModel& model,
+        IBSolver& solver,
+        double dt,
+        const std::string& outputBasename
+    );
+
+    /// \brief Compute the numModes leading global modes (by magnitude of
+    /// the propagator eigenvalue, i.e. by growth rate) from a Krylov
+    /// subspace of dimension krylovDim, each matrix-vector product being
+    /// stepsPerMatvec timesteps of the linearized solver.  The iteration
+    /// is restarted from a combination of the leading Ritz vectors up to
+    /// maxRestarts times if fewer than numModes pairs reach a relative
+    /// residual of tol.  With singlePrecisionBasis the Krylov basis is
+    /// stored as float32, halving its memory.  Writes an eigenvalue file
+    /// and one Tecplot file per converged mode; returns the leading
+    /// growth rate in leadingGrowthRate
+    bool computeModes( int numModes, int krylovDim, int stepsPerMatvec,
+        int maxRestarts, double tol, bool singlePrecisionBasis,
+        double& leadingGrowthRate );
+
+private:
+    /// Apply the propagator: stepsPerMatvec linearized steps from the
+    /// perturbation vorticity v
+    void applyOperator( const Scalar& v, Scalar& Gv, int stepsPerMatvec );
+
+    /// Append a normalized Krylov vector to the in-memory basis
+    void appendBasis( const Scalar& v );
+
+    /// Copy basis column j back into a Scalar
+    void unpackBasis( int j, Scalar& v ) const;
+
+    /// Release the basis (and its memory accounting)
+    void clearBasis();
+
+    Grid& _grid;
+    NavierStokesModel& _model;
+    IBSolver& _solver;
+    double _dt;
+    std::string _basename;
+    // Krylov basis, flattened over the interior vorticity points of all
+    // grid levels; one of the two stores is used, per the precision flag
+    bool _single;
+    int _numRows;
+    std::vector< std::vector<float> > _basisF;
+    std::vector< std::vector<double> > _basisD;
+};
+
+} // namespace ibpm
+
+#endif /* _GLOBALMODES_H_ */
@@ -76,6 +76,7 @@ void Grid::resize(
     _xOffset = xOffset;
     _yOffset = yOffset;
     _dx = length / nx;
+    updateCoordinateCache();
 }
 	
 /// Set all grid parameters
@@ -98,6 +99,29 @@ void Grid::resize(
 	_xShift = xShift;
 	_yShift = yShift;
 	_dx = length / nx;
+	updateCoordinateCache();
+}
+
+// Precompute the edge and center coordinates of every level, so that the
+// coordinate accessors are array reads rather than arithmetic per call
+void Grid::updateCoordinateCache() {
+    _xEdge.resize( _ngrid * (_nx+1) );
+    _xCenter.resize( _ngrid * (_nx+1) );
+    _yEdge.resize( _ngrid * (_ny+1) );
+    _yCenter.resize( _ngrid * (_ny+1) );
+    for (int lev=0; lev < _ngrid; ++lev) {
+        double xOff = getXOffset(lev);
+        double yOff = getYOffset(lev);
+        double dx = Dx(lev);
+        for (int i=0; i <= _nx; ++i) {
+            _xEdge[lev*(_nx+1) + i] = xOff + i * dx;
+            _xCenter[lev*(_nx+1) + i] = xOff + (i+0.5) * dx;
+        }
+        for (int j=0; j <= _ny; ++j) {
+            _yEdge[lev*(_ny+1) + j] = yOff + j * dx;
+            _yCenter[lev*(_ny+1) + j] = yOff + (j+0.5) * dx;
+        }
+    }
 }
 
 // Return the x-coordinate of the left-most gridpoint of level lev
@@ -110,39 +134,12 @@ double Grid::getYOffset(int lev) const {
     return _yOffset + 0.5 * ( _yShift - 1 ) * ( ( 1 << lev ) - 1 ) * (_ny * _dx);
 }
     
-// Return the x-coordinate of the center of cell i  (i in 0..m-1)
-double Grid::getXCenter(int lev, int i) const {
-    assert( lev >= 0 && lev <  _ngrid );
-    assert(   i >= 0 &&   i <= _nx );
-    return getXOffset(lev) + (i+0.5) * Dx(lev);
-}
-
-// Return the y-coordinate of the center of cell j  (j in 0..n-1)
-double Grid::getYCenter(int lev, int j) const {
-    assert( lev >= 0 && lev <  _ngrid );
-    assert(   j >= 0 &&   j <= _ny );
-    return getYOffset(lev) + (j+0.5) * Dx(lev);
-}
-
-// Return the x-coordinate of the left edge of cell i  (i in 0..m)
-double Grid::getXEdge(int lev, int i) const {
-    assert( lev >= 0 && lev <  _ngrid );
-    assert(   i >= 0 &&   i <= _nx );
-    return getXOffset(lev) + i * Dx(lev);
-}
-
-// Return the y-coordinate of the bottom edge of cell j  (j in 0..n)
-double Grid::getYEdge(int lev, int j) const {
-    assert( lev >= 0 && lev <  _ngrid );
-    assert(   j >= 0 &&   j <= _ny );
-    return getYOffset(lev) + j * Dx(lev);
-}
-
 // Set the shift parameter in x
 void Grid::setXShift( double xShift ) {
     assert( fabs( xShift ) <= 1 );
     assert( fmod( xShift*_nx,4 ) == 0 );
     _xShift = xShift;
+    updateCoordinateCache();
 }
 
 // Return the shift parameter in x
@@ -155,6 +152,7 @@ void Grid::setYShift( double yShift ) {
 	assert( fabs( yShift ) <= 1 );
 	assert( fmod( yShift*_ny,4 ) == 0 );
 	_yShift = yShift;
+	updateCoordinateCache();
 }
 	
 // Return the shift parameter in y
@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <vector>
 //JON
 #include <iostream>
 
@@ -100,19 +101,32 @@ public:
 	// However, due to asserts enforced in Grid.cc, this is nominally an integer already
     inline int NyExt() const { return (int) floor( _ny / 4 * ( 1 - _yShift ) + 0.5 ); }
     
+    /// \brief Refinement ratio between consecutive grid levels.
+    /// The multi-domain scheme is derived for 2:1 nesting throughout:
+    /// besides the index maps c2f/f2c and the spacing Dx(lev) here, the
+    /// ratio is built into the extent formulas NxExt/NyExt (each fine
+    /// domain spans the central half of its coarse level), the
+    /// restriction stencil (Scalar::coarsify), the boundary
+    /// interpolation map (Scalar::updateBCIndex), and the hand-derived
+    /// interface quadrature of the level-coupling sweeps in
+    /// VectorOperations (the velocity/flux conversions and both curls),
+    /// so a different ratio requires rederiving those stencils, not
+    /// just changing this constant
+    static const int RefinementRatio = 2;
+
     /// Given indices (i,j) on a coarse grid, return corresponding indices
     /// (ii,jj) on the fine grid
     inline void c2f(int i, int j, int& ii, int& jj) const {
-        ii = (i - NxExt() ) * 2;
-        jj = (j - NyExt() ) * 2;
+        ii = (i - NxExt() ) * RefinementRatio;
+        jj = (j - NyExt() ) * RefinementRatio;
     }
 
     /// Given indices (ii,jj) on a fine grid, return indices (i,j) of the
     /// corresponding point on the coarse grid, or of the nearest point
     /// below and to the left
     inline void f2c(int ii, int jj, int& i, int& j) const {
-        i = ii/2 + NxExt();
-        j = jj/2 + NyExt();
+        i = ii/RefinementRatio + NxExt();
+        j = jj/RefinementRatio + NyExt();
     }
     
     /// Return number of grid levels for multi-domain solution
@@ -127,18 +141,66 @@ public:
         return _dx * (1 << lev);
     }
 
+    // The coordinates below are precomputed for every level when the grid
+    // is resized (or shifted), so each call is an array read; callers
+    // sweeping whole levels can grab the per-level arrays directly.
+
     /// Return the x-coordinate of the center of cell i  (i in 0..m-1)
-    double getXCenter(int lev, int i) const;
-    
+    inline double getXCenter(int lev, int i) const {
+        assert( lev >= 0 && lev <  _ngrid );
+        assert(   i >= 0 &&   i <= _nx );
+        return _xCenter[lev * (_nx+1) + i];
+    }
+
     /// Return the y-coordinate of the center of cell j  (j in 0..n-1)
-    double getYCenter(int lev, int j) const;
+    inline double getYCenter(int lev, int j) const {
+        assert( lev >= 0 && lev <  _ngrid );
+        assert(   j >= 0 &&   j <= _ny );
+        return _yCenter[lev * (_ny+1) + j];
+    }
 
     /// Return the x-coordinate of the left edge of cell i  (i in 0..m)
-    double getXEdge(int lev, int i) const;
-    
+    inline double getXEdge(int lev, int i) const {
+        assert( lev >= 0 && lev <  _ngrid );
+        assert(   i >= 0 &&   i <= _nx );
+        return _xEdge[lev * (_nx+1) + i];
+    }
+
     /// Return the y-coordinate of the bottom edge of cell j  (j in 0..n)
-    double getYEdge(int lev, int j) const;
-	
+    inline double getYEdge(int lev, int j) const {
+        assert( lev >= 0 && lev <  _ngrid );
+        assert(   j >= 0 &&   j <= _ny );
+        return _yEdge[lev * (_ny+1) + j];
+    }
+
+    /// Return the cached array of x-coordinates of cell edges at the
+    /// given level (length Nx()+1)
+    inline const double* xEdges(int lev) const {
+        assert( lev >= 0 && lev < _ngrid );
+        return &_xEdge[lev * (_nx+1)];
+    }
+
+    /// Return the cached array of y-coordinates of cell edges at the
+    /// given level (length Ny()+1)
+    inline const double* yEdges(int lev) const {
+        assert( lev >= 0 && lev < _ngrid );
+        return &_yEdge[lev * (_ny+1)];
+    }
+
+    /// Return the cached array of x-coordinates of cell centers at the
+    /// given level (length Nx())
+    inline const double* xCenters(int lev) const {
+        assert( lev >= 0 && lev < _ngrid );
+        return &_xCenter[lev * (_nx+1)];
+    }
+
+    /// Return the cached array of y-coordinates of cell centers at the
+    /// given level (length Ny())
+    inline const double* yCenters(int lev) const {
+        assert( lev >= 0 && lev < _ngrid );
+        return &_yCenter[lev * (_ny+1)];
+    }
+
     /// Return the grid index i corresponding to the given x-coordinate 
 	/// Currently, only works for the finest grid level. 
     int getXGridIndex( double x ) const;
@@ -165,6 +227,7 @@ public:
 private:
     double getXOffset( int lev ) const;
     double getYOffset( int lev ) const;
+    void updateCoordinateCache();
     int _nx;
     int _ny;
     int _ngrid;
@@ -173,6 +236,11 @@ private:
     double _yOffset;
     double _xShift;
 	double _yShift;
+    // Precomputed coordinates, one block of length (n+1) per level
+    std::vector<double> _xEdge;
+    std::vector<double> _yEdge;
+    std::vector<double> _xCenter;
+    std::vector<double> _yCenter;
 };
 
 } // namespace
@@ -9,7 +9,14 @@
 #include "Grid.h"
 #include "State.h"
 #include "VectorOperations.h"
+#include "Timers.h"
+#include "Tasks.h"
+#include "FlowMonitor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include <string.h>
 
 namespace ibpm {
 
@@ -28,8 +35,38 @@ IBSolver::IBSolver(
 	_Ntemp( grid ), 
 	_oldSaved( false ),
 	_solver( _scheme.nsteps() ),
-    _tol( 1e-7) {	
+    _tol( 1e-7 ),
+    _useUpdatedCholesky( false ),
+    _useSinglePrecisionCholesky( false ),
+    _usePreconditionedCG( false ),
+    _adaptive( false ),
+    _cfl( 0. ),
+    _dtNominal( dt ),
+    _tolSchedule( false ),
+    _stepsTaken( 0 ),
+    _tolTightened( false ),
+    _fPrevSched( NULL ),
+    _phaseCacheEnabled( false ),
+    _phaseSteps( 0 ),
+    _multirate( 1 ),
+    _nonlinearMaxLev( grid.Ngrid() ),
+    _NheldMR( grid ),
+    _NheldSaved( false ),
+    _errInterval( 0 ),
+    _errTol( 0. ),
+    _errEstimate( 0. ),
+    _errHalvings( 0 ),
+    _autoSolver( false ),
+    _autoPlannedSteps( 0 ),
+    _autoStepsTaken( 0 ),
+    _autoIterBase( -1 ),
+    _autoPhase( 0 ),
+    _autoFactorDone( 0 ),
+    _autoTask( NULL ),
+    _controller( NULL ),
+    _controllerGeometry( NULL ) {
 		createAllSolvers();
+		updateSchemeCoeffs();
 	}
 	
 IBSolver::IBSolver( 
@@ -48,11 +85,42 @@ IBSolver::IBSolver(
     _Ntemp( grid ), 
     _oldSaved( false ),
     _solver( _scheme.nsteps() ),
-    _tol( tol ) {	
+    _tol( tol ),
+    _useUpdatedCholesky( false ),
+    _useSinglePrecisionCholesky( false ),
+    _usePreconditionedCG( false ),
+    _adaptive( false ),
+    _cfl( 0. ),
+    _dtNominal( dt ),
+    _tolSchedule( false ),
+    _stepsTaken( 0 ),
+    _tolTightened( false ),
+    _fPrevSched( NULL ),
+    _phaseCacheEnabled( false ),
+    _phaseSteps( 0 ),
+    _multirate( 1 ),
+    _nonlinearMaxLev( grid.Ngrid() ),
+    _NheldMR( grid ),
+    _NheldSaved( false ),
+    _errInterval( 0 ),
+    _errTol( 0. ),
+    _errEstimate( 0. ),
+    _errHalvings( 0 ),
+    _autoSolver( false ),
+    _autoPlannedSteps( 0 ),
+    _autoStepsTaken( 0 ),
+    _autoIterBase( -1 ),
+    _autoPhase( 0 ),
+    _autoFactorDone( 0 ),
+    _autoTask( NULL ),
+    _controller( NULL ),
+    _controllerGeometry( NULL ) {
         createAllSolvers();
+        updateSchemeCoeffs();
 }
 	
 IBSolver::~IBSolver() {
+	delete _fPrevSched;
 	deleteAllSolvers();
 }
 	
@@ -70,9 +138,10 @@ void IBSolver::init() {
 	}
 }
     
-void IBSolver::reset() {	
+void IBSolver::reset() {
     _oldSaved = false;
-}    
+    _NheldSaved = false;
+}
 	
 bool IBSolver::load(const string& basename) {
 	bool successInit = false;
@@ -106,31 +175,205 @@ bool IBSolver::save(const string& basename) {
 	
 	return successInit && successTemp;
 }
-	
+
+// History file layout (version 1): magic and version, then the scheme
+// and grid parameters the record depends on, then the multistep and
+// multirate terms, then one per-run record per substep solver (see
+// ProjectionSolver::saveRunState).  There is no partial-substep phase
+// to record: advance() always completes every substep of a step
+static const char HIST_MAGIC[8] = { 'I','B','P','M','H','I','S','T' };
+static const int HIST_VERSION = 1;
+
+bool IBSolver::saveHistory(const string& filename) {
+	FILE* fp = fopen( filename.c_str(), "wb" );
+	if ( fp == NULL ) return false;
+	fwrite( HIST_MAGIC, sizeof( char ), 8, fp );
+	fwrite( &HIST_VERSION, sizeof( int ), 1, fp );
+	int nsteps = _scheme.nsteps();
+	int nx = _grid.Nx();
+	int ny = _grid.Ny();
+	int ngrid = _grid.Ngrid();
+	int numPoints = _model.getNumPoints();
+	fwrite( &nsteps, sizeof( int ), 1, fp );
+	fwrite( &nx, sizeof( int ), 1, fp );
+	fwrite( &ny, sizeof( int ), 1, fp );
+	fwrite( &ngrid, sizeof( int ), 1, fp );
+	fwrite( &numPoints, sizeof( int ), 1, fp );
+	fwrite( &_dt, sizeof( double ), 1, fp );
+	size_t numN = (size_t) ngrid * (nx-1) * (ny-1);
+	int flag = _oldSaved ? 1 : 0;
+	fwrite( &flag, sizeof( int ), 1, fp );
+	if ( _oldSaved ) {
+		fwrite( _Nprev.flatten(0), sizeof( double ), numN, fp );
+	}
+	flag = _NheldSaved ? 1 : 0;
+	fwrite( &flag, sizeof( int ), 1, fp );
+	if ( _NheldSaved ) {
+		fwrite( _NheldMR.flatten(0), sizeof( double ), numN, fp );
+	}
+	bool success = ferror( fp ) == 0;
+	for ( int i = 0; i < nsteps; i++ ) {
+		success = _solver[i] -> saveRunState( fp ) && success;
+	}
+	success = ( fclose( fp ) == 0 ) && success;
+	return success;
+}
+
+bool IBSolver::loadHistory(const string& filename) {
+	FILE* fp = fopen( filename.c_str(), "rb" );
+	if ( fp == NULL ) return false;
+	char magic[8];
+	int version, nsteps, nx, ny, ngrid, numPoints;
+	double dt;
+	bool ok = ( fread( magic, sizeof( char ), 8, fp ) == 8 ) &&
+		( memcmp( magic, HIST_MAGIC, 8 ) == 0 ) &&
+		( fread( &version, sizeof( int ), 1, fp ) == 1 ) &&
+		( version == HIST_VERSION ) &&
+		( fread( &nsteps, sizeof( int ), 1, fp ) == 1 ) &&
+		( fread( &nx, sizeof( int ), 1, fp ) == 1 ) &&
+		( fread( &ny, sizeof( int ), 1, fp ) == 1 ) &&
+		( fread( &ngrid, sizeof( int ), 1, fp ) == 1 ) &&
+		( fread( &numPoints, sizeof( int ), 1, fp ) == 1 ) &&
+		( fread( &dt, sizeof( double ), 1, fp ) == 1 );
+	if ( ok ) {
+		// The history continues a specific integration: require the
+		// same scheme, timestep, grid, and geometry
+		ok = ( nsteps == _scheme.nsteps() ) &&
+			( nx == _grid.Nx() ) &&
+			( ny == _grid.Ny() ) &&
+			( ngrid == _grid.Ngrid() ) &&
+			( numPoints == _model.getNumPoints() ) &&
+			( dt == _dt );
+	}
+	size_t numN = (size_t) _grid.Ngrid() * ( _grid.Nx()-1 ) * ( _grid.Ny()-1 );
+	Scalar Nprev( _grid );
+	Scalar Nheld( _grid );
+	int oldSaved = 0;
+	int heldSaved = 0;
+	if ( ok ) {
+		ok = ( fread( &oldSaved, sizeof( int ), 1, fp ) == 1 );
+	}
+	if ( ok && oldSaved ) {
+		ok = ( fread( Nprev.flatten(0), sizeof( double ), numN, fp )
+			== numN );
+	}
+	if ( ok ) {
+		ok = ( fread( &heldSaved, sizeof( int ), 1, fp ) == 1 );
+	}
+	if ( ok && heldSaved ) {
+		ok = ( fread( Nheld.flatten(0), sizeof( double ), numN, fp )
+			== numN );
+	}
+	for ( int i = 0; ok && i < _scheme.nsteps(); i++ ) {
+		ok = _solver[i] -> loadRunState( fp );
+	}
+	fclose( fp );
+	if ( ! ok ) return false;
+	_oldSaved = ( oldSaved != 0 );
+	if ( _oldSaved ) {
+		_Nprev = Nprev;
+	}
+	_NheldSaved = ( heldSaved != 0 );
+	if ( _NheldSaved ) {
+		_NheldMR = Nheld;
+	}
+	return true;
+}
+
 void IBSolver::createAllSolvers() {
 	for ( int i = 0; i < _scheme.nsteps(); i++ ) {
 		_solver[i] = createSolver( ( _scheme.an(i) + _scheme.bn(i) )*_dt );
 	}
 }
 	
+// Precompute the per-substep coefficients (see SubstepCoeffs in the
+// header).  Called from the constructors and whenever dt changes; the
+// viscous coefficient folds in alpha = 1/Re, so a change of Reynolds
+// number requires rebuilding the solver, as it already does for the
+// projection operators
+void IBSolver::updateSchemeCoeffs() {
+	_coeffs.resize( _scheme.nsteps() );
+	for ( int i = 0; i < _scheme.nsteps(); i++ ) {
+		_coeffs[i].anDt = _scheme.an(i) * _dt;
+		_coeffs[i].bnDt = _scheme.bn(i) * _dt;
+		_coeffs[i].viscDt = 0.5 * _model.getAlpha()
+			* ( _scheme.an(i) + _scheme.bn(i) ) * _dt;
+	}
+}
+
 void IBSolver::deleteAllSolvers() {
+	// A background factorization (see setAutoSolver) still references
+	// its solvers from the worker; let it finish before deleting them
+	if ( _autoPhase == 1 ) {
+		WaitForTasks();
+		_autoPhase = 2;
+	}
+	for (unsigned int i = 0; i < _autoCholesky.size(); i++) {
+		delete _autoCholesky[i];
+	}
+	_autoCholesky.clear();
+	if ( _autoTask != NULL ) {
+		free( _autoTask );
+		_autoTask = NULL;
+	}
 	for (unsigned int i = 0; i < _solver.size(); i++) {
 		delete _solver[i];
 	}
+	// Solver sets cached for other timesteps (adaptive mode); the
+	// active set is never in the cache, so each is deleted exactly once
+	std::map< double, vector< ProjectionSolver* > >::iterator it;
+	for (it = _solverCache.begin(); it != _solverCache.end(); ++it) {
+		for (unsigned int i = 0; i < it->second.size(); i++) {
+			delete it->second[i];
+		}
+	}
+	_solverCache.clear();
+	// Phase-binned factorizations for periodic motions
+	std::map< std::pair<int,int>, ProjectionSolver* >::iterator pit;
+	for (pit = _phaseSolvers.begin(); pit != _phaseSolvers.end(); ++pit) {
+		delete pit->second;
+	}
+	_phaseSolvers.clear();
 }
 	
 ProjectionSolver* IBSolver::createSolver(double beta) {
 	// Check whether all bodies are stationary
 	//      If so, return a CholeskySolver
-	//      If not, return a ConjugateGradientSolver
+	//      If not, return a ConjugateGradientSolver, or an
+	//      UpdatedCholeskySolver if requested (small-amplitude motions)
 	if ( _model.geTimeDependent() ) {
+		if ( _useUpdatedCholesky ) {
+			cerr << "Using updated-Cholesky solver for projection step" << endl
+			<< "  tolerance = " << _tol << endl;
+			return new UpdatedCholeskySolver( _grid, _model, beta, _tol );
+		}
+		if ( _usePreconditionedCG ) {
+			cerr << "Using preconditioned ConjugateGradient solver for "
+			"projection step" << endl
+			<< "  tolerance = " << _tol << endl;
+			return new PreconditionedConjugateGradientSolver(
+				_grid, _model, beta, _tol );
+		}
 		cerr << "Using ConjugateGradient solver for projection step" << endl
 		<< "  tolerance = " << _tol << endl;
 		return new ConjugateGradientSolver( _grid, _model, beta, _tol );    
 	}
 	else {
+		if ( _autoSolver ) {
+			// Automatic selection (see setAutoSolver): start iterative,
+			// with the factorization deferred until the probe steps
+			// show it pays off
+			cerr << "Auto solver selection: starting with ConjugateGradient, "
+			"probing" << endl
+			<< "  tolerance = " << _tol << endl;
+			return new ConjugateGradientSolver( _grid, _model, beta, _tol );
+		}
 		cerr << "Using Cholesky solver for projection step" << endl;
-		return new CholeskySolver( _grid, _model, beta );
+		CholeskySolver* solver = new CholeskySolver( _grid, _model, beta );
+		if ( _useSinglePrecisionCholesky ) {
+			solver->setSinglePrecision( true );
+		}
+		return solver;
 	}
 }
     
@@ -139,58 +382,689 @@ void IBSolver::setTol( double tol ) {
     createAllSolvers();
 }
 
-void IBSolver::advance( State& x ) {	
+void IBSolver::setUpdatedCholesky( bool flag ) {
+    if ( flag == _useUpdatedCholesky ) return;
+    _useUpdatedCholesky = flag;
+    deleteAllSolvers();
+    createAllSolvers();
+}
+
+void IBSolver::setSinglePrecisionCholesky( bool flag ) {
+    if ( flag == _useSinglePrecisionCholesky ) return;
+    _useSinglePrecisionCholesky = flag;
+    deleteAllSolvers();
+    createAllSolvers();
+}
+
+void IBSolver::setPreconditionedCG( bool flag ) {
+    if ( flag == _usePreconditionedCG ) return;
+    _usePreconditionedCG = flag;
+    deleteAllSolvers();
+    createAllSolvers();
+}
+
+void IBSolver::setAdaptiveTimestep( double cfl ) {
+    _adaptive = ( cfl > 0. );
+    _cfl = cfl;
+    if ( ! _adaptive && _dt != _dtNominal ) {
+        setTimestep( _dtNominal );
+    }
+}
+
+void IBSolver::setErrorEstimate( int interval, double tol ) {
+    _errInterval = ( interval > 0 ) ? interval : 0;
+    _errTol = tol;
+    if ( _errInterval > 0 && _errTol > 0. && ! _adaptive ) {
+        // The error control feeds the same quantized-timestep machinery
+        // as the CFL bound; with no CFL number given, only the error
+        // halvings apply
+        _adaptive = true;
+    }
+}
+
+double IBSolver::getErrorEstimate() const {
+    return _errEstimate;
+}
+
+void IBSolver::setController( Controller& controller,
+                              const Geometry& geometry ) {
+    _controller = &controller;
+    _controllerGeometry = &geometry;
+    // Cache the per-body point ranges once (the point counts are fixed
+    // for a run); the rotation centers are looked up each call, since
+    // they follow the bodies
+    _ctrlBodyBegin.clear();
+    _ctrlBodyEnd.clear();
+    int offset = 0;
+    for ( int i=0; i<geometry.getNumBodies(); ++i ) {
+        _ctrlBodyBegin.push_back( offset );
+        offset += geometry.getBody( i ).getNumPoints();
+        _ctrlBodyEnd.push_back( offset );
+    }
+    _ctrlForces.resize( geometry.getNumBodies() );
+}
+
+// Hand the just-advanced state and its per-body force decomposition to
+// the registered controller.  Everything passed down references solver-
+// or geometry-owned storage, so a control step allocates nothing and
+// copies no field data
+void IBSolver::notifyController( const State& x ) {
+    const BoundaryVector& points = _controllerGeometry->getPoints();
+    for ( unsigned int i=0; i<_ctrlForces.size(); ++i ) {
+        double xc;
+        double yc;
+        _controllerGeometry->getBody( i ).getCenter( xc, yc );
+        Controller::BodyForce& f = _ctrlForces[i];
+        x.computeBodyForce( _ctrlBodyBegin[i], _ctrlBodyEnd[i], points,
+                            xc, yc, f.x, f.y, f.moment );
+    }
+    _controller->notify( x, _ctrlForces );
+}
+
+// How many steps of conjugate gradient to measure before comparing its
+// projected cost against a factorization (see setAutoSolver)
+const int AUTO_PROBE_STEPS = 5;
+
+namespace {
+
+    // Task run on the background worker: initialize (assemble and
+    // factor) the deferred Cholesky solvers, then raise the completion
+    // flag polled by updateAutoSolver.  Allocated with malloc, since
+    // the owner holds it as void*
+    struct AutoFactorTask {
+        vector< ProjectionSolver* >* solvers;
+        int* done;
+    };
+
+    void autoFactorizeTask( void* p ) {
+        AutoFactorTask* task = (AutoFactorTask*) p;
+        for (unsigned int i = 0; i < task->solvers->size(); i++) {
+            (*task->solvers)[i]->init();
+        }
+        __sync_fetch_and_add( task->done, 1 );
+    }
+
+} // namespace
+
+void IBSolver::setAutoSolver( int plannedSteps ) {
+    if ( _model.geTimeDependent() ) {
+        cerr << "Warning: automatic solver selection applies only to "
+            << "stationary geometry; ignoring" << endl;
+        return;
+    }
+    if ( _adaptive ) {
+        cerr << "Warning: automatic solver selection is incompatible with "
+            << "the adaptive timestep; ignoring" << endl;
+        return;
+    }
+    _autoSolver = true;
+    _autoPlannedSteps = plannedSteps;
+    _autoStepsTaken = 0;
+    _autoIterBase = -1;
+    _autoPhase = 0;
+    _autoFactorDone = 0;
+    deleteAllSolvers();
+    createAllSolvers();
+}
+
+// Advance the solver-selection state machine by one step (called once
+// per advance): measure the CG iteration count over the probe steps,
+// compare its projected remaining cost against a factorization, start
+// the factorization on the background worker if it pays, and swap it in
+// once the worker is done
+void IBSolver::updateAutoSolver() {
+    if ( _autoPhase == 0 ) {
+        if ( _autoIterBase < 0 ) {
+            _autoIterBase = Timers::counterValue( Timers::CG_ITERATIONS );
+        }
+        ++_autoStepsTaken;
+        if ( _autoStepsTaken < AUTO_PROBE_STEPS ) return;
+        long iters = Timers::counterValue( Timers::CG_ITERATIONS )
+            - _autoIterBase;
+        double itersPerStep = (double) iters / _autoStepsTaken;
+        int stepsLeft = _autoPlannedSteps - _autoStepsTaken;
+        if ( stepsLeft < 0 ) stepsLeft = 0;
+        // Both costs in applications of M, which dominate everything
+        // here.  Remaining CG work is the measured iteration rate over
+        // the steps left.  Assembling M applies it to each of the
+        // 2 numPoints basis vectors, once per substep; the dense
+        // factorization's (2n)^3/3 flops are charged at the flop count
+        // of one application, roughly the 5 N log2 N of its FFTs
+        double n2 = 2. * _model.getNumPoints();
+        double gridN = (double) _grid.Nx() * _grid.Ny();
+        double mFlops = 5. * _grid.Ngrid() * gridN * log( gridN ) / log( 2. );
+        double factorCost = _scheme.nsteps()
+            * ( n2 + n2 * n2 * n2 / ( 3. * mFlops ) );
+        double cgCost = itersPerStep * stepsLeft;
+        if ( cgCost <= factorCost ) {
+            cerr << "Auto solver selection: staying with ConjugateGradient ("
+                << itersPerStep << " iterations/step over " << stepsLeft
+                << " steps < factorization ~" << (long) factorCost
+                << " equivalent iterations)" << endl;
+            _autoPhase = 2;
+            return;
+        }
+        cerr << "Auto solver selection: factorizing in the background ("
+            << itersPerStep << " iterations/step over " << stepsLeft
+            << " steps > factorization ~" << (long) factorCost
+            << " equivalent iterations)" << endl;
+        for ( int i = 0; i < _scheme.nsteps(); i++ ) {
+            double beta = ( _scheme.an(i) + _scheme.bn(i) ) * _dt;
+            CholeskySolver* chol = new CholeskySolver( _grid, _model, beta );
+            if ( _useSinglePrecisionCholesky ) {
+                chol->setSinglePrecision( true );
+            }
+            _autoCholesky.push_back( chol );
+        }
+        AutoFactorTask* task = (AutoFactorTask*) malloc( sizeof(*task) );
+        task->solvers = &_autoCholesky;
+        task->done = &_autoFactorDone;
+        _autoTask = task;
+        SubmitTask( autoFactorizeTask, task );
+        _autoPhase = 1;
+    }
+    else if ( _autoPhase == 1 && _autoFactorDone != 0 ) {
+        for ( int i = 0; i < _scheme.nsteps(); i++ ) {
+            delete _solver[i];
+            _solver[i] = _autoCholesky[i];
+        }
+        _autoCholesky.clear();
+        free( _autoTask );
+        _autoTask = NULL;
+        _autoPhase = 2;
+        cerr << "Auto solver selection: switching to the Cholesky factor"
+            << endl;
+    }
+}
+
+void IBSolver::setPhaseCache( double period ) {
+    if ( _adaptive ) {
+        cerr << "Warning: phase cache is incompatible with the adaptive "
+            << "timestep; ignoring" << endl;
+        return;
+    }
+    _phaseSteps = (int)( period / _dt + 0.5 );
+    if ( _phaseSteps < 1 ) _phaseSteps = 1;
+    if ( fabs( _phaseSteps * _dt - period ) > 1e-9 * period ) {
+        cerr << "Warning: phase cache period is not an integer multiple "
+            << "of dt; rounding to " << _phaseSteps << " steps" << endl;
+    }
+    cerr << "Caching projection factorizations over " << _phaseSteps
+        << " phases" << endl;
+    _phaseCacheEnabled = true;
+}
+
+// Return the solver factorized at the phase of the given timestep,
+// factorizing on the first visit (i.e. during the first period).  Called
+// with the body positions already updated for this substep
+ProjectionSolver* IBSolver::phaseCachedSolver( int substep, int timestep ) {
+    int bin = timestep % _phaseSteps;
+    std::pair<int,int> key( substep, bin );
+    std::map< std::pair<int,int>, ProjectionSolver* >::iterator it =
+        _phaseSolvers.find( key );
+    if ( it != _phaseSolvers.end() ) {
+        return it->second;
+    }
+    double beta = ( _scheme.an(substep) + _scheme.bn(substep) ) * _dt;
+    cerr << "Phase cache: factorizing substep " << substep + 1
+        << ", phase " << bin + 1 << " of " << _phaseSteps << endl;
+    CholeskySolver* solver = new CholeskySolver( _grid, _model, beta );
+    if ( _useSinglePrecisionCholesky ) {
+        solver->setSinglePrecision( true );
+    }
+    solver->init();
+    _phaseSolvers[ key ] = solver;
+    return solver;
+}
+
+void IBSolver::setMultirate( int factor ) {
+    // Round down to a power of two, so that whenever a level is
+    // refreshed every finer level is refreshed too
+    int rounded = 1;
+    while ( rounded * 2 <= factor ) {
+        rounded *= 2;
+    }
+    _multirate = rounded;
+    _NheldSaved = false;
+    _nonlinearMaxLev = _grid.Ngrid();
+    if ( _multirate > 1 ) {
+        cerr << "Multirate advection: coarse level k refreshed every "
+            << "min(2^k, " << _multirate << ") steps" << endl;
+    }
+}
+
+// Number of levels whose advection term is refreshed at the given step:
+// level k is refreshed every min(2^k, factor) steps, so the refreshed
+// set is always the finest levels
+int IBSolver::multirateLevels( int timestep ) const {
+    int ngrid = _grid.Ngrid();
+    int L = 1;
+    while ( L < ngrid ) {
+        int rate = 1 << L;
+        if ( rate > _multirate ) rate = _multirate;
+        if ( timestep % rate != 0 ) break;
+        ++L;
+    }
+    return L;
+}
+
+// Overwrite the levels not refreshed this step with their held values,
+// and refresh the held copy of the levels that were recomputed.  On the
+// first call (no held term yet) the term was computed in full, and is
+// simply stored
+void IBSolver::applyMultirateHold( Scalar& nonlinear ) {
+    if ( ! _NheldSaved ) {
+        _NheldMR = nonlinear;
+        _NheldSaved = true;
+        return;
+    }
+    int ngrid = _grid.Ngrid();
+    int n = nonlinear.getSize() / ngrid;
+    for ( int lev = 1; lev < ngrid; ++lev ) {
+        if ( lev < _nonlinearMaxLev ) {
+            memcpy( _NheldMR.flatten(lev), nonlinear.flatten(lev),
+                    n * sizeof(double) );
+        }
+        else {
+            memcpy( nonlinear.flatten(lev), _NheldMR.flatten(lev),
+                    n * sizeof(double) );
+        }
+    }
+}
+
+void IBSolver::setToleranceSchedule( double transientFactor,
+    int transientSteps, double tightenFactor, double convergeThreshold ) {
+    _tolSchedule = true;
+    _tolTransientFactor = transientFactor;
+    _tolTransientSteps = transientSteps;
+    _tolTightenFactor = tightenFactor;
+    _tolConvergeThreshold = convergeThreshold;
+    _stepsTaken = 0;
+    _tolTightened = false;
+}
+
+// Set the tolerance of the given substep's solver from the schedule.
+// Direct solvers ignore setTolerance, so no dispatch on solver type is
+// needed here
+void IBSolver::applyToleranceSchedule( int substep ) {
+    double factor = 1.;
+    // Early transient: start transientFactor looser than the base
+    // tolerance and tighten geometrically as the transient decays
+    if ( _stepsTaken < _tolTransientSteps ) {
+        double progress = (double) _stepsTaken / _tolTransientSteps;
+        factor *= pow( _tolTransientFactor, 1. - progress );
+    }
+    // Statistically converged: polish the remaining error
+    if ( _tolTightened ) {
+        factor *= _tolTightenFactor;
+    }
+    // A substep advancing a smaller fraction of dt injects
+    // proportionally less solver error into the full step, so it can be
+    // solved proportionally looser (capped, to keep CG well within its
+    // convergent regime)
+    double dtFraction = _scheme.an(substep) + _scheme.bn(substep);
+    if ( dtFraction > 0. && dtFraction < 1. ) {
+        double subFactor = 1. / dtFraction;
+        if ( subFactor > 10. ) subFactor = 10.;
+        factor *= subFactor;
+    }
+    _solver[substep]->setTolerance( _tol * factor );
+}
+
+// Track the step-to-step force change, and once it falls below the
+// threshold treat the run as statistically converged and tighten
+void IBSolver::updateToleranceSchedule( const State& x ) {
+    ++_stepsTaken;
+    if ( _fPrevSched == NULL ) {
+        _fPrevSched = new BoundaryVector( x.f );
+        return;
+    }
+    if ( ! _tolTightened &&
+         x.f.getNumPoints() == _fPrevSched->getNumPoints() ) {
+        double diff = 0.;
+        double norm = 0.;
+        for ( Direction dir=X; dir < XY; ++dir ) {
+            for ( int i=0; i < x.f.getNumPoints(); ++i ) {
+                double d = fabs( x.f(dir,i) - (*_fPrevSched)(dir,i) );
+                double mag = fabs( x.f(dir,i) );
+                if ( d > diff ) diff = d;
+                if ( mag > norm ) norm = mag;
+            }
+        }
+        if ( norm > 0. && diff <= _tolConvergeThreshold * norm ) {
+            cerr << "Tolerance schedule: forces statistically converged; "
+                << "tightening tolerance by " << _tolTightenFactor << endl;
+            _tolTightened = true;
+        }
+    }
+    *_fPrevSched = x.f;
+}
+
+// Largest timestep satisfying the CFL condition at every level,
+// capped at the nominal (constructed) timestep
+double IBSolver::computeCFLTimestep( const State& x ) const {
+    double dtMax = _dtNominal;
+    if ( _cfl <= 0. ) return dtMax;
+    // With monitoring on, the peak of |q| / dx^2 was already
+    // accumulated inside the last step's curl output pass: reuse it
+    // and skip the sweep below
+    if ( FlowMonitorEnabled() && GetMonitorCFLRate() > 0. ) {
+        double dtLev = _cfl / GetMonitorCFLRate();
+        return ( dtLev < dtMax ) ? dtLev : dtMax;
+    }
+    int ngrid = x.q.Ngrid();
+    int n = x.q.getSize() / ngrid;
+    for (int lev = 0; lev < ngrid; ++lev) {
+        const double* q = x.q.flatten( lev );
+        double qMax = 0.;
+        for (int i = 0; i < n; ++i) {
+            double mag = fabs( q[i] );
+            if ( mag > qMax ) qMax = mag;
+        }
+        if ( qMax > 0. ) {
+            // Fluxes are velocity times cell edge length, so the CFL
+            // condition u dt / dx <= cfl reads q dt / dx^2 <= cfl
+            double dx = _grid.Dx( lev );
+            double dtLev = _cfl * dx * dx / qMax;
+            if ( dtLev < dtMax ) dtMax = dtLev;
+        }
+    }
+    return dtMax;
+}
+
+void IBSolver::adjustTimestep( const State& x ) {
+    double dtCFL = computeCFLTimestep( x );
+    // Quantize to nominal / 2^k so that only a handful of distinct
+    // timesteps -- and hence solver factorizations -- ever occur
+    const int MAX_HALVINGS = 16;
+    double dt = _dtNominal;
+    // The error control (see setErrorEstimate) imposes a number of
+    // halvings of its own, on top of however many the CFL bound needs
+    for (int k = 0; ( dt > dtCFL || k < _errHalvings ) && k < MAX_HALVINGS;
+         ++k) {
+        dt *= 0.5;
+    }
+    if ( dt != _dt ) {
+        setTimestep( dt );
+    }
+}
+
+void IBSolver::setTimestep( double dt ) {
+    // Stash the active solvers under the outgoing dt and pull the set
+    // for the new dt from the cache, initializing one on a first visit
+    _solverCache[ _dt ] = _solver;
+    _dt = dt;
+    std::map< double, vector< ProjectionSolver* > >::iterator it =
+        _solverCache.find( dt );
+    if ( it != _solverCache.end() ) {
+        _solver = it->second;
+        _solverCache.erase( it );
+    }
+    else {
+        cerr << "Adaptive timestep: initializing solvers for dt = "
+            << dt << endl;
+        createAllSolvers();
+        init();
+    }
+    updateSchemeCoeffs();
+    // The multistep history was formed with the outgoing dt, so treat
+    // the next substep as a first step
+    _oldSaved = false;
+}
+
+void IBSolver::advance( State& x ) {
+	ScopedTimer timer( Timers::ADVANCE );
+	FlowMonitorStartStep();
+	if ( _adaptive ) {
+		adjustTimestep( x );
+	}
+	// Keep the pre-step state (a constant-time copy-on-write copy) when
+	// a step-doubling error estimate is due this step
+	bool estimateDue = ( _errInterval > 0 ) &&
+		( x.timestep % _errInterval == 0 );
+	State x0;
+	if ( estimateDue ) {
+		x0 = x;
+	}
+	// With multirate subcycling, only the finest levels' advection term
+	// is refreshed this step (all of them, until a held term exists)
+	_nonlinearMaxLev = ( _multirate > 1 && _NheldSaved )
+		? multirateLevels( x.timestep ) : _grid.Ngrid();
 	for ( int i = 0; i < _scheme.nsteps(); i++ ) {
-		Scalar nonlinear = N(x); 
+		Scalar nonlinear = N(x);
+		if ( _multirate > 1 ) {
+			applyMultirateHold( nonlinear );
+		}
+		if ( _tolSchedule ) {
+			applyToleranceSchedule( i );
+		}
 		advanceSubstep( x, nonlinear, i );
 	}
-    
+	if ( _tolSchedule ) {
+		updateToleranceSchedule( x );
+	}
+	if ( _autoSolver && _autoPhase < 2 ) {
+		updateAutoSolver();
+	}
+
+	if ( estimateDue ) {
+		computeErrorEstimate( x0, x );
+	}
+
 	x.time += _dt;
 	++x.timestep;
-}      
+	if ( _controller != NULL ) {
+		notifyController( x );
+	}
+}
+
+// Step-doubling estimate of the local error of the step just taken
+// (see setErrorEstimate): re-advance the saved pre-step state by two
+// half steps and compare the vorticity.  The half-dt solvers come from
+// the same cache the adaptive timestep uses, so only the first estimate
+// pays for their initialization.  The multistep history belongs to the
+// full-dt trajectory and is saved around the half steps (which run
+// history-free, as any step after a dt change does)
+void IBSolver::computeErrorEstimate( const State& x0, const State& x ) {
+	Scalar NprevSaved = _Nprev;
+	Scalar NheldSaved = _NheldMR;
+	bool oldSaved = _oldSaved;
+	bool heldSaved = _NheldSaved;
+	double dtFull = _dt;
+
+	State xh = x0;
+	setTimestep( 0.5 * dtFull );
+	_NheldSaved = false;
+	for ( int s = 0; s < 2; s++ ) {
+		_nonlinearMaxLev = _grid.Ngrid();
+		for ( int i = 0; i < _scheme.nsteps(); i++ ) {
+			Scalar nonlinear = N( xh );
+			advanceSubstep( xh, nonlinear, i );
+		}
+		xh.time += _dt;
+		++xh.timestep;
+	}
+	setTimestep( dtFull );
+	_Nprev = NprevSaved;
+	_NheldMR = NheldSaved;
+	_oldSaved = oldSaved;
+	_NheldSaved = heldSaved;
+	// For moving bodies, put the operators back at the full step's time
+	if ( _model.isTimeDependent() ) {
+		_model.updateOperators( x.time + _dt );
+	}
+
+	// Richardson: for a scheme of order p the error of the full step is
+	// the solution difference over 1 - 2^-p, reported relative to the
+	// vorticity norm
+	double diffSq = 0.;
+	double normSq = 0.;
+	int n = x.omega.getSize();
+	const double* a = x.omega.flatten(0);
+	const double* b = xh.omega.flatten(0);
+	for (int i = 0; i < n; ++i) {
+		double d = a[i] - b[i];
+		diffSq += d * d;
+		normSq += a[i] * a[i];
+	}
+	double scale = 1. - pow( 2., -_scheme.order() );
+	_errEstimate = ( normSq > 0. ) ?
+		sqrt( diffSq / normSq ) / scale : sqrt( diffSq ) / scale;
+
+	// Close the loop on the timestep: demand another halving while the
+	// estimate exceeds the tolerance, and release one once it falls
+	// well below it (an eighth: one order of accuracy of margin)
+	if ( _errTol > 0. ) {
+		const int MAX_HALVINGS = 16;
+		if ( _errEstimate > _errTol && _errHalvings < MAX_HALVINGS ) {
+			++_errHalvings;
+			cerr << "Error control: estimate " << _errEstimate
+				<< " exceeds " << _errTol << "; halving timestep" << endl;
+		}
+		else if ( _errEstimate < 0.125 * _errTol && _errHalvings > 0 ) {
+			--_errHalvings;
+			cerr << "Error control: estimate " << _errEstimate
+				<< " well below " << _errTol << "; relaxing timestep" << endl;
+		}
+	}
+}
 	
+void IBSolver::advance( vector<State>& x ) {
+	ScopedTimer timer( Timers::ADVANCE );
+	unsigned int numStates = x.size();
+	if ( numStates == 0 ) return;
+	assert( ! _adaptive );
+	// Multirate subcycling is not applied to the batched advance: the
+	// held term would have to be kept per state
+	_nonlinearMaxLev = _grid.Ngrid();
+	if ( _NprevBatch.size() != numStates ) {
+		// New batch: size the per-state history and mark it empty
+		_NprevBatch.assign( numStates, _Nprev );
+		_oldSavedBatch.assign( numStates, false );
+	}
+	// Substeps outermost, so each substep's projection operators (and
+	// Cholesky factors) are traversed once for the whole batch.
+	// advanceSubstep keeps its multistep history in _Nprev/_oldSaved,
+	// so each state's history is swapped in around the call
+	for ( int i = 0; i < _scheme.nsteps(); i++ ) {
+		for ( unsigned int k = 0; k < numStates; k++ ) {
+			Scalar nonlinear = N( x[k] );
+			bool oldSavedSingle = _oldSaved;
+			_Nprev.swap( _NprevBatch[k] );
+			_oldSaved = _oldSavedBatch[k];
+			advanceSubstep( x[k], nonlinear, i );
+			_oldSavedBatch[k] = _oldSaved;
+			_Nprev.swap( _NprevBatch[k] );
+			_oldSaved = oldSavedSingle;
+		}
+	}
+	for ( unsigned int k = 0; k < numStates; k++ ) {
+		x[k].time += _dt;
+		++x[k].timestep;
+	}
+}
+
 void IBSolver::advance( State& x, const Scalar& Bu ) {
+	ScopedTimer timer( Timers::ADVANCE );
+	if ( _adaptive ) {
+		adjustTimestep( x );
+	}
+	_nonlinearMaxLev = ( _multirate > 1 && _NheldSaved )
+		? multirateLevels( x.timestep ) : _grid.Ngrid();
 	for ( int i = 0; i < _scheme.nsteps(); i++ ) {
-		Scalar nonlinear = N(x) + Bu; 
+		Scalar nonlinear = N(x) + Bu;
+		if ( _multirate > 1 ) {
+			applyMultirateHold( nonlinear );
+		}
+		if ( _tolSchedule ) {
+			applyToleranceSchedule( i );
+		}
 		advanceSubstep( x, nonlinear, i );
 	}
-    
+	if ( _tolSchedule ) {
+		updateToleranceSchedule( x );
+	}
+	if ( _autoSolver && _autoPhase < 2 ) {
+		updateAutoSolver();
+	}
+
     x.time += _dt;
 	++x.timestep;
-}     
+}
 	
-void IBSolver::advanceSubstep( State& x, const Scalar& nonlinear, int i ) {    
-	// If the body is moving, update the positions of the bodies
+namespace {
+
+	// Task run on the background worker: update the body positions and
+	// rebuild the associated operators (see advanceSubstep)
+	struct OperatorUpdate {
+		NavierStokesModel* model;
+		double time;
+	};
+
+	void updateOperatorsTask( void* p ) {
+		OperatorUpdate* update = (OperatorUpdate*) p;
+		ScopedTimer geomTimer( Timers::GEOMETRY );
+		update->model->updateOperators( update->time );
+	}
+
+} // namespace
+
+void IBSolver::advanceSubstep( State& x, Scalar& nonlinear, int i ) {
+	ScopedTimer timer( Timers::SUBSTEP );
+	// If the body is moving, update the positions of the bodies.  The
+	// update touches only the geometry and the regularizer, and the
+	// right-hand side (a) below touches only field data, so the two are
+	// independent and the update runs on the background worker while
+	// (a) is assembled.  The constraint values (b) and the projection
+	// solve depend on the updated operators, so wait before computing b
+	OperatorUpdate update;
 	if ( _model.isTimeDependent() ) {
-		_model.updateOperators( x.time + _scheme.cn(i) * _dt );
-	}		
-    
-	// Evaluate Right-Hand-Side (a) for first equation of ProjectionSolver
-	Scalar a = Laplacian( x.omega );
-	a *= 0.5 * _model.getAlpha() * ( _scheme.an(i) + _scheme.bn(i) );
-	a += _scheme.an(i)*nonlinear;
-	
-	if ( _scheme.bn(i) != 0 ) {        
-        // for ab2
-		if ( _oldSaved == false ) {
-			_Nprev = nonlinear;
-		}
-        
-		a += _scheme.bn(i) * _Nprev;
+		update.model = &_model;
+		update.time = x.time + _scheme.cn(i) * _dt;
+		SubmitTask( updateOperatorsTask, &update );
+	}
+
+	// Evaluate Right-Hand-Side (a) for first equation of ProjectionSolver,
+	// assembled in the persistent scratch field so that no full-grid
+	// temporary is allocated inside the substep.  The coefficients are
+	// precomputed per substep (_coeffs), and the whole assembly is one
+	// fused pass over the field (expression templates) instead of a
+	// sweep per term
+	Scalar& a = _Ntemp;
+	Laplacian( x.omega, a );
+	const SubstepCoeffs& c = _coeffs[i];
+	if ( c.bnDt != 0. ) {
+		// for ab2: no history is available on the first step, so use the
+		// current term in its place
+		const Scalar& prev = _oldSaved ? _Nprev : nonlinear;
+		a = x.omega + c.viscDt * a + c.anDt * nonlinear + c.bnDt * prev;
+	}
+	else {
+		a = x.omega + c.viscDt * a + c.anDt * nonlinear;
 	}
-	
-	a *= _dt;
-	a += x.omega;
 
 	// Evaluate Right-Hand-Side (b) for second equation of ProjectionSolver
-	BoundaryVector b = _model.getConstraints();
+	if ( _model.isTimeDependent() ) {
+		WaitForTasks();
+	}
+	// The model caches the constraint vector for stationary geometry, so
+	// bind a reference rather than copying it every substep
+	const BoundaryVector& b = _model.getConstraints();
     
-	// Call the ProjectionSolver to determine the vorticity and forces
-	_solver[i]->solve( a, b, x.omega, x.f );
+	// Call the ProjectionSolver to determine the vorticity and forces.
+	// For periodic motions with the phase cache on, swap in the solver
+	// factorized at this phase of the period instead of iterating
+	ProjectionSolver* solver = _solver[i];
+	if ( _phaseCacheEnabled && _model.isTimeDependent() ) {
+		solver = phaseCachedSolver( i, x.timestep );
+	}
+	solver->solve( a, b, x.omega, x.f );
 
 	// Update the state, for instance to compute the corresponding flux
 	_model.refreshState( x );	
-	_Nprev = nonlinear;
+	// Keep the term as history for the next substep; a buffer swap, not
+	// an elementwise copy
+	_Nprev.swap( nonlinear );
     
     if( _oldSaved == false ) {
         _oldSaved = true;       
@@ -203,8 +1077,24 @@ void IBSolver::advanceSubstep( State& x, const Scalar& nonlinear, int i ) {
 // ===================== //
 	
 Scalar NonlinearIBSolver::N(const State& x) const {
-	Flux v = CrossProduct( x.q, x.omega );
-	Scalar g = Curl( v );
+	// Fused form of Curl( CrossProduct( x.q, x.omega ) ), computing the
+	// cross product q x omega = ( omega v, -omega u ) in the persistent
+	// scratch fields rather than allocating temporaries each substep.
+	// The products sweep only the active region of the vorticity, which
+	// covers little of the coarse outer levels early in a run.
+	// With multirate subcycling only the finest _nonlinearMaxLev levels
+	// are recomputed; the coarser levels of the scratch fields keep the
+	// products of their last refresh, which supply the coarse side of
+	// the interface terms in VelocityToFlux, and the caller overwrites
+	// the held levels of the result
+	int maxlev = _nonlinearMaxLev;
+	FluxToXVelocity( x.q, _u, maxlev );
+	_u.multiplyActive( x.omega, -1., maxlev );
+	FluxToYVelocity( x.q, _v, maxlev );
+	_v.multiplyActive( x.omega, 1., maxlev );
+	VelocityToFlux( _v, _u, _cross, maxlev );   // _cross = ( omega v, -omega u )
+	Scalar g( _grid );
+	Curl( _cross, g, maxlev );
 	return g;
 }
 	
@@ -244,7 +1134,7 @@ Scalar SFDSolver::N(const State& x) const {
 }
 	
 
-void SFDSolver::advanceSubstep( State& x, const Scalar& nonlinear, int i ) {
+void SFDSolver::advanceSubstep( State& x, Scalar& nonlinear, int i ) {
     assert( x.time == _xhat.time );
     
 	// Initialize _xhat if necessary, save current vorticity field
@@ -257,34 +1147,123 @@ void SFDSolver::advanceSubstep( State& x, const Scalar& nonlinear, int i ) {
 	// Advance state x
 	IBSolver::advanceSubstep( x, nonlinear, i );
 	
-	// Advance state _xhat
+	// Advance state _xhat.  Each update below is a single fused pass
+	// (expression templates), with no Scalar temporary besides the rhs
+	// kept as multistep history
 	Scalar rhs = ( _omegaTemp - _xhat.omega ) / _Delta;
-	Scalar a = _scheme.an(i)*rhs;
-	
-	if ( _scheme.bn(i) != 0 ) {
-		if ( _rhsSaved == false ) {
-			_rhsPrev = rhs;
-		}
-		
-		a += _scheme.bn(i) * _rhsPrev;
+	const SubstepCoeffs& c = _coeffs[i];
+	if ( c.bnDt != 0. ) {
+		// As above: use the current term in place of history on the
+		// first step
+		const Scalar& hist = _rhsSaved ? _rhsPrev : rhs;
+		_xhat.omega += c.anDt * rhs + c.bnDt * hist;
+	}
+	else {
+		_xhat.omega += c.anDt * rhs;
 	}
-	
-	a *= _dt;
-	_xhat.omega += a;
     
     if ( i == _scheme.nsteps()-1 ) {
         _xhat.time += _dt;
         _xhat.timestep++;
+        if ( _tuneInterval > 0 ) {
+            // Residual norm ||omega - omegaHat||, from the rhs field
+            // the filter update already formed (one fused pass)
+            double rnorm = _Delta * sqrt( InnerProduct( rhs, rhs ) );
+            if ( rnorm < 1e-300 ) rnorm = 1e-300;
+            _resHistory.push_back( log( rnorm ) );
+            if ( (int) _resHistory.size() >= _tuneInterval ) {
+                retune();
+                _resHistory.clear();
+            }
+        }
     }
-    
-	_rhsPrev = rhs;
+
+	_rhsPrev.swap( rhs );
     
     if( _rhsSaved == false ) {
         _rhsSaved = true;       
     }
 }
  
-void SFDSolver::saveFilteredState( string outdir, string name, string numDigitInFileName ) { 
+void SFDSolver::setAutoTune( int interval ) {
+    // A window needs several oscillation periods to read a frequency
+    // off; anything shorter just adds noise to the estimates
+    _tuneInterval = ( interval < 16 ) ? 16 : interval;
+    _resHistory.reserve( _tuneInterval );
+}
+
+void SFDSolver::retune() {
+    int n = _resHistory.size();
+    if ( n < 16 ) return;
+    // Least-squares slope of log ||r|| against time: the growth (or
+    // decay) rate of the coupled system's dominant mode
+    double tm = 0.5 * ( n - 1 );
+    double mean = 0.;
+    for ( int k = 0; k < n; ++k ) mean += _resHistory[k];
+    mean /= n;
+    double num = 0.;
+    double den = 0.;
+    for ( int k = 0; k < n; ++k ) {
+        num += ( k - tm ) * ( _resHistory[k] - mean );
+        den += ( k - tm ) * ( k - tm ) * _dt;
+    }
+    double slope = num / den;
+    // Dominant frequency from the spacing of the local maxima of the
+    // detrended history: for a single complex mode the residual norm
+    // oscillates with period pi / omega
+    int numMax = 0;
+    int firstMax = -1;
+    int lastMax = -1;
+    double detrended2 = 0.;
+    for ( int k = 1; k < n - 1; ++k ) {
+        double dm = _resHistory[k-1] - slope * _dt * ( k - 1 - tm );
+        double d0 = _resHistory[k]   - slope * _dt * ( k - tm );
+        double dp = _resHistory[k+1] - slope * _dt * ( k + 1 - tm );
+        detrended2 += ( d0 - mean ) * ( d0 - mean );
+        if ( d0 > dm && d0 >= dp ) {
+            ++numMax;
+            if ( firstMax < 0 ) firstMax = k;
+            lastMax = k;
+        }
+    }
+    double chiOld = _chi;
+    double deltaOld = _Delta;
+    // A monotone history has no frequency to read; roundoff ripple
+    // would otherwise register as closely spaced maxima
+    bool oscillating = sqrt( detrended2 / ( n - 2 ) ) > 1e-3;
+    if ( oscillating && numMax >= 3 ) {
+        double omegaEst = M_PI * ( numMax - 1 )
+            / ( ( lastMax - firstMax ) * _dt );
+        // Cutoff at the instability frequency, kept well above the
+        // timestep so the filter stays resolvable
+        double deltaNew = 1. / omegaEst;
+        if ( deltaNew < 2. * _dt ) deltaNew = 2. * _dt;
+        _Delta = deltaNew;
+    }
+    if ( slope > 0. ) {
+        // Filter losing: raise the gain above the estimated growth
+        // rate (chi ~ 2 sigma), at least doubling it
+        double chiNew = 2. * slope;
+        if ( chiNew < 2. * _chi ) chiNew = 2. * _chi;
+        _chi = chiNew;
+    }
+    else if ( -slope < 0.05 * _chi ) {
+        // Decay far slower than the gain suggests: overdamped, and a
+        // smaller gain converges faster
+        _chi *= 0.75;
+    }
+    if ( _Delta != deltaOld && _rhsSaved ) {
+        // The multistep history carries the old 1/Delta scaling
+        _rhsPrev *= deltaOld / _Delta;
+    }
+    if ( _chi != chiOld || _Delta != deltaOld ) {
+        cout << "SFD auto-tune at step " << _xhat.timestep
+            << ": chi = " << _chi << ", Delta = " << _Delta
+            << " (residual slope " << slope << ")" << endl;
+    }
+}
+
+void SFDSolver::saveFilteredState( string outdir, string name, string numDigitInFileName ) {
     string formatString = outdir+name+numDigitInFileName+".bin"+"_xhat";
     char filename[256];
     sprintf( filename, formatString.c_str(), _xhat.timestep );
@@ -3,7 +3,9 @@
 
 // header file for storing integration schemes
 
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 #include "Scheme.h"
 #include "Scalar.h"
@@ -15,6 +17,29 @@ namespace ibpm{
 	
 class ProjectionSolver;
 
+/// \brief Callback interface for in-process closed-loop control (see
+/// IBSolver::setController).  After each completed step of
+/// advance(State&) the solver calls notify with the advanced state and
+/// the per-body force decomposition, both passed by reference with no
+/// copies and no file I/O, so a feedback law runs at solver speed
+/// rather than file-exchange speed.  The callback runs on the stepping
+/// thread and may adjust the bodies' Motion parameters (through
+/// whatever non-const handles the caller holds) before the next step
+/// begins
+class Controller {
+public:
+	virtual ~Controller() {}
+	/// Force on one body, and moment about its center of rotation
+	struct BodyForce {
+		double x;
+		double y;
+		double moment;
+	};
+	/// \brief Called once per completed step; forces holds one entry
+	/// per body, in the order the geometry stores them
+	virtual void notify( const State& x,
+	                     const vector<BodyForce>& forces ) = 0;
+};
 
 // Base class
 class IBSolver{
@@ -33,33 +58,227 @@ public:
 	virtual ~IBSolver();
     void init();
     void reset();
-	bool load(const string& basename); 
+	bool load(const string& basename);
 	bool save(const string& basename);
+	/// \brief Write the integration history to a versioned binary file:
+	/// the multistep (Adams-Bashforth) convective term, the held
+	/// multirate advection term if active, and each substep solver's
+	/// per-run iteration state (warm starts and recycled subspaces for
+	/// conjugate gradient).  Together with the restart file this makes a
+	/// resumed run advance bit-for-bit as the original would have, with
+	/// no first-order restart step and no re-converging of the iterative
+	/// solvers' transients.  Complements save(), which stores the
+	/// precomputed operators.  The batched-advance history
+	/// (advance(vector<State>&)) is not recorded
+	bool saveHistory(const string& filename);
+	/// \brief Read a history file written by saveHistory.  The header is
+	/// validated against the current scheme, timestep, and grid before
+	/// anything is modified; returns false (leaving the solver's state
+	/// unchanged) on any mismatch.  On success the first advance()
+	/// continues the multistep scheme instead of restarting it
+	bool loadHistory(const string& filename);
 	string getName();
     double getTimestep();
-	void advance( State& x );  
-	void advance( State& x, const Scalar& Bu );  
-	virtual void advanceSubstep( State& x, const Scalar& nonlinear, int i ); // virtual for SFD 
+	void advance( State& x );
+	void advance( State& x, const Scalar& Bu );
+	/// \brief Advance a batch of states through one timestep,
+	/// substep by substep, so the projection-step operators for each
+	/// substep are traversed once per batch rather than once per state
+	/// (e.g. the Krylov vectors of an Arnoldi iteration about a frozen
+	/// base flow).  Multistep history is kept per state, and is
+	/// restarted whenever the batch size changes.  Not compatible with
+	/// the adaptive timestep
+	void advance( vector<State>& x );
+	// Note: may take over the contents of nonlinear, which is history
+	// bookkeeping only; callers pass a fresh term each substep
+	virtual void advanceSubstep( State& x, Scalar& nonlinear, int i ); // virtual for SFD 
     void setTol( double tol );
+    /// \brief For moving geometry, solve the projection step with the
+    /// updated-Cholesky direct solver rather than conjugate gradient
+    /// (appropriate for small-amplitude motions)
+    void setUpdatedCholesky( bool flag );
+    /// \brief Store Cholesky factors in single precision, with one step
+    /// of double-precision iterative refinement per solve
+    void setSinglePrecisionCholesky( bool flag );
+    /// \brief For moving geometry, precondition the conjugate gradient
+    /// iteration with a reference-configuration Cholesky factor
+    void setPreconditionedCG( bool flag );
+    /// \brief Choose the timestep each step from the given CFL number,
+    /// halving the nominal dt as many times as the current maximum
+    /// velocity requires.  Restricting dt to nominal / 2^k keeps the
+    /// number of distinct timesteps small, and solvers initialized for
+    /// each are cached, so returning to a dt reuses its factorizations.
+    /// A CFL number of zero restores the fixed timestep
+    void setAdaptiveTimestep( double cfl );
+    /// \brief Schedule the tolerance of iterative projection solves
+    /// instead of using a single fixed value: start transientFactor
+    /// looser than the base tolerance and tighten geometrically to it
+    /// over the first transientSteps steps; scale each substep's
+    /// tolerance inversely with its fraction of the timestep, so every
+    /// substep contributes comparable error to the step; and once the
+    /// force changes by less than convergeThreshold (relative) between
+    /// steps, tighten by tightenFactor to polish the converged state.
+    /// Direct solvers ignore the schedule
+    void setToleranceSchedule( double transientFactor, int transientSteps,
+                               double tightenFactor,
+                               double convergeThreshold );
+    /// \brief For strictly periodic prescribed motions with the given
+    /// period, cache a Cholesky factorization of the projection step per
+    /// substep and per phase of the period.  The first period pays one
+    /// factorization per phase; every later period swaps in the cached
+    /// factor and advances at stationary-body (direct-solve) speed.
+    /// The period must be an integer multiple of dt; incompatible with
+    /// the adaptive timestep
+    void setPhaseCache( double period );
+    /// \brief Subcycle the advection term of the coarse outer levels:
+    /// level k is refreshed every min(2^k, factor) steps (matching the
+    /// 2^k growth of the grid spacing) and held constant in between, so
+    /// per unit of simulated time most of the outer-level advection work
+    /// disappears.  The held coarse products also supply the coarse side
+    /// of the interface terms when the fine levels are converted, so the
+    /// coarse-fine advective coupling is retained at the held value.
+    /// The implicit viscous and projection solves remain global at every
+    /// step, which keeps the scheme unconditionally stable.  A factor of
+    /// one (or zero) disables subcycling; factors are rounded down to a
+    /// power of two so the refresh steps of the levels nest
+    void setMultirate( int factor );
+    /// \brief Estimate the local timestepping error every interval
+    /// steps by step doubling: the state is also advanced by two half
+    /// steps (reusing the adaptive-timestep solver cache for the
+    /// half-dt operators) and the vorticity difference, scaled by the
+    /// scheme's order per Richardson extrapolation, gives the relative
+    /// error of the full step.  With tol > 0 the estimate closes the
+    /// loop on the timestep: dt is halved while the estimate exceeds
+    /// tol and relaxed back toward nominal once it falls below an
+    /// eighth of it, composing with the CFL bound of
+    /// setAdaptiveTimestep.  An interval of zero disables estimation.
+    /// The estimate costs two extra steps each time, so the interval
+    /// sets the overhead (e.g. 100 for ~2%)
+    void setErrorEstimate( int interval, double tol );
+    /// \brief For stationary geometry, pick the projection solver from
+    /// a cost model instead of always factorizing: the run starts on
+    /// conjugate gradient (no initialization cost), a few probe steps
+    /// measure its iteration count, and if the projected iterations
+    /// over the planned number of steps outweigh the cost of
+    /// factorizing, the Cholesky factorization is computed on the
+    /// background worker while CG keeps stepping and is swapped in
+    /// once ready.  Short runs and small geometries then never pay the
+    /// factorization; long runs converge to direct-solve speed after
+    /// the first few hundred steps.  Incompatible with the adaptive
+    /// timestep (whose dt changes invalidate the comparison)
+    void setAutoSolver( int plannedSteps );
+    /// \brief The most recent step-doubling error estimate (relative,
+    /// on the vorticity); zero until one has been computed
+    double getErrorEstimate() const;
+    /// \brief Register a controller to be called after every step of
+    /// advance(State&) with the advanced state and the per-body forces,
+    /// decomposed from the given geometry's point ranges and rotation
+    /// centers.  The caller retains ownership of both arguments.  A
+    /// controller that moves the bodies should give them a Motion, so
+    /// the model reports itself time-dependent and the operators are
+    /// refreshed each step (see NavierStokesModel::updateOperators)
+    void setController( Controller& controller, const Geometry& geometry );
 
-protected: 
+protected:
 	// methods
 	virtual Scalar N( const State& x ) const = 0;
 	ProjectionSolver* createSolver(double beta);
 	void createAllSolvers();
 	void deleteAllSolvers();
-	
+	double computeCFLTimestep( const State& x ) const;
+	void adjustTimestep( const State& x );
+	void setTimestep( double dt );
+	void applyToleranceSchedule( int substep );
+	void updateToleranceSchedule( const State& x );
+	ProjectionSolver* phaseCachedSolver( int substep, int timestep );
+	void updateSchemeCoeffs();
+	int multirateLevels( int timestep ) const;
+	void applyMultirateHold( Scalar& nonlinear );
+	void computeErrorEstimate( const State& x0, const State& x );
+	void updateAutoSolver();
+	void notifyController( const State& x );
+
 	// data 
 	const Grid& _grid;
 	Scheme _scheme;
 	string _name;
 	double _dt;
+	// Per-substep scheme coefficients premultiplied by the timestep and
+	// viscosity, captured at construction and refreshed when dt changes
+	// (updateSchemeCoeffs), so the substep right-hand side reads three
+	// plain doubles instead of indexing the scheme table every substep
+	struct SubstepCoeffs {
+		double anDt;    // an * dt
+		double bnDt;    // bn * dt
+		double viscDt;  // 0.5 * alpha * (an + bn) * dt
+	};
+	vector< SubstepCoeffs > _coeffs;
 	NavierStokesModel& _model;
 	Scalar _Nprev;
-	Scalar _Ntemp;
+	Scalar _Ntemp;   // scratch for the substep right-hand side (a)
 	bool _oldSaved;
     vector < ProjectionSolver* > _solver;
     double _tol;
+    bool _useUpdatedCholesky;
+    bool _useSinglePrecisionCholesky;
+    bool _usePreconditionedCG;
+    bool _adaptive;
+    double _cfl;
+    double _dtNominal;
+    // Initialized solvers for timesteps not currently active, keyed by
+    // dt (beta follows from dt); the active set is always in _solver
+    std::map< double, vector< ProjectionSolver* > > _solverCache;
+    // Tolerance schedule (see setToleranceSchedule)
+    bool _tolSchedule;
+    double _tolTransientFactor;
+    int _tolTransientSteps;
+    double _tolTightenFactor;
+    double _tolConvergeThreshold;
+    int _stepsTaken;
+    bool _tolTightened;
+    BoundaryVector* _fPrevSched;  // force at the previous step
+    // Phase cache for periodic motions (see setPhaseCache): factorized
+    // solvers keyed by (substep, timestep mod period)
+    bool _phaseCacheEnabled;
+    int _phaseSteps;
+    std::map< std::pair<int,int>, ProjectionSolver* > _phaseSolvers;
+    // Per-state multistep history for the batched advance
+    vector< Scalar > _NprevBatch;
+    vector< bool > _oldSavedBatch;
+    // Multirate advection (see setMultirate): the number of levels
+    // refreshed at the current step, read by N implementations that
+    // support level-capped evaluation, and the held term for the rest
+    int _multirate;
+    int _nonlinearMaxLev;
+    Scalar _NheldMR;
+    bool _NheldSaved;
+    // Embedded error estimation (see setErrorEstimate): the cadence and
+    // tolerance, the latest estimate, and the number of timestep
+    // halvings the error control currently imposes on adjustTimestep
+    int _errInterval;
+    double _errTol;
+    double _errEstimate;
+    int _errHalvings;
+    // Automatic solver selection (see setAutoSolver): phase 0 probes
+    // the CG iteration count, phase 1 has a factorization running on
+    // the background worker (its completion flag set by the worker and
+    // polled each step), phase 2 is decided
+    bool _autoSolver;
+    int _autoPlannedSteps;
+    int _autoStepsTaken;
+    long _autoIterBase;
+    int _autoPhase;
+    vector< ProjectionSolver* > _autoCholesky;
+    int _autoFactorDone;
+    void* _autoTask;
+    // Closed-loop control hook (see setController): the registered
+    // controller and geometry, the cached per-body point ranges, and
+    // the force buffer reused every call
+    Controller* _controller;
+    const Geometry* _controllerGeometry;
+    vector< int > _ctrlBodyBegin;
+    vector< int > _ctrlBodyEnd;
+    vector< Controller::BodyForce > _ctrlForces;
 };
 
 // =============== //
@@ -68,25 +287,38 @@ protected:
 	
 class NonlinearIBSolver : public IBSolver {
 public:
-	NonlinearIBSolver( 
-		Grid& grid, 
+	NonlinearIBSolver(
+		Grid& grid,
 		NavierStokesModel& model,
-		double dt, 
+		double dt,
 		Scheme::SchemeType scheme
         ) :
-        IBSolver( grid, model, dt, scheme ) { };
-    
-    NonlinearIBSolver( 
-        Grid& grid, 
+        IBSolver( grid, model, dt, scheme ),
+        _u( grid ),
+        _v( grid ),
+        _cross( grid ) { };
+
+    NonlinearIBSolver(
+        Grid& grid,
         NavierStokesModel& model,
-        double dt, 
+        double dt,
         Scheme::SchemeType scheme,
         double tol
         ) :
-        IBSolver( grid, model, dt, scheme, tol ) { };
-    
+        IBSolver( grid, model, dt, scheme, tol ),
+        _u( grid ),
+        _v( grid ),
+        _cross( grid ) { };
+
 protected:
 	Scalar N( const State& x ) const;
+
+private:
+	// scratch fields for N, persistent so that no full-grid temporaries
+	// are allocated inside the timestepping loop
+	mutable Scalar _u;
+	mutable Scalar _v;
+	mutable Flux _cross;
 };
 	
 class LinearizedIBSolver : public IBSolver {
@@ -137,14 +369,19 @@ public:
         const State& baseFlow)  :
         IBSolver( grid, model, dt, scheme, tol ),
         _x0( baseFlow ) { }
-	
+
+    /// \brief Replace the base flow, e.g. with the forward state for
+    /// the current reverse step of a trajectory adjoint (the forward
+    /// states are typically supplied by a Checkpointer)
+    void setBaseFlow( const State& x0 ) { _x0 = x0; }
+
 protected:
 	Scalar N(const State& x) const;
-	
+
 private:
 	State _x0;
-};	
-	
+};
+
 //! Navier-Stokes equations linearized about a periodic orbit.
 class LinearizedPeriodicIBSolver : public IBSolver {
 public:
@@ -202,16 +439,34 @@ public:
 		_omegaTemp( grid ),
 		_rhsPrev( grid ),
 		_xhatSaved( false ),
-		_rhsSaved( false ) { }
-    
+		_rhsSaved( false ),
+		_tuneInterval( 0 ) { }
+
     void saveFilteredState( string outdir, string name, string numDigitInFileName );
     void loadFilteredState( string icFile );
-    
+
+    /// \brief Retune chi and Delta online, every interval steps, from
+    /// the history of the filtered-unfiltered residual norm (taken from
+    /// the rhs field the filter update already forms, one fused pass per
+    /// step).  The slope of the log-residual gives the coupled growth
+    /// rate: while the residual grows the gain is raised above it, and
+    /// when the decay is far slower than the gain suggests -- the
+    /// overdamped regime -- the gain is lowered.  The dominant frequency,
+    /// read off the spacing of the residual's oscillation peaks, sets
+    /// the cutoff to 1/omega.  Removes the 5-10x steps-to-steady-state
+    /// penalty of badly guessed parameters; the -chi/-Delta flags only
+    /// seed the first window
+    void setAutoTune( int interval );
+
 protected:
 	Scalar N(const State& x) const;
-	void advanceSubstep( State& x, const Scalar& nonlinear, int i );  
+	void advanceSubstep( State& x, Scalar& nonlinear, int i );  
 
 private:
+	// Re-estimate the dominant instability from the logged residual
+	// norms and reset chi and Delta (see setAutoTune)
+	void retune();
+
 	double _Delta;			// inverse of cutoff frequency
 	double _chi;			// sfd gain
 	State _xhat;
@@ -219,6 +474,8 @@ private:
 	Scalar _rhsPrev;
 	bool _xhatSaved;
 	bool _rhsSaved;
+	int _tuneInterval;		// steps per retune; 0: fixed parameters
+	vector<double> _resHistory;	// log residual norm, one entry per step
 };		
 	
 	
@@ -0,0 +1,150 @@
+// Kernels.cc
+//
+// Description:
+// Flat numerical kernels, with runtime CPU dispatch (see Kernels.h)
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Kernels.h"
+#include <math.h>
+
+// With GCC on x86-64, emit baseline, AVX2, and AVX-512 variants of each
+// kernel and let the dynamic loader pick the widest one the host supports
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define IBPM_MULTIARCH \
+    __attribute__(( target_clones("avx512f","avx2","default") ))
+#else
+#define IBPM_MULTIARCH
+#endif
+
+namespace ibpm {
+
+namespace Kernels {
+
+// Four independent accumulators break the serial dependence of the
+// reduction, so that each variant vectorizes at its full register width
+IBPM_MULTIARCH
+double Dot( const double* a, const double* b, int n ) {
+    double s0 = 0.;
+    double s1 = 0.;
+    double s2 = 0.;
+    double s3 = 0.;
+    int i = 0;
+    for ( ; i <= n-4; i += 4 ) {
+        s0 += a[i]   * b[i];
+        s1 += a[i+1] * b[i+1];
+        s2 += a[i+2] * b[i+2];
+        s3 += a[i+3] * b[i+3];
+    }
+    double sum = (s0 + s1) + (s2 + s3);
+    for ( ; i < n; ++i ) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// No IBPM_MULTIARCH here: the compensated accumulation is sequential by
+// design, and must produce the same bits on every host
+double CompensatedSum( const double* a, int n ) {
+    double sum = 0.;
+    double comp = 0.;
+    for (int i=0; i<n; ++i) {
+        double t = sum + a[i];
+        if ( fabs( sum ) >= fabs( a[i] ) ) {
+            comp += ( sum - t ) + a[i];
+        }
+        else {
+            comp += ( a[i] - t ) + sum;
+        }
+        sum = t;
+    }
+    return sum + comp;
+}
+
+IBPM_MULTIARCH
+void Axpy( double* y, double a, const double* x, int n ) {
+    for (int i=0; i<n; ++i) {
+        y[i] += a * x[i];
+    }
+}
+
+IBPM_MULTIARCH
+void Diff( double* out, const double* a, const double* b, int n ) {
+    for (int i=0; i<n; ++i) {
+        out[i] = a[i] - b[i];
+    }
+}
+
+IBPM_MULTIARCH
+void DiffAdd( double* out, const double* a, const double* b,
+              const double* c, int n ) {
+    for (int i=0; i<n; ++i) {
+        out[i] = a[i] - b[i] + c[i];
+    }
+}
+
+IBPM_MULTIARCH
+void Avg( double* out, const double* a, const double* b, double s, int n ) {
+    for (int i=0; i<n; ++i) {
+        out[i] = ( a[i] + b[i] ) * s;
+    }
+}
+
+IBPM_MULTIARCH
+void CrossRow( double* out,
+               const double* x1, const double* y1a, const double* y1b,
+               const double* x2, const double* y2a, const double* y2b,
+               double s, int n ) {
+    for (int i=0; i<n; ++i) {
+        out[i] = ( ( x1[i] + x1[i+1] ) * ( y2a[i] + y2b[i] )
+                 - ( x2[i] + x2[i+1] ) * ( y1a[i] + y1b[i] ) ) * s;
+    }
+}
+
+IBPM_MULTIARCH
+void Stencil5( double* out, const double* c, const double* up,
+               const double* dn, double s, int n ) {
+    for (int i=0; i<n; ++i) {
+        out[i] = ( up[i] + dn[i] + c[i-1] + c[i+1] - 4. * c[i] ) * s;
+    }
+}
+
+IBPM_MULTIARCH
+void Restrict9( double* out, const double* mid, const double* up,
+                const double* dn, int n ) {
+    for (int k=0; k<n; ++k) {
+        int f = 2 * k;
+        out[k] = 0.25 * mid[f]
+            + 0.125  * ( mid[f-1] + mid[f+1] + up[f] + dn[f] )
+            + 0.0625 * ( up[f-1] + up[f+1] + dn[f-1] + dn[f+1] );
+    }
+}
+
+IBPM_MULTIARCH
+void CoarsenSum( double* out, const double* a, const double* b, int n ) {
+    for (int k=0; k<n; ++k) {
+        out[k] = a[2*k] + b[2*k];
+    }
+}
+
+IBPM_MULTIARCH
+double RowDot( const double* w, const int* ind, const double* x,
+               int begin, int end ) {
+    double sum = 0.;
+    for (int k=begin; k<end; ++k) {
+        sum += w[k] * x[ ind[k] ];
+    }
+    return sum;
+}
+
+} // namespace Kernels
+
+} // namespace ibpm
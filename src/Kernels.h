@@ -0,0 +1,101 @@
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+/*!
+    \file Kernels.h
+
+    \brief Flat numerical kernels, with runtime CPU dispatch.
+
+    The hot loops of the field operations, the conjugate gradient solver,
+    and the regularizer reduce to a handful of flat kernels over contiguous
+    data.  They are collected here in one translation unit and compiled
+    with GCC function multi-versioning (target_clones): the compiler emits
+    a baseline variant plus AVX2 and AVX-512 variants of each kernel, and
+    the dynamic loader selects the widest one the host supports when the
+    binary starts.  A single binary therefore runs at full SIMD width on
+    every node of a heterogeneous cluster, with no per-machine rebuilds.
+
+    On compilers or architectures without multi-versioning the kernels
+    compile once at the build's default ISA, with identical results.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+namespace ibpm {
+
+namespace Kernels {
+
+/// \brief Return the dot product of two contiguous ranges of length n
+double Dot( const double* a, const double* b, int n );
+
+/// \brief Return the sum of a contiguous range of length n, accumulated
+/// in index order with Neumaier compensation.  Deliberately not
+/// multi-versioned: the sequential fixed-order loop gives bitwise
+/// identical results on every host and at any thread count, which
+/// regression comparisons against archived histories rely on
+double CompensatedSum( const double* a, int n );
+
+/// \brief y += a * x, over contiguous ranges of length n
+void Axpy( double* y, double a, const double* x, int n );
+
+/// \brief out[i] = a[i] - b[i], over contiguous ranges of length n
+void Diff( double* out, const double* a, const double* b, int n );
+
+/// \brief out[i] = a[i] - b[i] + c[i], over contiguous ranges of
+/// length n (a difference with a folded-in additive field)
+void DiffAdd( double* out, const double* a, const double* b,
+              const double* c, int n );
+
+/// \brief out[i] = ( a[i] + b[i] ) * s, over contiguous ranges of
+/// length n: the scaled two-point average at the core of the flux /
+/// velocity conversions (see FluxToVelocity in VectorOperations)
+void Avg( double* out, const double* a, const double* b, double s, int n );
+
+/// \brief out[i] = ( ( x1[i] + x1[i+1] ) * ( y2a[i] + y2b[i] )
+///               -   ( x2[i] + x2[i+1] ) * ( y1a[i] + y1b[i] ) ) * s,
+/// over contiguous ranges of length n: one row of the cross product of
+/// two fluxes, u1 v2 - u2 v1, formed directly from the six flux rows it
+/// touches (see CrossProduct in VectorOperations)
+void CrossRow( double* out,
+               const double* x1, const double* y1a, const double* y1b,
+               const double* x2, const double* y2a, const double* y2b,
+               double s, int n );
+
+/// \brief out[i] = ( up[i] + dn[i] + c[i-1] + c[i+1] - 4*c[i] ) * s,
+/// over contiguous ranges of length n: one interior row of the 5-point
+/// Laplacian stencil (see Laplacian in VectorOperations).  c must be
+/// readable from c[-1] to c[n], and out must not alias the inputs
+void Stencil5( double* out, const double* c, const double* up,
+               const double* dn, double s, int n );
+
+/// \brief out[k] = 0.25 * mid[2k]
+///              + 0.125  * ( mid[2k-1] + mid[2k+1] + up[2k] + dn[2k] )
+///              + 0.0625 * ( up[2k-1] + up[2k+1] + dn[2k-1] + dn[2k+1] ),
+/// for k in [0,n): one coarse row of the 9-point full-weighting
+/// restriction (see Scalar::coarsify), reading three fine rows at
+/// stride two.  Each row must be readable from index -1 to 2n-1, and
+/// out must not alias the inputs
+void Restrict9( double* out, const double* mid, const double* up,
+                const double* dn, int n );
+
+/// \brief out[k] = a[2k] + b[2k], for k in [0,n): one coarse row of the
+/// two-point restriction sums of the flux coarsening (see
+/// X/YVelocityToFlux in VectorOperations); pass b = a + 1 to sum
+/// adjacent entries of a single fine row.  out must not alias the inputs
+void CoarsenSum( double* out, const double* a, const double* b, int n );
+
+/// \brief Return the sum over k in [begin,end) of w[k] * x[ ind[k] ]:
+/// the gather-and-accumulate at the core of the delta-function smearing
+/// and interpolation rows (see Regularizer)
+double RowDot( const double* w, const int* ind, const double* x,
+               int begin, int end );
+
+} // namespace Kernels
+
+} // namespace ibpm
+
+#endif /* _KERNELS_H_ */
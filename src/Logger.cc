@@ -14,13 +14,20 @@
 // $HeadURL$
 
 #include <assert.h>
+#include <iostream>
+#include <limits.h>
+#include <math.h>
 #include <vector>
 #include "Output.h"
 #include "BaseFlow.h"
 #include "State.h"
+#include "Timers.h"
 #include "Logger.h"
 
 
+using std::cout;
+using std::endl;
+
 namespace ibpm {
 
 #define LOOP_OVER_ALL_OUTPUTS( a )                                          \
@@ -34,24 +41,363 @@ namespace ibpm {
 
 
 Logger::Logger() {
+    _stepSeconds = 0.;
+    _lastClock = 0.;
+    _lastStep = -1;
     _hasBeenInitialized = false;
+    _asynchronous = false;
+    _writerRunning = false;
+    _writerSuccessful = true;
+    _snapshotHasBaseFlow = false;
+    _snapshotAllocated = false;
+    _ringNext = 0;
+    _ringCount = 0;
+    _prevValid = false;
+    _interpAllocated = false;
+}
+
+Logger::~Logger() {
+    waitForWriter();
+}
+
+void Logger::setAsynchronous( bool asynchronous ) {
+    if ( ! asynchronous ) {
+        waitForWriter();
+    }
+    _asynchronous = asynchronous;
 }
 
 void Logger::addOutput(Output* output, int numSkip) {
     Entry entry;
     entry.output = output;
     entry.numSkip = numSkip;
+    entry.adaptive = false;
+    entry.targetFraction = 0.;
+    entry.minSkip = numSkip;
+    entry.maxSkip = numSkip;
+    entry.nextStep = -1;
+    entry.avgCost = 0.;
+    entry.trigger = NULL;
+    entry.burstSkip = 1;
+    entry.burstSteps = 0;
+    entry.preSteps = 0;
+    entry.burstStart = -1;
+    entry.burstUntil = -1;
+    entry.lastEventStep = -1;
+    entry.heavy = false;
+    entry.phase = 0;
+    entry.lockPeriod = 0.;
+    entry.lockPhases = 0;
+    entry.lockLast = LONG_MIN;
     _outputs.push_back(entry);
 }
 
+void Logger::setPhaseLock( Output* output, double period, int numPhases ) {
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->output == output ) {
+            entry->lockPeriod = period;
+            entry->lockPhases = ( period > 0. && numPhases > 0 ) ?
+                numPhases : 0;
+            entry->lockLast = LONG_MIN;
+        }
+    }
+}
+
+void Logger::setHeavy( Output* output ) {
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->output == output ) {
+            entry->heavy = true;
+        }
+    }
+}
+
+static int gcdInt( int a, int b ) {
+    while ( b != 0 ) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+void Logger::assignPhases() {
+    // Greedy placement: each heavy routine, in registration order,
+    // takes the phase minimizing how often it fires on the same step
+    // as the heavy routines placed before it.  Two schedules with
+    // strides s1, s2 and phases p1, p2 coincide iff p1 = p2 modulo
+    // gcd(s1,s2), and then once every lcm(s1,s2) steps, so that rate
+    // is the cost of a candidate phase.  The first heavy routine keeps
+    // phase zero, and with it the output at timestep zero
+    vector<Entry*> placed;
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( ! entry->heavy || entry->numSkip <= 1 ) continue;
+        int bestPhase = 0;
+        double bestCost = -1.;
+        for (int p = 0; p < entry->numSkip; ++p) {
+            double cost = 0.;
+            for (size_t k = 0; k < placed.size(); ++k) {
+                int g = gcdInt( entry->numSkip, placed[k]->numSkip );
+                if ( ( p - placed[k]->phase ) % g == 0 ) {
+                    cost += (double) g /
+                        ( (double) entry->numSkip * placed[k]->numSkip );
+                }
+            }
+            if ( bestCost < 0. || cost < bestCost ) {
+                bestCost = cost;
+                bestPhase = p;
+            }
+        }
+        entry->phase = bestPhase;
+        placed.push_back( &*entry );
+    }
+}
+
+void Logger::setAdaptiveInterval( Output* output, double targetFraction,
+                                  int minSkip, int maxSkip ) {
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->output == output ) {
+            entry->adaptive = true;
+            entry->targetFraction = targetFraction;
+            entry->minSkip = ( minSkip > 0 ) ? minSkip : 1;
+            entry->maxSkip = ( maxSkip >= entry->minSkip ) ? maxSkip
+                                                           : entry->minSkip;
+        }
+    }
+}
+
+void Logger::setTrigger( Output* output, OutputTrigger* trigger,
+                         int burstSkip, int burstSteps, int preSteps ) {
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->output == output ) {
+            entry->trigger = trigger;
+            entry->burstSkip = ( burstSkip > 0 ) ? burstSkip : 1;
+            entry->burstSteps = ( burstSteps > 0 ) ? burstSteps : 0;
+            entry->preSteps = ( preSteps > 0 ) ? preSteps : 0;
+            // Grow the shared ring to the largest preSteps requested;
+            // the states inside stay unallocated until first captured
+            if ( entry->preSteps > (int) _ring.size() ) {
+                _ring.resize( entry->preSteps );
+                _ringNext = 0;
+                _ringCount = 0;
+            }
+        }
+    }
+}
+
+void Logger::flushRing( Entry& entry, const BaseFlow* q ) {
+    int cap = _ring.size();
+    for (int i = 0; i < _ringCount; ++i) {
+        State& s = _ring[ (_ringNext - _ringCount + i + cap) % cap ];
+        // Keep only the last preSteps states, and skip any this
+        // routine's regular schedule (or a previous burst) already wrote
+        if ( _ringCount - i > entry.preSteps ) continue;
+        if ( s.timestep <= entry.lastEventStep ) continue;
+        if ( entry.numSkip > 0 && s.timestep % entry.numSkip == 0 ) continue;
+        if ( q != NULL ) entry.output->doOutput( *q, s );
+        else entry.output->doOutput( s );
+    }
+}
+
+void Logger::checkTriggers( const BaseFlow* q, const State& x ) {
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->trigger == NULL ) continue;
+        if ( entry->burstUntil >= 0 && x.timestep <= entry->burstUntil ) {
+            continue;   // burst already in progress
+        }
+        if ( entry->trigger->test( x ) ) {
+            cout << "Output trigger fired at step " << x.timestep
+                 << ": bursting every " << entry->burstSkip
+                 << " step(s) for " << entry->burstSteps
+                 << " step(s)" << endl;
+            // The pre-trigger states are written here, synchronously:
+            // triggers are rare, and the ring must be free for the
+            // steps that follow.  For an unsteady base flow the
+            // current q stands in for the (slightly earlier) buffered
+            // instants
+            flushRing( *entry, q );
+            entry->burstStart = x.timestep;
+            entry->burstUntil = x.timestep + entry->burstSteps;
+            entry->lastEventStep = entry->burstUntil;
+        }
+    }
+    // Capture after testing, so the ring holds the steps strictly
+    // before a trigger; the trigger step itself opens the burst
+    if ( _ring.size() > 0 ) {
+        _ring[_ringNext] = x;
+        _ringNext = (_ringNext + 1) % _ring.size();
+        if ( _ringCount < (int) _ring.size() ) ++_ringCount;
+    }
+}
+
+void Logger::trackStepTime( int timestep ) {
+    double now = Timers::readClock();
+    if ( _lastStep >= 0 && timestep > _lastStep ) {
+        double perStep = ( now - _lastClock ) / ( timestep - _lastStep );
+        _stepSeconds = ( _stepSeconds > 0. ) ?
+            0.9 * _stepSeconds + 0.1 * perStep : perStep;
+    }
+    _lastClock = now;
+    _lastStep = timestep;
+}
+
+bool Logger::callEntry( Entry& entry, const BaseFlow* q, const State& x ) {
+    if ( ! entry.adaptive ) {
+        if ( q != NULL ) return entry.output->doOutput( *q, x );
+        return entry.output->doOutput( x );
+    }
+    double start = Timers::readClock();
+    bool result = ( q != NULL ) ? entry.output->doOutput( *q, x )
+                                : entry.output->doOutput( x );
+    double cost = Timers::readClock() - start;
+    entry.avgCost = ( entry.avgCost > 0. ) ?
+        0.5 * ( entry.avgCost + cost ) : cost;
+    // Space the next call so this routine's cost stays near the target
+    // fraction of wall time, within the configured floor and ceiling
+    int skip = entry.maxSkip;
+    if ( _stepSeconds > 0. && entry.targetFraction > 0. ) {
+        double steps = entry.avgCost / ( entry.targetFraction * _stepSeconds );
+        if ( steps < (double) entry.maxSkip ) {
+            skip = (int) ( steps + 1. );
+        }
+    }
+    if ( skip < entry.minSkip ) skip = entry.minSkip;
+    entry.nextStep = x.timestep + skip;
+    return result;
+}
+
+void Logger::interpolateState( const State& a, const State& b, double s,
+                               State& out ) {
+    if ( ! _interpAllocated ) {
+        out.resize( b.omega.getGrid(), b.f.getNumPoints() );
+        _interpAllocated = true;
+    }
+    // Start from a copy-on-write copy of a; scaling detaches it.  The
+    // scaled-b temporaries are grid-sized, but locked phases are sparse
+    double w = 1. - s;
+    out = a;
+    out.omega *= w;
+    out.omega += b.omega * s;
+    out.q *= w;
+    out.q += b.q * s;
+    out.f *= w;
+    BoundaryVector fScaled = b.f;
+    fScaled *= s;
+    out.f += fScaled;
+    out.time = a.time + s * ( b.time - a.time );
+    out.timestep = b.timestep;
+}
+
+// Phase-locked outputs run on the stepping thread in both modes, like
+// the pre-trigger flush: the interpolant needs the two bracketing
+// states, which the writer-thread snapshot does not carry
+bool Logger::checkPhaseLocks( const BaseFlow* q, const State& x ) {
+    bool successful = true;
+    bool anyLocked = false;
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->lockPhases <= 0 ) continue;
+        anyLocked = true;
+        if ( ! _prevValid || x.time <= _xPrev.time ) continue;
+        double spacing = entry->lockPeriod / entry->lockPhases;
+        if ( entry->lockLast == LONG_MIN ) {
+            // First step with a previous state: phases at or before it
+            // cannot be interpolated and are skipped
+            entry->lockLast = (long) floor( _xPrev.time / spacing + 1e-9 );
+        }
+        // Phase indices run over all cycles; every phase time in
+        // (previous time, current time] gets an interpolated frame
+        long kmax = (long) floor( x.time / spacing + 1e-9 );
+        for (long k = entry->lockLast + 1; k <= kmax; ++k) {
+            double t = k * spacing;
+            double s = ( t - _xPrev.time ) / ( x.time - _xPrev.time );
+            interpolateState( _xPrev, x, s, _xInterp );
+            bool result = callEntry( *entry, q, _xInterp );
+            successful = successful && result;
+        }
+        if ( kmax > entry->lockLast ) entry->lockLast = kmax;
+    }
+    if ( anyLocked ) {
+        _xPrev = x;
+        _prevValid = true;
+    }
+    return successful;
+}
+
+bool Logger::anyOutputDue( const State& x ) {
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        if ( entry->shouldBeCalled( x ) ) return true;
+    }
+    return false;
+}
+
+bool Logger::waitForWriter() {
+    if ( ! _writerRunning ) return true;
+    pthread_join( _writerThread, NULL );
+    _writerRunning = false;
+    return _writerSuccessful;
+}
+
+void* Logger::runWriter( void* logger ) {
+    Logger& self = *static_cast<Logger*>( logger );
+    ScopedTimer timer( Timers::OUTPUT );
+    vector<Entry>::iterator entry;
+    bool successful = true;
+    for (entry = self._outputs.begin(); entry != self._outputs.end(); ++entry) {
+        if ( entry->shouldBeCalled( self._xSnapshot ) ) {
+            const BaseFlow* q = self._snapshotHasBaseFlow ?
+                &self._qSnapshot : NULL;
+            bool result = self.callEntry( *entry, q, self._xSnapshot );
+            successful = successful && result;
+        }
+    }
+    self._writerSuccessful = successful;
+    return NULL;
+}
+
+bool Logger::startWriter( const State& x ) {
+    if ( ! _snapshotAllocated ) {
+        _xSnapshot.resize( x.omega.getGrid(), x.f.getNumPoints() );
+        _snapshotAllocated = true;
+    }
+    _xSnapshot = x;
+    if ( pthread_create( &_writerThread, NULL, runWriter, this ) != 0 ) {
+        // Could not start a thread: write synchronously instead
+        runWriter( this );
+        return _writerSuccessful;
+    }
+    _writerRunning = true;
+    return true;
+}
+
 /// \brief Call all output routines needed at the current timestep,.
 bool Logger::doOutput(const State& x) {
     assert( _hasBeenInitialized );
+    if ( _asynchronous ) {
+        bool successful = waitForWriter();
+        checkTriggers( NULL, x );
+        trackStepTime( x.timestep );
+        successful = checkPhaseLocks( NULL, x ) && successful;
+        if ( anyOutputDue( x ) ) {
+            _snapshotHasBaseFlow = false;
+            successful = startWriter( x ) && successful;
+        }
+        return successful;
+    }
+    checkTriggers( NULL, x );
+    trackStepTime( x.timestep );
+    ScopedTimer timer( Timers::OUTPUT );
     vector<Entry>::iterator entry;
-    bool successful = true;
+    bool successful = checkPhaseLocks( NULL, x );
     for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
         if ( entry->shouldBeCalled( x ) ) {
-            bool result = (entry->output)->doOutput( x );
+            bool result = callEntry( *entry, NULL, x );
             successful = successful && result;
         }
     }
@@ -61,11 +407,26 @@ bool Logger::doOutput(const State& x) {
 /// \brief Call all output routines needed at the current timestep, using baseflow.
 bool Logger::doOutput(const BaseFlow& q, const State& x) {
 	assert( _hasBeenInitialized );
+    if ( _asynchronous ) {
+        bool successful = waitForWriter();
+        checkTriggers( &q, x );
+        trackStepTime( x.timestep );
+        successful = checkPhaseLocks( &q, x ) && successful;
+        if ( anyOutputDue( x ) ) {
+            _qSnapshot = q;
+            _snapshotHasBaseFlow = true;
+            successful = startWriter( x ) && successful;
+        }
+        return successful;
+    }
+    checkTriggers( &q, x );
+    trackStepTime( x.timestep );
+    ScopedTimer timer( Timers::OUTPUT );
     vector<Entry>::iterator entry;
-    bool successful = true;
+    bool successful = checkPhaseLocks( &q, x );
     for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
         if ( entry->shouldBeCalled( x ) ) {
-            bool result = (entry->output)->doOutput( q , x );
+            bool result = callEntry( *entry, &q, x );
             successful = successful && result;
         }
     }
@@ -75,13 +436,20 @@ bool Logger::doOutput(const BaseFlow& q, const State& x) {
 // Initialize all of the output routines.
 bool Logger::init() {
     _hasBeenInitialized = true;
+    assignPhases();
     LOOP_OVER_ALL_OUTPUTS( init() );
 }
 
-/// Clean up all of the output routines.
+/// Clean up all of the output routines, once any outstanding writes finish.
 bool Logger::cleanup() {
     assert( _hasBeenInitialized );
-    LOOP_OVER_ALL_OUTPUTS( cleanup() );
+    bool successful = waitForWriter();
+    vector<Entry>::iterator entry;
+    for (entry = _outputs.begin(); entry != _outputs.end(); ++entry) {
+        bool result = (entry->output)->cleanup();
+        successful = successful && result;
+    }
+    return successful;
 }
 
 #undef LOOP_OVER_ALL_OUTPUTS
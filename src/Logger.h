@@ -3,6 +3,7 @@
 
 #include "BaseFlow.h"
 #include "State.h"
+#include <pthread.h>
 #include <vector>
 
 using std::vector;
@@ -14,9 +15,9 @@ class Output;
 /*!
     \file Logger.h
     \class Logger
-    
+
     \brief Maintain a list of output routines, and call them when specified.
-    
+
     \author Clancy Rowley
     \date 21 Aug 2008
 
@@ -25,10 +26,35 @@ class Output;
     \version $Revision$
 */
 
+/// \brief Predicate for event-triggered output (see Logger::setTrigger).
+/// Subclasses test the current state -- or quantities derived from it,
+/// such as the FlowMonitor values or a probe signal -- and return true
+/// to start a high-rate output burst
+class OutputTrigger {
+public:
+    virtual ~OutputTrigger() {}
+    /// \brief Return true to trigger a burst at the current state.
+    /// Called once per timestep while no burst is active
+    virtual bool test( const State& x ) = 0;
+};
+
 class Logger {
 public:
     Logger();
-    
+
+    /// Destructor: waits for an outstanding writer thread, if any
+    ~Logger();
+
+    /// \brief Select asynchronous or synchronous output (default synchronous).
+    /// In asynchronous mode, doOutput copies the state (and base flow) into
+    /// an internal snapshot and returns once a background thread has taken
+    /// over, so file I/O overlaps the timesteps that follow.  The state
+    /// snapshot is a constant-time copy-on-write copy (see State), so
+    /// the pause before the thread takes over is negligible.  The results
+    /// of the output routines are folded into the next call to doOutput
+    /// (or cleanup), one output step late.
+    void setAsynchronous( bool asynchronous );
+
     /// \brief Add the specified Output to the list of output routines.
     /// The caller is responsible for allocating and deallocating memory for
     /// Output.
@@ -37,6 +63,57 @@ public:
     ///             (number of timesteps).
     void addOutput(Output* output, int numSkip);
 
+    /// \brief Adapt the interval of an already-added output routine so
+    /// that the time it spends writing stays near the given fraction of
+    /// wall time.  Each call of the routine is timed, and the interval
+    /// to its next call is set to (average cost) / (target * time per
+    /// step), clamped to [minSkip, maxSkip]; the numSkip given to
+    /// addOutput schedules the first call.  On a shared filesystem this
+    /// checkpoints as often as the observed write bandwidth affords,
+    /// instead of a fixed count tuned for one machine.  In asynchronous
+    /// mode the cost is measured on the writer thread, so the target
+    /// caps the I/O bandwidth consumed rather than time the timestepping
+    /// loop actually loses
+    void setAdaptiveInterval( Output* output, double targetFraction,
+                              int minSkip, int maxSkip );
+
+    /// \brief Attach a conditional trigger to an already-added output
+    /// routine.  The trigger is tested once per timestep; when it fires,
+    /// the routine switches to a high-rate burst -- called every
+    /// burstSkip steps for the next burstSteps steps -- and the last
+    /// preSteps states, kept in a ring buffer of constant-time
+    /// copy-on-write copies, are flushed through it first, so the event
+    /// is resolved from before its onset.  An output added with
+    /// numSkip <= 0 is called only during bursts, giving event-resolved
+    /// data without the steady high-cadence I/O.  The caller keeps
+    /// ownership of the trigger, as with the output itself
+    void setTrigger( Output* output, OutputTrigger* trigger,
+                     int burstSkip, int burstSteps, int preSteps );
+
+    /// \brief Mark an already-added output routine as heavy, allowing
+    /// init() to offset its schedule.  When several heavy routines
+    /// share stride multiples they all fire on the same step -- the
+    /// worst-case stall -- so each heavy routine is given a phase
+    /// offset chosen to minimize how often it coincides with the heavy
+    /// routines registered before it; the first keeps phase zero.
+    /// Only meaningful for routines whose output steps are
+    /// interchangeable (snapshots, restarts), not for sampled signals
+    void setHeavy( Output* output );
+
+    /// \brief Phase-lock an already-added output routine to a periodic
+    /// motion: the routine is called at the numPhases equally spaced
+    /// phases of the given period, with the state interpolated linearly
+    /// in time between the two steps bracketing each phase.  The
+    /// previous state is kept as a constant-time copy-on-write copy, so
+    /// the output phases are decoupled from dt and the run can use the
+    /// CFL-optimal timestep rather than one that divides the period.
+    /// The interpolated state carries the exact phase time and the
+    /// bracketing step's index; with dt below the phase spacing each
+    /// step yields at most one frame.  An output added with
+    /// numSkip <= 0 is called only at the locked phases, as with
+    /// trigger-only outputs
+    void setPhaseLock( Output* output, double period, int numPhases );
+
     /// \brief Call all output routines needed at the current timestep.
     bool doOutput(const State& x);
     
@@ -53,12 +130,119 @@ private:
     struct Entry {
         Output* output;
         int numSkip;
+        // Adaptive cadence (see setAdaptiveInterval); until the first
+        // call establishes a cost estimate, nextStep is negative and
+        // the fixed numSkip schedule applies
+        bool adaptive;
+        double targetFraction;
+        int minSkip;
+        int maxSkip;
+        int nextStep;
+        double avgCost;     // smoothed seconds per call
+        // Conditional trigger (see setTrigger); while a burst is
+        // active, the burst schedule overrides the regular cadence
+        OutputTrigger* trigger;
+        int burstSkip;
+        int burstSteps;
+        int preSteps;
+        int burstStart;     // timestep the active burst began, or -1
+        int burstUntil;     // last timestep of the active burst, or -1
+        int lastEventStep;  // last timestep covered by a previous burst
+        // Staggering (see setHeavy); phase stays 0 unless init()
+        // offsets this entry's schedule
+        bool heavy;
+        int phase;
+        // Phase locking (see setPhaseLock); lockLast is the index of
+        // the last phase written (over all cycles), or LONG_MIN until
+        // the first step with a previous state establishes it
+        double lockPeriod;
+        int lockPhases;
+        long lockLast;
         inline bool shouldBeCalled(const State& x) {
-            return (x.timestep % numSkip == 0);
+            if ( trigger != 0 && burstUntil >= 0 && x.timestep <= burstUntil ) {
+                return ((x.timestep - burstStart) % burstSkip == 0);
+            }
+            if ( numSkip <= 0 ) return false;   // trigger-only output
+            if ( adaptive && nextStep >= 0 ) {
+                return x.timestep >= nextStep;
+            }
+            return ((x.timestep - phase) % numSkip == 0);
         }
     };
+    // Return true if any output routine is due at the current timestep
+    bool anyOutputDue( const State& x );
+
+    // Test the triggers of entries not currently bursting, starting a
+    // burst (and flushing the pre-trigger ring) for any that fire, then
+    // capture the current state into the ring; called once per doOutput,
+    // before any writer thread is started
+    void checkTriggers( const BaseFlow* q, const State& x );
+
+    // Write the buffered pre-trigger states through one output routine,
+    // oldest first, skipping states its regular schedule already wrote
+    void flushRing( Entry& entry, const BaseFlow* q );
+
+    // Choose phase offsets for the heavy entries (see setHeavy);
+    // called once, from init()
+    void assignPhases();
+
+    // Write the phase-locked outputs due between the previous and the
+    // current state (see setPhaseLock), then capture the current state
+    // as the new previous one; called once per doOutput
+    bool checkPhaseLocks( const BaseFlow* q, const State& x );
+
+    // Set out to the linear interpolant between a (at s = 0) and b
+    // (at s = 1), with the interpolated time and b's step index
+    void interpolateState( const State& a, const State& b, double s,
+                           State& out );
+
+    // Run one output routine (with the base flow if q is non-NULL),
+    // timing it and rescheduling if its interval is adaptive
+    bool callEntry( Entry& entry, const BaseFlow* q, const State& x );
+
+    // Fold the wall time since the previous call into the smoothed
+    // time-per-timestep estimate; called once per doOutput
+    void trackStepTime( int timestep );
+
+    // Wait for an outstanding writer thread and return its result
+    // (true if no writer is outstanding)
+    bool waitForWriter();
+
+    // Copy the state into the snapshot and start the writer thread;
+    // falls back to writing synchronously if no thread can be started
+    bool startWriter( const State& x );
+
+    // Body of the writer thread: run all output routines due at the
+    // snapshot's timestep
+    static void* runWriter( void* logger );
+
     vector<Entry> _outputs;
+    // Smoothed wall time per timestep, measured between successive
+    // calls to doOutput, and the clock and timestep of the last call
+    double _stepSeconds;
+    double _lastClock;
+    int _lastStep;
     bool _hasBeenInitialized;
+    bool _asynchronous;
+    bool _writerRunning;
+    bool _writerSuccessful;
+    pthread_t _writerThread;
+    State _xSnapshot;
+    BaseFlow _qSnapshot;
+    bool _snapshotHasBaseFlow;
+    bool _snapshotAllocated;
+    // Pre-trigger ring buffer of recent states (copy-on-write copies),
+    // sized to the largest preSteps of any trigger; _ringNext is the
+    // slot the next capture overwrites
+    vector<State> _ring;
+    int _ringNext;
+    int _ringCount;
+    // Previous state (a copy-on-write copy) and the interpolated frame,
+    // for phase-locked outputs
+    State _xPrev;
+    bool _prevValid;
+    State _xInterp;
+    bool _interpAllocated;
 };
 
 #undef LOOP_OVER_ALL_OUTPUTS
@@ -0,0 +1,224 @@
+// Memory.cc
+//
+// Description:
+// Implementation of the allocation accounting behind Memory.h
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Memory.h"
+#include <assert.h>
+#include <iomanip>
+#include <pthread.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+namespace ibpm {
+
+namespace Memory {
+
+namespace {
+
+    const char* _names[NUM_TAGS] = {
+        "Scalar",
+        "Flux",
+        "boundary",
+        "State",
+        "Cholesky",
+        "FFT",
+        "other"
+    };
+
+    long long _current[NUM_TAGS];
+    long long _peak[NUM_TAGS];
+    long long _totalCurrent = 0;
+    long long _totalPeak = 0;
+
+    // Backing requested per owner tag (see setHugePages / setPinned).
+    // Only allocations of at least one huge page are affected: the 2MB
+    // alignment would waste more than it saves on anything smaller
+    const size_t _hugePageSize = 2u << 20;
+    bool _hugePages[NUM_TAGS];
+    bool _pinned[NUM_TAGS];
+    bool _mlockWarned = false;
+
+    // Fields may be allocated concurrently by the asynchronous output
+    // thread (see Logger), so the totals are updated under a mutex, and
+    // the owner tag in effect is kept per thread
+    pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+#if defined(__GNUC__)
+    __thread int _currentTag = OTHER;
+#else
+    int _currentTag = OTHER;
+#endif
+
+} // namespace
+
+int currentTag() {
+    return _currentTag;
+}
+
+int setTag( int tag ) {
+    assert( tag >= 0 && tag < NUM_TAGS );
+    int previous = _currentTag;
+    _currentTag = tag;
+    return previous;
+}
+
+void recordAlloc( int tag, size_t bytes ) {
+    assert( tag >= 0 && tag < NUM_TAGS );
+    pthread_mutex_lock( &_mutex );
+    _current[tag] += (long long) bytes;
+    if ( _current[tag] > _peak[tag] ) _peak[tag] = _current[tag];
+    _totalCurrent += (long long) bytes;
+    if ( _totalCurrent > _totalPeak ) _totalPeak = _totalCurrent;
+    pthread_mutex_unlock( &_mutex );
+}
+
+void recordFree( int tag, size_t bytes ) {
+    assert( tag >= 0 && tag < NUM_TAGS );
+    pthread_mutex_lock( &_mutex );
+    _current[tag] -= (long long) bytes;
+    _totalCurrent -= (long long) bytes;
+    pthread_mutex_unlock( &_mutex );
+}
+
+size_t currentBytes() {
+    return (size_t) _totalCurrent;
+}
+
+size_t peakBytes() {
+    return (size_t) _totalPeak;
+}
+
+void setHugePages( int tag, bool flag ) {
+    assert( tag >= 0 && tag < NUM_TAGS );
+    _hugePages[tag] = flag;
+}
+
+void setPinned( int tag, bool flag ) {
+    assert( tag >= 0 && tag < NUM_TAGS );
+    _pinned[tag] = flag;
+}
+
+bool setBackingByName( const string& list, bool pinned ) {
+    const char* s = list.c_str();
+    while ( *s != '\0' ) {
+        const char* comma = strchr( s, ',' );
+        string name = comma ? string( s, comma - s ) : string( s );
+        int first, last;
+        if ( name == "fields" )        { first = SCALAR;   last = FLUX; }
+        else if ( name == "state" )    { first = STATE;    last = STATE; }
+        else if ( name == "boundary" ) { first = BOUNDARY; last = BOUNDARY; }
+        else if ( name == "cholesky" ) { first = CHOLESKY; last = CHOLESKY; }
+        else if ( name == "fft" )      { first = FFT;      last = FFT; }
+        else if ( name == "other" )    { first = OTHER;    last = OTHER; }
+        else if ( name == "all" )      { first = 0;        last = NUM_TAGS-1; }
+        else return false;
+        for (int t=first; t<=last; ++t) {
+            if ( pinned ) setPinned( t, true );
+            else setHugePages( t, true );
+        }
+        if ( ! comma ) break;
+        s = comma + 1;
+    }
+    return true;
+}
+
+void printReport( ostream& out, const string& label ) {
+    const double MB = 1. / (1024. * 1024.);
+    // This report may print before the run starts, so put the stream's
+    // formatting back the way it was found
+    ios::fmtflags oldFlags = out.flags();
+    streamsize oldPrecision = out.precision();
+    pthread_mutex_lock( &_mutex );
+    out << "\n-- memory usage " << label << " (MB) --" << endl;
+    out << setw(10) << left << "owner" << right
+        << setw(12) << "current"
+        << setw(12) << "peak" << endl;
+    out << fixed << setprecision(1);
+    for (int t=0; t<NUM_TAGS; ++t) {
+        if ( _peak[t] == 0 ) continue;
+        out << setw(10) << left << _names[t] << right
+            << setw(12) << _current[t] * MB
+            << setw(12) << _peak[t] * MB;
+        if ( _hugePages[t] && _pinned[t] ) out << "  huge+pinned";
+        else if ( _hugePages[t] ) out << "  huge";
+        else if ( _pinned[t] ) out << "  pinned";
+        out << endl;
+    }
+    out << setw(10) << left << "total" << right
+        << setw(12) << _totalCurrent * MB
+        << setw(12) << _totalPeak * MB << endl;
+    out << "------------------------------" << endl;
+    out.flags( oldFlags );
+    out.precision( oldPrecision );
+    pthread_mutex_unlock( &_mutex );
+}
+
+} // namespace Memory
+
+} // namespace ibpm
+
+// Accounting hooks called from the Array classes (see Array.h)
+namespace Array {
+
+int accountAlloc( size_t bytes ) {
+    int tag = ibpm::Memory::currentTag();
+    ibpm::Memory::recordAlloc( tag, bytes );
+    return tag;
+}
+
+void accountFree( int tag, size_t bytes ) {
+    ibpm::Memory::recordFree( tag, bytes );
+}
+
+// Backing hooks, also called from the allocation layer.  backingAlign
+// raises the requested alignment to the huge-page size when the owner
+// tag in effect asks for huge pages and the allocation is big enough
+// to benefit; backingAdvise then applies the huge-page advice and the
+// residency lock to the fresh allocation, before its pages are first
+// touched (transparent huge pages are assembled at fault time, so the
+// advice must precede population)
+size_t backingAlign( size_t bytes, size_t align ) {
+    using namespace ibpm::Memory;
+    int tag = currentTag();
+    if ( _hugePages[tag] && bytes >= _hugePageSize
+         && align < _hugePageSize ) {
+        return _hugePageSize;
+    }
+    return align;
+}
+
+void backingAdvise( void* p, size_t bytes ) {
+    using namespace ibpm::Memory;
+    int tag = currentTag();
+    if ( bytes < _hugePageSize ) return;
+#if defined( MADV_HUGEPAGE )
+    if ( _hugePages[tag] ) {
+        madvise( p, bytes, MADV_HUGEPAGE );
+    }
+#endif
+#ifndef _WIN32
+    if ( _pinned[tag] ) {
+        if ( mlock( p, bytes ) != 0 && ! _mlockWarned ) {
+            _mlockWarned = true;
+            std::cerr << "Warning: mlock failed (memlock limit?); "
+                "allocations will not be pinned" << std::endl;
+        }
+    }
+#endif
+}
+
+} // namespace Array
@@ -0,0 +1,108 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <iostream>
+#include <string>
+
+/*!
+    \file Memory.h
+
+    \brief Accounting of the large allocations, tagged by owner.
+
+    Large runs (fine grids with several nested levels, plus a Cholesky
+    factor per substep) can approach the memory limit of a node, and an
+    overcommitted job is discovered only when the scheduler kills it.
+    This module keeps a running total of the bytes held by each class of
+    owner -- field data, boundary vectors, Cholesky factors, FFT work
+    buffers -- along with the high-water mark, so a report at
+    initialization or exit shows where the memory went.
+
+    Allocations made through the Array classes are charged automatically
+    (see the accounting hooks in Array.h) to the owner tag currently in
+    effect, set with a ScopedMemoryTag at the owning allocation site;
+    untagged allocations are charged to OTHER.  Buffers drawn from the
+    field pool are charged when first allocated and stay charged while
+    pooled, matching their resident footprint.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+namespace ibpm {
+
+namespace Memory {
+
+/// Owners of the large allocations
+enum Tag {
+    SCALAR,     // Scalar field data, via the field buffer pool
+    FLUX,       // Flux field data, via the field buffer pool
+    BOUNDARY,   // BoundaryVector data and BC edge buffers
+    STATE,      // combined State arenas (q, omega, and f together)
+    CHOLESKY,   // packed Cholesky factors
+    FFT,        // FFT work buffers and eigenvalue tables
+    OTHER,      // everything else allocated through the Array classes
+    NUM_TAGS
+};
+
+/// \brief Charge an allocation of the given number of bytes to a tag
+void recordAlloc( int tag, size_t bytes );
+
+/// \brief Record that bytes charged to a tag have been freed
+void recordFree( int tag, size_t bytes );
+
+/// \brief Return the owner tag currently in effect for this thread
+int currentTag();
+
+/// \brief Set the owner tag for this thread, returning the previous
+/// one; normally called only by ScopedMemoryTag
+int setTag( int tag );
+
+/// \brief Return the bytes currently charged, over all tags
+size_t currentBytes();
+
+/// \brief Return the high-water mark of currentBytes()
+size_t peakBytes();
+
+/// \brief Back allocations charged to the given tag with 2MB
+/// transparent huge pages, cutting TLB pressure in the strided
+/// multi-level sweeps.  Applies to allocations of at least one huge
+/// page made after the call; needs Linux transparent-huge-page
+/// support, and is silently a no-op without it
+void setHugePages( int tag, bool flag );
+
+/// \brief Keep allocations charged to the given tag resident (mlock),
+/// the backing a registered-transfer path (GPU or asynchronous I/O)
+/// expects of its staging buffers.  Applies to allocations of at
+/// least one huge page made after the call; warns once if the
+/// memlock limit refuses a request
+void setPinned( int tag, bool flag );
+
+/// \brief Apply huge-page (pinned = false) or pinned (pinned = true)
+/// backing to the owners in a comma-separated list of names:
+/// "fields" (Scalar and Flux together), "state", "boundary",
+/// "cholesky", "fft", "other", or "all".  Returns false on an
+/// unrecognized name
+bool setBackingByName( const std::string& list, bool pinned );
+
+/// \brief Print a table of current and peak usage per owner tag,
+/// marking pools configured for huge-page or pinned backing
+void printReport( std::ostream& out, const std::string& label );
+
+} // namespace Memory
+
+/// \brief Charge allocations made during this object's lifetime to the
+/// given owner tag
+class ScopedMemoryTag {
+public:
+    explicit ScopedMemoryTag( int tag ) : _previous( Memory::setTag( tag ) ) {}
+    ~ScopedMemoryTag() { Memory::setTag( _previous ); }
+private:
+    int _previous;
+};
+
+} // namespace ibpm
+
+#endif /* _MEMORY_H_ */
@@ -58,7 +58,8 @@ namespace ibpm {
                    double period
                    ) :
         _filename(filename),
-        _period(period) {
+        _period(period),
+        _lastIndex(0) {
             ifstream in( filename.c_str() );
             int n;
             double t,x,y,theta,dx,dy,dtheta;
@@ -83,51 +84,75 @@ namespace ibpm {
         /// Adds an element of TTSE2 to the vector
         void addTTSE2(double t, double x, double y, double theta, double dx, double dy, double dtheta) {
             TTSE2 p(t,x,y,theta,dx,dy,dtheta);
-            // Add the element to the motion file data list
+            // Add the element to the motion file data list, and precompute
+            // the slopes of the interval it completes
             _data.push_back(p);
+            if( _data.size() > 1 ) addSegment( _data.size()-2 );
         }
-        
+
         /// Returns transformation for the piecewise linear data in _filename:
         inline TangentSE2 getTransformation(double time) const {
-            int index = -1;
             time = fmod(time,_period);
-            // find correct index corresponding to current time
-            int n=_data.size();
-            for(int i=0; i<n-1; i++) {
-                if( (time>=_data[i].t) && (time<_data[i+1].t) ) index = i;
-            }
-            double xo = 0.;
-            double yo = 0.;
-            double thetao = 0.;
-            double dxo = 0.;
-            double dyo = 0.;
-            double dthetao = 0.;
-            double alpha=0.;
-            double tdiff=0.;
-            if( index != -1 ) {
-                tdiff = _data[index+1].t-_data[index].t;
-                alpha = (time-_data[index].t)/tdiff;
-                xo = alpha*_data[index+1].x+(1-alpha)*_data[index].x;
-                yo = alpha*_data[index+1].y+(1-alpha)*_data[index].y;
-                thetao = alpha*_data[index+1].theta+(1-alpha)*_data[index].theta;
-                dxo = alpha*_data[index+1].dx+(1-alpha)*_data[index].dx;
-                dyo = alpha*_data[index+1].dy+(1-alpha)*_data[index].dy;
-                dthetao = alpha*_data[index+1].dtheta+(1-alpha)*_data[index].dtheta;
-            }
-            return TangentSE2( xo, yo, thetao, dxo, dyo, dthetao );
+            int index = findIndex(time);
+            if( index == -1 ) return TangentSE2( 0., 0., 0., 0., 0., 0. );
+            // evaluate the precomputed piecewise linear coefficients
+            const TTSE2& p = _data[index];
+            const Segment& s = _segments[index];
+            double dt = time - p.t;
+            return TangentSE2( p.x + dt*s.sx, p.y + dt*s.sy,
+                               p.theta + dt*s.stheta,
+                               p.dx + dt*s.sdx, p.dy + dt*s.sdy,
+                               p.dtheta + dt*s.sdtheta );
         }
-        
+
         inline Motion* clone() const {
             return new MotionFilePeriodic(
                                   _filename,
                                   _period
                                   );
         };
-        
+
     private:
+        // Slopes of the piecewise linear data on one interval, computed
+        // once at load so that evaluation needs no division or search
+        struct Segment {
+            double sx, sy, stheta, sdx, sdy, sdtheta;
+        };
+
+        // Precompute the slope coefficients of interval i
+        void addSegment(int i) {
+            double invdt = 1. / (_data[i+1].t - _data[i].t);
+            Segment s;
+            s.sx = (_data[i+1].x - _data[i].x) * invdt;
+            s.sy = (_data[i+1].y - _data[i].y) * invdt;
+            s.stheta = (_data[i+1].theta - _data[i].theta) * invdt;
+            s.sdx = (_data[i+1].dx - _data[i].dx) * invdt;
+            s.sdy = (_data[i+1].dy - _data[i].dy) * invdt;
+            s.sdtheta = (_data[i+1].dtheta - _data[i].dtheta) * invdt;
+            _segments.push_back(s);
+        }
+
+        // Find the interval with t[i] <= time < t[i+1], or -1 if time is
+        // outside the table.  The search starts from the interval found
+        // by the previous query: within a period time advances
+        // monotonically, so the per-step cost is O(1) instead of a scan
+        // of the whole table.
+        inline int findIndex(double time) const {
+            int n = _data.size();
+            if( n < 2 || time < _data[0].t || time >= _data[n-1].t ) return -1;
+            int i = _lastIndex;
+            if( i < 0 || i > n-2 ) i = 0;
+            while( i > 0 && time < _data[i].t ) --i;
+            while( i < n-2 && time >= _data[i+1].t ) ++i;
+            _lastIndex = i;
+            return i;
+        }
+
         string _filename;
         double _period;
         vector<TTSE2> _data;
+        vector<Segment> _segments;
+        mutable int _lastIndex; // interval found by the previous query
     };
 } // namespace ibpm
 
@@ -0,0 +1,293 @@
+// MultigridSolver2d.cc
+//
+// Description:
+// Implementation of the Multigrid2d class and the multigrid-backed
+// Poisson and Helmholtz solvers
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Sep 2008
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "MultigridSolver2d.h"
+#include <math.h>
+
+namespace ibpm {
+
+namespace {
+    // Tolerance and cycle limit applied to subsequently created solvers.
+    // The default tolerance is tight enough that swapping backends does
+    // not perturb the time-marching results noticeably; users trading
+    // accuracy for speed loosen it explicitly
+    double _defaultTolerance = 1.e-9;
+    int _defaultMaxCycles = 100;
+
+    // Number of Gauss-Seidel sweeps before and after each coarse-grid
+    // correction, and on the coarsest level (where the grid is small
+    // enough that smoothing converges outright)
+    const int PRE_SMOOTH_SWEEPS = 2;
+    const int POST_SMOOTH_SWEEPS = 2;
+    const int COARSEST_SWEEPS = 30;
+
+    // Value of a coarse-grid array at (i,j), zero outside the interior
+    // (homogeneous Dirichlet conditions on every level)
+    inline double coarseValue( const Array::Array2<double>& u,
+                               int nx, int ny, int i, int j ) {
+        if ( i < 1 || i > nx-1 || j < 1 || j > ny-1 ) return 0.;
+        return u(i,j);
+    }
+}
+
+void Multigrid2d::setDefaultTolerance( double tol ) {
+    _defaultTolerance = tol;
+}
+
+void Multigrid2d::setDefaultMaxCycles( int maxCycles ) {
+    _defaultMaxCycles = maxCycles;
+}
+
+Multigrid2d::MGLevel::MGLevel( int nx_, int ny_, double c1_ ) :
+    nx( nx_ ),
+    ny( ny_ ),
+    c1( c1_ ),
+    u( nx_-1, ny_-1, 1, 1 ),
+    f( nx_-1, ny_-1, 1, 1 ),
+    r( nx_-1, ny_-1, 1, 1 ) {
+    u = 0.;
+    f = 0.;
+    r = 0.;
+}
+
+Multigrid2d::Multigrid2d( int nx, int ny, double c0, double c1 ) :
+    _c0( c0 ),
+    _tolerance( _defaultTolerance ),
+    _maxCycles( _defaultMaxCycles ),
+    _previousSolution( nx-1, ny-1, 1, 1 ) {
+    // Build the hierarchy by halving both dimensions while possible;
+    // each coarser level sees the physical operator with c1 reduced by 4
+    _levels.push_back( new MGLevel( nx, ny, c1 ) );
+    while ( nx % 2 == 0 && ny % 2 == 0 && nx / 2 >= 2 && ny / 2 >= 2 ) {
+        nx /= 2;
+        ny /= 2;
+        c1 /= 4.;
+        _levels.push_back( new MGLevel( nx, ny, c1 ) );
+    }
+    _previousSolution = 0.;
+}
+
+Multigrid2d::~Multigrid2d() {
+    for (unsigned int l=0; l<_levels.size(); ++l) {
+        delete _levels[l];
+    }
+}
+
+void Multigrid2d::setTolerance( double tol ) {
+    _tolerance = tol;
+}
+
+void Multigrid2d::setMaxCycles( int maxCycles ) {
+    _maxCycles = maxCycles;
+}
+
+// Gauss-Seidel sweeps for (c0 + c1 L) u = f with zero boundary values.
+// The unit-spacing Laplacian is L u = (sum of neighbors) - 4 u, so the
+// diagonal of the operator is c0 - 4 c1
+void Multigrid2d::smooth( MGLevel& lev, int sweeps ) const {
+    const double c1 = lev.c1;
+    const double byDiag = 1. / ( _c0 - 4. * c1 );
+    const int nx = lev.nx;
+    const int ny = lev.ny;
+    for (int sweep=0; sweep<sweeps; ++sweep) {
+        for (int i=1; i<nx; ++i) {
+            for (int j=1; j<ny; ++j) {
+                double nbr = 0.;
+                if ( i > 1 )    nbr += lev.u(i-1,j);
+                if ( i < nx-1 ) nbr += lev.u(i+1,j);
+                if ( j > 1 )    nbr += lev.u(i,j-1);
+                if ( j < ny-1 ) nbr += lev.u(i,j+1);
+                lev.u(i,j) = ( lev.f(i,j) - c1 * nbr ) * byDiag;
+            }
+        }
+    }
+}
+
+// r = f - (c0 + c1 L) u
+void Multigrid2d::computeResidual( MGLevel& lev ) const {
+    const double c1 = lev.c1;
+    const double diag = _c0 - 4. * c1;
+    const int nx = lev.nx;
+    const int ny = lev.ny;
+    for (int i=1; i<nx; ++i) {
+        for (int j=1; j<ny; ++j) {
+            double nbr = 0.;
+            if ( i > 1 )    nbr += lev.u(i-1,j);
+            if ( i < nx-1 ) nbr += lev.u(i+1,j);
+            if ( j > 1 )    nbr += lev.u(i,j-1);
+            if ( j < ny-1 ) nbr += lev.u(i,j+1);
+            lev.r(i,j) = lev.f(i,j) - diag * lev.u(i,j) - c1 * nbr;
+        }
+    }
+}
+
+// Full-weighting restriction of the fine residual onto the coarse
+// right-hand side.  Coarse point (i,j) sits at fine point (2i,2j), so
+// all nine fine stencil points are interior
+void Multigrid2d::restrictResidual( const MGLevel& fine,
+                                    MGLevel& coarse ) const {
+    for (int i=1; i<coarse.nx; ++i) {
+        for (int j=1; j<coarse.ny; ++j) {
+            int fi = 2*i;
+            int fj = 2*j;
+            coarse.f(i,j) = ( 4. * fine.r(fi,fj)
+                + 2. * ( fine.r(fi-1,fj) + fine.r(fi+1,fj)
+                       + fine.r(fi,fj-1) + fine.r(fi,fj+1) )
+                + fine.r(fi-1,fj-1) + fine.r(fi+1,fj-1)
+                + fine.r(fi-1,fj+1) + fine.r(fi+1,fj+1) ) / 16.;
+        }
+    }
+}
+
+// Bilinear prolongation of the coarse correction, added to the fine
+// solution.  Coarse values outside the interior are zero (homogeneous
+// Dirichlet conditions on the correction)
+void Multigrid2d::prolongAndCorrect( const MGLevel& coarse,
+                                     MGLevel& fine ) const {
+    const int cnx = coarse.nx;
+    const int cny = coarse.ny;
+    for (int i=1; i<fine.nx; ++i) {
+        for (int j=1; j<fine.ny; ++j) {
+            double val;
+            if ( i % 2 == 0 && j % 2 == 0 ) {
+                val = coarseValue( coarse.u, cnx, cny, i/2, j/2 );
+            }
+            else if ( i % 2 == 0 ) {
+                val = 0.5 * ( coarseValue( coarse.u, cnx, cny, i/2, (j-1)/2 )
+                            + coarseValue( coarse.u, cnx, cny, i/2, (j+1)/2 ) );
+            }
+            else if ( j % 2 == 0 ) {
+                val = 0.5 * ( coarseValue( coarse.u, cnx, cny, (i-1)/2, j/2 )
+                            + coarseValue( coarse.u, cnx, cny, (i+1)/2, j/2 ) );
+            }
+            else {
+                val = 0.25 * ( coarseValue( coarse.u, cnx, cny, (i-1)/2, (j-1)/2 )
+                             + coarseValue( coarse.u, cnx, cny, (i+1)/2, (j-1)/2 )
+                             + coarseValue( coarse.u, cnx, cny, (i-1)/2, (j+1)/2 )
+                             + coarseValue( coarse.u, cnx, cny, (i+1)/2, (j+1)/2 ) );
+            }
+            fine.u(i,j) += val;
+        }
+    }
+}
+
+// One V-cycle starting at level l
+void Multigrid2d::vcycle( unsigned int l ) const {
+    MGLevel& lev = *_levels[l];
+    if ( l == _levels.size() - 1 ) {
+        smooth( lev, COARSEST_SWEEPS );
+        return;
+    }
+    MGLevel& coarse = *_levels[l+1];
+    smooth( lev, PRE_SMOOTH_SWEEPS );
+    computeResidual( lev );
+    restrictResidual( lev, coarse );
+    coarse.u = 0.;
+    vcycle( l+1 );
+    prolongAndCorrect( coarse, lev );
+    smooth( lev, POST_SMOOTH_SWEEPS );
+}
+
+void Multigrid2d::solve( const Array2d& f, Array2d& u ) {
+    MGLevel& fine = *_levels[0];
+    assert( f.Size() == fine.f.Size() );
+    assert( u.Size() == fine.u.Size() );
+
+    // Copy the right-hand side first: u may alias f (as it does when
+    // called through the boundary-condition form of solve)
+    double fnorm = 0.;
+    for (int i=1; i<fine.nx; ++i) {
+        for (int j=1; j<fine.ny; ++j) {
+            fine.f(i,j) = f(i,j);
+            double mag = fabs( f(i,j) );
+            if ( mag > fnorm ) fnorm = mag;
+        }
+    }
+
+    // Warm start from the previous solution; for time-marching, where
+    // the right-hand side changes little between substeps, this is what
+    // makes the iterative solve cheap
+    for (int i=1; i<fine.nx; ++i) {
+        for (int j=1; j<fine.ny; ++j) {
+            fine.u(i,j) = _previousSolution(i,j);
+        }
+    }
+
+    if ( fnorm > 0. ) {
+        for (int cycle=0; cycle<_maxCycles; ++cycle) {
+            vcycle( 0 );
+            computeResidual( fine );
+            double rnorm = 0.;
+            for (int i=1; i<fine.nx; ++i) {
+                for (int j=1; j<fine.ny; ++j) {
+                    double mag = fabs( fine.r(i,j) );
+                    if ( mag > rnorm ) rnorm = mag;
+                }
+            }
+            if ( rnorm <= _tolerance * fnorm ) break;
+        }
+    }
+    else {
+        // Zero right-hand side: the solution is zero, exactly
+        fine.u = 0.;
+    }
+
+    for (int i=1; i<fine.nx; ++i) {
+        for (int j=1; j<fine.ny; ++j) {
+            u(i,j) = fine.u(i,j);
+            _previousSolution(i,j) = fine.u(i,j);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Multigrid-backed Poisson solver
+//------------------------------------------------------------------------------
+
+MultigridPoissonSolver2d::MultigridPoissonSolver2d( int nx, int ny, double dx ) :
+    PoissonSolver2d( nx, ny, dx ) {
+    // The base class has set _c0 and _c1 for the operator at unit grid
+    // spacing; the hierarchy works in the same coefficient convention
+    _multigrid = new Multigrid2d( nx, ny, _c0, _c1 );
+}
+
+MultigridPoissonSolver2d::~MultigridPoissonSolver2d() {
+    delete _multigrid;
+}
+
+void MultigridPoissonSolver2d::solve( const Array2d& f, Array2d& u ) const {
+    _multigrid->solve( f, u );
+}
+
+//------------------------------------------------------------------------------
+// Multigrid-backed Helmholtz solver
+//------------------------------------------------------------------------------
+
+MultigridHelmholtzSolver2d::MultigridHelmholtzSolver2d( int nx, int ny,
+    double dx, double alpha ) :
+    HelmholtzSolver2d( nx, ny, dx, alpha ) {
+    _multigrid = new Multigrid2d( nx, ny, _c0, _c1 );
+}
+
+MultigridHelmholtzSolver2d::~MultigridHelmholtzSolver2d() {
+    delete _multigrid;
+}
+
+void MultigridHelmholtzSolver2d::solve( const Array2d& f, Array2d& u ) const {
+    _multigrid->solve( f, u );
+}
+
+} // namespace ibpm
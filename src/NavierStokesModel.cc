@@ -13,6 +13,10 @@
 // $HeadURL$
 
 #include "NavierStokesModel.h"
+#include "FlowMonitor.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace ibpm {
 	
@@ -28,6 +32,8 @@ namespace ibpm {
     _baseFlow( q_potential ),
     _ReynoldsNumber( Reynolds ),
     _poisson( grid ),
+    _scratch0( grid ),
+    _constraintsCurrent( false ),
     _hasBeenInitialized( false )
 	{}
 	
@@ -42,12 +48,45 @@ namespace ibpm {
     _baseFlow( grid ),
     _ReynoldsNumber( Reynolds ),
     _poisson( grid ),
+    _scratch0( grid ),
+    _constraintsCurrent( false ),
     _hasBeenInitialized( false )
     {
         _baseFlow.setFlux(0.);
     }
 	
-    NavierStokesModel::~NavierStokesModel() {}
+    NavierStokesModel::~NavierStokesModel() {
+        for ( size_t t=0; t<_threadScratch.size(); ++t ) {
+            delete _threadScratch[t];
+        }
+    }
+
+    // Return the calling thread's scratch fields.  The serial path (all
+    // of the timestepping) takes the early return and never touches the
+    // lock; OpenMP workers inside the Cholesky column assembly get their
+    // own lazily-created slot.  The lookup is guarded because the vector
+    // may be growing, but each M application does a full Helmholtz
+    // solve, so the critical section is negligible next to the work
+    NavierStokesModel::Scratch& NavierStokesModel::getScratch() const {
+#ifdef _OPENMP
+        int t = omp_get_thread_num();
+        if ( t > 0 ) {
+            Scratch* s;
+#pragma omp critical(ibpm_nsmodel_scratch)
+            {
+                if ( t >= (int) _threadScratch.size() ) {
+                    _threadScratch.resize( t + 1, (Scratch*) NULL );
+                }
+                if ( _threadScratch[t] == NULL ) {
+                    _threadScratch[t] = new Scratch( _grid );
+                }
+                s = _threadScratch[t];
+            }
+            return *s;
+        }
+#endif
+        return _scratch0;
+    }
     
     void NavierStokesModel::init() {
         if ( _hasBeenInitialized ) return;  // do only once
@@ -81,47 +120,88 @@ namespace ibpm {
     double NavierStokesModel::getAlpha() const {
         return 1. / _ReynoldsNumber;
     }
-	
+
+    void NavierStokesModel::setReynolds( double Reynolds ) {
+        _ReynoldsNumber = Reynolds;
+    }
+
     // Return the boundary velocities minus the base flow velocity at the boundary
-    BoundaryVector NavierStokesModel::getConstraints() const {
-        BoundaryVector b = _geometry.getVelocities();
-        BoundaryVector b0 = getBaseFlowBoundaryVelocities();
-        b -= b0;
-        return b;
+    const BoundaryVector& NavierStokesModel::getConstraints() const {
+        // For a static case the right-hand side never changes: assemble
+        // it once and reuse the cached vector until updateOperators
+        // moves the geometry or the base flow
+        if ( ! _constraintsCurrent ) {
+            if ( _constraints.getNumPoints() != _geometry.getNumPoints() ) {
+                _constraints.resize( _geometry.getNumPoints() );
+            }
+            _constraints = _geometry.getVelocities();
+            _constraints -= getBaseFlowBoundaryVelocities();
+            _constraintsCurrent = ! isTimeDependent();
+        }
+        return _constraints;
     }
-    
+
     void NavierStokesModel::updateOperators( double time ) {
         if( bfTimeDependent() ) _baseFlow.moveFlow(time);
         if( geTimeDependent() ) {
             _geometry.moveBodies(time);
             _regularizer.update();
         }
+        if( isTimeDependent() ) _constraintsCurrent = false;
     }
     
     void NavierStokesModel::B(const BoundaryVector& f, Scalar& omega ) const {
         assert( _hasBeenInitialized );
-        Flux q = _regularizer.toFlux( f );
-        Curl( q, omega );
+        Flux& flux = getScratch().flux;
+        _regularizer.toFlux( f, flux );
+        Curl( flux, omega );
     }
 	
     void NavierStokesModel::C(const Scalar& omega, BoundaryVector& f) const {
         assert( _hasBeenInitialized );
-		Flux q(_grid);
-		computeFluxWithoutBaseFlow( omega, q );
-		f = _regularizer.toBoundary( q );
+        Flux& flux = getScratch().flux;
+		computeFluxWithoutBaseFlow( omega, flux );
+		_regularizer.toBoundary( flux, f );
 	}
 	
 	void NavierStokesModel::computeFluxWithoutBaseFlow(const Scalar& omega,
 													   Flux& q ) const {
 		assert( _hasBeenInitialized );
-		Scalar streamfunction = vorticityToStreamfunction( omega );
-		Curl( streamfunction, q );
+		// Solve L psi = -omega in the preallocated scratch field, in
+		// place; the solver restricts its right-hand side to the
+		// coarse levels itself, so no coarsify is needed here
+		Scalar& psi = getScratch().psi;
+		psi = -1. * omega;
+		_poisson.solve( psi, psi );
+		Curl( psi, q );
 	}
 	
 	void NavierStokesModel::computeFlux(const Scalar& omega, Flux& q ) const {
 		assert( _hasBeenInitialized );
-		computeFluxWithoutBaseFlow( omega, q );
-		q += _baseFlow.getFlux();
+		// Same as computeFluxWithoutBaseFlow, but with the base-flow
+		// addition folded into the curl output pass: one traversal of
+		// q instead of curl-then-add
+		Scalar& psiScratch = getScratch().psi;
+		if ( FlowMonitorEnabled() ) {
+			// Fuse the peak-vorticity reduction into the negation
+			// pass (see FlowMonitor.h).  The inverted comparison
+			// propagates NaN into the running maximum
+			int n = omega.getSize();
+			const double* om = omega.flatten(0);
+			double* psi = psiScratch.flatten(0);
+			double m = 0.;
+			for (int k=0; k<n; ++k) {
+				double a = fabs( om[k] );
+				psi[k] = -om[k];
+				if ( ! ( a <= m ) ) m = a;
+			}
+			FlowMonitorVorticity( m );
+		}
+		else {
+			psiScratch = -1. * omega;
+		}
+		_poisson.solve( psiScratch, psiScratch );
+		Curl( psiScratch, _baseFlow.getFlux(), q );
 	}
 	
 	void NavierStokesModel::refreshState( State& x ) const {
@@ -132,9 +212,9 @@ namespace ibpm {
 	//    Laplacian psi = - omega
 	Scalar NavierStokesModel::vorticityToStreamfunction( const Scalar& omega ) const {
 		assert( _hasBeenInitialized );
-		// Solve L psi = omega, with zero Dirichlet bc's
+		// Solve L psi = omega, with zero Dirichlet bc's; the solver
+		// restricts the right-hand side to the coarse levels itself
 		Scalar psi = -1. * omega;
-		psi.coarsify();
 		_poisson.solve( psi, psi );
 		return psi;
 	}
@@ -12,6 +12,7 @@
 #include "Regularizer.h"
 #include "EllipticSolver.h"
 #include <math.h>
+#include <vector>
 
 namespace ibpm {
 
@@ -66,8 +67,10 @@ public:
     int getNumPoints() const;
 
     /// \brief Return the right-hand side b of the constraint equations.
-    /// Here, this is the velocity of the bodies minus the base flow velocity
-    BoundaryVector getConstraints() const;
+    /// Here, this is the velocity of the bodies minus the base flow velocity.
+    /// For stationary geometry and steady base flow the vector is assembled
+    /// once and the cached copy returned on later calls.
+    const BoundaryVector& getConstraints() const;
     
     /// \brief Update operators, for time-dependent models
     void updateOperators( double time );
@@ -75,6 +78,18 @@ public:
 //    /// Return a pointer to the associated Geometry
 //    inline const Geometry& getGeometry() const { return _geometry; }
 //
+    /// \brief Return the coordinates of the boundary points (a
+    /// reference to the geometry's cached assembled vector)
+    inline const BoundaryVector& getPoints() const {
+        return _geometry.getPoints();
+    }
+
+    /// \brief Return true if every body declares mirror symmetry about
+    /// the x-axis (see RigidBody::setMirrorSymmetric)
+    inline bool isMirrorSymmetric() const {
+        return _geometry.isMirrorSymmetric();
+    }
+
     /// Return a pointer to the associated Grid
     inline const Grid& getGrid() const { return _grid; }
 
@@ -87,6 +102,12 @@ public:
 	/// \brief Return the constant alpha = 1/ReynoldsNumber
     double getAlpha() const;
 
+    /// \brief Change the Reynolds number, for in-process parameter
+    /// continuation.  Only the viscous coefficient changes: the
+    /// regularizer, Poisson solver, and constraint cache are untouched,
+    /// but any IBSolver built from this model must be rebuilt
+    void setReynolds( double Reynolds );
+
     /// Return the angle of attack of the baseflow
     inline double getAlphaBF() const { return _baseFlow.getAlpha(); }
 	
@@ -118,6 +139,26 @@ private:
     BaseFlow _baseFlow;
 	double _ReynoldsNumber;
     PoissonSolver _poisson;
+    // Scratch fields for B, C, and the streamfunction solve, preallocated
+    // so that applying the operators (many times per timestep, for the
+    // iterative solvers) allocates no grid-sized data.  Slot 0 is created
+    // with the model and serves all serial calls; further slots are
+    // created on first use by the corresponding OpenMP worker (the
+    // parallel column assembly in CholeskySolver applies B and C
+    // concurrently), so the operators stay allocation-free in steady
+    // state and safe to call from several threads
+    struct Scratch {
+        Flux flux;
+        Scalar psi;
+        Scratch( const Grid& grid ) : flux( grid ), psi( grid ) {}
+    };
+    Scratch& getScratch() const;
+    mutable Scratch _scratch0;
+    mutable std::vector<Scratch*> _threadScratch;
+    // Cached constraint right-hand side, reused while geometry and base
+    // flow are unchanged
+    mutable BoundaryVector _constraints;
+    mutable bool _constraintsCurrent;
     bool _hasBeenInitialized;
 };
 
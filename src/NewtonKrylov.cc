@@ -0,0 +1,196 @@
+// NewtonKrylov.cc
+//
+// Description:
+// Implementation of the NewtonKrylovSolver class
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "NewtonKrylov.h"
+#include "Grid.h"
+#include "NavierStokesModel.h"
+#include "IBSolver.h"
+#include "VectorOperations.h"
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+namespace ibpm {
+
+NewtonKrylovSolver::NewtonKrylovSolver(
+    Grid& grid,
+    NavierStokesModel& model,
+    NavierStokesModel& perturbModel,
+    IBSolver& solver,
+    double dt,
+    Scheme::SchemeType scheme,
+    const string& solverBasename
+    ) :
+    _grid( grid ),
+    _model( model ),
+    _perturbModel( perturbModel ),
+    _solver( solver ),
+    _dt( dt ),
+    _scheme( scheme ),
+    _solverBasename( solverBasename ) {
+}
+
+double NewtonKrylovSolver::residual( const State& x, Scalar& r ) {
+    State s = x;
+    // Clear any multistep history: each residual evaluation is a
+    // single step from an arbitrary state, not part of a trajectory
+    _solver.reset();
+    _solver.advance( s );
+    r = s.omega;
+    r -= x.omega;
+    return sqrt( InnerProduct( r, r ) );
+}
+
+void NewtonKrylovSolver::applyJacobian(
+    IBSolver& linearized,
+    const Scalar& v,
+    Scalar& Jv
+    ) {
+    State p( _grid, _model.getNumPoints() );
+    p.omega = v;
+    _perturbModel.refreshState( p );
+    linearized.reset();
+    linearized.advance( p );
+    Jv = p.omega;
+    Jv -= v;
+}
+
+// Standard GMRES with modified Gram-Schmidt and Givens rotations.
+// The iteration count stays in the tens, so no restarting
+void NewtonKrylovSolver::gmres(
+    IBSolver& linearized,
+    const Scalar& rhs,
+    Scalar& d,
+    double tol,
+    int maxKrylov
+    ) {
+    d = 0.;
+    double beta = sqrt( InnerProduct( rhs, rhs ) );
+    if ( beta == 0. ) return;
+
+    vector<Scalar> V;
+    V.push_back( rhs );
+    V[0] *= 1. / beta;
+    vector< vector<double> > H( maxKrylov+1, vector<double>( maxKrylov, 0. ) );
+    vector<double> cs( maxKrylov, 0. );
+    vector<double> sn( maxKrylov, 0. );
+    vector<double> g( maxKrylov+1, 0. );
+    g[0] = beta;
+
+    Scalar w( _grid );
+    int k = 0;
+    while ( k < maxKrylov ) {
+        applyJacobian( linearized, V[k], w );
+        for (int i = 0; i <= k; ++i) {
+            H[i][k] = InnerProduct( w, V[i] );
+            w -= H[i][k] * V[i];
+        }
+        H[k+1][k] = sqrt( InnerProduct( w, w ) );
+
+        // Rotate the new column into upper triangular form
+        for (int i = 0; i < k; ++i) {
+            double h = cs[i] * H[i][k] + sn[i] * H[i+1][k];
+            H[i+1][k] = -sn[i] * H[i][k] + cs[i] * H[i+1][k];
+            H[i][k] = h;
+        }
+        double denom = sqrt( H[k][k] * H[k][k] + H[k+1][k] * H[k+1][k] );
+        cs[k] = H[k][k] / denom;
+        sn[k] = H[k+1][k] / denom;
+        H[k][k] = denom;
+        g[k+1] = -sn[k] * g[k];
+        g[k] = cs[k] * g[k];
+
+        bool breakdown = ( H[k+1][k] == 0. );
+        if ( ! breakdown && k+1 < maxKrylov ) {
+            w *= 1. / H[k+1][k];
+            V.push_back( w );
+        }
+        ++k;
+        if ( breakdown || fabs( g[k] ) < tol * beta ) break;
+    }
+
+    // Back substitution and assembly of the correction
+    vector<double> y( k, 0. );
+    for (int i = k-1; i >= 0; --i) {
+        double sum = g[i];
+        for (int j = i+1; j < k; ++j) {
+            sum -= H[i][j] * y[j];
+        }
+        y[i] = sum / H[i][i];
+    }
+    for (int j = 0; j < k; ++j) {
+        d += y[j] * V[j];
+    }
+}
+
+bool NewtonKrylovSolver::solve( State& x, int maxIterations, double tol ) {
+    Scalar F( _grid );
+    Scalar Fnew( _grid );
+    Scalar d( _grid );
+    double rnorm = residual( x, F );
+    cout << "Newton iteration 0: residual " << rnorm << endl;
+
+    for (int iter = 1; iter <= maxIterations && rnorm >= tol; ++iter) {
+        // Linearize about the current iterate.  The projection-step
+        // operators depend only on the geometry and dt, so the factors
+        // saved by the nonlinear solver are reloaded here
+        LinearizedIBSolver linearized(
+            _grid, _perturbModel, _dt, _scheme, x );
+        if ( ! linearized.load( _solverBasename ) ) {
+            linearized.init();
+        }
+
+        Scalar rhs = F;
+        rhs *= -1.;
+        gmres( linearized, rhs, d, 1.e-3, 50 );
+
+        // Backtracking: halve the step while it fails to reduce the
+        // residual, accepting the last attempt if none does
+        State xNew = x;
+        double rnormNew = rnorm;
+        double step = 1.;
+        for (int attempt = 0; attempt < 5; ++attempt) {
+            xNew.omega = x.omega;
+            xNew.omega += step * d;
+            _model.refreshState( xNew );
+            rnormNew = residual( xNew, Fnew );
+            if ( rnormNew < rnorm ) break;
+            step *= 0.5;
+        }
+        if ( rnormNew >= rnorm ) {
+            cout << "WARNING: Newton step did not reduce the residual"
+                << endl;
+        }
+        x = xNew;
+        F.swap( Fnew );
+        rnorm = rnormNew;
+        cout << "Newton iteration " << iter << ": residual " << rnorm
+            << "  (step " << step << ")" << endl;
+    }
+
+    _model.refreshState( x );
+    // The residual evaluations advance copies, so x.f was never
+    // filled in; one more step from the converged state supplies the
+    // boundary forces
+    State s = x;
+    _solver.reset();
+    _solver.advance( s );
+    x.f = s.f;
+    return rnorm < tol;
+}
+
+} // namespace ibpm
@@ -0,0 +1,80 @@
+#ifndef _NEWTONKRYLOV_H_
+#define _NEWTONKRYLOV_H_
+
+#include <string>
+// for Scheme::SchemeType; Scheme.h itself has no include guard
+#include "IBSolver.h"
+#include "Scalar.h"
+#include "State.h"
+
+namespace ibpm {
+
+/*!
+    \file NewtonKrylov.h
+    \class NewtonKrylovSolver
+
+    \brief Jacobian-free Newton-Krylov solver for steady states
+
+    Finds an equilibrium of the nonlinear equations directly, rather
+    than time-marching until transients decay.  The nonlinear residual
+    is one step of the existing timestepper, F(omega) = G(omega) - omega,
+    whose roots are exactly the steady states.  The Jacobian-vector
+    product for the inner GMRES iteration is one step of the
+    LinearizedIBSolver about the current iterate, so no Jacobian matrix
+    is ever formed, and the projection-step operators (and Cholesky
+    factors) are shared with ordinary time-marching runs.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+class NewtonKrylovSolver {
+public:
+    /// \brief Constructor.
+    /// \param[in] model          nonlinear model, including the base flow
+    /// \param[in] perturbModel   model with zero base flow, used to
+    ///                           refresh perturbation states in the
+    ///                           linearized matvec
+    /// \param[in] solver         initialized nonlinear timestepper
+    /// \param[in] solverBasename basename of saved projection-solver
+    ///                           files, reused by the linearized solver
+    NewtonKrylovSolver(
+        Grid& grid,
+        NavierStokesModel& model,
+        NavierStokesModel& perturbModel,
+        IBSolver& solver,
+        double dt,
+        Scheme::SchemeType scheme,
+        const std::string& solverBasename
+    );
+
+    /// \brief Drive x to a steady state.  Returns true if the residual
+    /// norm fell below tol within maxIterations Newton steps
+    bool solve( State& x, int maxIterations, double tol );
+
+private:
+    // || G(x) - x ||, with the difference returned in r
+    double residual( const State& x, Scalar& r );
+
+    // One linearized step about the current base flow: Jv = L(v) - v
+    void applyJacobian( IBSolver& linearized, const Scalar& v, Scalar& Jv );
+
+    // Solve J d = rhs approximately by GMRES, to relative tolerance tol
+    void gmres( IBSolver& linearized, const Scalar& rhs, Scalar& d,
+        double tol, int maxKrylov );
+
+    Grid& _grid;
+    NavierStokesModel& _model;
+    NavierStokesModel& _perturbModel;
+    IBSolver& _solver;
+    double _dt;
+    Scheme::SchemeType _scheme;
+    std::string _solverBasename;
+};
+
+} // namespace ibpm
+
+#endif /* _NEWTONKRYLOV_H_ */
@@ -0,0 +1,177 @@
+// OutputDiagnostics.cc
+//
+// Description:
+// Implementation of output routine for writing fused per-step flow
+// diagnostics: energy, enstrophy, net circulation, and peak vorticity.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 22 Aug 2008
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "OutputDiagnostics.h"
+#include "State.h"
+#include "Output.h"
+#include "Scalar.h"
+#include "VectorOperations.h"
+#include "Array.h"
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+using Array::Array2;
+
+namespace ibpm {
+
+// Number of output steps batched in memory before the file is written
+// (see OutputForce.cc)
+static const int FLUSH_INTERVAL = 100;
+
+// Fold one vorticity value into the three accumulators.  The weight is
+// the quadrature weight of the point (dx^2, scaled at grid interfaces).
+static inline void accumulate( double val, double weight,
+                               double& enstrophy, double& circulation,
+                               double& peak ) {
+    enstrophy += val * val * weight;
+    circulation += val * weight;
+    if ( fabs( val ) > peak ) peak = fabs( val );
+}
+
+// Compute enstrophy (1/2 int omega^2), net circulation (int omega), and
+// peak |omega| in a single pass over the vorticity field, visiting each
+// point once with the same multi-domain quadrature weights as
+// InnerProduct( Scalar, Scalar ) in VectorOperations.cc
+static void vorticityDiagnostics( const Scalar& omega, double& enstrophy,
+                                  double& circulation, double& peak ) {
+    int nx = omega.Nx();
+    int ny = omega.Ny();
+    int nx2 = omega.NxExt();    // # coarse cells outside each fine domain
+    int ny2 = omega.NyExt();
+
+    enstrophy = 0.;
+    circulation = 0.;
+    peak = 0.;
+
+    // Finest grid interior points are one contiguous block
+    double dx2 = omega.Dx() * omega.Dx();
+    const Array2<double> wd = omega[0];
+    const double* w = &wd(0);
+    for (unsigned int k=0; k<wd.Size(); ++k) {
+        accumulate( w[k], dx2, enstrophy, circulation, peak );
+    }
+
+    // Coarser grids
+    for (int lev=1; lev < omega.Ngrid(); ++lev) {
+        dx2 = omega.Dx(lev) * omega.Dx(lev);
+        // Interface points
+        // corners
+        accumulate( omega(lev,nx2,ny2), dx2 * 15./16,
+                    enstrophy, circulation, peak );
+        accumulate( omega(lev,nx/2+nx2,ny2), dx2 * 15./16,
+                    enstrophy, circulation, peak );
+        accumulate( omega(lev,nx2,ny/2+ny2), dx2 * 15./16,
+                    enstrophy, circulation, peak );
+        accumulate( omega(lev,nx/2+nx2,ny/2+ny2), dx2 * 15./16,
+                    enstrophy, circulation, peak );
+        // edges
+        for (int j=ny2+1; j < ny/2 + ny2; ++j) {
+            // left & right
+            accumulate( omega(lev,nx2,j), dx2 * 0.75,
+                        enstrophy, circulation, peak );
+            accumulate( omega(lev,nx/2+nx2,j), dx2 * 0.75,
+                        enstrophy, circulation, peak );
+        }
+        for (int i=nx2+1; i< nx/2 + nx2; ++i) {
+            // top & bottom
+            accumulate( omega(lev,i,ny2), dx2 * 0.75,
+                        enstrophy, circulation, peak );
+            accumulate( omega(lev,i,ny/2+ny2), dx2 * 0.75,
+                        enstrophy, circulation, peak );
+        }
+        // Left border
+        for (int i = 1; i < nx2; ++i) {
+            for ( int j = 1; j < ny; ++j) {
+                accumulate( omega(lev,i,j), dx2,
+                            enstrophy, circulation, peak );
+            }
+        }
+        // Right border
+        for (int i = nx/2 + nx2 + 1; i < nx; ++i ) {
+            for (int j = 1; j < ny; ++j) {
+                accumulate( omega(lev,i,j), dx2,
+                            enstrophy, circulation, peak );
+            }
+        }
+        for (int i = nx2; i < nx/2 + nx2 + 1; ++i ) {
+            // Bottom border
+            for (int j=1; j < ny2; ++ j ) {
+                accumulate( omega(lev,i,j), dx2,
+                            enstrophy, circulation, peak );
+            }
+            // Top border
+            for (int j = ny/2 + ny2 + 1; j < ny; ++j) {
+                accumulate( omega(lev,i,j), dx2,
+                            enstrophy, circulation, peak );
+            }
+        }
+    }
+    enstrophy *= 0.5;
+}
+
+OutputDiagnostics::OutputDiagnostics(string filename) :
+    _filename( filename )
+{}
+
+bool OutputDiagnostics::init() {
+    _fp = fopen( _filename.c_str(), "w" );
+    _buffer.clear();
+    _pendingLines = 0;
+    if ( _fp == NULL ) return false;
+    else return true;
+}
+
+bool OutputDiagnostics::cleanup() {
+    bool status = true;
+    if ( _fp != NULL ) {
+        status = flushBuffer();
+        status = status && ( fclose( _fp ) == 0 );
+    }
+    return status;
+}
+
+bool OutputDiagnostics::flushBuffer() {
+    if ( _pendingLines == 0 ) return true;
+    size_t nbytes = fwrite( _buffer.data(), 1, _buffer.size(), _fp );
+    bool status = ( nbytes == _buffer.size() );
+    fflush( _fp );
+    _buffer.clear();
+    _pendingLines = 0;
+    return status;
+}
+
+bool OutputDiagnostics::doOutput(const State& x) {
+    double energy = .5 * InnerProduct( x.q, x.q );
+    double enstrophy, circulation, peak;
+    vorticityDiagnostics( x.omega, enstrophy, circulation, peak );
+
+    if ( _fp == NULL ) return false;
+    char line[256];
+    sprintf( line, "%5d %.5e %.5e %.5e %.5e %.5e\n",
+             x.timestep, x.time, energy, enstrophy, circulation, peak );
+    _buffer += line;
+    if ( ++_pendingLines >= FLUSH_INTERVAL ) return flushBuffer();
+    return true;
+}
+
+bool OutputDiagnostics::doOutput(const BaseFlow & q, const State& x) {
+    // Currently no use for baseflow, but this method is defined for future
+    // flexibility
+    return doOutput(x);
+}
+
+} // namespace ibpm
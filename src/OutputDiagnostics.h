@@ -0,0 +1,65 @@
+#ifndef _OUTPUTDIAGNOSTICS_H_
+#define _OUTPUTDIAGNOSTICS_H_
+
+#include "Output.h"
+#include <stdio.h>
+#include <string>
+using std::string;
+
+namespace ibpm {
+
+/*!
+\file OutputDiagnostics.h
+\class OutputDiagnostics
+
+\brief Output routine for writing fused per-step flow diagnostics.
+
+Writes kinetic energy, enstrophy, net circulation, and peak vorticity
+to a single file, one line per output step.  Energy is accumulated in
+one sweep over the fluxes, and the three vorticity diagnostics share
+one sweep over the vorticity field, so enabling all four costs two
+memory sweeps instead of one per quantity.
+
+\author Clancy Rowley
+\date 22 Aug 2008
+
+\author $LastChangedBy$
+\date $LastChangedDate$
+\version $Revision$
+*/
+
+class OutputDiagnostics : public Output {
+public:
+    /// \brief Constructor
+    /// \param[in] filename to which diagnostics will be written.
+    OutputDiagnostics(string filename);
+
+    /// \brief Open the file for writing.
+    /// If a file with the same name is already present, it is overwritten.
+    /// Returns true if successful.
+    bool init();
+
+    /// \brief Close the file.
+    /// Returns true if successful
+    bool cleanup();
+
+    /// \brief Write timestep, time, energy, enstrophy, circulation, and
+    /// peak vorticity to the diagnostics file.
+    bool doOutput(const State& x);
+
+    /// \brief Write data to the diagnostics file, making use of the baseflow.
+    bool doOutput(const BaseFlow& q, const State& x);
+
+private:
+    // Write the batched lines to the file and flush it
+    bool flushBuffer();
+
+    string _filename;
+    FILE* _fp;
+    string _buffer;         // lines batched in memory, not yet written
+    int _pendingLines;
+};
+
+} // namespace ibpm
+
+#endif /* _OUTPUTDIAGNOSTICS_H_ */
@@ -7,12 +7,18 @@
 
 namespace ibpm {
 
+// Number of output steps batched in memory before the file is written
+// (see OutputForce.cc)
+static const int FLUSH_INTERVAL = 100;
+
 OutputEnergy::OutputEnergy(string filename) :
     _filename( filename )
 {}
 
 bool OutputEnergy::init() {
     _fp = fopen( _filename.c_str(), "w" );
+    _buffer.clear();
+    _pendingLines = 0;
     if ( _fp == NULL ) return false;
     else return true;
 }
@@ -20,18 +26,31 @@ bool OutputEnergy::init() {
 bool OutputEnergy::cleanup() {
     bool status = true;
     if ( _fp != NULL ) {
-        status = fclose( _fp );
+        status = flushBuffer();
+        status = status && ( fclose( _fp ) == 0 );
     }
     return status;
 }
-    
+
+bool OutputEnergy::flushBuffer() {
+    if ( _pendingLines == 0 ) return true;
+    size_t nbytes = fwrite( _buffer.data(), 1, _buffer.size(), _fp );
+    bool status = ( nbytes == _buffer.size() );
+    fflush( _fp );
+    _buffer.clear();
+    _pendingLines = 0;
+    return status;
+}
+
 bool OutputEnergy::doOutput(const State& x) {
     double energy = 0.;
     energy = .5 * InnerProduct( x.q, x.q );
-    
+
     if ( _fp == NULL ) return false;
-    fprintf( _fp, "%5d %.5e %.5e\n", x.timestep, x.time, energy );   
-    fflush( _fp );
+    char line[256];
+    sprintf( line, "%5d %.5e %.5e\n", x.timestep, x.time, energy );
+    _buffer += line;
+    if ( ++_pendingLines >= FLUSH_INTERVAL ) return flushBuffer();
     return true;
 }
     
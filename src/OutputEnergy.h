@@ -28,10 +28,15 @@ public:
     
     /// \brief Write data to the energy file, making use of the baseflow.
     bool doOutput(const BaseFlow& q, const State& x);
-    
+
 private:
+    // Write the batched lines to the file and flush it
+    bool flushBuffer();
+
     string _filename;
     FILE* _fp;
+    string _buffer;         // lines batched in memory, not yet written
+    int _pendingLines;
 };
 
 } // namespace ibpm
@@ -16,6 +16,8 @@
 
 #include "OutputForce.h"
 #include "BaseFlow.h"
+#include "Geometry.h"
+#include "RigidBody.h"
 #include "State.h"
 #include "Output.h"
 #include "VectorOperations.h"
@@ -24,12 +26,46 @@
 
 namespace ibpm {
 
+// Number of output steps batched in memory before the file is written.
+// Batching avoids a system call per timestep; the buffer is flushed
+// explicitly at cleanup so no lines are lost at the end of a run.
+static const int FLUSH_INTERVAL = 100;
+
 OutputForce::OutputForce(string filename) :
-    _filename( filename )
+    _filename( filename ),
+    _geometry( NULL )
+{}
+
+OutputForce::OutputForce(string filename, const Geometry& geometry) :
+    _filename( filename ),
+    _geometry( &geometry )
 {}
 
 bool OutputForce::init() {
     _fp = fopen( _filename.c_str(), "w" );
+    _buffer.clear();
+    _pendingLines = 0;
+    // Cache the per-body point ranges and rotation centers once; the
+    // bodies appear in the force vector in the order the geometry
+    // stores them
+    _bodyBegin.clear();
+    _bodyEnd.clear();
+    _bodyXC.clear();
+    _bodyYC.clear();
+    if ( _geometry != NULL ) {
+        int offset = 0;
+        for ( int i=0; i<_geometry->getNumBodies(); ++i ) {
+            const RigidBody& body = _geometry->getBody( i );
+            _bodyBegin.push_back( offset );
+            offset += body.getNumPoints();
+            _bodyEnd.push_back( offset );
+            double xc;
+            double yc;
+            body.getCenter( xc, yc );
+            _bodyXC.push_back( xc );
+            _bodyYC.push_back( yc );
+        }
+    }
     if ( _fp == NULL ) return false;
     else return true;
 }
@@ -37,11 +73,22 @@ bool OutputForce::init() {
 bool OutputForce::cleanup() {
     bool status = true;
     if ( _fp != NULL ) {
-        status = fclose( _fp );
+        status = flushBuffer();
+        status = status && ( fclose( _fp ) == 0 );
     }
     return status;
 }
 
+bool OutputForce::flushBuffer() {
+    if ( _pendingLines == 0 ) return true;
+    size_t nbytes = fwrite( _buffer.data(), 1, _buffer.size(), _fp );
+    bool status = ( nbytes == _buffer.size() );
+    fflush( _fp );
+    _buffer.clear();
+    _pendingLines = 0;
+    return status;
+}
+
 // Method to compute lift, drag from state (x), angle of attack (alpha), and freestream velocity (mag)
 bool OutputForce::doOutput( const double alpha, const double mag, const State& x) {
     double xF, yF;      // force in x and y direction in domain
@@ -61,9 +108,30 @@ bool OutputForce::doOutput( const double alpha, const double mag, const State& x
     lift *= 2.;
     
     if ( _fp == NULL ) return false;
-    fprintf( _fp, "%5d %.5e %.5e %.5e\n", x.timestep, x.time, drag, lift );   
-    fflush( _fp );
-    
+    char line[256];
+    sprintf( line, "%5d %.5e %.5e %.5e", x.timestep, x.time, drag, lift );
+    _buffer += line;
+
+    // Per-body columns: drag, lift, and moment coefficient of each
+    // body, from the cached point ranges (see init)
+    if ( _geometry != NULL ) {
+        BoundaryVector points = _geometry->getPoints();
+        for ( unsigned int i=0; i<_bodyBegin.size(); ++i ) {
+            double fx;
+            double fy;
+            double moment;
+            x.computeBodyForce( _bodyBegin[i], _bodyEnd[i], points,
+                                _bodyXC[i], _bodyYC[i], fx, fy, moment );
+            double bodyDrag = 2. * (  fx * cos(alpha) + fy * sin(alpha) );
+            double bodyLift = 2. * ( -fx * sin(alpha) + fy * cos(alpha) );
+            sprintf( line, " %.5e %.5e %.5e",
+                     bodyDrag, bodyLift, 2. * moment );
+            _buffer += line;
+        }
+    }
+    _buffer += "\n";
+    if ( ++_pendingLines >= FLUSH_INTERVAL ) return flushBuffer();
+
     return true;
 }
 
@@ -4,10 +4,14 @@
 #include "Output.h"
 #include <stdio.h>
 #include <string>
+#include <vector>
 using std::string;
+using std::vector;
 
 namespace ibpm {
 
+class Geometry;
+
 /*!
 \file OutputForce.h
 \class OutputForce
@@ -29,6 +33,12 @@ public:
     /// \param[in] filename to which force data will be written.
     OutputForce(string filename);
 
+    /// \brief Constructor with a geometry, for per-body output: each
+    /// body appends its own drag, lift, and moment about its center to
+    /// every line, so multi-body forces need no postprocessing of the
+    /// raw force vector
+    OutputForce(string filename, const Geometry& geometry);
+
     /// \brief Open the file for writing.
     /// If a file with the same name is already present, it is overwritten.
     /// Returns true if successful.
@@ -46,11 +56,22 @@ public:
     
     /// \brief Write data to the force file.
     bool doOutput(const State& x);
-    
-    
-private:   
+
+
+private:
+    // Write the batched lines to the file and flush it
+    bool flushBuffer();
+
     string _filename;
     FILE* _fp;
+    string _buffer;         // lines batched in memory, not yet written
+    int _pendingLines;
+    const Geometry* _geometry;  // for per-body columns; may be NULL
+    // cached per-body point ranges and rotation centers, built at init()
+    vector<int> _bodyBegin;
+    vector<int> _bodyEnd;
+    vector<double> _bodyXC;
+    vector<double> _bodyYC;
 };
 
 } // namespace ibpm
@@ -0,0 +1,250 @@
+// OutputForceStats.cc
+//
+// Description:
+// Implementation of the OutputForceStats class
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "OutputForceStats.h"
+#include "BaseFlow.h"
+#include "State.h"
+#include "Output.h"
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace ibpm {
+
+// Evaluating the spectrum at every bin of the block costs
+// O(blockSize * numBins) multiplies per block on two scalars, which is
+// negligible, but the recurrence state is two doubles per bin, so the
+// bin count is capped for very long blocks
+static const int MAX_BINS = 512;
+
+OutputForceStats::OutputForceStats(
+    string filename,
+    int blockSize,
+    double convergeTol
+    ) :
+    _filename( filename ),
+    _fp( NULL ),
+    _blockSize( blockSize < 16 ? 16 : blockSize ),
+    _convergeTol( convergeTol ),
+    _numSamples( 0 ),
+    _dragMean( 0. ),
+    _dragM2( 0. ),
+    _liftMean( 0. ),
+    _liftM2( 0. ),
+    _blockCount( 0 ),
+    _blockStartTime( 0. ),
+    _blockEndTime( 0. ),
+    _blockDragMean( 0. ),
+    _blockDragM2( 0. ),
+    _blockLiftMean( 0. ),
+    _blockLiftM2( 0. ),
+    _detrend( 0. ),
+    _lastTimestep( 0 ),
+    _lastTime( 0. ),
+    _havePrevBlock( false ),
+    _prevDragMean( 0. ),
+    _prevLiftRms( 0. ),
+    _prevStrouhal( 0. ),
+    _stationaryBlocks( 0 ),
+    _converged( false )
+{
+    _numBins = _blockSize / 2;
+    if ( _numBins > MAX_BINS ) _numBins = MAX_BINS;
+    _coeff.resize( _numBins + 1 );
+    _s1.resize( _numBins + 1 );
+    _s2.resize( _numBins + 1 );
+    for ( int k=1; k<=_numBins; ++k ) {
+        _coeff[k] = 2. * cos( 2. * M_PI * k / _blockSize );
+    }
+}
+
+bool OutputForceStats::init() {
+    _fp = fopen( _filename.c_str(), "w" );
+    if ( _fp == NULL ) return false;
+    fprintf( _fp, "# step time mean_drag rms_drag mean_lift rms_lift "
+        "St converged\n" );
+    _numSamples = 0;
+    _dragMean = 0.;
+    _dragM2 = 0.;
+    _liftMean = 0.;
+    _liftM2 = 0.;
+    _blockCount = 0;
+    _detrend = 0.;
+    _havePrevBlock = false;
+    _stationaryBlocks = 0;
+    _converged = false;
+    return true;
+}
+
+bool OutputForceStats::cleanup() {
+    if ( _fp == NULL ) return true;
+    // Report a trailing partial block if it holds enough samples for
+    // meaningful statistics (its frequency resolution is degraded)
+    if ( _blockCount >= _blockSize / 4 ) {
+        finishBlock();
+    }
+    if ( _numSamples > 1 ) {
+        fprintf( _fp, "# overall: samples %ld, mean drag %.5e, "
+            "rms drag %.5e, mean lift %.5e, rms lift %.5e\n",
+            _numSamples, _dragMean,
+            sqrt( _dragM2 / ( _numSamples - 1 ) ), _liftMean,
+            sqrt( _liftM2 / ( _numSamples - 1 ) ) );
+    }
+    bool status = ( fclose( _fp ) == 0 );
+    _fp = NULL;
+    return status;
+}
+
+// Fold one sample of the lift and drag coefficients into the running
+// accumulators; the force-to-coefficient conversion matches OutputForce
+bool OutputForceStats::addSample( double alpha, const State& x ) {
+    if ( _fp == NULL ) return false;
+    double xF, yF;
+    x.computeNetForce( xF, yF );
+    double drag = 2. * (  xF * cos(alpha) + yF * sin(alpha) );
+    double lift = 2. * ( -xF * sin(alpha) + yF * cos(alpha) );
+    _lastTimestep = x.timestep;
+    _lastTime = x.time;
+
+    // Whole-run mean and variance (Welford)
+    ++_numSamples;
+    double d = drag - _dragMean;
+    _dragMean += d / _numSamples;
+    _dragM2 += d * ( drag - _dragMean );
+    d = lift - _liftMean;
+    _liftMean += d / _numSamples;
+    _liftM2 += d * ( lift - _liftMean );
+
+    // Current block
+    if ( _blockCount == 0 ) {
+        _blockStartTime = x.time;
+        _blockDragMean = 0.;
+        _blockDragM2 = 0.;
+        _blockLiftMean = 0.;
+        _blockLiftM2 = 0.;
+        for ( int k=1; k<=_numBins; ++k ) {
+            _s1[k] = 0.;
+            _s2[k] = 0.;
+        }
+    }
+    ++_blockCount;
+    _blockEndTime = x.time;
+    d = drag - _blockDragMean;
+    _blockDragMean += d / _blockCount;
+    _blockDragM2 += d * ( drag - _blockDragMean );
+    d = lift - _blockLiftMean;
+    _blockLiftMean += d / _blockCount;
+    _blockLiftM2 += d * ( lift - _blockLiftMean );
+
+    // Goertzel recurrence per candidate frequency, on the detrended
+    // lift (shedding shows up in lift at the fundamental; drag
+    // oscillates at its harmonic)
+    double y = lift - _detrend;
+    for ( int k=1; k<=_numBins; ++k ) {
+        double s = y + _coeff[k] * _s1[k] - _s2[k];
+        _s2[k] = _s1[k];
+        _s1[k] = s;
+    }
+
+    if ( _blockCount >= _blockSize ) {
+        finishBlock();
+    }
+    return true;
+}
+
+// Close out the current block: spectral peak, block statistics, one
+// output line, and the stationarity comparison with the previous block
+void OutputForceStats::finishBlock() {
+    int n = _blockCount;
+    double dragMean = _blockDragMean;
+    double dragRms = ( n > 1 ) ? sqrt( _blockDragM2 / ( n - 1 ) ) : 0.;
+    double liftMean = _blockLiftMean;
+    double liftRms = ( n > 1 ) ? sqrt( _blockLiftM2 / ( n - 1 ) ) : 0.;
+
+    // Power at each candidate frequency, from the Goertzel state
+    std::vector<double> power( _numBins + 1, 0. );
+    int kPeak = 0;
+    for ( int k=1; k<=_numBins; ++k ) {
+        power[k] = _s1[k] * _s1[k] + _s2[k] * _s2[k]
+            - _coeff[k] * _s1[k] * _s2[k];
+        if ( kPeak == 0 || power[k] > power[kPeak] ) kPeak = k;
+    }
+    // Sharpen the peak by parabolic interpolation across its neighbors
+    double kRefined = kPeak;
+    if ( kPeak > 1 && kPeak < _numBins ) {
+        double denom = power[kPeak-1] - 2. * power[kPeak] + power[kPeak+1];
+        if ( denom < 0. ) {
+            kRefined += 0.5 * ( power[kPeak-1] - power[kPeak+1] ) / denom;
+        }
+    }
+    // Time is nondimensional (lengths by c, velocity by U), so the
+    // dominant frequency is the Strouhal number directly
+    double dtSample = ( n > 1 )
+        ? ( _blockEndTime - _blockStartTime ) / ( n - 1 ) : 0.;
+    double strouhal = ( dtSample > 0. )
+        ? kRefined / ( _blockSize * dtSample ) : 0.;
+
+    // Stationarity: the block statistics have stopped changing when
+    // mean drag, RMS lift, and the Strouhal number all moved by less
+    // than the tolerance relative to their own size (the Strouhal
+    // comparison never demands more than the block's bin resolution)
+    if ( _havePrevBlock && ! _converged && _convergeTol > 0. ) {
+        double dragScale = fabs( dragMean ) > 1e-12 ? fabs( dragMean ) : 1.;
+        double liftScale = liftRms > 1e-12 ? liftRms : 1.;
+        double stTol = _convergeTol;
+        if ( kPeak > 0 && 1. / kPeak > stTol ) stTol = 1. / kPeak;
+        bool stationary =
+            fabs( dragMean - _prevDragMean ) <= _convergeTol * dragScale &&
+            fabs( liftRms - _prevLiftRms ) <= _convergeTol * liftScale &&
+            ( _prevStrouhal <= 0. || strouhal <= 0. ||
+              fabs( strouhal - _prevStrouhal ) <= stTol * _prevStrouhal );
+        if ( stationary ) {
+            if ( ++_stationaryBlocks >= 2 ) {
+                _converged = true;
+                cerr << "Force statistics converged at step "
+                    << _lastTimestep << " (mean drag " << dragMean
+                    << ", rms lift " << liftRms << ", St " << strouhal
+                    << ")" << endl;
+            }
+        }
+        else {
+            _stationaryBlocks = 0;
+        }
+    }
+    _havePrevBlock = true;
+    _prevDragMean = dragMean;
+    _prevLiftRms = liftRms;
+    _prevStrouhal = strouhal;
+
+    fprintf( _fp, "%5d %.5e %.5e %.5e %.5e %.5e %.5e %d\n",
+        _lastTimestep, _lastTime, dragMean, dragRms, liftMean, liftRms,
+        strouhal, _converged ? 1 : 0 );
+    fflush( _fp );
+
+    // Next block detrends the lift with this block's mean
+    _detrend = liftMean;
+    _blockCount = 0;
+}
+
+bool OutputForceStats::doOutput( const State& x ) {
+    return addSample( 0., x );
+}
+
+bool OutputForceStats::doOutput( const BaseFlow& q, const State& x ) {
+    return addSample( q.getAlpha(), x );
+}
+
+} // namespace ibpm
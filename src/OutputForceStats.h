@@ -0,0 +1,120 @@
+#ifndef _OUTPUTFORCESTATS_H_
+#define _OUTPUTFORCESTATS_H_
+
+#include "Output.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+using std::string;
+
+namespace ibpm {
+
+/*!
+    \file OutputForceStats.h
+    \class OutputForceStats
+
+    \brief Online analysis of the force signal: mean/RMS, dominant
+    Strouhal number, and a statistical-stationarity detector.
+
+    Consumes the same per-step net force OutputForce writes, but keeps
+    no history: the signal is folded into streaming accumulators as it
+    arrives, replacing the usual postprocessing pass over a stored
+    .force file.  Per block of samples it reports
+
+      - mean and RMS of the drag and lift coefficients (Welford),
+      - the dominant frequency of the lift fluctuation, i.e. the
+        Strouhal number (time is already nondimensional).  The power
+        spectrum -- the transform of the lift autocovariance -- is
+        evaluated at each candidate frequency with a Goertzel
+        recurrence, so no sample buffer is needed, and the peak is
+        sharpened by parabolic interpolation across adjacent bins,
+      - a converged flag, raised once the block statistics stop
+        changing (relative change of mean drag, RMS lift, and Strouhal
+        number below the tolerance for two consecutive blocks).
+
+    One line per block goes to the output file.  converged() exposes
+    the flag so the main loop can terminate a run once its statistics
+    have stopped changing, instead of integrating to the step budget.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 30 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+class OutputForceStats : public Output {
+public:
+    /// \brief Constructor
+    /// \param[in] filename Name of the text file for the per-block lines
+    /// \param[in] blockSize Number of force samples per analysis block;
+    /// the frequency resolution is 1 / (blockSize * sample interval)
+    /// \param[in] convergeTol Relative tolerance of the stationarity
+    /// detector
+    OutputForceStats( string filename, int blockSize, double convergeTol );
+
+    /// \brief Open the output file and reset the accumulators
+    bool init();
+
+    /// \brief Write a final line for any partial block and close the file
+    bool cleanup();
+
+    /// \brief Fold the net force into the running analysis
+    bool doOutput( const State& x );
+
+    /// \brief Fold the net force in, with lift and drag taken with
+    /// respect to the base flow's angle of attack
+    bool doOutput( const BaseFlow& q, const State& x );
+
+    /// \brief True once the block statistics have stopped changing.
+    /// With -asyncoutput the flag is raised on the writer thread and
+    /// may be seen one output interval late, which only delays the
+    /// termination check by that interval
+    bool converged() const { return _converged; }
+
+private:
+    bool addSample( double alpha, const State& x );
+    void finishBlock();
+
+    string _filename;
+    FILE* _fp;
+    int _blockSize;
+    double _convergeTol;
+
+    // Whole-run statistics (Welford)
+    long _numSamples;
+    double _dragMean;
+    double _dragM2;
+    double _liftMean;
+    double _liftM2;
+
+    // Current block: Welford accumulators, sample times for the
+    // frequency axis, and one Goertzel recurrence (s1, s2) per
+    // candidate frequency bin
+    int _blockCount;
+    double _blockStartTime;
+    double _blockEndTime;
+    double _blockDragMean;
+    double _blockDragM2;
+    double _blockLiftMean;
+    double _blockLiftM2;
+    double _detrend;    // previous block's mean lift, subtracted before
+                        // the Goertzel update so bin 0 does not leak
+    int _numBins;
+    std::vector<double> _coeff;     // 2 cos( 2 pi k / blockSize ) per bin
+    std::vector<double> _s1;
+    std::vector<double> _s2;
+    int _lastTimestep;  // of the newest sample, for the per-block lines
+    double _lastTime;
+
+    // Previous block's results, for the stationarity comparison
+    bool _havePrevBlock;
+    double _prevDragMean;
+    double _prevLiftRms;
+    double _prevStrouhal;
+    int _stationaryBlocks;
+    bool _converged;
+};
+
+} // namespace ibpm
+
+#endif /* _OUTPUTFORCESTATS_H_ */
@@ -13,9 +13,11 @@
 #include "Array.h"
 #include "State.h"
 #include "Output.h"
-#include "VectorOperations.h"
+#include "Scalar.h"
+#include "Flux.h"
 #include <vector>
 #include <stdio.h>
+#include <math.h>
 #include <string>
 
 namespace ibpm {
@@ -23,10 +25,16 @@ namespace ibpm {
 const int OutputProbes::_lev = 0;   // all probes at finest grid level
 const int OutputProbes::_dimen = 2; // two-dimensional domain for now
 
+// Number of output steps batched in memory before the files are written
+// (see OutputForce.cc)
+static const int FLUSH_INTERVAL = 100;
+
 OutputProbes::OutputProbes(string filename, Grid& grid ) :
     _filename( filename ),
     _grid( grid ),
-    _hasBeenInitialized( false )
+    _hasBeenInitialized( false ),
+    _writeGradients( false ),
+    _pendingLines( 0 )
 {}
 
 bool OutputProbes::init() {
@@ -37,52 +45,162 @@ bool OutputProbes::init() {
         char name[256];
         sprintf( name, _filename.c_str(), n+1 );
         _probes[n].fp = fopen( name, "w" );
+        _probes[n].buffer.clear();
         if ( _probes[n].fp == NULL ) return false;
     }
+    _pendingLines = 0;
     _hasBeenInitialized = true;
     return true;
 }
 
 bool OutputProbes::cleanup() {
-    bool status = true;
+    bool status = flushBuffers();
     for ( unsigned int n=0 ; n < _probes.size(); n++ ) {
         if ( _probes[n].fp != NULL ) {
-                status = status && fclose( _probes[n].fp );
+                status = status && ( fclose( _probes[n].fp ) == 0 );
         }
     }
     return status;
 }
 
-bool OutputProbes::doOutput(const State& state) {
-    // TODO: Unnecessary to transform velocity fields everywhere, when only a few probe points will be used
-    Scalar u(_grid);
-    Scalar v(_grid);
-    FluxToVelocity( state.q, u, v );
+bool OutputProbes::flushBuffers() {
+    bool status = true;
+    if ( _pendingLines == 0 ) return status;
+    for ( unsigned int n=0 ; n < _probes.size(); n++ ) {
+        string& buf = _probes[n].buffer;
+        size_t nbytes = fwrite( buf.data(), 1, buf.size(), _probes[n].fp );
+        status = status && ( nbytes == buf.size() );
+        fflush( _probes[n].fp );
+        buf.clear();
+    }
+    _pendingLines = 0;
+    return status;
+}
 
+bool OutputProbes::doOutput(const State& state) {
     // Write  u, v, qx, qy, omega, all at gridpoint/edge (i, j), for each probe,
-    // in seperate files
+    // in seperate files.  The velocities are evaluated probe-locally
+    // from the fluxes adjacent to the stencil nodes: no full-grid
+    // flux-to-velocity conversion is needed, so this stays cheap even
+    // when called every timestep
     // TODO: Why store qx and u?  Seems like this is redundant.
     for ( unsigned int n=0; n < _probes.size(); n++ ) {
-        assert(_probes[n].fp != NULL);
-        int i = _probes[n].i;
-        int j = _probes[n].j;
-        fprintf( _probes[n].fp, "%5d %.5e %.14e %.14e %.14e %.14e %.14e\n",  
-                 state.timestep, state.time,  
-                 u(_lev, i, j), v(_lev, i, j),
-                 state.q(_lev, X, i, j), state.q(_lev, Y, i, j),
-                 state.omega(_lev, i, j) ); 
-        fflush( _probes[n].fp );
+        const Probe& probe = _probes[n];
+        assert(probe.fp != NULL);
+        char line[256];
+        sprintf( line, "%5d %.5e %.14e %.14e %.14e %.14e %.14e",
+                 state.timestep, state.time,
+                 sampleVelocity( state.q, X, probe ),
+                 sampleVelocity( state.q, Y, probe ),
+                 sampleFlux( state.q, X, probe ),
+                 sampleFlux( state.q, Y, probe ),
+                 sampleScalar( state.omega, probe ) );
+        _probes[n].buffer += line;
+        if ( _writeGradients ) {
+            sprintf( line, " %.14e %.14e %.14e %.14e",
+                     sampleVelocityGradient( state.q, X, X, probe ),
+                     sampleVelocityGradient( state.q, X, Y, probe ),
+                     sampleVelocityGradient( state.q, Y, X, probe ),
+                     sampleVelocityGradient( state.q, Y, Y, probe ) );
+            _probes[n].buffer += line;
+        }
+        _probes[n].buffer += "\n";
     }
-    
+    if ( ++_pendingLines >= FLUSH_INTERVAL ) return flushBuffers();
+
     return true;
 }
 
 bool OutputProbes::doOutput(const BaseFlow & q, const State& x) {
-    // Currently no use for baseflow, but this method is defined for future 
+    // Currently no use for baseflow, but this method is defined for future
     // flexibility
     return doOutput(x);
 }
 
+// Sample a scalar field at a probe with its precomputed bilinear stencil.
+// For a probe on a gridpoint the stencil collapses to the value at (i, j).
+double OutputProbes::sampleScalar( const Scalar& f, const Probe& probe ) const {
+    return probe.w00 * f( _lev, probe.i,            probe.j            )
+         + probe.w10 * f( _lev, probe.i + probe.di, probe.j            )
+         + probe.w01 * f( _lev, probe.i,            probe.j + probe.dj )
+         + probe.w11 * f( _lev, probe.i + probe.di, probe.j + probe.dj );
+}
+
+// Sample one component of a flux field the same way
+double OutputProbes::sampleFlux( const Flux& q, int dir,
+                                 const Probe& probe ) const {
+    return probe.w00 * q( _lev, dir, probe.i,            probe.j            )
+         + probe.w10 * q( _lev, dir, probe.i + probe.di, probe.j            )
+         + probe.w01 * q( _lev, dir, probe.i,            probe.j + probe.dj )
+         + probe.w11 * q( _lev, dir, probe.i + probe.di, probe.j + probe.dj );
+}
+
+// Velocity at inner node (i,j) of the finest level, averaged from the
+// two adjacent fluxes: the same formula FluxToVelocity applies to the
+// whole grid, applied here to a single node
+double OutputProbes::nodeVelocity( const Flux& q, int dir,
+                                   int i, int j ) const {
+    double oneOver2Delta = 1. / ( 2 * _grid.Dx() );
+    if ( dir == X ) {
+        return ( q( _lev, X, i, j-1 ) + q( _lev, X, i, j ) ) * oneOver2Delta;
+    }
+    else {
+        return ( q( _lev, Y, i-1, j ) + q( _lev, Y, i, j ) ) * oneOver2Delta;
+    }
+}
+
+// Sample a velocity component at a probe: bilinear stencil over the
+// node velocities, each computed from two fluxes, so a probe touches at
+// most eight flux values per component
+double OutputProbes::sampleVelocity( const Flux& q, int dir,
+                                     const Probe& probe ) const {
+    return probe.w00 * nodeVelocity( q, dir, probe.i,            probe.j            )
+         + probe.w10 * nodeVelocity( q, dir, probe.i + probe.di, probe.j            )
+         + probe.w01 * nodeVelocity( q, dir, probe.i,            probe.j + probe.dj )
+         + probe.w11 * nodeVelocity( q, dir, probe.i + probe.di, probe.j + probe.dj );
+}
+
+// Derivative of velocity component dir with respect to coordinate deriv,
+// at inner node (i,j), by a centered difference of node velocities.
+// Where the centered neighbor would fall outside the nodes at which
+// that velocity component is defined (du/dy at j=1 or Ny-1, dv/dx at
+// i=1 or Nx-1), a one-sided difference is used instead.
+double OutputProbes::nodeVelocityGradient( const Flux& q, int dir, int deriv,
+                                           int i, int j ) const {
+    double oneOverDelta = 1. / _grid.Dx();
+    if ( deriv == X ) {
+        int ilo = i - 1;
+        int ihi = i + 1;
+        if ( dir == Y ) {
+            // v is defined only at i in [1, Nx-1]
+            if ( ilo < 1 ) ilo = 1;
+            if ( ihi > _grid.Nx()-1 ) ihi = _grid.Nx()-1;
+        }
+        return ( nodeVelocity( q, dir, ihi, j ) -
+                 nodeVelocity( q, dir, ilo, j ) ) * oneOverDelta / (ihi - ilo);
+    }
+    else {
+        int jlo = j - 1;
+        int jhi = j + 1;
+        if ( dir == X ) {
+            // u is defined only at j in [1, Ny-1]
+            if ( jlo < 1 ) jlo = 1;
+            if ( jhi > _grid.Ny()-1 ) jhi = _grid.Ny()-1;
+        }
+        return ( nodeVelocity( q, dir, i, jhi ) -
+                 nodeVelocity( q, dir, i, jlo ) ) * oneOverDelta / (jhi - jlo);
+    }
+}
+
+// Sample a velocity gradient at a probe with the same bilinear stencil
+double OutputProbes::sampleVelocityGradient( const Flux& q, int dir, int deriv,
+                                             const Probe& probe ) const {
+    return probe.w00 * nodeVelocityGradient( q, dir, deriv, probe.i,            probe.j            )
+         + probe.w10 * nodeVelocityGradient( q, dir, deriv, probe.i + probe.di, probe.j            )
+         + probe.w01 * nodeVelocityGradient( q, dir, deriv, probe.i,            probe.j + probe.dj )
+         + probe.w11 * nodeVelocityGradient( q, dir, deriv, probe.i + probe.di, probe.j + probe.dj );
+}
+
 void OutputProbes::addProbeByIndex( int i, int j ){
     if ( _hasBeenInitialized ) {
         cout << "Error: Addition of probes is allowed only "
@@ -102,9 +220,45 @@ void OutputProbes::addProbeByIndex( int i, int j ){
 }
 
 void OutputProbes::addProbeByPosition( double xcord, double ycord ) {
-    int i = _grid.getXGridIndex( xcord );
-    int j = _grid.getYGridIndex( ycord );
-    addProbeByIndex( i, j ); 
+    // Lower-left gridpoint of the cell containing the probe, and the
+    // fractional offset of the probe within that cell
+    double xpos = ( xcord - _grid.getXEdge( _lev, 0 ) ) / _grid.Dx();
+    double ypos = ( ycord - _grid.getYEdge( _lev, 0 ) ) / _grid.Dx();
+    int i = int( floor( xpos ) );
+    int j = int( floor( ypos ) );
+    double fx = xpos - i;
+    double fy = ypos - j;
+
+    // Snap to the nearest gridpoint when the probe lies on one
+    const double tol = 1.e-10;
+    if ( fx < tol ) fx = 0.;
+    if ( fx > 1. - tol ) { ++i; fx = 0.; }
+    if ( fy < tol ) fy = 0.;
+    if ( fy > 1. - tol ) { ++j; fy = 0.; }
+    if ( fx == 0. && fy == 0. ) {
+        addProbeByIndex( i, j );
+        return;
+    }
+
+    if ( _hasBeenInitialized ) {
+        cout << "Error: Addition of probes is allowed only "
+             << "before initialization." << endl;
+        exit(1);
+    }
+
+    // The whole stencil must lie at the inner nodes of the finest level
+    int di = ( fx > 0. ) ? 1 : 0;
+    int dj = ( fy > 0. ) ? 1 : 0;
+    if ( i < 1 || j < 1 ||
+         i + di > _grid.Nx()-1 || j + dj > _grid.Ny()-1 ) {
+        cout << "Warning: invalid probe position: ("
+            << xcord << "," << ycord << ")" << endl
+            << "Probes should be located at the inner nodes "
+            << "at the finest grid level." << endl;
+        exit(1);
+    };
+    Probe probe( i, j, fx, fy );
+    _probes.push_back(probe);
 }
 
 void OutputProbes::addProbe( int i, int j ) {
@@ -12,16 +12,28 @@ using std::vector;
 
 namespace ibpm {
 
+class Scalar;
+class Flux;
+
 /*!
 \file OutputProbes.h
 \class OutputProbes
 
-\brief Write velocities, fluxes, and vorticity, at given probe locations, to files. 
- 
-Each probe has a corresponding output file. 
+\brief Write velocities, fluxes, and vorticity, at given probe locations, to files.
+
+Each probe has a corresponding output file.
+
+All probes are supposed to be located in the interior of the finest
+grid level (level 0).  Probes added by index lie at gridpoints; probes
+added by position may lie anywhere in the interior, and are sampled by
+bilinear interpolation, with the stencil weights precomputed when the
+probe is added so that sampling costs only four multiply-adds per
+quantity per probe.
 
-All probes are supposed to be located at the interior nodes
- at the finest grid level (level 0).
+All quantities are evaluated probe-locally: velocities come from the
+handful of fluxes adjacent to the stencil nodes, not from a full-grid
+flux-to-velocity conversion, so each output step touches a few dozen
+values per probe and probes can be written every timestep.
 
 Probes are labelled as Probe 1, 2, ... .
 
@@ -64,19 +76,26 @@ public:
     /// to the correpsonding file with name (filename + probe#), making use of the baseflow too.
     bool doOutput( const BaseFlow& q, const State& x );
     
-    /// \brief Add a probe by specifying its gridpoint indices 
+    /// \brief Add a probe by specifying its gridpoint indices
     void addProbeByIndex( int i, int j );
-    
-    /// \brief Add a probe by specifying its absolute coordinates 
+
+    /// \brief Add a probe by specifying its absolute coordinates.
+    /// The probe need not lie on a gridpoint: off-gridpoint probes are
+    /// sampled by bilinear interpolation from the surrounding gridpoints.
     void addProbeByPosition( double xcord, double ycord );
-    // TODO: Write up this member function. 
     
     /// \brief Add a probe by specifying its gridpoint indices
     void addProbe( int i, int j );
     
     /// \brief Add a probe by specifying its absolute coordinates
-    void addProbe( double xcord, double ycord ); 
-    
+    void addProbe( double xcord, double ycord );
+
+    /// \brief Also write the velocity gradients du/dx, du/dy, dv/dx,
+    /// dv/dy as four extra columns after the vorticity.  The gradients
+    /// are evaluated probe-locally as well, from centered differences
+    /// of the node velocities around the stencil
+    inline void setWriteGradients( bool flag ) { _writeGradients = flag; }
+
     /// Print out probe locations (by grid indices), for debugging 
     void print();
     
@@ -96,18 +115,20 @@ public:
         return _probes[index-1].j;
     }
     
-    /// Return the gridpoint x coordinate of the corresponding probe
+    /// Return the x coordinate of the corresponding probe
     inline double getProbeCoordX( unsigned int index ){
         assert( index <= _probes.size() && index >= 1 );
-        return _grid.getXEdge( _lev, _probes[index-1].i );
+        return _grid.getXEdge( _lev, _probes[index-1].i )
+            + _probes[index-1].fx * _grid.Dx();
     }
-    
-    /// Return the gridpoint y coordinate of the corresponding probe
+
+    /// Return the y coordinate of the corresponding probe
     inline double getProbeCoordY( unsigned int index ){
         assert( index <= _probes.size() && index >= 1 );
-        return _grid.getYEdge( _lev, _probes[index-1].j );
+        return _grid.getYEdge( _lev, _probes[index-1].j )
+            + _probes[index-1].fy * _grid.Dx();
     }
-    
+
 private:
     class Probe {
     public:
@@ -115,18 +136,66 @@ private:
             i(ii),
             j(jj),
             fp(NULL)
-        {}
+        {
+            setStencil( 0., 0. );
+        }
+        Probe(int ii, int jj, double fracx, double fracy) :
+            i(ii),
+            j(jj),
+            fp(NULL)
+        {
+            setStencil( fracx, fracy );
+        }
+        // Precompute the bilinear interpolation stencil for a probe at
+        // fractional offset (fx, fy) from gridpoint (i, j), in cells.
+        // The neighbor offsets collapse to zero when the probe lies
+        // exactly on a gridpoint, so the stencil never reads past (i, j).
+        void setStencil( double fracx, double fracy ) {
+            fx = fracx;
+            fy = fracy;
+            di = ( fx > 0. ) ? 1 : 0;
+            dj = ( fy > 0. ) ? 1 : 0;
+            w00 = (1. - fx) * (1. - fy);
+            w10 = fx * (1. - fy);
+            w01 = (1. - fx) * fy;
+            w11 = fx * fy;
+        }
         int i,j;
+        int di,dj;              // stencil neighbor offsets (0 or 1)
+        double fx,fy;           // fractional offset from (i,j), in cells
+        double w00,w10,w01,w11; // bilinear stencil weights
         FILE *fp;
+        string buffer;  // lines batched in memory, not yet written
     };
 
     bool writeSummaryFile(void);
 
+    // Sample a field at a probe with its precomputed stencil
+    double sampleScalar( const Scalar& f, const Probe& probe ) const;
+    double sampleFlux( const Flux& q, int dir, const Probe& probe ) const;
+
+    // Velocity at an inner node of the finest level, averaged from the
+    // two adjacent fluxes, and its sampled value at a probe
+    double nodeVelocity( const Flux& q, int dir, int i, int j ) const;
+    double sampleVelocity( const Flux& q, int dir, const Probe& probe ) const;
+
+    // Derivative d(velocity dir)/d(coordinate deriv) at a node, by
+    // centered differences of node velocities, and its sampled value
+    double nodeVelocityGradient( const Flux& q, int dir, int deriv,
+                                 int i, int j ) const;
+    double sampleVelocityGradient( const Flux& q, int dir, int deriv,
+                                   const Probe& probe ) const;
+
+    // Write the batched lines of every probe to its file and flush it
+    bool flushBuffers();
+
     // Private data
     string _filename;
     Grid _grid;
     bool _hasBeenInitialized;
+    bool _writeGradients;
     vector<Probe> _probes;
+    int _pendingLines;
     static const int _lev;
     static const int _dimen;
 };
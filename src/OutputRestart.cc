@@ -17,21 +17,136 @@
 #include "State.h"
 #include "Output.h"
 #include <stdio.h>
+#include <string.h>
 #include <string>
 
 namespace ibpm {
 
-OutputRestart::OutputRestart(string formatString) {
+OutputRestart::OutputRestart(string formatString, bool compress,
+                             bool singlePrecision) {
     _formatString = formatString;
+    _compress = compress;
+    _singlePrecision = singlePrecision;
+    _compact = false;
+    _quantized = false;
+    _maxLevels = 0;
+    _deltaInterval = 0;
+    _deltaQuantize = false;
+    _writeCount = 0;
+    _keepLast = 0;
+    _keepEvery = 0;
+    _checkpointCount = 0;
+    _trackedFiles = 0;
 }
 
 bool OutputRestart::doOutput(const State& x) {
     char filename[256];
     sprintf( filename, _formatString.c_str(), x.timestep );
-    bool status = x.save( filename );
+
+    // Whether this write is self-contained (loadable without another
+    // file), for the retention policy; computed before writeRecord
+    // advances the delta schedule
+    bool fullSave = _compact || ( _deltaInterval <= 1 ) ||
+                    ( _writeCount % _deltaInterval == 0 );
+
+    const Grid& grid = x.q.getGrid();
+    if ( _maxLevels > 0 && _maxLevels < grid.Ngrid() ) {
+        // Copy the finest _maxLevels levels into a truncated State and
+        // save that instead, for smaller monitoring dumps
+        Grid subgrid( grid.Nx(), grid.Ny(), _maxLevels,
+                      grid.Nx() * grid.Dx(),
+                      grid.getXEdge(0,0), grid.getYEdge(0,0),
+                      grid.getXShift(), grid.getYShift() );
+        State sub( subgrid, x.f.getNumPoints() );
+        for (int lev=0; lev < _maxLevels; ++lev) {
+            for (int i=0; i <= grid.Nx(); ++i) {
+                for (int j=0; j < grid.Ny(); ++j) {
+                    sub.q(lev,X,i,j) = x.q(lev,X,i,j);
+                }
+            }
+            for (int i=0; i < grid.Nx(); ++i) {
+                for (int j=0; j <= grid.Ny(); ++j) {
+                    sub.q(lev,Y,i,j) = x.q(lev,Y,i,j);
+                }
+            }
+            for (int i=1; i < grid.Nx(); ++i) {
+                for (int j=1; j < grid.Ny(); ++j) {
+                    sub.omega(lev,i,j) = x.omega(lev,i,j);
+                }
+            }
+        }
+        sub.f = x.f;
+        sub.timestep = x.timestep;
+        sub.time = x.time;
+        bool status = writeRecord( sub, filename );
+        if ( status ) recordCheckpoint( filename, fullSave );
+        return status;
+    }
+
+    bool status = writeRecord( x, filename );
+    if ( status ) recordCheckpoint( filename, fullSave );
     return status;
 }
 
+void OutputRestart::recordCheckpoint( const char* filename, bool fullSave ) {
+    if ( _keepLast <= 0 ) return;
+    bool permanent = ( _keepEvery > 0 &&
+                       _checkpointCount % _keepEvery == 0 );
+    ++_checkpointCount;
+    // A full save starts a new group; deltas join the group of the
+    // keyframe they reference
+    if ( fullSave || _fileGroups.empty() ) {
+        _fileGroups.push_back( FileGroup() );
+        _fileGroups.back().retained = false;
+    }
+    _fileGroups.back().names.push_back( filename );
+    _fileGroups.back().retained = _fileGroups.back().retained || permanent;
+    ++_trackedFiles;
+    // Retire whole groups from the front while at least _keepLast files
+    // remain behind them; permanent groups are left on disk, the rest
+    // deleted
+    while ( _fileGroups.size() > 1 &&
+            _trackedFiles - (int) _fileGroups.front().names.size()
+                >= _keepLast ) {
+        FileGroup& g = _fileGroups.front();
+        _trackedFiles -= g.names.size();
+        if ( ! g.retained ) {
+            for (unsigned int i=0; i<g.names.size(); ++i) {
+                remove( g.names[i].c_str() );
+            }
+        }
+        _fileGroups.erase( _fileGroups.begin() );
+    }
+}
+
+bool OutputRestart::writeRecord( const State& x, const char* filename ) {
+    if ( _compact ) {
+        return x.saveCompact( filename );
+    }
+    if ( _quantized ) {
+        return x.saveQuantized( filename );
+    }
+    if ( _deltaInterval <= 1 ) {
+        return x.save( filename, _compress, _singlePrecision );
+    }
+    bool isKeyframe = ( _writeCount % _deltaInterval == 0 );
+    ++_writeCount;
+    if ( isKeyframe ) {
+        bool status = x.save( filename, _compress, _singlePrecision );
+        if ( status ) {
+            _keyframe = x;
+            // Record the name without the directory, so the keyframe is
+            // found next to the delta files wherever they are archived
+            const char* slash = strrchr( filename, '/' );
+            _keyframeName = ( slash != NULL ) ? slash + 1 : filename;
+        }
+        return status;
+    }
+    // saveDelta falls back to a full save if no keyframe has been
+    // written yet (e.g. the keyframe save above failed)
+    return x.saveDelta( filename, _keyframeName, _keyframe, _deltaQuantize );
+}
+
 bool OutputRestart::doOutput(const BaseFlow& q, const State& x) {
     // Currently no use for baseflow, but this method is defined for future 
     // flexibility
@@ -42,5 +157,29 @@ void OutputRestart::setFilename( string formatString ) {
     _formatString = formatString;
 }
 
+void OutputRestart::setMaxLevels( int maxLevels ) {
+    _maxLevels = maxLevels;
+}
+
+void OutputRestart::setCompact( bool flag ) {
+    _compact = flag;
+}
+
+void OutputRestart::setQuantized( bool flag ) {
+    _quantized = flag;
+}
+
+void OutputRestart::setDeltaCheckpoints( int interval, bool quantize ) {
+    _deltaInterval = interval;
+    _deltaQuantize = quantize;
+    _writeCount = 0;
+    _keyframeName = "";
+}
+
+void OutputRestart::setRetention( int keepLast, int keepEvery ) {
+    _keepLast = keepLast;
+    _keepEvery = keepEvery;
+}
+
 } // namespace ibpm
 
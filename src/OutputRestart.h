@@ -2,7 +2,9 @@
 #define _OUTPUTRESTART_H_
 
 #include "Output.h"
+#include "State.h"
 #include <string>
+#include <vector>
 using std::string;
 
 namespace ibpm {
@@ -26,7 +28,13 @@ public:
     /// \brief Constructor
     /// \param[in] formatString Filename in the standard printf format
     /// (e.g. "file%06d.bin"), where timestep will be substituted for %d
-    OutputRestart(string formatString);
+    /// \param[in] compress If true, write zlib-compressed restart files
+    /// (State::load reads both formats transparently)
+    /// \param[in] singlePrecision If true, store the field data as
+    /// single-precision floats; suitable for visualization-bound
+    /// snapshots but not restarts
+    OutputRestart(string formatString, bool compress = false,
+                  bool singlePrecision = false);
 
     /// \brief Write the restart file
     bool doOutput(const State& x);
@@ -36,9 +44,79 @@ public:
     
     /// \brief Change the filename for the output file
     void setFilename( string formatString );
-    
+
+    /// \brief Save only the finest maxLevels grid levels (0 saves all).
+    /// Useful for frequent monitoring dumps; full-fidelity checkpoints
+    /// should leave this at the default
+    void setMaxLevels( int maxLevels );
+
+    /// \brief Write compact restart files holding only the finest-level
+    /// fields (see State::saveCompact); the coarse vorticity levels are
+    /// rebuilt when the file is loaded.  Takes precedence over the
+    /// compression, precision, and delta options
+    void setCompact( bool flag );
+
+    /// \brief Write quantized snapshot files, with the vorticity
+    /// stored as 16-bit integers against a per-tile scale and offset
+    /// (see State::saveQuantized) -- a quarter the size of single
+    /// precision, for movie-density frame dumps.  Not for full-fidelity
+    /// checkpoints.  Takes precedence over the compression, precision,
+    /// and delta options; setCompact takes precedence over this
+    void setQuantized( bool flag );
+
+    /// \brief Write every interval-th restart file in full (a keyframe)
+    /// and the files in between as differences from it (see
+    /// State::saveDelta), cutting the write volume of high-cadence
+    /// checkpointing several-fold.  State::load reconstructs delta files
+    /// transparently, provided the keyframe stays alongside them.  With
+    /// quantize set the differences are stored as 16-bit integers
+    void setDeltaCheckpoints( int interval, bool quantize );
+
+    /// \brief Prune old restart files automatically: keep the newest
+    /// keepLast files, plus (permanently) every keepEvery-th checkpoint
+    /// written, and delete the rest.  With delta checkpoints active a
+    /// keyframe and its deltas are pruned (or kept) together, so no
+    /// surviving delta file ever loses the keyframe it references.
+    /// Only files written by this run are tracked; a keepEvery of zero
+    /// keeps no permanent checkpoints beyond the newest keepLast
+    void setRetention( int keepLast, int keepEvery );
+
 private:
+    /// Write one restart record, as a keyframe or a delta depending on
+    /// the checkpoint schedule
+    bool writeRecord( const State& x, const char* filename );
+
+    /// Track a successfully written file for the retention policy and
+    /// delete the files that fall out of it (see setRetention)
+    void recordCheckpoint( const char* filename, bool fullSave );
+
     string _formatString;
+    bool _compress;
+    bool _singlePrecision;
+    bool _compact;
+    bool _quantized;
+    int _maxLevels;
+    int _deltaInterval;
+    bool _deltaQuantize;
+    int _writeCount;
+    State _keyframe;        // the state last written in full
+    string _keyframeName;   // its filename, without the directory
+
+    // Retention bookkeeping (see setRetention): the files written so
+    // far, grouped so that a delta keyframe and the deltas that
+    // reference it leave together; the oldest groups are deleted as
+    // they fall outside the newest _keepLast files, except groups
+    // holding a permanent (every _keepEvery-th) checkpoint, which are
+    // dropped from tracking and left on disk
+    struct FileGroup {
+        std::vector<string> names;
+        bool retained;
+    };
+    int _keepLast;
+    int _keepEvery;
+    int _checkpointCount;
+    int _trackedFiles;
+    std::vector<FileGroup> _fileGroups;
 };
 
 } // namespace ibpm
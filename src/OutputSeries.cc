@@ -0,0 +1,201 @@
+// OutputSeries.cc
+//
+// Description:
+// Implementation of output routine for appending snapshots to a single
+// time-series file, with an index footer for random access.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 22 Aug 2008
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "OutputSeries.h"
+#include "State.h"
+#include "Output.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace ibpm {
+
+// Magic strings identifying the head of a series file and of its footer
+static const char FILE_MAGIC[9] = "IBPMSER1";
+static const char INDEX_MAGIC[9] = "IBPMSIDX";
+static const int MAGIC_LEN = 8;
+
+OutputSeries::OutputSeries( string filename, bool singlePrecision,
+                            double sparseThreshold ) {
+    _filename = filename;
+    _singlePrecision = singlePrecision;
+    _sparseThreshold = sparseThreshold;
+    _fp = NULL;
+    _indexOffset = 0;
+}
+
+bool OutputSeries::init() {
+    // If the file already contains a valid series, continue appending to it
+    _fp = fopen( _filename.c_str(), "r+b" );
+    if ( _fp != NULL ) {
+        if ( readIndex( _fp, _index, _indexOffset ) ) {
+            cerr << "Continuing time series " << _filename << " with "
+                 << _index.size() << " frame(s)" << endl;
+            return true;
+        }
+        fclose( _fp );
+    }
+    // Otherwise start a new series
+    _fp = fopen( _filename.c_str(), "wb" );
+    if ( _fp == NULL ) return false;
+    fwrite( FILE_MAGIC, 1, MAGIC_LEN, _fp );
+    _index.clear();
+    _indexOffset = MAGIC_LEN;
+    return writeFooter();
+}
+
+bool OutputSeries::cleanup() {
+    if ( _fp != NULL ) {
+        fclose( _fp );
+        _fp = NULL;
+    }
+    return true;
+}
+
+bool OutputSeries::doOutput( const State& x ) {
+    if ( _fp == NULL ) return false;
+    // The new frame overwrites the old footer, and the footer is
+    // rewritten after it
+    FrameEntry entry;
+    entry.timestep = x.timestep;
+    entry.time = x.time;
+    entry.offset = _indexOffset;
+    fseeko( _fp, (off_t) _indexOffset, SEEK_SET );
+    bool success;
+    if ( _sparseThreshold > 0. ) {
+        success = x.saveSparse( _fp, _sparseThreshold );
+    }
+    else {
+        success = x.save( _fp, _singlePrecision );
+    }
+    if ( ! success ) return false;
+    _indexOffset = (long long) ftello( _fp );
+    _index.push_back( entry );
+    return writeFooter();
+}
+
+bool OutputSeries::doOutput( const BaseFlow& q, const State& x ) {
+    // Currently no use for baseflow, but this method is defined for future
+    // flexibility
+    return doOutput( x );
+}
+
+bool OutputSeries::writeFooter() {
+    fseeko( _fp, (off_t) _indexOffset, SEEK_SET );
+    for (unsigned int i=0; i<_index.size(); ++i) {
+        fwrite( &_index[i].timestep, sizeof( int ), 1, _fp );
+        fwrite( &_index[i].time, sizeof( double ), 1, _fp );
+        fwrite( &_index[i].offset, sizeof( long long ), 1, _fp );
+    }
+    int numFrames = _index.size();
+    fwrite( &numFrames, sizeof( int ), 1, _fp );
+    fwrite( &_indexOffset, sizeof( long long ), 1, _fp );
+    bool success = fwrite( INDEX_MAGIC, 1, MAGIC_LEN, _fp ) == (size_t) MAGIC_LEN;
+    // Flush so the file is complete after every output step
+    fflush( _fp );
+    return success;
+}
+
+bool OutputSeries::readIndex( FILE* fp, std::vector<FrameEntry>& index,
+                              long long& indexOffset ) {
+    char magic[MAGIC_LEN];
+
+    // Check the magic string at the head of the file
+    fseeko( fp, 0, SEEK_SET );
+    if ( fread( magic, 1, MAGIC_LEN, fp ) != (size_t) MAGIC_LEN ) return false;
+    if ( strncmp( magic, FILE_MAGIC, MAGIC_LEN ) != 0 ) return false;
+
+    // The footer ends with the frame count, the offset of the footer,
+    // and the footer magic string
+    long tailLen = sizeof( int ) + sizeof( long long ) + MAGIC_LEN;
+    if ( fseeko( fp, (off_t) -tailLen, SEEK_END ) != 0 ) return false;
+    int numFrames;
+    if ( fread( &numFrames, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( fread( &indexOffset, sizeof( long long ), 1, fp ) != 1 ) return false;
+    if ( fread( magic, 1, MAGIC_LEN, fp ) != (size_t) MAGIC_LEN ) return false;
+    if ( strncmp( magic, INDEX_MAGIC, MAGIC_LEN ) != 0 ) return false;
+    if ( numFrames < 0 || indexOffset < MAGIC_LEN ) return false;
+
+    // Read the per-frame entries
+    index.resize( numFrames );
+    fseeko( fp, (off_t) indexOffset, SEEK_SET );
+    for (int i=0; i<numFrames; ++i) {
+        if ( fread( &index[i].timestep, sizeof( int ), 1, fp ) != 1 ) return false;
+        if ( fread( &index[i].time, sizeof( double ), 1, fp ) != 1 ) return false;
+        if ( fread( &index[i].offset, sizeof( long long ), 1, fp ) != 1 ) return false;
+    }
+    return true;
+}
+
+int OutputSeries::getNumFrames( string filename ) {
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return -1;
+    std::vector<FrameEntry> index;
+    long long indexOffset;
+    bool success = readIndex( fp, index, indexOffset );
+    fclose( fp );
+    return success ? (int) index.size() : -1;
+}
+
+bool OutputSeries::getFrameInfo( string filename, int frame,
+                                 int& timestep, double& time ) {
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
+    std::vector<FrameEntry> index;
+    long long indexOffset;
+    bool success = readIndex( fp, index, indexOffset ) &&
+        ( frame >= 0 ) && ( frame < (int) index.size() );
+    if ( success ) {
+        timestep = index[frame].timestep;
+        time = index[frame].time;
+    }
+    fclose( fp );
+    return success;
+}
+
+bool OutputSeries::loadFrame( string filename, int frame, State& x ) {
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
+    std::vector<FrameEntry> index;
+    long long indexOffset;
+    bool success = readIndex( fp, index, indexOffset ) &&
+        ( frame >= 0 ) && ( frame < (int) index.size() );
+    if ( success ) {
+        fseeko( fp, (off_t) index[frame].offset, SEEK_SET );
+        success = x.load( fp );
+    }
+    fclose( fp );
+    return success;
+}
+
+bool OutputSeries::loadFrameForce( string filename, int frame,
+                                   BoundaryVector& f, int& timestep,
+                                   double& time, double& dx ) {
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
+    std::vector<FrameEntry> index;
+    long long indexOffset;
+    bool success = readIndex( fp, index, indexOffset ) &&
+        ( frame >= 0 ) && ( frame < (int) index.size() );
+    if ( success ) {
+        fseeko( fp, (off_t) index[frame].offset, SEEK_SET );
+        success = State::loadForceRecord( fp, f, timestep, time, dx );
+    }
+    fclose( fp );
+    return success;
+}
+
+} // namespace ibpm
@@ -0,0 +1,112 @@
+#ifndef _OUTPUTSERIES_H_
+#define _OUTPUTSERIES_H_
+
+#include "Output.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+using std::string;
+
+namespace ibpm {
+
+class State;
+class BoundaryVector;
+
+/*!
+\file OutputSeries.h
+\class OutputSeries
+
+\brief Output routine appending snapshots to a single time-series file
+
+Writes all snapshots of a run into one file, instead of one file per
+output step, so that long runs do not produce tens of thousands of
+small files.  Each frame holds the same record as a restart file
+(State::save), and an index footer at the end of the file lists the
+timestep, time, and file offset of every frame, so postprocessing
+tools can seek directly to any frame (see bin2plt and bininfo in
+examples/).  The footer is rewritten after every frame, so the file
+is valid after any output step, and init() continues a series left by
+a previous run rather than overwriting it.
+
+\author Clancy Rowley
+\date 22 Aug 2008
+
+\author $LastChangedBy$
+\date $LastChangedDate$
+\version $Revision$
+*/
+
+class OutputSeries : public Output {
+public:
+    /// \brief Constructor
+    /// \param[in] filename Name of the series file to append to
+    /// \param[in] singlePrecision If true, store the field data of each
+    /// frame as single-precision floats, halving the file size; suitable
+    /// for visualization-bound snapshots but not restarts
+    /// \param[in] sparseThreshold If positive, store the vorticity of
+    /// each frame sparsely, skipping tiles whose peak magnitude does not
+    /// exceed this value, and omit the flux (see State::saveSparse);
+    /// loadFrame re-densifies transparently, so postprocessing tools
+    /// (bin2plt etc.) need no changes
+    OutputSeries( string filename, bool singlePrecision = false,
+                  double sparseThreshold = 0. );
+
+    /// \brief Open the series file, continuing an existing series if the
+    /// file already contains one
+    bool init();
+
+    /// \brief Close the series file
+    bool cleanup();
+
+    /// \brief Append the state as a new frame and rewrite the index footer
+    bool doOutput( const State& x );
+
+    /// \brief Append the state as a new frame (base flow is not stored)
+    bool doOutput( const BaseFlow& q, const State& x );
+
+    /// \brief Return the number of frames in the given series file,
+    /// or -1 if the file is not a valid series file
+    static int getNumFrames( string filename );
+
+    /// \brief Look up the timestep and time of the given frame
+    static bool getFrameInfo( string filename, int frame,
+                              int& timestep, double& time );
+
+    /// \brief Load the given frame (0 .. numFrames-1) into the state
+    static bool loadFrame( string filename, int frame, State& x );
+
+    /// \brief Load only the boundary force of the given frame, plus its
+    /// timestep, time, and grid spacing, without reading the field data
+    /// (see State::loadForceRecord).  f is resized to the frame's point
+    /// count
+    static bool loadFrameForce( string filename, int frame,
+                                BoundaryVector& f, int& timestep,
+                                double& time, double& dx );
+
+private:
+    // One index footer entry per frame
+    struct FrameEntry {
+        int timestep;
+        double time;
+        long long offset;   // file offset where the frame record begins
+    };
+
+    // Rewrite the index footer at _indexOffset
+    bool writeFooter();
+
+    // Read the index footer of an open series file; returns false if the
+    // file is not a valid series
+    static bool readIndex( FILE* fp, std::vector<FrameEntry>& index,
+                           long long& indexOffset );
+
+    string _filename;
+    bool _singlePrecision;
+    double _sparseThreshold;
+    FILE* _fp;
+    std::vector<FrameEntry> _index;
+    long long _indexOffset;     // file offset where the footer begins
+};
+
+} // namespace ibpm
+
+#endif /* _OUTPUTSERIES_H_ */
@@ -0,0 +1,253 @@
+#include "OutputSnapshots.h"
+#include "State.h"
+#include "BaseFlow.h"
+#include "Output.h"
+#include "Scalar.h"
+#include "Memory.h"
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace ibpm {
+
+OutputSnapshots::OutputSnapshots( string basename, int stride,
+    int svdRank ) :
+    _basename( basename ),
+    _stride( stride < 1 ? 1 : stride ),
+    _svdRank( svdRank ),
+    _numRows( 0 ),
+    _numSnapshots( 0 ),
+    _rank( 0 )
+{}
+
+bool OutputSnapshots::init() {
+    return true;
+}
+
+void OutputSnapshots::flattenSnapshot( const State& x,
+    vector<double>& column ) {
+    column.clear();
+    int ngrid = x.omega.Ngrid();
+    int nx = x.omega.Nx();
+    int ny = x.omega.Ny();
+    for ( int lev = 0; lev < ngrid; ++lev ) {
+        for ( int i = 1; i < nx; i += _stride ) {
+            for ( int j = 1; j < ny; j += _stride ) {
+                column.push_back( x.omega(lev,i,j) );
+            }
+        }
+    }
+}
+
+bool OutputSnapshots::doOutput( const State& x ) {
+    flattenSnapshot( x, _column );
+    if ( _numRows != 0 && (int) _column.size() != _numRows ) {
+        // The grid grew mid-run (see -growngrid): columns of different
+        // lengths cannot share a snapshot matrix or POD basis, so
+        // restart the collection on the new grid
+        Memory::recordFree( Memory::OTHER,
+            _snapshots.size() * sizeof(float) );
+        _snapshots.clear();
+        _basis.clear();
+        _sigma.clear();
+        _rank = 0;
+        _numSnapshots = 0;
+        _numRows = 0;
+    }
+    if ( _numRows == 0 ) {
+        _numRows = (int) _column.size();
+    }
+    // Append as a float32 column: half the resident footprint of the
+    // matrix, and far more precision than POD/DMD of a time series needs
+    _snapshots.reserve( _snapshots.size() + _numRows );
+    for ( int i = 0; i < _numRows; i++ ) {
+        _snapshots.push_back( (float) _column[i] );
+    }
+    Memory::recordAlloc( Memory::OTHER, _numRows * sizeof(float) );
+    ++_numSnapshots;
+    if ( _svdRank > 0 ) {
+        updateBasis( _column );
+    }
+    return true;
+}
+
+bool OutputSnapshots::doOutput( const BaseFlow& q, const State& x ) {
+    return doOutput( x );
+}
+
+// One-sided Jacobi on the columns of the n x n column-major matrix K:
+// right rotations orthogonalize the columns, so on return column j is
+// sigma_j * u_j.  n here is the basis rank plus one, so this is a few
+// microseconds per snapshot
+static void jacobiOrthogonalize( vector<double>& K, int n ) {
+    const int MAX_SWEEPS = 30;
+    const double eps = 1e-14;
+    for ( int sweep = 0; sweep < MAX_SWEEPS; ++sweep ) {
+        bool rotated = false;
+        for ( int p = 0; p < n - 1; ++p ) {
+            for ( int q = p + 1; q < n; ++q ) {
+                double* cp = &K[p*n];
+                double* cq = &K[q*n];
+                double app = 0., aqq = 0., apq = 0.;
+                for ( int i = 0; i < n; i++ ) {
+                    app += cp[i] * cp[i];
+                    aqq += cq[i] * cq[i];
+                    apq += cp[i] * cq[i];
+                }
+                if ( fabs( apq ) <= eps * sqrt( app * aqq ) ) continue;
+                rotated = true;
+                double zeta = ( aqq - app ) / ( 2. * apq );
+                double t = ( zeta >= 0. ? 1. : -1. )
+                    / ( fabs( zeta ) + sqrt( 1. + zeta * zeta ) );
+                double c = 1. / sqrt( 1. + t * t );
+                double s = c * t;
+                for ( int i = 0; i < n; i++ ) {
+                    double vp = cp[i];
+                    cp[i] = c * vp - s * cq[i];
+                    cq[i] = s * vp + c * cq[i];
+                }
+            }
+        }
+        if ( ! rotated ) break;
+    }
+}
+
+// Fold the new snapshot into the rank-limited POD basis: orthogonalize
+// against the current basis, diagonalize the (rank+1)-square quotient,
+// rotate the extended basis, and truncate back to the requested rank
+void OutputSnapshots::updateBasis( const vector<double>& a ) {
+    int m = _numRows;
+    if ( _rank == 0 ) {
+        double norm = 0.;
+        for ( int i = 0; i < m; i++ ) norm += a[i] * a[i];
+        norm = sqrt( norm );
+        _sigma.assign( 1, norm );
+        _basis.assign( m, 0. );
+        if ( norm > 0. ) {
+            for ( int i = 0; i < m; i++ ) _basis[i] = a[i] / norm;
+        }
+        _rank = 1;
+        return;
+    }
+    int r = _rank;
+    // Projection onto the basis and the residual direction
+    vector<double> p( r, 0. );
+    for ( int j = 0; j < r; j++ ) {
+        const double* uj = &_basis[j*m];
+        double sum = 0.;
+        for ( int i = 0; i < m; i++ ) sum += uj[i] * a[i];
+        p[j] = sum;
+    }
+    vector<double> q( m );
+    for ( int i = 0; i < m; i++ ) q[i] = a[i];
+    for ( int j = 0; j < r; j++ ) {
+        const double* uj = &_basis[j*m];
+        for ( int i = 0; i < m; i++ ) q[i] -= p[j] * uj[i];
+    }
+    double rho = 0.;
+    for ( int i = 0; i < m; i++ ) rho += q[i] * q[i];
+    rho = sqrt( rho );
+    if ( rho > 0. ) {
+        for ( int i = 0; i < m; i++ ) q[i] /= rho;
+    }
+    // Small quotient K = [ diag(sigma)  p ; 0  rho ], column-major
+    int n = r + 1;
+    vector<double> K( n * n, 0. );
+    for ( int j = 0; j < r; j++ ) K[j*n + j] = _sigma[j];
+    for ( int i = 0; i < r; i++ ) K[r*n + i] = p[i];
+    K[r*n + r] = rho;
+    jacobiOrthogonalize( K, n );
+    // Column norms are the updated singular values; order them
+    vector<int> order( n );
+    vector<double> norms( n );
+    for ( int j = 0; j < n; j++ ) {
+        double sum = 0.;
+        for ( int i = 0; i < n; i++ ) sum += K[j*n + i] * K[j*n + i];
+        norms[j] = sqrt( sum );
+        order[j] = j;
+    }
+    for ( int j = 0; j < n - 1; j++ ) {        // selection sort, n is tiny
+        int best = j;
+        for ( int k = j + 1; k < n; k++ ) {
+            if ( norms[order[k]] > norms[order[best]] ) best = k;
+        }
+        int tmp = order[j]; order[j] = order[best]; order[best] = tmp;
+    }
+    // Rotate the extended basis [U q] by the leading columns of the
+    // orthogonalized quotient and truncate
+    int rNew = ( n < _svdRank ) ? n : _svdRank;
+    vector<double> newBasis( (size_t) m * rNew, 0. );
+    vector<double> newSigma( rNew );
+    for ( int jj = 0; jj < rNew; jj++ ) {
+        int j = order[jj];
+        double sigma = norms[j];
+        newSigma[jj] = sigma;
+        if ( sigma <= 0. ) continue;
+        double* dst = &newBasis[(size_t) jj * m];
+        for ( int k = 0; k < r; k++ ) {
+            double w = K[j*n + k] / sigma;
+            if ( w == 0. ) continue;
+            const double* uk = &_basis[(size_t) k * m];
+            for ( int i = 0; i < m; i++ ) dst[i] += w * uk[i];
+        }
+        double w = K[j*n + r] / sigma;
+        if ( w != 0. ) {
+            for ( int i = 0; i < m; i++ ) dst[i] += w * q[i];
+        }
+    }
+    _basis.swap( newBasis );
+    _sigma.swap( newSigma );
+    _rank = rNew;
+}
+
+// Write an m x n float32 matrix, column-major, with a small self-
+// describing header
+static bool writeMatrix( const string& filename, const vector<float>& a,
+    int m, int n, int stride ) {
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) return false;
+    const char magic[8] = { 'I','B','P','M','S','N','A','P' };
+    int header[4];
+    header[0] = 1;          // format version
+    header[1] = m;
+    header[2] = n;
+    header[3] = stride;
+    bool status = ( fwrite( magic, 1, 8, fp ) == 8 );
+    status = status && ( fwrite( header, sizeof(int), 4, fp ) == 4 );
+    status = status &&
+        ( fwrite( &a[0], sizeof(float), a.size(), fp ) == a.size() );
+    status = ( fclose( fp ) == 0 ) && status;
+    return status;
+}
+
+bool OutputSnapshots::cleanup() {
+    if ( _numSnapshots == 0 ) return true;
+    bool status = writeMatrix( _basename + ".snap", _snapshots,
+        _numRows, _numSnapshots, _stride );
+    if ( _svdRank > 0 && _rank > 0 ) {
+        vector<float> basis( _basis.size() );
+        for ( size_t i = 0; i < _basis.size(); i++ ) {
+            basis[i] = (float) _basis[i];
+        }
+        status = writeMatrix( _basename + ".pod", basis,
+            _numRows, _rank, _stride ) && status;
+        FILE* fp = fopen( ( _basename + ".sigma" ).c_str(), "w" );
+        if ( fp != NULL ) {
+            for ( int j = 0; j < _rank; j++ ) {
+                fprintf( fp, "%.10e\n", _sigma[j] );
+            }
+            status = ( fclose( fp ) == 0 ) && status;
+        }
+        else {
+            status = false;
+        }
+    }
+    Memory::recordFree( Memory::OTHER,
+        (size_t) _numRows * _numSnapshots * sizeof(float) );
+    _snapshots.clear();
+    _numSnapshots = 0;
+    return status;
+}
+
+} // namespace ibpm
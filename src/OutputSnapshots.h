@@ -0,0 +1,81 @@
+#ifndef _OUTPUTSNAPSHOTS_H_
+#define _OUTPUTSNAPSHOTS_H_
+
+#include "Output.h"
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace ibpm {
+
+/*!
+    \file OutputSnapshots.h
+    \class OutputSnapshots
+
+    \brief Accumulate a snapshot matrix for modal analysis in memory.
+
+    Each sampled state's vorticity is flattened (optionally keeping only
+    every stride-th interior point per direction) and appended as a
+    float32 column of an in-memory snapshot matrix, so a POD/DMD study
+    never writes or re-reads restart files.  The temporal subsampling is
+    the interval this Output is registered with in the Logger.
+
+    Optionally a rank-r POD basis is maintained incrementally: each new
+    snapshot is orthogonalized against the current basis, the small
+    (r+1) x (r+1) quotient is diagonalized by one-sided Jacobi, and the
+    basis is rotated and truncated back to rank r, so the leading modes
+    are available at any time without a pass over the matrix.
+
+    At cleanup the snapshot matrix is written as one flat binary file
+    (float32 columns with a small header), along with the singular
+    values and basis when the incremental update is on.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+class OutputSnapshots : public Output {
+public:
+    /// \brief Constructor
+    /// \param[in] basename for the files written at cleanup
+    /// \param[in] stride keep every stride-th interior point per direction
+    /// \param[in] svdRank if >0, maintain a rank-svdRank POD basis
+    /// incrementally as snapshots arrive
+    OutputSnapshots( string basename, int stride, int svdRank );
+
+    bool init();
+
+    /// \brief Write the snapshot matrix (and basis, if maintained)
+    bool cleanup();
+
+    /// \brief Append the state as a new snapshot column
+    bool doOutput( const State& x );
+
+    /// \brief Append the state as a new snapshot column
+    bool doOutput( const BaseFlow& q, const State& x );
+
+private:
+    void flattenSnapshot( const State& x, vector<double>& column );
+    void updateBasis( const vector<double>& column );
+
+    string _basename;
+    int _stride;
+    int _svdRank;
+    int _numRows;       // set by the first snapshot
+    int _numSnapshots;
+    // Snapshot matrix, column-major, float32: _numRows * _numSnapshots
+    vector<float> _snapshots;
+    vector<double> _column;     // current snapshot, in double, for the basis
+    // Incremental POD factors: _basis is column-major _numRows x _rank,
+    // _sigma the corresponding singular values
+    vector<double> _basis;
+    vector<double> _sigma;
+    int _rank;          // current rank, grows up to _svdRank
+};
+
+} // namespace ibpm
+
+#endif /* _OUTPUTSNAPSHOTS_H_ */
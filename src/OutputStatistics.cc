@@ -0,0 +1,184 @@
+#include "OutputStatistics.h"
+#include "State.h"
+#include "BaseFlow.h"
+#include "Output.h"
+#include "Grid.h"
+#include "VectorOperations.h"
+#include "DerivedFields.h"
+#include "ScalarToTecplot.h"
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace ibpm {
+
+OutputStatistics::OutputStatistics( string basename ) :
+    _basename( basename ),
+    _numSamples( 0 ),
+    _uMean( NULL ),
+    _vMean( NULL ),
+    _omegaMean( NULL ),
+    _uu( NULL ),
+    _vv( NULL ),
+    _uv( NULL ),
+    _omegaVar( NULL ),
+    _fxMean( 0. ),
+    _fyMean( 0. ),
+    _fxM2( 0. ),
+    _fyM2( 0. )
+{}
+
+OutputStatistics::~OutputStatistics() {
+    delete _uMean;
+    delete _vMean;
+    delete _omegaMean;
+    delete _uu;
+    delete _vv;
+    delete _uv;
+    delete _omegaVar;
+}
+
+bool OutputStatistics::init() {
+    return true;
+}
+
+void OutputStatistics::allocateAccumulators( const Grid& grid ) {
+    _uMean = new Scalar( grid );
+    _vMean = new Scalar( grid );
+    _omegaMean = new Scalar( grid );
+    _uu = new Scalar( grid );
+    _vv = new Scalar( grid );
+    _uv = new Scalar( grid );
+    _omegaVar = new Scalar( grid );
+    *_uMean = 0.;
+    *_vMean = 0.;
+    *_omegaMean = 0.;
+    *_uu = 0.;
+    *_vv = 0.;
+    *_uv = 0.;
+    *_omegaVar = 0.;
+}
+
+bool OutputStatistics::doOutput( const State& x ) {
+    if ( _uMean != NULL && _uMean->Ngrid() != x.omega.Ngrid() ) {
+        // The grid grew mid-run (see -growngrid): samples on different
+        // level counts cannot be accumulated together, so restart the
+        // statistics on the new grid
+        delete _uMean;   _uMean = NULL;
+        delete _vMean;   _vMean = NULL;
+        delete _omegaMean; _omegaMean = NULL;
+        delete _uu;      _uu = NULL;
+        delete _vv;      _vv = NULL;
+        delete _uv;      _uv = NULL;
+        delete _omegaVar; _omegaVar = NULL;
+        _numSamples = 0;
+        _fxMean = 0.;
+        _fyMean = 0.;
+        _fxM2 = 0.;
+        _fyM2 = 0.;
+    }
+    if ( _uMean == NULL ) {
+        allocateAccumulators( x.omega.getGrid() );
+    }
+    // Velocities come from the shared per-step cache, so a Tecplot file
+    // written on the same step reuses this conversion (and vice versa)
+    const Scalar* xVel;
+    const Scalar* yVel;
+    DerivedFields::getVelocities( x, xVel, yVel );
+    ++_numSamples;
+    const double invN = 1. / _numSamples;
+
+    // One fused pass: Welford updates of every field accumulator at each
+    // gridpoint, so each sample streams the fields through memory once
+    int ngrid = x.omega.Ngrid();
+    int nx = x.omega.Nx();
+    int ny = x.omega.Ny();
+    for ( int lev = 0; lev < ngrid; ++lev ) {
+        for ( int i = 1; i < nx; ++i ) {
+            for ( int j = 1; j < ny; ++j ) {
+                double u = (*xVel)(lev,i,j);
+                double v = (*yVel)(lev,i,j);
+                double w = x.omega(lev,i,j);
+                double du = u - (*_uMean)(lev,i,j);
+                double dv = v - (*_vMean)(lev,i,j);
+                double dw = w - (*_omegaMean)(lev,i,j);
+                (*_uMean)(lev,i,j) += du * invN;
+                (*_vMean)(lev,i,j) += dv * invN;
+                (*_omegaMean)(lev,i,j) += dw * invN;
+                // Sums of (co-)deviation products, using the updated
+                // means; divided by the sample count at cleanup
+                (*_uu)(lev,i,j) += du * ( u - (*_uMean)(lev,i,j) );
+                (*_vv)(lev,i,j) += dv * ( v - (*_vMean)(lev,i,j) );
+                (*_uv)(lev,i,j) += du * ( v - (*_vMean)(lev,i,j) );
+                (*_omegaVar)(lev,i,j) += dw * ( w - (*_omegaMean)(lev,i,j) );
+            }
+        }
+    }
+
+    // Force coefficients, as written by OutputForce
+    double xF, yF;
+    x.computeNetForce( xF, yF );
+    double drag = 2. * xF;
+    double lift = 2. * yF;
+    double dFx = drag - _fxMean;
+    double dFy = lift - _fyMean;
+    _fxMean += dFx * invN;
+    _fyMean += dFy * invN;
+    _fxM2 += dFx * ( drag - _fxMean );
+    _fyM2 += dFy * ( lift - _fyMean );
+    return true;
+}
+
+bool OutputStatistics::doOutput( const BaseFlow& q, const State& x ) {
+    // The rotation to lift/drag at the instantaneous angle of attack is
+    // not applied here: statistics of the lab-frame components stay
+    // well-defined even when alpha varies over the averaging window
+    return doOutput( x );
+}
+
+bool OutputStatistics::cleanup() {
+    if ( _numSamples == 0 ) return true;
+
+    // Convert the deviation-product sums into (co)variances, in place
+    double invN = 1. / _numSamples;
+    *_uu *= invN;
+    *_vv *= invN;
+    *_uv *= invN;
+    *_omegaVar *= invN;
+
+    vector<const Scalar*> fields;
+    vector<string> names;
+    fields.push_back( _uMean );     names.push_back( "u_mean" );
+    fields.push_back( _vMean );     names.push_back( "v_mean" );
+    fields.push_back( _omegaMean ); names.push_back( "omega_mean" );
+    fields.push_back( _uu );        names.push_back( "uu" );
+    fields.push_back( _vv );        names.push_back( "vv" );
+    fields.push_back( _uv );        names.push_back( "uv" );
+    fields.push_back( _omegaVar ); names.push_back( "omega_var" );
+    char title[256];
+    sprintf( title, "Running statistics, %ld samples", _numSamples );
+    bool status = ScalarToTecplot( fields, names, _basename + ".plt",
+        title );
+
+    // Force statistics: mean, standard deviation, and the 95% confidence
+    // interval of the mean (1.96 sigma / sqrt(n), assuming independent
+    // samples)
+    FILE* fp = fopen( ( _basename + ".force" ).c_str(), "w" );
+    if ( fp == NULL ) return false;
+    double fxStd = ( _numSamples > 1 ) ?
+        sqrt( _fxM2 / ( _numSamples - 1 ) ) : 0.;
+    double fyStd = ( _numSamples > 1 ) ?
+        sqrt( _fyM2 / ( _numSamples - 1 ) ) : 0.;
+    double halfWidth = 1.96 / sqrt( (double) _numSamples );
+    fprintf( fp, "# force statistics over %ld samples\n", _numSamples );
+    fprintf( fp, "# quantity      mean          std           ci95\n" );
+    fprintf( fp, "x force   %13.5e %13.5e %13.5e\n",
+        _fxMean, fxStd, fxStd * halfWidth );
+    fprintf( fp, "y force   %13.5e %13.5e %13.5e\n",
+        _fyMean, fyStd, fyStd * halfWidth );
+    status = ( fclose( fp ) == 0 ) && status;
+    return status;
+}
+
+} // namespace ibpm
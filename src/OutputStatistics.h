@@ -0,0 +1,81 @@
+#ifndef _OUTPUTSTATISTICS_H_
+#define _OUTPUTSTATISTICS_H_
+
+#include "Output.h"
+#include "Scalar.h"
+#include <string>
+using std::string;
+
+namespace ibpm {
+
+/*!
+    \file OutputStatistics.h
+    \class OutputStatistics
+
+    \brief Accumulate running flow and force statistics in place.
+
+    Maintains the running mean and variance of the vorticity and of both
+    velocity components, and the Reynolds stresses (u'u', v'v', u'v'),
+    updated with one fused pass over the grid per sample (Welford's
+    algorithm, so no snapshots are stored and no second pass is needed).
+    Force statistics (mean, standard deviation, 95% confidence interval
+    of the mean) are accumulated the same way.
+
+    Nothing is written until cleanup(): the fields then go to a single
+    Tecplot file (finest grid level) and the force statistics to a small
+    text file, eliminating the snapshot I/O that averaging runs
+    otherwise pay.  The confidence interval assumes independent samples;
+    for correlated ones (consecutive timesteps) it is optimistic.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+class OutputStatistics : public Output {
+public:
+    /// \brief Constructor
+    /// \param[in] basename for the files written at cleanup:
+    /// <basename>.plt for the fields, <basename>.force for the forces
+    OutputStatistics( string basename );
+
+    ~OutputStatistics();
+
+    /// \brief Nothing to open; files are written at cleanup
+    bool init();
+
+    /// \brief Write the accumulated statistics and free the accumulators
+    bool cleanup();
+
+    /// \brief Fold the state into the running statistics (writes nothing)
+    bool doOutput( const State& x );
+
+    /// \brief Fold the state into the running statistics (writes nothing)
+    bool doOutput( const BaseFlow& q, const State& x );
+
+private:
+    void allocateAccumulators( const Grid& grid );
+
+    string _basename;
+    long _numSamples;
+    // Running means and sums of squared deviations (M2), one fused
+    // update per sample; allocated at the first sample, when the grid
+    // is known
+    Scalar* _uMean;
+    Scalar* _vMean;
+    Scalar* _omegaMean;
+    Scalar* _uu;
+    Scalar* _vv;
+    Scalar* _uv;
+    Scalar* _omegaVar;
+    // Force statistics, accumulated the same way
+    double _fxMean;
+    double _fyMean;
+    double _fxM2;
+    double _fyM2;
+};
+
+} // namespace ibpm
+
+#endif /* _OUTPUTSTATISTICS_H_ */
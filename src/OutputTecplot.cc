@@ -16,6 +16,7 @@
 #include "OutputTecplot.h"
 #include "State.h"
 #include "Output.h"
+#include "DerivedFields.h"
 #include "VectorOperations.h"
 #include "ScalarToTecplot.h"
 #include <stdio.h>
@@ -24,10 +25,12 @@
 
 namespace ibpm {
 
-OutputTecplot::OutputTecplot( string filename, string title, bool TecplotAllGrids ) {
+OutputTecplot::OutputTecplot( string filename, string title, bool TecplotAllGrids, bool TecplotBinary ) {
     _filename = filename;
     _title = title;
     _TecplotAllGrids = TecplotAllGrids;
+    _TecplotBinary = TecplotBinary;
+    _maxLevels = 0;
 }
     
 bool OutputTecplot::doOutput(const State& state) {
@@ -36,35 +39,53 @@ bool OutputTecplot::doOutput(const State& state) {
     sprintf( filename, _filename.c_str(), state.timestep );
     char title[256];
     sprintf( title, _title.c_str(), state.timestep );
-    bool status = false;    
-    const Grid& grid = state.omega.getGrid();	
-		
-    // Calculate velocities
-    Scalar u( state.omega.getGrid() );
-    Scalar v( state.omega.getGrid() );
-    FluxToVelocity( state.q, u, v );
-    
+    bool status = false;
+    const Grid& grid = state.omega.getGrid();
+
+    // Fill the persistent coordinate fields on the first call (or if
+    // the grid ever changes); later calls reuse them, so a snapshot no
+    // longer rebuilds two full multi-domain Scalars per file
+    if ( ! _x.getGrid().isEqualTo( grid ) ) {
+        _x.resize( grid );
+        _y.resize( grid );
+        TecplotCoordinates( grid, _x, _y );
+    }
+
+    // Get the velocities, shared with other outputs of this step
+    const Scalar* u;
+    const Scalar* v;
+    DerivedFields::getVelocities( state, u, v );
+
     // Create vector of Scalar fields
     vector<const Scalar*> varVec;
-    varVec.push_back( &u );
-    varVec.push_back( &v);
+    varVec.push_back( u );
+    varVec.push_back( v );
     varVec.push_back( &state.omega );
     
     vector<string> varNameVec;
     varNameVec.push_back( "u" );
     varNameVec.push_back( "v" );
     varNameVec.push_back( "Vorticity" );
+
+    for (unsigned int n=0; n<_extraVars.size(); ++n) {
+        varVec.push_back( _extraVars[n] );
+        varNameVec.push_back( _extraNames[n] );
+    }
         
     // Write the tecplot file
     if(_TecplotAllGrids) {
+        int numLevels = grid.Ngrid();
+        if ( _maxLevels > 0 && _maxLevels < numLevels ) {
+            numLevels = _maxLevels;
+        }
         status = true;
-        for(int i=0;i < grid.Ngrid(); i++) {
+        for(int i=0;i < numLevels; i++) {
             sprintf( filename, _filename.c_str(), state.timestep, i );
             cout << filename << endl;
-            status = status && ScalarToTecplot( varVec, varNameVec, filename, title, i);
+            status = status && ScalarToTecplot( varVec, varNameVec, filename, title, i, _TecplotBinary, _region, _x, _y );
         }
     }
-    else status = ScalarToTecplot( varVec, varNameVec, filename, title );
+    else status = ScalarToTecplot( varVec, varNameVec, filename, title, 0, _TecplotBinary, _region, _x, _y );
     return status;
 }
     
@@ -81,5 +102,18 @@ void OutputTecplot::setFilename( string filename ) {
 void OutputTecplot::setTitle( string title ) {
     _title = title;
 }
+
+void OutputTecplot::setRegion( const TecplotRegion& region ) {
+    _region = region;
+}
+
+void OutputTecplot::setMaxLevels( int maxLevels ) {
+    _maxLevels = maxLevels;
+}
+
+void OutputTecplot::addScalar( const Scalar* field, string name ) {
+    _extraVars.push_back( field );
+    _extraNames.push_back( name );
+}
     
 } // namespace ibpm
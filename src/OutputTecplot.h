@@ -14,7 +14,7 @@ namespace ibpm {
 \file OutputTecplot.h
 \class OutputTecplot
 
-\brief Output routines for writing ASCII Tecplot files
+\brief Output routines for writing ASCII or binary Tecplot files
 
 \author Clancy Rowley
 \date 22 Aug 2008
@@ -30,7 +30,9 @@ public:
     /// \brief Constructor
     /// \param[in] filename Filename in the standard printf format (e.g. "file%06d.plt"), where timestep will be supplied
     /// \param[in] title Title in the standard printf format
-    OutputTecplot( string filename, string title, bool TecplotAllGrids );
+    /// \param[in] TecplotBinary If true, write Tecplot binary (TDV112) files
+    /// instead of ASCII, much faster and smaller for large grids
+    OutputTecplot( string filename, string title, bool TecplotAllGrids, bool TecplotBinary = false );
     
     /// \brief Write the Tecplot file
     bool doOutput(const State& x);
@@ -43,11 +45,36 @@ public:
     
     /// \brief Change the title for the output file
     void setTitle( string title );
-    
+
+    /// \brief Restrict the output to a spatial subset of each level
+    /// (index box and/or point stride); monitoring dumps near the body
+    /// are typically ~10x smaller than full-field snapshots
+    void setRegion( const TecplotRegion& region );
+
+    /// \brief When writing all grids, write only the finest maxLevels
+    /// levels (0 writes every level)
+    void setMaxLevels( int maxLevels );
+
+    /// \brief Append an extra scalar variable (e.g. a streamfunction
+    /// computed offline) to every file written.  The field must match
+    /// the state's grid and stay valid across doOutput calls; the
+    /// caller keeps ownership
+    void addScalar( const Scalar* field, string name );
+
 private:
     string _filename;
     string _title;
     bool _TecplotAllGrids;
+    bool _TecplotBinary;
+    TecplotRegion _region;
+    int _maxLevels;
+    // Extra variables appended to every file (see addScalar)
+    std::vector<const Scalar*> _extraVars;
+    std::vector<string> _extraNames;
+    // Coordinate staging fields, filled once (the grid is fixed during
+    // a run) and reused across output calls
+    Scalar _x;
+    Scalar _y;
 };
 
 } // namespace ibpm
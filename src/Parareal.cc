@@ -0,0 +1,143 @@
+// Parareal.cc
+//
+// Description:
+// Implementation of the Parareal class
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 30 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Parareal.h"
+#include "Threads.h"
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+
+using namespace std;
+
+namespace ibpm {
+
+Parareal::Parareal(
+    vector<IBSolver*>& fine,
+    IBSolver& coarse,
+    int stepsPerSlice,
+    int maxIterations,
+    double tol
+    ) :
+    _fine( fine ),
+    _coarse( coarse ),
+    _stepsPerSlice( stepsPerSlice ),
+    _maxIterations( maxIterations ),
+    _tol( tol ) {
+    assert( _fine.size() > 1 );
+    assert( _stepsPerSlice >= 1 );
+    // The coarse timestep must divide the slice duration, so that both
+    // propagators cover exactly one slice per sweep
+    double sliceT = _stepsPerSlice * _fine[0]->getTimestep();
+    _coarseStepsPerSlice =
+        (int) ( sliceT / _coarse.getTimestep() + 0.5 );
+    if ( _coarseStepsPerSlice < 1 ) _coarseStepsPerSlice = 1;
+    assert( fabs( _coarseStepsPerSlice * _coarse.getTimestep() - sliceT )
+        < 1e-10 * sliceT );
+    // numSlices sweeps reproduce the serial fine solution exactly
+    if ( _maxIterations < 1 || _maxIterations > numSlices() ) {
+        _maxIterations = numSlices();
+    }
+}
+
+const State& Parareal::sliceState( int n ) const {
+    assert( n >= 1 && n <= numSlices() );
+    return _U[n];
+}
+
+void Parareal::propagate(
+    IBSolver& solver,
+    int nsteps,
+    const State& x0,
+    State& x ) {
+    x = x0;
+    // Each propagation starts from an independent state, not from the
+    // trajectory the solver saw last: clear the multistep history
+    solver.reset();
+    for (int s=0; s<nsteps; ++s) {
+        solver.advance( x );
+    }
+    // Keep the bookkeeping in fine steps, whichever propagator ran
+    x.timestep = x0.timestep + _stepsPerSlice;
+    x.time = x0.time + _stepsPerSlice * _fine[0]->getTimestep();
+}
+
+int Parareal::advance( State& x ) {
+    int N = numSlices();
+    if ( (int) _U.size() != N+1 ) {
+        // Copies share x's arena copy-on-write, so this is cheap; each
+        // state detaches with private storage on its first update
+        _U.assign( N+1, x );
+        _F.assign( N, x );
+        _G.assign( N, x );
+    }
+    _U[0] = x;
+
+    // Serial coarse sweep: predict the slice-boundary states
+    for (int n=0; n<N; ++n) {
+        propagate( _coarse, _coarseStepsPerSlice, _U[n], _U[n+1] );
+        _G[n] = _U[n+1];
+    }
+
+    int sweeps = 0;
+    for (int k=1; k<=_maxIterations; ++k) {
+        sweeps = k;
+        // Slices 0..k-2 already carry the exact fine solution and their
+        // initial states no longer change: skip them
+        int n0 = k - 1;
+
+        // Fine propagation of every remaining slice, concurrently.
+        // Each slice has its own solver; the model is shared, as in the
+        // ensemble workers
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for (int n=n0; n<N; ++n) {
+            propagate( *_fine[n], _stepsPerSlice, _U[n], _F[n] );
+        }
+
+        // Serial correction sweep
+        double diffSq = 0.;
+        double normSq = 0.;
+        State Gnew;
+        for (int n=n0; n<N; ++n) {
+            propagate( _coarse, _coarseStepsPerSlice, _U[n], Gnew );
+            double* u = _U[n+1].flatten();
+            const double* g = Gnew.flatten();
+            const double* f = _F[n].flatten();
+            const double* gold = _G[n].flatten();
+            unsigned int m = _U[n+1].getSize();
+            for (unsigned int i=0; i<m; ++i) {
+                double unew = g[i] + f[i] - gold[i];
+                double d = unew - u[i];
+                diffSq += d * d;
+                normSq += unew * unew;
+                u[i] = unew;
+            }
+            _U[n+1].timestep = _F[n].timestep;
+            _U[n+1].time = _F[n].time;
+            _G[n] = Gnew;
+        }
+
+        double err = ( normSq > 0. ) ? sqrt( diffSq / normSq ) : 0.;
+        cout << "  parareal sweep " << k << ": correction " << err << endl;
+        if ( err <= _tol ) break;
+    }
+
+    x = _U[N];
+    return sweeps;
+}
+
+} // namespace ibpm
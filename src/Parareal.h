@@ -0,0 +1,90 @@
+#ifndef _PARAREAL_H_
+#define _PARAREAL_H_
+
+#include <vector>
+#include "IBSolver.h"
+#include "State.h"
+
+namespace ibpm {
+
+/*!
+    \file Parareal.h
+    \class Parareal
+
+    \brief Time-parallel (parareal) execution of a window of timesteps.
+
+    The window is split into equal slices.  A cheap coarse propagator
+    (the same equations with a larger timestep) sweeps the whole window
+    serially to predict the slice-boundary states; then, repeatedly,
+    the accurate fine propagator advances every slice concurrently from
+    the current boundary states, and a serial correction sweep updates
+    the boundaries with
+
+        U_{n+1}  <-  G(U_n) + F(U_n) - G_prev(U_n)
+
+    where F is the fine propagator over one slice and G the coarse one.
+    The iteration reproduces the serial fine solution slice by slice --
+    after k sweeps the first k slices are exact, and the leading exact
+    slices are skipped on later sweeps -- but in practice the boundary
+    corrections fall below tolerance in far fewer sweeps than there are
+    slices, and the fine propagations, which dominate the cost, run
+    numSlices at a time.
+
+    Each slice advances on its own fine solver, so multistep history
+    and conjugate-gradient warm starts never leak between slices (the
+    same arrangement as the ensemble workers); the model is shared
+    between the slices and must be stationary.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 30 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+class Parareal {
+public:
+    /// \brief Constructor.
+    /// \param[in] fine    one initialized solver per slice, advanced
+    ///                    concurrently; all must share the fine timestep
+    /// \param[in] coarse  initialized coarse propagator, whose (larger)
+    ///                    timestep must divide the slice duration
+    ///                    stepsPerSlice * dt
+    /// \param[in] stepsPerSlice  fine steps per slice
+    /// \param[in] maxIterations  parareal sweeps per window (capped at
+    ///                    the number of slices, which is always enough)
+    /// \param[in] tol     relative slice-boundary correction below which
+    ///                    the window counts as converged
+    Parareal( std::vector<IBSolver*>& fine, IBSolver& coarse,
+        int stepsPerSlice, int maxIterations, double tol );
+
+    /// \brief Advance x through one window of numSlices()*stepsPerSlice
+    /// timesteps.  Returns the number of parareal sweeps used
+    int advance( State& x );
+
+    inline int numSlices() const { return (int) _fine.size(); }
+
+    /// \brief Slice-boundary state n (1..numSlices) of the last window,
+    /// for output at slice resolution
+    const State& sliceState( int n ) const;
+
+private:
+    // Advance x0 over one slice with the given propagator, writing the
+    // result (with fine-step bookkeeping) into x
+    void propagate( IBSolver& solver, int nsteps, const State& x0,
+        State& x );
+
+    std::vector<IBSolver*>& _fine;
+    IBSolver& _coarse;
+    int _stepsPerSlice;
+    int _coarseStepsPerSlice;
+    int _maxIterations;
+    double _tol;
+    std::vector<State> _U;   // slice-boundary states, 0..numSlices
+    std::vector<State> _F;   // fine solution over each slice
+    std::vector<State> _G;   // coarse prediction at each boundary
+};
+
+} // namespace ibpm
+
+#endif /* _PARAREAL_H_ */
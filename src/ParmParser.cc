@@ -23,10 +23,7 @@ ParmParser::ParmParser(int argc, char* argv[]) :
     _argc( argc ),
     _argv( argc ),
     _used( argc ) {
-    _args = "";
     for (int i=1; i<argc; ++i) {
-        _args += argv[i];
-        _args += " ";
         _argv[i] = argv[i];
         _used[i] = false;
     }
@@ -40,6 +37,57 @@ ParmParser::ParmParser(int argc, char* argv[]) :
     }
     _usageMessage << "USAGE: " << exec << " [options]" << endl
         << "where [options] are as follows (defaults shown in [ ]):" << endl;
+    appendUsageMessage( "config", "<file>",
+        "read parameters from file; command-line values take precedence", "" );
+
+    // Append parameters from a config file (e.g. the <name>.cmd file
+    // saved by a previous run) after the command line, so that a value
+    // given on the command line shadows the one in the file
+    for (int i=1; i<_argc-1; ++i) {
+        if ( _argv[i] == "-config" ) {
+            _used[i] = true;
+            _used[i+1] = true;
+            readConfigFile( _argv[i+1] );
+            break;
+        }
+    }
+    buildIndex();
+}
+
+// Read whitespace-separated parameters from a file and append them to
+// the argument list, to be indexed by buildIndex() below
+void ParmParser::readConfigFile( string fname ) {
+    std::ifstream in( fname.c_str() );
+    if ( ! in.good() ) {
+        cerr << "Warning: cannot read config file " << fname << endl;
+        return;
+    }
+    string s;
+    bool first = true;
+    while ( in >> s ) {
+        // a saved command line begins with the executable name: skip it
+        if ( first && s[0] != '-' ) {
+            first = false;
+            continue;
+        }
+        first = false;
+        _argv.push_back( s );
+        _used.push_back( true );  // file entries need not all be queried
+        ++_argc;
+    }
+}
+
+// Index the position of each "-parm" token, one pass over the argument
+// list, so that each get call below is a map lookup instead of a scan.
+// The first occurrence wins, matching the scan order of earlier versions
+void ParmParser::buildIndex() {
+    for (int i=1; i<_argc; ++i) {
+        const string& s = _argv[i];
+        if ( s.length() > 1 && s[0] == '-' &&
+             _index.find( s ) == _index.end() ) {
+            _index[ s ] = i;
+        }
+    }
 }
 
 void ParmParser::appendUsageMessage(
@@ -65,25 +113,16 @@ void ParmParser::appendUsageMessage(
 bool ParmParser::getFlag( string flag, string description ) {
     appendUsageMessage( flag, description );
     flag = "-" + flag;
-    
-    // Make an input stream with the whole argument list
-    istringstream in;
-    in.str(_args);
-    
-    // Loop through all the command line arguments
-    int i=0;
-    string s;
-    while ( in >> s ) {
-        ++i;
-        // If the specified parameter is found
-        if ( s == flag ) {
-            _used[i] = true;
-            _argOut << " " << flag;
-            return true;
-        }
+
+    // Look up the flag in the index built at construction
+    std::map<string, int>::iterator it = _index.find( flag );
+    if ( it == _index.end() ) {
+        // If not found, return false
+        return false;
     }
-    // If not found, return false
-    return false;
+    _used[ it->second ] = true;
+    _argOut << " " << flag;
+    return true;
 }
 
 // Generic function to search for the given entry parm and return its
@@ -94,40 +133,33 @@ template<class T> T ParmParser::getParm(
     T defaultVal
     ) {
     parm = "-" + parm;
-    
-    // Make an input stream with the whole argument list
-    istringstream in;
-    in.str(_args);
-    
-    // Loop through all the command line arguments
-    int i=0;
-    string s;
-    while ( in >> s ) {
-        ++i;
-        // If the specified parameter is found
-        if ( s == parm ) {
-            // Try to get the next argument in the list as an integer
-            T val;
-            in >> val;
-            // If successful
-            if ( ! in.fail() ) {
-                _used[i] = true;
-                _used[i+1] = true;
-                // Append the argument and value to the local list
-                _argOut << " " << parm << " " << val;
-                // return the value found
-                return val;
-            }
-            else {
-                // Otherwise, print an error message and return default value
-                cerr << "Warning: cannot parse argument " << i 
-                    << ": " << parm << endl;
-                return defaultVal;
-            }
+
+    // Look up the parameter in the index built at construction
+    std::map<string, int>::iterator it = _index.find( parm );
+    if ( it == _index.end() ) {
+        // If not found, return the default value
+        return defaultVal;
+    }
+    int i = it->second;
+    if ( i+1 < _argc ) {
+        // Try to parse the next argument in the list as a value
+        istringstream in( _argv[i+1] );
+        T val;
+        in >> val;
+        // If successful
+        if ( ! in.fail() ) {
+            _used[i] = true;
+            _used[i+1] = true;
+            // Append the argument and value to the local list
+            _argOut << " " << parm << " " << val;
+            // return the value found
+            return val;
         }
     }
-    // If not found, return the default value
-    return defaultVal;        
+    // Otherwise, print an error message and return default value
+    cerr << "Warning: cannot parse argument " << i
+        << ": " << parm << endl;
+    return defaultVal;
 }
 
 #define PP_APPEND_USAGE(a) \
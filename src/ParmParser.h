@@ -1,6 +1,7 @@
 #ifndef _PARMPARSER_H_
 #define _PARMPARSER_H_
 
+#include <map>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -24,6 +25,13 @@ using std::fstream;
 
     \brief Class for parsing command-line arguments
 
+    The argument list is indexed once at construction, so each get
+    call is a map lookup rather than a scan of argv.  A "-config
+    <file>" argument appends the parameters saved in the file (e.g.
+    the ibpm.cmd written by a previous run) after the command line,
+    so command-line values shadow the file's and long sweep command
+    lines become reusable config files.
+
     \author Clancy Rowley
     \author $LastChangedBy$
     \date  4 Sep 2008
@@ -85,12 +93,15 @@ private:
         string description,
         T defaultVal
     );
-    
+    void readConfigFile( string fname );
+    void buildIndex();
+
     // data
     int _argc;
     vector<string> _argv;
     vector<bool> _used;
-    string _args;
+    // position of each "-parm" token, first occurrence winning
+    std::map<string, int> _index;
     ostringstream _argOut;
     ostringstream _usageMessage;
 };
@@ -17,7 +17,13 @@
 #include "BoundaryVector.h"
 #include "NavierStokesModel.h"
 #include "ProjectionSolver.h"
+#include "Timers.h"
+#include <assert.h>
 #include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace ibpm {
 
@@ -30,10 +36,40 @@ ProjectionSolver::ProjectionSolver(
     _beta(beta),
     _grid(grid),
     _model(model),
-    _helmholtz( grid, -beta/2. * _model.getAlpha() )
+    _helmholtz( grid, -beta/2. * _model.getAlpha() ),
+    _workspace0( grid, model.getNumPoints() ),
+    _rhs( model.getNumPoints() )
 {}
 
-ProjectionSolver::~ProjectionSolver() {}
+ProjectionSolver::~ProjectionSolver() {
+    for ( size_t t=0; t<_threadWorkspaces.size(); ++t ) {
+        delete _threadWorkspaces[t];
+    }
+}
+
+// Return the calling thread's workspace; see the note in
+// NavierStokesModel::getScratch for the locking rationale
+ProjectionSolver::Workspace& ProjectionSolver::getWorkspace() {
+#ifdef _OPENMP
+    int t = omp_get_thread_num();
+    if ( t > 0 ) {
+        Workspace* w;
+#pragma omp critical(ibpm_projsolver_workspace)
+        {
+            if ( t >= (int) _threadWorkspaces.size() ) {
+                _threadWorkspaces.resize( t + 1, (Workspace*) NULL );
+            }
+            if ( _threadWorkspaces[t] == NULL ) {
+                _threadWorkspaces[t] =
+                    new Workspace( _grid, _model.getNumPoints() );
+            }
+            w = _threadWorkspaces[t];
+        }
+        return *w;
+    }
+#endif
+    return _workspace0;
+}
 
 // Initialization for this base class done in constructor
 // Subclasses use this for their own initialization, if needed
@@ -45,6 +81,39 @@ void ProjectionSolver::init() {}
 bool ProjectionSolver::save(const std::string& filename) { return false; }
 bool ProjectionSolver::load(const std::string& filename) { return false; }
 
+// Per-run iteration state, embedded in integration-history records
+// (see IBSolver::saveHistory).  The record is two counts -- boundary
+// vectors stored, then trailing metadata doubles -- followed by that
+// much data, so any solver can skip the record of any other.  Direct
+// solvers store nothing
+bool ProjectionSolver::saveRunState( FILE* fp ) {
+    int count = 0;
+    fwrite( &count, sizeof( int ), 1, fp );
+    fwrite( &count, sizeof( int ), 1, fp );
+    return true;
+}
+
+bool ProjectionSolver::loadRunState( FILE* fp ) {
+    int count, meta;
+    if ( fread( &count, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( fread( &meta, sizeof( int ), 1, fp ) != 1 ) return false;
+    size_t n = (size_t) XY * _model.getNumPoints();
+    std::vector<double> skip( n > 0 ? n : 1 );
+    for (int k=0; k<count; ++k) {
+        if ( fread( &skip[0], sizeof( double ), n, fp ) != n ) {
+            return false;
+        }
+    }
+    double d;
+    for (int k=0; k<meta; ++k) {
+        if ( fread( &d, sizeof( double ), 1, fp ) != 1 ) return false;
+    }
+    return true;
+}
+
+// Iterative subclasses override this; direct solvers have no tolerance
+void ProjectionSolver::setTolerance( double tolerance ) {}
+
 
 // Solve for omega and f for a system of the form
 //   A omega + B f = a
@@ -60,43 +129,56 @@ void ProjectionSolver::solve(
     Scalar& omega,
     BoundaryVector& f
     ) {
-    
-    // A omega^* = a
-    Scalar omegaStar( a.getGrid() );
-    Ainv( a, omegaStar );
-    
+    // omega doubles as the workspace for omega^*: the right-hand side a
+    // already contains the previous vorticity, so the value of omega on
+    // entry is never an input here
+    assert( &a != &omega );
+
+    // A omega^* = a, solved directly into the output field
+    Ainv( a, omega );
+
     // C A^{-1}B f = C omega^* - b
-    BoundaryVector rhs( f.getNumPoints() );
-    C( omegaStar, rhs );
-    rhs -= b;               // rhs = C omega^* - b
-    Minv( rhs, f );         // f = Minv( rhs )
-
-    // omega = omega^* - A^{-1} B f
-    Scalar c( a.getGrid() );
-    B( f, c );              // c = Bf
-    Ainv( c, c );           // c = Ainv(Bf)
-    omega = omegaStar - c;
+    C( omega, _rhs );
+    _rhs -= b;              // rhs = C omega^* - b
+    {
+        ScopedTimer timer( Timers::MINV );
+        Minv( _rhs, f );    // f = Minv( rhs )
+    }
+
+    // omega = omega^* - A^{-1} B f, with the correction formed in the
+    // preallocated workspace (Minv is done with it by this point)
+    Scalar& u = getWorkspace().u;
+    B( f, u );              // u = Bf
+    Ainv( u, u );           // u = Ainv(Bf)
+    omega -= u;
 }
     
 void ProjectionSolver::Ainv(const Scalar& x, Scalar& y) {
+    ScopedTimer timer( Timers::AINV );
     _helmholtz.solve( x, y );
 }
-    
+
 void ProjectionSolver::B(const BoundaryVector& f, Scalar& y) {
-    _model.B( f, y );
-    y *= _beta;
+    ScopedTimer timer( Timers::B_OP );
+    // Scale the (small) boundary force by beta before smearing it onto the
+    // grid, rather than scaling the full-grid result afterwards
+    BoundaryVector& fScaled = getWorkspace().fScaled;
+    fScaled = f;
+    fScaled *= _beta;
+    _model.B( fScaled, y );
 }
 
 
 void ProjectionSolver::C(const Scalar& x, BoundaryVector& y ) {
+    ScopedTimer timer( Timers::C_OP );
     _model.C( x, y );
 }
 
 // Compute y = M(f), where M = C A^{-1} B
 void ProjectionSolver::M(const BoundaryVector& f, BoundaryVector& y ) {
-    Scalar u( _grid );
+    Scalar& u = getWorkspace().u;
     B( f, u );          // u = B f
-    Ainv( u, u );       // u = Ainv B f
+    Ainv( u, u );       // u = Ainv B f  (solved in place)
     C( u, y );          // y = C Ainv B f
 }    
 
@@ -5,7 +5,9 @@
 #include "BoundaryVector.h"
 #include "NavierStokesModel.h"
 #include "EllipticSolver.h"
+#include <stdio.h>
 #include <string>
+#include <vector>
 using std::string;
 
 namespace ibpm {
@@ -76,7 +78,23 @@ public:
     /// Can be used in place of init() (if successful)
     /// Return true if successful
     virtual bool load(const string& basename);
-    
+
+    /// \brief Write this solver's per-run iteration state (warm
+    /// starts, recycled subspaces) at the current position of an open
+    /// file, as part of an integration-history record (see
+    /// IBSolver::saveHistory).  Distinct from save(), which stores the
+    /// precomputed operators.  The default writes an empty record:
+    /// direct solvers carry no per-run state
+    virtual bool saveRunState( FILE* fp );
+
+    /// \brief Read the per-run iteration state written by saveRunState
+    virtual bool loadRunState( FILE* fp );
+
+    /// \brief Set the convergence tolerance for iterative solvers.
+    /// Direct solvers ignore it, so callers (e.g. the tolerance schedule
+    /// in IBSolver) may set it unconditionally
+    virtual void setTolerance( double tolerance );
+
     /*! \brief Solve for \a omega and \a f using a fractional step method.
     Solves equations (1-2) using the algorithm (3-5).
     
@@ -123,6 +141,24 @@ private:
     const Grid _grid;
 	const NavierStokesModel& _model;
     HelmholtzSolver _helmholtz;
+    // Workspaces for M, preallocated so that each application of M (many
+    // per timestep, for the iterative solvers) allocates no grid-sized
+    // data.  Slot 0 serves all serial calls; further slots are created
+    // on first use by the corresponding OpenMP worker, mirroring the
+    // per-thread scratch of NavierStokesModel, so the parallel column
+    // assembly in CholeskySolver may apply M concurrently
+    struct Workspace {
+        Scalar u;
+        BoundaryVector fScaled;
+        Workspace( const Grid& grid, int numPoints ) :
+            u( grid ), fScaled( numPoints ) {}
+    };
+    Workspace& getWorkspace();
+    Workspace _workspace0;
+    std::vector<Workspace*> _threadWorkspaces;
+    // Workspace for the constraint right-hand side in solve(), kept
+    // across solves for the same reason (solve is never concurrent)
+    BoundaryVector _rhs;
 };
 
 } // namespace ibpm
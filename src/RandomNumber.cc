@@ -0,0 +1,65 @@
+// RandomNumber.cc
+//
+// Description:
+// Counter-based random field initialization (see CounterRandom in
+// RandomNumber.h): each element's value is a pure function of the seed
+// and the element's index, so the fills run threaded and are bitwise
+// reproducible for any thread count.
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 29 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "RandomNumber.h"
+#include "Scalar.h"
+#include "BoundaryVector.h"
+#include "Grid.h"
+#include "Threads.h"
+
+namespace ibpm {
+
+void RandomizeScalar( Scalar& f, Ullong seed ) {
+    const Grid& grid = f.getGrid();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int ngrid = grid.Ngrid();
+    CounterRandom rng( seed );
+
+    for (int lev=0; lev<ngrid; ++lev) {
+        // Counter of node (lev,i,j), counting all (nx+1)(ny+1) nodes
+        // of each level so the indexing is independent of which nodes
+        // are filled
+        Ullong base = (Ullong) lev * ( nx + 1 ) * ( ny + 1 );
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+        for (int j=1; j<ny; ++j) {
+            for (int i=1; i<nx; ++i) {
+                f(lev,i,j) = rng.getSymmetric(
+                    base + (Ullong) i * ( ny + 1 ) + j );
+            }
+        }
+    }
+}
+
+void RandomizeBoundaryVector( BoundaryVector& f, Ullong seed ) {
+    int n = f.getNumPoints();
+    CounterRandom rng( seed );
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+    for (int i=0; i<n; ++i) {
+        f(X,i) = rng.getSymmetric( 2 * (Ullong) i );
+        f(Y,i) = rng.getSymmetric( 2 * (Ullong) i + 1 );
+    }
+}
+
+} // namespace ibpm
@@ -1,3 +1,6 @@
+#ifndef _RANDOMNUMBER_H_
+#define _RANDOMNUMBER_H_
+
 // Random number generator adapted from Numerical Recipes
 #include <iostream>
 
@@ -9,33 +12,90 @@ class RandomNumber {
 public:
     // Constructor. Call with any integer seed (except value of v above).
     RandomNumber( ) :
-    v(4101842887655102017LL), 
+    v(4101842887655102017LL),
     w(1),
-    j( time(0) ) {      // Seed with current time (random seed)     
-        u = j ^ v; 
-        getLongInt(); 
-        v = u; 
-        getLongInt(); 
-        w = v; 
-        getLongInt(); 
-    }  
-
-    // Return 64-bit random integer. 
-    inline Ullong getLongInt() {     
-        u = u * 2862933555777941757LL + 7046029254386353087LL; 
-        v ^= v >> 17; v ^= v << 31; v ^= v >> 8; 
-        w = 4294957665U*(w & 0xffffffff) + (w >> 32); 
-        Ullong x = u ^ (u << 21); x ^= x >> 35; x ^= x << 4; 
-        return (x + v) ^ w; 
-    } 
+    j( time(0) ) {      // Seed with current time (random seed)
+        u = j ^ v;
+        getLongInt();
+        v = u;
+        getLongInt();
+        w = v;
+        getLongInt();
+    }
+
+    // Return 64-bit random integer.
+    inline Ullong getLongInt() {
+        u = u * 2862933555777941757LL + 7046029254386353087LL;
+        v ^= v >> 17; v ^= v << 31; v ^= v >> 8;
+        w = 4294957665U*(w & 0xffffffff) + (w >> 32);
+        Ullong x = u ^ (u << 21); x ^= x >> 35; x ^= x << 4;
+        return (x + v) ^ w;
+    }
 
     // Return random double-precision ﬂoating value in the range 0. to 1.
-    inline Doub getDouble() { return 5.42101086242752217E-20 * getLongInt(); } 
+    inline Doub getDouble() { return 5.42101086242752217E-20 * getLongInt(); }
 
-    // Return 32-bit random integer.  
-    inline Uint getInt() { return (Uint)getLongInt(); } 
+    // Return 32-bit random integer.
+    inline Uint getInt() { return (Uint)getLongInt(); }
 
 private:
     Ullong u, v, w;
     Ullong j;           // initial seed
 };
+
+// Counter-based generator: the value at counter n is a pure function
+// of (seed, n), with no state carried between calls, so any subset of
+// the stream can be generated in any order and in parallel, and the
+// result is bitwise identical for any thread count.  The mixing is
+// two rounds of a 64-bit multiply-xorshift finalizer (in the spirit
+// of Philox: a keyed bijection of the counter)
+class CounterRandom {
+public:
+    CounterRandom( Ullong seed ) : _seed( seed ) {}
+
+    // Return the 64-bit random integer at counter n
+    inline Ullong getLongInt( Ullong n ) const {
+        Ullong x = n + _seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL;
+        x ^= x >> 30;  x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;  x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        x ^= x >> 33;  x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;  x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // Return the random double in the range 0. to 1. at counter n
+    inline Doub getDouble( Ullong n ) const {
+        return 5.42101086242752217E-20 * getLongInt( n );
+    }
+
+    // Return the random double in the range -1. to 1. at counter n
+    inline Doub getSymmetric( Ullong n ) const {
+        return 2. * getDouble( n ) - 1.;
+    }
+
+private:
+    Ullong _seed;
+};
+
+namespace ibpm {
+
+class Scalar;
+class BoundaryVector;
+
+/// \brief Fill the (interior) nodes of f on every level with uniform
+/// random values in (-1,1) (e.g. perturbation vorticity fields for
+/// transition studies or randomized resolvent sketches).  Each node's
+/// value is a pure function of the seed and the node's (lev,i,j)
+/// index, generated in parallel over rows, so the field is bitwise
+/// reproducible for any thread count
+void RandomizeScalar( Scalar& f, Ullong seed );
+
+/// \brief Fill both components of f with uniform random values in
+/// (-1,1), indexed by component and point as for RandomizeScalar
+void RandomizeBoundaryVector( BoundaryVector& f, Ullong seed );
+
+} // namespace ibpm
+
+#endif /* _RANDOMNUMBER_H_ */
@@ -15,20 +15,27 @@
 
 #include "Regularizer.h"
 #include "Grid.h"
+#include "Kernels.h"
+#include "Threads.h"
+#include "Timers.h"
 #include "Geometry.h"
 #include "Flux.h"
 #include <vector>
+#include <algorithm>
 #include <math.h>
 
 namespace ibpm {
 
-Regularizer::Regularizer(const Grid& grid, const Geometry& geometry) :
+Regularizer::Regularizer(const Grid& grid, const Geometry& geometry,
+                         DeltaKernel kernel) :
     _grid(grid),
-    _geometry(geometry)
+    _geometry(geometry),
+    _kernel(kernel)
 {}
 
-// number of cells over which delta function has support
-const double deltaSupportRadius = 1.5;
+// number of cells over which each delta kernel has support
+const double romaSupportRadius = 1.5;
+const double linearSupportRadius = 1.;
 
 // Return the value of the regularized delta function phi(r)
 // where delta(x) \approx phi(x/h) / h, where h is the grid spacing
@@ -36,8 +43,8 @@ const double deltaSupportRadius = 1.5;
 // From Roma, Peskin, and Berger, JCP 1999, eq (22)
 // Note that the input r is given in numbers of cells
 // (e.g. normalized by the cell width)
-inline double deltaFunction(double r) {
-    if (r > deltaSupportRadius) {
+inline double deltaFunctionRoma(double r) {
+    if (r > romaSupportRadius) {
         return 0;
     }
     else {
@@ -48,84 +55,288 @@ inline double deltaFunction(double r) {
     }
 }
 
-// Update list of relationships between boundary points and cells, and the
-// corresponding weights
+// Narrower 2-cell hat kernel: piecewise-linear interpolation weights.
+// Two-thirds the support of the Roma kernel in each direction, so four
+// nonzero weights per boundary point and direction instead of nine, and
+// a correspondingly sparser M matrix; only C^0, so reserved for cases
+// where that accuracy suffices
+inline double deltaFunctionLinear(double r) {
+    if (r > linearSupportRadius) {
+        return 0;
+    }
+    return 1. - r;
+}
+
+double Regularizer::deltaSupport() const {
+    return ( _kernel == DELTA_LINEAR ) ? linearSupportRadius
+                                       : romaSupportRadius;
+}
+
+double Regularizer::delta( double r ) const {
+    return ( _kernel == DELTA_LINEAR ) ? deltaFunctionLinear( r )
+                                       : deltaFunctionRoma( r );
+}
+
+// Order associations by flux index, for building the smearing rows.
+// The sort used is stable, so entries within a row stay ordered by
+// boundary point
+bool Regularizer::fluxIndexLessThan(
+    const Association& a,
+    const Association& b
+    ) {
+    return a.fluxIndex < b.fluxIndex;
+}
+
+// Update the association weights between boundary points and cells, and
+// repack them into the sparse rows used by toFlux and toBoundary.
+// Only bodies whose points have changed since the last update (per-body
+// dirty flags, set by RigidBody::moveBody) are recomputed: in multi-body
+// cases where one small body moves, the weights for the stationary
+// bodies are reused unchanged.
 // Checks only the finest grid level, level=0
 void Regularizer::update() {
+    int numBodies = _geometry.getNumBodies();
+
+    // If the set of bodies has changed, discard all cached weights
+    if ( (int) _bodyNeighbors.size() != numBodies ) {
+        _bodyNeighbors.clear();
+        _bodyNeighbors.resize( numBodies );
+    }
+
+    // Assemble the cached point vector once, before the loop below reads
+    // per-body spans of it concurrently
+    _geometry.getPoints();
+
+    // Collect the bodies whose weights need recomputing, with their
+    // point offsets
+    vector<int> stale;
+    vector<int> staleOffset;
+    int pointOffset = 0;
+    for (int b = 0; b < numBodies; ++b) {
+        const RigidBody& body = _geometry.getBody(b);
+        if ( _bodyNeighbors[b].empty() || body.hasMoved() ) {
+            stale.push_back( b );
+            staleOffset.push_back( pointOffset );
+        }
+        body.clearMoved();
+        pointOffset += body.getNumPoints();
+    }
+
+    // Each stale body's weights go into its own association list, so the
+    // bodies are recomputed concurrently; dynamic scheduling lets the
+    // small elements of a multi-body configuration finish without
+    // waiting behind the largest one
+    int numStale = stale.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 && numStale > 1 )
+#endif
+    for (int k = 0; k < numStale; ++k) {
+        updateBody( stale[k], staleOffset[k] );
+    }
+    // If every body's weights were reused, the packed rows are current too
+    if ( numStale > 0 ) packRows();
+}
+
+// Recompute the association list for a single body.
+// Note that a body with no points within the delta function's support
+// radius of any flux cell cannot occur (every point is within a cell of
+// some edge), so an empty list always denotes a body not yet seen.
+void Regularizer::updateBody( int bodyIndex, int pointOffset ) {
     Direction dir;
     Flux f(_grid);
     int i;
-    Flux::index j;
     double dx, dy;
     double h = _grid.Dx();  // mesh spacing
     Association a;
+    int numPoints = _geometry.getNumPoints();
+    int nx = _grid.Nx();
+    int ny = _grid.Ny();
+    double xOffset = _grid.getXEdge(0,0);
+    double yOffset = _grid.getYEdge(0,0);
+    double support = deltaSupport();
 
-    // Clear the list of associated Flux and BoundaryVector points
-    _neighbors.clear();
+    vector<Association>& neighbors = _bodyNeighbors[bodyIndex];
+    neighbors.clear();
 
-    // Get the coordinates of the body
-    BoundaryVector bodyCoords = _geometry.getPoints();
+    // This body's span of the geometry's cached assembled point vector
+    const BoundaryVector& coords = _geometry.getPoints();
+    int numBodyPoints = _geometry.getBody(bodyIndex).getNumPoints();
 
+    // Find all associated Flux and BoundaryVector points, ordered by
+    // boundary index (the loops below visit boundary points in order).
+    // The grid is uniform, so the edges within the delta function's
+    // support of a point are found directly by index arithmetic: each
+    // point visits only an O(1) window of edges, rather than scanning
+    // every edge on the finest grid.
     // For each direction (x and y)
     for (dir = X; dir <= Y; ++dir) {
-        // For each point on the boundary
-        for (i = 0; i < bodyCoords.getNumPoints(); ++i) {
-            // For each cell
-            for (j = f.begin(dir); j != f.end(dir); ++j) {
-                // Find x and y distances between boundary point and cell
-                dx = fabs(f.x(0,j) - bodyCoords(X,i)) / h;
-                dy = fabs(f.y(0,j) - bodyCoords(Y,i)) / h;
-                // If cell is within the radius of support of delta function
-                if ((dx < deltaSupportRadius) && (dy < deltaSupportRadius)) {
-                    // Compute the weight factor
-                    a.weight = deltaFunction(dx) * deltaFunction(dy);
-                    a.fluxIndex = j;
-                    a.boundaryIndex = bodyCoords.getIndex(dir,i);
-                    // Add to list of associated cells
-                    _neighbors.push_back(a);
+        // Index ranges of the edges carrying this flux component
+        int iMax = (dir == X) ? nx : nx-1;
+        int jMax = (dir == X) ? ny-1 : ny;
+        // For each point on this body
+        for (i = 0; i < numBodyPoints; ++i) {
+            // Position of the point, in cells from the grid corner
+            double xb = ( coords(X,pointOffset+i) - xOffset ) / h;
+            double yb = ( coords(Y,pointOffset+i) - yOffset ) / h;
+            // Conservative window of edges within the support radius,
+            // padded by a cell; the exact test below filters the extras
+            int iLo = (int) floor( xb - support ) - 1;
+            int iHi = (int) ceil( xb + support ) + 1;
+            int jLo = (int) floor( yb - support ) - 1;
+            int jHi = (int) ceil( yb + support ) + 1;
+            if (iLo < 0) iLo = 0;
+            if (iHi > iMax) iHi = iMax;
+            if (jLo < 0) jLo = 0;
+            if (jHi > jMax) jHi = jMax;
+            // For each cell in the window
+            for (int ci = iLo; ci <= iHi; ++ci) {
+                for (int cj = jLo; cj <= jHi; ++cj) {
+                    // Find x and y distances between boundary point and cell
+                    dx = fabs(f.x(0,dir,ci) - coords(X,pointOffset+i)) / h;
+                    dy = fabs(f.y(0,dir,cj) - coords(Y,pointOffset+i)) / h;
+                    // If cell is within the radius of support of delta function
+                    if ((dx < support) && (dy < support)) {
+                        // Compute the weight factor
+                        a.weight = delta(dx) * delta(dy);
+                        a.fluxIndex = f.getIndex(dir, ci, cj);
+                        // Index into the geometry's global point numbering
+                        a.boundaryIndex = dir * numPoints + pointOffset + i;
+                        // Add to list of associated cells
+                        neighbors.push_back(a);
+                    }
                 }
             }
         }
     }
 }
 
-Flux Regularizer::toFlux(const BoundaryVector& u1) const {
-    // Allocate a new Flux field, initialized to zero
-    Flux u2(_grid);
-    u2 = 0;
+// Repack the per-body association lists into the sparse rows used by
+// toFlux and toBoundary
+void Regularizer::packRows() {
+    int numBodies = _bodyNeighbors.size();
+    int numEntries = 0;
+    for (int b = 0; b < numBodies; ++b) {
+        numEntries += _bodyNeighbors[b].size();
+    }
 
-    // For each association between cells and boundary points
-    vector<Association>::const_iterator a;
-    for (a = _neighbors.begin(); a != _neighbors.end(); ++a) {
-        // add the weight factor times the boundary value to the flux
-        u2(0,a->fluxIndex) += a->weight * u1(a->boundaryIndex);
+    // Gather all associations into a single list
+    vector<Association> neighbors;
+    neighbors.reserve( numEntries );
+    for (int b = 0; b < numBodies; ++b) {
+        neighbors.insert( neighbors.end(),
+            _bodyNeighbors[b].begin(), _bodyNeighbors[b].end() );
     }
 
-    // Multiply by grid spacing for correct dimension (vector -> Flux)
-    u2 *= _grid.Dx();
+    // Pack the interpolation rows, one (possibly empty) row per boundary
+    // degree of freedom.  Each row draws its entries from a single body's
+    // list, in flux-index order, so filling rows through a cursor keeps
+    // the entries within each row ordered
+    int numBoundaryRows = 2 * _geometry.getNumPoints();
+    _interpRowStart.assign( numBoundaryRows + 1, 0 );
+    _interpFluxIndex.resize( numEntries );
+    _interpWeight.resize( numEntries );
+    for (int k = 0; k < numEntries; ++k) {
+        ++_interpRowStart[ neighbors[k].boundaryIndex + 1 ];
+    }
+    for (int b = 0; b < numBoundaryRows; ++b) {
+        _interpRowStart[b+1] += _interpRowStart[b];
+    }
+    vector<int> cursor( _interpRowStart.begin(), _interpRowStart.end() - 1 );
+    for (int k = 0; k < numEntries; ++k) {
+        int pos = cursor[ neighbors[k].boundaryIndex ]++;
+        _interpFluxIndex[pos] = neighbors[k].fluxIndex;
+        _interpWeight[pos] = neighbors[k].weight;
+    }
+
+    // Pack the smearing rows: reorder by flux index, keeping only the
+    // flux cells actually touched
+    std::stable_sort( neighbors.begin(), neighbors.end(), fluxIndexLessThan );
+    _smearFluxIndex.clear();
+    _smearRowStart.clear();
+    _smearBoundaryIndex.resize( numEntries );
+    _smearWeight.resize( numEntries );
+    for (int k = 0; k < numEntries; ++k) {
+        if ( _smearFluxIndex.empty() ||
+             _smearFluxIndex.back() != neighbors[k].fluxIndex ) {
+            _smearFluxIndex.push_back( neighbors[k].fluxIndex );
+            _smearRowStart.push_back( k );
+        }
+        _smearBoundaryIndex[k] = neighbors[k].boundaryIndex;
+        _smearWeight[k] = neighbors[k].weight;
+    }
+    _smearRowStart.push_back( numEntries );
+}
 
-    // Return the new flux field
+Flux Regularizer::toFlux(const BoundaryVector& u1) const {
+    // Allocate a new Flux field and fill it in
+    Flux u2(_grid);
+    toFlux( u1, u2 );
     return u2;
 }
 
-BoundaryVector Regularizer::toBoundary(const Flux& u2) const {
-    // Allocate a new BoundaryVector, initialized to zero
-    BoundaryVector u1(_geometry.getNumPoints());
-    u1 = 0;
+void Regularizer::toFlux(const BoundaryVector& u1, Flux& u2) const {
+    ScopedTimer timer( Timers::SMEAR );
+    Timers::bump( Timers::SMEAR_CALLS );
+    u2 = 0;
 
-    // For each association between cells and boundary points
-    vector<Association>::const_iterator a;
-    for (a = _neighbors.begin(); a != _neighbors.end(); ++a) {
-        // Add the weight factor times the flux value to the boundary
-        u1(a->boundaryIndex) += a->weight * u2(0,a->fluxIndex);
+    // For each flux cell touched by the delta functions, accumulate the
+    // weighted boundary values, streaming through the weights in order.
+    // Each row writes a distinct flux entry, so the rows partition the
+    // writes without conflicts and may be shared among threads; the
+    // gathers in the inner loop are left to the compiler to vectorize.
+    // Multiply by grid spacing for correct dimension (vector -> Flux)
+    double dx = _grid.Dx();
+    int numRows = _smearFluxIndex.size();
+    if ( numRows == 0 ) return;
+    // Flat view of the boundary values: X block followed by Y block,
+    // matching the indices stored in the rows
+    const double* u1flat = u1.component(X);
+    const double* weight = &_smearWeight[0];
+    const int* boundaryIndex = &_smearBoundaryIndex[0];
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+    for (int r = 0; r < numRows; ++r) {
+        double sum = Kernels::RowDot( weight, boundaryIndex, u1flat,
+                                      _smearRowStart[r], _smearRowStart[r+1] );
+        u2(0, _smearFluxIndex[r]) = sum * dx;
     }
+}
 
-    // Divide by grid spacing for correct dimension (Flux -> vector)
-    u1 /= _grid.Dx();    
-
-    // Return the new BoundaryVector
+BoundaryVector Regularizer::toBoundary(const Flux& u2) const {
+    // Allocate a new BoundaryVector and fill it in
+    BoundaryVector u1(_geometry.getNumPoints());
+    toBoundary( u2, u1 );
     return u1;
 }
 
+void Regularizer::toBoundary(const Flux& u2, BoundaryVector& u1) const {
+    ScopedTimer timer( Timers::INTERP );
+    Timers::bump( Timers::INTERP_CALLS );
+    // For each boundary degree of freedom, accumulate the weighted flux
+    // values, streaming through the weights in order.
+    // Each row writes a distinct boundary entry, so the rows may be
+    // shared among threads, each gathering from the flux field.
+    // Divide by grid spacing for correct dimension (Flux -> vector)
+    double dx = _grid.Dx();
+    int numRows = _interpRowStart.size() - 1;
+    if ( numRows == 0 ) return;
+    const double* u2flat = u2.flatten(0);
+    const double* weight = _interpWeight.empty() ? NULL : &_interpWeight[0];
+    const int* fluxIndex =
+        _interpFluxIndex.empty() ? NULL : &_interpFluxIndex[0];
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+    for (int b = 0; b < numRows; ++b) {
+        double sum = Kernels::RowDot( weight, fluxIndex, u2flat,
+                                      _interpRowStart[b], _interpRowStart[b+1] );
+        u1(b) = sum / dx;
+    }
+}
+
 } // namespace
 
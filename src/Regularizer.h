@@ -40,6 +40,12 @@ These integrals are discretized using a regularized version of the delta
 function, with finite support, as in (14) of Taira & Colonius (J Comput Phys,
 2007).
 
+The discrete delta kernel is selectable at construction.  The support
+width directly sets the number of nonzero weights per boundary point in
+toFlux and toBoundary, and hence the density of the M matrix factored by
+CholeskySolver, so the narrower kernel cuts both transfer and
+factorization cost where its lower smoothness suffices.
+
 \author Clancy Rowley
 \author $LastChangedBy$
 \date  7 Jul 2008
@@ -49,13 +55,24 @@ function, with finite support, as in (14) of Taira & Colonius (J Comput Phys,
 
 class Regularizer {
 public:
+    /// Discrete delta kernels available for the regularization
+    enum DeltaKernel {
+        DELTA_ROMA,     ///< 3-cell support; Roma, Peskin & Berger (default)
+        DELTA_LINEAR    ///< 2-cell hat: fewer nonzeros, lower smoothness
+    };
+
     /// Constructor
-    Regularizer(const Grid& grid, const Geometry& geometry);
-    
+    Regularizer(const Grid& grid, const Geometry& geometry,
+                DeltaKernel kernel = DELTA_ROMA);
+
     /// Destructor
     ~Regularizer() {}
     
-    /// Update operators, for instance when the position of the bodies changes
+    /// \brief Update operators, for instance when the position of the
+    /// bodies changes.
+    /// Only bodies that have moved since the last call (or have not been
+    /// seen yet) have their weights recomputed; the weights of stationary
+    /// bodies are reused
     void update();
     
     /// \brief Smear boundary data to grid.
@@ -68,6 +85,10 @@ public:
     /// or u2 * dx
     Flux toFlux(const BoundaryVector& u) const;
 
+    /// \brief Smear boundary data to grid, writing the result into a
+    /// preallocated Flux, to avoid allocating grid-sized data in inner loops
+    void toFlux(const BoundaryVector& u1, Flux& u2) const;
+
     /// \brief Interpolate grid data to boundary.
     /// In particular, if q denotes fluxes in the 2D domain, compute
     /// corresponding velocities u2 = q / dx, and define velocities u1 at
@@ -76,9 +97,17 @@ public:
     ///      \approx \sum u2(\xi,\eta) \delta(x-\xi) \delta(y-\eta) * dx^2
     BoundaryVector toBoundary(const Flux& u) const;
 
+    /// \brief Interpolate grid data to a preallocated BoundaryVector
+    void toBoundary(const Flux& u2, BoundaryVector& u1) const;
+
 private:
     const Grid& _grid;
     const Geometry& _geometry;
+    DeltaKernel _kernel;
+
+    // Radius of support (in cells) and value of the selected delta kernel
+    double deltaSupport() const;
+    double delta( double r ) const;
 
     // Associations between BoundaryVector points and nearby Flux values
     struct Association {
@@ -86,8 +115,38 @@ private:
         Flux::index fluxIndex;
         double weight;
     };
-    
-    vector<Association> _neighbors;
+
+    // Order associations by flux index, for building the smearing rows
+    static bool fluxIndexLessThan( const Association& a, const Association& b );
+
+    // Recompute the association list for a single body, whose points start
+    // at the given offset in the geometry's global point numbering
+    void updateBody( int bodyIndex, int pointOffset );
+
+    // Repack the per-body association lists into the sparse rows below
+    void packRows();
+
+    // Cached association lists, one per RigidBody, so that update() can
+    // rebuild only the bodies that have moved
+    vector< vector<Association> > _bodyNeighbors;
+
+    // The association weights are stored in compressed sparse row form,
+    // once ordered for each direction of application, so that both toFlux
+    // and toBoundary stream linearly through contiguous weight arrays.
+    //
+    // Smearing (boundary -> flux): one row per flux cell touched by the
+    // delta functions; row r holds the weights for flux index
+    // _smearFluxIndex[r], in entries [_smearRowStart[r], _smearRowStart[r+1])
+    vector<Flux::index> _smearFluxIndex;
+    vector<int> _smearRowStart;
+    vector<BoundaryVector::index> _smearBoundaryIndex;
+    vector<double> _smearWeight;
+
+    // Interpolation (flux -> boundary): one row per boundary degree of
+    // freedom; row b holds entries [_interpRowStart[b], _interpRowStart[b+1])
+    vector<int> _interpRowStart;
+    vector<Flux::index> _interpFluxIndex;
+    vector<double> _interpWeight;
 };
 
 } // namespace ibpm
@@ -0,0 +1,347 @@
+// Resolvent.cc
+//
+// Description:
+// Implementation of the ResolventSolver class
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Resolvent.h"
+#include "Grid.h"
+#include "NavierStokesModel.h"
+#include "IBSolver.h"
+#include "State.h"
+#include "VectorOperations.h"
+#include "ScalarToTecplot.h"
+#include "RandomNumber.h"
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+
+namespace ibpm {
+
+ResolventSolver::ResolventSolver(
+    Grid& grid,
+    NavierStokesModel& model,
+    IBSolver& forward,
+    IBSolver& adjoint,
+    double dt,
+    const string& outputBasename
+    ) :
+    _grid( grid ),
+    _model( model ),
+    _forward( forward ),
+    _adjoint( adjoint ),
+    _dt( dt ),
+    _basename( outputBasename ) {
+}
+
+// Complex inner product <a,b> = a^H b of two complex vorticity fields,
+// each stored as a (real, imaginary) pair of Scalars
+static void innerProductC( const Scalar& ar, const Scalar& ai,
+    const Scalar& br, const Scalar& bi, double& re, double& im ) {
+    re = InnerProduct( ar, br ) + InnerProduct( ai, bi );
+    im = InnerProduct( ar, bi ) - InnerProduct( ai, br );
+}
+
+// Orthonormalize a block of complex fields in place by modified
+// Gram-Schmidt.  Columns that lose essentially all their norm to the
+// preceding ones are zeroed
+static void orthonormalize( vector<Scalar>& re, vector<Scalar>& im ) {
+    int k = re.size();
+    for ( int j = 0; j < k; ++j ) {
+        for ( int i = 0; i < j; ++i ) {
+            double cr, ci;
+            innerProductC( re[i], im[i], re[j], im[j], cr, ci );
+            // (re,im)_j -= (cr + i ci) * (re,im)_i
+            re[j] -= cr * re[i];
+            re[j] += ci * im[i];
+            im[j] -= cr * im[i];
+            im[j] -= ci * re[i];
+        }
+        double norm2, dummy;
+        innerProductC( re[j], im[j], re[j], im[j], norm2, dummy );
+        double norm = sqrt( norm2 );
+        if ( norm > 1e-12 ) {
+            re[j] *= 1. / norm;
+            im[j] *= 1. / norm;
+        }
+        else {
+            re[j] = 0.;
+            im[j] = 0.;
+        }
+    }
+}
+
+// Classical cyclic Jacobi eigensolver for a symmetric n x n matrix A
+// (column-major), accumulating the eigenvectors in V.  n here is twice
+// the sketch size, so this is microseconds
+static void jacobiEigen( vector<double>& A, vector<double>& V, int n ) {
+    const int MAX_SWEEPS = 50;
+    const double eps = 1e-14;
+    for ( int j = 0; j < n; ++j ) {
+        for ( int i = 0; i < n; ++i ) {
+            V[j*n + i] = ( i == j ) ? 1. : 0.;
+        }
+    }
+    for ( int sweep = 0; sweep < MAX_SWEEPS; ++sweep ) {
+        double off = 0.;
+        double diag = 0.;
+        for ( int j = 0; j < n; ++j ) {
+            diag += fabs( A[j*n + j] );
+            for ( int i = 0; i < j; ++i ) off += fabs( A[j*n + i] );
+        }
+        if ( off <= eps * ( diag + off ) ) break;
+        for ( int p = 0; p < n - 1; ++p ) {
+            for ( int q = p + 1; q < n; ++q ) {
+                double apq = A[q*n + p];
+                if ( fabs( apq ) <= eps * diag / n ) continue;
+                double app = A[p*n + p];
+                double aqq = A[q*n + q];
+                double zeta = ( aqq - app ) / ( 2. * apq );
+                double t = ( zeta >= 0. ? 1. : -1. )
+                    / ( fabs( zeta ) + sqrt( 1. + zeta * zeta ) );
+                double c = 1. / sqrt( 1. + t * t );
+                double s = c * t;
+                for ( int i = 0; i < n; ++i ) {
+                    double aip = A[p*n + i];
+                    double aiq = A[q*n + i];
+                    A[p*n + i] = c * aip - s * aiq;
+                    A[q*n + i] = s * aip + c * aiq;
+                }
+                for ( int i = 0; i < n; ++i ) {
+                    double api = A[i*n + p];
+                    double aqi = A[i*n + q];
+                    A[i*n + p] = c * api - s * aqi;
+                    A[i*n + q] = s * api + c * aqi;
+                    double vip = V[p*n + i];
+                    double viq = V[q*n + i];
+                    V[p*n + i] = c * vip - s * viq;
+                    V[q*n + i] = s * vip + c * viq;
+                }
+            }
+        }
+    }
+}
+
+void ResolventSolver::applyOperator(
+    IBSolver& solver,
+    double omega,
+    const Scalar& fRe,
+    const Scalar& fIm,
+    Scalar& uRe,
+    Scalar& uIm,
+    int transientPeriods
+    ) {
+    // Steps per forcing period (the same count for negative omega, used
+    // for the adjoint resolvent)
+    double period = 2. * atan(1.) * 4. / fabs( omega );
+    int stepsPerPeriod = (int) ( period / _dt + 0.5 );
+    if ( stepsPerPeriod < 4 ) stepsPerPeriod = 4;
+
+    State x( _grid, _model.getNumPoints() );
+    x.omega = 0.;
+    x.q = 0.;
+    x.f = 0.;
+    solver.reset();
+
+    // Forcing f(t) = Re[ (fRe + i fIm) e^{i omega t} ], injected into
+    // the vorticity between steps (first-order splitting).  March the
+    // transient out, then Fourier-project the response over one period
+    uRe = 0.;
+    uIm = 0.;
+    int numSteps = ( transientPeriods + 1 ) * stepsPerPeriod;
+    int projectFrom = transientPeriods * stepsPerPeriod;
+    for ( int i = 0; i < numSteps; ++i ) {
+        solver.advance( x );
+        double t = ( i + 1 ) * _dt;
+        double c = cos( omega * t );
+        double s = sin( omega * t );
+        x.omega += ( _dt * c ) * fRe;
+        x.omega -= ( _dt * s ) * fIm;
+        _model.refreshState( x );
+        if ( i >= projectFrom ) {
+            double w = 2. / stepsPerPeriod;
+            uRe += ( w * c ) * x.omega;
+            uIm -= ( w * s ) * x.omega;
+        }
+    }
+}
+
+bool ResolventSolver::computeModes(
+    double omega,
+    int numModes,
+    int transientPeriods,
+    double& leadingGain
+    ) {
+    leadingGain = 0.;
+    if ( numModes < 1 || omega == 0. ) return false;
+    int k = numModes + 2;   // oversampled sketch
+
+    cout << "Resolvent modes at omega = " << omega << " ("
+        << k << " forward + " << k << " adjoint applications)" << endl;
+
+    // Random complex forcing block, orthonormalized.  Counter-based
+    // generator with a fixed seed per column, so a rerun reproduces
+    // the same modes to roundoff regardless of thread count
+    Scalar zero( _grid );
+    zero = 0.;
+    vector<Scalar> fre( k, zero );
+    vector<Scalar> fim( k, zero );
+    const Ullong seed = 6502;
+    for ( int j = 0; j < k; ++j ) {
+        RandomizeScalar( fre[j], seed + 2*j );
+        RandomizeScalar( fim[j], seed + 2*j + 1 );
+    }
+    orthonormalize( fre, fim );
+
+    // Y = R F: one forced linearized run per sketch column, then
+    // orthonormalize the responses into the basis Q
+    vector<Scalar> qre( k, zero );
+    vector<Scalar> qim( k, zero );
+    for ( int j = 0; j < k; ++j ) {
+        cout << "    forward " << j+1 << "/" << k << endl;
+        applyOperator( _forward, omega, fre[j], fim[j],
+            qre[j], qim[j], transientPeriods );
+    }
+    orthonormalize( qre, qim );
+
+    // Z = R^H Q: one forced adjoint run per basis column.  The adjoint
+    // resolvent is the resolvent of the adjoint operator at -omega
+    vector<Scalar> zre( k, zero );
+    vector<Scalar> zim( k, zero );
+    for ( int j = 0; j < k; ++j ) {
+        cout << "    adjoint " << j+1 << "/" << k << endl;
+        applyOperator( _adjoint, -omega, qre[j], qim[j],
+            zre[j], zim[j], transientPeriods );
+    }
+
+    // Gram matrix G = Z^H Z (Hermitian k x k); its eigenvalues are the
+    // squared gains and its eigenvectors rotate Q and Z into the modes.
+    // Solve it through the real symmetric embedding [[Gr,-Gi],[Gi,Gr]],
+    // whose spectrum is that of G with each eigenvalue doubled
+    int n = 2 * k;
+    vector<double> A( n * n, 0. );
+    for ( int j = 0; j < k; ++j ) {
+        for ( int i = 0; i < k; ++i ) {
+            double gr, gi;
+            innerProductC( zre[i], zim[i], zre[j], zim[j], gr, gi );
+            A[j*n + i] = gr;
+            A[(j+k)*n + (i+k)] = gr;
+            A[j*n + (i+k)] = gi;
+            A[(j+k)*n + i] = -gi;
+        }
+    }
+    vector<double> V( n * n );
+    jacobiEigen( A, V, n );
+
+    // Sort eigenvalues descending; each appears twice (the embedding
+    // pairs w and i w), so deflate duplicates by projecting each complex
+    // eigenvector onto the span of those already selected
+    vector<int> order( n );
+    for ( int j = 0; j < n; ++j ) order[j] = j;
+    for ( int j = 0; j < n - 1; ++j ) {
+        int best = j;
+        for ( int i = j + 1; i < n; ++i ) {
+            if ( A[order[i]*n + order[i]] > A[order[best]*n + order[best]] ) {
+                best = i;
+            }
+        }
+        int tmp = order[j]; order[j] = order[best]; order[best] = tmp;
+    }
+    vector< vector<double> > wre;   // selected eigenvectors of G, complex
+    vector< vector<double> > wim;
+    vector<double> gains;
+    for ( int jj = 0; jj < n && (int) wre.size() < numModes; ++jj ) {
+        int col = order[jj];
+        vector<double> xr( k ), xi( k );
+        for ( int i = 0; i < k; ++i ) {
+            xr[i] = V[col*n + i];
+            xi[i] = V[col*n + (i+k)];
+        }
+        // Project out the already-selected complex directions
+        for ( size_t m = 0; m < wre.size(); ++m ) {
+            double cr = 0., ci = 0.;
+            for ( int i = 0; i < k; ++i ) {
+                cr += wre[m][i] * xr[i] + wim[m][i] * xi[i];
+                ci += wre[m][i] * xi[i] - wim[m][i] * xr[i];
+            }
+            for ( int i = 0; i < k; ++i ) {
+                xr[i] -= cr * wre[m][i] - ci * wim[m][i];
+                xi[i] -= cr * wim[m][i] + ci * wre[m][i];
+            }
+        }
+        double norm2 = 0.;
+        for ( int i = 0; i < k; ++i ) norm2 += xr[i]*xr[i] + xi[i]*xi[i];
+        if ( norm2 < 0.25 ) continue;   // duplicate of a selected vector
+        double norm = sqrt( norm2 );
+        for ( int i = 0; i < k; ++i ) {
+            xr[i] /= norm;
+            xi[i] /= norm;
+        }
+        wre.push_back( xr );
+        wim.push_back( xi );
+        double lambda = A[col*n + col];
+        gains.push_back( lambda > 0. ? sqrt( lambda ) : 0. );
+    }
+
+    // Write the gains, and the forcing/response pair of each mode:
+    // response U_j = Q w_j, forcing V_j = Z w_j / sigma_j
+    char suffix[64];
+    sprintf( suffix, "_w%g", omega );
+    string gainFile = _basename + suffix + ".gain";
+    FILE* fp = fopen( gainFile.c_str(), "w" );
+    if ( fp == NULL ) return false;
+    fprintf( fp, "# resolvent gains at omega = %g\n", omega );
+    for ( size_t j = 0; j < gains.size(); ++j ) {
+        fprintf( fp, "%.10e\n", gains[j] );
+    }
+    fclose( fp );
+
+    bool status = true;
+    for ( size_t j = 0; j < gains.size(); ++j ) {
+        Scalar ur( zero ), ui( zero ), vr( zero ), vi( zero );
+        for ( int i = 0; i < k; ++i ) {
+            double cr = wre[j][i];
+            double ci = wim[j][i];
+            ur += cr * qre[i];  ur -= ci * qim[i];
+            ui += cr * qim[i];  ui += ci * qre[i];
+            vr += cr * zre[i];  vr -= ci * zim[i];
+            vi += cr * zim[i];  vi += ci * zre[i];
+        }
+        if ( gains[j] > 0. ) {
+            vr *= 1. / gains[j];
+            vi *= 1. / gains[j];
+        }
+        vector<const Scalar*> fields;
+        vector<string> names;
+        fields.push_back( &vr ); names.push_back( "f_re" );
+        fields.push_back( &vi ); names.push_back( "f_im" );
+        fields.push_back( &ur ); names.push_back( "u_re" );
+        fields.push_back( &ui ); names.push_back( "u_im" );
+        char title[256];
+        sprintf( title, "Resolvent mode %d at omega = %g, gain = %g",
+            (int) j + 1, omega, gains[j] );
+        char modeSuffix[64];
+        sprintf( modeSuffix, "_w%g_mode%02d.plt", omega, (int) j + 1 );
+        status = ScalarToTecplot( fields, names,
+            _basename + modeSuffix, title ) && status;
+    }
+
+    leadingGain = gains.empty() ? 0. : gains[0];
+    cout << "    leading gain " << leadingGain << endl;
+    return status;
+}
+
+} // namespace ibpm
@@ -0,0 +1,77 @@
+#ifndef _RESOLVENT_H_
+#define _RESOLVENT_H_
+
+#include <string>
+// for Scheme::SchemeType; Scheme.h itself has no include guard
+#include "IBSolver.h"
+#include "Scalar.h"
+#include <vector>
+
+namespace ibpm {
+
+/*!
+    \file Resolvent.h
+    \class ResolventSolver
+
+    \brief Matrix-free frequency-response (resolvent) computation
+
+    Computes the leading singular values and modes of the resolvent
+    operator R(w) = (iw I - A)^{-1} of the linearized equations about a
+    base flow, without ever forming A.  The action of R on a forcing
+    field is obtained by time-marching the LinearizedIBSolver with
+    harmonic forcing until transients decay and Fourier-projecting the
+    periodic response; the action of the adjoint resolvent uses the
+    AdjointIBSolver the same way.  A randomized SVD over a small block
+    of forcing vectors (one forward and one adjoint application per
+    vector) then yields the gains, forcing modes, and response modes,
+    all in-process, with no operator export or snapshot I/O.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+class ResolventSolver {
+public:
+    /// \brief Constructor.
+    /// \param[in] model    model with zero base flow, used to refresh
+    ///                     perturbation states between forced steps
+    /// \param[in] forward  initialized LinearizedIBSolver about the base flow
+    /// \param[in] adjoint  initialized AdjointIBSolver about the base flow
+    /// \param[in] outputBasename basename for the gain and mode files
+    ResolventSolver(
+        Grid& grid,
+        NavierStokesModel& model,
+        IBSolver& forward,
+        IBSolver& adjoint,
+        double dt,
+        const std::string& outputBasename
+    );
+
+    /// \brief Compute the leading numModes resolvent modes at angular
+    /// frequency omega, integrating transientPeriods forcing periods
+    /// before each Fourier projection.  Writes a gain file and one
+    /// Tecplot file per mode; returns the leading gain in leadingGain
+    bool computeModes( double omega, int numModes, int transientPeriods,
+        double& leadingGain );
+
+private:
+    /// Apply the resolvent at (signed) frequency omega to the complex
+    /// forcing (fRe, fIm), by forced integration of the given solver
+    void applyOperator( IBSolver& solver, double omega,
+        const Scalar& fRe, const Scalar& fIm,
+        Scalar& uRe, Scalar& uIm, int transientPeriods );
+
+    Grid& _grid;
+    NavierStokesModel& _model;
+    IBSolver& _forward;
+    IBSolver& _adjoint;
+    double _dt;
+    std::string _basename;
+};
+
+} // namespace ibpm
+
+#endif /* _RESOLVENT_H_ */
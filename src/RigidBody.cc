@@ -43,6 +43,8 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <cstdio>
+#include <cstdlib>
 #include "utils.h"
 
 using std::setw;
@@ -54,17 +56,25 @@ namespace ibpm {
 RigidBody::RigidBody() {
     _xCenter = 0;
     _yCenter = 0;
+    _gridDx = 0;
     _isStationary = true;
+    _mirrorSymmetric = false;
     _motion = NULL;
+    _moved = true;
+    _positionIsCurrent = false;
 }
 
 RigidBody::RigidBody(const RigidBody& body) :
    _xCenter( body._xCenter ),
    _yCenter( body._yCenter ),
+   _gridDx( body._gridDx ),
    _isStationary( body._isStationary ),
+   _mirrorSymmetric( body._mirrorSymmetric ),
    _refPoints( body._refPoints ),
    _currentPoints( body._currentPoints ),
-   _currentVelocities( body._currentVelocities ) {
+   _currentVelocities( body._currentVelocities ),
+   _moved( body._moved ),
+   _positionIsCurrent( body._positionIsCurrent ) {
    if ( body._motion == NULL ) {
        _motion = NULL;
    }
@@ -80,6 +90,13 @@ RigidBody::~RigidBody() {
     }
 }
 
+void RigidBody::reservePoints(int n) {
+    int total = _refPoints.size() + n;
+    _refPoints.reserve( total );
+    _currentPoints.reserve( total );
+    _currentVelocities.reserve( total );
+}
+
 void RigidBody::addPoint(double x, double y) {
     Point p(x,y);
     // Add the point to both lists: reference locations and current locations
@@ -102,6 +119,15 @@ void RigidBody::addCircle(
     addCircle_n( xc, yc, radius, numPoints );
 }
 
+void RigidBody::addCircle_grid(
+    double xc,
+    double yc,
+    double radius
+    ) {
+    // two points per cell on the finest grid
+    addCircle( xc, yc, radius, 0.5 * _gridDx );
+}
+
 void RigidBody::addCircle_n(
     double xc,
     double yc,
@@ -110,6 +136,7 @@ void RigidBody::addCircle_n(
     ) {
     double twopi = 8. * atan(1.);
     double dTheta = twopi / numPoints;
+    reservePoints( numPoints );
     for(int i=0; i < numPoints; i++) {
         double x = xc + radius * cos( i * dTheta );
         double y = yc + radius * sin( i * dTheta );
@@ -130,6 +157,16 @@ void RigidBody::addLine(
     addLine_n( x1, y1, x2, y2, numPoints );
 }
 
+void RigidBody::addLine_grid(
+    double x1,
+    double y1,
+    double x2,
+    double y2
+    ) {
+    // two points per cell on the finest grid
+    addLine( x1, y1, x2, y2, 0.5 * _gridDx );
+}
+
 void RigidBody::addLine_n(
     double x1,
     double y1,
@@ -139,6 +176,7 @@ void RigidBody::addLine_n(
     ) {
     double deltaX = (x2 - x1) / (numPoints - 1);
     double deltaY = (y2 - y1) / (numPoints - 1);
+    reservePoints( numPoints );
     for(int i=0; i < numPoints; i++) {
         double x = x1 + i * deltaX;
         double y = y1 + i * deltaY;
@@ -159,6 +197,7 @@ void RigidBody::addLine_aoa(
         double cosa = cos(alpha);
         double sina = sin(alpha);
         double delta = l / (numPoints - 1);
+        reservePoints( numPoints );
         for(int i=0; i < numPoints; i++) {
             x0 = i * delta;
             y0 = 0.;    // (x0,y0) point before rotation
@@ -186,20 +225,71 @@ void RigidBody::saveRaw(ostream& out) {
 }
 
 
+// Read the whole file in one buffered pass and parse in place,
+// preallocating from the point-count header: large raw point sets load
+// many times faster than with per-line iostream parsing
 bool RigidBody::loadRaw(string filename) {
-    ifstream in( filename.c_str() );
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
+    fseek( fp, 0, SEEK_END );
+    long size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    vector<char> buf( size + 1 );
+    size_t bytesRead = fread( &buf[0], 1, size, fp );
+    fclose( fp );
+    if ( bytesRead != (size_t) size ) return false;
+    buf[size] = '\0';
+
+    char* s = &buf[0];
+    char* end;
+    long n = strtol( s, &end, 10 );
+    if ( end == s || n < 0 ) return false;
+    s = end;
+    reservePoints( n );
+    for(long i=0; i<n; i++) {
+        double x = strtod( s, &end );
+        if ( end == s ) return false;
+        s = end;
+        double y = strtod( s, &end );
+        if ( end == s ) return false;
+        s = end;
+        addPoint(x,y);
+    }
+    return true;
+}
+
+// Binary companion to the raw format (conventionally a .geomb file):
+// the point count as an int, followed by x,y pairs of doubles.
+// Loading is a single read with no text parsing at all
+bool RigidBody::saveRawBin(string filename) {
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) return false;
+    int n = getNumPoints();
+    fwrite( &n, sizeof( int ), 1, fp );
+    for(int i=0; i<n; i++) {
+        // x and y are contiguous in Point
+        fwrite( &_refPoints[i].x, sizeof( double ), 2, fp );
+    }
+    fclose( fp );
+    return true;
+}
+
+bool RigidBody::loadRawBin(string filename) {
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
     int n;
-    double x,y;
-    in >> n;
-    if ( in.fail() ) {
+    if ( fread( &n, sizeof( int ), 1, fp ) != 1 || n < 0 ) {
+        fclose( fp );
         return false;
     }
-    for(int i=0; i<n; i++) { 
-       in >> x >> y;
-       if ( in.fail() ) {
-           return false;
-       }
-       addPoint(x,y); 
+    vector<double> coords( 2*n );
+    bool success = ( n == 0 ) ||
+        ( fread( &coords[0], sizeof( double ), 2*n, fp ) == (size_t) (2*n) );
+    fclose( fp );
+    if ( ! success ) return false;
+    reservePoints( n );
+    for(int i=0; i<n; i++) {
+        addPoint( coords[2*i], coords[2*i+1] );
     }
     return true;
 }
@@ -237,9 +327,12 @@ static bool check_bad_input(
 //     point x y
 //     line x1 y1 x2 y2 dx
 //     line_n x1 y1 x2 y2 npts
+//     line_grid x1 y1 x2 y2    # spacing from the grid's finest dx
 //     circle xc yc radius dx
 //     circle_n xc yc radius npts
+//     circle_grid xc yc radius # spacing from the grid's finest dx
 //     raw naca0012.dat
+//     raw plate.geomb   # .geomb suffix selects the binary format
 //     motion fixed x y theta
 //     motion pitchplunge amp1 freq1 amp2 freq2
 //     end
@@ -282,6 +375,24 @@ bool RigidBody::load(istream& in) {
 #ifdef DEBUG
             cerr << "Add a circle, center (" << xc << ", " << yc << "), "
                 << "radius " << radius << ", dx = " << dx << endl;
+#endif
+        }
+        else if ( cmd == "circle_grid" ) {
+            double xc;
+            double yc;
+            double radius;
+            one_line >> xc >> yc >> radius;
+            RB_CHECK_FOR_ERRORS;
+            if ( _gridDx <= 0. ) {
+                cerr << "WARNING: circle_grid requires a grid spacing "
+                    "(see setGridSpacing)" << endl;
+                error_found = true;
+                continue;
+            }
+            addCircle_grid( xc, yc, radius );
+#ifdef DEBUG
+            cerr << "Add a circle_grid, center (" << xc << ", " << yc << "), "
+                << "radius " << radius << endl;
 #endif
         }
         else if ( cmd == "circle_n" ) {
@@ -315,6 +426,25 @@ bool RigidBody::load(istream& in) {
 #ifdef DEBUG
             cerr << "Add a line: (" << x0 << ", " << y0 << ") - ("
                 << x1 << ", " << y1 << "), dx = " << dx << endl;
+#endif
+        }
+        else if ( cmd == "line_grid" ) {
+            double x0;
+            double y0;
+            double x1;
+            double y1;
+            one_line >> x0 >> y0 >> x1 >> y1;
+            RB_CHECK_FOR_ERRORS;
+            if ( _gridDx <= 0. ) {
+                cerr << "WARNING: line_grid requires a grid spacing "
+                    "(see setGridSpacing)" << endl;
+                error_found = true;
+                continue;
+            }
+            addLine_grid( x0, y0, x1, y1 );
+#ifdef DEBUG
+            cerr << "Add a line_grid: (" << x0 << ", " << y0 << ") - ("
+                << x1 << ", " << y1 << ")" << endl;
 #endif
         }
         else if ( cmd == "line_n" ) {
@@ -515,9 +645,27 @@ bool RigidBody::load(istream& in) {
             string filename;
             one_line >> filename;
             RB_CHECK_FOR_ERRORS;
-            loadRaw( filename );
+            // files with a .geomb suffix are in the binary raw format
+            bool success;
+            if ( filename.length() > 6 &&
+                 filename.compare( filename.length()-6, 6, ".geomb" ) == 0 ) {
+                success = loadRawBin( filename );
+            }
+            else {
+                success = loadRaw( filename );
+            }
+            if ( ! success ) {
+                parse_error( buf );
+                error_found = true;
+            }
 #ifdef DEBUG
-            cerr << "Read a raw file: " << filename << endl;            
+            cerr << "Read a raw file: " << filename << endl;
+#endif
+        }
+        else if ( cmd == "symmetric" ) {
+            setMirrorSymmetric( true );
+#ifdef DEBUG
+            cerr << "Declare mirror symmetry about the x-axis" << endl;
 #endif
         }
         else {
@@ -559,6 +707,14 @@ bool RigidBody::isStationary() const {
     return _isStationary;
 }
 
+bool RigidBody::hasMoved() const {
+    return _moved;
+}
+
+void RigidBody::clearMoved() const {
+    _moved = false;
+}
+
 void RigidBody::setMotion(const Motion& motion) {
     // Delete the old motion, if present
     if ( _motion != NULL ) {
@@ -567,6 +723,7 @@ void RigidBody::setMotion(const Motion& motion) {
     // make a local copy of the new motion
     _motion = motion.clone();
     _isStationary = motion.isStationary();
+    _positionIsCurrent = false;
 }
 
 Motion* RigidBody::getMotion() {
@@ -585,27 +742,26 @@ void RigidBody::setName(string name) {
 // Update the position of the body (_currentPoints) based on the motion
 void RigidBody::moveBody(double time) const {
     if ( _motion == NULL ) return;
+    // A stationary motion (e.g. a fixed position at an angle of attack)
+    // yields the same transformation at every time: once it has been
+    // applied, later calls leave the points untouched
+    if ( _isStationary && _positionIsCurrent ) return;
+    _moved = true;
+    _positionIsCurrent = true;
     TangentSE2 g = _motion->getTransformation(time);
-    _currentPoints.clear();
-    _currentVelocities.clear();
-
-    // for each reference point
-    vector<Point>::const_iterator p;
-    for (p = _refPoints.begin(); p != _refPoints.end(); ++p) {
-        // add the new position to the list of current positions
-        double xnew;
-        double ynew;
-        g.mapPosition(p->x-_xCenter, p->y-_yCenter, xnew, ynew);
-        Point q(xnew+_xCenter,ynew+_yCenter);
-        _currentPoints.push_back(q);
-
-        // add the new velocity to the list of current velocities
-        double u;
-        double v;
-        g.mapVelocity(p->x-_xCenter, p->y-_yCenter, u, v);
-        Point vel(u,v);
-        _currentVelocities.push_back(vel);
-    }
+    int n = _refPoints.size();
+    _currentPoints.resize( n, Point(0,0) );
+    _currentVelocities.resize( n, Point(0,0) );
+    if ( n == 0 ) return;
+
+    // Apply the transformation to the whole point array in one pass.
+    // Point stores x and y contiguously, so consecutive coordinates of
+    // each array are two doubles apart.
+    g.mapPoints( _xCenter, _yCenter,
+                 &_refPoints[0].x, &_refPoints[0].y,
+                 &_currentPoints[0].x, &_currentPoints[0].y,
+                 &_currentVelocities[0].x, &_currentVelocities[0].y,
+                 n, 2 );
 }
 
 } // namespace ibpm
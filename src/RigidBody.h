@@ -53,6 +53,15 @@ public:
         double dx
     );
 
+    /// Add a circle with center (xc, yc) and the given radius, with
+    /// spacing taken from the grid (two points per cell, the rule of
+    /// thumb from Taira & Colonius); requires setGridSpacing
+    void addCircle_grid(
+        double xc,
+        double yc,
+        double radius
+    );
+
     /// Add a circle with center (xc, yc) and the given radius
     /// with the specified number of points.
     void addCircle_n(
@@ -72,6 +81,15 @@ public:
         double dx
     );
     
+    /// Add a line connecting (x1,y1) and (x2,y2), with spacing taken
+    /// from the grid (two points per cell); requires setGridSpacing
+    void addLine_grid(
+        double x1,
+        double y1,
+        double x2,
+        double y2
+    );
+
     /// Add a line connecting (x1,y1) and (x2,y2)
     /// with the specified number of points
     void addLine_n(
@@ -102,11 +120,15 @@ public:
     ///     point x y
     ///     line x1 y1 x2 y2 dx
     ///     line_n x1 y1 x2 y2 npts
+    ///     line_grid x1 y1 x2 y2    # spacing from the grid's finest dx
     ///     circle xc yc radius dx
     ///     circle_n xc yc radius npts
+    ///     circle_grid xc yc radius # spacing from the grid's finest dx
     ///     raw naca0012.dat
+    ///     raw plate.geomb   # .geomb suffix selects the binary format
     ///     motion fixed x y theta
     ///     motion pitchplunge amp1 freq1 amp2 freq2
+    ///     symmetric   # declare mirror symmetry about the x-axis
     ///     end
     /// Whitespace at the beginning of the line is ignored
     /// Returns false if invalid input was encountered
@@ -116,10 +138,29 @@ public:
     /// Assumes the center is (0,0)
     /// Returns false if invalid input was encountered
     bool loadRaw(string fname);
-    
+
+    /// Load a list of points from a binary raw file (conventionally
+    /// .geomb): the point count as an int, then x,y pairs of doubles.
+    /// Much faster than the ASCII format for large point sets
+    bool loadRawBin(string fname);
+
     /// Save a list of points to the specified output stream
     void saveRaw(ostream& out);
-    
+
+    /// Save the list of points in the binary raw (.geomb) format
+    bool saveRawBin(string fname);
+
+    /// Reserve storage for n additional boundary points
+    void reservePoints(int n);
+
+    /// \brief Set the finest grid spacing, used by the _grid generator
+    /// commands so one geometry file serves a whole refinement sweep.
+    /// Boundary points are placed two per cell (spacing dx/2), fine
+    /// enough not to leak but not so fine that the solver stalls
+    inline void setGridSpacing(double dx) {
+        _gridDx = dx;
+    }
+
     /// Return the number of points on the body's boundary
     int getNumPoints() const;
     
@@ -132,6 +173,28 @@ public:
     /// Return true if the body is not moving in time
     bool isStationary() const;
 
+    /// \brief Declare that the body's boundary points are mirror
+    /// symmetric about the x-axis (e.g. a cylinder or symmetric airfoil
+    /// at zero incidence).  Direct solvers use the declaration to split
+    /// the force system into its symmetric and antisymmetric halves
+    /// (see CholeskySolver); the point pairing is verified there, so a
+    /// wrong declaration degrades to the ordinary solve
+    inline void setMirrorSymmetric(bool flag) {
+        _mirrorSymmetric = flag;
+    }
+
+    /// Return true if the body declares mirror symmetry about the x-axis
+    inline bool isMirrorSymmetric() const {
+        return _mirrorSymmetric;
+    }
+
+    /// Return true if the body's points have changed since the flag was
+    /// last cleared (dirty flag for cached operators)
+    bool hasMoved() const;
+
+    /// Clear the moved flag, once cached operators have been refreshed
+    void clearMoved() const;
+
     /// Set the evolution of the current body (which may be stationary or not)
     void setMotion(const Motion& motion);
 
@@ -169,10 +232,14 @@ private:
     string _name;
     double _xCenter;  ///< x-coordinate of center
     double _yCenter;  ///< y-coordinate of center
+    double _gridDx;   ///< finest grid spacing, for _grid generators
     bool _isStationary;
+    bool _mirrorSymmetric; ///< declared mirror symmetry about the x-axis
     vector<Point> _refPoints;
     mutable vector<Point> _currentPoints;
     mutable vector<Point> _currentVelocities;
+    mutable bool _moved;             // points changed since flag cleared
+    mutable bool _positionIsCurrent; // stationary transform already applied
     Motion *_motion;
 };
 
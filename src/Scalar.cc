@@ -14,6 +14,10 @@
 // $HeadURL$
 
 #include "Scalar.h"
+#include "Kernels.h"
+#include "Memory.h"
+#include "Threads.h"
+#include <algorithm>
 #include <iostream>
 
 using std::cout;
@@ -26,7 +30,9 @@ Scalar::Scalar( const Grid& grid ) :
 }
 
 /// Default constructor: do not allocate memory yet
-Scalar::Scalar() {}
+Scalar::Scalar() {
+    _ownData = true;
+}
     
 /// Allocate new array, copy the data
 Scalar::Scalar( const Scalar& f ) :
@@ -38,26 +44,36 @@ Scalar::Scalar( const Scalar& f ) :
     }
 }
     
-/// Deallocate memory in the destructor
+/// Return the data buffer to the pool in the destructor
 Scalar::~Scalar() {
-    // deallocation automatic for Arrays
+    if ( _data.Size() > 0 && _ownData ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
 }
     
 void Scalar::coarsify() {
-    // Fine grid unchanged: start with next finest grid
+    ensureUnique();
+    // Fine grid unchanged: start with next finest grid.  Each level
+    // averages down from the one below it, so the levels must run in
+    // order, but the rows within a level are independent
     for (int lev=1; lev<Ngrid(); ++lev) {
         // Loop over interior gridpoints, that correspond to finer grid
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_COARSIFY ) ) \
+    if( GetKernelThreads( KERNEL_COARSIFY ) > 1 )
+#endif
         for (int i=NxExt()+1; i<Nx()/2+NxExt(); ++i) {
-            for (int j=NyExt()+1; j<Ny()/2+NyExt(); ++j) {
-                // get corresponding point on fine grid
-				int ii,jj;
-                getGrid().c2f(i,j,ii,jj);
-                _data(lev,i,j) = 0.25 * _data(lev-1,ii,jj) +
-                    0.125 * ( _data(lev-1,ii+1,jj) + _data(lev-1,ii,jj+1) +
-                              _data(lev-1,ii-1,jj) + _data(lev-1,ii,jj-1) ) +
-                    0.0625 * ( _data(lev-1,ii+1,jj+1) + _data(lev-1,ii+1,jj-1) +
-                               _data(lev-1,ii-1,jj+1) + _data(lev-1,ii-1,jj-1) );
-            }
+            // One coarse row of the 9-point restriction: coarse point
+            // (i,j) reads the fine columns around 2(j-NyExt()) of the
+            // three fine rows around 2(i-NxExt()), so the whole row is
+            // one strided kernel pass over contiguous fine rows
+            int ii,jj;
+            getGrid().c2f(i,NyExt()+1,ii,jj);
+            const double* mid = &_data(lev-1,ii,jj);
+            const double* up  = &_data(lev-1,ii+1,jj);
+            const double* dn  = &_data(lev-1,ii-1,jj);
+            Kernels::Restrict9( &_data(lev,i,NyExt()+1), mid, up, dn,
+                Ny()/2 - 1 );
         }
     }
 }
@@ -79,53 +95,190 @@ void Scalar::print() const {
 }
 
 void Scalar::resize( const Grid& grid ) {
+    if ( _data.Size() > 0 && _ownData ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
     setGrid( grid );
-    _data.Deallocate();
-    // Allocate arrays for interior points:
+    // Arrays hold the interior points:
     //    lev in 0..lev-1
     //    i   in 1..nx-1
     //    j   in 1..ny-1
-    _data.Allocate( Ngrid(), Nx() - 1, Ny() - 1, 0, 1, 1 );
+    // with storage drawn from the shared field-buffer pool
+    unsigned int size = Ngrid() * (Nx() - 1) * (Ny() - 1);
+    ScopedMemoryTag memTag( Memory::SCALAR );
+    _data.Dimension( Ngrid(), Nx() - 1, Ny() - 1,
+        acquireFieldBuffer( size ), 0, 1, 1 );
+    _ownData = true;
+    unshareData();
+    _bcSrc1.clear();
+    _bcSrc2.clear();
+    // Build the boundary index map up front on multi-domain grids, so
+    // that getBC may be called concurrently for several levels (see the
+    // level-parallel loop in Curl) without racing on the lazy build
+    if ( Ngrid() > 1 ) updateBCIndex();
+}
+
+void Scalar::viewExternal( const Grid& grid, double* data ) {
+    if ( _data.Size() > 0 && _ownData ) {
+        releaseFieldBuffer( &_data(0), _data.Size() );
+    }
+    setGrid( grid );
+    _data.Dimension( Ngrid(), Nx() - 1, Ny() - 1, data, 0, 1, 1 );
+    _ownData = false;
+    unshareData();
+    _bcSrc1.clear();
+    _bcSrc2.clear();
+    if ( Ngrid() > 1 ) updateBCIndex();
 }
     
-void Scalar::getBC( int lev, BC& bc ) const {
-    assert( Nx() == bc.Nx() );
-    assert( Ny() == bc.Ny() );
-    assert( lev >= 0 && lev < Ngrid()-1 );
+// Build the index map used by getBC.  Boundary slot k of a BC object (in
+// the flat layout of BC.h) is filled with
+//     0.5 * ( data[_bcSrc1[k]] + data[_bcSrc2[k]] )
+// where the offsets index the interior points of the next coarser grid
+// level: a fine boundary point coinciding with a coarse gridpoint lists
+// that point twice, and one midway between two coarse points lists both
+// neighbors.  The map depends only on the grid dimensions, not on the
+// level or the data, so it is built once and reused for every call.
+void Scalar::updateBCIndex() const {
+    int nx = Nx();
+    int ny = Ny();
+    int nbc = 2 * (nx + ny + 2);
+    _bcSrc1.assign( nbc, 0 );
+    _bcSrc2.assign( nbc, 0 );
+    // flat offset of interior point (i,j) within one level is
+    // (i-1) * stride + (j-1)
+    int stride = ny - 1;
+    // slot offsets of each side's contiguous run (see BC.h)
+    int rightOff = ny + 1;
+    int botOff = 2 * (ny + 1);
+    int topOff = botOff + nx + 1;
 
-    // top and bottom boundaries
-	/* if grid is shifted completely up or down, 
-	   then all poinsts on the shared boundary must take a value of 0,
-	   as required on the boundary of the outermost grid */ 
-    for (int i=0; i<=Nx(); ++i) {
+    // top and bottom boundaries:
+    // bottom(i) is slot botOff+i; top(i) is slot topOff+i
+    for (int i=0; i<=nx; ++i) {
         int ii,jj;  // indices on coarse grid
         getGrid().f2c(i,0,ii,jj);
-        // copy point that coincides with coarse point
-		bc.bottom(i) = (*this)( lev+1, ii, jj );
-		bc.top(i) = (*this)( lev+1, ii, Ny()/2+jj );
-		
-        if ( ++i <= Nx() ) {
-            // interpolate point in between coarse points
-			bc.bottom(i) = 0.5 * ( (*this)( lev+1, ii, jj ) + (*this)( lev+1, ii+1, jj) );
-			bc.top(i) = 0.5 * ( (*this)( lev+1, ii, Ny()/2+jj ) + (*this)( lev+1, ii+1, Ny()/2+jj) );
+        // point that coincides with a coarse point
+        int bot = botOff + i;
+        int top = topOff + i;
+        _bcSrc1[bot] = _bcSrc2[bot] = (ii-1) * stride + (jj-1);
+        _bcSrc1[top] = _bcSrc2[top] = (ii-1) * stride + (ny/2+jj-1);
+        if ( ++i <= nx ) {
+            // point in between coarse points
+            bot = botOff + i;
+            top = topOff + i;
+            _bcSrc1[bot] = (ii-1) * stride + (jj-1);
+            _bcSrc2[bot] = ii * stride + (jj-1);
+            _bcSrc1[top] = (ii-1) * stride + (ny/2+jj-1);
+            _bcSrc2[top] = ii * stride + (ny/2+jj-1);
         }
     }
 
-    // left and right boundaries
-    for (int j=0; j<=Ny(); ++j) {
+    // left and right boundaries:
+    // left(j) is slot j; right(j) is slot rightOff+j
+    // (the corner values are computed by both loops; they coincide)
+    for (int j=0; j<=ny; ++j) {
         int ii,jj;  // indices on coarse grid
         getGrid().f2c(0,j,ii,jj);
-        // copy point that coincides with coarse point
-		bc.left(j) = (*this)( lev+1, ii, jj );
-		bc.right(j) = (*this)( lev+1, Nx()/2+ii, jj );
-        if ( ++j <= Ny() ) {
-            // interpolate point in between coarse points
-			bc.left(j) = 0.5 * ( (*this)( lev+1, ii, jj ) + (*this)( lev+1, ii, jj+1) );
-			bc.right(j) = 0.5 * ( (*this)( lev+1, Nx()/2+ii, jj ) + (*this)( lev+1, Nx()/2+ii, jj+1 ) );
+        int left = j;
+        int right = rightOff + j;
+        _bcSrc1[left] = _bcSrc2[left] = (ii-1) * stride + (jj-1);
+        _bcSrc1[right] = _bcSrc2[right] = (nx/2+ii-1) * stride + (jj-1);
+        if ( ++j <= ny ) {
+            left = j;
+            right = rightOff + j;
+            _bcSrc1[left] = (ii-1) * stride + (jj-1);
+            _bcSrc2[left] = (ii-1) * stride + jj;
+            _bcSrc1[right] = (nx/2+ii-1) * stride + (jj-1);
+            _bcSrc2[right] = (nx/2+ii-1) * stride + jj;
         }
     }
 }
 
+// Bounding box of the nonzero interior values at level lev.  Each row is
+// scanned inward from both ends, so rows that are nonzero near the wake
+// cost only a few reads, and all-zero rows (most of a coarse outer level
+// early in a run) cost one full pass of comparisons with no writes
+bool Scalar::activeBox( int lev, int& i1, int& i2, int& j1, int& j2 ) const {
+    assert( lev >= 0 && lev < Ngrid() );
+    int nx = Nx();
+    int ny = Ny();
+    i1 = nx; i2 = 0;
+    j1 = ny; j2 = 0;
+    for (int i=1; i<nx; ++i) {
+        const double* row = &_data(lev,i,1);
+        int lo = 0;
+        int hi = ny-2;  // offsets of j = 1 .. ny-1 within the row
+        while ( lo <= hi && row[lo] == 0. ) ++lo;
+        if ( lo > hi ) continue;  // row is identically zero
+        while ( row[hi] == 0. ) --hi;
+        if ( i < i1 ) i1 = i;
+        i2 = i;
+        if ( lo+1 < j1 ) j1 = lo+1;
+        if ( hi+1 > j2 ) j2 = hi+1;
+    }
+    return i1 <= i2;
+}
+
+void Scalar::multiplyActive( const Scalar& g ) {
+    multiplyActive( g, 1., Ngrid() );
+}
+
+void Scalar::multiplyActive( const Scalar& g, double scale, int maxlev ) {
+    ensureUnique();
+    assert( g.Ngrid() == Ngrid() );
+    assert( g.Nx() == Nx() );
+    assert( g.Ny() == Ny() );
+    assert( maxlev >= 1 && maxlev <= Ngrid() );
+    int nx = Nx();
+    int ny = Ny();
+    for (int lev=0; lev<maxlev; ++lev) {
+        int i1, i2, j1, j2;
+        if ( !g.activeBox( lev, i1, i2, j1, j2 ) ) {
+            // g is identically zero at this level, and so is the product
+            double* d = &_data(lev,1,1);
+            std::fill( d, d + (nx-1)*(ny-1), 0. );
+            continue;
+        }
+        for (int i=1; i<nx; ++i) {
+            double* row = &_data(lev,i,1);
+            if ( i < i1 || i > i2 ) {
+                std::fill( row, row + ny-1, 0. );
+                continue;
+            }
+            const double* grow = &g._data(lev,i,1);
+            std::fill( row, row + (j1-1), 0. );
+            for (int j=j1-1; j<=j2-1; ++j) {
+                row[j] *= scale * grow[j];
+            }
+            std::fill( row + j2, row + ny-1, 0. );
+        }
+    }
+}
+
+void Scalar::getBC( int lev, BC& bc ) const {
+    assert( Nx() == bc.Nx() );
+    assert( Ny() == bc.Ny() );
+    assert( lev >= 0 && lev < Ngrid()-1 );
+	/* if grid is shifted completely up or down,
+	   then all poinsts on the shared boundary must take a value of 0,
+	   as required on the boundary of the outermost grid */
+
+    if ( _bcSrc1.empty() ) updateBCIndex();
+
+    // Gather from the interior of the next coarser grid through the
+    // precomputed index map: a flat loop over the boundary slots, with no
+    // index arithmetic or branches left in the inner loop
+    const double* src = &_data( lev+1, 1, 1 );
+    const int* s1 = &_bcSrc1[0];
+    const int* s2 = &_bcSrc2[0];
+    double* b = bc.flatten();
+    int nbc = bc.Size();
+    for (int k=0; k<nbc; ++k) {
+        b[k] = 0.5 * ( src[ s1[k] ] + src[ s2[k] ] );
+    }
+}
+
 
 
 } // namespace
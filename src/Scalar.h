@@ -5,7 +5,8 @@
 #include "BC.h"
 #include "Field.h"
 #include "Grid.h"
-#include <iostream>  
+#include <iostream>
+#include <vector>
  
 namespace ibpm {
 
@@ -29,6 +30,9 @@ namespace ibpm {
     \version $Revision$
 */
 
+// Expression template for lazy elementwise arithmetic (defined below)
+template <class L, class Op, class R> class ScalarExpr;
+
 class Scalar : public Field {
 public:
     /// Allocate memory for the 2D array
@@ -46,6 +50,12 @@ public:
     /// Reassign the grid parameters and allocate memory based on the new grid
     void resize( const Grid& grid );
 
+    /// \brief Make this Scalar a view of externally owned data, laid out as
+    /// in resize() (e.g. a region of a memory-mapped restart file; see
+    /// State::mapFromFile).  The data must outlive the view, and is not
+    /// returned to the buffer pool
+    void viewExternal( const Grid& grid, double* data );
+
     /// Print the whole field to standard output
     void print() const;
     
@@ -57,6 +67,7 @@ public:
     
     /// Copy assignment
     inline Scalar& operator=(const Scalar& f) {
+        ensureUnique();
         assert( f.Ngrid() == Ngrid() );
 		assert( f.Nx() == Nx() );
         assert( f.Ny() == Ny() );
@@ -68,12 +79,80 @@ public:
 
     /// Copy assignment from double
     inline Scalar& operator=(double a) {
+        ensureUnique();
         _data = a;
         return *this;
     }
 
+    /// Exchange contents with f, in constant time (no data is copied)
+    inline void swap( Scalar& f ) {
+        Grid tmp = getGrid();
+        setGrid( f.getGrid() );
+        f.setGrid( tmp );
+        _data.Swap( f._data );
+        bool own = _ownData; _ownData = f._ownData; f._ownData = own;
+        swapShareState( f );
+    }
+
+#if __cplusplus >= 201103L
+    /// Move constructor: take over the contents of f, leaving it empty
+    inline Scalar( Scalar&& f ) : Field( f ) {
+        _data.Swap( f._data );
+        _ownData = f._ownData;
+        f._ownData = true;
+        swapShareState( f );
+    }
+
+    /// Move assignment: exchange contents with f
+    inline Scalar& operator=( Scalar&& f ) {
+        swap( f );
+        return *this;
+    }
+#endif
+
+    /// Construct from a lazy expression, evaluating it in a single loop
+    template <class L, class Op, class R>
+    inline Scalar( const ScalarExpr<L,Op,R>& e ) :
+        Field( e.getGrid() ) {
+        resize( e.getGrid() );
+        for (unsigned int i=0; i<_data.Size(); ++i) {
+            _data(i) = e(i);
+        }
+    }
+
+    /// Assignment from a lazy expression, evaluated in a single loop
+    template <class L, class Op, class R>
+    inline Scalar& operator=(const ScalarExpr<L,Op,R>& e) {
+        ensureUnique();
+        assert( e.getGrid().isEqualTo( getGrid() ) );
+        for (unsigned int i=0; i<_data.Size(); ++i) {
+            _data(i) = e(i);
+        }
+        return *this;
+    }
+
+    /// Return the total number of stored gridpoints, over all levels
+    inline unsigned int getSize() const { return _data.Size(); }
+
+    /// Return the i-th stored value, indexed linearly over all levels
+    /// (used by the expression templates below)
+    inline double flat(unsigned int i) const { return _data(i); }
+
+    /// \brief Return a pointer to the flat interior data at grid level
+    /// lev, in row-major (i,j) order ((nx-1)*(ny-1) values)
+    inline double* flatten(int lev) {
+        ensureUnique();
+        assert( lev >= 0 && lev < Ngrid() );
+        return &_data(lev,1,1);
+    }
+    inline const double* flatten(int lev) const {
+        assert( lev >= 0 && lev < Ngrid() );
+        return &_data(lev,1,1);
+    }
+
     /// f(i,j) refers to the value at index (i,j)
     inline double& operator()(int lev, int i, int j) {
+        ensureUnique();
         assert( lev >= 0 && lev < Ngrid() );
         assert( i>=1  && i< Nx() );
         assert( j>=1  && j< Ny() );
@@ -90,6 +169,7 @@ public:
 		
     /// f[lev] returns a 2d array of grid level lev
     inline Array::Array2<double> operator[](int lev) {
+        ensureUnique();
         return _data[lev];
     }
         
@@ -98,6 +178,28 @@ public:
         return _data[lev];
     }
     
+    /// \brief Compute the bounding box [i1,i2] x [j1,j2] of the nonzero
+    /// interior values at level lev.  Returns false when the level is
+    /// identically zero (the box is then empty, i1 > i2).  One cheap
+    /// read-only pass, used to restrict elementwise sweeps to the active
+    /// region of the coarse outer levels, where the vorticity vanishes
+    /// outside the advected wake
+    bool activeBox( int lev, int& i1, int& i2, int& j1, int& j2 ) const;
+
+    /// \brief f *= g, restricted to the active region of g: the product
+    /// is identically zero outside the bounding box of g's nonzero values
+    /// at each level, so those points are set to zero without reading
+    /// either operand.  Equivalent to operator*=( g ), but skips most of
+    /// the coarse outer levels when g is compactly supported (e.g. the
+    /// vorticity in the nonlinear term)
+    void multiplyActive( const Scalar& g );
+
+    /// \brief As above, with the product scaled by the given factor
+    /// (folding e.g. a sign flip into the same pass), and applied to the
+    /// finest maxlev levels only: the coarser levels are left untouched
+    /// (multirate advection; see IBSolver::setMultirate)
+    void multiplyActive( const Scalar& g, double scale, int maxlev );
+
     /// \brief Compute the boundary values at level lev from the next coarser
     /// grid.
     /// \param[in] lev is the grid level for which the bounday values are
@@ -107,6 +209,7 @@ public:
     
     /// f += g
     inline Scalar& operator+=(const Scalar& f) {
+        ensureUnique();
         assert( f.Ngrid() == Ngrid() );
         assert(f.Nx() == Nx() );
         assert(f.Ny() == Ny() );
@@ -118,6 +221,7 @@ public:
 
     /// f += a
     inline Scalar& operator+=(double a) {
+        ensureUnique();
         for ( unsigned int i=0; i<_data.Size(); ++i ) {
             _data(i) += a;
         }
@@ -126,6 +230,7 @@ public:
 
     /// f -= g
     inline Scalar& operator-=(const Scalar& f) {
+        ensureUnique();
         assert( f.Ngrid() == Ngrid() );
         assert(f.Nx() == Nx() );
         assert(f.Ny() == Ny() );
@@ -137,48 +242,38 @@ public:
 
     /// f -= a
     inline Scalar& operator-=(double a) {
+        ensureUnique();
         for ( unsigned int i=0; i<_data.Size(); ++i ) {
             _data(i) -= a;
         }
         return *this;
     }
 
-    /// f + g
-    inline Scalar operator+(const Scalar& f) {
-        assert( f.Ngrid() == Ngrid() );
-        assert( f.Nx() == Nx() );
-        assert( f.Ny() == Ny() );
-        Scalar g = *this;
-        g += f;
-        return g;
-    }
-    
-    /// f + a
-    inline Scalar operator+(double a) {
-        Scalar g = *this;
-        g += a;
-        return g;
-    }
-    
-    /// f - g
-    inline Scalar operator-(const Scalar& f) {
-        assert( f.Ngrid() == Ngrid() );
-        assert( f.Nx() == Nx() );
-        assert( f.Ny() == Ny() );
-        Scalar g = *this;
-        g -= f;
-        return g;
+    /// f += (expression), evaluated in a single fused loop
+    template <class L, class Op, class R>
+    inline Scalar& operator+=(const ScalarExpr<L,Op,R>& e) {
+        ensureUnique();
+        assert( e.getGrid().isEqualTo( getGrid() ) );
+        for ( unsigned int i=0; i<_data.Size(); ++i ) {
+            _data(i) += e(i);
+        }
+        return *this;
     }
-    
-    /// f - a
-    inline Scalar operator-(double a) {
-        Scalar g = *this;
-        g -= a;
-        return g;
+
+    /// f -= (expression), evaluated in a single fused loop
+    template <class L, class Op, class R>
+    inline Scalar& operator-=(const ScalarExpr<L,Op,R>& e) {
+        ensureUnique();
+        assert( e.getGrid().isEqualTo( getGrid() ) );
+        for ( unsigned int i=0; i<_data.Size(); ++i ) {
+            _data(i) -= e(i);
+        }
+        return *this;
     }
-    
+
     /// f *= g
     inline Scalar& operator*=(const Scalar& f) {
+        ensureUnique();
         assert( f.Ngrid() == Ngrid() );
         assert( f.Nx() == Nx() );
         assert( f.Ny() == Ny() );
@@ -190,29 +285,14 @@ public:
 
     /// f *= a
     inline Scalar& operator*=(double a) {
+        ensureUnique();
         _data *= a;
         return *this;
     }
 
-    /// f * g
-    inline Scalar operator*(const Scalar& f) {
-        assert( f.Ngrid() == Ngrid() );
-        assert( f.Nx() == Nx() );
-        assert( f.Ny() == Ny() );
-        Scalar g = *this;
-        g *= f;
-        return g;
-    }
-    
-    /// f * a
-    inline Scalar operator*(double a) {
-        Scalar g = *this;
-        g *= a;
-        return g;
-    }
-    
     /// f /= g
     inline Scalar& operator/=(const Scalar& f) {
+        ensureUnique();
         assert( f.Ngrid() == Ngrid() );
         assert( f.Nx() == Nx() );
         assert( f.Ny() == Ny() );
@@ -222,66 +302,150 @@ public:
 
     /// f /= a
     inline Scalar& operator/=(double a) {
+        ensureUnique();
         _data /= a;
         return *this;
     }
 
-    /// f / g
-    inline Scalar operator/(const Scalar& f) {
-        assert( f.Ngrid() == Ngrid() );
-        assert( f.Nx() == Nx() );
-        assert( f.Ny() == Ny() );
-        Scalar g = *this;
-        g /= f;
-        return g;
-    }
-    
-    /// f / a
-    inline Scalar operator/(double a) {
-        Scalar g = *this;
-        g /= a;
-        return g;
-    }
 
 
 private:
+    /// Build the index map used by getBC (see Scalar.cc)
+    void updateBCIndex() const;
+
     Array::Array3<double> _data;
+    bool _ownData;  // false when viewing externally owned data
+    // Precomputed source offsets for the coarse-to-fine boundary
+    // interpolation in getBC; built lazily, cleared when the grid changes
+    mutable std::vector<int> _bcSrc1;
+    mutable std::vector<int> _bcSrc2;
 };
 
-/// -f
-inline Scalar operator-(const Scalar& f) {
-    Scalar g = f;
-    g *= -1;
-    return g;
-}
+// =========================================================================
+// Expression templates for Scalar arithmetic
+//
+// Binary operators on Scalars do not return a new Scalar directly; instead
+// they build a lightweight ScalarExpr object that records the operands.
+// The elementwise loop runs only when the expression is assigned to (or
+// constructed into) a Scalar, so a compound right-hand side such as
+//     a = b + 0.5 * ( c - d );
+// evaluates in a single loop with no full-grid temporaries.
+// =========================================================================
 
-/// a + f
-inline Scalar operator+(double a, const Scalar& f) {
-    Scalar g = f;
-    g += a;
-    return g;
-}
-    
-/// a - f
-inline Scalar operator-(double a, const Scalar& f) {
-    Scalar g = -f;
-    g += a;
-    return g;
+/// Elementwise operation tags, applied by ScalarExpr
+struct SPlus   { static inline double apply(double a, double b) {return a+b;} };
+struct SMinus  { static inline double apply(double a, double b) {return a-b;} };
+struct STimes  { static inline double apply(double a, double b) {return a*b;} };
+struct SDivide { static inline double apply(double a, double b) {return a/b;} };
+
+/// Leaf node wrapping a reference to a Scalar operand
+class ScalarRef {
+public:
+    inline ScalarRef( const Scalar& f ) : _f( &f ) {}
+    inline double operator()(unsigned int i) const { return _f->flat(i); }
+    inline const Grid& getGrid() const { return _f->getGrid(); }
+private:
+    const Scalar* _f;
+};
+
+/// Leaf node wrapping a scalar constant operand
+class ScalarConst {
+public:
+    inline ScalarConst( double a ) : _a( a ) {}
+    inline double operator()(unsigned int) const { return _a; }
+private:
+    double _a;
+};
+
+/// Node representing the elementwise operation Op applied to two
+/// subexpressions (leaves or other ScalarExpr nodes), stored by value
+template <class L, class Op, class R>
+class ScalarExpr {
+public:
+    inline ScalarExpr( const L& l, const R& r, const Grid& grid ) :
+        _l( l ), _r( r ), _grid( &grid ) {}
+    inline double operator()(unsigned int i) const {
+        return Op::apply( _l(i), _r(i) );
+    }
+    inline const Grid& getGrid() const { return *_grid; }
+private:
+    L _l;
+    R _r;
+    const Grid* _grid;
+};
+
+// Generate the overloads for one elementwise operator, covering each
+// combination of Scalar, double, and subexpression operands
+#define IBPM_SCALAR_EXPR_OP( op, Op )                                        \
+inline ScalarExpr<ScalarRef,Op,ScalarRef>                                    \
+operator op( const Scalar& f, const Scalar& g ) {                            \
+    assert( f.getGrid().isEqualTo( g.getGrid() ) );                          \
+    return ScalarExpr<ScalarRef,Op,ScalarRef>(                               \
+        ScalarRef(f), ScalarRef(g), f.getGrid() );                           \
+}                                                                            \
+inline ScalarExpr<ScalarRef,Op,ScalarConst>                                  \
+operator op( const Scalar& f, double a ) {                                   \
+    return ScalarExpr<ScalarRef,Op,ScalarConst>(                             \
+        ScalarRef(f), ScalarConst(a), f.getGrid() );                         \
+}                                                                            \
+inline ScalarExpr<ScalarConst,Op,ScalarRef>                                  \
+operator op( double a, const Scalar& f ) {                                   \
+    return ScalarExpr<ScalarConst,Op,ScalarRef>(                             \
+        ScalarConst(a), ScalarRef(f), f.getGrid() );                         \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline ScalarExpr<ScalarExpr<L,O,R>,Op,ScalarRef>                            \
+operator op( const ScalarExpr<L,O,R>& e, const Scalar& f ) {                 \
+    assert( e.getGrid().isEqualTo( f.getGrid() ) );                          \
+    return ScalarExpr<ScalarExpr<L,O,R>,Op,ScalarRef>(                       \
+        e, ScalarRef(f), e.getGrid() );                                      \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline ScalarExpr<ScalarRef,Op,ScalarExpr<L,O,R> >                           \
+operator op( const Scalar& f, const ScalarExpr<L,O,R>& e ) {                 \
+    assert( f.getGrid().isEqualTo( e.getGrid() ) );                          \
+    return ScalarExpr<ScalarRef,Op,ScalarExpr<L,O,R> >(                      \
+        ScalarRef(f), e, e.getGrid() );                                      \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline ScalarExpr<ScalarExpr<L,O,R>,Op,ScalarConst>                          \
+operator op( const ScalarExpr<L,O,R>& e, double a ) {                        \
+    return ScalarExpr<ScalarExpr<L,O,R>,Op,ScalarConst>(                     \
+        e, ScalarConst(a), e.getGrid() );                                    \
+}                                                                            \
+template <class L, class O, class R>                                         \
+inline ScalarExpr<ScalarConst,Op,ScalarExpr<L,O,R> >                         \
+operator op( double a, const ScalarExpr<L,O,R>& e ) {                        \
+    return ScalarExpr<ScalarConst,Op,ScalarExpr<L,O,R> >(                    \
+        ScalarConst(a), e, e.getGrid() );                                    \
+}                                                                            \
+template <class L1, class O1, class R1, class L2, class O2, class R2>        \
+inline ScalarExpr<ScalarExpr<L1,O1,R1>,Op,ScalarExpr<L2,O2,R2> >             \
+operator op( const ScalarExpr<L1,O1,R1>& e1,                                 \
+             const ScalarExpr<L2,O2,R2>& e2 ) {                              \
+    assert( e1.getGrid().isEqualTo( e2.getGrid() ) );                        \
+    return ScalarExpr<ScalarExpr<L1,O1,R1>,Op,ScalarExpr<L2,O2,R2> >(        \
+        e1, e2, e1.getGrid() );                                              \
 }
-    
-/// a * f
-inline Scalar operator*(double a, const Scalar& f) {
-    Scalar g = f;
-    g *= a;
-    return g;
+
+IBPM_SCALAR_EXPR_OP( +, SPlus )
+IBPM_SCALAR_EXPR_OP( -, SMinus )
+IBPM_SCALAR_EXPR_OP( *, STimes )
+IBPM_SCALAR_EXPR_OP( /, SDivide )
+
+#undef IBPM_SCALAR_EXPR_OP
+
+/// -f, as the expression (-1) * f
+inline ScalarExpr<ScalarConst,STimes,ScalarRef>
+operator-( const Scalar& f ) {
+    return -1. * f;
 }
 
-/// a / f
-inline Scalar operator/(double a, const Scalar& f) {
-    Scalar g(f.getGrid());
-    g = a;
-    g /= f;
-    return g;
+/// -(expression)
+template <class L, class O, class R>
+inline ScalarExpr<ScalarConst,STimes,ScalarExpr<L,O,R> >
+operator-( const ScalarExpr<L,O,R>& e ) {
+    return -1. * e;
 }
 
 } // namespace ibpm
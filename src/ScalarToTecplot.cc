@@ -1,5 +1,6 @@
 
 #include "ScalarToTecplot.h"
+#include "Threads.h"
 #include <stdio.h>
 #include <cstring>
 #include <vector>
@@ -33,16 +34,146 @@ private:
     vector<string> _names;
 };
     
-bool writeTecplotFileASCII( const char* filename, const char* title, const VarList& list, int lev ) {
+// Helpers for the Tecplot binary (TDV112) format: 32-bit ints, 32-bit
+// floats, and strings written one character per 32-bit int
+static void writeInt32( FILE* fp, int i ) {
+    fwrite( &i, sizeof(int), 1, fp );
+}
+
+static void writeFloat32( FILE* fp, float x ) {
+    fwrite( &x, sizeof(float), 1, fp );
+}
+
+static void writeFloat64( FILE* fp, double x ) {
+    fwrite( &x, sizeof(double), 1, fp );
+}
+
+static void writeString( FILE* fp, const char* s ) {
+    for ( ; *s != '\0'; ++s ) {
+        writeInt32( fp, *s );
+    }
+    writeInt32( fp, 0 );
+}
+
+// Clamp the requested region to the interior nodes [1, nx-1] x [1, ny-1]
+// and compute the point counts in each direction
+static void clampRegion( const TecplotRegion& region, int nx, int ny,
+                         int& iBegin, int& iEnd, int& jBegin, int& jEnd,
+                         int& stride, int& numI, int& numJ ) {
+    stride = ( region.stride < 1 ) ? 1 : region.stride;
+    iBegin = ( region.imin < 1 ) ? 1 : region.imin;
+    jBegin = ( region.jmin < 1 ) ? 1 : region.jmin;
+    iEnd = ( region.imax < 0 || region.imax > nx-1 ) ? nx-1 : region.imax;
+    jEnd = ( region.jmax < 0 || region.jmax > ny-1 ) ? ny-1 : region.jmax;
+    numI = ( iEnd >= iBegin ) ? ( iEnd - iBegin ) / stride + 1 : 0;
+    numJ = ( jEnd >= jBegin ) ? ( jEnd - jBegin ) / stride + 1 : 0;
+}
+
+// Write the variables in Tecplot binary format, version 112.  The data
+// are written as 32-bit floats, the same precision as the ASCII writer,
+// but at a fraction of the size and without any formatting cost
+bool writeTecplotFileBinary( const char* filename, const char* title, const VarList& list, int lev, const TecplotRegion& region ) {
     int numVars = list.getNumVars();
     assert( numVars > 0 );
-    
+
     // Get grid information
     const Grid& grid = list.getVariable(0)->getGrid();
     assert( lev < grid.Ngrid() );
     int nx = grid.Nx();
     int ny = grid.Ny();
-    
+    int iBegin, iEnd, jBegin, jEnd, stride, numI, numJ;
+    clampRegion( region, nx, ny,
+                 iBegin, iEnd, jBegin, jEnd, stride, numI, numJ );
+    int numPoints = numI * numJ;
+    if ( numPoints == 0 ) return false;
+
+    cerr << "Writing Tecplot binary file " << filename << endl;
+    FILE *fp = fopen( filename, "wb" );
+    if (fp == NULL) return false;
+
+    // Header section
+    fwrite( "#!TDV112", 1, 8, fp );
+    writeInt32( fp, 1 );                // byte order of this machine
+    writeInt32( fp, 0 );                // file type: full
+    writeString( fp, title );
+    writeInt32( fp, numVars );
+    for (int i=0; i<numVars; ++i) {
+        writeString( fp, list.getName(i).c_str() );
+    }
+    writeFloat32( fp, 299.0f );         // zone marker
+    writeString( fp, "Rectangular zone" );
+    writeInt32( fp, -1 );               // parent zone: none
+    writeInt32( fp, -1 );               // strand id: static zone
+    writeFloat64( fp, 0. );             // solution time
+    writeInt32( fp, -1 );               // zone color: not used
+    writeInt32( fp, 0 );                // zone type: ordered
+    writeInt32( fp, 0 );                // all variables node-centered
+    writeInt32( fp, 0 );                // no raw face neighbors
+    writeInt32( fp, 0 );                // no misc face connections
+    writeInt32( fp, numI );             // IMax
+    writeInt32( fp, numJ );             // JMax
+    writeInt32( fp, 1 );                // KMax
+    writeInt32( fp, 0 );                // no auxiliary data
+    writeFloat32( fp, 357.0f );         // end of header
+
+    // Data section: block packing, one variable at a time
+    writeFloat32( fp, 299.0f );         // zone marker
+    for (int i=0; i<numVars; ++i) {
+        writeInt32( fp, 1 );            // data type: float
+    }
+    writeInt32( fp, 0 );                // no passive variables
+    writeInt32( fp, 0 );                // no variable sharing
+    writeInt32( fp, -1 );               // no connectivity sharing
+    for (int ind=0; ind<numVars; ++ind) {
+        const Scalar& var = *list.getVariable(ind);
+        double minVal = var(lev,iBegin,jBegin);
+        double maxVal = minVal;
+        for (int j=jBegin; j<=jEnd; j+=stride) {
+            for (int i=iBegin; i<=iEnd; i+=stride) {
+                double val = var(lev,i,j);
+                if ( val < minVal ) minVal = val;
+                if ( val > maxVal ) maxVal = val;
+            }
+        }
+        writeFloat64( fp, minVal );
+        writeFloat64( fp, maxVal );
+    }
+    // Staging buffer for the float conversion, reused across calls:
+    // outputs run sequentially (see DerivedFields), so a single buffer
+    // suffices and snapshots stop allocating it per dump
+    static vector<float> buffer;
+    if ( buffer.size() < (unsigned int) numPoints ) {
+        buffer.resize( numPoints );
+    }
+    for (int ind=0; ind<numVars; ++ind) {
+        const Scalar& var = *list.getVariable(ind);
+        int count = 0;
+        for (int j=jBegin; j<=jEnd; j+=stride) {
+            for (int i=iBegin; i<=iEnd; i+=stride) {
+                buffer[count++] = var(lev,i,j);
+            }
+        }
+        fwrite( &buffer[0], sizeof(float), numPoints, fp );
+    }
+
+    fclose(fp);
+    return true;
+}
+
+bool writeTecplotFileASCII( const char* filename, const char* title, const VarList& list, int lev, const TecplotRegion& region ) {
+    int numVars = list.getNumVars();
+    assert( numVars > 0 );
+
+    // Get grid information
+    const Grid& grid = list.getVariable(0)->getGrid();
+    assert( lev < grid.Ngrid() );
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int iBegin, iEnd, jBegin, jEnd, stride, numI, numJ;
+    clampRegion( region, nx, ny,
+                 iBegin, iEnd, jBegin, jEnd, stride, numI, numJ );
+    if ( numI * numJ == 0 ) return false;
+
     // Write the header for the Tecplot file
     cerr << "Writing Tecplot file " << filename << endl;
     FILE *fp = fopen( filename, "w" );
@@ -54,7 +185,7 @@ bool writeTecplotFileASCII( const char* filename, const char* title, const VarLi
     }
     fprintf( fp, "\n" );
     fprintf( fp, "ZONE T=\"Rectangular zone\"\n" );
-    fprintf( fp, "I=%d, J=%d, K=1, ZONETYPE=Ordered\n", nx-1, ny-1 );
+    fprintf( fp, "I=%d, J=%d, K=1, ZONETYPE=Ordered\n", numI, numJ );
     fprintf( fp, "DATAPACKING=POINT\n" );
     fprintf( fp, "DT=(");
     for (int i=0; i<numVars; ++i) {
@@ -62,36 +193,55 @@ bool writeTecplotFileASCII( const char* filename, const char* title, const VarLi
     }
     fprintf( fp, ")\n" );
     
-    // Write the data
-    for (int j=1; j<ny; ++j) {
-        for (int i=1; i<nx; ++i) {
-            for (int ind=0; ind < numVars; ++ind ) {
-                fprintf( fp, "%.5e ", (*list.getVariable(ind))(lev,i,j) );
+    // Write the data.  The rows are partitioned into chunks, each
+    // chunk is formatted into its own memory buffer (in parallel when
+    // OpenMP is enabled), and the buffers are then written to the file
+    // sequentially: the output is identical to formatting point by
+    // point through the stream, but the text conversion -- which
+    // dominates ASCII snapshot time -- is spread over the threads
+    const int chunkRows = 64;
+    vector<int> jStart;
+    for (int j=jBegin; j<=jEnd; j+=stride*chunkRows) {
+        jStart.push_back( j );
+    }
+    int numChunks = jStart.size();
+    vector<string> chunks( numChunks );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetNumThreads() ) \
+    if( GetNumThreads() > 1 )
+#endif
+    for (int c=0; c<numChunks; ++c) {
+        string& out = chunks[c];
+        // "%.5e " is at most 13 characters, plus the newline per point row
+        out.reserve( chunkRows * numI * ( numVars * 13 + 1 ) );
+        char field[32];
+        int jStop = jStart[c] + stride*chunkRows;
+        for (int j=jStart[c]; j<=jEnd && j<jStop; j+=stride) {
+            for (int i=iBegin; i<=iEnd; i+=stride) {
+                for (int ind=0; ind < numVars; ++ind ) {
+                    sprintf( field, "%.5e ", (*list.getVariable(ind))(lev,i,j) );
+                    out += field;
+                }
+                out += "\n";
             }
-            fprintf( fp, "\n" );
         }
     }
-    
+    bool status = true;
+    for (int c=0; c<numChunks; ++c) {
+        size_t nbytes = fwrite( chunks[c].data(), 1, chunks[c].size(), fp );
+        status = status && ( nbytes == chunks[c].size() );
+    }
+
     fclose(fp);
-    return true;
-}  
-    
+    return status;
+}
     
-bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev ) {
-    assert( varVec.size() > 0 );
-    assert( varVec.size() == varNameVec.size() );
     
-    // Get grid dimensions
-    const Grid& grid = varVec[0]->getGrid();
+// Fill the coordinate fields written as the x and y columns
+void TecplotCoordinates( const Grid& grid, Scalar& x, Scalar& y ) {
     int nx = grid.Nx();
     int ny = grid.Ny();
     int ngrid = grid.Ngrid();
-    assert( lev < ngrid );
-    
-    // Calculate the variables for output
-    // Calculate the grid
-    Scalar x(grid);
-    Scalar y(grid);
     for (int _lev=0; _lev<ngrid; ++_lev) {
         for (int i=1; i<nx; ++i) {
             for (int j=1; j<ny; ++j) {
@@ -100,7 +250,27 @@ bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, s
             }
         }
     }
-    
+}
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev, bool binary, const TecplotRegion& region ) {
+    assert( varVec.size() > 0 );
+
+    // Calculate the grid coordinates for this call only; callers that
+    // write many files should fill them once with TecplotCoordinates
+    // and use the overload taking them as arguments
+    const Grid& grid = varVec[0]->getGrid();
+    Scalar x(grid);
+    Scalar y(grid);
+    TecplotCoordinates( grid, x, y );
+    return ScalarToTecplot( varVec, varNameVec, filename, title, lev,
+                            binary, region, x, y );
+}
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev, bool binary, const TecplotRegion& region, const Scalar& x, const Scalar& y ) {
+    assert( varVec.size() > 0 );
+    assert( varVec.size() == varNameVec.size() );
+    assert( lev < varVec[0]->getGrid().Ngrid() );
+
     // Store pointers to variables and corresponding names in vectors
     VarList list;
     list.addVariable( &x, "x" );
@@ -116,10 +286,25 @@ bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, s
     strncpy( _title, title.c_str(), BUFSIZ-1 );
     
     // Write the Tecplot file
-    bool status = writeTecplotFileASCII( _filename, _title, list, lev );
+    bool status;
+    if ( binary ) {
+        status = writeTecplotFileBinary( _filename, _title, list, lev, region );
+    }
+    else {
+        status = writeTecplotFileASCII( _filename, _title, list, lev, region );
+    }
     return status;
 }
-    
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev, bool binary ) {
+    return ScalarToTecplot( varVec, varNameVec, filename, title, lev, binary,
+                            TecplotRegion() );
+}
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev ) {
+    return ScalarToTecplot( varVec, varNameVec, filename, title, lev, false );
+}
+
 bool ScalarToTecplot( const Scalar* var, string varName, string filename, string title, int lev ) {
     vector<const Scalar*> varVec;
     varVec.push_back( var );
@@ -9,14 +9,38 @@ using std::vector;
 
 namespace ibpm {
 
+/*! \brief Spatial subset applied when writing Tecplot files: an index
+    box on the interior nodes of the written level, plus a point stride.
+    The defaults select the full level */
+struct TecplotRegion {
+    int imin;
+    int jmin;
+    int imax;   ///< -1 selects up to the last interior node
+    int jmax;   ///< -1 selects up to the last interior node
+    int stride; ///< keep every stride-th point in each direction
+    TecplotRegion() : imin(1), jmin(1), imax(-1), jmax(-1), stride(1) {}
+};
+
 bool ScalarToTecplot( const Scalar* var, string varName, string filename, string title );
     
 bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title );
     
 bool ScalarToTecplot( const Scalar* var, string varName, string filename, string title, int lev );
 
-bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev );    
-    
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev );
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev, bool binary );
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev, bool binary, const TecplotRegion& region );
+
+/// \brief Fill x and y with the node coordinates of every grid level,
+/// as written in the Tecplot coordinate columns.  Callers that write
+/// many files (e.g. OutputTecplot) can fill these once and pass them to
+/// the overload below, instead of having them rebuilt on every call
+void TecplotCoordinates( const Grid& grid, Scalar& x, Scalar& y );
+
+bool ScalarToTecplot( vector<const Scalar*> varVec, vector<string> varNameVec, string filename, string title, int lev, bool binary, const TecplotRegion& region, const Scalar& x, const Scalar& y );
+
 } // namespace ibpm
 
 #endif /* _SCALARTOTECPLOT_H_ */
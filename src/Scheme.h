@@ -17,6 +17,7 @@ public:
             _coeff(0,1) = 0.;		// bn
 			_coeff(0,2) = 1.;		// cn
 			_name = "Explicit Euler";
+			_order = 1;
         }
         else if ( scheme == AB2 ) {
             _coeff.Allocate(1,3);
@@ -24,6 +25,7 @@ public:
             _coeff(0,1) = -1./2.;	// bn
 			_coeff(0,2) = 1.;		// cn
 			_name = "Adams Bashforth";
+			_order = 2;
         }
         else if ( scheme == RK3 ) {
             _coeff.Allocate(3,3);
@@ -37,6 +39,7 @@ public:
 			_coeff(1,2) = 2./3.;
 			_coeff(2,2) = 1.;
 			_name = "3rd-order Runge Kutta (3-step)";
+			_order = 3;
         }
         else if ( scheme == RK3b ) {
             _coeff.Allocate(4,3);
@@ -53,6 +56,7 @@ public:
 			_coeff(2,2) = 2./3.;
             _coeff(3,2) = 1.;
 			_name = "3rd-order Runge Kutta (4-step)";
+			_order = 3;
         }
 		else {
 			cout << endl << "ERROR: unrecognized solver: " << scheme << endl << endl;
@@ -65,10 +69,13 @@ public:
 	inline double cn( int i ) { return _coeff(i,2); }
     inline int nsteps() { return _coeff.Nx(); }
 	inline string name() { return _name; }
+	/// Formal order of accuracy, for Richardson error estimation
+	inline int order() { return _order; }
 	
 private:
 	Array::Array2<double> _coeff;
 	string _name;
+	int _order;
 	
 };
 
@@ -0,0 +1,99 @@
+// Simulation.cc
+//
+// Description:
+// Implementation of the minimal driver facade for running a simulation
+// in process (see Simulation.h).
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 29 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Simulation.h"
+#include <math.h>
+
+namespace ibpm {
+
+Simulation::Simulation( const Grid& grid, const Geometry& geometry,
+                        double Reynolds, double magnitude, double alpha,
+                        double dt, Scheme::SchemeType scheme ) :
+    _grid( grid ),
+    _geometry( geometry ),
+    _baseFlow( _grid, magnitude, alpha ),
+    _model( _grid, _geometry, Reynolds, _baseFlow ),
+    _solver( _grid, _model, dt, scheme ),
+    _x( _grid, _geometry.getNumPoints() ),
+    _initialized( false )
+{
+    resetState();
+}
+
+Simulation::Simulation( const Grid& grid, const Geometry& geometry,
+                        double Reynolds, const BaseFlow& baseFlow,
+                        double dt, Scheme::SchemeType scheme ) :
+    _grid( grid ),
+    _geometry( geometry ),
+    _baseFlow( baseFlow ),
+    _model( _grid, _geometry, Reynolds, _baseFlow ),
+    _solver( _grid, _model, dt, scheme ),
+    _x( _grid, _geometry.getNumPoints() ),
+    _initialized( false )
+{
+    resetState();
+}
+
+Simulation::~Simulation() {}
+
+void Simulation::init() {
+    if ( _initialized ) return;
+    _model.init();
+    _solver.init();
+    _initialized = true;
+}
+
+void Simulation::resetState() {
+    _x.omega = 0.;
+    _x.q = 0.;
+    _x.f = 0.;
+    _x.timestep = 0;
+    _x.time = 0.;
+    _geometry.moveBodies( 0. );
+    // Clear the multistep history so the next advance restarts the
+    // scheme; the initialized operators are untouched
+    _solver.reset();
+}
+
+void Simulation::advance() {
+    if ( ! _initialized ) init();
+    _solver.advance( _x );
+}
+
+void Simulation::advance( int numSteps ) {
+    for (int i=0; i<numSteps; ++i) {
+        advance();
+    }
+}
+
+bool Simulation::loadState( const std::string& filename ) {
+    return _x.load( filename );
+}
+
+bool Simulation::saveState( const std::string& filename ) const {
+    return _x.save( filename );
+}
+
+void Simulation::getForceCoefficients( double& drag, double& lift ) const {
+    double xF;
+    double yF;
+    _x.computeNetForce( xF, yF );
+    double alpha = _baseFlow.getAlpha();
+    drag = 2. * (  xF * cos(alpha) + yF * sin(alpha) );
+    lift = 2. * ( -xF * sin(alpha) + yF * cos(alpha) );
+}
+
+} // namespace ibpm
@@ -0,0 +1,112 @@
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include "Grid.h"
+#include "Geometry.h"
+#include "BaseFlow.h"
+#include "NavierStokesModel.h"
+#include "IBSolver.h"
+#include "State.h"
+#include <string>
+
+namespace ibpm {
+
+/*!
+    \file Simulation.h
+    \class Simulation
+
+    \brief Minimal driver facade for running a simulation in process
+
+    Bundles the objects every driver assembles by hand (Grid, Geometry,
+    BaseFlow, NavierStokesModel, NonlinearIBSolver, State) behind a
+    small stable interface, for callers that embed the solver in a
+    larger program -- e.g. a design-optimization loop evaluating
+    hundreds of cases.  The expensive setup (FFT plans, the
+    regularizer, and any projection-step factorization) happens once in
+    init(); after that, each evaluation is resetState() followed by
+    advance(), so repeated evaluations with the same grid and geometry
+    reuse the warm operators instead of paying process startup and
+    initialization per case.
+
+    The underlying model and solver remain reachable through model()
+    and solver() for options the facade does not wrap (tolerances,
+    adaptive timestepping, and so on); see IBSolver.h.  Drivers that
+    need a different solver type (linearized, adjoint, SFD) should
+    assemble the pieces directly, as the examples do.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 29 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+class Simulation {
+public:
+    /// \brief Constructor: uniform background flow with the given
+    /// magnitude and angle of attack.  Copies of the grid, geometry,
+    /// and base flow are kept internally, so the caller's objects need
+    /// not outlive the simulation
+    Simulation( const Grid& grid, const Geometry& geometry, double Reynolds,
+                double magnitude, double alpha, double dt,
+                Scheme::SchemeType scheme = Scheme::AB2 );
+
+    /// \brief Constructor with an arbitrary base flow
+    Simulation( const Grid& grid, const Geometry& geometry, double Reynolds,
+                const BaseFlow& baseFlow, double dt,
+                Scheme::SchemeType scheme = Scheme::AB2 );
+
+    ~Simulation();
+
+    /// \brief Perform the one-time setup of the model and solver.
+    /// Called automatically by the first advance() if not called
+    /// explicitly
+    void init();
+
+    /// \brief Return the state to a zero initial condition at time
+    /// zero, clearing the solver's multistep history, without touching
+    /// the initialized operators.  Starts the next evaluation
+    void resetState();
+
+    /// \brief Advance the state by one timestep
+    void advance();
+
+    /// \brief Advance the state by the given number of timesteps
+    void advance( int numSteps );
+
+    /// \brief Load the state from a restart file (see State::load)
+    bool loadState( const std::string& filename );
+
+    /// \brief Save the state to a restart file
+    bool saveState( const std::string& filename ) const;
+
+    /// \brief Return the current drag and lift coefficients, rotated by
+    /// the base flow's angle of attack (same convention as OutputForce)
+    void getForceCoefficients( double& drag, double& lift ) const;
+
+    /// The state being advanced
+    inline State& state() { return _x; }
+    inline const State& state() const { return _x; }
+
+    inline const Grid& grid() const { return _grid; }
+    inline const Geometry& geometry() const { return _geometry; }
+
+    /// The underlying model and solver, for options not wrapped here
+    inline NavierStokesModel& model() { return _model; }
+    inline IBSolver& solver() { return _solver; }
+
+private:
+    // Declaration order matters: the model and solver hold references
+    // to the members above them
+    Grid _grid;
+    Geometry _geometry;
+    BaseFlow _baseFlow;
+    NavierStokesModel _model;
+    NonlinearIBSolver _solver;
+    State _x;
+    bool _initialized;
+};
+
+} // namespace ibpm
+
+#endif /* _SIMULATION_H_ */
@@ -14,60 +14,782 @@
 // $HeadURL$
 
 #include "State.h"
+#include "Memory.h"
+#include "Kernels.h"
+#include <algorithm>
 #include <string>
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <zlib.h>
 
 using namespace ibpm;
 
 namespace ibpm {
 
+// Compressed restart files carry this magic string, followed by a format
+// version, the uncompressed length, and zlib-compressed blocks of the
+// ordinary restart record
+static const char ZMAGIC[9] = "IBPMZSTA";
+static const int ZMAGIC_LEN = 8;
+// Version 2 added the metadata block after the raw length (see
+// writeCompressedMetadata), so headers can be scanned without inflating
+static const int ZVERSION = 2;
+static const size_t ZBLOCK_SIZE = 1 << 20;    // 1 MB of raw data per block
+
+// Single-precision records carry this magic string before the header;
+// the grid info and time remain doubles, the field data are floats
+static const char FMAGIC[9] = "IBPMFSTA";
+static const int FMAGIC_LEN = 8;
+
+// Delta restart files carry this magic string, followed by the name of
+// the keyframe file they difference against and the differences
+// themselves, as floats or quantized 16-bit integers (see saveDelta)
+static const char DMAGIC[9] = "IBPMDSTA";
+static const int DMAGIC_LEN = 8;
+static const int DVERSION = 1;
+
+// Compact restart files carry this magic string, followed by the header
+// of the full multi-domain grid but only the finest-level field data
+// (see saveCompact)
+static const char CMAGIC[9] = "IBPMCSTA";
+static const int CMAGIC_LEN = 8;
+static const int CVERSION = 1;
+
+// Sparse snapshot files carry this magic string, followed by the full
+// grid header and, per level, only the vorticity tiles whose peak
+// magnitude exceeds the stored threshold; the flux is omitted entirely
+// (see saveSparse)
+static const char SMAGIC[9] = "IBPMSSTA";
+static const int SMAGIC_LEN = 8;
+static const int SVERSION = 1;
+// Edge length of the square vorticity tiles, in gridpoints
+static const int STILE = 8;
+
+// Quantized snapshot files carry this magic string, followed by the
+// full grid header and the vorticity of every level stored as 16-bit
+// integers with a scale and offset per tile; the flux is omitted, as
+// for sparse files (see saveQuantized)
+static const char QMAGIC[9] = "IBPMQSTA";
+static const int QMAGIC_LEN = 8;
+static const int QVERSION = 1;
+
+// See setUncachedWrites
+static bool _uncachedWrites = false;
+
+// Finish writing a checkpoint file without leaving it in the page
+// cache: flush the dirty pages to disk now, on the calling (writer)
+// thread, and drop them, so multi-GB checkpoints neither evict the
+// solver's working set nor pile up for background writeback to flush
+// at an arbitrary later moment.  Called just before closing each
+// file-backed save
+static void finishUncached( FILE* fp ) {
+    if ( ! _uncachedWrites ) return;
+    fflush( fp );
+#ifndef _WIN32
+    int fd = fileno( fp );
+    fdatasync( fd );
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+#endif
+#endif
+}
+
+// Read one field value, stored as a float or a double
+static bool readValue( FILE* fp, bool singlePrecision, double& x ) {
+    if ( singlePrecision ) {
+        float v;
+        if ( fread( &v, sizeof( float ), 1, fp ) != 1 ) return false;
+        x = v;
+        return true;
+    }
+    return fread( &x, sizeof( double ), 1, fp ) == 1;
+}
+
+// Write one field value, as a float or a double
+static void writeValue( FILE* fp, bool singlePrecision, double x ) {
+    if ( singlePrecision ) {
+        float v = x;
+        fwrite( &v, sizeof( float ), 1, fp );
+    }
+    else {
+        fwrite( &x, sizeof( double ), 1, fp );
+    }
+}
+
+// Write one field difference, as a float or (quantized) as a 16-bit
+// integer in units of scale
+static void writeDelta( FILE* fp, bool quantized, double scale, double d ) {
+    if ( quantized ) {
+        double s = ( scale > 0. ) ? d / scale : 0.;
+        short v = (short) ( s >= 0. ? s + 0.5 : s - 0.5 );
+        fwrite( &v, sizeof( short ), 1, fp );
+    }
+    else {
+        float v = d;
+        fwrite( &v, sizeof( float ), 1, fp );
+    }
+}
+
+// Read one field difference, stored as a float or a quantized 16-bit
+// integer
+static bool readDelta( FILE* fp, bool quantized, double scale, double& d ) {
+    if ( quantized ) {
+        short v;
+        if ( fread( &v, sizeof( short ), 1, fp ) != 1 ) return false;
+        d = v * scale;
+        return true;
+    }
+    float v;
+    if ( fread( &v, sizeof( float ), 1, fp ) != 1 ) return false;
+    d = v;
+    return true;
+}
+
 State::State() {
     timestep = 0;
     time = 0.;
+    _mapBase = NULL;
+    _mapLength = 0;
+    _arena = NULL;
+    _arenaSize = 0;
+    _arenaRefs = NULL;
 }
 
 State::State(const Grid& grid, int numPoints ) {
     timestep = 0;
     time = 0.;
+    _mapBase = NULL;
+    _mapLength = 0;
+    _arena = NULL;
+    _arenaSize = 0;
+    _arenaRefs = NULL;
     resize( grid, numPoints );
 }
 
+State::State( const State& x ) {
+    timestep = x.timestep;
+    time = x.time;
+    _mapBase = NULL;
+    _mapLength = 0;
+    _arena = NULL;
+    _arenaSize = 0;
+    _arenaRefs = NULL;
+    if ( x._arena != NULL ) {
+        // Constant-time copy: share x's arena until one of the two
+        // states is written to (copy-on-write; see detachData)
+        shareArena( x );
+    }
+    else {
+        // x is a view of a mapped file: allocate through resize, so the
+        // copy is arena-backed, and copy field by field
+        resize( x.q.getGrid(), x.f.getNumPoints() );
+        q = x.q;
+        omega = x.omega;
+        f = x.f;
+    }
+}
+
+State& State::operator=( const State& x ) {
+    if ( &x == this ) return *this;
+    timestep = x.timestep;
+    time = x.time;
+    if ( x._arena != NULL ) {
+        // Constant-time assignment: drop this state's arena and share
+        // x's copy-on-write (see detachData)
+        if ( _arena != x._arena ) {
+            releaseArena();
+            shareArena( x );
+        }
+        return *this;
+    }
+    // x is a view of a mapped file: deep copy, reallocating if the
+    // dimensions differ or this state is itself a mapped view
+    if ( _mapBase != NULL ||
+         ! q.getGrid().isEqualTo( x.q.getGrid() ) ||
+         f.getNumPoints() != x.f.getNumPoints() ) {
+        resize( x.q.getGrid(), x.f.getNumPoints() );
+    }
+    q = x.q;
+    omega = x.omega;
+    f = x.f;
+    return *this;
+}
+
+void State::shareArena( const State& x ) {
+    // Adopt x's arena: both states' fields view the same block, and
+    // whichever state is written to first detaches with a private copy.
+    // Copies of a const state must mark its fields shared too, hence
+    // the const_cast (the share bookkeeping is mutable; see Field)
+    _arena = x._arena;
+    _arenaSize = x._arenaSize;
+    _arenaRefs = x._arenaRefs;
+    __sync_add_and_fetch( _arenaRefs, 1 );
+    const Grid& grid = x.q.getGrid();
+    int numPoints = x.f.getNumPoints();
+    unsigned int qSize = x.q.getSize();
+    unsigned int omegaSize = x.omega.getSize();
+    q.viewExternal( grid, _arena );
+    omega.viewExternal( grid, _arena + qSize );
+    f.viewExternal( numPoints, _arena + qSize + omegaSize );
+    q.shareData( this );
+    omega.shareData( this );
+    f.shareData( this );
+    State* xp = const_cast<State*>( &x );
+    x.q.shareData( xp );
+    x.omega.shareData( xp );
+    x.f.shareData( xp );
+    unmap();
+}
+
+void State::detachData() {
+    if ( _arenaRefs == NULL || *_arenaRefs == 1 ) {
+        // The other owners have already let go: keep writing in place
+        q.unshareData();
+        omega.unshareData();
+        f.unshareData();
+        return;
+    }
+    // Give this state a private copy of the shared arena.  The other
+    // owners keep the old block, so readers of it (e.g. the
+    // asynchronous output thread) are unaffected
+    double* fresh;
+    {
+        ScopedMemoryTag memTag( Memory::STATE );
+        fresh = acquireFieldBuffer( _arenaSize );
+    }
+    std::copy( _arena, _arena + _arenaSize, fresh );
+    if ( __sync_sub_and_fetch( _arenaRefs, 1 ) == 0 ) {
+        // The last other owner let go while the copy was being made
+        delete _arenaRefs;
+        releaseFieldBuffer( _arena, _arenaSize );
+    }
+    _arena = fresh;
+    _arenaRefs = new int( 1 );
+    Grid grid = q.getGrid();
+    unsigned int qSize = q.getSize();
+    unsigned int omegaSize = omega.getSize();
+    q.viewExternal( grid, _arena );
+    omega.viewExternal( grid, _arena + qSize );
+    f.viewExternal( f.getNumPoints(), _arena + qSize + omegaSize );
+}
+
 void State::resize( const Grid& grid, int numPoints ) {
-    q.resize( grid );
-    omega.resize( grid );
-    f.resize( numPoints );
+    // Back the three fields with a single contiguous arena -- q, then
+    // omega, then f, matching the restart-record order -- so that
+    // whole-state copies and axpy updates (see StateVector) and the
+    // double-precision field I/O below run over one block instead of
+    // three separate allocations.  The size expressions mirror the
+    // fields' own resize methods
+    releaseArena();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    unsigned int qSize = grid.Ngrid() * ( 2 * nx * ny + nx + ny );
+    unsigned int omegaSize = grid.Ngrid() * ( nx - 1 ) * ( ny - 1 );
+    unsigned int fSize = 2 * numPoints;
+    _arenaSize = qSize + omegaSize + fSize;
+    {
+        ScopedMemoryTag memTag( Memory::STATE );
+        _arena = acquireFieldBuffer( _arenaSize );
+    }
+    _arenaRefs = new int( 1 );
+    q.viewExternal( grid, _arena );
+    omega.viewExternal( grid, _arena + qSize );
+    f.viewExternal( numPoints, _arena + qSize + omegaSize );
+    // The fields no longer point into any file mapping, so release it
+    unmap();
 }
 
 State::State( string filename ) {
     timestep = 0;
     time = 0.;
+    _mapBase = NULL;
+    _mapLength = 0;
+    _arena = NULL;
+    _arenaSize = 0;
+    _arenaRefs = NULL;
     load( filename );
 }
 
-State::~State() {}
+State::~State() {
+    releaseArena();
+    unmap();
+}
+
+void State::releaseArena() {
+    if ( _arena == NULL ) return;
+    // Drop this state's reference; the arena goes back to the pool only
+    // when the last owner lets go
+    if ( _arenaRefs == NULL || __sync_sub_and_fetch( _arenaRefs, 1 ) == 0 ) {
+        delete _arenaRefs;
+        releaseFieldBuffer( _arena, _arenaSize );
+    }
+    _arena = NULL;
+    _arenaSize = 0;
+    _arenaRefs = NULL;
+}
+
+void State::unmap() {
+    if ( _mapBase != NULL ) {
+        munmap( _mapBase, _mapLength );
+        _mapBase = NULL;
+        _mapLength = 0;
+    }
+}
     
 // Routine for computing X & Y forces
 // Note that f is actually a body force (force per unit mass), so the net
 // force is the integral over the domain.  By a property of the discrete
 // delta function, this equals a sum of the BoundaryVector values times dx^2
 void State::computeNetForce( double& xforce, double& yforce) const {
-    xforce = 0;
-    yforce = 0;
-    for( int i=0; i<f.getNumPoints(); i++ ) {
-        xforce += f(X,i);
-        yforce += f(Y,i);
-    }
+    // Fixed-order compensated sums over the component blocks: bitwise
+    // reproducible regardless of threading, and robust when opposing
+    // forces on the boundary nearly cancel
+    int n = f.getNumPoints();
     double dx2 = omega.Dx() * omega.Dx();
-    xforce *= dx2;
-    yforce *= dx2;
+    xforce = Kernels::CompensatedSum( f.component(X), n ) * dx2;
+    yforce = Kernels::CompensatedSum( f.component(Y), n ) * dx2;
 }
 
-bool State::load(const std::string& filename) {
+// Force and moment on a contiguous range of boundary points, with the
+// same dx^2 weighting (and the same compensated force sums) as
+// computeNetForce.  The moment about (xc,yc),
+//     sum (x - xc) fy - (y - yc) fx,
+// is rearranged so the coordinate sums are plain dot products
+void State::computeBodyForce(
+    int begin,
+    int end,
+    const BoundaryVector& points,
+    double xCenter,
+    double yCenter,
+    double& xforce,
+    double& yforce,
+    double& moment
+    ) const {
+    int n = end - begin;
+    double dx2 = omega.Dx() * omega.Dx();
+    const double* fx = f.component(X) + begin;
+    const double* fy = f.component(Y) + begin;
+    xforce = Kernels::CompensatedSum( fx, n ) * dx2;
+    yforce = Kernels::CompensatedSum( fy, n ) * dx2;
+    const double* px = points.component(X) + begin;
+    const double* py = points.component(Y) + begin;
+    moment = Kernels::Dot( px, fy, n ) * dx2 - xCenter * yforce
+           - Kernels::Dot( py, fx, n ) * dx2 + yCenter * xforce;
+}
+
+// Metadata block stored in the compressed container header (version 2),
+// mirroring the header and tail of the inflated record
+static const size_t ZMETA_BYTES =
+    5 * sizeof( int ) + 4 * sizeof( double );
+
+// Read a compressed restart record from fp (positioned just past the
+// magic string) into the state
+static bool loadCompressed( FILE* fp, State& x ) {
+    int version;
+    long long rawBytes;
+    if ( fread( &version, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( version < 1 || version > ZVERSION ) return false;
+    if ( fread( &rawBytes, sizeof( long long ), 1, fp ) != 1 ) return false;
+    if ( rawBytes <= 0 ) return false;
+    if ( version >= 2 ) {
+        // metadata duplicates what the record itself carries: skip it
+        if ( fseeko( fp, ZMETA_BYTES, SEEK_CUR ) != 0 ) return false;
+    }
+
+    // Inflate the blocks into one buffer holding the plain restart record
+    std::vector<char> raw( rawBytes );
+    std::vector<Bytef> cbuf;
+    long long off = 0;
+    while ( off < rawBytes ) {
+        int compLen, rawLen;
+        if ( fread( &compLen, sizeof( int ), 1, fp ) != 1 ) return false;
+        if ( fread( &rawLen, sizeof( int ), 1, fp ) != 1 ) return false;
+        if ( compLen <= 0 || rawLen <= 0 || off + rawLen > rawBytes ) return false;
+        cbuf.resize( compLen );
+        if ( fread( &cbuf[0], 1, compLen, fp ) != (size_t) compLen ) return false;
+        uLongf destLen = rawLen;
+        if ( uncompress( (Bytef*) &raw[off], &destLen, &cbuf[0],
+                         (uLong) compLen ) != Z_OK ) return false;
+        if ( destLen != (uLongf) rawLen ) return false;
+        off += rawLen;
+    }
+
+    // Parse the record as if it were an ordinary restart file
+    FILE* mem = fmemopen( &raw[0], rawBytes, "rb" );
+    if ( mem == NULL ) return false;
+    bool success = x.load( mem );
+    fclose( mem );
+    return success;
+}
+
+// Read a delta restart record from fp (positioned just past the magic
+// string): load the keyframe file it names, then apply the stored
+// differences.  filename is the delta file's own name, used to resolve
+// the keyframe name relative to its directory
+static bool loadDelta( FILE* fp, const std::string& filename, State& x ) {
+    int version;
+    int quantized;
+    int refLen;
+    if ( fread( &version, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( version < 1 || version > DVERSION ) return false;
+    if ( fread( &quantized, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( fread( &refLen, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( refLen <= 0 || refLen > 4096 ) return false;
+    std::string refName( refLen, '\0' );
+    if ( fread( &refName[0], 1, refLen, fp ) != (size_t) refLen ) return false;
+    if ( refName[0] != '/' ) {
+        size_t slash = filename.rfind( '/' );
+        if ( slash != std::string::npos ) {
+            refName = filename.substr( 0, slash + 1 ) + refName;
+        }
+    }
+
+    // Load the keyframe into the state (this recursion also handles
+    // compressed keyframes), then apply the differences in place
+    cerr << "(keyframe) ";
+    if ( ! x.load( refName ) ) return false;
+
+    // The header must match the keyframe: a delta of one run against the
+    // keyframe of another is meaningless
+    int nx, ny, ngrid, numPoints;
+    double dx, x0, y0;
+    bool success =
+        fread( &nx, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ny, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ngrid, sizeof( int ), 1, fp ) == 1 &&
+        fread( &dx, sizeof( double ), 1, fp ) == 1 &&
+        fread( &x0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &y0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &numPoints, sizeof( int ), 1, fp ) == 1;
+    if ( ! success ||
+         nx != x.q.Nx() ||
+         ny != x.q.Ny() ||
+         ngrid != x.q.Ngrid() ||
+         dx != x.q.Dx() ||
+         x0 != x.q.getXEdge(0,0) ||
+         y0 != x.q.getYEdge(0,0) ||
+         numPoints != x.f.getNumPoints() ) {
+        cerr << "Warning: delta file does not match its keyframe." << endl;
+        return false;
+    }
+
+    double qScale = 1.;
+    double omegaScale = 1.;
+    double fScale = 1.;
+    if ( quantized ) {
+        success = success &&
+            fread( &qScale, sizeof( double ), 1, fp ) == 1 &&
+            fread( &omegaScale, sizeof( double ), 1, fp ) == 1 &&
+            fread( &fScale, sizeof( double ), 1, fp ) == 1;
+    }
+
+    double d;
+    Flux::index qind;
+    for ( int lev=0; lev < ngrid; ++lev ) {
+        for ( qind = x.q.begin(); qind != x.q.end(); ++qind ) {
+            success = success && readDelta( fp, quantized, qScale, d );
+            x.q(lev,qind) += d;
+        }
+    }
+    for ( int lev=0; lev < ngrid; ++lev ) {
+        for (int i=1; i<nx; ++i ) {
+            for ( int j=1; j<ny; ++j ) {
+                success = success && readDelta( fp, quantized, omegaScale, d );
+                x.omega(lev,i,j) += d;
+            }
+        }
+    }
+    for ( int i=0; i < numPoints; ++i ) {
+        success = success && readDelta( fp, quantized, fScale, d );
+        x.f(X,i) += d;
+        success = success && readDelta( fp, quantized, fScale, d );
+        x.f(Y,i) += d;
+    }
+
+    success = success && fread( &x.timestep, sizeof(int), 1, fp );
+    success = success && fread( &x.time, sizeof(double), 1, fp );
+    return success;
+}
+
+// Read a compact restart record from fp (positioned just past the magic
+// string): the finest-level fields fill level 0, and the coarse
+// vorticity levels are rebuilt by averaging down (Scalar::coarsify).
+// The coarse flux levels stay zero; the solver re-derives the flux from
+// the vorticity on its first refreshState
+static bool loadCompact( FILE* fp, State& x ) {
+    int version;
+    if ( fread( &version, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( version < 1 || version > CVERSION ) return false;
+
+    int nx, ny, ngrid, numPoints;
+    double dx, x0, y0;
+    bool success =
+        fread( &nx, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ny, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ngrid, sizeof( int ), 1, fp ) == 1 &&
+        fread( &dx, sizeof( double ), 1, fp ) == 1 &&
+        fread( &x0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &y0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &numPoints, sizeof( int ), 1, fp ) == 1 &&
+        nx > 0 && ny > 0 && ngrid > 0 && numPoints >= 0;
+    if ( ! success ) return false;
+
+    if ( nx != x.q.Nx() ||
+         ny != x.q.Ny() ||
+         ngrid != x.q.Ngrid() ||
+         dx != x.q.Dx() ||
+         x0 != x.q.getXEdge(0,0) ||
+         y0 != x.q.getYEdge(0,0) ||
+         numPoints != x.f.getNumPoints() ) {
+        if ( x.q.Nx() > 0 ) {
+            cerr << "Warning: grids do not match.  Resizing grid." << endl;
+        }
+        Grid newgrid( nx, ny, ngrid, dx * nx, x0, y0 );
+        x.resize( newgrid, numPoints );
+    }
+    x.q = 0.;
+    x.omega = 0.;
 
+    // finest-level fields, in their storage order
+    unsigned int numFluxes = 2 * nx * ny + nx + ny;
+    unsigned int numOmega = ( nx - 1 ) * ( ny - 1 );
+    success =
+        fread( x.q.flatten(0), sizeof( double ), numFluxes, fp )
+            == numFluxes &&
+        fread( x.omega.flatten(0), sizeof( double ), numOmega, fp )
+            == numOmega;
+
+    for ( int i=0; i < numPoints; ++i ) {
+        success = success &&
+            fread( &x.f(X,i), sizeof( double ), 1, fp ) == 1 &&
+            fread( &x.f(Y,i), sizeof( double ), 1, fp ) == 1;
+    }
+    success = success && fread( &x.timestep, sizeof(int), 1, fp ) == 1;
+    success = success && fread( &x.time, sizeof(double), 1, fp ) == 1;
+
+    // Rebuild the coarse vorticity levels from the finest
+    if ( success ) x.omega.coarsify();
+    return success;
+}
+
+// Read a sparse snapshot record from fp (positioned just past the magic
+// string): the vorticity of every level is rebuilt dense, with the
+// tiles absent from the file set to zero.  The flux was not stored and
+// stays zero; the solver re-derives it from the vorticity on its first
+// refreshState, as for compact records
+static bool loadSparse( FILE* fp, State& x ) {
+    int version;
+    if ( fread( &version, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( version < 1 || version > SVERSION ) return false;
+
+    int nx, ny, ngrid, numPoints;
+    double dx, x0, y0;
+    bool success =
+        fread( &nx, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ny, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ngrid, sizeof( int ), 1, fp ) == 1 &&
+        fread( &dx, sizeof( double ), 1, fp ) == 1 &&
+        fread( &x0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &y0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &numPoints, sizeof( int ), 1, fp ) == 1 &&
+        nx > 0 && ny > 0 && ngrid > 0 && numPoints >= 0;
+    if ( ! success ) return false;
+
+    double threshold;
+    int tile;
+    success =
+        fread( &threshold, sizeof( double ), 1, fp ) == 1 &&
+        fread( &tile, sizeof( int ), 1, fp ) == 1 &&
+        tile > 0;
+    if ( ! success ) return false;
+
+    if ( nx != x.q.Nx() ||
+         ny != x.q.Ny() ||
+         ngrid != x.q.Ngrid() ||
+         dx != x.q.Dx() ||
+         x0 != x.q.getXEdge(0,0) ||
+         y0 != x.q.getYEdge(0,0) ||
+         numPoints != x.f.getNumPoints() ) {
+        if ( x.q.Nx() > 0 ) {
+            cerr << "Warning: grids do not match.  Resizing grid." << endl;
+        }
+        Grid newgrid( nx, ny, ngrid, dx * nx, x0, y0 );
+        x.resize( newgrid, numPoints );
+    }
+    x.q = 0.;
+    x.omega = 0.;
+
+    // number of tiles covering the interior, per direction
+    int ntx = ( nx - 1 + tile - 1 ) / tile;
+    int nty = ( ny - 1 + tile - 1 ) / tile;
+    for ( int lev=0; lev < ngrid && success; ++lev ) {
+        int numActive;
+        if ( fread( &numActive, sizeof( int ), 1, fp ) != 1 ||
+             numActive < 0 || numActive > ntx * nty ) return false;
+        for ( int n=0; n < numActive && success; ++n ) {
+            int t;
+            if ( fread( &t, sizeof( int ), 1, fp ) != 1 ||
+                 t < 0 || t >= ntx * nty ) return false;
+            int i0 = 1 + ( t / nty ) * tile;
+            int j0 = 1 + ( t % nty ) * tile;
+            int i1 = ( i0 + tile < nx ) ? i0 + tile : nx;
+            int j1 = ( j0 + tile < ny ) ? j0 + tile : ny;
+            for ( int i=i0; i < i1; ++i ) {
+                for ( int j=j0; j < j1; ++j ) {
+                    float v;
+                    success = success &&
+                        fread( &v, sizeof( float ), 1, fp ) == 1;
+                    x.omega(lev,i,j) = v;
+                }
+            }
+        }
+    }
+
+    for ( int i=0; i < numPoints; ++i ) {
+        success = success &&
+            fread( &x.f(X,i), sizeof( double ), 1, fp ) == 1 &&
+            fread( &x.f(Y,i), sizeof( double ), 1, fp ) == 1;
+    }
+    success = success && fread( &x.timestep, sizeof(int), 1, fp ) == 1;
+    success = success && fread( &x.time, sizeof(double), 1, fp ) == 1;
+    return success;
+}
+
+// Read one quantized snapshot record, after the magic string (see
+// saveQuantized): each tile's 16-bit codes are mapped back through its
+// stored offset and scale.  The flux was not stored and stays zero, to
+// be re-derived by the solver, as for sparse records
+static bool loadQuantized( FILE* fp, State& x ) {
+    int version;
+    if ( fread( &version, sizeof( int ), 1, fp ) != 1 ) return false;
+    if ( version < 1 || version > QVERSION ) return false;
+
+    int nx, ny, ngrid, numPoints;
+    double dx, x0, y0;
+    bool success =
+        fread( &nx, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ny, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ngrid, sizeof( int ), 1, fp ) == 1 &&
+        fread( &dx, sizeof( double ), 1, fp ) == 1 &&
+        fread( &x0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &y0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &numPoints, sizeof( int ), 1, fp ) == 1 &&
+        nx > 0 && ny > 0 && ngrid > 0 && numPoints >= 0;
+    if ( ! success ) return false;
+
+    int tile;
+    if ( fread( &tile, sizeof( int ), 1, fp ) != 1 || tile <= 0 ) {
+        return false;
+    }
+
+    if ( nx != x.q.Nx() ||
+         ny != x.q.Ny() ||
+         ngrid != x.q.Ngrid() ||
+         dx != x.q.Dx() ||
+         x0 != x.q.getXEdge(0,0) ||
+         y0 != x.q.getYEdge(0,0) ||
+         numPoints != x.f.getNumPoints() ) {
+        if ( x.q.Nx() > 0 ) {
+            cerr << "Warning: grids do not match.  Resizing grid." << endl;
+        }
+        Grid newgrid( nx, ny, ngrid, dx * nx, x0, y0 );
+        x.resize( newgrid, numPoints );
+    }
+    x.q = 0.;
+
+    // number of tiles covering the interior, per direction
+    int ntx = ( nx - 1 + tile - 1 ) / tile;
+    int nty = ( ny - 1 + tile - 1 ) / tile;
+    for ( int lev=0; lev < ngrid && success; ++lev ) {
+        for ( int t=0; t < ntx * nty && success; ++t ) {
+            float offset, scale;
+            success =
+                fread( &offset, sizeof( float ), 1, fp ) == 1 &&
+                fread( &scale, sizeof( float ), 1, fp ) == 1;
+            int i0 = 1 + ( t / nty ) * tile;
+            int j0 = 1 + ( t % nty ) * tile;
+            int i1 = ( i0 + tile < nx ) ? i0 + tile : nx;
+            int j1 = ( j0 + tile < ny ) ? j0 + tile : ny;
+            for ( int i=i0; i < i1 && success; ++i ) {
+                for ( int j=j0; j < j1; ++j ) {
+                    unsigned short v;
+                    success = success &&
+                        fread( &v, sizeof( unsigned short ), 1, fp ) == 1;
+                    x.omega(lev,i,j) = offset + scale * v;
+                }
+            }
+        }
+    }
+
+    for ( int i=0; i < numPoints; ++i ) {
+        success = success &&
+            fread( &x.f(X,i), sizeof( double ), 1, fp ) == 1 &&
+            fread( &x.f(Y,i), sizeof( double ), 1, fp ) == 1;
+    }
+    success = success && fread( &x.timestep, sizeof(int), 1, fp ) == 1;
+    success = success && fread( &x.time, sizeof(double), 1, fp ) == 1;
+    return success;
+}
+
+bool State::load(const std::string& filename) {
     cerr << "Reading restart file " << filename << "..." << flush;
     FILE* fp = fopen( filename.c_str(), "rb" );
     if ( fp == NULL ) return false;
+    // Check for a compressed or delta restart file; plain records never
+    // start with a magic string (the first word is nx)
+    bool success;
+    char magic[ZMAGIC_LEN];
+    size_t got = fread( magic, 1, ZMAGIC_LEN, fp );
+    if ( got == (size_t) ZMAGIC_LEN &&
+         strncmp( magic, ZMAGIC, ZMAGIC_LEN ) == 0 ) {
+        success = loadCompressed( fp, *this );
+    }
+    else if ( got == (size_t) DMAGIC_LEN &&
+              strncmp( magic, DMAGIC, DMAGIC_LEN ) == 0 ) {
+        success = loadDelta( fp, filename, *this );
+    }
+    else if ( got == (size_t) CMAGIC_LEN &&
+              strncmp( magic, CMAGIC, CMAGIC_LEN ) == 0 ) {
+        success = loadCompact( fp, *this );
+    }
+    else {
+        rewind( fp );
+        success = load( fp );
+    }
+    fclose( fp );
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::load( FILE* fp ) {
+    // Check for a single-precision or sparse record (see save with
+    // singlePrecision, and saveSparse); double-precision records have no
+    // magic string (their first word is nx)
+    off_t start = ftello( fp );
+    char magic[FMAGIC_LEN];
+    if ( fread( magic, 1, FMAGIC_LEN, fp ) == (size_t) FMAGIC_LEN ) {
+        if ( strncmp( magic, FMAGIC, FMAGIC_LEN ) == 0 ) {
+            return readRecord( fp, true );
+        }
+        if ( strncmp( magic, SMAGIC, SMAGIC_LEN ) == 0 ) {
+            return loadSparse( fp, *this );
+        }
+        if ( strncmp( magic, QMAGIC, QMAGIC_LEN ) == 0 ) {
+            return loadQuantized( fp, *this );
+        }
+    }
+    fseeko( fp, start, SEEK_SET );
+    return readRecord( fp, false );
+}
 
+bool State::readRecord( FILE* fp, bool singlePrecision ) {
     // read Grid info
     int nx;
     int ny;
@@ -122,45 +844,1011 @@ bool State::load(const std::string& filename) {
         resize( newgrid, numPoints );
     }
 
-    // read Flux q
-    Flux::index qind;
-    for ( int lev=0; lev < q.Ngrid(); ++lev ) {
-        for ( qind = q.begin(); qind != q.end(); ++qind ) {
-            success = success && fread( &( q(lev,qind) ), sizeof( double ), 1, fp );
-        }
+    // A shared arena is about to be overwritten wholesale: replace it
+    // with a fresh one rather than detaching with a copy
+    if ( _arenaRefs != NULL && *_arenaRefs > 1 ) {
+        resize( q.getGrid(), f.getNumPoints() );
     }
-    
-    // read Scalar omega
-    for ( int lev=0; lev < q.Ngrid(); ++lev ) {
-        for (int i=1; i<nx; ++i ) {
-            for ( int j=1; j<ny; ++j ) {
-                success = success && fread( &( omega(lev,i,j) ), sizeof( double ), 1, fp );
+
+    // read Flux q and Scalar omega.  A double-precision record stores
+    // them in the same order as the arena (all q, then interior omega),
+    // so both fields are read with a single call
+    unsigned int qOmegaSize = q.getSize() + omega.getSize();
+    if ( ! singlePrecision && _arena != NULL ) {
+        success = success &&
+            fread( _arena, sizeof( double ), qOmegaSize, fp ) == qOmegaSize;
+    }
+    else {
+        Flux::index qind;
+        for ( int lev=0; lev < q.Ngrid(); ++lev ) {
+            for ( qind = q.begin(); qind != q.end(); ++qind ) {
+                success = success && readValue( fp, singlePrecision, q(lev,qind) );
+            }
+        }
+        for ( int lev=0; lev < q.Ngrid(); ++lev ) {
+            for (int i=1; i<nx; ++i ) {
+                for ( int j=1; j<ny; ++j ) {
+                    success = success && readValue( fp, singlePrecision, omega(lev,i,j) );
+                }
             }
         }
     }
 
     // read BoundaryVector f
     for ( int i=0; i < numPoints; ++i ) {
-        success = success && fread( &( f(X,i) ), sizeof( double ), 1, fp );
-        success = success && fread( &( f(Y,i) ), sizeof( double ), 1, fp );        
+        success = success && readValue( fp, singlePrecision, f(X,i) );
+        success = success && readValue( fp, singlePrecision, f(Y,i) );
     }
 
     // read timestep and time
     success = success && fread( &timestep, sizeof(int), 1, fp );
     success = success && fread( &time, sizeof(double), 1, fp );
 
-    // close file
+    return success;
+}
+
+bool State::describe( const std::string& filename, StateInfo& info ) {
+    info.nx = 0;
+    info.ny = 0;
+    info.ngrid = 0;
+    info.numPoints = 0;
+    info.timestep = -1;
+    info.dx = 0.;
+    info.x0 = 0.;
+    info.y0 = 0.;
+    info.time = 0.;
+    info.qOffset = 0;
+    info.omegaOffset = 0;
+    info.fOffset = 0;
+    info.compressed = false;
+    info.singlePrecision = false;
+    info.delta = false;
+    info.compact = false;
+    info.sparse = false;
+    info.quantized = false;
+
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
+
+    char magic[ZMAGIC_LEN];
+    size_t got = fread( magic, 1, ZMAGIC_LEN, fp );
+    bool success = true;
+    if ( got == (size_t) ZMAGIC_LEN &&
+         strncmp( magic, ZMAGIC, ZMAGIC_LEN ) == 0 ) {
+        // Compressed container.  Version 2 keeps the metadata in the
+        // container header; for version 1 inflate the first block, which
+        // holds the record header (timestep/time are at the record's end
+        // and stay unknown)
+        info.compressed = true;
+        int version;
+        long long rawBytes;
+        success = fread( &version, sizeof( int ), 1, fp ) == 1 &&
+                  fread( &rawBytes, sizeof( long long ), 1, fp ) == 1;
+        if ( success && version >= 2 ) {
+            success =
+                fread( &info.timestep, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.time, sizeof( double ), 1, fp ) == 1 &&
+                fread( &info.nx, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.ny, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.ngrid, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.dx, sizeof( double ), 1, fp ) == 1 &&
+                fread( &info.x0, sizeof( double ), 1, fp ) == 1 &&
+                fread( &info.y0, sizeof( double ), 1, fp ) == 1 &&
+                fread( &info.numPoints, sizeof( int ), 1, fp ) == 1;
+        }
+        else if ( success ) {
+            int compLen, rawLen;
+            success = fread( &compLen, sizeof( int ), 1, fp ) == 1 &&
+                      fread( &rawLen, sizeof( int ), 1, fp ) == 1 &&
+                      compLen > 0 && rawLen > 0;
+            if ( success ) {
+                std::vector<Bytef> cbuf( compLen );
+                std::vector<char> raw( rawLen );
+                uLongf destLen = rawLen;
+                success =
+                    fread( &cbuf[0], 1, compLen, fp ) == (size_t) compLen &&
+                    uncompress( (Bytef*) &raw[0], &destLen, &cbuf[0],
+                                (uLong) compLen ) == Z_OK;
+                if ( success ) {
+                    char* p = &raw[0];
+                    memcpy( &info.nx, p, sizeof( int ) ); p += sizeof( int );
+                    memcpy( &info.ny, p, sizeof( int ) ); p += sizeof( int );
+                    memcpy( &info.ngrid, p, sizeof( int ) ); p += sizeof( int );
+                    memcpy( &info.dx, p, sizeof( double ) ); p += sizeof( double );
+                    memcpy( &info.x0, p, sizeof( double ) ); p += sizeof( double );
+                    memcpy( &info.y0, p, sizeof( double ) ); p += sizeof( double );
+                    memcpy( &info.numPoints, p, sizeof( int ) );
+                }
+            }
+        }
+        fclose( fp );
+        return success;
+    }
+
+    if ( got == (size_t) DMAGIC_LEN &&
+         strncmp( magic, DMAGIC, DMAGIC_LEN ) == 0 ) {
+        // Delta record: the header follows the keyframe name, and the
+        // timestep/time tail sits past the (float or 16-bit) differences
+        info.delta = true;
+        int version, quantized, refLen;
+        success =
+            fread( &version, sizeof( int ), 1, fp ) == 1 &&
+            version >= 1 && version <= DVERSION &&
+            fread( &quantized, sizeof( int ), 1, fp ) == 1 &&
+            fread( &refLen, sizeof( int ), 1, fp ) == 1 &&
+            refLen > 0 && refLen <= 4096 &&
+            fseeko( fp, refLen, SEEK_CUR ) == 0 &&
+            fread( &info.nx, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ny, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ngrid, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.dx, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.x0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.y0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.numPoints, sizeof( int ), 1, fp ) == 1 &&
+            info.nx > 0 && info.ny > 0 && info.ngrid > 0 &&
+            info.numPoints >= 0;
+        if ( success ) {
+            long long numFluxes =
+                2LL * info.nx * info.ny + info.nx + info.ny;
+            long long numValues =
+                (long long) info.ngrid * numFluxes +
+                (long long) info.ngrid * (info.nx-1) * (info.ny-1) +
+                2LL * info.numPoints;
+            size_t valueSize = quantized ? sizeof( short ) : sizeof( float );
+            long long tail = ftello( fp ) + numValues * valueSize +
+                ( quantized ? 3 * sizeof( double ) : 0 );
+            success = fseeko( fp, (off_t) tail, SEEK_SET ) == 0 &&
+                fread( &info.timestep, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.time, sizeof( double ), 1, fp ) == 1;
+        }
+        fclose( fp );
+        return success;
+    }
+
+    if ( got == (size_t) CMAGIC_LEN &&
+         strncmp( magic, CMAGIC, CMAGIC_LEN ) == 0 ) {
+        // Compact record: full-grid header after the version, then only
+        // the finest-level fields before the timestep/time tail
+        info.compact = true;
+        int version;
+        success =
+            fread( &version, sizeof( int ), 1, fp ) == 1 &&
+            version >= 1 && version <= CVERSION &&
+            fread( &info.nx, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ny, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ngrid, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.dx, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.x0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.y0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.numPoints, sizeof( int ), 1, fp ) == 1 &&
+            info.nx > 0 && info.ny > 0 && info.ngrid > 0 &&
+            info.numPoints >= 0;
+        if ( success ) {
+            long long numValues =
+                2LL * info.nx * info.ny + info.nx + info.ny +
+                (long long) (info.nx-1) * (info.ny-1) +
+                2LL * info.numPoints;
+            long long tail = ftello( fp ) + numValues * sizeof( double );
+            success = fseeko( fp, (off_t) tail, SEEK_SET ) == 0 &&
+                fread( &info.timestep, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.time, sizeof( double ), 1, fp ) == 1;
+        }
+        fclose( fp );
+        return success;
+    }
+
+    if ( got == (size_t) SMAGIC_LEN &&
+         strncmp( magic, SMAGIC, SMAGIC_LEN ) == 0 ) {
+        // Sparse record: full-grid header after the version, then a
+        // variable number of vorticity tiles per level before the force
+        // and the timestep/time tail (see saveSparse)
+        info.sparse = true;
+        int version;
+        double threshold;
+        int tile = 0;
+        success =
+            fread( &version, sizeof( int ), 1, fp ) == 1 &&
+            version >= 1 && version <= SVERSION &&
+            fread( &info.nx, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ny, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ngrid, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.dx, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.x0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.y0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.numPoints, sizeof( int ), 1, fp ) == 1 &&
+            fread( &threshold, sizeof( double ), 1, fp ) == 1 &&
+            fread( &tile, sizeof( int ), 1, fp ) == 1 &&
+            info.nx > 0 && info.ny > 0 && info.ngrid > 0 &&
+            info.numPoints >= 0 && tile > 0;
+        if ( success ) {
+            // Walk the tile directory to reach the tail
+            int ntx = ( info.nx - 1 + tile - 1 ) / tile;
+            int nty = ( info.ny - 1 + tile - 1 ) / tile;
+            for ( int lev=0; lev < info.ngrid && success; ++lev ) {
+                int numActive;
+                success = fread( &numActive, sizeof( int ), 1, fp ) == 1 &&
+                    numActive >= 0 && numActive <= ntx * nty;
+                for ( int n=0; n < numActive && success; ++n ) {
+                    int t;
+                    success = fread( &t, sizeof( int ), 1, fp ) == 1 &&
+                        t >= 0 && t < ntx * nty;
+                    if ( ! success ) break;
+                    int i0 = 1 + ( t / nty ) * tile;
+                    int j0 = 1 + ( t % nty ) * tile;
+                    long long ni =
+                        ( ( i0 + tile < info.nx ) ? i0 + tile : info.nx ) - i0;
+                    long long nj =
+                        ( ( j0 + tile < info.ny ) ? j0 + tile : info.ny ) - j0;
+                    success = fseeko( fp,
+                        (off_t) ( ni * nj * sizeof( float ) ),
+                        SEEK_CUR ) == 0;
+                }
+            }
+            success = success &&
+                fseeko( fp, (off_t) ( 2LL * info.numPoints *
+                                      sizeof( double ) ), SEEK_CUR ) == 0 &&
+                fread( &info.timestep, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.time, sizeof( double ), 1, fp ) == 1;
+        }
+        fclose( fp );
+        return success;
+    }
+
+    if ( got == (size_t) QMAGIC_LEN &&
+         strncmp( magic, QMAGIC, QMAGIC_LEN ) == 0 ) {
+        // Quantized record: full-grid header after the version, then a
+        // fixed-size block of vorticity tiles per level (two floats and
+        // the 16-bit codes of each tile) before the force and the
+        // timestep/time tail (see saveQuantized)
+        info.quantized = true;
+        int version;
+        int tile = 0;
+        success =
+            fread( &version, sizeof( int ), 1, fp ) == 1 &&
+            version >= 1 && version <= QVERSION &&
+            fread( &info.nx, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ny, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.ngrid, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.dx, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.x0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.y0, sizeof( double ), 1, fp ) == 1 &&
+            fread( &info.numPoints, sizeof( int ), 1, fp ) == 1 &&
+            fread( &tile, sizeof( int ), 1, fp ) == 1 &&
+            info.nx > 0 && info.ny > 0 && info.ngrid > 0 &&
+            info.numPoints >= 0 && tile > 0;
+        if ( success ) {
+            long long ntx = ( info.nx - 1 + tile - 1 ) / tile;
+            long long nty = ( info.ny - 1 + tile - 1 ) / tile;
+            long long perLevel =
+                ntx * nty * 2LL * sizeof( float ) +
+                (long long) (info.nx-1) * (info.ny-1) *
+                    sizeof( unsigned short );
+            long long skip = info.ngrid * perLevel +
+                2LL * info.numPoints * sizeof( double );
+            success =
+                fseeko( fp, (off_t) skip, SEEK_CUR ) == 0 &&
+                fread( &info.timestep, sizeof( int ), 1, fp ) == 1 &&
+                fread( &info.time, sizeof( double ), 1, fp ) == 1;
+        }
+        fclose( fp );
+        return success;
+    }
+
+    // Uncompressed record, field data in doubles or floats
+    size_t base = 0;
+    size_t valueSize = sizeof( double );
+    if ( got == (size_t) FMAGIC_LEN &&
+         strncmp( magic, FMAGIC, FMAGIC_LEN ) == 0 ) {
+        info.singlePrecision = true;
+        base = FMAGIC_LEN;
+        valueSize = sizeof( float );
+    }
+    else {
+        rewind( fp );
+    }
+    success =
+        fread( &info.nx, sizeof( int ), 1, fp ) == 1 &&
+        fread( &info.ny, sizeof( int ), 1, fp ) == 1 &&
+        fread( &info.ngrid, sizeof( int ), 1, fp ) == 1 &&
+        fread( &info.dx, sizeof( double ), 1, fp ) == 1 &&
+        fread( &info.x0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &info.y0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &info.numPoints, sizeof( int ), 1, fp ) == 1 &&
+        info.nx > 0 && info.ny > 0 && info.ngrid > 0 &&
+        info.numPoints >= 0;
+    if ( success ) {
+        // offsets of each field, and of the timestep/time tail
+        long long numFluxes = 2LL * info.nx * info.ny + info.nx + info.ny;
+        info.qOffset = base + 4 * sizeof( int ) + 3 * sizeof( double );
+        info.omegaOffset = info.qOffset +
+            (long long) info.ngrid * numFluxes * valueSize;
+        info.fOffset = info.omegaOffset +
+            (long long) info.ngrid * (info.nx-1) * (info.ny-1) * valueSize;
+        long long tail = info.fOffset +
+            2LL * info.numPoints * valueSize;
+        success = fseeko( fp, (off_t) tail, SEEK_SET ) == 0 &&
+            fread( &info.timestep, sizeof( int ), 1, fp ) == 1 &&
+            fread( &info.time, sizeof( double ), 1, fp ) == 1;
+    }
+    fclose( fp );
+    return success;
+}
+
+// Read only the force of one plain (double- or single-precision) or
+// sparse state record at the current position: parse the
+// self-describing header, seek over the flux and vorticity data, and
+// read the force and the timestep/time tail.  The header layout
+// matches readRecord/describe (or loadSparse)
+bool State::loadForceRecord( FILE* fp, BoundaryVector& f,
+                             int& timestep, double& time, double& dx ) {
+    off_t start = ftello( fp );
+    bool singlePrecision = false;
+    bool sparse = false;
+    bool quantized = false;
+    char magic[FMAGIC_LEN];
+    size_t got = fread( magic, 1, FMAGIC_LEN, fp );
+    if ( got == (size_t) FMAGIC_LEN &&
+         strncmp( magic, FMAGIC, FMAGIC_LEN ) == 0 ) {
+        singlePrecision = true;
+    }
+    else if ( got == (size_t) SMAGIC_LEN &&
+              strncmp( magic, SMAGIC, SMAGIC_LEN ) == 0 ) {
+        sparse = true;
+        int version;
+        if ( fread( &version, sizeof( int ), 1, fp ) != 1 ||
+             version < 1 || version > SVERSION ) {
+            return false;
+        }
+    }
+    else if ( got == (size_t) QMAGIC_LEN &&
+              strncmp( magic, QMAGIC, QMAGIC_LEN ) == 0 ) {
+        quantized = true;
+        int version;
+        if ( fread( &version, sizeof( int ), 1, fp ) != 1 ||
+             version < 1 || version > QVERSION ) {
+            return false;
+        }
+    }
+    else if ( fseeko( fp, start, SEEK_SET ) != 0 ) {
+        return false;
+    }
+    int nx, ny, ngrid, numPoints;
+    double x0, y0;
+    bool success =
+        fread( &nx, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ny, sizeof( int ), 1, fp ) == 1 &&
+        fread( &ngrid, sizeof( int ), 1, fp ) == 1 &&
+        fread( &dx, sizeof( double ), 1, fp ) == 1 &&
+        fread( &x0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &y0, sizeof( double ), 1, fp ) == 1 &&
+        fread( &numPoints, sizeof( int ), 1, fp ) == 1 &&
+        nx > 0 && ny > 0 && ngrid > 0 && numPoints >= 0;
+    if ( ! success ) return false;
+
+    // Seek over the field data: only the force is read
+    if ( sparse ) {
+        // Walk the tile directory of a sparse record (see saveSparse),
+        // seeking over each tile's values; the flux is not stored
+        double threshold;
+        int tile;
+        if ( fread( &threshold, sizeof( double ), 1, fp ) != 1 ||
+             fread( &tile, sizeof( int ), 1, fp ) != 1 || tile <= 0 ) {
+            return false;
+        }
+        int ntx = ( nx - 1 + tile - 1 ) / tile;
+        int nty = ( ny - 1 + tile - 1 ) / tile;
+        for ( int lev=0; lev < ngrid; ++lev ) {
+            int numActive;
+            if ( fread( &numActive, sizeof( int ), 1, fp ) != 1 ||
+                 numActive < 0 || numActive > ntx * nty ) return false;
+            for ( int n=0; n < numActive; ++n ) {
+                int t;
+                if ( fread( &t, sizeof( int ), 1, fp ) != 1 ||
+                     t < 0 || t >= ntx * nty ) return false;
+                int i0 = 1 + ( t / nty ) * tile;
+                int j0 = 1 + ( t % nty ) * tile;
+                long long ni = ( ( i0 + tile < nx ) ? i0 + tile : nx ) - i0;
+                long long nj = ( ( j0 + tile < ny ) ? j0 + tile : ny ) - j0;
+                if ( fseeko( fp, (off_t) ( ni * nj * sizeof( float ) ),
+                             SEEK_CUR ) != 0 ) {
+                    return false;
+                }
+            }
+        }
+    }
+    else if ( quantized ) {
+        // The tile block of a quantized record has a fixed size per
+        // level (see saveQuantized); the flux is not stored
+        int tile;
+        if ( fread( &tile, sizeof( int ), 1, fp ) != 1 || tile <= 0 ) {
+            return false;
+        }
+        long long ntx = ( nx - 1 + tile - 1 ) / tile;
+        long long nty = ( ny - 1 + tile - 1 ) / tile;
+        long long perLevel = ntx * nty * 2LL * sizeof( float ) +
+            (long long) (nx-1) * (ny-1) * sizeof( unsigned short );
+        if ( fseeko( fp, (off_t) ( ngrid * perLevel ), SEEK_CUR ) != 0 ) {
+            return false;
+        }
+    }
+    else {
+        size_t valueSize = singlePrecision ? sizeof( float ) : sizeof( double );
+        long long numFluxes = 2LL * nx * ny + nx + ny;
+        long long skip = (long long) ngrid * numFluxes +
+            (long long) ngrid * (nx-1) * (ny-1);
+        if ( fseeko( fp, (off_t) ( skip * valueSize ), SEEK_CUR ) != 0 ) {
+            return false;
+        }
+    }
+
+    if ( f.getNumPoints() != numPoints ) {
+        f.resize( numPoints );
+    }
+    for ( int i=0; i < numPoints; ++i ) {
+        success = success && readValue( fp, singlePrecision, f(X,i) );
+        success = success && readValue( fp, singlePrecision, f(Y,i) );
+    }
+    success = success && fread( &timestep, sizeof( int ), 1, fp ) == 1;
+    success = success && fread( &time, sizeof( double ), 1, fp ) == 1;
+    return success;
+}
+
+bool State::loadForce( const std::string& filename, BoundaryVector& f,
+                       int& timestep, double& time, double& dx ) {
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if ( fp == NULL ) return false;
+    char magic[ZMAGIC_LEN];
+    size_t got = fread( magic, 1, ZMAGIC_LEN, fp );
+    bool container = ( got == (size_t) ZMAGIC_LEN ) &&
+        ( strncmp( magic, ZMAGIC, ZMAGIC_LEN ) == 0 ||
+          strncmp( magic, DMAGIC, DMAGIC_LEN ) == 0 ||
+          strncmp( magic, CMAGIC, CMAGIC_LEN ) == 0 );
+    if ( container ) {
+        // Compressed, delta, and compact records interleave or encode
+        // the force with the field data: reconstruct the whole state
+        fclose( fp );
+        State x;
+        if ( ! x.load( filename ) ) return false;
+        if ( f.getNumPoints() != x.f.getNumPoints() ) {
+            f.resize( x.f.getNumPoints() );
+        }
+        f = x.f;
+        timestep = x.timestep;
+        time = x.time;
+        dx = x.omega.Dx();
+        return true;
+    }
+    rewind( fp );
+    bool success = loadForceRecord( fp, f, timestep, time, dx );
     fclose( fp );
-    cerr << "done" << endl;
     return success;
 }
 
+bool State::mapFromFile( const std::string& filename ) {
+    cerr << "Mapping restart file " << filename << "..." << flush;
+    int fd = open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 ) return false;
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) {
+        close( fd );
+        return false;
+    }
+    size_t length = st.st_size;
+
+    // header: nx, ny, ngrid, dx, x0, y0, numPoints, as written by save()
+    const size_t headerBytes = 4 * sizeof( int ) + 3 * sizeof( double );
+    if ( length < headerBytes ) {
+        close( fd );
+        cerr << "failed (not a restart file)" << endl;
+        return false;
+    }
+
+    // Map privately, so that modifying the state copies pages rather than
+    // writing back to the file
+    void* base = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, 0 );
+    close( fd );
+    if ( base == MAP_FAILED ) return false;
+    char* p = (char*) base;
+
+    int nx, ny, ngrid, numPoints;
+    double dx, x0, y0;
+    memcpy( &nx, p, sizeof( int ) ); p += sizeof( int );
+    memcpy( &ny, p, sizeof( int ) ); p += sizeof( int );
+    memcpy( &ngrid, p, sizeof( int ) ); p += sizeof( int );
+    memcpy( &dx, p, sizeof( double ) ); p += sizeof( double );
+    memcpy( &x0, p, sizeof( double ) ); p += sizeof( double );
+    memcpy( &y0, p, sizeof( double ) ); p += sizeof( double );
+    memcpy( &numPoints, p, sizeof( int ) ); p += sizeof( int );
+
+    // Validate the header against the file length before touching the data
+    bool valid = ( nx > 0 ) && ( ny > 0 ) && ( ngrid > 0 ) &&
+        ( numPoints >= 0 ) && ( dx > 0 );
+    size_t qBytes = 0;
+    size_t omegaBytes = 0;
+    size_t fBytes = 0;
+    if ( valid ) {
+        int numFluxes = 2 * nx * ny + nx + ny;
+        qBytes = (size_t) ngrid * numFluxes * sizeof( double );
+        omegaBytes = (size_t) ngrid * (nx-1) * (ny-1) * sizeof( double );
+        fBytes = (size_t) 2 * numPoints * sizeof( double );
+        size_t expected = headerBytes + qBytes + omegaBytes + fBytes +
+            sizeof( int ) + sizeof( double );
+        valid = ( expected == length );
+    }
+    if ( ! valid ) {
+        munmap( base, length );
+        cerr << "failed (not a restart file)" << endl;
+        return false;
+    }
+
+    // Point q and omega directly at the mapped data (their storage order
+    // matches the file layout), releasing any previous mapping first.
+    // The arena is released too: a mapped state is not contiguous, and
+    // flatten() reports that by returning NULL
+    unmap();
+    releaseArena();
+    Grid newgrid( nx, ny, ngrid, dx * nx, x0, y0 );
+    q.viewExternal( newgrid, (double*) p );
+    omega.viewExternal( newgrid, (double*) ( p + qBytes ) );
+
+    // The boundary force components are interleaved in the file, so unpack
+    // them into an ordinary BoundaryVector
+    f.resize( numPoints );
+    const double* fdata = (const double*) ( p + qBytes + omegaBytes );
+    for ( int i=0; i < numPoints; ++i ) {
+        f(X,i) = fdata[2*i];
+        f(Y,i) = fdata[2*i+1];
+    }
+
+    // read timestep and time from the tail
+    p += qBytes + omegaBytes + fBytes;
+    memcpy( &timestep, p, sizeof( int ) ); p += sizeof( int );
+    memcpy( &time, p, sizeof( double ) );
+
+    _mapBase = base;
+    _mapLength = length;
+    cerr << "done" << endl;
+    return true;
+}
+
+void State::setUncachedWrites( bool flag ) {
+    _uncachedWrites = flag;
+}
+
 bool State::save(std::string filename) const {
     cerr << "Writing restart file " << filename << "..." << flush;
     // open file
     FILE* fp = fopen( filename.c_str(), "wb" );
     if ( fp == NULL ) return false;
+    bool success = save( fp );
+    finishUncached( fp );
+    fclose( fp );
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::save(std::string filename, bool compress) const {
+    return save( filename, compress, false );
+}
+
+bool State::save(std::string filename, bool compress,
+                 bool singlePrecision) const {
+    if ( ! compress && ! singlePrecision ) return save( filename );
+    if ( ! compress ) {
+        cerr << "Writing single-precision snapshot file " << filename
+             << "..." << flush;
+        FILE* fp = fopen( filename.c_str(), "wb" );
+        if ( fp == NULL ) return false;
+        bool success = save( fp, true );
+        finishUncached( fp );
+        fclose( fp );
+        cerr << "done" << endl;
+        return success;
+    }
+    cerr << "Writing compressed restart file " << filename << "..." << flush;
+
+    // Serialize the ordinary restart record to memory
+    char* raw = NULL;
+    size_t rawBytes = 0;
+    FILE* mem = open_memstream( &raw, &rawBytes );
+    if ( mem == NULL ) return false;
+    bool success = save( mem, singlePrecision );
+    fclose( mem );
+    if ( ! success ) {
+        free( raw );
+        return false;
+    }
+
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) {
+        free( raw );
+        return false;
+    }
+    fwrite( ZMAGIC, 1, ZMAGIC_LEN, fp );
+    int version = ZVERSION;
+    fwrite( &version, sizeof( int ), 1, fp );
+    long long totalBytes = rawBytes;
+    fwrite( &totalBytes, sizeof( long long ), 1, fp );
+
+    // metadata block (ZMETA_BYTES), so the file can be catalogued
+    // without inflating anything (see describe)
+    {
+        const Grid& grid = q.getGrid();
+        int nx = grid.Nx();
+        int ny = grid.Ny();
+        int ngrid = grid.Ngrid();
+        double dx = grid.Dx();
+        double x0 = grid.getXEdge(0,0);
+        double y0 = grid.getYEdge(0,0);
+        int numPoints = f.getNumPoints();
+        fwrite( &timestep, sizeof( int ), 1, fp );
+        fwrite( &time, sizeof( double ), 1, fp );
+        fwrite( &nx, sizeof( int ), 1, fp );
+        fwrite( &ny, sizeof( int ), 1, fp );
+        fwrite( &ngrid, sizeof( int ), 1, fp );
+        fwrite( &dx, sizeof( double ), 1, fp );
+        fwrite( &x0, sizeof( double ), 1, fp );
+        fwrite( &y0, sizeof( double ), 1, fp );
+        fwrite( &numPoints, sizeof( int ), 1, fp );
+    }
+
+    // Compress block by block, each prefixed with its compressed and raw
+    // lengths.  Compression level 1 trades a few percent of ratio for
+    // write speed
+    std::vector<Bytef> cbuf;
+    for ( size_t off=0; off < rawBytes; off += ZBLOCK_SIZE ) {
+        uLong rawLen = rawBytes - off;
+        if ( rawLen > ZBLOCK_SIZE ) rawLen = ZBLOCK_SIZE;
+        uLongf compLen = compressBound( rawLen );
+        cbuf.resize( compLen );
+        if ( compress2( &cbuf[0], &compLen, (const Bytef*) raw + off,
+                        rawLen, 1 ) != Z_OK ) {
+            success = false;
+            break;
+        }
+        int cl = compLen;
+        int rl = rawLen;
+        fwrite( &cl, sizeof( int ), 1, fp );
+        fwrite( &rl, sizeof( int ), 1, fp );
+        success = success &&
+            fwrite( &cbuf[0], 1, compLen, fp ) == (size_t) compLen;
+    }
+    free( raw );
+    finishUncached( fp );
+    fclose( fp );
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::saveDelta( std::string filename, const std::string& refName,
+                       const State& ref, bool quantize ) const {
+    // A delta only makes sense against a keyframe on the same grid; fall
+    // back to a full record otherwise (e.g. no keyframe written yet)
+    if ( refName.empty() ||
+         ! q.getGrid().isEqualTo( ref.q.getGrid() ) ||
+         f.getNumPoints() != ref.f.getNumPoints() ) {
+        return save( filename );
+    }
+    cerr << "Writing delta restart file " << filename << "..." << flush;
+
+    // Gather the differences from the keyframe, in record order
+    std::vector<double> dq;
+    std::vector<double> domega;
+    std::vector<double> df;
+    int nx = q.Nx();
+    int ny = q.Ny();
+    Flux::index qind;
+    for ( int lev=0; lev < q.Ngrid(); ++lev ) {
+        for ( qind = q.begin(); qind != q.end(); ++qind ) {
+            dq.push_back( q(lev,qind) - ref.q(lev,qind) );
+        }
+    }
+    for ( int lev=0; lev < q.Ngrid(); ++lev ) {
+        for (int i=1; i<nx; ++i ) {
+            for ( int j=1; j<ny; ++j ) {
+                domega.push_back( omega(lev,i,j) - ref.omega(lev,i,j) );
+            }
+        }
+    }
+    for ( int i=0; i < f.getNumPoints(); ++i ) {
+        df.push_back( f(X,i) - ref.f(X,i) );
+        df.push_back( f(Y,i) - ref.f(Y,i) );
+    }
+
+    // Quantization scales per field, so a large flux difference cannot
+    // wipe out the resolution of the boundary forces
+    double qScale = 0.;
+    double omegaScale = 0.;
+    double fScale = 0.;
+    if ( quantize ) {
+        for ( size_t i=0; i < dq.size(); ++i ) {
+            if ( fabs( dq[i] ) > qScale ) qScale = fabs( dq[i] );
+        }
+        for ( size_t i=0; i < domega.size(); ++i ) {
+            if ( fabs( domega[i] ) > omegaScale ) omegaScale = fabs( domega[i] );
+        }
+        for ( size_t i=0; i < df.size(); ++i ) {
+            if ( fabs( df[i] ) > fScale ) fScale = fabs( df[i] );
+        }
+        qScale /= 32767.;
+        omegaScale /= 32767.;
+        fScale /= 32767.;
+    }
+
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) return false;
+    fwrite( DMAGIC, 1, DMAGIC_LEN, fp );
+    int version = DVERSION;
+    int quantized = quantize ? 1 : 0;
+    int refLen = refName.size();
+    fwrite( &version, sizeof( int ), 1, fp );
+    fwrite( &quantized, sizeof( int ), 1, fp );
+    fwrite( &refLen, sizeof( int ), 1, fp );
+    fwrite( refName.c_str(), 1, refLen, fp );
+
+    // header, as in an ordinary record, so mismatched keyframes are
+    // detected at load time
+    const Grid& grid = q.getGrid();
+    int ngrid = grid.Ngrid();
+    double dx = grid.Dx();
+    double x0 = grid.getXEdge(0,0);
+    double y0 = grid.getYEdge(0,0);
+    int numPoints = f.getNumPoints();
+    fwrite( &nx, sizeof( int ), 1, fp );
+    fwrite( &ny, sizeof( int ), 1, fp );
+    fwrite( &ngrid, sizeof( int ), 1, fp );
+    fwrite( &dx, sizeof( double ), 1, fp );
+    fwrite( &x0, sizeof( double ), 1, fp );
+    fwrite( &y0, sizeof( double ), 1, fp );
+    fwrite( &numPoints, sizeof( int ), 1, fp );
+    if ( quantize ) {
+        fwrite( &qScale, sizeof( double ), 1, fp );
+        fwrite( &omegaScale, sizeof( double ), 1, fp );
+        fwrite( &fScale, sizeof( double ), 1, fp );
+    }
+
+    for ( size_t i=0; i < dq.size(); ++i ) {
+        writeDelta( fp, quantize, qScale, dq[i] );
+    }
+    for ( size_t i=0; i < domega.size(); ++i ) {
+        writeDelta( fp, quantize, omegaScale, domega[i] );
+    }
+    for ( size_t i=0; i < df.size(); ++i ) {
+        writeDelta( fp, quantize, fScale, df[i] );
+    }
+
+    fwrite( &timestep, sizeof(int), 1, fp );
+    fwrite( &time, sizeof(double), 1, fp );
+    finishUncached( fp );
+    bool success = ( fclose( fp ) == 0 );
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::saveCompact( std::string filename ) const {
+    cerr << "Writing compact restart file " << filename << "..." << flush;
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) return false;
+    fwrite( CMAGIC, 1, CMAGIC_LEN, fp );
+    int version = CVERSION;
+    fwrite( &version, sizeof( int ), 1, fp );
 
+    // header of the full multi-domain grid, as in an ordinary record
+    const Grid& grid = q.getGrid();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int ngrid = grid.Ngrid();
+    double dx = grid.Dx();
+    double x0 = grid.getXEdge(0,0);
+    double y0 = grid.getYEdge(0,0);
+    int numPoints = f.getNumPoints();
+    fwrite( &nx, sizeof( int ), 1, fp );
+    fwrite( &ny, sizeof( int ), 1, fp );
+    fwrite( &ngrid, sizeof( int ), 1, fp );
+    fwrite( &dx, sizeof( double ), 1, fp );
+    fwrite( &x0, sizeof( double ), 1, fp );
+    fwrite( &y0, sizeof( double ), 1, fp );
+    fwrite( &numPoints, sizeof( int ), 1, fp );
+
+    // finest-level fields only, in their storage order
+    unsigned int numFluxes = 2 * nx * ny + nx + ny;
+    unsigned int numOmega = ( nx - 1 ) * ( ny - 1 );
+    fwrite( q.flatten(0), sizeof( double ), numFluxes, fp );
+    fwrite( omega.flatten(0), sizeof( double ), numOmega, fp );
+    for ( int i=0; i < numPoints; ++i ) {
+        writeValue( fp, false, f(X,i) );
+        writeValue( fp, false, f(Y,i) );
+    }
+
+    fwrite( &timestep, sizeof(int), 1, fp );
+    fwrite( &time, sizeof(double), 1, fp );
+    finishUncached( fp );
+    bool success = ( fclose( fp ) == 0 );
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::saveSparse( std::string filename, double threshold ) const {
+    cerr << "Writing sparse snapshot file " << filename << "..." << flush;
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) return false;
+    bool success = saveSparse( fp, threshold );
+    finishUncached( fp );
+    success = ( fclose( fp ) == 0 ) && success;
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::saveSparse( FILE* fp, double threshold ) const {
+    fwrite( SMAGIC, 1, SMAGIC_LEN, fp );
+    int version = SVERSION;
+    fwrite( &version, sizeof( int ), 1, fp );
+
+    // header of the full multi-domain grid, as in an ordinary record
+    const Grid& grid = q.getGrid();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int ngrid = grid.Ngrid();
+    double dx = grid.Dx();
+    double x0 = grid.getXEdge(0,0);
+    double y0 = grid.getYEdge(0,0);
+    int numPoints = f.getNumPoints();
+    fwrite( &nx, sizeof( int ), 1, fp );
+    fwrite( &ny, sizeof( int ), 1, fp );
+    fwrite( &ngrid, sizeof( int ), 1, fp );
+    fwrite( &dx, sizeof( double ), 1, fp );
+    fwrite( &x0, sizeof( double ), 1, fp );
+    fwrite( &y0, sizeof( double ), 1, fp );
+    fwrite( &numPoints, sizeof( int ), 1, fp );
+    int tile = STILE;
+    fwrite( &threshold, sizeof( double ), 1, fp );
+    fwrite( &tile, sizeof( int ), 1, fp );
+
+    // number of tiles covering the interior, per direction
+    int ntx = ( nx - 1 + STILE - 1 ) / STILE;
+    int nty = ( ny - 1 + STILE - 1 ) / STILE;
+    for ( int lev=0; lev < ngrid; ++lev ) {
+        // First pass: the tiles whose peak |omega| exceeds the threshold
+        std::vector<int> active;
+        for ( int ti=0; ti < ntx; ++ti ) {
+            for ( int tj=0; tj < nty; ++tj ) {
+                int i0 = 1 + ti * STILE;
+                int j0 = 1 + tj * STILE;
+                int i1 = ( i0 + STILE < nx ) ? i0 + STILE : nx;
+                int j1 = ( j0 + STILE < ny ) ? j0 + STILE : ny;
+                double m = 0.;
+                for ( int i=i0; i < i1; ++i ) {
+                    for ( int j=j0; j < j1; ++j ) {
+                        double a = fabs( omega(lev,i,j) );
+                        if ( a > m ) m = a;
+                    }
+                }
+                if ( m > threshold ) active.push_back( ti * nty + tj );
+            }
+        }
+        // Second pass: the surviving tiles, dense, as floats
+        int numActive = active.size();
+        fwrite( &numActive, sizeof( int ), 1, fp );
+        for ( int n=0; n < numActive; ++n ) {
+            int t = active[n];
+            fwrite( &t, sizeof( int ), 1, fp );
+            int i0 = 1 + ( t / nty ) * STILE;
+            int j0 = 1 + ( t % nty ) * STILE;
+            int i1 = ( i0 + STILE < nx ) ? i0 + STILE : nx;
+            int j1 = ( j0 + STILE < ny ) ? j0 + STILE : ny;
+            for ( int i=i0; i < i1; ++i ) {
+                for ( int j=j0; j < j1; ++j ) {
+                    float v = omega(lev,i,j);
+                    fwrite( &v, sizeof( float ), 1, fp );
+                }
+            }
+        }
+    }
+
+    for ( int i=0; i < numPoints; ++i ) {
+        writeValue( fp, false, f(X,i) );
+        writeValue( fp, false, f(Y,i) );
+    }
+
+    fwrite( &timestep, sizeof(int), 1, fp );
+    fwrite( &time, sizeof(double), 1, fp );
+    return true;
+}
+
+bool State::saveQuantized( std::string filename ) const {
+    cerr << "Writing quantized snapshot file " << filename << "..." << flush;
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( fp == NULL ) return false;
+    bool success = saveQuantized( fp );
+    finishUncached( fp );
+    success = ( fclose( fp ) == 0 ) && success;
+    cerr << "done" << endl;
+    return success;
+}
+
+bool State::saveQuantized( FILE* fp ) const {
+    fwrite( QMAGIC, 1, QMAGIC_LEN, fp );
+    int version = QVERSION;
+    fwrite( &version, sizeof( int ), 1, fp );
+
+    // header of the full multi-domain grid, as in an ordinary record
+    const Grid& grid = q.getGrid();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int ngrid = grid.Ngrid();
+    double dx = grid.Dx();
+    double x0 = grid.getXEdge(0,0);
+    double y0 = grid.getYEdge(0,0);
+    int numPoints = f.getNumPoints();
+    fwrite( &nx, sizeof( int ), 1, fp );
+    fwrite( &ny, sizeof( int ), 1, fp );
+    fwrite( &ngrid, sizeof( int ), 1, fp );
+    fwrite( &dx, sizeof( double ), 1, fp );
+    fwrite( &x0, sizeof( double ), 1, fp );
+    fwrite( &y0, sizeof( double ), 1, fp );
+    fwrite( &numPoints, sizeof( int ), 1, fp );
+    int tile = STILE;
+    fwrite( &tile, sizeof( int ), 1, fp );
+
+    // number of tiles covering the interior, per direction
+    int ntx = ( nx - 1 + STILE - 1 ) / STILE;
+    int nty = ( ny - 1 + STILE - 1 ) / STILE;
+    for ( int lev=0; lev < ngrid; ++lev ) {
+        // Every tile, in row-major tile order: its value range sets the
+        // quantization step, so smooth regions lose almost nothing and
+        // the error within a tile is bounded by half its step
+        for ( int t=0; t < ntx * nty; ++t ) {
+            int i0 = 1 + ( t / nty ) * STILE;
+            int j0 = 1 + ( t % nty ) * STILE;
+            int i1 = ( i0 + STILE < nx ) ? i0 + STILE : nx;
+            int j1 = ( j0 + STILE < ny ) ? j0 + STILE : ny;
+            double lo = omega(lev,i0,j0);
+            double hi = lo;
+            for ( int i=i0; i < i1; ++i ) {
+                for ( int j=j0; j < j1; ++j ) {
+                    double a = omega(lev,i,j);
+                    if ( a < lo ) lo = a;
+                    if ( a > hi ) hi = a;
+                }
+            }
+            float offset = lo;
+            float scale = ( hi > lo ) ? ( hi - lo ) / 65535. : 0.;
+            fwrite( &offset, sizeof( float ), 1, fp );
+            fwrite( &scale, sizeof( float ), 1, fp );
+            for ( int i=i0; i < i1; ++i ) {
+                for ( int j=j0; j < j1; ++j ) {
+                    unsigned short v = 0;
+                    if ( scale > 0. ) {
+                        double c = ( omega(lev,i,j) - offset ) / scale;
+                        if ( c < 0. ) c = 0.;
+                        if ( c > 65535. ) c = 65535.;
+                        v = (unsigned short) ( c + 0.5 );
+                    }
+                    fwrite( &v, sizeof( unsigned short ), 1, fp );
+                }
+            }
+        }
+    }
+
+    for ( int i=0; i < numPoints; ++i ) {
+        writeValue( fp, false, f(X,i) );
+        writeValue( fp, false, f(Y,i) );
+    }
+
+    fwrite( &timestep, sizeof(int), 1, fp );
+    fwrite( &time, sizeof(double), 1, fp );
+    return true;
+}
+
+bool State::save( FILE* fp ) const {
+    return save( fp, false );
+}
+
+bool State::save( FILE* fp, bool singlePrecision ) const {
+    if ( singlePrecision ) {
+        fwrite( FMAGIC, 1, FMAGIC_LEN, fp );
+    }
     // write Grid info
     const Grid& grid = q.getGrid();
     int nx = grid.Nx();
@@ -185,40 +1873,39 @@ bool State::save(std::string filename) const {
     int numPoints = f.getNumPoints();
     fwrite( &numPoints, sizeof( int ), 1, fp );
         
-    // write Flux q
-    Flux::index qind;
-    for ( int lev=0; lev < q.Ngrid(); ++lev ) {
-        for ( qind = q.begin(); qind != q.end(); ++qind ) {
-            double qq = q(lev,qind);
-            fwrite( &qq, sizeof( double ), 1, fp );
-        }
+    // write Flux q and Scalar omega.  The record stores them in the
+    // same order as the arena (all q, then interior omega), so a
+    // double-precision save streams both fields with a single call
+    unsigned int qOmegaSize = q.getSize() + omega.getSize();
+    if ( ! singlePrecision && _arena != NULL ) {
+        fwrite( _arena, sizeof( double ), qOmegaSize, fp );
     }
-
-    // write Scalar omega
-    for ( int lev=0; lev < q.Ngrid(); ++lev ) {
-        for (int i=1; i<nx; ++i ) {
-            for ( int j=1; j<ny; ++j ) {
-                double g = omega(lev,i,j);
-                fwrite( &g, sizeof( double ), 1, fp );
+    else {
+        Flux::index qind;
+        for ( int lev=0; lev < q.Ngrid(); ++lev ) {
+            for ( qind = q.begin(); qind != q.end(); ++qind ) {
+                writeValue( fp, singlePrecision, q(lev,qind) );
+            }
+        }
+        for ( int lev=0; lev < q.Ngrid(); ++lev ) {
+            for (int i=1; i<nx; ++i ) {
+                for ( int j=1; j<ny; ++j ) {
+                    writeValue( fp, singlePrecision, omega(lev,i,j) );
+                }
             }
         }
     }
 
     // write BoundaryVector f
     for ( int i=0; i < numPoints; ++i ) {
-        double fx = f(X,i);
-        double fy = f(Y,i);
-        fwrite( &fx, sizeof( double ), 1, fp );
-        fwrite( &fy, sizeof( double ), 1, fp );        
+        writeValue( fp, singlePrecision, f(X,i) );
+        writeValue( fp, singlePrecision, f(Y,i) );
     }
 
     // write timestep and time
     fwrite( &timestep, sizeof(int), 1, fp );
     fwrite( &time, sizeof(double), 1, fp );
 
-    // close file
-    fclose( fp );
-    cerr << "done" << endl;
     return true;
 }
 
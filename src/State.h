@@ -5,6 +5,7 @@
 #include "Flux.h"
 #include "Scalar.h"
 #include "BoundaryVector.h"
+#include <stdio.h>
 #include <string>
 
 using std::string;
@@ -24,7 +25,32 @@ namespace ibpm {
     \version $Revision$
 */
 
-class State {
+/*! \brief Header metadata of a restart file, readable without loading
+    the field data (see State::describe) */
+struct StateInfo {
+    int nx;
+    int ny;
+    int ngrid;
+    int numPoints;
+    int timestep;
+    double dx;
+    double x0;
+    double y0;
+    double time;
+    // byte offsets of each field within the record; zero for compressed
+    // files, where the offsets refer to the inflated record
+    long long qOffset;
+    long long omegaOffset;
+    long long fOffset;
+    bool compressed;
+    bool singlePrecision;
+    bool delta;
+    bool compact;
+    bool sparse;
+    bool quantized;
+};
+
+class State : public FieldDataOwner {
 public:
     /// Default constructor: do not allocate memory
     State();
@@ -50,19 +76,252 @@ public:
      */
     bool save(std::string filename) const;
 
+    /// \brief Save the state, optionally with zlib block compression.
+    /// Vorticity on the coarse outer domains is mostly near zero, so
+    /// compressed restart files are typically several times smaller.
+    /// load() detects compressed files automatically
+    bool save(std::string filename, bool compress) const;
+
+    /// \brief Save the state, optionally compressed and/or with the field
+    /// data converted to single precision.  Single precision halves the
+    /// size of visualization-bound snapshots; restart files should keep
+    /// full precision.  load() detects both options automatically
+    bool save(std::string filename, bool compress, bool singlePrecision) const;
+
+    /// \brief Save only the difference from a reference state (a
+    /// "keyframe" restart file named refName, resolved relative to the
+    /// delta file's directory).  Consecutive checkpoints differ smoothly,
+    /// so the differences compress well: they are stored as
+    /// single-precision floats, or as quantized 16-bit integers when
+    /// quantize is set.  load() reconstructs the state transparently by
+    /// reading the keyframe and applying the differences.  Falls back to
+    /// an ordinary full save if the reference grid does not match
+    bool saveDelta( std::string filename, const std::string& refName,
+                    const State& ref, bool quantize ) const;
+
+    /// \brief Save only the finest-level fields plus the boundary force
+    /// (a "compact" restart), shrinking the file by roughly the number
+    /// of grid levels.  The full multi-domain dimensions are kept in
+    /// the header; load() rebuilds the coarse vorticity levels through
+    /// Scalar::coarsify, while the parts of the coarse levels outside
+    /// the refined region, and the coarse flux levels, start at zero
+    /// and are re-established when the solver recomputes the flux from
+    /// the vorticity (NavierStokesModel::refreshState).  Suited to
+    /// frequent checkpoints of runs restarted through the solver, not
+    /// to standalone postprocessing of coarse-level data
+    bool saveCompact( std::string filename ) const;
+
+    /// \brief Save an analysis snapshot with the vorticity stored
+    /// sparsely: the interior of each level is cut into small square
+    /// tiles, and tiles whose peak |omega| does not exceed the given
+    /// threshold are skipped entirely, while the surviving tiles are
+    /// stored dense, as single-precision floats.  Outside the wake the
+    /// vorticity is numerically negligible, so early in a run this
+    /// shrinks a snapshot by an order of magnitude or more.  The flux
+    /// is omitted: load() re-densifies the vorticity transparently
+    /// (skipped tiles read back as zero) and leaves q zero, to be
+    /// re-derived by the solver (NavierStokesModel::refreshState), as
+    /// for compact files.  Suited to analysis output (see
+    /// OutputSeries), not to restart checkpoints
+    bool saveSparse( std::string filename, double threshold ) const;
+
+    /// \brief As saveSparse, writing one record at the current position
+    /// of an open file, e.g. a frame of a time-series file
+    bool saveSparse( FILE* fp, double threshold ) const;
+
+    /// \brief Save a visualization snapshot with the vorticity
+    /// quantized: each level is cut into small square tiles, and the
+    /// values of a tile are stored as 16-bit integers against the
+    /// tile's own offset and scale, giving roughly three significant
+    /// digits at a quarter of the size of single precision.  The flux
+    /// is omitted and read back as zero, as for sparse files; load()
+    /// (and so bin2plt) decodes the vorticity transparently.  Suited
+    /// to movie-density frame dumps, not to restart checkpoints
+    bool saveQuantized( std::string filename ) const;
+
+    /// \brief As saveQuantized, writing one record at the current
+    /// position of an open file
+    bool saveQuantized( FILE* fp ) const;
+
+    /// \brief Write the state at the current position of an open file,
+    /// in the same format as save(filename).
+    /// Used for appending frames to a time-series file (see OutputSeries)
+    bool save( FILE* fp ) const;
+
+    /// \brief Write the state at the current position of an open file,
+    /// optionally with the field data as single-precision floats
+    bool save( FILE* fp, bool singlePrecision ) const;
+
+    /// \brief Flush checkpoint files to disk as they are written and
+    /// drop them from the page cache (fdatasync and
+    /// posix_fadvise(DONTNEED) on each file-backed save).  Multi-GB
+    /// checkpoints then neither evict the solver's working set nor
+    /// accumulate dirty pages for background writeback to flush mid
+    /// timestep; pair with the asynchronous output worker so the
+    /// synchronous flush lands on the writer thread.  Applies to
+    /// subsequent saves, process-wide; off by default
+    static void setUncachedWrites( bool flag );
+
     /// \brief Load the state from a file (e.g. as a restart file)
     /// Return true if successful
     bool load(const std::string& filename);
 
+    /// \brief Read one state record at the current position of an open file
+    bool load( FILE* fp );
+
+    /// \brief Construct the state as a view of a memory-mapped restart file.
+    /// The header is validated against the file length before any data is
+    /// touched, and q and omega point directly into the mapping (no copy);
+    /// only the boundary force, whose components are interleaved in the
+    /// file, is unpacked.  The mapping is private, so the state may be
+    /// modified without affecting the file.  Returns false (leaving the
+    /// state unchanged) if the file cannot be mapped or is not a valid
+    /// restart file
+    bool mapFromFile( const std::string& filename );
+
+    /// \brief Read only the boundary force of a restart file, plus its
+    /// timestep, time, and grid spacing (needed for the dx^2 weighting
+    /// of net forces).  For plain records the self-describing header is
+    /// used to seek straight to the force, so a snapshot's field data is
+    /// never read; compressed, delta, and compact files fall back to a
+    /// full load.  f is resized to the file's point count.
+    /// Return true if successful
+    static bool loadForce( const std::string& filename, BoundaryVector& f,
+                           int& timestep, double& time, double& dx );
+
+    /// \brief As loadForce, for one plain (double- or single-precision)
+    /// record at the current position of an open file, e.g. a frame of a
+    /// time-series file (see OutputSeries::loadFrameForce)
+    static bool loadForceRecord( FILE* fp, BoundaryVector& f,
+                                 int& timestep, double& time, double& dx );
+
+    /// \brief Read only the header metadata of a restart file, filling
+    /// in the given StateInfo.  Only a few bytes are read, so scanning a
+    /// directory of snapshots takes milliseconds per file.  Compressed
+    /// files carry the metadata in their container header; for older
+    /// compressed files (version 1) the grid info is recovered from the
+    /// first block but timestep is reported as -1
+    static bool describe( const std::string& filename, StateInfo& info );
+
+    /// \brief Return a pointer to the contiguous arena backing q, omega,
+    /// and f (in that order; see resize), of getSize() doubles, or NULL
+    /// when the fields are not contiguous (e.g. a view of a mapped file).
+    /// Whole-state copies and axpy updates (see StateVector) run over
+    /// this single block instead of field by field
+    inline double* flatten() {
+        if ( _arenaRefs != NULL && *_arenaRefs > 1 ) detachData();
+        return _arena;
+    }
+    inline const double* flatten() const { return _arena; }
+
+    /// Number of doubles in the combined arena (q, omega, and f)
+    inline unsigned int getSize() const { return _arenaSize; }
+
     /// \brief Routine for computing X & Y forces
     void computeNetForce( double& xforce, double& yforce ) const;
-			    
+
+    /// \brief Compute the force, and the moment about the given center,
+    /// exerted on the contiguous range [begin,end) of boundary points:
+    /// the per-body analogue of computeNetForce.  points holds the
+    /// current coordinates of all boundary points (Geometry::getPoints)
+    void computeBodyForce(
+        int begin,
+        int end,
+        const BoundaryVector& points,
+        double xCenter,
+        double yCenter,
+        double& xforce,
+        double& yforce,
+        double& moment
+    ) const;
+
+    /// \brief Constant-time copy: the new state shares x's arena under
+    /// copy-on-write, and whichever of the two is written to first
+    /// detaches with a private copy (see detachData).  A copy of a
+    /// mapped view is a deep copy
+    State( const State& x );
+
+    /// Copy assignment, sharing x's arena copy-on-write as for the
+    /// copy constructor, and reallocating if the dimensions differ
+    State& operator=( const State& x );
+
+    /// \brief Give this state a private copy of its arena if it is
+    /// currently shared with other states (FieldDataOwner interface;
+    /// called by the fields on their first mutating access)
+    virtual void detachData();
+
+    /// Exchange contents with x, in constant time (no field data is copied)
+    inline void swap( State& x ) {
+        q.swap( x.q );
+        omega.swap( x.omega );
+        f.swap( x.f );
+        int t = timestep; timestep = x.timestep; x.timestep = t;
+        double tt = time; time = x.time; x.time = tt;
+        void* b = _mapBase; _mapBase = x._mapBase; x._mapBase = b;
+        size_t len = _mapLength; _mapLength = x._mapLength; x._mapLength = len;
+        double* a = _arena; _arena = x._arena; x._arena = a;
+        unsigned int n = _arenaSize; _arenaSize = x._arenaSize;
+        x._arenaSize = n;
+        int* r = _arenaRefs; _arenaRefs = x._arenaRefs; x._arenaRefs = r;
+        rebindShared();
+        x.rebindShared();
+    }
+
+#if __cplusplus >= 201103L
+    /// Move construction and assignment hand off the field data (and any
+    /// file mapping) without copying it
+    State( State&& x ) : State() {
+        swap( x );
+    }
+
+    State& operator=( State&& x ) {
+        swap( x );
+        return *this;
+    }
+#endif
+
     // public data
     Flux q;
     Scalar omega;
     BoundaryVector f;
     int timestep;
     double time;
+
+private:
+    /// Read one record (double- or single-precision field data) at the
+    /// current position of an open file
+    bool readRecord( FILE* fp, bool singlePrecision );
+
+    /// Release the file mapping backing this state, if any
+    void unmap();
+
+    /// Return the arena backing the fields to the buffer pool, if any
+    void releaseArena();
+
+    /// Adopt x's arena copy-on-write (see the copy constructor)
+    void shareArena( const State& x );
+
+    /// \brief Re-point the fields' copy-on-write hooks at this state,
+    /// after swap() has exchanged the fields between two states
+    inline void rebindShared() {
+        if ( q.isShared() ) q.shareData( this );
+        if ( omega.isShared() ) omega.shareData( this );
+        if ( f.isShared() ) f.shareData( this );
+    }
+
+    // When the state is a view of a memory-mapped restart file (see
+    // mapFromFile), the mapping that q and omega point into
+    void* _mapBase;
+    size_t _mapLength;
+    // Contiguous arena backing the three fields (see resize); NULL when
+    // the state is a view of a mapped file.  The arena may be shared by
+    // several states under copy-on-write (see the copy constructor), so
+    // it carries a reference count; the count is adjusted atomically,
+    // since an asynchronous writer thread may copy its snapshot (see
+    // Logger) while the simulation thread detaches
+    double* _arena;
+    unsigned int _arenaSize;
+    int* _arenaRefs;
 };
 
 } // namespace ibpm
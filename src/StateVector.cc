@@ -46,9 +46,8 @@ StateVector::StateVector(const Grid& grid, int numPoints ) {
 }
 
 void StateVector::resize( const Grid& grid, int numPoints ) {
-    x.q.resize( grid );
-    x.omega.resize( grid );
-    x.f.resize( numPoints );
+    // Size through the State, so the fields share its contiguous arena
+    x.resize( grid, numPoints );
 }
 
 StateVector::StateVector( string filename ) {
@@ -3,6 +3,8 @@
 
 #include "State.h"
 #include "Grid.h"
+#include "Kernels.h"
+#include <algorithm>
 
 namespace ibpm {
 
@@ -53,13 +55,12 @@ public:
     /// Return true if successful
     bool load(const std::string& filename);
 
-    /// Copy assignment
+    /// \brief Copy assignment: constant time, sharing the state's arena
+    /// copy-on-write (see State).  Vectors kept as read-only snapshots,
+    /// e.g. a Krylov basis, cost nothing until they are mutated; the
+    /// compound updates below detach them with a private copy first
     inline StateVector& operator=(const StateVector& v) {
-        x.q = v.x.q;
-        x.omega = v.x.omega;
-        x.f = v.x.f;
-        x.timestep = v.x.timestep;
-        x.time = v.x.time;
+        x = v.x;
         return *this;
     }
 
@@ -75,9 +76,16 @@ public:
 
     /// u += v
     inline StateVector& operator+=(const StateVector& v) {
-        x.q += v.x.q;
-        x.omega += v.x.omega;
-        x.f += v.x.f;
+        double* y = x.flatten();
+        const double* b = v.x.flatten();
+        if ( y != NULL && b != NULL && x.getSize() == v.x.getSize() ) {
+            Kernels::Axpy( y, 1., b, x.getSize() );
+        }
+        else {
+            x.q += v.x.q;
+            x.omega += v.x.omega;
+            x.f += v.x.f;
+        }
         return *this;
     }
 
@@ -91,9 +99,16 @@ public:
 
     /// u -= v
     inline StateVector& operator-=(const StateVector& v) {
-        x.q -= v.x.q;
-        x.omega -= v.x.omega;
-        x.f -= v.x.f;
+        double* y = x.flatten();
+        const double* b = v.x.flatten();
+        if ( y != NULL && b != NULL && x.getSize() == v.x.getSize() ) {
+            Kernels::Axpy( y, -1., b, x.getSize() );
+        }
+        else {
+            x.q -= v.x.q;
+            x.omega -= v.x.omega;
+            x.f -= v.x.f;
+        }
         return *this;
     }
 
@@ -107,17 +122,29 @@ public:
 
     /// u *= a
     inline StateVector& operator*=(double a) {
-        x.q *= a;
-        x.omega *= a;
-        x.f *= a;
+        double* y = x.flatten();
+        if ( y != NULL ) {
+            for ( unsigned int i = 0; i < x.getSize(); ++i ) y[i] *= a;
+        }
+        else {
+            x.q *= a;
+            x.omega *= a;
+            x.f *= a;
+        }
         return *this;
     }
 
     /// u /= a
     inline StateVector& operator/=(double a) {
-        x.q /= a;
-        x.omega /= a;
-        x.f /= a;
+        double* y = x.flatten();
+        if ( y != NULL ) {
+            for ( unsigned int i = 0; i < x.getSize(); ++i ) y[i] /= a;
+        }
+        else {
+            x.q /= a;
+            x.omega /= a;
+            x.f /= a;
+        }
         return *this;
     }
 
@@ -223,6 +250,28 @@ inline StateVector operator/(const StateVector& v, double a) {
     return w;
 }
 
+/// \brief Fused filter update xbar += a * (x - xbar).
+/// The elementwise form used by SFD-style low-pass filters, which run
+/// every step on full multi-domain fields: each member is updated in a
+/// single pass, with no temporary StateVector
+inline void filteredUpdate( StateVector& xbar, const StateVector& x, double a ) {
+    double* y = xbar.x.flatten();
+    const double* b = x.x.flatten();
+    if ( y != NULL && b != NULL && xbar.x.getSize() == x.x.getSize() ) {
+        // One flat pass over the combined arena (see State::resize)
+        for ( unsigned int i = 0; i < xbar.x.getSize(); ++i ) {
+            y[i] += a * ( b[i] - y[i] );
+        }
+        return;
+    }
+    xbar.x.q += a * ( x.x.q - xbar.x.q );
+    xbar.x.omega += a * ( x.x.omega - xbar.x.omega );
+    for (BoundaryVector::index ind = xbar.x.f.begin();
+        ind != xbar.x.f.end(); ++ind) {
+        xbar.x.f(ind) += a * ( x.x.f(ind) - xbar.x.f(ind) );
+    }
+}
+
 } // namespace ibpm
 
 #endif /* _STATEVECTOR_H_ */
@@ -0,0 +1,81 @@
+// Tasks.cc
+//
+// Description:
+// Background execution of independent pieces of a substep
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Tasks.h"
+#include <pthread.h>
+#include <vector>
+
+namespace ibpm {
+
+namespace {
+
+    struct Task {
+        void (*run)( void* );
+        void* arg;
+    };
+
+    std::vector<Task> _queue;
+    int _numPending = 0;            // queued plus currently running
+    bool _workerStarted = false;
+    pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t _workAvailable = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t _workDone = PTHREAD_COND_INITIALIZER;
+
+    // Worker thread: run tasks in submission order, forever
+    void* runWorker( void* ) {
+        pthread_mutex_lock( &_mutex );
+        while ( true ) {
+            while ( _queue.empty() ) {
+                pthread_cond_wait( &_workAvailable, &_mutex );
+            }
+            Task task = _queue.front();
+            _queue.erase( _queue.begin() );
+            pthread_mutex_unlock( &_mutex );
+            task.run( task.arg );
+            pthread_mutex_lock( &_mutex );
+            --_numPending;
+            pthread_cond_broadcast( &_workDone );
+        }
+        return 0;
+    }
+
+} // namespace
+
+void SubmitTask( void (*task)( void* ), void* arg ) {
+    Task t;
+    t.run = task;
+    t.arg = arg;
+    pthread_mutex_lock( &_mutex );
+    if ( ! _workerStarted ) {
+        pthread_t worker;
+        pthread_create( &worker, 0, runWorker, 0 );
+        pthread_detach( worker );
+        _workerStarted = true;
+    }
+    _queue.push_back( t );
+    ++_numPending;
+    pthread_cond_signal( &_workAvailable );
+    pthread_mutex_unlock( &_mutex );
+}
+
+void WaitForTasks() {
+    pthread_mutex_lock( &_mutex );
+    while ( _numPending > 0 ) {
+        pthread_cond_wait( &_workDone, &_mutex );
+    }
+    pthread_mutex_unlock( &_mutex );
+}
+
+} // namespace ibpm
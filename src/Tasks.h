@@ -0,0 +1,39 @@
+#ifndef _TASKS_H_
+#define _TASKS_H_
+
+/*!
+    \file Tasks.h
+
+    \brief Background execution of independent pieces of a substep.
+
+    A single persistent worker thread runs submitted tasks in order,
+    so work that does not depend on the main thread's current
+    computation can overlap it -- for example, the geometry and
+    operator update of a moving body overlapping the Helmholtz
+    right-hand-side assembly in IBSolver::advanceSubstep.  The caller
+    is responsible for the dependence structure: submit only work that
+    is independent of everything the main thread touches before the
+    matching WaitForTasks.
+
+    The worker is created lazily on the first submission, so runs that
+    never submit a task pay nothing.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+namespace ibpm {
+
+/// \brief Run the given task on the background worker thread.  The
+/// argument must stay valid until WaitForTasks returns.
+void SubmitTask( void (*task)( void* ), void* arg );
+
+/// \brief Block until every submitted task has finished
+void WaitForTasks();
+
+} // namespace ibpm
+
+#endif /* _TASKS_H_ */
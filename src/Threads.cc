@@ -0,0 +1,208 @@
+// Threads.cc
+//
+// Description:
+// Runtime control of the number of threads used by field kernels
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Threads.h"
+#include "Grid.h"
+#include "Scalar.h"
+#include "Flux.h"
+#include "VectorOperations.h"
+#include "Timers.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#if defined(_OPENMP) && defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ibpm {
+
+namespace {
+    int _numThreads = 1;
+    int _kernelThreads[NUM_KERNEL_CLASSES] = { 1, 1, 1 };
+    bool _pinned = false;
+}
+
+void SetNumThreads( int numThreads ) {
+    if ( numThreads < 1 ) {
+        numThreads = 1;
+    }
+    _numThreads = numThreads;
+    for (int k=0; k<NUM_KERNEL_CLASSES; ++k) {
+        _kernelThreads[k] = numThreads;
+    }
+}
+
+int GetNumThreads() {
+    return _numThreads;
+}
+
+int GetKernelThreads( int kernel ) {
+    return _kernelThreads[kernel];
+}
+
+void SetKernelThreads( int kernel, int numThreads ) {
+    if ( numThreads < 1 ) {
+        numThreads = 1;
+    }
+    _kernelThreads[kernel] = numThreads;
+}
+
+// Bind each OpenMP worker to one core.  The same team of threads is
+// reused for every parallel region (with a fixed thread count), so
+// binding them once here keeps thread t on core t for the whole run,
+// and the static partitioning of the kernels then keeps each thread on
+// the pages it first touched.
+void PinThreads() {
+#if defined(_OPENMP) && defined(__linux__)
+    int numCores = sysconf( _SC_NPROCESSORS_ONLN );
+    if ( numCores < 1 ) numCores = 1;
+#pragma omp parallel num_threads( _numThreads )
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO( &cpuset );
+        CPU_SET( omp_get_thread_num() % numCores, &cpuset );
+        pthread_setaffinity_np( pthread_self(), sizeof(cpuset), &cpuset );
+    }
+    _pinned = true;
+#endif
+}
+
+bool ThreadsPinned() {
+    return _pinned;
+}
+
+namespace {
+
+    // Best-of-three timing of reps repetitions of the stencil proxy
+    // (Curl) or the coarsification proxy, per candidate thread count
+    double timeStencil( const Flux& q, Scalar& w, int reps ) {
+        double best = -1.;
+        for (int trial=0; trial<3; ++trial) {
+            double t0 = Timers::readClock();
+            for (int r=0; r<reps; ++r) {
+                Curl( q, w );
+            }
+            double dt = ( Timers::readClock() - t0 ) / reps;
+            if ( best < 0. || dt < best ) best = dt;
+        }
+        return best;
+    }
+
+    double timeCoarsify( Scalar& w, int reps ) {
+        double best = -1.;
+        for (int trial=0; trial<3; ++trial) {
+            double t0 = Timers::readClock();
+            for (int r=0; r<reps; ++r) {
+                w.coarsify();
+            }
+            double dt = ( Timers::readClock() - t0 ) / reps;
+            if ( best < 0. || dt < best ) best = dt;
+        }
+        return best;
+    }
+
+} // namespace
+
+void CalibrateThreads( const Grid& grid, const std::string& cacheDir ) {
+    if ( _numThreads <= 1 ) return;
+
+    // Results are machine- and case-specific: key the cache file by
+    // host, grid dimensions, and the configured thread count
+    char host[256] = "unknown";
+#ifndef _WIN32
+    gethostname( host, sizeof(host) - 1 );
+    host[sizeof(host) - 1] = '\0';
+#endif
+    char cacheName[512];
+    snprintf( cacheName, sizeof(cacheName),
+        "%sthreads_%s_%dx%dx%d_t%d.cal", cacheDir.c_str(), host,
+        grid.Nx(), grid.Ny(), grid.Ngrid(), _numThreads );
+
+    FILE* fp = fopen( cacheName, "r" );
+    if ( fp != NULL ) {
+        int stencil, coarsify, fft;
+        if ( fscanf( fp, "ibpm thread calibration 1 "
+                     "stencil %d coarsify %d fft %d",
+                     &stencil, &coarsify, &fft ) == 3 ) {
+            fclose( fp );
+            SetKernelThreads( KERNEL_STENCIL, stencil );
+            SetKernelThreads( KERNEL_COARSIFY, coarsify );
+            SetKernelThreads( KERNEL_FFT, fft );
+            fprintf( stderr, "Thread calibration (cached): "
+                "stencil %d, coarsify %d, fft %d\n", stencil, coarsify, fft );
+            return;
+        }
+        fclose( fp );
+    }
+
+    // Enough repetitions for a few milliseconds per measurement
+    int gridPoints = grid.Nx() * grid.Ny() * grid.Ngrid();
+    int reps = 1 + (int)( 2000000 / ( gridPoints > 0 ? gridPoints : 1 ) );
+    if ( reps > 50 ) reps = 50;
+
+    Flux q( grid );
+    q = 1.;
+    Scalar w( grid );
+    w = 1.;
+
+    int bestStencil = 1;
+    int bestCoarsify = 1;
+    double bestStencilTime = -1.;
+    double bestCoarsifyTime = -1.;
+    for (int c = 1; c <= _numThreads; c = ( 2*c <= _numThreads ) ? 2*c
+                                                                 : c+1 ) {
+        // Candidates are the powers of two up to the global count, plus
+        // the global count itself
+        if ( c > 1 && c < _numThreads && ( c & (c-1) ) != 0 ) continue;
+        SetKernelThreads( KERNEL_STENCIL, c );
+        SetKernelThreads( KERNEL_COARSIFY, c );
+        Curl( q, w );   // warm the team before timing
+        double tStencil = timeStencil( q, w, reps );
+        double tCoarsify = timeCoarsify( w, reps );
+        if ( bestStencilTime < 0. || tStencil < bestStencilTime ) {
+            bestStencilTime = tStencil;
+            bestStencil = c;
+        }
+        if ( bestCoarsifyTime < 0. || tCoarsify < bestCoarsifyTime ) {
+            bestCoarsifyTime = tCoarsify;
+            bestCoarsify = c;
+        }
+    }
+    SetKernelThreads( KERNEL_STENCIL, bestStencil );
+    SetKernelThreads( KERNEL_COARSIFY, bestCoarsify );
+    // Transform plans are shared and live for the whole run, so the FFT
+    // count cannot be re-timed per candidate; the stencil result has
+    // the same footprint and stands in for it
+    SetKernelThreads( KERNEL_FFT, bestStencil );
+    fprintf( stderr, "Thread calibration: stencil %d, coarsify %d, fft %d "
+        "(of %d)\n", bestStencil, bestCoarsify, bestStencil, _numThreads );
+
+    fp = fopen( cacheName, "w" );
+    if ( fp != NULL ) {
+        fprintf( fp, "ibpm thread calibration 1\n"
+            "stencil %d\ncoarsify %d\nfft %d\n",
+            bestStencil, bestCoarsify, bestStencil );
+        fclose( fp );
+    }
+}
+
+} // namespace ibpm
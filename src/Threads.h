@@ -0,0 +1,86 @@
+#ifndef _THREADS_H_
+#define _THREADS_H_
+
+/*!
+    \file Threads.h
+
+    \brief Runtime control of the number of threads used by field kernels
+
+    When the code is compiled with OpenMP support (e.g. -fopenmp), the
+    expensive field kernels (such as Curl in VectorOperations) run with the
+    number of threads set here.  The default is one thread, so small grids
+    stay serial unless the user requests otherwise.  Without OpenMP support
+    these routines still compile, and the kernels always run serially.
+
+    On multi-socket machines the kernels are limited by memory bandwidth,
+    so the threads should stay where their pages are: PinThreads binds
+    each OpenMP worker to one core (thread t to core t), and freshly
+    allocated field buffers are first-touched in parallel with the same
+    static partitioning the kernels use (see acquireFieldBuffer in
+    Field.cc), so each thread's share of a field lands on its own NUMA
+    node.  Pinning is off by default and is a no-op without OpenMP.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+#include <string>
+
+namespace ibpm {
+
+class Grid;
+
+/// \brief Set the number of threads used by threaded field kernels.
+/// Values less than 1 are treated as 1 (serial); if compiled without
+/// OpenMP support, the setting is remembered but has no effect.
+/// Also resets every per-kernel count (see SetKernelThreads)
+void SetNumThreads( int numThreads );
+
+/// \brief Return the number of threads used by threaded field kernels
+int GetNumThreads();
+
+/// \brief Kernel classes whose thread counts can be set separately:
+/// their scaling sweet spots differ (the per-level coarsification
+/// sweeps are a quarter the size of the finest-level stencils, and are
+/// often faster serial), so one global count leaves performance on the
+/// table at some of the call sites
+enum KernelClass {
+    KERNEL_STENCIL,     // full-grid stencil sweeps (VectorOperations)
+    KERNEL_COARSIFY,    // small per-level sweeps (Scalar::coarsify)
+    KERNEL_FFT,         // sine-transform planning (EllipticSolver2d)
+    NUM_KERNEL_CLASSES
+};
+
+/// \brief Number of threads for the given kernel class (defaults to
+/// the global count of SetNumThreads)
+int GetKernelThreads( int kernel );
+
+/// \brief Set the number of threads for one kernel class
+void SetKernelThreads( int kernel, int numThreads );
+
+/// \brief Time the threaded kernels on this run's grid across
+/// candidate thread counts (1, 2, 4, ... up to the global count) and
+/// fix each class's count to its fastest.  The result is cached in
+/// cacheDir, keyed by host name, grid dimensions, and the global
+/// count, so later runs of the same case skip the measurement.  The
+/// FFT class is assigned the stencil result rather than measured:
+/// transform plans are created once and cached for the whole run, so
+/// their thread count cannot be re-timed per candidate.  Call before
+/// any solver is initialized (i.e. before any plan is created)
+void CalibrateThreads( const Grid& grid, const std::string& cacheDir );
+
+/// \brief Bind each worker thread to one core (thread t to core t,
+/// modulo the number of cores), so threaded kernels keep touching the
+/// same NUMA node; call after SetNumThreads.  No effect when compiled
+/// without OpenMP.
+void PinThreads();
+
+/// \brief Return true if PinThreads has bound the worker threads
+bool ThreadsPinned();
+
+} // namespace ibpm
+
+#endif /* _THREADS_H_ */
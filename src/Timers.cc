@@ -0,0 +1,324 @@
+// Timers.cc
+//
+// Description:
+// Implementation of the timing aggregates behind Timers.h
+//
+// Author(s):
+// Clancy Rowley
+//
+// Date: 27 Aug 2026
+//
+// $Revision$
+// $LastChangedDate$
+// $LastChangedBy$
+// $HeadURL$
+
+#include "Timers.h"
+#include <assert.h>
+#include <iomanip>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+using namespace std;
+
+namespace ibpm {
+
+namespace Timers {
+
+namespace {
+
+    const char* _names[NUM_SECTIONS] = {
+        "advance",
+        "substep",
+        "geometry",
+        "Ainv",
+        "B",
+        "C",
+        "Minv",
+        "smear",
+        "interp",
+        "output"
+    };
+
+    const char* _counterNames[NUM_COUNTERS] = {
+        "cg_iterations",
+        "fft_executions",
+        "smear_calls",
+        "interp_calls",
+        "cholesky_solves"
+    };
+
+    bool _enabled = false;
+    long _count[NUM_SECTIONS];
+    double _total[NUM_SECTIONS];
+    double _min[NUM_SECTIONS];
+    double _max[NUM_SECTIONS];
+    double _stepTotal[NUM_SECTIONS];
+    long _counters[NUM_COUNTERS];
+    long _stepCounters[NUM_COUNTERS];
+    FILE* _stepFp = NULL;
+
+    // Output routines may run on the asynchronous writer thread (see
+    // Logger), so the aggregates are updated under a mutex; a few locks
+    // per substep are negligible next to the sections being timed
+    pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    // One recorded begin/end interval of an instrumented section
+    struct TraceEvent {
+        int section;
+        int tid;
+        double start;
+        double end;
+    };
+
+    string _traceFilename;
+    int _traceFirstStep = 0;
+    int _traceLastStep = -1;
+    bool _traceConfigured = false;
+    bool _tracing = false;
+    vector<TraceEvent> _traceEvents;
+
+    // Small-integer thread ids for the trace: slot 0 is whichever thread
+    // records the first event (normally the main thread)
+    const int MAX_TRACE_THREADS = 8;
+    pthread_t _traceThreads[MAX_TRACE_THREADS];
+    int _numTraceThreads = 0;
+
+    // Caller holds _mutex
+    int traceThreadId() {
+        pthread_t self = pthread_self();
+        for (int t=0; t<_numTraceThreads; ++t) {
+            if ( pthread_equal( _traceThreads[t], self ) ) return t;
+        }
+        if ( _numTraceThreads < MAX_TRACE_THREADS ) {
+            _traceThreads[_numTraceThreads] = self;
+            return _numTraceThreads++;
+        }
+        return MAX_TRACE_THREADS - 1;
+    }
+
+} // namespace
+
+void bump( int counter ) {
+    bumpBy( counter, 1 );
+}
+
+void bumpBy( int counter, long n ) {
+    assert( counter >= 0 && counter < NUM_COUNTERS );
+#if defined(__GNUC__)
+    __sync_fetch_and_add( &_counters[counter], n );
+    __sync_fetch_and_add( &_stepCounters[counter], n );
+#else
+    // counted events all occur on the main thread; without the GCC
+    // builtins a plain add is close enough for instrumentation
+    _counters[counter] += n;
+    _stepCounters[counter] += n;
+#endif
+}
+
+long counterValue( int counter ) {
+    assert( counter >= 0 && counter < NUM_COUNTERS );
+    return _counters[counter];
+}
+
+void setEnabled( bool enabled ) {
+    pthread_mutex_lock( &_mutex );
+    if ( enabled && ! _enabled ) {
+        for (int s=0; s<NUM_SECTIONS; ++s) {
+            _count[s] = 0;
+            _total[s] = 0.;
+            _min[s] = 0.;
+            _max[s] = 0.;
+            _stepTotal[s] = 0.;
+        }
+    }
+    _enabled = enabled;
+    pthread_mutex_unlock( &_mutex );
+}
+
+bool isEnabled() {
+    return _enabled;
+}
+
+double readClock() {
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + 1.e-9 * t.tv_nsec;
+}
+
+void accumulate( int section, double seconds ) {
+    assert( section >= 0 && section < NUM_SECTIONS );
+    pthread_mutex_lock( &_mutex );
+    if ( _count[section] == 0 || seconds < _min[section] ) {
+        _min[section] = seconds;
+    }
+    if ( _count[section] == 0 || seconds > _max[section] ) {
+        _max[section] = seconds;
+    }
+    ++_count[section];
+    _total[section] += seconds;
+    _stepTotal[section] += seconds;
+    pthread_mutex_unlock( &_mutex );
+}
+
+bool setStepFile( string filename ) {
+    setEnabled( true );
+    pthread_mutex_lock( &_mutex );
+    if ( _stepFp != NULL ) fclose( _stepFp );
+    _stepFp = fopen( filename.c_str(), "w" );
+    bool ok = ( _stepFp != NULL );
+    if ( ok ) {
+        fprintf( _stepFp, "timestep" );
+        for (int s=0; s<NUM_SECTIONS; ++s) {
+            fprintf( _stepFp, ",%s", _names[s] );
+        }
+        for (int c=0; c<NUM_COUNTERS; ++c) {
+            fprintf( _stepFp, ",%s", _counterNames[c] );
+        }
+        fprintf( _stepFp, "\n" );
+    }
+    pthread_mutex_unlock( &_mutex );
+    return ok;
+}
+
+void stepDone( int timestep ) {
+    if ( ! _enabled ) return;
+    pthread_mutex_lock( &_mutex );
+    if ( _stepFp != NULL ) {
+        fprintf( _stepFp, "%d", timestep );
+        for (int s=0; s<NUM_SECTIONS; ++s) {
+            fprintf( _stepFp, ",%.6e", _stepTotal[s] );
+        }
+        for (int c=0; c<NUM_COUNTERS; ++c) {
+            fprintf( _stepFp, ",%ld", _stepCounters[c] );
+        }
+        fprintf( _stepFp, "\n" );
+    }
+    for (int s=0; s<NUM_SECTIONS; ++s) {
+        _stepTotal[s] = 0.;
+    }
+    for (int c=0; c<NUM_COUNTERS; ++c) {
+        _stepCounters[c] = 0;
+    }
+    pthread_mutex_unlock( &_mutex );
+}
+
+void setTrace( string filename, int firstStep, int lastStep ) {
+    setEnabled( true );
+    pthread_mutex_lock( &_mutex );
+    _traceFilename = filename;
+    _traceFirstStep = firstStep;
+    _traceLastStep = lastStep;
+    _traceConfigured = true;
+    _tracing = false;
+    _traceEvents.clear();
+    pthread_mutex_unlock( &_mutex );
+}
+
+void setTraceStep( int timestep ) {
+    if ( ! _traceConfigured ) return;
+    _tracing = ( timestep >= _traceFirstStep && timestep <= _traceLastStep );
+}
+
+bool isTracing() {
+    return _tracing;
+}
+
+void traceEvent( int section, double start, double end ) {
+    assert( section >= 0 && section < NUM_SECTIONS );
+    pthread_mutex_lock( &_mutex );
+    TraceEvent e;
+    e.section = section;
+    e.tid = traceThreadId();
+    e.start = start;
+    e.end = end;
+    _traceEvents.push_back( e );
+    pthread_mutex_unlock( &_mutex );
+}
+
+// Write the recorded events as a JSON array of complete ("ph":"X")
+// events, the format read by chrome://tracing and compatible viewers.
+// Caller holds _mutex
+static void writeTraceFile( ostream& out ) {
+    FILE* fp = fopen( _traceFilename.c_str(), "w" );
+    if ( fp == NULL ) {
+        out << "Warning: could not open trace file " << _traceFilename << endl;
+        return;
+    }
+    // Timestamps are microseconds relative to the earliest event
+    double t0 = _traceEvents[0].start;
+    for (unsigned int k=1; k<_traceEvents.size(); ++k) {
+        if ( _traceEvents[k].start < t0 ) t0 = _traceEvents[k].start;
+    }
+    fprintf( fp, "{\"traceEvents\":[\n" );
+    for (unsigned int k=0; k<_traceEvents.size(); ++k) {
+        const TraceEvent& e = _traceEvents[k];
+        fprintf( fp,
+            "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            _names[e.section], e.tid,
+            ( e.start - t0 ) * 1.e6, ( e.end - e.start ) * 1.e6,
+            ( k + 1 < _traceEvents.size() ) ? "," : "" );
+    }
+    fprintf( fp, "]}\n" );
+    fclose( fp );
+    out << "Wrote " << _traceEvents.size() << " trace events to "
+        << _traceFilename << endl;
+}
+
+void printSummary( ostream& out ) {
+    pthread_mutex_lock( &_mutex );
+    bool anyTimed = false;
+    for (int s=0; s<NUM_SECTIONS; ++s) {
+        if ( _count[s] > 0 ) anyTimed = true;
+    }
+    if ( anyTimed ) {
+        out << "\n-- timing summary (seconds) --" << endl;
+        out << setw(10) << left << "section" << right
+            << setw(10) << "calls"
+            << setw(14) << "total"
+            << setw(14) << "avg"
+            << setw(14) << "min"
+            << setw(14) << "max" << endl;
+        for (int s=0; s<NUM_SECTIONS; ++s) {
+            if ( _count[s] == 0 ) continue;
+            out << setw(10) << left << _names[s] << right
+                << setw(10) << _count[s]
+                << setw(14) << scientific << setprecision(4) << _total[s]
+                << setw(14) << _total[s] / _count[s]
+                << setw(14) << _min[s]
+                << setw(14) << _max[s] << endl;
+        }
+        out.unsetf( ios::scientific );
+        out << "------------------------------" << endl;
+    }
+    bool anyCounted = false;
+    for (int c=0; c<NUM_COUNTERS; ++c) {
+        if ( _counters[c] > 0 ) anyCounted = true;
+    }
+    if ( anyCounted ) {
+        out << "\n-- event counters --" << endl;
+        for (int c=0; c<NUM_COUNTERS; ++c) {
+            if ( _counters[c] == 0 ) continue;
+            out << setw(16) << left << _counterNames[c] << right
+                << setw(12) << _counters[c] << endl;
+        }
+        out << "--------------------" << endl;
+    }
+    if ( _traceConfigured && ! _traceEvents.empty() ) {
+        writeTraceFile( out );
+        _traceEvents.clear();
+        _tracing = false;
+    }
+    if ( _stepFp != NULL ) {
+        fclose( _stepFp );
+        _stepFp = NULL;
+    }
+    pthread_mutex_unlock( &_mutex );
+}
+
+} // namespace Timers
+
+} // namespace ibpm
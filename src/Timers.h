@@ -0,0 +1,146 @@
+#ifndef _TIMERS_H_
+#define _TIMERS_H_
+
+#include <iostream>
+#include <string>
+
+/*!
+    \file Timers.h
+
+    \brief Low-overhead timing of the stages of the timestep loop.
+
+    Scoped timers accumulate the wall time spent in each instrumented
+    section (the advance loop, the pieces of the projection solve, the
+    regularizer, and output).  Timing is off by default: a ScopedTimer
+    constructed while timing is disabled reads no clock and costs one
+    branch.  When enabled (the -timing flag of the main program), a
+    summary table of call counts and total/average/min/max times is
+    printed at exit, and optionally a CSV file records the time spent in
+    each section at every timestep.
+
+    Sections nest: Ainv, B, C, and Minv run inside ADVANCE, and the
+    regularizer sections run inside B and C, so child times are included
+    in their parents' totals.
+
+    Independent of the scoped timers, cheap always-on event counters
+    track how often the expensive operations run (conjugate gradient
+    iterations, FFT executions, regularizer transfers, Cholesky
+    substitutions).  These cost one atomic add per event and are printed
+    with the summary; they are what distinguishes two runs on identical
+    grids that differ only in how hard the constraint solve works.
+
+    \author Clancy Rowley
+    \author $LastChangedBy$
+    \date 27 Aug 2026
+    \date $LastChangedDate$
+    \version $Revision$
+*/
+
+namespace ibpm {
+
+namespace Timers {
+
+/// Instrumented sections of the timestep loop
+enum Section {
+    ADVANCE,    // one full call to IBSolver::advance
+    SUBSTEP,    // one substep of the integration scheme
+    GEOMETRY,   // moving-body geometry and operator updates
+    AINV,       // ProjectionSolver::Ainv (Helmholtz solve)
+    B_OP,       // ProjectionSolver::B (smear boundary force to grid)
+    C_OP,       // ProjectionSolver::C (interpolate velocity to boundary)
+    MINV,       // constraint solve (Cholesky or conjugate gradient)
+    SMEAR,      // Regularizer::toFlux
+    INTERP,     // Regularizer::toBoundary
+    OUTPUT,     // Logger output routines (including asynchronous writer)
+    NUM_SECTIONS
+};
+
+/// Counted events (always on, independent of the scoped timers)
+enum Counter {
+    CG_ITERATIONS,      // conjugate gradient iterations, all substeps
+    FFT_EXECUTIONS,     // FFT executions in the elliptic solvers
+    SMEAR_CALLS,        // Regularizer::toFlux transfers
+    INTERP_CALLS,       // Regularizer::toBoundary transfers
+    CHOLESKY_SOLVES,    // back-substitutions against a Cholesky factor
+    NUM_COUNTERS
+};
+
+/// \brief Add one to the given event counter
+void bump( int counter );
+
+/// \brief Add n to the given event counter
+void bumpBy( int counter, long n );
+
+/// \brief Return the current value of the given event counter
+long counterValue( int counter );
+
+/// \brief Turn timing on or off (off by default)
+void setEnabled( bool enabled );
+
+/// \brief Return true if timing is enabled
+bool isEnabled();
+
+/// \brief Return the current wall time, in seconds from an arbitrary
+/// origin (monotonic clock)
+double readClock();
+
+/// \brief Add an interval to the given section's aggregate; normally
+/// called only by ScopedTimer
+void accumulate( int section, double seconds );
+
+/// \brief Open a CSV file recording the per-step section times; enables
+/// timing.  Returns false if the file cannot be opened.
+bool setStepFile( std::string filename );
+
+/// \brief Write one row of the per-step CSV (if open) and reset the
+/// per-step aggregates; call once per step of the main loop
+void stepDone( int timestep );
+
+/// \brief Record begin/end events of every section for timesteps in
+/// [firstStep, lastStep] into a chrome://tracing-compatible JSON file,
+/// written when printSummary is called; enables timing
+void setTrace( std::string filename, int firstStep, int lastStep );
+
+/// \brief Turn event recording on or off according to the trace window;
+/// call at the top of each step of the main loop
+void setTraceStep( int timestep );
+
+/// \brief Return true if trace events are currently being recorded
+bool isTracing();
+
+/// \brief Record one trace event (normally called only by ScopedTimer);
+/// start and end are readClock() values
+void traceEvent( int section, double start, double end );
+
+/// \brief Print a summary table of all sections with nonzero counts and
+/// of all nonzero event counters, and close the per-step CSV file if one
+/// is open
+void printSummary( std::ostream& out );
+
+} // namespace Timers
+
+/// \brief Accumulate the wall time between construction and destruction
+/// into the given section's aggregate.  Does nothing if timing is
+/// disabled.
+class ScopedTimer {
+public:
+    explicit ScopedTimer( int section ) :
+        _section( section ),
+        _start( Timers::isEnabled() ? Timers::readClock() : -1. ) {}
+    ~ScopedTimer() {
+        if ( _start >= 0. ) {
+            double end = Timers::readClock();
+            Timers::accumulate( _section, end - _start );
+            if ( Timers::isTracing() ) {
+                Timers::traceEvent( _section, _start, end );
+            }
+        }
+    }
+private:
+    int _section;
+    double _start;
+};
+
+} // namespace ibpm
+
+#endif /* _TIMERS_H_ */
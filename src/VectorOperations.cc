@@ -22,8 +22,13 @@
 #include "BoundaryVector.h"
 #include "VectorOperations.h"
 #include "NavierStokesModel.h"
+#include "Kernels.h"
+#include "Threads.h"
+#include "FlowMonitor.h"
 #include <fftw3.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 using Array::Array2;
 
@@ -31,22 +36,35 @@ namespace ibpm {
 
 // Compute the curl of Flux q, as a Scalar object f
 void Curl(const Flux& q, Scalar& f ) {
+    Curl( q, f, q.Ngrid() );
+}
+
+// As above, computing only the finest maxlev levels
+void Curl(const Flux& q, Scalar& f, int maxlev ) {
     assert( q.Nx() == f.Nx() );
     assert( q.Ny() == f.Ny() );
     assert( q.Ngrid() == f.Ngrid() );
+    assert( maxlev >= 1 && maxlev <= q.Ngrid() );
     int nx = q.Nx();
     int ny = q.Ny();
-    
+    int ngrid = maxlev;
+
     // Curl (u,v) = v_x - u_y
 
+    // All levels are independent here, so the loops over levels and rows
+    // may be shared among threads
     // Start with finest grid, to coarsest grid
-    for (int lev=0; lev<q.Ngrid(); ++lev ) {
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2) num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int lev=0; lev<ngrid; ++lev ) {
         // compute curl at all nodes
-        double dx = q.Dx(lev);
-        double bydx2 = 1. / (dx * dx);
         for (int i=1; i<nx; ++i) {
+            double dx = q.Dx(lev);
+            double bydx2 = 1. / (dx * dx);
             for (int j=1; j<ny; ++j) {
-                f(lev,i,j) = ( q(lev,Y,i,j) - q(lev,Y,i-1,j) 
+                f(lev,i,j) = ( q(lev,Y,i,j) - q(lev,Y,i-1,j)
                     + q(lev,X,i,j-1) - q(lev,X,i,j) ) * bydx2;
             }
         }
@@ -59,21 +77,171 @@ Scalar Curl(const Flux& q) {
     return omega;
 }
 
+// Write one output row of the interior differences in CurlImpl:
+//     out[k] = a[k] - b[k] ( + add[k] )   for k in [lo,hi],
+// and zero (or add[k]) for the remaining offsets in 0..n-1, where the
+// differences are known to vanish.  An empty range (lo > hi) writes no
+// differences at all, reducing the row to a fill or a copy
+static inline void DiffRowBoxed( double* out, const double* a,
+    const double* b, const double* add, int lo, int hi, int n ) {
+    if ( lo < 0 ) lo = 0;
+    if ( hi > n-1 ) hi = n-1;
+    if ( lo > hi ) {
+        lo = n;
+        hi = n-1;
+    }
+    if ( add != 0 ) {
+        std::copy( add, add + lo, out );
+        Kernels::DiffAdd( out + lo, a + lo, b + lo, add + lo, hi - lo + 1 );
+        std::copy( add + hi + 1, add + n, out + hi + 1 );
+    }
+    else {
+        std::fill( out, out + lo, 0. );
+        Kernels::Diff( out + lo, a + lo, b + lo, hi - lo + 1 );
+        std::fill( out + hi + 1, out + n, 0. );
+    }
+}
+
+// Fold one level's monitoring metrics right after its curl output
+// pass, while the freshly written fluxes are still cache resident:
+// the peak flux magnitude (CFL-weighted in FlowMonitorFlux) and the
+// peak cell divergence, which is roundoff-level for the curl of a
+// streamfunction and so flags corrupted state.  The inverted
+// comparisons propagate NaN into the running maxima
+static void MonitorFluxLevel( const Flux& q, int lev ) {
+    int nx = q.Nx();
+    int ny = q.Ny();
+    const double* qd = q.flatten(lev);
+    int n = q.getSize() / q.Ngrid();
+    double m = 0.;
+    for (int k=0; k<n; ++k) {
+        double a = fabs( qd[k] );
+        if ( ! ( a <= m ) ) m = a;
+    }
+    FlowMonitorFlux( m, q.Dx(lev) );
+    double d = 0.;
+    for (int i=0; i<nx; ++i) {
+        for (int j=0; j<ny; ++j) {
+            double div = q(lev,X,i+1,j) - q(lev,X,i,j)
+                       + q(lev,Y,i,j+1) - q(lev,Y,i,j);
+            double a = fabs( div );
+            if ( ! ( a <= d ) ) d = a;
+        }
+    }
+    FlowMonitorDivergence( d );
+}
+
+// Single-domain specialization of the Scalar -> Flux curl below: with
+// one level the boundary values of f are identically zero, so the BC
+// object, its per-call allocation, and the coarse-grid interpolation
+// drop out entirely
+static void CurlSingle(const Scalar& f, const Flux* add, Flux& q) {
+    int nx = f.Nx();
+    int ny = f.Ny();
+    const Array2<double> fd = f[0];
+    double* qlev = q.flatten(0);
+    const double* addlev = ( add != 0 ) ? add->flatten(0) : 0;
+    int i1, i2, j1, j2;
+    bool active = f.activeBox( 0, i1, i2, j1, j2 );
+
+    // X direction: u = df/dy, interior points
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int i=1; i<nx; ++i) {
+        bool rowActive = active && i >= i1 && i <= i2;
+        DiffRowBoxed( qlev + q.getIndex(X,i,1), &fd(i,2), &fd(i,1),
+            ( addlev != 0 ) ? addlev + q.getIndex(X,i,1) : 0,
+            rowActive ? j1-2 : 0, rowActive ? j2-1 : -1, ny-2 );
+    }
+    // top and bottom boundaries (boundary values of f are zero)
+    for (int i=1; i<nx; ++i) {
+        q(0,X,i,0) = fd(i,1);
+        q(0,X,i,ny-1) = -fd(i,ny-1);
+    }
+    // left and right boundaries
+    for (int j=0; j<ny; ++j) {
+        q(0,X,0,j) = 0.;
+        q(0,X,nx,j) = 0.;
+    }
+
+    // Y direction: v = -df/dx, interior points
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int i=1; i<nx-1; ++i) {
+        bool rowActive = active && i >= i1-1 && i <= i2;
+        DiffRowBoxed( qlev + q.getIndex(Y,i,1), &fd(i,1), &fd(i+1,1),
+            ( addlev != 0 ) ? addlev + q.getIndex(Y,i,1) : 0,
+            rowActive ? j1-1 : 0, rowActive ? j2-1 : -1, ny-1 );
+    }
+    // left and right boundaries
+    for (int j=1; j<ny; ++j) {
+        q(0,Y,0,j) = -fd(1,j);
+        q(0,Y,nx-1,j) = fd(nx-1,j);
+    }
+    // top and bottom boundaries
+    for (int i=0; i<nx; ++i) {
+        q(0,Y,i,0) = 0.;
+        q(0,Y,i,ny) = 0.;
+    }
+
+    if ( add != 0 ) {
+        for (int i=1; i<nx; ++i) {
+            q(0,X,i,0) += (*add)(0,X,i,0);
+            q(0,X,i,ny-1) += (*add)(0,X,i,ny-1);
+        }
+        for (int j=0; j<ny; ++j) {
+            q(0,X,0,j) += (*add)(0,X,0,j);
+            q(0,X,nx,j) += (*add)(0,X,nx,j);
+        }
+        for (int j=1; j<ny; ++j) {
+            q(0,Y,0,j) += (*add)(0,Y,0,j);
+            q(0,Y,nx-1,j) += (*add)(0,Y,nx-1,j);
+        }
+        for (int i=0; i<nx; ++i) {
+            q(0,Y,i,0) += (*add)(0,Y,i,0);
+            q(0,Y,i,ny) += (*add)(0,Y,i,ny);
+        }
+    }
+
+    if ( FlowMonitorEnabled() ) {
+        MonitorFluxLevel( q, 0 );
+    }
+}
+
 // Return the curl of Scalar f, as a Flux object q.
-void Curl(const Scalar& f, Flux& q) {
+// Shared implementation of the Scalar -> Flux curl, optionally folding
+// an additive flux (e.g. a steady base flow) into the output pass
+static void CurlImpl(const Scalar& f, const Flux* add, Flux& q) {
     assert( f.Nx() == q.Nx() );
     assert( f.Ny() == q.Ny() );
     assert( f.Ngrid() == q.Ngrid() );
     int nx = f.Nx();
     int ny = f.Ny();
+    int ngrid = f.Ngrid();
 
-    // boundary condition object for use in computing curl on finer grids
-    BC bc(nx,ny);
-    
-    // From coarsest grid to finest
-    for (int lev=f.Ngrid()-1; lev >= 0; --lev) {
+    if ( ngrid == 1 ) {
+        CurlSingle( f, add, q );
+        return;
+    }
+
+    // Each level reads only f at its own and the next coarser level
+    // (through getBC) and writes fluxes at its own level, so the levels
+    // are independent and may be shared among threads; the row loops
+    // below then split the threads only on single-level grids
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 && ngrid > 1 )
+#endif
+    for (int lev=ngrid-1; lev >= 0; --lev) {
+        // boundary condition object for computing curl on finer grids,
+        // private to each level's thread
+        BC bc(nx,ny);
         // For outermost grid, all boundaries are zero
-        if (lev == f.Ngrid()-1) {
+        if (lev == ngrid-1) {
             bc = 0.;
         }
         // Otherwise, get bc from next coarser grid
@@ -81,13 +249,35 @@ void Curl(const Scalar& f, Flux& q) {
             f.getBC( lev, bc );
         }
 
+        // Slices of the data at this level: fd(i,j) is contiguous in j,
+        // as is each gridline of fluxes, so the interior differences below
+        // run one contiguous row at a time in the dispatched kernel
+        const Array2<double> fd = f[lev];
+        double* qlev = q.flatten(lev);
+        const double* addlev = ( add != 0 ) ? add->flatten(lev) : 0;
+
+        // Active bounding box of f at this level: the interior differences
+        // vanish outside it, so those rows reduce to a fill (or a copy of
+        // the additive field), skipping the far-field sweeps on the coarse
+        // outer levels, where f is zero outside the advected wake
+        int i1, i2, j1, j2;
+        bool active = f.activeBox( lev, i1, i2, j1, j2 );
+
         // X direction: u = df/dy
-        
+
         // Compute all points except boundaries
-        for (int j=1; j<ny-1; ++j) {
-            for (int i=1; i<nx; ++i) {
-                q(lev,X,i,j) = f(lev,i,j+1) - f(lev,i,j);
-            }
+        // (rows are independent, so they may be shared among threads)
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 && ngrid == 1 )
+#endif
+        for (int i=1; i<nx; ++i) {
+            // q(lev,X,i,j) = f(lev,i,j+1) - f(lev,i,j),  for j in 1..ny-2,
+            // nonzero only for j in j1-1..j2 within rows i1..i2
+            bool rowActive = active && i >= i1 && i <= i2;
+            DiffRowBoxed( qlev + q.getIndex(X,i,1), &fd(i,2), &fd(i,1),
+                ( addlev != 0 ) ? addlev + q.getIndex(X,i,1) : 0,
+                rowActive ? j1-2 : 0, rowActive ? j2-1 : -1, ny-2 );
         }
         // top and bottom boundaries
         for (int i=1; i<nx; ++i) {
@@ -99,16 +289,33 @@ void Curl(const Scalar& f, Flux& q) {
             q(lev,X,0,j) = bc.left(j+1) - bc.left(j);
             q(lev,X,nx,j) = bc.right(j+1) - bc.right(j);
         }
+        if ( add != 0 ) {
+            for (int i=1; i<nx; ++i) {
+                q(lev,X,i,0) += (*add)(lev,X,i,0);
+                q(lev,X,i,ny-1) += (*add)(lev,X,i,ny-1);
+            }
+            for (int j=0; j<ny; ++j) {
+                q(lev,X,0,j) += (*add)(lev,X,0,j);
+                q(lev,X,nx,j) += (*add)(lev,X,nx,j);
+            }
+        }
 
         // Y direction: v = -df/dx
-        
+
         // Compute all points except boundaries
-        for (int j=1; j<ny; ++j) {
-            for (int i=1; i<nx-1; ++i) {
-                q(lev,Y,i,j) = f(lev,i,j) - f(lev,i+1,j);
-            }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 && ngrid == 1 )
+#endif
+        for (int i=1; i<nx-1; ++i) {
+            // q(lev,Y,i,j) = f(lev,i,j) - f(lev,i+1,j),  for j in 1..ny-1,
+            // nonzero only for j in j1..j2 within rows i1-1..i2
+            bool rowActive = active && i >= i1-1 && i <= i2;
+            DiffRowBoxed( qlev + q.getIndex(Y,i,1), &fd(i,1), &fd(i+1,1),
+                ( addlev != 0 ) ? addlev + q.getIndex(Y,i,1) : 0,
+                rowActive ? j1-1 : 0, rowActive ? j2-1 : -1, ny-1 );
         }
-        
+
         // left and right boundaries
         for (int j=1; j<ny; ++j) {
             q(lev,Y,0,j) = bc.left(j) - f(lev,1,j);
@@ -119,9 +326,32 @@ void Curl(const Scalar& f, Flux& q) {
             q(lev,Y,i,0) = bc.bottom(i) - bc.bottom(i+1);
             q(lev,Y,i,ny) = bc.top(i) - bc.top(i+1);
         }
+        if ( add != 0 ) {
+            for (int j=1; j<ny; ++j) {
+                q(lev,Y,0,j) += (*add)(lev,Y,0,j);
+                q(lev,Y,nx-1,j) += (*add)(lev,Y,nx-1,j);
+            }
+            for (int i=0; i<nx; ++i) {
+                q(lev,Y,i,0) += (*add)(lev,Y,i,0);
+                q(lev,Y,i,ny) += (*add)(lev,Y,i,ny);
+            }
+        }
+
+        if ( FlowMonitorEnabled() ) {
+            MonitorFluxLevel( q, lev );
+        }
     }
 }
 
+void Curl(const Scalar& f, Flux& q) {
+    CurlImpl( f, 0, q );
+}
+
+void Curl(const Scalar& f, const Flux& add, Flux& q) {
+    assert( add.Ngrid() == f.Ngrid() );
+    CurlImpl( f, &add, q );
+}
+
 Flux Curl(const Scalar& f) {
     Flux q( f.getGrid() );
     Curl( f, q );
@@ -134,43 +364,33 @@ void Laplacian(const Scalar& f, Scalar& g) {
     assert( f.Nx() == g.Nx() );
     assert( f.Ny() == g.Ny() );
     assert( f.Ngrid() == g.Ngrid() );
+    int ngrid = f.Ngrid();
 
-    // Laplacian = - Curl( Curl( ) )
-    Flux q = Curl( f );
-    Curl( q, g );
-    g *= -1;
-    
-   // // Single-grid version
-//    assert( f.Ngrid() == 1 );
-//    double bydx2 = 1. / (f.Dx() * f.Dx());
-//    int nx = f.Nx();
-//    int ny = f.Ny();
-//    
-//    for (int i=2; i<nx-1; ++i) {
-//        for (int j=2; j<ny-1; ++j) {
-//            g(0,i,j) = f(0,i-1,j) + f(0,i+1,j) + f(0,i,j-1) + f(0,i,j+1) -4*f(0,i,j);
-//            g(0,i,j) *= bydx2;
-//        }
-//    }
-//    // left and right edges
-//    for (int j=2; j<ny-1; ++j) {
-//        g(0,1,j) = f(0,2,j) + f(0,1,j+1) + f(0,1,j-1) - 4*f(0,1,j);
-//        g(0,1,j) *= bydx2;
-//        g(0,nx-1,j) = f(0,nx-2,j) + f(0,nx-1,j+1) + f(0,nx-1,j-1) - 4*f(0,nx-1,j);
-//        g(0,nx-1,j) *= bydx2;
-//    }
-//    // top and bottom edges
-//    for (int i=2; i<nx-1; ++i) {
-//        g(0,i,1) = f(0,i,2) + f(0,i+1,1) + f(0,i-1,1) - 4*f(0,i,1);
-//        g(0,i,1) *= bydx2;
-//        g(0,i,ny-1) = f(0,i,ny-2) + f(0,i+1,ny-1) + f(0,i-1,ny-1) - 4*f(0,i,ny-1);
-//        g(0,i,ny-1) *= bydx2;
-//    }
-//    // corners
-//    g(0,1,1) = ( f(0,1,2) + f(0,2,1) - 4 * f(0,1,1) ) * bydx2;
-//    g(0,nx-1,1) = ( f(0,nx-1,2) + f(0,nx-2,1) - 4 * f(0,nx-1,1) ) * bydx2;
-//    g(0,1,ny-1) = ( f(0,1,ny-2) + f(0,2,ny-1) - 4 * f(0,1,ny-1) ) * bydx2;
-//    g(0,nx-1,ny-1) = ( f(0,nx-2,ny-1) + f(0,nx-1,ny-2) - 4 * f(0,nx-1,ny-1) ) * bydx2;
+    // The multi-domain Laplacian -Curl( Curl( f ) ) decouples by level:
+    // the curl at level lev reads only f at lev plus the boundary values
+    // interpolated from the next coarser grid, so the composite collapses
+    // to the 5-point stencil with those boundary values on the rim.
+    // Applying the stencil directly, level by level, skips the Flux
+    // temporary and one full sweep of the fields; the single-level
+    // routine below streams the interior rows through the dispatched
+    // kernel, with the boundary rim handled in separate loops
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 && ngrid > 1 )
+#endif
+    for (int lev=0; lev<ngrid; ++lev) {
+        BC bc( f.Nx(), f.Ny() );
+        if ( lev == ngrid-1 ) {
+            // coarsest grid: boundary values are zero
+            bc = 0.;
+        }
+        else {
+            f.getBC( lev, bc );
+        }
+        const Array2<double> fd = f[lev];
+        Array2<double> gd = g[lev];
+        Laplacian( fd, f.Dx(lev), bc, gd );
+    }
 }
 
 void Laplacian( const Array2<double>& f,
@@ -186,11 +406,13 @@ void Laplacian( const Array2<double>& f,
     int nx = bc.Nx();
     int ny = bc.Ny();
     
+    // Interior rows stream through the dispatched stencil kernel.  Each
+    // row of f is read three times (as the center row and as the up/down
+    // neighbor of the adjacent rows), but the revisits hit rows still in
+    // cache, so the sweep runs at streaming bandwidth with no blocking
     for (int i=2; i<nx-1; ++i) {
-        for (int j=2; j<ny-1; ++j) {
-            g(i,j) = f(i-1,j) + f(i+1,j) + f(i,j-1) + f(i,j+1) -4*f(i,j);
-            g(i,j) *= bydx2;
-        }
+        Kernels::Stencil5( &g(i,2), &f(i,2), &f(i+1,2), &f(i-1,2),
+                           bydx2, ny-3 );
     }
     // left and right edges
     for (int j=2; j<ny-1; ++j) {
@@ -221,25 +443,66 @@ Scalar Laplacian( const Scalar& f ) {
     
     
 // ~~~~~~~~~~~~~~~~~~~~~~
+// The inner products below spend nearly all their time in flat dot
+// products over the finest grid, so those run in the dispatched kernel
+// (see Kernels.h).
+
+// Deterministic threaded dot product over a contiguous range: the range
+// is split into fixed-size chunks, each chunk is summed by the
+// dispatched kernel, and the per-chunk partial sums are accumulated in
+// index order.  The split depends only on the length, never on the
+// number of threads, so the result is bitwise reproducible at any
+// thread count -- regression comparisons against archived force and
+// energy histories depend on this
+static const int innerProductChunk = 8192;
+
+static double DeterministicDot( const double* a, const double* b, int n ) {
+    if ( n <= innerProductChunk ) {
+        return Kernels::Dot( a, b, n );
+    }
+    int numChunks = ( n + innerProductChunk - 1 ) / innerProductChunk;
+    std::vector<double> partial( numChunks );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int c=0; c < numChunks; ++c) {
+        int begin = c * innerProductChunk;
+        int len = n - begin;
+        if ( len > innerProductChunk ) len = innerProductChunk;
+        partial[c] = Kernels::Dot( a + begin, b + begin, len );
+    }
+    double sum = 0.;
+    for (int c=0; c < numChunks; ++c) {
+        sum += partial[c];
+    }
+    return sum;
+}
+
+// Dot product of a contiguous range of flux indices on a single level
+static inline double FluxRangeDot(
+    const Flux& p,
+    const Flux& q,
+    int lev,
+    Flux::index begin,
+    Flux::index end
+    ) {
+    return Kernels::Dot( p.flatten(lev) + begin, q.flatten(lev) + begin,
+                         end - begin );
+}
+
 // Inner product of two Scalars, taken over the finest domain only
 double FineGridInnerProduct( const Scalar& f, const Scalar& g ) {
     assert( f.Ngrid() == g.Ngrid() );
     assert( f.Nx() == g.Nx() );
     assert( f.Ny() == g.Ny() );
-    
-    double ip = 0.;
-    int nx = f.Nx();
-    int ny = f.Ny();
-    
-    // Finest grid interior points
+
+    // Finest grid interior points (i in 1..nx-1, j in 1..ny-1) are exactly
+    // the points stored for level 0, as one contiguous block
     double dx2 = f.Dx() * f.Dx();
-    for (int i = 1; i < nx; ++i) {
-        for ( int j = 1; j < ny; ++j) {
-            ip += f( 0 ,i, j ) * g( 0 ,i, j ) * dx2;
-        }
-    }
-    
-    return ip;
+    const Array2<double> fd = f[0];
+    const Array2<double> gd = g[0];
+    return DeterministicDot( &fd(0), &gd(0), fd.Size() ) * dx2;
 }
 
 
@@ -314,28 +577,36 @@ double InnerProduct (const Scalar& f, const Scalar& g){
 // multiplied by these (i.e., inner product is really over *velocities*).
 
 // Finest grid, all interior points
-double FineGridInnerProduct( const Flux& p, const Flux& q ) { 
+double FineGridInnerProduct( const Flux& p, const Flux& q ) {
     assert( p.Ngrid() == q.Ngrid() );
     assert( p.Nx() == q.Nx() );
     assert( p.Ny() == q.Ny() );
-    
+
     int nx = p.Nx();
     int ny = p.Ny();
 
     double ip = 0.;
-    
-    // X-fluxes
-    for (int j=0; j<ny; ++j) {
-        for (int i=1; i<nx; ++i){
-            ip += p(0,X,i,j) * q(0,X,i,j);
-        }
-    }
 
-    // Y-fluxes    
+    // X-fluxes: columns i in 1..nx-1 are one contiguous index range
+    Flux::index xBegin = p.getIndex(X,1,0);
+    Flux::index xEnd = p.getIndex(X,nx-1,ny-1) + 1;
+    ip += DeterministicDot( p.flatten(0) + xBegin, q.flatten(0) + xBegin,
+                            xEnd - xBegin );
+
+    // Y-fluxes: each column i is contiguous in j.  Per-column partial
+    // sums, shared among threads and accumulated in column order, so
+    // the result does not depend on the thread count
+    std::vector<double> colSum( nx );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
     for (int i=0; i<nx; ++i) {
-        for (int j=1; j<ny; ++j){
-            ip += p(0,Y,i,j) * q(0,Y,i,j);
-        }
+        colSum[i] = FluxRangeDot( p, q, 0, p.getIndex(Y,i,1),
+                                  p.getIndex(Y,i,ny) );
+    }
+    for (int i=0; i<nx; ++i) {
+        ip += colSum[i];
     }
 
     return ip;
@@ -428,6 +699,11 @@ double VorticityInnerProduct( const Scalar& omega1, const Scalar& omega2, const
     return InnerProduct( omega1, psi2 );
 }
     
+// Border points of the coarse grids for the flux-to-velocity
+// conversions; defined with the conversions below
+static void FluxToXVelocityCoarse(const Flux& q, Scalar& u, int maxlev);
+static void FluxToYVelocityCoarse(const Flux& q, Scalar& v, int maxlev);
+
 // Return cross product of a Flux q and a Scalar f, as a Flux object.
 //   q x f = ( f v, -f u )
 //
@@ -442,14 +718,15 @@ Flux CrossProduct(const Flux& q, const Scalar& f){
 
     Scalar u( f.getGrid() );
     Scalar v( f.getGrid() );
-    	
-    FluxToXVelocity( q, u );
-    u *= f;
+
+    // One fused pass over q forms both velocity components; the products
+    // are then restricted to the active region of f, skipping the
+    // all-zero far field of the coarse outer levels
+    FluxToVelocity( q, u, v );
+    u.multiplyActive( f );
     u *= -1;
-    
-    FluxToYVelocity( q, v );
-    v *= f;
-    
+    v.multiplyActive( f );
+
     Flux cross( q.getGrid() );
     VelocityToFlux( v, u, cross );      // cross = ( f v, -f u )
 
@@ -459,49 +736,96 @@ Flux CrossProduct(const Flux& q, const Scalar& f){
 // Return cross product of two Flux objects q1, q2, as a Scalar object.
 //   q1 x q2 = u1 v2 - u2 v1
 //
-// Step 1: Convert the fluxes to velocities at nodes
-// Step 2: Compute u1 * v2 - u2 * v1
+// On the finest grid each output row is formed in one pass, directly
+// from the six flux rows it touches (x-fluxes of the row, y-fluxes of
+// the rows on either side, for each operand): the velocity averaging
+// and the products are fused in the row kernel, so every flux row is
+// read while still in cache instead of being revisited by four separate
+// conversion sweeps.  The coarse levels need velocities only on their
+// border bands (coarsify rebuilds the overlapped interior from the
+// finer level), so those are filled per component and multiplied level
+// by level, with the levels shared among threads
 
 Scalar CrossProduct(const Flux& q1, const Flux& q2){
     assert( q1.Nx() == q2.Nx() );
     assert( q1.Ny() == q2.Ny() );
     assert( q1.Ngrid() == q2.Ngrid() );
-    
+
     const Grid& grid = q1.getGrid();
-    Scalar u( grid );
-    Scalar v( grid );
-    
-    FluxToXVelocity( q1, u );
-    FluxToYVelocity( q2, v );
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int ngrid = grid.Ngrid();
+    Scalar f( grid );
+
+    // Finest grid: fused row-tiled pass
+    double oneOver2Delta = 1. / ( 2 * grid.Dx() );
+    double scale = oneOver2Delta * oneOver2Delta;
+    const double* q1lev = q1.flatten(0);
+    const double* q2lev = q2.flatten(0);
+    double* flev = f.flatten(0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int i=1; i < nx; ++i) {
+        Kernels::CrossRow( flev + (i-1)*(ny-1),
+            q1lev + q1.getIndex(X,i,0),
+            q1lev + q1.getIndex(Y,i-1,1), q1lev + q1.getIndex(Y,i,1),
+            q2lev + q2.getIndex(X,i,0),
+            q2lev + q2.getIndex(Y,i-1,1), q2lev + q2.getIndex(Y,i,1),
+            scale, ny-1 );
+    }
+
+    // Coarse levels: border-band velocities, then the products
+    if ( ngrid > 1 ) {
+        Scalar u( grid );
+        Scalar v( grid );
+        int n = (nx-1) * (ny-1);
+
+        FluxToXVelocityCoarse( q1, u, ngrid );
+        FluxToYVelocityCoarse( q2, v, ngrid );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 && ngrid > 2 )
+#endif
+        for (int lev=1; lev < ngrid; ++lev) {
+            double* fl = f.flatten(lev);
+            const double* ul = u.flatten(lev);
+            const double* vl = v.flatten(lev);
+            for (int k=0; k < n; ++k) {
+                fl[k] = ul[k] * vl[k];      // f is now u1 * v2
+            }
+        }
+
+        FluxToXVelocityCoarse( q2, u, ngrid );
+        FluxToYVelocityCoarse( q1, v, ngrid );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 && ngrid > 2 )
+#endif
+        for (int lev=1; lev < ngrid; ++lev) {
+            double* fl = f.flatten(lev);
+            const double* ul = u.flatten(lev);
+            const double* vl = v.flatten(lev);
+            for (int k=0; k < n; ++k) {
+                fl[k] -= ul[k] * vl[k];     // f is now u1 * v2 - u2 * v1
+            }
+        }
+    }
 
-    Scalar f = u * v;  // f is now u1 * v2
-    
-    FluxToXVelocity( q2, u );
-    FluxToYVelocity( q1, v );
-    
-    f -= u * v;  // f is now u1 * v2 - u2 * v1
-    
     f.coarsify();   // fill in overlapping grid regions
     return f;
 };
 
-void FluxToXVelocity(const Flux& q, Scalar& u) {
-    assert( q.Nx() == u.Nx() );
-    assert( q.Ny() == u.Ny() );
-    assert( q.Ngrid() == u.Ngrid() );
+// Border points of the coarse grids for FluxToXVelocity: everything
+// except the finest grid, whose interior (A) the callers below stream
+// through the averaging kernel
+static void FluxToXVelocityCoarse(const Flux& q, Scalar& u, int maxlev) {
     int nx = q.Nx();
     int ny = q.Ny();
     int nx2 = q.NxExt();
     int ny2 = q.NyExt();
-    double oneOver2Delta = 1./ (2 * q.Dx());
-    
-    // Compute interior points (A)
-    for (int i=1; i < nx; ++i ){
-        for (int j=1; j < ny; ++j ) {
-            u(0,i,j) = ( q(0,X,i,j) + q(0,X,i,j-1) ) * oneOver2Delta;
-        }
-    }
-    
+
     // Compute border points for each coarse grid
     //
     // These points are accessed by loops below labeled B, C, D, E, F
@@ -515,8 +839,8 @@ void FluxToXVelocity(const Flux& q, Scalar& u) {
     //  3  B D 0 0 0 D B
     //  2  B F E E E F B
     //  1  B C C C C C B
-	
-    for (int lev=1; lev < q.Ngrid(); ++lev) {
+
+    for (int lev=1; lev < maxlev; ++lev) {
         double bydx = 1. / q.Dx(lev);
         // left and right borders (excluding interface) (B)
         for (int j=1; j<ny; ++j) {
@@ -576,23 +900,43 @@ void FluxToXVelocity(const Flux& q, Scalar& u) {
     }
 }
 
-void FluxToYVelocity(const Flux& q, Scalar& v) {
-    assert( q.Nx() == v.Nx() );
-    assert( q.Ny() == v.Ny() );
-    assert( q.Ngrid() == v.Ngrid() );
+void FluxToXVelocity(const Flux& q, Scalar& u) {
+    FluxToXVelocity( q, u, q.Ngrid() );
+}
+
+void FluxToXVelocity(const Flux& q, Scalar& u, int maxlev) {
+    assert( q.Nx() == u.Nx() );
+    assert( q.Ny() == u.Ny() );
+    assert( q.Ngrid() == u.Ngrid() );
+    assert( maxlev >= 1 && maxlev <= q.Ngrid() );
     int nx = q.Nx();
     int ny = q.Ny();
-    int nx2 = q.NxExt();
-    int ny2 = q.NyExt();
     double oneOver2Delta = 1./ (2 * q.Dx());
-    
-    // Compute interior points (A)
-    for (int j=1; j < ny; ++j ){
-        for (int i=1; i < nx; ++i ) {
-            v(0,i,j) = ( q(0,Y,i-1,j) + q(0,Y,i,j) ) * oneOver2Delta;
-        }
+
+    // Compute interior points (A), one contiguous row at a time
+    const double* qlev = q.flatten(0);
+    double* ulev = u.flatten(0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int i=1; i < nx; ++i ){
+        const double* qrow = qlev + q.getIndex(X,i,0);
+        Kernels::Avg( ulev + (i-1)*(ny-1), qrow, qrow + 1,
+                      oneOver2Delta, ny-1 );
     }
-    
+
+    FluxToXVelocityCoarse( q, u, maxlev );
+}
+
+// Border points of the coarse grids for FluxToYVelocity (see
+// FluxToXVelocityCoarse)
+static void FluxToYVelocityCoarse(const Flux& q, Scalar& v, int maxlev) {
+    int nx = q.Nx();
+    int ny = q.Ny();
+    int nx2 = q.NxExt();
+    int ny2 = q.NyExt();
+
     // Compute border points for each coarse grid
     //
     // These points are accessed by loops below labeled B, C, D, E, F
@@ -607,8 +951,8 @@ void FluxToYVelocity(const Flux& q, Scalar& v) {
     //  3  B D 0 0 0 D B
     //  2  B F E E E F B
     //  1  B C C C C C B
-    
-    for (int lev=1; lev < q.Ngrid(); ++lev) {
+
+    for (int lev=1; lev < maxlev; ++lev) {
         double bydx = 1. / q.Dx(lev);
         // top and bottom borders (excluding interface) (B)
         for (int i=1; i<nx; ++i) {
@@ -664,12 +1008,45 @@ void FluxToYVelocity(const Flux& q, Scalar& v) {
     }
 }
 
+void FluxToYVelocity(const Flux& q, Scalar& v) {
+    FluxToYVelocity( q, v, q.Ngrid() );
+}
+
+void FluxToYVelocity(const Flux& q, Scalar& v, int maxlev) {
+    assert( q.Nx() == v.Nx() );
+    assert( q.Ny() == v.Ny() );
+    assert( q.Ngrid() == v.Ngrid() );
+    assert( maxlev >= 1 && maxlev <= q.Ngrid() );
+    int nx = q.Nx();
+    int ny = q.Ny();
+    double oneOver2Delta = 1./ (2 * q.Dx());
+
+    // Compute interior points (A), one contiguous row at a time
+    const double* qlev = q.flatten(0);
+    double* vlev = v.flatten(0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int i=1; i < nx; ++i ){
+        Kernels::Avg( vlev + (i-1)*(ny-1), qlev + q.getIndex(Y,i-1,1),
+                      qlev + q.getIndex(Y,i,1), oneOver2Delta, ny-1 );
+    }
+
+    FluxToYVelocityCoarse( q, v, maxlev );
+}
+
 // Convert u-velocities at vertices to x-fluxes through edges.
 // Does not touch the y-component of the Flux q passed in.
 void XVelocityToFlux(const Scalar& u, Flux& q) {
+    XVelocityToFlux( u, q, u.Ngrid() );
+}
+
+void XVelocityToFlux(const Scalar& u, Flux& q, int maxlev) {
     assert( u.Nx() == q.Nx() );
     assert( u.Ny() == q.Ny() );
     assert( u.Ngrid() == q.Ngrid() );
+    assert( maxlev >= 1 && maxlev <= u.Ngrid() );
     int nx = u.Nx();
     int ny = u.Ny();
     int nx2 = u.NxExt();
@@ -697,18 +1074,21 @@ void XVelocityToFlux(const Scalar& u, Flux& q) {
     //  2  A D D G G G D D A
     //  1  A B B B B B B B A
     //  0  A C C C C C C C A
-        
-    for (int lev=0; lev < u.Ngrid(); ++lev) {
+
+    for (int lev=0; lev < maxlev; ++lev) {
         double dx = g.Dx(lev);
         // Interior points
         // If on fine grid, compute all interior points
         if (lev == 0) {
-            // compute interior points on finest grid, minus top and bottom rows (D)
+            // compute interior points on finest grid, minus top and
+            // bottom rows (D), one contiguous row at a time
+            const double* ulev = u.flatten(0);
+            double* qlev = q.flatten(0);
             for (int i=1; i<nx; ++i) {
-                for (int j=1; j<ny-1; ++j) {
-                    q(0,X,i,j) = ( u(0,i,j) + u(0,i,j+1) ) * 0.5 * dx;
-                }
-            }            
+                const double* urow = ulev + (i-1)*(ny-1);
+                Kernels::Avg( qlev + q.getIndex(X,i,1), urow, urow + 1,
+                              0.5 * dx, ny-2 );
+            }
         }
         else {  // not the finest grid
             for (int i=1; i<nx; ++i) {
@@ -729,14 +1109,16 @@ void XVelocityToFlux(const Scalar& u, Flux& q) {
                     q(lev,X,i,j) = ( u(lev,i,j) + u(lev,i,j+1) ) * 0.5 * dx;
                 }
             }
-            // get interior portion of coarse grid from fine grid (G)
+            // get interior portion of coarse grid from fine grid (G):
+            // each coarse row sums adjacent pairs of one contiguous
+            // fine row, one strided kernel pass per row
             for (int i=nx2+1; i<nx/2+nx2; ++i) {
-                for (int j=ny2; j<ny/2+ny2; ++j) {
-                    int ii,jj; // fine gridpoints
-                    g.c2f(i,j,ii,jj);
-                    q(lev,X,i,j) = q(lev-1,X,ii,jj) + q(lev-1,X,ii,jj+1);
-                }
-            }            
+                int ii,jj; // fine gridpoints
+                g.c2f(i,ny2,ii,jj);
+                const double* fine = &q(lev-1,X,ii,jj);
+                Kernels::CoarsenSum( &q(lev,X,i,ny2), fine, fine+1,
+                    ny/2 );
+            }
         }
         // Boundary points
         // left and right boundaries of coarsest grid are zero (A)
@@ -791,9 +1173,14 @@ void XVelocityToFlux(const Scalar& u, Flux& q) {
 // Convert v-velocities at vertices to y-fluxes through edges.
 // Does not touch the x-component of the Flux q passed in.
 void YVelocityToFlux(const Scalar& v, Flux& q) {
+    YVelocityToFlux( v, q, v.Ngrid() );
+}
+
+void YVelocityToFlux(const Scalar& v, Flux& q, int maxlev) {
     assert( v.Nx() == q.Nx() );
     assert( v.Ny() == q.Ny() );
     assert( v.Ngrid() == q.Ngrid() );
+    assert( maxlev >= 1 && maxlev <= v.Ngrid() );
     int nx = v.Nx();
     int ny = v.Ny();
     int nx2 = v.NxExt();
@@ -824,17 +1211,19 @@ void YVelocityToFlux(const Scalar& v, Flux& q) {
     //  1  C B D D D D B C
     //  0  A A A A A A A A
 
-    for (int lev=0; lev < g.Ngrid(); ++lev) {
+    for (int lev=0; lev < maxlev; ++lev) {
         double dx = g.Dx(lev);
         // Interior points
         // If on fine grid, compute all interior points
         if (lev == 0) {
-            // compute interior points on finest grid, minus top and bottom rows (D)
-            for (int j=1; j<ny; ++j) {
-                for (int i=1; i<nx-1; ++i) {
-                    q(0,Y,i,j) = ( v(0,i,j) + v(0,i+1,j) ) * 0.5 * dx;
-                }
-            }            
+            // compute interior points on finest grid, minus left and
+            // right columns (D), one contiguous row at a time
+            const double* vlev = v.flatten(0);
+            double* qlev = q.flatten(0);
+            for (int i=1; i<nx-1; ++i) {
+                Kernels::Avg( qlev + q.getIndex(Y,i,1), vlev + (i-1)*(ny-1),
+                              vlev + i*(ny-1), 0.5 * dx, ny-1 );
+            }
         }
         else {  // not the finest grid
             for (int j=1; j<ny; ++j) {
@@ -855,14 +1244,17 @@ void YVelocityToFlux(const Scalar& v, Flux& q) {
                     q(lev,Y,i,j) = ( v(lev,i,j) + v(lev,i+1,j) ) * 0.5 * dx;
                 }
             }
-            // get interior portion of coarse grid from fine grid (G)
-            for (int j=ny2+1; j<ny/2+ny2; ++j) {
-                for (int i=nx2; i<nx/2+nx2; ++i) {
-                    int ii,jj; // fine gridpoints
-                    g.c2f(i,j,ii,jj);
-                    q(lev,Y,i,j) = q(lev-1,Y,ii,jj) + q(lev-1,Y,ii+1,jj);
-                }
-            }            
+            // get interior portion of coarse grid from fine grid (G),
+            // row by row: each coarse row sums two contiguous fine
+            // rows at stride two, one kernel pass per row
+            for (int i=nx2; i<nx/2+nx2; ++i) {
+                int ii,jj; // fine gridpoints
+                g.c2f(i,ny2+1,ii,jj);
+                const double* rowA = &q(lev-1,Y,ii,jj);
+                const double* rowB = &q(lev-1,Y,ii+1,jj);
+                Kernels::CoarsenSum( &q(lev,Y,i,ny2+1), rowA, rowB,
+                    ny/2 - 1 );
+            }
         }
         // Boundary points
         // top and bottom boundaries of coarsest grid are zero (A)
@@ -920,10 +1312,55 @@ void VelocityToFlux(const Scalar& u, const Scalar& v, Flux& q) {
     YVelocityToFlux( v, q );
 }
 
-// Convert fluxes through edges to u- and v-velocities at vertices
+void VelocityToFlux(const Scalar& u, const Scalar& v, Flux& q, int maxlev) {
+    XVelocityToFlux( u, q, maxlev );
+    YVelocityToFlux( v, q, maxlev );
+}
+
+// Convert fluxes through edges to u- and v-velocities at vertices.
+// Fused: both components of the finest grid are formed in one pass over
+// its rows, so the x- and y-fluxes of each row are read while still in
+// cache; the coarse-grid borders are then filled per component
 void FluxToVelocity(const Flux& q, Scalar& u, Scalar& v) {
-    FluxToXVelocity( q, u );
-    FluxToYVelocity( q, v );
+    assert( q.Nx() == u.Nx() );
+    assert( q.Ny() == u.Ny() );
+    assert( q.Ngrid() == u.Ngrid() );
+    assert( q.Nx() == v.Nx() );
+    assert( q.Ny() == v.Ny() );
+    assert( q.Ngrid() == v.Ngrid() );
+    int nx = q.Nx();
+    int ny = q.Ny();
+    double oneOver2Delta = 1./ (2 * q.Dx());
+
+    const double* qlev = q.flatten(0);
+    double* ulev = u.flatten(0);
+    double* vlev = v.flatten(0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( GetKernelThreads( KERNEL_STENCIL ) ) \
+    if( GetKernelThreads( KERNEL_STENCIL ) > 1 )
+#endif
+    for (int i=1; i < nx; ++i ){
+        const double* qxrow = qlev + q.getIndex(X,i,0);
+        Kernels::Avg( ulev + (i-1)*(ny-1), qxrow, qxrow + 1,
+                      oneOver2Delta, ny-1 );
+        Kernels::Avg( vlev + (i-1)*(ny-1), qlev + q.getIndex(Y,i-1,1),
+                      qlev + q.getIndex(Y,i,1), oneOver2Delta, ny-1 );
+    }
+
+    FluxToXVelocityCoarse( q, u, q.Ngrid() );
+    FluxToYVelocityCoarse( q, v, q.Ngrid() );
+}
+
+// Variant writing into caller-provided buffers, each laid out like the
+// flat interior data of a Scalar over all levels (see Scalar::flatten):
+// output staging code can convert straight into its own storage, with
+// no intermediate Scalar allocation
+void FluxToVelocity(const Flux& q, double* u, double* v) {
+    Scalar us;
+    Scalar vs;
+    us.viewExternal( q.getGrid(), u );
+    vs.viewExternal( q.getGrid(), v );
+    FluxToVelocity( q, us, vs );
 }
 
 } // namespace ibpm
@@ -36,10 +36,17 @@ The curl is defined only at the interior nodes, and this routine returns zero at
 */
 Scalar Curl(const Flux& q);
 void Curl(const Flux& q, Scalar& omega );
-    
-/// \brief Return the curl of Scalar f, as a Flux object. 
+/// \brief As above, but computing only the finest maxlev levels and
+/// leaving the coarser levels of omega untouched (multirate advection;
+/// see IBSolver::setMultirate)
+void Curl(const Flux& q, Scalar& omega, int maxlev );
+
+/// \brief Return the curl of Scalar f, as a Flux object.
 Flux Curl(const Scalar& f);
 void Curl(const Scalar& f, Flux& q);
+/// \brief q = curl(f) + add, folding the addition (e.g. a steady base
+/// flow) into the output pass instead of a separate full-flux sweep
+void Curl(const Scalar& f, const Flux& add, Flux& q);
 
 /// \brief Return the inner product of Scalar f and Scalar g, calculated over the finest grid only.
 double FineGridInnerProduct( const Scalar& f, const Scalar& g );  
@@ -95,24 +102,40 @@ Scalar CrossProduct(const Flux& q, const Flux& p);
 
 /// \brief Convert x-fluxes through edges to velocities at vertices
 void FluxToXVelocity(const Flux& q, Scalar& u);
+void FluxToXVelocity(const Flux& q, Scalar& u, int maxlev);
 
 /// \brief Convert y-fluxes through edges to velocities at vertices
 void FluxToYVelocity(const Flux& q, Scalar& v);
+void FluxToYVelocity(const Flux& q, Scalar& v, int maxlev);
 
 /// \brief Convert u-velocities at vertices to x-fluxes through edges.
 /// Does not touch the y-component of the Flux q passed in.
+/// The maxlev forms convert only the finest maxlev levels, leaving the
+/// coarser levels untouched; the capped level's velocities still supply
+/// the interface boundary values of the level below
 void XVelocityToFlux(const Scalar& u, Flux& q);
+void XVelocityToFlux(const Scalar& u, Flux& q, int maxlev);
 
 /// \brief Convert v-velocities at vertices to y-fluxes through edges.
 /// Does not touch the x-component of the Flux q passed in.
 void YVelocityToFlux(const Scalar& v, Flux& q);
+void YVelocityToFlux(const Scalar& v, Flux& q, int maxlev);
 
 /// \brief Convert u- and v-velocities at vertices to fluxes through edges
 void VelocityToFlux(const Scalar& u, const Scalar& v, Flux& q);
+void VelocityToFlux(const Scalar& u, const Scalar& v, Flux& q, int maxlev);
 
-/// \brief Convert fluxes through edges to u- and v-velocities at vertices
+/// \brief Convert fluxes through edges to u- and v-velocities at
+/// vertices.  Both components of the finest grid are formed in a single
+/// fused pass over the flux
 void FluxToVelocity(const Flux& q, Scalar& u, Scalar& v);
 
+/// \brief As above, but writing into caller-provided buffers, each laid
+/// out like the flat interior data of a Scalar over all levels (see
+/// Scalar::flatten); avoids intermediate Scalar allocation when staging
+/// output
+void FluxToVelocity(const Flux& q, double* u, double* v);
+
 } // namespace ibpm
 
 #endif /* _VECTOROPERATIONS_H_ */
@@ -17,16 +17,120 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cmath>
 #include "ibpm.h"
 #include "Regularizer.h"
 
 using namespace ibpm;
 
+// Streaming validation of a geometry against the grid parameters:
+// point spacing vs dx, bounding box vs the domain extents, and motion
+// sanity, using only O(numPoints) storage so it can run in a tight
+// loop over thousands of generated geometry files.
+// Returns the number of problems found.
+static int validateGeometry( const Grid& grid, const Geometry& geom ) {
+    int numProblems = 0;
+    double dx = grid.Dx();
+    int nx = grid.Nx();
+    int ny = grid.Ny();
+    int outer = grid.Ngrid() - 1;
+
+    // extent of the finest and outermost domains
+    double xminFine = grid.getXEdge( 0, 0 );
+    double xmaxFine = grid.getXEdge( 0, nx );
+    double yminFine = grid.getYEdge( 0, 0 );
+    double ymaxFine = grid.getYEdge( 0, ny );
+    double xminOuter = grid.getXEdge( outer, 0 );
+    double xmaxOuter = grid.getXEdge( outer, nx );
+    double yminOuter = grid.getYEdge( outer, 0 );
+    double ymaxOuter = grid.getYEdge( outer, ny );
+
+    for (int i=0; i < geom.getNumBodies(); ++i) {
+        const RigidBody& body = geom.getBody( i );
+        BoundaryVector b = body.getPoints();
+        int n = b.getNumPoints();
+        cout << "Body " << i << ": " << n << " points" << endl;
+        if ( n == 0 ) continue;
+
+        // spacing between consecutive points, and the bounding box
+        double minSpacing = 0.;
+        double maxSpacing = 0.;
+        double xmin = b(X,0);
+        double xmax = b(X,0);
+        double ymin = b(Y,0);
+        double ymax = b(Y,0);
+        for (int j=0; j<n; ++j) {
+            if ( b(X,j) < xmin ) xmin = b(X,j);
+            if ( b(X,j) > xmax ) xmax = b(X,j);
+            if ( b(Y,j) < ymin ) ymin = b(Y,j);
+            if ( b(Y,j) > ymax ) ymax = b(Y,j);
+            if ( j > 0 ) {
+                double ds = sqrt( (b(X,j) - b(X,j-1)) * (b(X,j) - b(X,j-1))
+                                + (b(Y,j) - b(Y,j-1)) * (b(Y,j) - b(Y,j-1)) );
+                if ( j == 1 || ds < minSpacing ) minSpacing = ds;
+                if ( ds > maxSpacing ) maxSpacing = ds;
+            }
+        }
+        if ( n > 1 ) {
+            cout << "  point spacing in [" << minSpacing << ", "
+                << maxSpacing << "], grid dx = " << dx << endl;
+            if ( maxSpacing > dx ) {
+                cout << "  PROBLEM: spacing exceeds dx; "
+                    "boundary may be leaky" << endl;
+                ++numProblems;
+            }
+            if ( minSpacing < 0.2 * dx ) {
+                cout << "  PROBLEM: spacing below dx/5; "
+                    "solver may not converge" << endl;
+                ++numProblems;
+            }
+        }
+
+        cout << "  bounding box [" << xmin << ", " << xmax << "] x ["
+            << ymin << ", " << ymax << "]" << endl;
+        if ( xmin < xminOuter || xmax > xmaxOuter ||
+             ymin < yminOuter || ymax > ymaxOuter ) {
+            cout << "  PROBLEM: body extends outside the outermost domain"
+                << endl;
+            ++numProblems;
+        }
+        else if ( xmin < xminFine || xmax > xmaxFine ||
+                  ymin < yminFine || ymax > ymaxFine ) {
+            cout << "  PROBLEM: body extends outside the finest domain"
+                << endl;
+            ++numProblems;
+        }
+    }
+
+    // motion sanity: moving the bodies over a sample of times must
+    // leave every coordinate finite
+    if ( ! geom.isStationary() ) {
+        const int numSamples = 16;
+        for (int k=0; k<numSamples; ++k) {
+            geom.moveBodies( k * 0.125 );
+            BoundaryVector b = geom.getPoints();
+            for (int j=0; j<b.getNumPoints(); ++j) {
+                if ( b(X,j) != b(X,j) || b(Y,j) != b(Y,j) ) {
+                    cout << "PROBLEM: motion gives NaN coordinates "
+                        "at time " << k * 0.125 << endl;
+                    ++numProblems;
+                    break;
+                }
+            }
+        }
+        geom.moveBodies( 0. );
+    }
+
+    return numProblems;
+}
+
 int main(int argc, char* argv[]) {
     cout << "Check geometry\n";
 
     ParmParser parser( argc, argv );
     bool helpFlag = parser.getFlag( "h", "print this help message and exit" );
+    bool checkFlag = parser.getFlag( "check",
+        "validate spacing, extents, and motion against the grid, then exit" );
     int nx = parser.getInt(
         "nx", "number of gridpoints in x-direction", 200 );
     int ny = parser.getInt(
@@ -61,6 +165,7 @@ int main(int argc, char* argv[]) {
 
     // Setup geometry
     Geometry geom;
+    geom.setGridSpacing( grid.Dx() );  // for grid-aware generator commands
     cout << "Reading geometry from file " << geomFile << endl;
     if ( geom.load( geomFile ) ) {
         cout << "  " << geom.getNumPoints() << " points on the boundary" << endl;
@@ -70,6 +175,16 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if ( checkFlag ) {
+        int numProblems = validateGeometry( grid, geom );
+        if ( numProblems == 0 ) {
+            cout << "Geometry OK" << endl;
+            return 0;
+        }
+        cout << numProblems << " problem(s) found" << endl;
+        return 1;
+    }
+
     if ( outFileName == "" ) return 0;
 
     Regularizer regularizer( grid, geom );
@@ -12,12 +12,17 @@ $Author$
 $HeadURL$
 */
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <string>
+#include <stdio.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include "ibpm.h"
+#include "MultigridSolver2d.h"
+#include "Tasks.h"
 
 using namespace ibpm;
 
@@ -29,6 +34,120 @@ ModelType str2model( string modelName );
 // Return the integration scheme specified in the string integratorType
 Scheme::SchemeType str2scheme( string integratorType );
 
+// Print the projected memory footprint of a run with the given
+// parameters, before anything large has been allocated
+void printProjectedFootprint( ostream& out, int nx, int ny, int ngrid,
+    int numPoints, int numSolvers );
+
+// The sin transform in EllipticSolver2d is computed through an FFT of
+// length 2*nx, so its cost depends on the prime factorization of 2*nx:
+// a size one off from a product of small primes can be several times
+// slower.  These helpers classify and estimate, for the startup advisor
+
+// True if FFTW has fast codelets for every factor: 2, 3, 5 and 7
+// freely, and at most one factor of 11 or 13
+bool isFFTFriendly( int n );
+
+// Smallest FFT-friendly size >= n
+int nextFFTFriendlySize( int n );
+
+// Crude relative operation count for a transform of size n, for
+// reporting estimated slowdowns
+double transformCostEstimate( int n );
+
+// True if the vorticity within a few cells of the outer boundary of its
+// coarsest level exceeds tol times its global maximum, i.e. the wake is
+// approaching the edge of the computational domain (used by -growngrid)
+bool vorticityNearOuterBoundary( const Scalar& omega, double tol );
+
+// Return a hex digest of the quantities that determine the projection
+// operators, used to name entries of the content-addressed operator
+// cache (-cachedir)
+string operatorCacheKey( const Grid& grid, const Geometry& geom,
+    double Reynolds, double dt, Scheme::SchemeType schemeType,
+    bool cholSingle );
+
+// Shared work list for the ensemble driver: workers claim the next
+// unstarted member under the mutex and run it to completion
+struct EnsembleWork {
+    Grid* grid;
+    NavierStokesModel* model;
+    Scheme::SchemeType schemeType;
+    double dt;
+    int numSteps;
+    int numMembers;
+    string outdir;
+    string name;
+    string icPattern;       // printf-style, formatted with the member index
+    int next;
+    pthread_mutex_t mutex;
+};
+
+// Advance all ensemble members through the shared operators, on the
+// given number of worker threads
+void runEnsemble( EnsembleWork& work, int numWorkers );
+
+// Print per-step statistics of a benchmark run (-benchmark): mean,
+// percentiles and extremes of the measured step times
+void printBenchmarkReport( ostream& out, vector<double> stepTimes,
+    double total );
+
+// Startup tasks run on the background worker (Tasks.h), so that phases
+// of initialization with no mutual dependence overlap instead of
+// running strictly in sequence.  The single worker runs tasks in
+// submission order, which is how the dependence between them is encoded
+
+// Plan the sin transforms for the grid size, while geometry and initial
+// condition load from disk
+struct PlanWarmup {
+    int nx;
+    int ny;
+};
+
+void warmPlanCacheTask( void* p ) {
+    PlanWarmup* warmup = (PlanWarmup*) p;
+    EllipticSolver2d::warmPlanCache( warmup->nx, warmup->ny );
+}
+
+// Assemble the regularizer (model->init()), while the initial condition
+// loads from disk.  Only valid for stationary geometry, where the body
+// positions do not depend on the initial time
+void initModelTask( void* p ) {
+    NavierStokesModel* model = (NavierStokesModel*) p;
+    model->init();
+}
+
+// Burst when the lift coefficient magnitude exceeds a threshold (see
+// Logger::setTrigger); the net-force sweep over the boundary points is
+// cheap relative to a timestep
+class LiftTrigger : public OutputTrigger {
+public:
+    LiftTrigger( double threshold, double alpha ) :
+        _threshold( threshold ),
+        _alpha( alpha ) {}
+    bool test( const State& x ) {
+        double xF, yF;
+        x.computeNetForce( xF, yF );
+        double lift = -xF * sin(_alpha) + yF * cos(_alpha);
+        return fabs( 2. * lift ) > _threshold;
+    }
+private:
+    double _threshold;
+    double _alpha;
+};
+
+// Burst when the monitored peak vorticity exceeds a threshold; reads
+// the FlowMonitor accumulators, so it costs nothing beyond -monitor
+class VorticityTrigger : public OutputTrigger {
+public:
+    VorticityTrigger( double threshold ) : _threshold( threshold ) {}
+    bool test( const State& x ) {
+        return GetMonitorMaxVorticity() > _threshold;
+    }
+private:
+    double _threshold;
+};
+
 /*! \brief Main routine for IBFS code
  *  Set up a timestepper and advance the flow in time.
  */
@@ -43,11 +162,50 @@ int main(int argc, char* argv[]) {
     // Output parameters
     string name = parser.getString( "name", "run name", "ibpm" );
     string outdir = parser.getString( "outdir", "directory for saving output", "." );
+    string stageDir = parser.getString( "stagedir", "node-local staging directory for checkpoint/snapshot files: a background migrator drains them to -outdir, so the writer only waits on the local disk (empty: write directly)", "" );
+    double stageBW = parser.getDouble( "stagebw", "bandwidth cap for migrating staged files to -outdir, in MB/s (0: unlimited)", 0. );
     int iTecplot = parser.getInt( "tecplot", "if >0, write a Tecplot file every n timesteps", 100);
     bool TecplotAllGrids = parser.getBool( "tecplotallgrids", "Tecplot output for all grids, or not", false );
+    bool TecplotBinary = parser.getBool( "tecplotbinary", "write Tecplot files in binary instead of ASCII", false );
+    int TecplotLevels = parser.getInt( "tecplotlevels", "if >0, write only the finest n grid levels to Tecplot files", 0 );
+    int TecplotStride = parser.getInt( "tecplotstride", "write every n-th gridpoint to Tecplot files", 1 );
+    bool asyncOutput = parser.getBool( "asyncoutput", "write output files from a background thread", false );
+    double progressInterval = parser.getDouble( "progress", "seconds between progress heartbeat lines (0: print every step)", 5. );
+    bool monitor = parser.getBool( "monitor", "accumulate per-step stability metrics (peak flux, peak vorticity, divergence residual) inside the existing field sweeps, reported on the heartbeat line", false );
+    double abortOmega = parser.getDouble( "abortomega", "with -monitor, terminate the run (saving a restart) if the peak vorticity exceeds this value (0: only on NaN)", 0. );
+    int burstSteps = parser.getInt( "burst", "if >0, switch Tecplot output into a high-rate burst of this many timesteps when a trigger fires (-burstlift or, with -monitor, -burstomega)", 0 );
+    int burstSkip = parser.getInt( "burstskip", "timesteps between Tecplot files during a burst", 1 );
+    int burstPre = parser.getInt( "burstpre", "pre-trigger states to buffer and write when a burst fires", 0 );
+    double burstLift = parser.getDouble( "burstlift", "trigger a burst when the lift coefficient magnitude exceeds this value (0: off)", 0. );
+    double burstOmega = parser.getDouble( "burstomega", "with -monitor, trigger a burst when the peak vorticity exceeds this value (0: off)", 0. );
+    bool staggerOut = parser.getBool( "staggerout", "offset the schedules of heavy outputs (tecplot, restart, series) so they do not all fire on the same step", false );
     int iRestart = parser.getInt( "restart", "if >0, write a restart file every n timesteps", 100);
+    double restartOverhead = parser.getDouble( "restartoverhead", "if >0, adapt the restart interval so checkpoint writes cost about this percent of wall time (between -restart and -restartmaxskip steps apart)", 0. );
+    int restartMaxSkip = parser.getInt( "restartmaxskip", "ceiling on the adaptive restart interval, in timesteps", 10000 );
+    int keepRestarts = parser.getInt( "keeprestarts", "if >0, keep only the newest n restart files, pruning the rest as the run proceeds (see -keepevery)", 0 );
+    int keepEvery = parser.getInt( "keepevery", "with -keeprestarts, additionally keep every n-th restart file permanently", 0 );
+    int iSeries = parser.getInt( "series", "if >0, append the state to a single time-series file every n timesteps", 0);
+    bool compressRestart = parser.getBool( "compressrestart", "write zlib-compressed restart files", false );
+    int restartLevels = parser.getInt( "restartlevels", "if >0, save only the finest n grid levels in restart files (not for full-fidelity checkpoints)", 0 );
+    int deltaRestart = parser.getInt( "deltarestart", "if >1, write every n-th restart file in full and those between as deltas from it", 0 );
+    bool quantRestart = parser.getBool( "quantrestart", "store delta restart differences as quantized 16-bit integers", false );
+    bool quantSnapshots = parser.getBool( "quantsnapshots", "store restart/snapshot files as 16-bit quantized vorticity with a per-tile scale and offset (~4x smaller than single precision; for movie frames, not full-fidelity checkpoints)", false );
+    bool compactRestart = parser.getBool( "compactrestart", "save only the finest-level fields in restart files; the coarse vorticity is rebuilt on load", false );
+    bool historyRestart = parser.getBool( "history", "write an integration-history file (multistep terms and iterative-solver state) alongside each restart file, for bit-exact resume; loaded from <ic>_hist when restarting", false );
+    bool uncachedWrites = parser.getBool( "uncachedwrites", "flush checkpoint files to disk as they are written and drop them from the page cache, avoiding writeback stalls (pair with -asyncoutput)", false );
+    bool seriesFloat = parser.getBool( "seriesfloat", "write time-series snapshots in single precision", false );
+    double seriesSparse = parser.getDouble( "seriessparse", "if >0, store time-series vorticity sparsely, dropping tiles with peak magnitude at or below this threshold; the flux is omitted", 0. );
     int iForce = parser.getInt( "force", "if >0, write forces every n timesteps", 1);
     int iEnergy = parser.getInt( "energy", "if >0, write energy every n timesteps", 0);
+    int iDiagnostics = parser.getInt( "diagnostics", "if >0, write energy, enstrophy, circulation, and peak vorticity every n timesteps", 0);
+    int iStats = parser.getInt( "stats", "if >0, fold the flow and force into running statistics (mean, variance, Reynolds stresses) every n timesteps, written once at the end", 0);
+    int iForceStats = parser.getInt( "forcestats", "if >0, analyze the force signal online every n timesteps (streaming mean/RMS, dominant Strouhal number, stationarity detection), one line per block in <name>.fstat", 0);
+    int fstatBlock = parser.getInt( "fstatblock", "force samples per analysis block for -forcestats", 2048);
+    double fstatTol = parser.getDouble( "fstattol", "relative tolerance of the -forcestats stationarity detector", 0.01);
+    bool stopConverged = parser.getBool( "stopconverged", "terminate the run once -forcestats reports converged statistics", false);
+    int iSnapshots = parser.getInt( "snapshots", "if >0, append the vorticity to an in-memory float32 snapshot matrix every n timesteps, written once at the end (for POD/DMD)", 0);
+    int snapStride = parser.getInt( "snapstride", "keep every n-th gridpoint per direction in snapshot columns", 1);
+    int snapSvd = parser.getInt( "snapsvd", "if >0, also maintain a POD basis of this rank incrementally as snapshots arrive", 0);
     string numDigitInFileName = parser.getString( "numdigfilename", "number of digits for time representation in filename", "%05d");
     
     // Grid parameters
@@ -59,6 +217,8 @@ int main(int argc, char* argv[]) {
     double yOffset = parser.getDouble( "yoffset", "y-coordinate of bottom edge of finest domain", -2. );
     double xShift = parser.getDouble( "xshift", "percentage offset between grid levels in x-direction", 0. );
     double yShift = parser.getDouble( "yshift", "percentage offset between grid levels in y-direction", 0. );
+    int growNgrid = parser.getInt( "growngrid", "if > ngrid, start with ngrid levels and append coarser outer levels up to this many as vorticity nears the outer boundary (nonlinear model, stationary geometry)", 0 );
+    double growTol = parser.getDouble( "growtol", "fraction of the peak vorticity reaching the outer boundary that triggers appending a level", 1e-4 );
     double alpha = parser.getDouble( "alpha", "angle of attack of base flow", 0.);    
 
     // Simulation parameters
@@ -66,15 +226,70 @@ int main(int argc, char* argv[]) {
     bool ubf = parser.getBool( "ubf", "Use unsteady base flow, or not", false );
     double Reynolds = parser.getDouble("Re", "Reynolds number", 100.);
     string modelName = parser.getString( "model", "type of model (linear, nonlinear, adjoint, linearperiodic, sfd)", "nonlinear" );
+    bool cholUpdate = parser.getBool( "cholupdate", "for moving geometry, correct a reference Cholesky factor instead of iterating CG (small-amplitude motions)", false );
+    bool cholSingle = parser.getBool( "cholsingle", "store Cholesky factors in single precision, with double-precision refinement in each solve", false );
+    bool pcg = parser.getBool( "pcg", "for moving geometry, precondition CG with a reference-configuration Cholesky factor", false );
+    bool cgSchedule = parser.getBool( "cgschedule", "schedule the tolerance of iterative projection solves: looser during the initial transient and for fractional substeps, tighter after statistical convergence", false );
+    int cgTransientSteps = parser.getInt( "cgtransientsteps", "steps over which the scheduled tolerance tightens to its base value", 100 );
+    double cgTransientFactor = parser.getDouble( "cgtransientfactor", "initial loosening factor for the scheduled tolerance", 100. );
+    double cgTightenFactor = parser.getDouble( "cgtightenfactor", "tightening factor applied once statistically converged", 0.1 );
+    double cgConvergeTol = parser.getDouble( "cgconvergetol", "relative step-to-step force change regarded as statistically converged", 1e-5 );
+    double phaseCachePeriod = parser.getDouble( "phasecache", "for strictly periodic prescribed motions, cache projection factorizations per phase of the given period and reuse them after the first cycle (0: off)", 0. );
     string baseFlow = parser.getString( "baseflow", "base flow for linear/adjoint model", "" );
     
     // Initial condition
     string icFile = parser.getString( "ic", "initial condition filename", "");
+    string analyticIC = parser.getString( "analyticic", "analytic initial condition when no -ic file is given: 'oseen' places an Oseen vortex at the origin (peak velocity 1 at radius 1)", "");
     bool resetTime = parser.getBool( "resettime", "Reset time when subtracting ic by baseflow (1/0(true/false))", false);
     bool subtractBaseflow = parser.getBool( "subbaseflow", "Subtract ic by baseflow (1/0(true/false))", false);
     
+    // Number of threads for threaded field kernels (needs OpenMP support)
+    int numThreads = parser.getInt( "nthreads", "number of threads for field kernels (if compiled with OpenMP)", 1 );
+    bool pinThreads = parser.getBool( "pinthreads", "bind each kernel thread to one core, for NUMA locality (needs OpenMP support)", false );
+    bool calibrateThreads = parser.getBool( "calibratethreads", "time the threaded kernels on this grid at startup and fix per-kernel thread counts, cached in -outdir", false );
+    bool timing = parser.getBool( "timing", "print a per-stage timing summary at exit", false );
+    string timingFile = parser.getString( "timingcsv", "if not empty, write per-step stage timings to this CSV file (implies -timing)", "" );
+    string traceRange = parser.getString( "trace", "record a chrome://tracing timeline of timesteps N:M to <name>.trace.json (implies -timing)", "" );
+    string hugePagesFor = parser.getString( "hugepages", "comma-separated owners to back with 2MB huge pages: fields,state,boundary,cholesky,fft,other,all (empty: none)", "" );
+    string pinnedFor = parser.getString( "pinned", "comma-separated owners to back with pinned (mlocked) pages, as for -hugepages", "" );
+    bool memcheck = parser.getFlag( "memcheck", "print the projected memory footprint for these parameters and exit without allocating" );
+    string sweepRe = parser.getString( "sweep", "comma-separated Reynolds numbers: run the cases in sequence in one process, warm-starting each from the previous final state (nonlinear model, stationary geometry)", "" );
+    int numEnsemble = parser.getInt( "ensemble", "if >1, advance an ensemble of n states through the same initialized operators (nonlinear model, stationary geometry)", 1 );
+    string ensembleIC = parser.getString( "ensembleic", "printf-style pattern for per-member initial condition files, e.g. 'ic%03d.bin' (empty: zero initial conditions)", "" );
+    int ensembleWorkers = parser.getInt( "ensembleworkers", "number of worker threads advancing ensemble members", 4 );
+    string wisdomFile = parser.getString( "wisdom", "file for caching FFTW planning data across runs (empty to disable)", "ibpm.wisdom" );
+    string cacheDir = parser.getString( "cachedir", "directory for a content-addressed operator cache: Cholesky factors and FFTW wisdom are stored and found under a hash of the problem (grid, geometry, Re, dt, scheme), so sweep runs sharing a problem skip initialization (empty to disable)", "" );
+    bool multigrid = parser.getBool( "multigrid", "use warm-started geometric multigrid for the elliptic solves instead of the direct sin-transform solver", false );
+    double mgTol = parser.getDouble( "mgtol", "residual tolerance for the multigrid elliptic solves", 1e-9 );
+    bool floatSolve = parser.getBool( "floatsolve", "use single-precision transforms in the elliptic solves (for exploratory runs)", false );
+    bool floatCorrect = parser.getBool( "floatcorrect", "apply one double-precision defect-correction pass per single-precision elliptic solve", true );
+    bool fastGrid = parser.getBool( "fastgrid", "round nx and ny up to the nearest FFT-friendly size, extending the domain to keep dx", false );
+    bool benchmark = parser.getBool( "benchmark", "zero-I/O benchmark mode: construct no output machinery, run -warmup untimed steps, then time -nsteps steps and print per-step statistics with a per-stage breakdown", false );
+    int warmupSteps = parser.getInt( "warmup", "number of untimed warmup steps before benchmark measurement", 5 );
+
     // Integration parameters
     double dt = parser.getDouble( "dt", "timestep", 0.02 );
+    double cfl = parser.getDouble( "cfl", "adapt the timestep to this CFL number, halving dt as needed (0: fixed dt)", 0. );
+    bool autoSolver = parser.getBool( "autosolver", "pick the projection solver from a cost model: start on conjugate gradient and factorize in the background only if it pays off over -nsteps (stationary geometry)", false );
+    int errInterval = parser.getInt( "errestimate", "if >0, estimate the local timestepping error every n steps by step doubling (costs two extra steps per estimate)", 0 );
+    double errTol = parser.getDouble( "errtol", "with -errestimate, halve dt while the relative error estimate exceeds this, relaxing it back when the estimate allows (0: estimate only)", 0. );
+    int multirate = parser.getInt( "multirate", "if >1, refresh the advection term of coarse level k every min(2^k, n) steps instead of every step (multirate subcycling of the outer levels)", 0 );
+    bool newton = parser.getBool( "newton", "solve directly for a steady state by Newton-Krylov iteration instead of time-marching", false );
+    int newtonIters = parser.getInt( "newtoniters", "maximum number of Newton iterations for steady-state mode", 50 );
+    double newtonTol = parser.getDouble( "newtontol", "residual tolerance for steady-state mode", 1e-10 );
+    int pararealSlices = parser.getInt( "parareal", "if >1, run time-parallel: split the run into n slices advanced concurrently by parareal iteration (stationary geometry only)", 0 );
+    int pararealCoarsen = parser.getInt( "pararealcoarsen", "timestep ratio of the parareal coarse propagator", 8 );
+    int pararealIters = parser.getInt( "pararealiters", "maximum parareal sweeps (0: number of slices)", 0 );
+    double pararealTol = parser.getDouble( "pararealtol", "relative slice-boundary correction below which a parareal window is converged", 1e-6 );
+    string resolventFreqs = parser.getString( "resolvent", "comma-separated angular frequencies: compute resolvent modes at each by randomized SVD over forward/adjoint linearized runs (linear model)", "" );
+    int resolventModes = parser.getInt( "resolventmodes", "number of resolvent modes to compute per frequency", 3 );
+    int resolventTransient = parser.getInt( "resolventtransient", "forcing periods integrated before each Fourier projection", 5 );
+    int globalModes = parser.getInt( "globalmodes", "if >0, compute this many leading global stability modes by in-process Arnoldi iteration on the linearized propagator (linear model)", 0 );
+    int arnoldiDim = parser.getInt( "arnoldidim", "Krylov subspace dimension for the global-mode Arnoldi iteration", 60 );
+    int arnoldiSteps = parser.getInt( "arnoldisteps", "timesteps of the linearized solver per Arnoldi matrix-vector product", 10 );
+    int arnoldiRestarts = parser.getInt( "arnoldirestarts", "maximum explicit restarts of the Arnoldi iteration", 5 );
+    double arnoldiTol = parser.getDouble( "arnolditol", "relative residual below which a global mode counts as converged", 1e-6 );
+    bool arnoldiSingle = parser.getBool( "arnoldisingle", "store the Arnoldi basis in single precision, halving its memory", false );
     int numSteps = parser.getInt( "nsteps", "number of timesteps to compute", 250 );
     string integratorType = parser.getString( "scheme", "timestepping scheme (euler,ab2,rk3,rk3b)", "rk3" );
     
@@ -86,6 +301,7 @@ int main(int argc, char* argv[]) {
     // SFD
     double chi = parser.getDouble( "chi", "sfd gain", 0.02 );
     double Delta = parser.getDouble( "Delta", "sfd cutoff frequency", 15. );
+    int sfdAutoTune = parser.getInt( "sfdautotune", "if >0, retune chi and Delta every this many steps from the filtered-unfiltered residual history (0: fixed parameters)", 0 );
 
     
     ModelType modelType = str2model( modelName );
@@ -124,6 +340,20 @@ int main(int argc, char* argv[]) {
     AddSlashToPath( outdir );
     mkdir( outdir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO );
 
+    // Tiered output staging: heavy one-shot files (restarts, Tecplot
+    // snapshots) land in the node-local staging directory and a
+    // background migrator drains them to outdir; the continuously
+    // appended histories stay on outdir
+    string heavyDir = outdir;
+    if ( stageDir != "" ) {
+        AddSlashToPath( stageDir );
+        if ( FileStager::start( stageDir, outdir, stageBW ) ) {
+            heavyDir = stageDir;
+            cout << "Staging checkpoint/snapshot files in " << stageDir
+                << ( stageBW > 0. ? ", migration capped" : "" ) << endl;
+        }
+    }
+
     // output command line arguments
     string cmd = parser.getParameters();
     cout << "Command:" << endl << cmd << "\n" << endl;
@@ -132,6 +362,123 @@ int main(int argc, char* argv[]) {
     // Name of this run
     cout << "Run name: " << name << "\n" << endl;
 
+    // Set the number of threads for threaded field kernels
+    SetNumThreads( numThreads );
+    if ( pinThreads ) {
+        PinThreads();
+        if ( ! ThreadsPinned() ) {
+            cout << "Warning: -pinthreads has no effect "
+                "(needs OpenMP support on Linux)" << endl;
+        }
+    }
+
+    // Memory backing must be chosen before the first field or factor
+    // is allocated
+    if ( hugePagesFor != ""
+         && ! Memory::setBackingByName( hugePagesFor, false ) ) {
+        cout << "ERROR: unrecognized owner in -hugepages \""
+            << hugePagesFor << "\"" << endl;
+        exit(1);
+    }
+    if ( pinnedFor != ""
+         && ! Memory::setBackingByName( pinnedFor, true ) ) {
+        cout << "ERROR: unrecognized owner in -pinned \""
+            << pinnedFor << "\"" << endl;
+        exit(1);
+    }
+
+    if ( uncachedWrites ) State::setUncachedWrites( true );
+
+    // Stability monitoring, accumulated inside the existing sweeps
+    // (see FlowMonitor.h)
+    if ( monitor ) SetFlowMonitor( true );
+
+    // Per-stage timing of the timestep loop
+    if ( timing ) Timers::setEnabled( true );
+    if ( timingFile != "" ) {
+        if ( ! Timers::setStepFile( outdir + timingFile ) ) {
+            cout << "Warning: cannot open timing file "
+                << outdir + timingFile << endl;
+        }
+    }
+    if ( traceRange != "" ) {
+        int traceFirst, traceLast;
+        if ( sscanf( traceRange.c_str(), "%d:%d",
+                     &traceFirst, &traceLast ) == 2 ) {
+            Timers::setTrace( outdir + name + ".trace.json",
+                traceFirst, traceLast );
+        }
+        else {
+            cout << "Warning: trace range \"" << traceRange
+                << "\" is not of the form N:M; ignoring" << endl;
+        }
+    }
+
+    // Content-addressed operator cache: factors and wisdom are stored
+    // under a hash of the problem, so every run of a sweep after the
+    // first finds them without a manually-managed filename
+    if ( cacheDir != "" ) {
+        AddSlashToPath( cacheDir );
+        mkdir( cacheDir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO );
+        if ( wisdomFile == "ibpm.wisdom" ) {
+            // -wisdom was left at its default: keep the wisdom with the
+            // cache, where the whole sweep shares it
+            wisdomFile = cacheDir + "fftw.wisdom";
+        }
+    }
+
+    // Cache FFTW planning data across runs, so repeated runs on the same
+    // grid skip the planning step
+    EllipticSolver2d::setWisdomFile( wisdomFile );
+
+    // Select the elliptic solver backend before any solvers are created
+    if ( multigrid ) {
+        cout << "Using multigrid elliptic solves, tolerance " << mgTol << endl;
+        Multigrid2d::setDefaultTolerance( mgTol );
+        EllipticSolver::setUseMultigrid( true );
+    }
+    if ( floatSolve ) {
+        cout << "Using single-precision elliptic solves"
+            << ( floatCorrect ? " with defect correction" : "" ) << endl;
+        EllipticSolver2d::setDefectCorrection( floatCorrect );
+        EllipticSolver2d::setSinglePrecision( true );
+    }
+
+    // Advise on FFT-unfriendly grid sizes before anything is allocated:
+    // an accidental -nx 500 costs several times more per transform than
+    // -nx 512, and has repeatedly gone unnoticed for whole runs.  The
+    // multigrid backend has no such sensitivity, so it skips the check
+    if ( ! multigrid ) {
+        int* dims[2] = { &nx, &ny };
+        const char* dimNames[2] = { "nx", "ny" };
+        for ( int d = 0; d < 2; d++ ) {
+            int n = *dims[d];
+            if ( isFFTFriendly( n ) ) continue;
+            int nFast = nextFFTFriendlySize( n );
+            double slowdown = transformCostEstimate( n )
+                / transformCostEstimate( nFast );
+            if ( fastGrid ) {
+                if ( d == 0 ) {
+                    // dx = length / nx: extend the domain to keep dx
+                    length = length * nFast / n;
+                }
+                cout << "Adjusting " << dimNames[d] << " from " << n
+                    << " to the FFT-friendly size " << nFast
+                    << ( d == 0 ? " (domain length extended to keep dx)"
+                                : "" ) << endl;
+                *dims[d] = nFast;
+            }
+            else {
+                cout << "Warning: " << dimNames[d] << " = " << n
+                    << " is an FFT-unfriendly size: the sin transform is"
+                    << " an estimated " << std::setprecision(2) << slowdown
+                    << std::setprecision(6) << "x slower than at "
+                    << dimNames[d] << " = " << nFast
+                    << " (use -fastgrid to adjust automatically)" << endl;
+            }
+        }
+    }
+
     // Setup grid
     cout << "Grid parameters:" << endl
         << "    nx      " << nx << endl
@@ -145,8 +492,25 @@ int main(int argc, char* argv[]) {
         << endl;
     Grid grid( nx, ny, ngrid, length, xOffset, yOffset, xShift, yShift );
 
+    // Calibrate before any solver is set up, so the transform plans are
+    // created with the calibrated FFT thread count
+    if ( calibrateThreads ) {
+        CalibrateThreads( grid, outdir );
+    }
+
+    // FFTW planning needs only the grid dimensions, so start it on the
+    // background worker now and let it overlap the disk-bound phases
+    // below (geometry, base flow, initial condition)
+    PlanWarmup planWarmup;
+    if ( ! multigrid ) {
+        planWarmup.nx = nx;
+        planWarmup.ny = ny;
+        SubmitTask( warmPlanCacheTask, &planWarmup );
+    }
+
     // Setup geometry
     Geometry geom;
+    geom.setGridSpacing( grid.Dx() );  // for grid-aware generator commands
     cout << "Reading geometry from file " << geomFile << endl;
     if ( geom.load( geomFile ) ) {
         cout << "    " << geom.getNumPoints() << " points on the boundary" << "\n" << endl;
@@ -154,7 +518,17 @@ int main(int argc, char* argv[]) {
     else {
         exit(-1);
     }
-    
+
+    // Project the memory footprint for these parameters before any of
+    // the large allocations, so jobs that would exceed a node's memory
+    // are caught up front rather than at job death
+    if ( memcheck ) {
+        Scheme scheme( schemeType );
+        printProjectedFootprint( cout, nx, ny, ngrid, geom.getNumPoints(),
+            scheme.nsteps() );
+        return 0;
+    }
+
     // Setup equations to solve
     cout << "Reynolds number = " << Reynolds << "\n" << endl;
     cout << "Setting up Immersed Boundary Solver..." << flush;
@@ -224,6 +598,9 @@ int main(int argc, char* argv[]) {
             cout << "    Delta = " << Delta << endl << endl;
             model =  new NavierStokesModel( grid, geom, Reynolds, q_potential );
             SFDsolver = new SFDSolver( grid, *model, dt, schemeType, Delta, chi ) ;
+            if ( sfdAutoTune > 0 ) {
+                SFDsolver->setAutoTune( sfdAutoTune );
+            }
             solver = SFDsolver;
             break;
             }
@@ -240,7 +617,19 @@ int main(int argc, char* argv[]) {
         assert( SFDsolver != NULL );
     }
     // NOTE: still need to initialize model, but wait until after loading the initial
-    //       condition, so we know what the initial time is, for moving the bodies
+    //       condition, so we know what the initial time is, for moving the bodies.
+    //       For stationary geometry the body positions do not depend on the
+    //       initial time, so the regularizer assembly can start on the
+    //       background worker now and overlap the load
+    bool modelInitSubmitted = false;
+    if ( geom.isStationary() ) {
+        // Apply any fixed-position transformations now (the time passed
+        // is irrelevant for stationary bodies), so the regularizer sees
+        // the bodies in place; the moveBodies call below is then a no-op
+        geom.moveBodies( 0. );
+        SubmitTask( initModelTask, model );
+        modelInitSubmitted = true;
+    }
 
     // Load initial condition
     State x( grid, geom.getNumPoints() );
@@ -270,12 +659,33 @@ int main(int argc, char* argv[]) {
         if ( modelType == SFD ) {
             SFDsolver->loadFilteredState( icFile );
         }
-         
+
+        if ( historyRestart ) {
+            string histFile = icFile + "_hist";
+            if ( solver->loadHistory( histFile ) ) {
+                cout << "Loaded integration history from file: " << histFile << endl;
+            }
+            else {
+                cout << "No integration history at " << histFile
+                     << ": restarting the multistep scheme" << endl;
+            }
+        }
+
+    }
+    else if ( analyticIC == "oseen" ) {
+        cout << "Using analytic initial condition: Oseen vortex" << endl;
+        SetAnalyticFlow(
+            OseenVortex( Reynolds, OseenVortex::initialTime( Reynolds ) ),
+            x );
+    }
+    else if ( analyticIC != "" ) {
+        cout << "Unknown analytic initial condition: " << analyticIC << endl;
+        exit(1);
     }
     else {
         cout << "Using zero initial condition" << endl;
     }
-    
+
     if (resetTime == true) {
         x.timestep = 0;
         x.time = 0.;
@@ -285,15 +695,148 @@ int main(int argc, char* argv[]) {
     geom.moveBodies( x.time );
     
     // Initialize model and timestepper
-    model->init();
+    if ( cholUpdate ) {
+        solver->setUpdatedCholesky( true );
+    }
+    if ( cholSingle ) {
+        solver->setSinglePrecisionCholesky( true );
+    }
+    if ( pcg ) {
+        solver->setPreconditionedCG( true );
+    }
+    if ( cgSchedule ) {
+        solver->setToleranceSchedule( cgTransientFactor, cgTransientSteps,
+            cgTightenFactor, cgConvergeTol );
+    }
+    if ( cfl > 0. ) {
+        solver->setAdaptiveTimestep( cfl );
+    }
+    if ( errInterval > 0 ) {
+        solver->setErrorEstimate( errInterval, errTol );
+    }
+    if ( autoSolver ) {
+        solver->setAutoSolver( numSteps );
+    }
+    if ( multirate > 1 ) {
+        solver->setMultirate( multirate );
+    }
+    if ( phaseCachePeriod > 0. ) {
+        solver->setPhaseCache( phaseCachePeriod );
+    }
+    if ( modelInitSubmitted ) {
+        WaitForTasks();
+    }
+    model->init();   // no-op if already initialized on the worker
     cout << "using " << solver->getName() << " timestepper" << endl;
     cout << "    dt = " << dt << "\n" << endl;
-    if ( ! solver->load( outdir + name ) ) {
+
+    // Dynamic outer-level growth (see the check in the main loop below):
+    // the run starts on -ngrid levels and appends coarser outer levels,
+    // up to -growngrid, as the wake approaches the outer boundary
+    if ( growNgrid > ngrid ) {
+        if ( modelType != NONLINEAR || ! geom.isStationary()
+            || ! q_potential.isStationary() ) {
+            cout << "ERROR: -growngrid requires the nonlinear model, "
+                "stationary geometry, and a steady base flow" << endl;
+            exit(1);
+        }
+        cout << "Starting with " << ngrid << " grid levels; growing up to "
+            << growNgrid << " as the wake approaches the outer boundary"
+            << "\n" << endl;
+    }
+
+    // Parameter-continuation sweep: run the listed Reynolds numbers in
+    // sequence within this process, warm-starting each case from the
+    // previous case's final state.  The geometry, regularizer, Poisson
+    // solver, and FFTW plans above were built once and are reused; only
+    // the Re-dependent solver factors are rebuilt per case
+    if ( sweepRe != "" ) {
+        if ( modelType != NONLINEAR || ! geom.isStationary() ) {
+            cout << "ERROR: sweep mode requires the nonlinear model "
+                "and a stationary geometry" << endl;
+            exit(1);
+        }
+        vector<double> reList;
+        {
+            const char* s = sweepRe.c_str();
+            char* end;
+            while ( *s != '\0' ) {
+                double re = strtod( s, &end );
+                if ( end == s || re <= 0. ) {
+                    cout << "ERROR: bad -sweep value in '" << sweepRe
+                        << "'" << endl;
+                    exit(1);
+                }
+                reList.push_back( re );
+                s = ( *end == ',' ) ? end + 1 : end;
+            }
+        }
+        delete solver;  // rebuilt per case, with each case's Reynolds number
+        solver = NULL;
+        for ( unsigned int c=0; c < reList.size(); ++c ) {
+            double re = reList[c];
+            cout << "\nSweep case " << c+1 << "/" << reList.size()
+                << ": Reynolds number = " << re << endl;
+            model->setReynolds( re );
+            NonlinearIBSolver caseSolver( grid, *model, dt, schemeType );
+            if ( cholUpdate ) caseSolver.setUpdatedCholesky( true );
+            if ( cholSingle ) caseSolver.setSinglePrecisionCholesky( true );
+            if ( pcg ) caseSolver.setPreconditionedCG( true );
+            if ( cgSchedule ) {
+                caseSolver.setToleranceSchedule( cgTransientFactor,
+                    cgTransientSteps, cgTightenFactor, cgConvergeTol );
+            }
+            if ( cfl > 0. ) caseSolver.setAdaptiveTimestep( cfl );
+            if ( multirate > 1 ) caseSolver.setMultirate( multirate );
+            char label[64];
+            sprintf( label, "_Re%g", re );
+            string base = outdir + name + label;
+            if ( cacheDir != "" ) {
+                base = cacheDir + "op_" + operatorCacheKey( grid, geom, re,
+                    dt, schemeType, cholSingle );
+            }
+            if ( ! caseSolver.load( base ) ) {
+                caseSolver.init();
+                caseSolver.save( base );
+            }
+            // Continuation: keep the previous case's fields, but restart
+            // the case's own clock so its outputs line up
+            x.timestep = 0;
+            x.time = 0.;
+            model->refreshState( x );
+            OutputForce caseForce( outdir + name + label + ".force" );
+            caseForce.init();
+            for ( int i=1; i <= numSteps; ++i ) {
+                caseSolver.advance( x );
+                caseForce.doOutput( x );
+            }
+            caseForce.cleanup();
+            double xF, yF;
+            x.computeNetForce( xF, yF );
+            cout << "    final x force: " << setw(16) << 2.*xF
+                << ", y force: " << setw(16) << 2.*yF << endl;
+            x.save( outdir + name + label + ".bin" );
+        }
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        return 0;
+    }
+
+    string solverBase = outdir + name;
+    if ( cacheDir != "" ) {
+        // Entries are keyed by the problem, not by the run name, so any
+        // run of a sweep can reuse the factors of any earlier one
+        string key = operatorCacheKey( grid, geom, Reynolds, dt,
+            schemeType, cholSingle );
+        solverBase = cacheDir + "op_" + key;
+        cout << "operator cache key " << key << endl;
+    }
+    if ( ! solver->load( solverBase ) ) {
         // Set the tolerance for a ConjugateGradient solver below
         // Otherwise default is tol = 1e-7
         // solver->setTol( 1e-8 )
         solver->init();
-        solver->save( outdir + name );
+        solver->save( solverBase );
     }
     
     // Calculate flux for state, in case only vorticity was saved
@@ -304,24 +847,315 @@ int main(int argc, char* argv[]) {
     model->updateOperators( x.time );
     model->refreshState( x );
 
+    // Ensemble mode: the expensive initialization above ran exactly once
+    // (geometry, FFTW planning, Cholesky factorization); advance every
+    // member through the shared operators and exit
+    if ( numEnsemble > 1 ) {
+        if ( modelType != NONLINEAR || ! geom.isStationary() ) {
+            cout << "ERROR: ensemble mode requires the nonlinear model "
+                "and a stationary geometry" << endl;
+            exit(1);
+        }
+        EnsembleWork work;
+        work.grid = &grid;
+        work.model = model;
+        work.schemeType = schemeType;
+        work.dt = dt;
+        work.numSteps = numSteps;
+        work.numMembers = numEnsemble;
+        work.outdir = outdir;
+        work.name = name;
+        work.icPattern = ensembleIC;
+        work.next = 0;
+        pthread_mutex_init( &work.mutex, NULL );
+        runEnsemble( work, ensembleWorkers );
+        pthread_mutex_destroy( &work.mutex );
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        return 0;
+    }
+
+    // Newton-Krylov steady-state mode: find the equilibrium directly
+    // rather than marching out the transient, then exit
+    if ( newton ) {
+        if ( modelType != NONLINEAR || ! geom.isStationary() ) {
+            cout << "ERROR: steady-state mode requires the nonlinear model "
+                "and a stationary geometry" << endl;
+            exit(1);
+        }
+        // Zero-base-flow model, used to refresh the perturbation states
+        // inside the linearized Jacobian-vector products
+        NavierStokesModel perturbModel( grid, geom, Reynolds );
+        perturbModel.init();
+        NewtonKrylovSolver newtonSolver( grid, *model, perturbModel,
+            *solver, dt, schemeType, outdir + name );
+        bool converged = newtonSolver.solve( x, newtonIters, newtonTol );
+        double xF, yF;
+        x.computeNetForce( xF, yF );
+        double drag = xF * cos(alpha) + yF * sin(alpha);
+        double lift = xF * -1.*sin(alpha) + yF * cos(alpha);
+        cout << "    x force: " << setw(16) << drag*2 << ", y force: "
+            << setw(16) << lift*2 << endl;
+        string steadyFile = outdir + name + "_steady.bin";
+        cout << "Writing steady state to " << steadyFile << endl;
+        x.save( steadyFile );
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        return converged ? 0 : 1;
+    }
+
+    // Resolvent mode: frequency response of the linearized operator at
+    // the listed frequencies, computed from forced forward/adjoint runs
+    // in-process rather than by exporting operators or snapshots
+    if ( resolventFreqs != "" ) {
+        if ( modelType != LINEAR ) {
+            cout << "ERROR: resolvent mode requires the linear model "
+                "and a base flow" << endl;
+            exit(1);
+        }
+        // The adjoint shares the projection operators (and Cholesky
+        // factors) of the forward linearized solver
+        AdjointIBSolver adjointSolver( grid, *model, dt, schemeType, x00 );
+        if ( ! adjointSolver.load( solverBase ) ) {
+            adjointSolver.init();
+        }
+        ResolventSolver resolvent( grid, *model, *solver, adjointSolver,
+            dt, outdir + name );
+        const char* s = resolventFreqs.c_str();
+        char* end;
+        while ( *s != '\0' ) {
+            double w = strtod( s, &end );
+            if ( end == s || w == 0. ) {
+                cout << "ERROR: bad -resolvent value in '"
+                    << resolventFreqs << "'" << endl;
+                exit(1);
+            }
+            double gain;
+            resolvent.computeModes( w, resolventModes, resolventTransient,
+                gain );
+            s = ( *end == ',' ) ? end + 1 : end;
+        }
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        delete solver;
+        return 0;
+    }
+
+    // Global-mode eigensolver: leading eigenvalues and modes of the
+    // linearized propagator, by in-process Arnoldi iteration with the
+    // linearized solver itself as the matrix-vector product
+    if ( globalModes > 0 ) {
+        if ( modelType != LINEAR ) {
+            cout << "ERROR: global-mode computation requires the linear "
+                "model and a base flow" << endl;
+            exit(1);
+        }
+        if ( cfl > 0. ) {
+            cout << "ERROR: global-mode computation is incompatible with "
+                "the adaptive timestep" << endl;
+            exit(1);
+        }
+        GlobalModeSolver arnoldi( grid, *model, *solver, dt,
+            outdir + name );
+        double growthRate;
+        arnoldi.computeModes( globalModes, arnoldiDim, arnoldiSteps,
+            arnoldiRestarts, arnoldiTol, arnoldiSingle, growthRate );
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        delete solver;
+        return 0;
+    }
+
+    // Zero-I/O benchmark mode: no Output objects are constructed and no
+    // force lines are formatted, so the loop below is purely the solver.
+    // The warmup runs untimed (cold caches, lazy plan acquisition, CG
+    // warm-start convergence); then every step is measured individually
+    if ( benchmark ) {
+        cout << "Benchmark mode: " << warmupSteps << " warmup steps, "
+            << numSteps << " measured steps" << endl;
+        for ( int i = 0; i < warmupSteps; i++ ) {
+            solver->advance( x );
+        }
+        Timers::setEnabled( true );
+        vector<double> stepTimes( numSteps );
+        double start = Timers::readClock();
+        for ( int i = 0; i < numSteps; i++ ) {
+            double t0 = Timers::readClock();
+            solver->advance( x );
+            stepTimes[i] = Timers::readClock() - t0;
+        }
+        double total = Timers::readClock() - start;
+        printBenchmarkReport( cout, stepTimes, total );
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        delete solver;
+        return 0;
+    }
+
+    // Parareal time-parallel mode: split the run into slices advanced
+    // concurrently by parareal iteration, then exit.  Suited to long
+    // statistically-stationary runs, where the windowed force history
+    // and final state are what matter
+    if ( pararealSlices > 1 ) {
+        if ( modelType != NONLINEAR || ! geom.isStationary() ) {
+            cout << "ERROR: parareal mode requires the nonlinear model "
+                "and a stationary geometry" << endl;
+            exit(1);
+        }
+        if ( cfl > 0. ) {
+            cout << "ERROR: parareal mode is incompatible with the "
+                "adaptive timestep" << endl;
+            exit(1);
+        }
+        int stepsPerSlice = numSteps / pararealSlices;
+        if ( stepsPerSlice < 1 ||
+             numSteps != stepsPerSlice * pararealSlices ) {
+            cout << "ERROR: -nsteps must be a multiple of -parareal"
+                << endl;
+            exit(1);
+        }
+        if ( pararealCoarsen < 2 ) pararealCoarsen = 2;
+        if ( stepsPerSlice % pararealCoarsen != 0 ) {
+            cout << "ERROR: the coarse timestep (dt * pararealcoarsen) "
+                "must divide the slice duration" << endl;
+            exit(1);
+        }
+        // One fine solver per slice, so multistep history and warm
+        // starts stay slice-local; all reuse the operator files saved
+        // by the primary solver above
+        vector<IBSolver*> fineSolvers( pararealSlices );
+        fineSolvers[0] = solver;
+        for (int n=1; n<pararealSlices; ++n) {
+            NonlinearIBSolver* fine = new NonlinearIBSolver( grid,
+                *model, dt, schemeType );
+            if ( ! fine->load( solverBase ) ) {
+                fine->init();
+            }
+            if ( multirate > 1 ) fine->setMultirate( multirate );
+            fineSolvers[n] = fine;
+        }
+        // Coarse propagator: the same equations with a coarsened
+        // timestep, with its own operator files keyed by the ratio
+        NonlinearIBSolver coarseSolver( grid, *model,
+            dt * pararealCoarsen, schemeType );
+        char coarseSuffix[32];
+        snprintf( coarseSuffix, sizeof(coarseSuffix), "_pararealG%d",
+            pararealCoarsen );
+        if ( ! coarseSolver.load( solverBase + coarseSuffix ) ) {
+            coarseSolver.init();
+            coarseSolver.save( solverBase + coarseSuffix );
+        }
+        Parareal parareal( fineSolvers, coarseSolver, stepsPerSlice,
+            pararealIters, pararealTol );
+        Memory::printReport( cout, "after initialization" );
+        cout << "Parareal: " << pararealSlices << " slices of "
+            << stepsPerSlice << " steps, coarse timestep ratio "
+            << pararealCoarsen << endl;
+        int sweeps = parareal.advance( x );
+        cout << "Parareal: done after " << sweeps << " sweep(s)" << endl;
+        // Force history at slice resolution, and a final restart file
+        OutputForce force( outdir + name + ".force" );
+        force.init();
+        for (int n=1; n<=parareal.numSlices(); ++n) {
+            force.doOutput( parareal.sliceState( n ) );
+        }
+        force.cleanup();
+        OutputRestart restart( outdir + name + numDigitInFileName + ".bin",
+            compressRestart );
+        restart.doOutput( x );
+        Timers::printSummary( cout );
+        Memory::printReport( cout, "at exit" );
+        for (int n=1; n<pararealSlices; ++n) {
+            delete fineSolvers[n];
+        }
+        delete solver;
+        return 0;
+    }
+
+    // All the large allocations (fields, factors, FFT tables) are in
+    // place at this point: report where the memory went
+    Memory::printReport( cout, "after initialization" );
+
     cout << endl << "Initial timestep = " << x.timestep << "\n" << endl;
 
     // Setup output routines
-    OutputTecplot tecplot( outdir + name + numDigitInFileName + ".plt", "Test run, step" +  numDigitInFileName, TecplotAllGrids);
-    if(TecplotAllGrids) tecplot.setFilename( outdir + name + numDigitInFileName + "_g%01d.plt" );
-    OutputRestart restart( outdir + name + numDigitInFileName + ".bin" );
-    OutputForce force( outdir + name + ".force" ); 
-    OutputEnergy energy( outdir + name + ".energy" ); 
-    
+    OutputTecplot tecplot( heavyDir + name + numDigitInFileName + ".plt", "Test run, step" +  numDigitInFileName, TecplotAllGrids, TecplotBinary);
+    if(TecplotAllGrids) tecplot.setFilename( heavyDir + name + numDigitInFileName + "_g%01d.plt" );
+    tecplot.setMaxLevels( TecplotLevels );
+    if ( TecplotStride > 1 ) {
+        TecplotRegion region;
+        region.stride = TecplotStride;
+        tecplot.setRegion( region );
+    }
+    OutputRestart restart( heavyDir + name + numDigitInFileName + ".bin", compressRestart );
+    restart.setMaxLevels( restartLevels );
+    restart.setCompact( compactRestart );
+    restart.setQuantized( quantSnapshots );
+    if ( deltaRestart > 1 ) {
+        restart.setDeltaCheckpoints( deltaRestart, quantRestart );
+    }
+    if ( keepRestarts > 0 ) {
+        restart.setRetention( keepRestarts, keepEvery );
+    }
+    OutputSeries series( outdir + name + ".series", seriesFloat, seriesSparse );
+    OutputForce force( outdir + name + ".force", geom );
+    OutputEnergy energy( outdir + name + ".energy" );
+    OutputDiagnostics diagnostics( outdir + name + ".diag" );
+    OutputStatistics stats( outdir + name + "_stats" );
+    OutputForceStats forceStats( outdir + name + ".fstat", fstatBlock,
+        fstatTol );
+    OutputSnapshots snapshots( outdir + name + "_snap", snapStride, snapSvd );
+
     Logger logger;
+    logger.setAsynchronous( asyncOutput );
+    // Conditional high-rate Tecplot bursts (see Logger::setTrigger);
+    // with -tecplot 0 the files are written only during bursts
+    LiftTrigger liftTrigger( burstLift, alpha );
+    VorticityTrigger vorticityTrigger( burstOmega );
+    bool burstEnabled = ( burstSteps > 0 ) &&
+        ( burstLift > 0. || ( monitor && burstOmega > 0. ) );
     // Output Tecplot file every timestep
-    if ( iTecplot > 0 ) {
-        cout << "Writing Tecplot file every " << iTecplot << " step(s)" << endl;
+    if ( iTecplot > 0 || burstEnabled ) {
+        if ( iTecplot > 0 ) {
+            cout << "Writing Tecplot file every " << iTecplot << " step(s)" << endl;
+        }
         logger.addOutput( &tecplot, iTecplot );
+        if ( burstEnabled ) {
+            cout << "Conditional Tecplot bursts: every " << burstSkip
+                 << " step(s) for " << burstSteps << " step(s), "
+                 << burstPre << " pre-trigger state(s)" << endl;
+            OutputTrigger* trig = ( burstLift > 0. ) ?
+                (OutputTrigger*) &liftTrigger :
+                (OutputTrigger*) &vorticityTrigger;
+            logger.setTrigger( &tecplot, trig,
+                               burstSkip, burstSteps, burstPre );
+        }
     }
     if ( iRestart > 0 ) {
         cout << "Writing restart file every " << iRestart << " step(s)" << endl;
         logger.addOutput( &restart, iRestart );
+        if ( restartOverhead > 0. ) {
+            cout << "    adapting the interval toward " << restartOverhead
+                 << "% of wall time" << endl;
+            logger.setAdaptiveInterval( &restart, restartOverhead / 100.,
+                iRestart, restartMaxSkip );
+        }
+        if ( keepRestarts > 0 ) {
+            cout << "    keeping the newest " << keepRestarts
+                 << " restart file(s)";
+            if ( keepEvery > 0 ) {
+                cout << " plus every " << keepEvery << "-th";
+            }
+            cout << endl;
+        }
+    }
+    if ( iSeries > 0 ) {
+        cout << "Appending state to time-series file every " << iSeries << " step(s)" << endl;
+        if ( seriesSparse > 0. ) {
+            cout << "  storing vorticity sparsely (threshold "
+                << seriesSparse << ")" << endl;
+        }
+        logger.addOutput( &series, iSeries );
     }
     if ( iForce > 0 ) {
         cout << "Writing forces every " << iForce << " step(s)" << endl;
@@ -331,46 +1165,226 @@ int main(int argc, char* argv[]) {
         cout << "Writing energy every " << iForce << " step(s)" << endl;
         logger.addOutput( &energy, iEnergy );
     }
+    if ( iDiagnostics > 0 ) {
+        cout << "Writing diagnostics every " << iDiagnostics << " step(s)" << endl;
+        logger.addOutput( &diagnostics, iDiagnostics );
+    }
+    if ( iStats > 0 ) {
+        cout << "Accumulating statistics every " << iStats << " step(s)" << endl;
+        logger.addOutput( &stats, iStats );
+    }
+    if ( iForceStats > 0 ) {
+        cout << "Analyzing the force signal every " << iForceStats
+             << " step(s), in blocks of " << fstatBlock << endl;
+        logger.addOutput( &forceStats, iForceStats );
+    }
+    if ( iSnapshots > 0 ) {
+        cout << "Accumulating snapshots every " << iSnapshots << " step(s)" << endl;
+        logger.addOutput( &snapshots, iSnapshots );
+    }
+    if ( staggerOut ) {
+        // Spread field-sized writes across neighboring steps instead of
+        // stacking them on shared stride multiples (see Logger::setHeavy);
+        // marking a routine that was not added is a no-op
+        cout << "Staggering heavy output schedules" << endl;
+        logger.setHeavy( &tecplot );
+        logger.setHeavy( &restart );
+        logger.setHeavy( &series );
+    }
     cout << endl;
     logger.init();
     logger.doOutput( q_potential, x );
 
     cout << "Integrating for " << numSteps << " steps" << endl;
+    // Progress is reported on a wall-clock schedule, not per step: for
+    // dt ~ 1e-3 runs with millions of steps, per-step iostream flushes
+    // clutter the logs and measurably cost time on slow filesystems
+    double lastReport = Timers::readClock();
+    int lastReportStep = 0;
+    State xtemp;    // previous state, for the SFD convergence norm
     for(int i=1; i <= numSteps; ++i) {
-        cout << "\nstep " << i << endl; 
-        State xtemp( x ); // For SFD norm calculation
+        if ( progressInterval <= 0. ) {
+            cout << "\nstep " << i << endl;
+        }
+        Timers::setTraceStep( x.timestep + 1 );
+        if ( modelType == SFD ) {
+            xtemp = x;
+        }
         solver->advance( x );
-        double lift;
-        double drag;
-        double xF, yF; // forces in x and y direction (same as drag,lift if alpha=0)
-        x.computeNetForce( xF, yF );
-        // If there is an unsteady base flow, transform body frame normal and parallel forces into lab frame lift and drag
-        if( ! q_potential.isStationary() ) {
-            q_potential.setAlphaMag(x.time);
-            alpha = q_potential.getAlpha();
+        // Append a coarser outer level once vorticity nears the current
+        // outer boundary.  The impulsive-start transient then runs on a
+        // fraction of the final point count, paying for the outer levels
+        // only once the developed wake needs them.  The check itself is
+        // a few field sweeps, so it runs on a stride
+        if ( growNgrid > grid.Ngrid() && x.timestep % 10 == 0 &&
+             vorticityNearOuterBoundary( x.omega, growTol ) ) {
+            int newNgrid = grid.Ngrid() + 1;
+            cout << "Vorticity approaching the outer boundary: growing to "
+                << newNgrid << " grid levels at step " << x.timestep
+                << endl;
+            // Carry the state over: existing levels copy directly, the
+            // central quarter of the new coarsest level is averaged up
+            // from the level below it (coarsify), and the rest of the
+            // new level starts at zero
+            Scalar oldOmega = x.omega;
+            BoundaryVector oldF = x.f;
+            grid.resize( nx, ny, newNgrid, length, xOffset, yOffset,
+                xShift, yShift );
+            q_potential.resize( grid );
+            x.resize( grid, geom.getNumPoints() );
+            x.omega = 0.;
+            for (int lev=0; lev < newNgrid-1; ++lev) {
+                for (int ii=1; ii < nx; ++ii) {
+                    for (int jj=1; jj < ny; ++jj) {
+                        x.omega(lev,ii,jj) = oldOmega(lev,ii,jj);
+                    }
+                }
+            }
+            x.omega.coarsify();
+            x.f = oldF;
+            // Rebuild the model and solver on the grown grid.  The
+            // nonlinear solver's term history restarts, as after a
+            // restart file; the geometry and forces are untouched
+            delete solver;
+            delete model;
+            model = new NavierStokesModel( grid, geom, Reynolds,
+                q_potential );
+            model->init();
+            NonlinearIBSolver* grown = new NonlinearIBSolver( grid,
+                *model, dt, schemeType );
+            if ( cholUpdate ) grown->setUpdatedCholesky( true );
+            if ( cholSingle ) grown->setSinglePrecisionCholesky( true );
+            if ( pcg ) grown->setPreconditionedCG( true );
+            if ( cgSchedule ) {
+                grown->setToleranceSchedule( cgTransientFactor,
+                    cgTransientSteps, cgTightenFactor, cgConvergeTol );
+            }
+            if ( cfl > 0. ) grown->setAdaptiveTimestep( cfl );
+            if ( multirate > 1 ) grown->setMultirate( multirate );
+            solver = grown;
+            // The factors are specific to the level count, so each grown
+            // grid gets its own cache entry
+            char suffix[32];
+            sprintf( suffix, "_ng%d", newNgrid );
+            string base = outdir + name + suffix;
+            if ( cacheDir != "" ) {
+                base = cacheDir + "op_" + operatorCacheKey( grid, geom,
+                    Reynolds, dt, schemeType, cholSingle );
+            }
+            if ( ! solver->load( base ) ) {
+                solver->init();
+                solver->save( base );
+            }
+            model->updateOperators( x.time );
+            model->refreshState( x );
+            Memory::printReport( cout, "after grid growth" );
+        }
+        bool report = ( progressInterval <= 0. );
+        double now = lastReport;
+        if ( ! report ) {
+            now = Timers::readClock();
+            report = ( now - lastReport >= progressInterval ) ||
+                ( i == numSteps );
+        }
+        if ( report ) {
+            double xF, yF; // forces in x and y direction (same as drag,lift if alpha=0)
+            x.computeNetForce( xF, yF );
+            // If there is an unsteady base flow, transform body frame normal and parallel forces into lab frame lift and drag
+            if( ! q_potential.isStationary() ) {
+                q_potential.setAlphaMag(x.time);
+                alpha = q_potential.getAlpha();
+            }
+            double drag = xF * cos(alpha) + yF * sin(alpha);
+            double lift = xF * -1.*sin(alpha) + yF * cos(alpha);
+            if ( progressInterval <= 0. ) {
+                cout << "    x force: " << setw(16) << drag*2 << ", y force: "
+                    << setw(16) << lift*2 << "\n";
+            }
+            else {
+                // One key=value heartbeat line with throughput and a
+                // rolling ETA, parseable by a job monitor
+                double elapsed = now - lastReport;
+                double rate = ( elapsed > 0. ) ?
+                    ( i - lastReportStep ) / elapsed : 0.;
+                double eta = ( rate > 0. ) ? ( numSteps - i ) / rate : 0.;
+                cout << "progress step=" << i << "/" << numSteps
+                     << " time=" << x.time
+                     << " steps_per_sec=" << rate
+                     << " eta_sec=" << eta
+                     << " xforce=" << drag*2
+                     << " yforce=" << lift*2;
+                if ( monitor ) {
+                    cout << " maxomega=" << GetMonitorMaxVorticity()
+                         << " divres=" << GetMonitorDivergence();
+                }
+                cout << endl;
+                lastReport = now;
+                lastReportStep = i;
+            }
         }
-        drag = xF * cos(alpha) + yF * sin(alpha);
-        lift = xF * -1.*sin(alpha) + yF * cos(alpha);
-        cout << "    x force: " << setw(16) << drag*2 << ", y force: "
-            << setw(16) << lift*2 << "\n";
         logger.doOutput( q_potential, x );
+        Timers::stepDone( x.timestep );
+
+        // Divergence abort: the monitor publishes the peak vorticity
+        // of the step just completed, so a blowup (or a NaN, which the
+        // accumulators propagate) terminates on the step it happens
+        if ( monitor ) {
+            double maxOmega = GetMonitorMaxVorticity();
+            if ( maxOmega != maxOmega ||
+                 ( abortOmega > 0. && maxOmega > abortOmega ) ) {
+                cout << "Terminating at step " << x.timestep
+                     << ": peak vorticity " << maxOmega
+                     << " signals a diverging run" << endl;
+                x.save( outdir + name + "_abort.bin" );
+                break;
+            }
+        }
+
+        // Early exit once the force statistics have stopped changing
+        // (see OutputForceStats); the outputs still run their cleanup
+        if ( stopConverged && iForceStats > 0 && forceStats.converged() ) {
+            cout << "Terminating at step " << x.timestep
+                 << ": force statistics converged" << endl;
+            break;
+        }
+
+        // Integration history alongside each restart file (see
+        // IBSolver::saveHistory)
+        if ( historyRestart && iRestart > 0 && x.timestep % iRestart == 0 ) {
+            string formatString = outdir+name+numDigitInFileName+".bin"+"_hist";
+            char histName[256];
+            sprintf( histName, formatString.c_str(), x.timestep );
+            solver->saveHistory( histName );
+        }
 
         // For SFD
         if( modelType == SFD ) {
-            // Inner product of fluxes is equal to inner product of vorticity (with weighted inner product for latter)
-            Flux dq = xtemp.q-x.q;
-            double q = sqrt( InnerProduct( x.q, x.q ) );
-            double twoNorm = sqrt( InnerProduct( dq, dq ) ) / ( q * dt );
-            
             if ( (x.timestep % iRestart == 0 ) && (chi != 0.0) ) {
                 SFDsolver->saveFilteredState( outdir, name, numDigitInFileName );
             }
-            
-            cout << "    ||dx||/||x||/dt = " << setw(13) << twoNorm << endl;
+
+            if ( report ) {
+                // Inner product of fluxes is equal to inner product of vorticity (with weighted inner product for latter)
+                Flux dq = xtemp.q-x.q;
+                double q = sqrt( InnerProduct( x.q, x.q ) );
+                double twoNorm = sqrt( InnerProduct( dq, dq ) ) / ( q * dt );
+                cout << "    ||dx||/||x||/dt = " << setw(13) << twoNorm << endl;
+            }
         }
-         
+
     }
     logger.cleanup();
+    if ( FileStager::enabled() ) {
+        cout << "Flushing staged output files to " << outdir << endl;
+        if ( ! FileStager::drain() ) {
+            cout << "WARNING: some staged files could not be moved; "
+                "check " << stageDir << endl;
+        }
+    }
+
+    // Timing tables (only with -timing) and the always-on event counters
+    Timers::printSummary( cout );
+    Memory::printReport( cout, "at exit" );
 
     delete solver;
     return 0;
@@ -426,3 +1440,259 @@ Scheme::SchemeType str2scheme( string schemeName ) {
 }
 
 
+
+// Project the memory footprint of a run with the given parameters.  The
+// per-field sizes and the factor and FFT-table terms are exact; the
+// count of resident field buffers is the steady-state size of the field
+// buffer pool observed in nonlinear runs, so the total is an estimate,
+// good to tens of percent rather than exact bytes
+void printProjectedFootprint( ostream& out, int nx, int ny, int ngrid,
+    int numPoints, int numSolvers ) {
+    const double MB = 1. / (1024. * 1024.);
+    double scalarField = (double) ngrid * (nx-1) * (ny-1) * sizeof(double);
+    double fluxField = (double) ngrid *
+        ( (nx+1.) * ny + nx * (ny+1.) ) * sizeof(double);
+    double boundary = 2. * numPoints * sizeof(double);
+    // One packed Cholesky factor of the 2*numPoints square constraint
+    // matrix per substep of the scheme
+    double n = 2. * numPoints;
+    double cholesky = numSolvers * n * (n + 1.) / 2. * sizeof(double);
+    // Work buffer plus eigenvalue table for the Poisson solver and for
+    // the Helmholtz solver of each substep
+    double fft = ( numSolvers + 1. ) * 2. * (nx-1) * (ny-1) * sizeof(double);
+    double fields = 14. * scalarField + 8. * fluxField + 12. * boundary;
+    double total = fields + cholesky + fft;
+    out << "Projected memory footprint for nx=" << nx << " ny=" << ny
+        << " ngrid=" << ngrid << ", " << numPoints
+        << " boundary points, " << numSolvers << " solver(s):" << endl;
+    out << std::fixed << std::setprecision(1);
+    out << "    one Scalar field           " << setw(10)
+        << scalarField * MB << " MB" << endl;
+    out << "    one Flux field             " << setw(10)
+        << fluxField * MB << " MB" << endl;
+    out << "    resident fields (est.)     " << setw(10)
+        << fields * MB << " MB" << endl;
+    out << "    Cholesky factors           " << setw(10)
+        << cholesky * MB << " MB" << endl;
+    out << "    FFT buffers and tables     " << setw(10)
+        << fft * MB << " MB" << endl;
+    out << "    projected total            " << setw(10)
+        << total * MB << " MB" << endl;
+    out.unsetf( std::ios::fixed );
+}
+
+// Nearest-rank percentile of a sorted sample
+static double percentile( const vector<double>& sorted, double q ) {
+    int n = (int) sorted.size();
+    int k = (int) ( q * (n - 1) + 0.5 );
+    return sorted[k];
+}
+
+void printBenchmarkReport( ostream& out, vector<double> stepTimes,
+    double total ) {
+    int n = (int) stepTimes.size();
+    if ( n == 0 ) return;
+    double sum = 0.;
+    for ( int i = 0; i < n; i++ ) {
+        sum += stepTimes[i];
+    }
+    std::sort( stepTimes.begin(), stepTimes.end() );
+    const double ms = 1000.;
+    out << endl << "Benchmark report, " << n << " steps:" << endl;
+    out << std::fixed << std::setprecision(3);
+    out << "    total            " << setw(10) << total << " s" << endl;
+    out << "    steps/second     " << setw(10) << n / total << endl;
+    out << "    per-step mean    " << setw(10) << sum / n * ms
+        << " ms" << endl;
+    out << "    per-step p50     " << setw(10)
+        << percentile( stepTimes, 0.50 ) * ms << " ms" << endl;
+    out << "    per-step p99     " << setw(10)
+        << percentile( stepTimes, 0.99 ) * ms << " ms" << endl;
+    out << "    per-step min     " << setw(10)
+        << stepTimes[0] * ms << " ms" << endl;
+    out << "    per-step max     " << setw(10)
+        << stepTimes[n-1] * ms << " ms" << endl;
+    out.unsetf( std::ios::fixed );
+    out << std::setprecision(6);
+}
+
+bool isFFTFriendly( int n ) {
+    int m = 2 * n;      // length of the FFT behind the sin transform
+    while ( m % 2 == 0 ) m /= 2;
+    while ( m % 3 == 0 ) m /= 3;
+    while ( m % 5 == 0 ) m /= 5;
+    while ( m % 7 == 0 ) m /= 7;
+    return m == 1 || m == 11 || m == 13;
+}
+
+int nextFFTFriendlySize( int n ) {
+    while ( ! isFFTFriendly( n ) ) {
+        ++n;
+    }
+    return n;
+}
+
+double transformCostEstimate( int n ) {
+    // Operation-count model: m * (sum of prime factors of m).  Primes
+    // FFTW has no codelet for go through Rader's algorithm, which costs
+    // about two transforms of length p-1, so they contribute a (heavily
+    // weighted) logarithm of their size rather than the size itself
+    int m = 2 * n;
+    double factorSum = 0.;
+    int r = m;
+    for ( int p = 2; p * p <= r; p++ ) {
+        while ( r % p == 0 ) {
+            factorSum += ( p <= 13 ) ? p : 6. * log( (double) p ) / log(2.);
+            r /= p;
+        }
+    }
+    if ( r > 1 ) {
+        factorSum += ( r <= 13 ) ? r : 6. * log( (double) r ) / log(2.);
+    }
+    return m * factorSum;
+}
+
+// 64-bit FNV-1a, folded over the raw bytes of each hashed quantity
+static void hashBytes( unsigned long long& h, const void* data, int n ) {
+    const unsigned char* p = (const unsigned char*) data;
+    for ( int i = 0; i < n; i++ ) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+bool vorticityNearOuterBoundary( const Scalar& omega, double tol ) {
+    // global maximum over all levels
+    double maxAbs = 0.;
+    for (unsigned int i=0; i<omega.getSize(); ++i) {
+        double a = fabs( omega.flat(i) );
+        if ( a > maxAbs ) maxAbs = a;
+    }
+    if ( maxAbs == 0. ) return false;
+    // maximum over a ring of cells along the outer boundary of the
+    // coarsest level
+    const int margin = 4;
+    int lev = omega.Ngrid() - 1;
+    int nx = omega.Nx();
+    int ny = omega.Ny();
+    double ringMax = 0.;
+    for (int i=1; i<nx; ++i) {
+        bool edgeRow = ( i <= margin || i >= nx-margin );
+        for (int j=1; j<ny; ++j) {
+            if ( ! edgeRow && j > margin && j < ny-margin ) continue;
+            double a = fabs( omega(lev,i,j) );
+            if ( a > ringMax ) ringMax = a;
+        }
+    }
+    return ringMax > tol * maxAbs;
+}
+
+static void hashDouble( unsigned long long& h, double x ) {
+    hashBytes( h, &x, sizeof(x) );
+}
+
+static void hashInt( unsigned long long& h, int x ) {
+    hashBytes( h, &x, sizeof(x) );
+}
+
+string operatorCacheKey( const Grid& grid, const Geometry& geom,
+    double Reynolds, double dt, Scheme::SchemeType schemeType,
+    bool cholSingle ) {
+    unsigned long long h = 14695981039346656037ULL;
+    // Grid parameters
+    hashInt( h, grid.Nx() );
+    hashInt( h, grid.Ny() );
+    hashInt( h, grid.Ngrid() );
+    hashDouble( h, grid.Dx() );
+    hashDouble( h, grid.getXEdge( 0, 0 ) );
+    hashDouble( h, grid.getYEdge( 0, 0 ) );
+    hashDouble( h, grid.getXShift() );
+    hashDouble( h, grid.getYShift() );
+    // Boundary points, at their current (initial) positions
+    int numPoints = geom.getNumPoints();
+    hashInt( h, numPoints );
+    BoundaryVector points = geom.getPoints();
+    for ( int i = 0; i < numPoints; i++ ) {
+        hashDouble( h, points(X,i) );
+        hashDouble( h, points(Y,i) );
+    }
+    // Everything else the factors depend on: alpha = 1/Re and the
+    // per-substep beta values (determined by dt and the scheme), and
+    // the precision the factors are stored in
+    hashDouble( h, Reynolds );
+    hashDouble( h, dt );
+    hashInt( h, (int) schemeType );
+    hashInt( h, cholSingle ? 1 : 0 );
+    char digest[32];
+    sprintf( digest, "%016llx", h );
+    return string( digest );
+}
+
+// One ensemble worker: claim members off the shared work list and run
+// each to completion.  Every member gets its own solver, so integration
+// history (AB2 terms, conjugate gradient warm starts) never leaks
+// between members; the expensive pieces -- FFTW plans and Cholesky
+// factors -- are shared through the plan cache and the files saved by
+// the primary solver at startup.
+static void* ensembleWorker( void* arg ) {
+    EnsembleWork& work = *(EnsembleWork*) arg;
+    while ( true ) {
+        pthread_mutex_lock( &work.mutex );
+        int member = work.next++;
+        pthread_mutex_unlock( &work.mutex );
+        if ( member >= work.numMembers ) break;
+
+        char label[256];
+        snprintf( label, sizeof(label), "%s_m%03d",
+            work.name.c_str(), member );
+
+        NonlinearIBSolver solver( *work.grid, *work.model, work.dt,
+            work.schemeType );
+        if ( ! solver.load( work.outdir + work.name ) ) {
+            solver.init();
+        }
+
+        State x( *work.grid, work.model->getNumPoints() );
+        x.omega = 0.;
+        x.q = 0.;
+        x.f = 0.;
+        if ( work.icPattern != "" ) {
+            char icName[256];
+            snprintf( icName, sizeof(icName), work.icPattern.c_str(),
+                member );
+            if ( ! x.load( icName ) ) {
+                cout << "ensemble member " << member << ": could not load "
+                    << icName << ", using zero initial condition" << endl;
+            }
+        }
+        work.model->refreshState( x );
+
+        OutputForce force( work.outdir + string(label) + ".force" );
+        force.init();
+        for (int i=1; i <= work.numSteps; ++i) {
+            solver.advance( x );
+            force.doOutput( x );
+        }
+        force.cleanup();
+
+        // final snapshot, for restarts or ensemble statistics
+        OutputRestart restart( work.outdir + string(label) + "_%05d.bin" );
+        restart.doOutput( x );
+    }
+    return NULL;
+}
+
+void runEnsemble( EnsembleWork& work, int numWorkers ) {
+    if ( numWorkers > work.numMembers ) numWorkers = work.numMembers;
+    if ( numWorkers < 1 ) numWorkers = 1;
+    cout << "Advancing " << work.numMembers << " ensemble members for "
+        << work.numSteps << " steps on " << numWorkers
+        << " worker thread(s)" << endl;
+    vector<pthread_t> workers( numWorkers );
+    for (int w=0; w<numWorkers; ++w) {
+        pthread_create( &workers[w], NULL, ensembleWorker, &work );
+    }
+    for (int w=0; w<numWorkers; ++w) {
+        pthread_join( workers[w], NULL );
+    }
+}
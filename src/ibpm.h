@@ -26,6 +26,7 @@
 #include "BoundaryVector.h"
 #include "BaseFlow.h"
 #include "State.h"
+#include "AnalyticFlow.h"
 #include "StateVector.h"
 
 // operations
@@ -34,6 +35,12 @@
 
 // timesteppers
 #include "IBSolver.h"
+#include "NewtonKrylov.h"
+#include "Parareal.h"
+#include "Resolvent.h"
+#include "GlobalModes.h"
+#include "Checkpointer.h"
+#include "Simulation.h"
 
 // motion
 #include "Motion.h"
@@ -52,15 +59,28 @@
 
 // output routines
 #include "Logger.h"
+#include "DerivedFields.h"
 #include "OutputTecplot.h"
 #include "OutputRestart.h"
+#include "OutputSeries.h"
+#include "OutputSnapshots.h"
+#include "OutputStatistics.h"
+#include "OutputDiagnostics.h"
 #include "OutputEnergy.h"
 #include "OutputForce.h"
+#include "OutputForceStats.h"
 #include "OutputProbes.h"
 #include "ScalarToTecplot.h"
+#include "ForceHistory.h"
 
 // utilities
 #include "utils.h"
+#include "FlowMonitor.h"
 #include "ParmParser.h"
+#include "RandomNumber.h"
+#include "Threads.h"
+#include "Timers.h"
+#include "FileStager.h"
+#include "Memory.h"
 
 #endif /* _IBPM_H_ */
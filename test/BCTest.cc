@@ -66,29 +66,57 @@ TEST_F( BCTest, CheckAssignment ) {
 }
 
 TEST_F( BCTest, CheckCorners ) {
-    // left(0) should equal bottom(0)
+    // Each corner value is stored once per adjoining side (see the
+    // layout note in BC.h): writing through one side must not disturb
+    // the other side's copy
     _bc.left(0) = 3.;
-    EXPECT_DOUBLE_EQ( 3., _bc.bottom(0) );
     _bc.bottom(0) = 4.;
-    EXPECT_DOUBLE_EQ( 4., _bc.left(0) );
+    EXPECT_DOUBLE_EQ( 3., _bc.left(0) );
+    EXPECT_DOUBLE_EQ( 4., _bc.bottom(0) );
 
-    // top(0) should equal left(ny)
     _bc.top(0) = 6.;
-    EXPECT_DOUBLE_EQ( 6., _bc.left(_ny) );
     _bc.left(_ny) = 7.;
-    EXPECT_DOUBLE_EQ( 7., _bc.top(0) );
-    
-    // top(nx) should equal right(ny)
+    EXPECT_DOUBLE_EQ( 6., _bc.top(0) );
+    EXPECT_DOUBLE_EQ( 7., _bc.left(_ny) );
+
     _bc.right(_ny) = 8;
-    EXPECT_DOUBLE_EQ( 8., _bc.top(_nx) );
     _bc.top(_nx) = 9.;
-    EXPECT_DOUBLE_EQ( 9., _bc.right(_ny) );
+    EXPECT_DOUBLE_EQ( 8., _bc.right(_ny) );
+    EXPECT_DOUBLE_EQ( 9., _bc.top(_nx) );
 
-    // bottom(nx) should equal right(0)
     _bc.bottom(_nx) = 10.;
-    EXPECT_DOUBLE_EQ( 10., _bc.right(0) );
     _bc.right(0) = 11.;
-    EXPECT_DOUBLE_EQ( 11., _bc.bottom(_nx) );
+    EXPECT_DOUBLE_EQ( 10., _bc.bottom(_nx) );
+    EXPECT_DOUBLE_EQ( 11., _bc.right(0) );
+}
+
+TEST_F( BCTest, SideViewsAreContiguous ) {
+    for ( int j=0; j<=_ny; ++j ) {
+        _bc.left(j) = j;
+        _bc.right(j) = 10. + j;
+    }
+    for ( int i=0; i<=_nx; ++i ) {
+        _bc.bottom(i) = 20. + i;
+        _bc.top(i) = 30. + i;
+    }
+    const double* l = _bc.leftData();
+    const double* r = _bc.rightData();
+    for ( int j=0; j<=_ny; ++j ) {
+        EXPECT_DOUBLE_EQ( _bc.left(j), l[j] );
+        EXPECT_DOUBLE_EQ( _bc.right(j), r[j] );
+    }
+    const double* b = _bc.bottomData();
+    const double* t = _bc.topData();
+    for ( int i=0; i<=_nx; ++i ) {
+        EXPECT_DOUBLE_EQ( _bc.bottom(i), b[i] );
+        EXPECT_DOUBLE_EQ( _bc.top(i), t[i] );
+    }
+    // all four runs live in one backing array of Size() slots
+    EXPECT_EQ( 2 * (_nx + _ny + 2), _bc.Size() );
+    EXPECT_EQ( _bc.flatten(), l );
+    EXPECT_EQ( l + _ny + 1, r );
+    EXPECT_EQ( r + _ny + 1, b );
+    EXPECT_EQ( b + _nx + 1, t );
 }
 
 TEST_F( BCTest, BCEqualsDouble ) {
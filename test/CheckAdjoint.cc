@@ -2,10 +2,48 @@
 
 #include <iostream>
 #include "ibpm.h"
+#include "SingleWavenumber.h"
+#include "CheckTiming.h"
 
 using namespace std;
 using namespace ibpm;
 
+// ~~~ timing mode: the y flux/velocity transfers (see CheckTiming.h) ~~~
+
+struct FluxToYOp {
+    FluxToYOp( const Grid& grid ) : q(grid), v(grid) {
+        Scalar psi(grid);
+        InitializeSingleWavenumber( 1, 1, psi );
+        Curl( psi, q );
+    }
+    void run() { FluxToYVelocity( q, v ); }
+    Flux q;
+    Scalar v;
+};
+
+struct YToFluxOp {
+    YToFluxOp( const Grid& grid ) : v(grid), q(grid) {
+        InitializeSingleWavenumber( 1, 1, v );
+    }
+    void run() { YVelocityToFlux( v, q ); }
+    Scalar v;
+    Flux q;
+};
+
+int runTimingMode( int argc, char* argv[] ) {
+    vector<int> sizes = TimingSizes( argc, argv );
+    int reps = TimingReps( argc, argv );
+    for (unsigned int s=0; s<sizes.size(); ++s) {
+        int n = sizes[s];
+        Grid grid( n, n, 2, 4., -2., -2. );
+        FluxToYOp fluxToY( grid );
+        TimeKernel( "fluxtoyvel", n, reps, fluxToY );
+        YToFluxOp yToFlux( grid );
+        TimeKernel( "yveltoflux", n, reps, yToFlux );
+    }
+    return 0;
+}
+
 void printY(Flux q) {
     for (int lev=0; lev<q.Ngrid(); ++lev) {
         cout << "level " << lev << endl;
@@ -82,7 +120,10 @@ void computeScalarDependencies(int lev, int i, int j, Scalar& x) {
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    if ( TimingMode( argc, argv ) ) {
+        return runTimingMode( argc, argv );
+    }
     int nx=8;
     int ny=8;
     int ngrid=3;
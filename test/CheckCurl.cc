@@ -2,10 +2,48 @@
 
 #include <iostream>
 #include "ibpm.h"
+#include "SingleWavenumber.h"
+#include "CheckTiming.h"
 
 using namespace std;
 using namespace ibpm;
 
+// ~~~ timing mode: the two curl kernels (see CheckTiming.h) ~~~
+
+struct CurlScalarOp {
+    CurlScalarOp( const Grid& grid ) : u(grid), q(grid) {
+        InitializeSingleWavenumber( 1, 1, u );
+    }
+    void run() { Curl( u, q ); }
+    Scalar u;
+    Flux q;
+};
+
+struct CurlFluxOp {
+    CurlFluxOp( const Grid& grid ) : q(grid), omega(grid) {
+        Scalar psi(grid);
+        InitializeSingleWavenumber( 1, 1, psi );
+        Curl( psi, q );
+    }
+    void run() { Curl( q, omega ); }
+    Flux q;
+    Scalar omega;
+};
+
+int runTimingMode( int argc, char* argv[] ) {
+    vector<int> sizes = TimingSizes( argc, argv );
+    int reps = TimingReps( argc, argv );
+    for (unsigned int s=0; s<sizes.size(); ++s) {
+        int n = sizes[s];
+        Grid grid( n, n, 2, 4., -2., -2. );
+        CurlScalarOp curlScalar( grid );
+        TimeKernel( "curl_scalar", n, reps, curlScalar );
+        CurlFluxOp curlFlux( grid );
+        TimeKernel( "curl_flux", n, reps, curlFlux );
+    }
+    return 0;
+}
+
 void AdjointOfScalarCurl( const Flux& q, Scalar& f ) {
     // Loop over all Scalar fields
     for (int lev=0; lev<q.Ngrid(); ++lev) {
@@ -23,7 +61,10 @@ void AdjointOfScalarCurl( const Flux& q, Scalar& f ) {
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    if ( TimingMode( argc, argv ) ) {
+        return runTimingMode( argc, argv );
+    }
     bool printCurlScalar = true;
     bool printCurlFlux = true;
     int nx=8;
@@ -1,9 +1,47 @@
 #include <iostream>
 #include "ibpm.h"
+#include "SingleWavenumber.h"
+#include "CheckTiming.h"
 
 using namespace std;
 using namespace ibpm;
 
+// ~~~ timing mode: the x flux/velocity transfers (see CheckTiming.h) ~~~
+
+struct FluxToXOp {
+    FluxToXOp( const Grid& grid ) : q(grid), u(grid) {
+        Scalar psi(grid);
+        InitializeSingleWavenumber( 1, 1, psi );
+        Curl( psi, q );
+    }
+    void run() { FluxToXVelocity( q, u ); }
+    Flux q;
+    Scalar u;
+};
+
+struct XToFluxOp {
+    XToFluxOp( const Grid& grid ) : u(grid), q(grid) {
+        InitializeSingleWavenumber( 1, 1, u );
+    }
+    void run() { XVelocityToFlux( u, q ); }
+    Scalar u;
+    Flux q;
+};
+
+int runTimingMode( int argc, char* argv[] ) {
+    vector<int> sizes = TimingSizes( argc, argv );
+    int reps = TimingReps( argc, argv );
+    for (unsigned int s=0; s<sizes.size(); ++s) {
+        int n = sizes[s];
+        Grid grid( n, n, 2, 4., -2., -2. );
+        FluxToXOp fluxToX( grid );
+        TimeKernel( "fluxtoxvel", n, reps, fluxToX );
+        XToFluxOp xToFlux( grid );
+        TimeKernel( "xveltoflux", n, reps, xToFlux );
+    }
+    return 0;
+}
+
 void printX(Flux q) {
     for (int lev=0; lev<q.Ngrid(); ++lev) {
         cout << "level " << lev << endl;
@@ -34,7 +72,10 @@ void computeDependencies(int lev, int i, int j, Flux& q) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if ( TimingMode( argc, argv ) ) {
+        return runTimingMode( argc, argv );
+    }
     int nx=8;
     int ny=8;
     int ngrid=3;
@@ -2,12 +2,49 @@
 
 #include <iostream>
 #include "ibpm.h"
+#include "SingleWavenumber.h"
+#include "CheckTiming.h"
 
 using namespace std;
 using namespace ibpm;
 
 PoissonSolver* solver;
 
+// ~~~ timing mode: Laplacian and its inverse (see CheckTiming.h) ~~~
+
+struct LaplacianOp {
+    LaplacianOp( const Grid& grid ) : u(grid), Lu(grid) {
+        InitializeSingleWavenumber( 1, 1, u );
+    }
+    void run() { Laplacian( u, Lu ); }
+    Scalar u;
+    Scalar Lu;
+};
+
+struct PoissonOp {
+    PoissonOp( const Grid& grid ) : psolver(grid), f(grid), u(grid) {
+        InitializeSingleWavenumber( 1, 1, f );
+    }
+    void run() { psolver.solve( f, u ); }
+    PoissonSolver psolver;
+    Scalar f;
+    Scalar u;
+};
+
+int runTimingMode( int argc, char* argv[] ) {
+    vector<int> sizes = TimingSizes( argc, argv );
+    int reps = TimingReps( argc, argv );
+    for (unsigned int s=0; s<sizes.size(); ++s) {
+        int n = sizes[s];
+        Grid grid( n, n, 2, 4., -2., -2. );
+        LaplacianOp laplacian( grid );
+        TimeKernel( "laplacian", n, reps, laplacian );
+        PoissonOp poisson( grid );
+        TimeKernel( "poisson_solve", n, reps, poisson );
+    }
+    return 0;
+}
+
 bool equal( const Scalar& u, const Scalar& v ) {
     static double tol=1e-12;
     double err = 0;
@@ -147,7 +184,10 @@ bool checkLCEqualsCLC( const Grid& grid, int lev, int i, int j ) {
     return equal( CLCu, LCu );
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if ( TimingMode( argc, argv ) ) {
+        return runTimingMode( argc, argv );
+    }
     int nx=8;
     int ny=8;
     int ngrid=2;
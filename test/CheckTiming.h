@@ -0,0 +1,90 @@
+// CheckTiming.h - shared timing mode for the operator check programs
+//
+// The Check* drivers construct exactly the kernels the library keeps
+// optimizing, so they double as per-kernel timing harnesses.  Each
+// driver keeps its correctness checks as the default behavior and adds
+//
+//     ./CheckCurl -time [sizes] [reps]
+//
+// where sizes is a comma-separated list of grid sizes (default
+// "64,128,256,512") and reps fixes the repeat count per measurement;
+// without it each measurement repeats until MIN_TIME seconds have
+// elapsed, after one untimed warmup call.  Output is machine-readable
+// CSV on stdout, one row per kernel and size, in the same format as
+// benchmarking/benchmark:
+//
+//     kernel,nx,calls,mean_seconds,min_seconds
+//
+// The minimum is the most stable statistic to compare across commits;
+// the gap between mean and minimum shows the jitter of the run.
+#ifndef _CHECKTIMING_H_
+#define _CHECKTIMING_H_
+
+#include "Timers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Seconds of repetitions per measurement when no repeat count is given
+const double CHECK_TIMING_MIN_TIME = 0.2;
+
+// True if the driver was invoked in timing mode
+inline bool TimingMode( int argc, char* argv[] ) {
+    return ( argc > 1 ) && ( strcmp( argv[1], "-time" ) == 0 );
+}
+
+// Grid sizes to sweep, from the optional comma-separated argument
+inline std::vector<int> TimingSizes( int argc, char* argv[] ) {
+    std::vector<int> sizes;
+    if ( argc > 2 ) {
+        char* str = argv[2];
+        while ( *str != '\0' ) {
+            sizes.push_back( atoi( str ) );
+            while ( *str != '\0' && *str != ',' ) ++str;
+            if ( *str == ',' ) ++str;
+        }
+    }
+    else {
+        sizes.push_back( 64 );
+        sizes.push_back( 128 );
+        sizes.push_back( 256 );
+        sizes.push_back( 512 );
+    }
+    return sizes;
+}
+
+// Fixed repeat count, or 0 to calibrate from CHECK_TIMING_MIN_TIME
+inline int TimingReps( int argc, char* argv[] ) {
+    return ( argc > 3 ) ? atoi( argv[3] ) : 0;
+}
+
+// Time one kernel: op.run() executes it once.  Warm up, calibrate the
+// repeat count if none was given, and print one CSV row
+template <class Operation>
+inline void TimeKernel( const char* name, int nx, int reps, Operation& op ) {
+    op.run();   // warm up: FFTW planning, buffer pools, caches
+
+    int calls = reps;
+    if ( calls <= 0 ) {
+        double t0 = ibpm::Timers::readClock();
+        op.run();
+        double once = ibpm::Timers::readClock() - t0;
+        calls = (int) ( CHECK_TIMING_MIN_TIME /
+            ( once > 1.e-9 ? once : 1.e-9 ) ) + 1;
+    }
+
+    double total = 0.;
+    double best = 0.;
+    for (int i=0; i<calls; ++i) {
+        double start = ibpm::Timers::readClock();
+        op.run();
+        double elapsed = ibpm::Timers::readClock() - start;
+        total += elapsed;
+        if ( i == 0 || elapsed < best ) best = elapsed;
+    }
+    printf( "%s,%d,%d,%.6e,%.6e\n", name, nx, calls, total / calls, best );
+    fflush( stdout );
+}
+
+#endif /* _CHECKTIMING_H_ */
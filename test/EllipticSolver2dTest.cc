@@ -2,6 +2,7 @@
 #include "SingleWavenumber.h"
 #include "VectorOperations.h"
 #include "EllipticSolver2d.h"
+#include "MultigridSolver2d.h"
 #include "Array.h"
 #include <math.h>
 #include <iostream>
@@ -171,4 +172,162 @@ TEST_F( EllipticSolver2dTest, Helmholtz2dWithLinearBC ) {
     EXPECT_ALL_EQ( u(i,j), -_alpha * Lu(i,j) );
 }
 
+// Multigrid solvers iterate to a tolerance, so these tests use a looser
+// comparison than the (exact) transform solvers above
+const double mgTolerance = 1e-7;
+
+#define EXPECT_ALL_NEAR_MG(a,b)                     \
+    for (int i=1; i<_nx; ++i) {                     \
+        for (int j=1; j<_ny; ++j) {                 \
+            EXPECT_NEAR( (a), (b), mgTolerance );   \
+        }                                           \
+    }
+
+class MultigridSolver2dTest : public testing::Test {
+protected:
+    MultigridSolver2dTest() :
+        _nx(4),
+        _ny(8),
+        _dx(0.1),
+        _alpha(0.2),
+        _poisson(_nx, _ny, _dx ),
+        _helmholtz(_nx, _ny, _dx, _alpha)
+    {}
+
+    int _nx;
+    int _ny;
+    double _dx;
+    double _alpha;
+    MultigridPoissonSolver2d _poisson;
+    MultigridHelmholtzSolver2d _helmholtz;
+};
+
+TEST_F( MultigridSolver2dTest, Poisson2d ) {
+    Array2<double>  u( _nx-1, _ny-1, 1, 1 );
+    Array2<double>  f( _nx-1, _ny-1, 1, 1 );
+    Array2<double> Lu( _nx-1, _ny-1, 1, 1 );
+    BC bc( _nx, _ny );
+    bc = 0;
+
+    for (int kx = 0; kx < _nx; ++kx) {
+        for (int ky = 0; ky < _ny; ++ky) {
+            InitializeSingleWavenumber( kx, ky, f );
+            _poisson.solve( f, u );
+            Laplacian( u, _dx, bc, Lu );
+            EXPECT_ALL_NEAR_MG( f(i,j), Lu(i,j) );
+        }
+    }
+}
+
+TEST_F( MultigridSolver2dTest, Poisson2dConstWithBC ) {
+    Array2<double> f(_nx-1, _ny-1, 1, 1);
+    Array2<double> u(_nx-1, _ny-1, 1, 1);
+    BC bc(_nx, _ny);
+    // test f = 0, u = constant;
+    f = 0.;
+    const double val = 8.;
+    bc = val;
+    _poisson.solve( f, bc, u );
+    EXPECT_ALL_NEAR_MG( val, u(i,j) );
+}
+
+TEST_F( MultigridSolver2dTest, Helmholtz2d ) {
+    Array2<double>  u( _nx-1, _ny-1, 1, 1 );
+    Array2<double>  f( _nx-1, _ny-1, 1, 1 );
+    Array2<double> Lu( _nx-1, _ny-1, 1, 1 );
+    BC bc( _nx, _ny );
+    bc = 0;
+
+    for (int kx = 0; kx < _nx; ++kx) {
+        for (int ky = 0; ky < _ny; ++ky) {
+            InitializeSingleWavenumber( kx, ky, f );
+            _helmholtz.solve( f, u );
+            Laplacian( u, _dx, bc, Lu );
+            Lu *= _alpha;
+            Lu += u;
+            EXPECT_ALL_NEAR_MG( f(i,j), Lu(i,j) );
+        }
+    }
+}
+
+// Single-precision solves with one defect-correction pass should be
+// accurate well beyond bare float round-off
+const double floatTolerance = 1e-6;
+
+TEST( SinglePrecisionSolver2d, PoissonWithDefectCorrection ) {
+    const int nx = 4;
+    const int ny = 8;
+    const double dx = 0.1;
+    EllipticSolver2d::setSinglePrecision( true );
+    PoissonSolver2d poisson( nx, ny, dx );
+    EllipticSolver2d::setSinglePrecision( false );
+
+    Array2<double>  u( nx-1, ny-1, 1, 1 );
+    Array2<double>  f( nx-1, ny-1, 1, 1 );
+    Array2<double> Lu( nx-1, ny-1, 1, 1 );
+    BC bc( nx, ny );
+    bc = 0;
+
+    for (int kx = 0; kx < nx; ++kx) {
+        for (int ky = 0; ky < ny; ++ky) {
+            InitializeSingleWavenumber( kx, ky, f );
+            poisson.solve( f, u );
+            Laplacian( u, dx, bc, Lu );
+            for (int i=1; i<nx; ++i) {
+                for (int j=1; j<ny; ++j) {
+                    EXPECT_NEAR( f(i,j), Lu(i,j), floatTolerance );
+                }
+            }
+        }
+    }
+}
+
+TEST( SinglePrecisionSolver2d, HelmholtzWithDefectCorrection ) {
+    const int nx = 4;
+    const int ny = 8;
+    const double dx = 0.1;
+    const double alpha = 0.2;
+    EllipticSolver2d::setSinglePrecision( true );
+    HelmholtzSolver2d helmholtz( nx, ny, dx, alpha );
+    EllipticSolver2d::setSinglePrecision( false );
+
+    Array2<double>  u( nx-1, ny-1, 1, 1 );
+    Array2<double>  f( nx-1, ny-1, 1, 1 );
+    Array2<double> Lu( nx-1, ny-1, 1, 1 );
+    BC bc( nx, ny );
+    bc = 0;
+
+    for (int kx = 0; kx < nx; ++kx) {
+        for (int ky = 0; ky < ny; ++ky) {
+            InitializeSingleWavenumber( kx, ky, f );
+            helmholtz.solve( f, u );
+            Laplacian( u, dx, bc, Lu );
+            Lu *= alpha;
+            Lu += u;
+            for (int i=1; i<nx; ++i) {
+                for (int j=1; j<ny; ++j) {
+                    EXPECT_NEAR( f(i,j), Lu(i,j), floatTolerance );
+                }
+            }
+        }
+    }
+}
+
+// Repeating a solve warm-starts from the previous solution and must
+// reproduce it
+TEST_F( MultigridSolver2dTest, WarmStartIsConsistent ) {
+    Array2<double>  u( _nx-1, _ny-1, 1, 1 );
+    Array2<double> u2( _nx-1, _ny-1, 1, 1 );
+    Array2<double>  f( _nx-1, _ny-1, 1, 1 );
+
+    InitializeSingleWavenumber( 1, 1, f );
+    _poisson.solve( f, u );
+    _poisson.solve( f, u2 );
+    for (int i=1; i<_nx; ++i) {
+        for (int j=1; j<_ny; ++j) {
+            EXPECT_NEAR( u(i,j), u2(i,j), mgTolerance );
+        }
+    }
+}
+
 } // namespace
@@ -324,5 +324,21 @@ TEST_F(FluxTest, UniformFlow) {
     EXPECT_ALL_Y_EQUAL( q(lev,Y,i,j), mag * _grid.Dx(lev) );
 }
 
+TEST_F(FluxTest, SetFlow) {
+    double xdot = 2.;
+    double ydot = -1.;
+    double thetadot = 0.5;
+    double xC = 0.3;
+    double yC = -0.7;
+    TangentSE2 g( 0., 0., 0., xdot, ydot, thetadot );
+    _f.setFlow( g, xC, yC );
+    EXPECT_ALL_X_EQUAL( _f(lev,X,i,j),
+        ( xdot - thetadot * ( _grid.getYCenter(lev,j) - yC ) )
+            * _grid.Dx(lev) );
+    EXPECT_ALL_Y_EQUAL( _f(lev,Y,i,j),
+        ( ydot + thetadot * ( _grid.getXCenter(lev,i) - xC ) )
+            * _grid.Dx(lev) );
+}
+
 #undef EXPECT_ALL_X_EQUAL
 #undef EXPECT_ALL_Y_EQUAL
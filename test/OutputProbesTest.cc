@@ -1,4 +1,6 @@
 #include "OutputProbes.h"
+#include "State.h"
+#include <stdio.h>
 #include <gtest/gtest.h>
 
 using namespace ibpm;
@@ -67,4 +69,83 @@ TEST_F(OutputProbesTest, TestgetProbeInfoFunctions){
 	EXPECT_DOUBLE_EQ( jj, probe.getProbeIndexY(3) );
 }
 
+// Probe-local sampling of velocities and gradients, checked against a
+// linear velocity field, for which bilinear interpolation and centered
+// differences are exact:
+//   u = 0.2 + 0.3 x - 0.5 y
+//   v = -0.1 + 0.4 x - 0.3 y
+// The fluxes are velocities times dx, evaluated at the edge midpoints,
+// so the two-flux node average recovers the velocity at the node
+// exactly.  The vorticity field is a separate linear function.
+TEST_F(OutputProbesTest, ProbeLocalVelocitySampling) {
+	double dx = _grid.Dx();
+	State x( _grid, 0 );
+	x.timestep = 7;
+	x.time = 0.35;
+	for (int i=0; i<=_nx; ++i) {
+		for (int j=0; j<_ny; ++j) {
+			double xc = _grid.getXEdge(0,i);
+			double yc = _grid.getYEdge(0,j) + 0.5 * dx;
+			x.q(0,X,i,j) = ( 0.2 + 0.3 * xc - 0.5 * yc ) * dx;
+		}
+	}
+	for (int i=0; i<_nx; ++i) {
+		for (int j=0; j<=_ny; ++j) {
+			double xc = _grid.getXEdge(0,i) + 0.5 * dx;
+			double yc = _grid.getYEdge(0,j);
+			x.q(0,Y,i,j) = ( -0.1 + 0.4 * xc - 0.3 * yc ) * dx;
+		}
+	}
+	for (int i=1; i<_nx; ++i) {
+		for (int j=1; j<_ny; ++j) {
+			x.omega(0,i,j) = 1. + 2. * _grid.getXEdge(0,i)
+				- _grid.getYEdge(0,j);
+		}
+	}
+
+	OutputProbes probe( "testProbeLocal%01d.dat", _grid );
+	probe.setWriteGradients( true );
+	probe.addProbeByIndex( 3, 4 );      // on a gridpoint
+	probe.addProbeByPosition( _grid.getXEdge(0,5) + 0.3 * dx,
+	                          _grid.getYEdge(0,6) + 0.7 * dx );
+	ASSERT_TRUE( probe.init() );
+	ASSERT_TRUE( probe.doOutput( x ) );
+	ASSERT_TRUE( probe.cleanup() );
+
+	for (int n=1; n<=2; ++n) {
+		double px = probe.getProbeCoordX( n );
+		double py = probe.getProbeCoordY( n );
+		char fname[256];
+		sprintf( fname, "testProbeLocal%01d.dat", n );
+		FILE* fp = fopen( fname, "r" );
+		ASSERT_TRUE( fp != NULL );
+		int step;
+		double t, u, v, qx, qy, w, dudx, dudy, dvdx, dvdy;
+		int nread = fscanf( fp,
+			"%d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+			&step, &t, &u, &v, &qx, &qy, &w,
+			&dudx, &dudy, &dvdx, &dvdy );
+		fclose( fp );
+		ASSERT_EQ( 11, nread );
+		EXPECT_EQ( 7, step );
+		EXPECT_NEAR( 0.35, t, 1e-6 );
+		EXPECT_NEAR( 0.2 + 0.3 * px - 0.5 * py, u, tol * 100 );
+		EXPECT_NEAR( -0.1 + 0.4 * px - 0.3 * py, v, tol * 100 );
+		// raw fluxes are sampled at the edge midpoints, half a cell
+		// from the probe's node
+		EXPECT_NEAR( ( 0.2 + 0.3 * px - 0.5 * (py + 0.5*dx) ) * dx,
+		             qx, tol * 100 );
+		EXPECT_NEAR( ( -0.1 + 0.4 * (px + 0.5*dx) - 0.3 * py ) * dx,
+		             qy, tol * 100 );
+		EXPECT_NEAR( 1. + 2. * px - py, w, tol * 100 );
+		EXPECT_NEAR(  0.3, dudx, tol * 100 );
+		EXPECT_NEAR( -0.5, dudy, tol * 100 );
+		EXPECT_NEAR(  0.4, dvdx, tol * 100 );
+		EXPECT_NEAR( -0.3, dvdy, tol * 100 );
+	}
+	remove( "testProbeLocal0.dat" );
+	remove( "testProbeLocal1.dat" );
+	remove( "testProbeLocal2.dat" );
+}
+
 }  // namespace
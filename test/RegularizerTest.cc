@@ -184,9 +184,49 @@ TEST_F(RegularizerTest, InterpolateConstant) {
 
 TEST_F(RegularizerTest, SmoothThenInterpolateEqualsQuarter) {
     BoundaryVector f = _regularizer->toBoundary(_u2);
-    
+
     EXPECT_NEAR( f(X,0), _u1(X,0) * 0.25, tol );
     EXPECT_NEAR( f(Y,0), _u1(Y,0) * 0.25, tol );
 }
 
+TEST_F(RegularizerTest, LinearKernelSumsToOneWithNarrowerSupport) {
+    // The 2-cell hat kernel also satisfies the partition of unity...
+    Regularizer reg( _grid, _geom, Regularizer::DELTA_LINEAR );
+    reg.update();
+    Flux u2 = reg.toFlux( _u1 );
+
+    Scalar one( _grid );
+    Scalar zero( _grid );
+    Flux q( _grid );
+    one = 1.;
+    zero = 0.;
+
+    VelocityToFlux( one, zero, q );
+    double sum = InnerProduct( q, u2 ) / ( _dx * _dx );
+    EXPECT_NEAR( _u1(X,0), sum, tol );
+
+    VelocityToFlux( zero, one, q );
+    sum = InnerProduct( q, u2 ) / ( _dx * _dx );
+    EXPECT_NEAR( _u1(Y,0), sum, tol );
+
+    // ...and interpolates a constant exactly
+    Scalar u(_grid);
+    Scalar v(_grid);
+    u = 7;
+    v = 9;
+    VelocityToFlux( u, v, q );
+    BoundaryVector f = reg.toBoundary( q );
+    EXPECT_NEAR( f(X,0), 7, tol );
+    EXPECT_NEAR( f(Y,0), 9, tol );
+
+    // ...with a narrower footprint: fluxes a full cell away vanish
+    Flux::index ind;
+    for (ind = u2.begin(); ind != u2.end(); ++ind) {
+        if (fabs(u2.x(0,ind)) + tol > _dx ||
+            fabs(u2.y(0,ind)) + tol > _dx) {
+            EXPECT_NEAR( u2(0,ind), 0, tol );
+        }
+    }
+}
+
 } // namespace
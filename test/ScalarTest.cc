@@ -196,6 +196,41 @@ TEST_F(ScalarTestX, DoubleTimesScalar) {
     EXPECT_ALL_EQUAL( h(lev,i,j), g(lev,i,j) * 11 );
 }
 
+TEST_F(ScalarTestX, ActiveBox) {
+    int i1, i2, j1, j2;
+    Scalar h( _grid );
+    h = 0.;
+    EXPECT_FALSE( h.activeBox( 0, i1, i2, j1, j2 ) );
+    EXPECT_GT( i1, i2 );
+    h(1,3,2) = 5.;
+    h(1,5,7) = -2.;
+    EXPECT_FALSE( h.activeBox( 0, i1, i2, j1, j2 ) );
+    EXPECT_TRUE( h.activeBox( 1, i1, i2, j1, j2 ) );
+    EXPECT_EQ( 3, i1 );
+    EXPECT_EQ( 5, i2 );
+    EXPECT_EQ( 2, j1 );
+    EXPECT_EQ( 7, j2 );
+    // full box on a fully nonzero level
+    EXPECT_TRUE( _g.activeBox( 2, i1, i2, j1, j2 ) );
+    EXPECT_EQ( 1, i1 );
+    EXPECT_EQ( _nx-1, i2 );
+    EXPECT_EQ( 1, j1 );
+    EXPECT_EQ( _ny-1, j2 );
+}
+
+TEST_F(ScalarTestX, MultiplyActive) {
+    // h is compactly supported; multiplyActive must agree with *=
+    Scalar h( _grid );
+    h = 0.;
+    h(0,2,3) = 4.;
+    h(1,4,5) = -1.;
+    h(1,6,9) = 2.;
+    Scalar expected = _g;
+    expected *= h;
+    _g.multiplyActive( h );
+    EXPECT_ALL_EQUAL( _g(lev,i,j), expected(lev,i,j) );
+}
+
 TEST_F(ScalarTestX, DivEquals) {
     _g /= _f;
     EXPECT_ALL_EQUAL( _g(lev,i,j), g(lev,i,j) / f(lev,i,j) );
@@ -84,6 +84,113 @@ TEST_F( StateTest, Save ) {
     unlink("state_test");
 }
 
+TEST_F( StateTest, SaveDelta ) {
+    // Write a keyframe, then a delta against it, and reconstruct
+    bool success = _x.save("state_test_key");
+    ASSERT_EQ( true, success );
+
+    State x2( _x );
+    x2.q += 0.25;
+    x2.omega += 0.5;
+    x2.f += 0.125;
+    x2.timestep = 5;
+    x2.time = 0.625;
+    success = x2.saveDelta( "state_test_d", "state_test_key", _x, false );
+    ASSERT_EQ( true, success );
+
+    State y( _grid, _numPoints );
+    success = y.load( "state_test_d" );
+    EXPECT_EQ( true, success );
+    EXPECT_SCALAR_EQ( x2.omega(lev,i,j), y.omega(lev,i,j) );
+    EXPECT_FLUX_X_EQ( x2.q(lev,X,i,j),   y.q(lev,X,i,j)   );
+    EXPECT_FLUX_Y_EQ( x2.q(lev,Y,i,j),   y.q(lev,Y,i,j)   );
+    EXPECT_BV_EQ(     x2.f(dir,i),   y.f(dir,i)   );
+    EXPECT_DOUBLE_EQ( x2.time,       y.time       );
+    EXPECT_EQ(        x2.timestep,   y.timestep   );
+
+    // Quantized deltas reconstruct to within the 16-bit quantization step
+    success = x2.saveDelta( "state_test_dq", "state_test_key", _x, true );
+    ASSERT_EQ( true, success );
+    State z( _grid, _numPoints );
+    success = z.load( "state_test_dq" );
+    EXPECT_EQ( true, success );
+    EXPECT_SCALAR_EQ( x2.omega(lev,i,j), z.omega(lev,i,j) );
+    EXPECT_EQ( x2.timestep, z.timestep );
+
+    // describe() reads the header and tail without the keyframe
+    StateInfo info;
+    EXPECT_EQ( true, State::describe( "state_test_d", info ) );
+    EXPECT_EQ( true, info.delta );
+    EXPECT_EQ( _nx, info.nx );
+    EXPECT_EQ( x2.timestep, info.timestep );
+    EXPECT_DOUBLE_EQ( x2.time, info.time );
+
+    unlink("state_test_key");
+    unlink("state_test_d");
+    unlink("state_test_dq");
+}
+
+TEST_F( StateTest, ComputeBodyForce ) {
+    BoundaryVector points( _numPoints );
+    points(X,0) = 1.;
+    points(Y,0) = 2.;
+    points(X,1) = -0.5;
+    points(Y,1) = 0.25;
+    _x.f(X,0) = 1.;
+    _x.f(Y,0) = -2.;
+    _x.f(X,1) = 3.;
+    _x.f(Y,1) = 0.5;
+    double dx2 = _grid.Dx() * _grid.Dx();
+
+    // the whole range reproduces computeNetForce
+    double fx;
+    double fy;
+    double moment;
+    _x.computeBodyForce( 0, _numPoints, points, 0., 0., fx, fy, moment );
+    double fxNet;
+    double fyNet;
+    _x.computeNetForce( fxNet, fyNet );
+    EXPECT_DOUBLE_EQ( fxNet, fx );
+    EXPECT_DOUBLE_EQ( fyNet, fy );
+    double expected = dx2 * ( 1.*(-2.) - 2.*1. + (-0.5)*0.5 - 0.25*3. );
+    EXPECT_NEAR( expected, moment, 1e-14 );
+
+    // a single-point range, with a nonzero center
+    _x.computeBodyForce( 1, 2, points, 0.5, -1., fx, fy, moment );
+    EXPECT_DOUBLE_EQ( 3. * dx2, fx );
+    EXPECT_DOUBLE_EQ( 0.5 * dx2, fy );
+    expected = dx2 * ( (-0.5 - 0.5) * 0.5 - (0.25 + 1.) * 3. );
+    EXPECT_NEAR( expected, moment, 1e-14 );
+}
+
+TEST_F( StateTest, Describe ) {
+    // plain, single-precision, and compressed files all report the same
+    // metadata from their headers alone
+    bool success = _x.save("state_test");
+    ASSERT_EQ( true, success );
+    success = _x.save("state_test_z", true);
+    ASSERT_EQ( true, success );
+    success = _x.save("state_test_f", false, true);
+    ASSERT_EQ( true, success );
+
+    const char* files[] = { "state_test", "state_test_z", "state_test_f" };
+    for (int i=0; i<3; ++i) {
+        StateInfo info;
+        EXPECT_EQ( true, State::describe( files[i], info ) );
+        EXPECT_EQ( _nx, info.nx );
+        EXPECT_EQ( _ny, info.ny );
+        EXPECT_EQ( _ngrid, info.ngrid );
+        EXPECT_EQ( _numPoints, info.numPoints );
+        EXPECT_EQ( _x.timestep, info.timestep );
+        EXPECT_DOUBLE_EQ( _grid.Dx(), info.dx );
+        EXPECT_DOUBLE_EQ( _x.time, info.time );
+    }
+
+    unlink("state_test");
+    unlink("state_test_z");
+    unlink("state_test_f");
+}
+
 TEST_F( StateTest, LoadBadGeometry ) {
     bool status = _x.save("state_test");
     ASSERT_EQ( true, status );
@@ -105,8 +212,118 @@ TEST_F( StateTest, LoadBadGrid ) {
     State y( newGrid, _numPoints );
     status = y.load( "state_test" );
     EXPECT_EQ( false, status );
-    
+
     unlink("state_test");
 }
 
+TEST_F( StateTest, SaveCompact ) {
+    // Vary the vorticity so the coarse-level reconstruction is visible
+    for (int i=1; i<_nx; ++i) {
+        for (int j=1; j<_ny; ++j) {
+            _x.omega(0,i,j) = i + 0.1 * j;
+        }
+    }
+    bool success = _x.saveCompact("state_test_compact");
+    ASSERT_EQ( true, success );
+
+    State y( _grid, _numPoints );
+    success = y.load( "state_test_compact" );
+    EXPECT_EQ( true, success );
+
+    // The finest level and the boundary force round-trip exactly
+    for (int i=1; i<_nx; ++i) {
+        for (int j=1; j<_ny; ++j) {
+            EXPECT_DOUBLE_EQ( _x.omega(0,i,j), y.omega(0,i,j) );
+        }
+    }
+    for ( int i=0; i<_nx+1; ++i ) {
+        for ( int j=0; j<_ny; ++j ) {
+            EXPECT_DOUBLE_EQ( _x.q(0,X,i,j), y.q(0,X,i,j) );
+        }
+    }
+    EXPECT_BV_EQ( _x.f(dir,i), y.f(dir,i) );
+    EXPECT_DOUBLE_EQ( _x.time, y.time );
+    EXPECT_EQ( _x.timestep, y.timestep );
+
+    // The coarse vorticity levels are rebuilt by averaging down from
+    // the finest, starting from zero
+    Scalar expected( _grid );
+    expected = 0.;
+    for (int i=1; i<_nx; ++i) {
+        for (int j=1; j<_ny; ++j) {
+            expected(0,i,j) = _x.omega(0,i,j);
+        }
+    }
+    expected.coarsify();
+    EXPECT_SCALAR_EQ( expected(lev,i,j), y.omega(lev,i,j) );
+
+    StateInfo info;
+    EXPECT_EQ( true, State::describe( "state_test_compact", info ) );
+    EXPECT_EQ( true, info.compact );
+    EXPECT_EQ( _ngrid, info.ngrid );
+    EXPECT_EQ( _x.timestep, info.timestep );
+
+    unlink("state_test_compact");
+}
+
+TEST_F( StateTest, CopyOnWrite ) {
+    // A copy shares the original's arena until one of them is written
+    const State& xc = _x;
+    State y( _x );
+    const State& yc = y;
+    EXPECT_TRUE( yc.flatten() == xc.flatten() );
+    EXPECT_DOUBLE_EQ( 2., yc.omega(0,1,1) );
+
+    // Writing to the copy detaches it; the original is untouched, and
+    // the rest of the copy's data was carried over
+    y.omega(0,1,1) = 42.;
+    EXPECT_TRUE( yc.flatten() != xc.flatten() );
+    EXPECT_DOUBLE_EQ( 42., yc.omega(0,1,1) );
+    EXPECT_DOUBLE_EQ( 2., _x.omega(0,1,1) );
+    EXPECT_FLUX_X_EQ( _x.q(lev,X,i,j), yc.q(lev,X,i,j) );
+    EXPECT_BV_EQ( _x.f(dir,i), yc.f(dir,i) );
+
+    // Writing to the original detaches it from a shared copy, too
+    State z( _grid, _numPoints );
+    z = _x;
+    const State& zc = z;
+    EXPECT_TRUE( zc.flatten() == xc.flatten() );
+    _x.q(0,X,0,0) = 7.;
+    EXPECT_TRUE( zc.flatten() != xc.flatten() );
+    EXPECT_DOUBLE_EQ( 1., zc.q(0,X,0,0) );
+    EXPECT_DOUBLE_EQ( 7., _x.q(0,X,0,0) );
+
+    // swap() hands the shared view to another state, which still
+    // detaches correctly when the original is written afterwards
+    State a( _x );
+    State b( _grid, _numPoints );
+    b.swap( a );
+    _x.omega(0,2,2) = -3.;
+    const State& bc = b;
+    EXPECT_DOUBLE_EQ( 2., bc.omega(0,2,2) );
+    EXPECT_DOUBLE_EQ( 7., bc.q(0,X,0,0) );
+    EXPECT_DOUBLE_EQ( -3., _x.omega(0,2,2) );
+}
+
+TEST_F( StateTest, ContiguousArena ) {
+    // The fields are backed by one contiguous block: q, then omega,
+    // then f (see State::resize), so values written through the field
+    // interfaces appear at the expected offsets of flatten()
+    const double* arena = _x.flatten();
+    ASSERT_TRUE( arena != NULL );
+    unsigned int qSize = _x.q.getSize();
+    unsigned int omegaSize = _x.omega.getSize();
+    EXPECT_EQ( qSize + omegaSize + 2 * (unsigned int) _numPoints,
+               _x.getSize() );
+
+    _x.q(1,X,2,3) = 17.;
+    _x.omega(2,1,4) = 19.;
+    _x.f(Y,1) = 23.;
+    EXPECT_DOUBLE_EQ( 17.,
+        arena[ 1 * ( qSize / _ngrid ) + _x.q.getIndex(X,2,3) ] );
+    EXPECT_DOUBLE_EQ( 19., arena[ qSize + 2 * ( omegaSize / _ngrid )
+        + (1-1) * (_ny-1) + (4-1) ] );
+    EXPECT_DOUBLE_EQ( 23., arena[ qSize + omegaSize + _numPoints + 1 ] );
+}
+
 } // namespace
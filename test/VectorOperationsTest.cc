@@ -7,6 +7,7 @@
 #include "VectorOperations.h"
 #include "SingleWavenumber.h"
 #include <gtest/gtest.h>
+#include <vector>
 
 using Array::Array2;
 
@@ -105,6 +106,15 @@ protected:
         }                                       \
     }
 
+#define EXPECT_ALL_NEAR(a,b,tol)                \
+    for (int lev=0; lev<_ngrid; ++lev) {        \
+        for (int i=1; i<_nx; ++i) {             \
+            for (int j=1; j<_ny; ++j) {         \
+                EXPECT_NEAR( (a), (b), tol );   \
+            }                                   \
+        }                                       \
+    }
+
 // for Fluxes
 #define EXPECT_ALL_X_EQ(a,b)                    \
     for (int lev=0; lev<_ngrid; ++lev) {        \
@@ -583,8 +593,126 @@ TEST_P(VectorOperationsTestY, FluxToVelocity) {
 			EXPECT_NEAR( IPFlux, IPScalar, tol );
 		}
 	}
-}	
-	
+}
+
+TEST_F(VectorOperationsTestX, FluxToVelocityBuffers) {
+    // The caller-buffer variant writes the same values as the Scalar
+    // version, with each buffer laid out like the Scalar's flat
+    // interior data
+    Flux q = getFlux( 5 );
+    Scalar u(_grid);
+    Scalar v(_grid);
+    u = 0.;
+    v = 0.;
+    FluxToVelocity( q, u, v );
+
+    int n = _ngrid * (_nx-1) * (_ny-1);
+    std::vector<double> ubuf( n, 0. );
+    std::vector<double> vbuf( n, 0. );
+    FluxToVelocity( q, &ubuf[0], &vbuf[0] );
+
+    for (int lev=0; lev<_ngrid; ++lev) {
+        for (int i=1; i<_nx; ++i) {
+            for (int j=1; j<_ny; ++j) {
+                int ind = ( lev * (_nx-1) + (i-1) ) * (_ny-1) + (j-1);
+                EXPECT_DOUBLE_EQ( u(lev,i,j), ubuf[ind] );
+                EXPECT_DOUBLE_EQ( v(lev,i,j), vbuf[ind] );
+            }
+        }
+    }
+}
+
+// The level-capped variants (used by the multirate advection scheme)
+// reproduce the full versions on the finest maxlev levels and leave the
+// coarser levels of their output untouched
+TEST_F(VectorOperationsTestX, LevelCappedConversions) {
+    const int maxlev = 2;
+    Flux q = getFlux( 5 );
+    const double sentinel = 123.456;
+
+    // FluxToXVelocity / FluxToYVelocity / Curl.  Both versions leave the
+    // coarse-level interior of the velocities alone (only the border
+    // bands are consumed downstream), so the full outputs start from the
+    // same sentinel and untouched points compare equal
+    Scalar uFull(_grid);
+    Scalar vFull(_grid);
+    Scalar wFull(_grid);
+    uFull = sentinel;
+    vFull = sentinel;
+    wFull = sentinel;
+    FluxToXVelocity( q, uFull );
+    FluxToYVelocity( q, vFull );
+    Curl( q, wFull );
+    Scalar uCap(_grid);
+    Scalar vCap(_grid);
+    Scalar wCap(_grid);
+    uCap = sentinel;
+    vCap = sentinel;
+    wCap = sentinel;
+    FluxToXVelocity( q, uCap, maxlev );
+    FluxToYVelocity( q, vCap, maxlev );
+    Curl( q, wCap, maxlev );
+    for (int lev=0; lev<_ngrid; ++lev) {
+        for (int i=1; i<_nx; ++i) {
+            for (int j=1; j<_ny; ++j) {
+                if ( lev < maxlev ) {
+                    EXPECT_DOUBLE_EQ( uFull(lev,i,j), uCap(lev,i,j) );
+                    EXPECT_DOUBLE_EQ( vFull(lev,i,j), vCap(lev,i,j) );
+                    EXPECT_DOUBLE_EQ( wFull(lev,i,j), wCap(lev,i,j) );
+                }
+                else {
+                    EXPECT_DOUBLE_EQ( sentinel, uCap(lev,i,j) );
+                    EXPECT_DOUBLE_EQ( sentinel, vCap(lev,i,j) );
+                    EXPECT_DOUBLE_EQ( sentinel, wCap(lev,i,j) );
+                }
+            }
+        }
+    }
+
+    // VelocityToFlux: the capped call still reads the level-maxlev
+    // velocities for the interface boundary of level maxlev-1, so with a
+    // full velocity field supplied the capped levels match the full call
+    Flux qFull(_grid);
+    Flux qCap(_grid);
+    qCap = sentinel;
+    VelocityToFlux( uFull, vFull, qFull );
+    VelocityToFlux( uFull, vFull, qCap, maxlev );
+    for (int lev=0; lev<_ngrid; ++lev) {
+        for (Flux::index ind = q.begin(X); ind != q.end(X); ++ind) {
+            if ( lev < maxlev ) {
+                EXPECT_DOUBLE_EQ( qFull(lev,ind), qCap(lev,ind) );
+            }
+            else {
+                EXPECT_DOUBLE_EQ( sentinel, qCap(lev,ind) );
+            }
+        }
+        for (Flux::index ind = q.begin(Y); ind != q.end(Y); ++ind) {
+            if ( lev < maxlev ) {
+                EXPECT_DOUBLE_EQ( qFull(lev,ind), qCap(lev,ind) );
+            }
+            else {
+                EXPECT_DOUBLE_EQ( sentinel, qCap(lev,ind) );
+            }
+        }
+    }
+
+    // multiplyActive with a scale and a level cap: equals the product
+    // times the scale on the capped levels, untouched above
+    Scalar f = getScalar( 3 );
+    Scalar g = getScalar( 4 );
+    Scalar fCap = f;
+    fCap.multiplyActive( g, -2., maxlev );
+    for (int lev=0; lev<_ngrid; ++lev) {
+        for (int i=1; i<_nx; ++i) {
+            for (int j=1; j<_ny; ++j) {
+                double expected = ( lev < maxlev ) ?
+                    -2. * f(lev,i,j) * g(lev,i,j) : f(lev,i,j);
+                EXPECT_DOUBLE_EQ( expected, fCap(lev,i,j) );
+            }
+        }
+    }
+}
+
 // =================
 // = Cross product =
 // =================
@@ -732,6 +860,38 @@ TEST_F(VectorOperationsTestX, CurlOfLinearFlux) {
     EXPECT_ALL_EQ( a - b, CurlQ(lev,i,j) );
 }
 
+// Test curl of a compactly supported Scalar, exercising the active-region
+// path: points outside the bounding box of the nonzero values are filled
+// rather than computed
+TEST_F(VectorOperationsTestX, CurlOfCompactScalar) {
+    // single-level grid, so all boundary conditions are zero
+    Grid grid( _nx, _ny, 1, 2., -1., 3. );
+    Scalar f( grid );
+    f = 0.;
+    int i0 = _nx/2;
+    int j0 = _ny/2;
+    f(0,i0,j0) = 3.;
+    Flux q = Curl( f );
+    // X-fluxes: df/dy is nonzero only just below and at the spike
+    for (int i=0; i<=_nx; ++i) {
+        for (int j=0; j<_ny; ++j) {
+            double expected = 0.;
+            if ( i == i0 && j == j0-1 ) expected = 3.;
+            if ( i == i0 && j == j0 ) expected = -3.;
+            EXPECT_DOUBLE_EQ( expected, q(0,X,i,j) );
+        }
+    }
+    // Y-fluxes: -df/dx is nonzero only at and just left of the spike
+    for (int i=0; i<_nx; ++i) {
+        for (int j=0; j<=_ny; ++j) {
+            double expected = 0.;
+            if ( i == i0 && j == j0 ) expected = 3.;
+            if ( i == i0-1 && j == j0 ) expected = -3.;
+            EXPECT_DOUBLE_EQ( expected, q(0,Y,i,j) );
+        }
+    }
+}
+
 // Test curl( ax + by + c ) = (b, -a)  (constant)
 TEST_F(VectorOperationsTestX, CurlOfLinearScalar) {
     double a = 7;
@@ -876,7 +1036,31 @@ TEST_F(VectorOperationsTestX, LaplacianOfLinearScalarEqualsZero) {
     // fudge boundary
     SetScalarBoundary( 0, Lu );
     EXPECT_ALL_EQ( 0., Lu(lev,i,j) );
-}    
+}
+
+TEST_F(VectorOperationsTestX, LaplacianEqualsMinusCurlCurl) {
+    // The direct stencil in Laplacian agrees with its multi-domain
+    // definition -Curl( Curl( f ) ), including the boundary values
+    // interpolated from the coarser levels
+    Scalar u(_grid);
+    for (int lev=0; lev<_ngrid; ++lev) {
+        for (int i=1; i<_nx; ++i) {
+            double x = _grid.getXEdge(lev,i);
+            for (int j=1; j<_ny; ++j) {
+                double y = _grid.getYEdge(lev,j);
+                u(lev,i,j) = x * x * y + 2. * x * y - 3. * y * y + 0.5 * x;
+            }
+        }
+    }
+    Scalar Lu(_grid);
+    Laplacian( u, Lu );
+
+    Flux q = Curl( u );
+    Scalar expected(_grid);
+    Curl( q, expected );
+    expected *= -1;
+    EXPECT_ALL_NEAR( expected(lev,i,j), Lu(lev,i,j), 1e-9 );
+}
 
 // ================================
 // = BoundaryVector inner product =